@@ -0,0 +1,405 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * File System Virtual Channel - metadata cache
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/path.h>
+#include <winpr/string.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/inotify.h>
+#define DRIVE_CACHE_INOTIFY
+#endif
+
+#include "drive_file.h"
+#include "drive_cache.h"
+
+/* Metadata is shared by all handles of a drive and keyed by the (UTF-8) local path. Changes made
+ * through the drive invalidate entries directly, changes made by other processes are picked up
+ * from inotify where available and otherwise bounded by the TTL. */
+
+/* the cache is dropped completely once it grows beyond this */
+#define DRIVE_CACHE_MAX_ENTRIES 16384
+
+#if defined(DRIVE_CACHE_INOTIFY)
+#define DRIVE_CACHE_WATCH_MASK                                                     \
+	(IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | \
+	 IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+typedef struct
+{
+	BY_HANDLE_FILE_INFORMATION info;
+	UINT64 expires;
+} DRIVE_CACHE_ENTRY;
+
+struct S_DRIVE_CACHE
+{
+	UINT32 ttl;
+	CRITICAL_SECTION lock;
+	wHashTable* entries;
+#if defined(DRIVE_CACHE_INOTIFY)
+	int inotify;
+	wHashTable* watches; /* watch descriptor -> directory */
+	wHashTable* watched; /* directory -> watch descriptor */
+#endif
+};
+
+static char* cache_key(const WCHAR* path, const WCHAR* name)
+{
+	size_t length = 0;
+	char* key = ConvertWCharToUtf8Alloc(path, &length);
+	if (!key || !name)
+		return key;
+
+	size_t nameLength = 0;
+	char* utf8 = ConvertWCharToUtf8Alloc(name, &nameLength);
+	char* full = utf8 ? calloc(length + nameLength + 2, sizeof(char)) : NULL;
+	if (full)
+	{
+		memcpy(full, key, length);
+		full[length] = PathGetSeparatorA(PATH_STYLE_NATIVE);
+		memcpy(&full[length + 1], utf8, nameLength);
+	}
+	free(utf8);
+	free(key);
+	return full;
+}
+
+static char* cache_key_append(const char* path, const char* name)
+{
+	const size_t length = strlen(path);
+	const size_t nameLength = strlen(name);
+	char* full = calloc(length + nameLength + 2, sizeof(char));
+	if (!full)
+		return NULL;
+
+	memcpy(full, path, length);
+	full[length] = PathGetSeparatorA(PATH_STYLE_NATIVE);
+	memcpy(&full[length + 1], name, nameLength);
+	return full;
+}
+
+static char* cache_parent(const char* path)
+{
+	const char* sep = strrchr(path, PathGetSeparatorA(PATH_STYLE_NATIVE));
+	if (!sep || (sep == path))
+		return NULL;
+
+	const size_t length = (size_t)(sep - path);
+	char* parent = calloc(length + 1, sizeof(char));
+	if (parent)
+		memcpy(parent, path, length);
+	return parent;
+}
+
+static void cache_remove_parent(DRIVE_CACHE* cache, const char* path)
+{
+	char* parent = cache_parent(path);
+	if (parent)
+		HashTable_Remove(cache->entries, parent);
+	free(parent);
+}
+
+static void cache_remove_below(DRIVE_CACHE* cache, const char* path)
+{
+	const size_t length = strlen(path);
+	const char sep = PathGetSeparatorA(PATH_STYLE_NATIVE);
+	ULONG_PTR* keys = NULL;
+	const size_t count = HashTable_GetKeys(cache->entries, &keys);
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const char* key = (const char*)keys[x];
+		if ((strncmp(key, path, length) == 0) && (key[length] == sep))
+			HashTable_Remove(cache->entries, key);
+	}
+	free(keys);
+}
+
+#if defined(DRIVE_CACHE_INOTIFY)
+static void cache_unwatch(DRIVE_CACHE* cache, int wd)
+{
+	void* key = (void*)(size_t)wd;
+	const char* dir = HashTable_GetItemValue(cache->watches, key);
+	if (!dir)
+		return;
+
+	HashTable_Remove(cache->entries, dir);
+	cache_remove_below(cache, dir);
+	HashTable_Remove(cache->watched, dir);
+	HashTable_Remove(cache->watches, key);
+}
+
+static void cache_watch(DRIVE_CACHE* cache, const char* dir)
+{
+	if ((cache->inotify < 0) || !dir || HashTable_Contains(cache->watched, dir))
+		return;
+
+	/* without a watch the entry is still bounded by the TTL */
+	const int wd = inotify_add_watch(cache->inotify, dir, DRIVE_CACHE_WATCH_MASK);
+	if (wd < 0)
+		return;
+
+	if (!HashTable_Insert(cache->watches, (void*)(size_t)wd, dir) ||
+	    !HashTable_Insert(cache->watched, dir, (void*)(size_t)wd))
+	{
+		HashTable_Remove(cache->watches, (void*)(size_t)wd);
+		(void)inotify_rm_watch(cache->inotify, wd);
+	}
+}
+
+static void cache_handle_event(DRIVE_CACHE* cache, const struct inotify_event* event)
+{
+	if (event->mask & IN_Q_OVERFLOW)
+	{
+		HashTable_Clear(cache->entries);
+		return;
+	}
+
+	const char* dir = HashTable_GetItemValue(cache->watches, (void*)(size_t)event->wd);
+	if (!dir)
+		return;
+
+	if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+	{
+		if (!(event->mask & IN_IGNORED))
+			(void)inotify_rm_watch(cache->inotify, event->wd);
+		cache_unwatch(cache, event->wd);
+		return;
+	}
+
+	/* any change in a directory also changes its own timestamps */
+	HashTable_Remove(cache->entries, dir);
+	if (event->len > 0)
+	{
+		char* path = cache_key_append(dir, event->name);
+		if (!path)
+		{
+			HashTable_Clear(cache->entries);
+			return;
+		}
+
+		HashTable_Remove(cache->entries, path);
+		if (event->mask & IN_ISDIR)
+			cache_remove_below(cache, path);
+		free(path);
+	}
+}
+
+static void cache_poll(DRIVE_CACHE* cache)
+{
+	union
+	{
+		struct inotify_event event;
+		char buffer[4096];
+	} u;
+
+	if (cache->inotify < 0)
+		return;
+
+	while (TRUE)
+	{
+		const ssize_t length = read(cache->inotify, u.buffer, sizeof(u.buffer));
+		if (length <= 0)
+			break;
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)&u.buffer[offset];
+			cache_handle_event(cache, event);
+			offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+		}
+	}
+}
+#endif
+
+static void cache_clear(DRIVE_CACHE* cache)
+{
+	HashTable_Clear(cache->entries);
+#if defined(DRIVE_CACHE_INOTIFY)
+	ULONG_PTR* keys = NULL;
+	const size_t count = HashTable_GetKeys(cache->watches, &keys);
+	for (size_t x = 0; x < count; x++)
+		(void)inotify_rm_watch(cache->inotify, (int)keys[x]);
+	free(keys);
+	HashTable_Clear(cache->watched);
+	HashTable_Clear(cache->watches);
+#endif
+}
+
+/* picks up changes made outside of the drive, the lock must be held */
+static void cache_refresh(DRIVE_CACHE* cache)
+{
+#if defined(DRIVE_CACHE_INOTIFY)
+	cache_poll(cache);
+#else
+	WINPR_UNUSED(cache);
+#endif
+}
+
+void drive_cache_free(DRIVE_CACHE* cache)
+{
+	if (!cache)
+		return;
+
+#if defined(DRIVE_CACHE_INOTIFY)
+	if (cache->inotify >= 0)
+		(void)close(cache->inotify);
+	HashTable_Free(cache->watches);
+	HashTable_Free(cache->watched);
+#endif
+	HashTable_Free(cache->entries);
+	DeleteCriticalSection(&cache->lock);
+	free(cache);
+}
+
+DRIVE_CACHE* drive_cache_new(UINT32 ttl)
+{
+	if (ttl == 0)
+		return NULL;
+
+	DRIVE_CACHE* cache = calloc(1, sizeof(DRIVE_CACHE));
+	if (!cache)
+		return NULL;
+
+	cache->ttl = ttl;
+#if defined(DRIVE_CACHE_INOTIFY)
+	cache->inotify = -1;
+#endif
+	InitializeCriticalSection(&cache->lock);
+	cache->entries = HashTable_New(FALSE);
+	if (!cache->entries || !HashTable_SetupForStringData(cache->entries, FALSE))
+		goto fail;
+	HashTable_ValueObject(cache->entries)->fnObjectFree = free;
+
+#if defined(DRIVE_CACHE_INOTIFY)
+	cache->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (cache->inotify < 0)
+		WLog_WARN(TAG, "inotify not available, metadata is only bounded by the TTL");
+
+	cache->watches = HashTable_New(FALSE);
+	cache->watched = HashTable_New(FALSE);
+	if (!cache->watches || !cache->watched || !HashTable_SetupForStringData(cache->watched, FALSE))
+		goto fail;
+
+	wObject* obj = HashTable_ValueObject(cache->watches);
+	obj->fnObjectNew = HashTable_StringClone;
+	obj->fnObjectFree = HashTable_StringFree;
+#endif
+
+	return cache;
+
+fail:
+	drive_cache_free(cache);
+	return NULL;
+}
+
+BOOL drive_cache_get(DRIVE_CACHE* cache, const WCHAR* path, BY_HANDLE_FILE_INFORMATION* info)
+{
+	WINPR_ASSERT(info);
+
+	if (!cache || !path)
+		return FALSE;
+
+	char* key = cache_key(path, NULL);
+	if (!key)
+		return FALSE;
+
+	BOOL rc = FALSE;
+	EnterCriticalSection(&cache->lock);
+	cache_refresh(cache);
+
+	const DRIVE_CACHE_ENTRY* entry = HashTable_GetItemValue(cache->entries, key);
+	if (entry && (entry->expires > GetTickCount64()))
+	{
+		*info = entry->info;
+		rc = TRUE;
+	}
+	else if (entry)
+		HashTable_Remove(cache->entries, key);
+
+	LeaveCriticalSection(&cache->lock);
+	free(key);
+	return rc;
+}
+
+void drive_cache_put(DRIVE_CACHE* cache, const WCHAR* path, const WCHAR* name,
+                     const BY_HANDLE_FILE_INFORMATION* info)
+{
+	WINPR_ASSERT(info);
+
+	if (!cache || !path)
+		return;
+
+	char* key = cache_key(path, name);
+	DRIVE_CACHE_ENTRY* entry = calloc(1, sizeof(DRIVE_CACHE_ENTRY));
+	if (!key || !entry)
+		goto fail;
+
+	entry->info = *info;
+	entry->expires = GetTickCount64() + cache->ttl;
+
+	EnterCriticalSection(&cache->lock);
+	cache_refresh(cache);
+
+	if (HashTable_Count(cache->entries) >= DRIVE_CACHE_MAX_ENTRIES)
+		cache_clear(cache);
+
+#if defined(DRIVE_CACHE_INOTIFY)
+	char* parent = cache_parent(key);
+	cache_watch(cache, parent);
+	free(parent);
+#endif
+
+	if (HashTable_Insert(cache->entries, key, entry))
+		entry = NULL;
+	LeaveCriticalSection(&cache->lock);
+
+fail:
+	free(entry);
+	free(key);
+}
+
+void drive_cache_invalidate(DRIVE_CACHE* cache, const WCHAR* path, BOOL recursive)
+{
+	if (!cache || !path)
+		return;
+
+	char* key = cache_key(path, NULL);
+
+	EnterCriticalSection(&cache->lock);
+	if (!key)
+		cache_clear(cache);
+	else
+	{
+		HashTable_Remove(cache->entries, key);
+		cache_remove_parent(cache, key);
+		if (recursive)
+			cache_remove_below(cache, key);
+	}
+	LeaveCriticalSection(&cache->lock);
+	free(key);
+}
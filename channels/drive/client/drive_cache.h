@@ -0,0 +1,42 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * File System Virtual Channel - metadata cache
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H
+#define FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/file.h>
+
+/* metadata of a path is served from the cache for at most this many ms */
+#define DRIVE_CACHE_TTL 1000
+
+typedef struct S_DRIVE_CACHE DRIVE_CACHE;
+
+/* a NULL cache is valid and caches nothing */
+void drive_cache_free(DRIVE_CACHE* cache);
+DRIVE_CACHE* drive_cache_new(UINT32 ttl);
+
+BOOL drive_cache_get(DRIVE_CACHE* cache, const WCHAR* path, BY_HANDLE_FILE_INFORMATION* info);
+
+/* caches the metadata of path, or of name within directory path if name is not NULL */
+void drive_cache_put(DRIVE_CACHE* cache, const WCHAR* path, const WCHAR* name,
+                     const BY_HANDLE_FILE_INFORMATION* info);
+
+/* drops path and its parent directory, recursive also drops everything below path */
+void drive_cache_invalidate(DRIVE_CACHE* cache, const WCHAR* path, BOOL recursive);
+
+#endif /* FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H */
@@ -39,6 +39,7 @@
 #include <winpr/path.h>
 #include <winpr/file.h>
 #include <winpr/stream.h>
+#include <winpr/endian.h>
 
 #include <freerdp/channels/rdpdr.h>
 
@@ -321,7 +322,8 @@ static BOOL drive_file_init(DRIVE_FILE* file)
 
 DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 PathWCharLength,
                            UINT32 id, UINT32 DesiredAccess, UINT32 CreateDisposition,
-                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess)
+                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess,
+                           DRIVE_CACHE* cache)
 {
 	if (!base_path || (!path && (PathWCharLength > 0)))
 		return NULL;
@@ -343,6 +345,7 @@ DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 Pat
 	file->CreateDisposition = CreateDisposition;
 	file->CreateOptions = CreateOptions;
 	file->SharedAccess = SharedAccess;
+	file->cache = cache;
 
 	WCHAR* p = drive_file_combine_fullpath(base_path, path, PathWCharLength);
 	(void)drive_file_set_fullpath(file, p);
@@ -356,6 +359,10 @@ DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 Pat
 		return NULL;
 	}
 
+	/* everything but FILE_OPEN might have created or truncated the file */
+	if (CreateDisposition != FILE_OPEN)
+		drive_cache_invalidate(file->cache, file->fullpath, FALSE);
+
 	return file;
 }
 
@@ -383,6 +390,7 @@ BOOL drive_file_free(DRIVE_FILE* file)
 
 	if (file->delete_pending)
 	{
+		drive_cache_invalidate(file->cache, file->fullpath, file->is_dir);
 		if (file->is_dir)
 		{
 			if (!winpr_RemoveDirectory_RecursiveW(file->fullpath))
@@ -395,6 +403,7 @@ BOOL drive_file_free(DRIVE_FILE* file)
 	rc = TRUE;
 fail:
 	DEBUG_WSTR("Free %s", file->fullpath);
+	free(file->find_dir);
 	free(file->fullpath);
 	free(file);
 	return rc;
@@ -440,6 +449,7 @@ BOOL drive_file_write(DRIVE_FILE* file, const BYTE* buffer, UINT32 Length)
 		return FALSE;
 
 	DEBUG_WSTR("Write file %s", file->fullpath);
+	drive_cache_invalidate(file->cache, file->fullpath, FALSE);
 
 	while (Length > 0)
 	{
@@ -518,85 +528,23 @@ static BOOL drive_file_query_from_handle_information(const DRIVE_FILE* file,
 	return TRUE;
 }
 
-static BOOL drive_file_query_from_attributes(const DRIVE_FILE* file,
-                                             const WIN32_FILE_ATTRIBUTE_DATA* attrib,
-                                             UINT32 FsInformationClass, wStream* output)
+static void drive_file_info_from_attributes(const WIN32_FILE_ATTRIBUTE_DATA* attrib,
+                                            BY_HANDLE_FILE_INFORMATION* info)
 {
-	switch (FsInformationClass)
-	{
-		case FileBasicInformation:
-
-			/* http://msdn.microsoft.com/en-us/library/cc232094.aspx */
-			if (!Stream_EnsureRemainingCapacity(output, 4 + 36))
-				return FALSE;
-
-			Stream_Write_UINT32(output, 36);                                    /* Length */
-			Stream_Write_UINT32(output, attrib->ftCreationTime.dwLowDateTime);  /* CreationTime */
-			Stream_Write_UINT32(output, attrib->ftCreationTime.dwHighDateTime); /* CreationTime */
-			Stream_Write_UINT32(output,
-			                    attrib->ftLastAccessTime.dwLowDateTime); /* LastAccessTime */
-			Stream_Write_UINT32(output,
-			                    attrib->ftLastAccessTime.dwHighDateTime);       /* LastAccessTime */
-			Stream_Write_UINT32(output, attrib->ftLastWriteTime.dwLowDateTime); /* LastWriteTime */
-			Stream_Write_UINT32(output, attrib->ftLastWriteTime.dwHighDateTime); /* LastWriteTime */
-			Stream_Write_UINT32(output, attrib->ftLastWriteTime.dwLowDateTime);  /* ChangeTime */
-			Stream_Write_UINT32(output, attrib->ftLastWriteTime.dwHighDateTime); /* ChangeTime */
-			Stream_Write_UINT32(output, attrib->dwFileAttributes); /* FileAttributes */
-			/* Reserved(4), MUST NOT be added! */
-			break;
-
-		case FileStandardInformation:
-
-			/*  http://msdn.microsoft.com/en-us/library/cc232088.aspx */
-			if (!Stream_EnsureRemainingCapacity(output, 4 + 22))
-				return FALSE;
-
-			Stream_Write_UINT32(output, 22);                          /* Length */
-			Stream_Write_UINT32(output, attrib->nFileSizeLow);        /* AllocationSize */
-			Stream_Write_UINT32(output, attrib->nFileSizeHigh);       /* AllocationSize */
-			Stream_Write_UINT32(output, attrib->nFileSizeLow);        /* EndOfFile */
-			Stream_Write_UINT32(output, attrib->nFileSizeHigh);       /* EndOfFile */
-			Stream_Write_UINT32(output, 0);                           /* NumberOfLinks */
-			Stream_Write_UINT8(output, file->delete_pending ? 1 : 0); /* DeletePending */
-			Stream_Write_UINT8(output, attrib->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY
-			                               ? TRUE
-			                               : FALSE); /* Directory */
-			/* Reserved(2), MUST NOT be added! */
-			break;
-
-		case FileAttributeTagInformation:
-
-			/* http://msdn.microsoft.com/en-us/library/cc232093.aspx */
-			if (!Stream_EnsureRemainingCapacity(output, 4 + 8))
-				return FALSE;
-
-			Stream_Write_UINT32(output, 8);                        /* Length */
-			Stream_Write_UINT32(output, attrib->dwFileAttributes); /* FileAttributes */
-			Stream_Write_UINT32(output, 0);                        /* ReparseTag */
-			break;
-
-		default:
-			/* Unhandled FsInformationClass */
-			WLog_WARN(TAG, "Unhandled FSInformationClass %s [0x%08" PRIx32 "]",
-			          FSInformationClass2Tag(FsInformationClass), FsInformationClass);
-			return FALSE;
-	}
-
-	return TRUE;
+	info->dwFileAttributes = attrib->dwFileAttributes;
+	info->ftCreationTime = attrib->ftCreationTime;
+	info->ftLastAccessTime = attrib->ftLastAccessTime;
+	info->ftLastWriteTime = attrib->ftLastWriteTime;
+	info->nFileSizeHigh = attrib->nFileSizeHigh;
+	info->nFileSizeLow = attrib->nFileSizeLow;
+	info->nNumberOfLinks = 0;
 }
 
-BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, wStream* output)
+static BOOL drive_file_stat(const DRIVE_FILE* file, BY_HANDLE_FILE_INFORMATION* info)
 {
-	BY_HANDLE_FILE_INFORMATION fileInformation = { 0 };
-	BOOL status = 0;
-
-	if (!file || !output)
-		return FALSE;
-
 	if ((file->file_handle != INVALID_HANDLE_VALUE) &&
-	    GetFileInformationByHandle(file->file_handle, &fileInformation))
-		return drive_file_query_from_handle_information(file, &fileInformation, FsInformationClass,
-		                                                output);
+	    GetFileInformationByHandle(file->file_handle, info))
+		return TRUE;
 
 	if (!file->is_dir)
 	{
@@ -604,30 +552,40 @@ BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, w
 		                           FILE_ATTRIBUTE_NORMAL, NULL);
 		if (hFile != INVALID_HANDLE_VALUE)
 		{
-			status = GetFileInformationByHandle(hFile, &fileInformation);
+			const BOOL status = GetFileInformationByHandle(hFile, info);
 			(void)CloseHandle(hFile);
-			if (!status)
-				goto out_fail;
-
-			if (!drive_file_query_from_handle_information(file, &fileInformation,
-			                                              FsInformationClass, output))
-				goto out_fail;
-
-			return TRUE;
+			return status;
 		}
 	}
 
 	/* If we failed before (i.e. if information for a drive is queried) fall back to
 	 * GetFileAttributesExW */
-	{
-		WIN32_FILE_ATTRIBUTE_DATA fileAttributes = { 0 };
-		if (!GetFileAttributesExW(file->fullpath, GetFileExInfoStandard, &fileAttributes))
-			goto out_fail;
+	WIN32_FILE_ATTRIBUTE_DATA fileAttributes = { 0 };
+	if (!GetFileAttributesExW(file->fullpath, GetFileExInfoStandard, &fileAttributes))
+		return FALSE;
 
-		if (!drive_file_query_from_attributes(file, &fileAttributes, FsInformationClass, output))
+	drive_file_info_from_attributes(&fileAttributes, info);
+	return TRUE;
+}
+
+BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, wStream* output)
+{
+	BY_HANDLE_FILE_INFORMATION fileInformation = { 0 };
+
+	if (!file || !output)
+		return FALSE;
+
+	if (!drive_cache_get(file->cache, file->fullpath, &fileInformation))
+	{
+		if (!drive_file_stat(file, &fileInformation))
 			goto out_fail;
+		drive_cache_put(file->cache, file->fullpath, NULL, &fileInformation);
 	}
 
+	if (!drive_file_query_from_handle_information(file, &fileInformation, FsInformationClass,
+	                                              output))
+		goto out_fail;
+
 	return TRUE;
 out_fail:
 	Stream_Write_UINT32(output, 0); /* Length */
@@ -873,6 +831,9 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 	if (!Stream_CheckAndLogRequiredLength(TAG, input, Length))
 		return FALSE;
 
+	/* a rename moves everything below a directory */
+	drive_cache_invalidate(file->cache, file->fullpath, file->is_dir);
+
 	switch (FsInformationClass)
 	{
 		case FileBasicInformation:
@@ -887,15 +848,17 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 			return drive_file_set_disposition_information(file, Length, input);
 
 		case FileRenameInformation:
-			return drive_file_set_rename_information(file, Length, input);
+		{
+			const BOOL rc = drive_file_set_rename_information(file, Length, input);
+			drive_cache_invalidate(file->cache, file->fullpath, file->is_dir);
+			return rc;
+		}
 
 		default:
 			WLog_WARN(TAG, "Unhandled FSInformationClass %s [0x%08" PRIx32 "]",
 			          FSInformationClass2Tag(FsInformationClass), FsInformationClass);
 			return FALSE;
 	}
-
-	return TRUE;
 }
 
 static BOOL drive_file_query_dir_info(DRIVE_FILE* file, wStream* output, size_t length)
@@ -904,13 +867,12 @@ static BOOL drive_file_query_dir_info(DRIVE_FILE* file, wStream* output, size_t
 	WINPR_ASSERT(output);
 
 	/* http://msdn.microsoft.com/en-us/library/cc232097.aspx */
-	if (!Stream_EnsureRemainingCapacity(output, 4 + 64 + length))
+	if (!Stream_EnsureRemainingCapacity(output, 64 + length))
 		return FALSE;
 
 	if (length > UINT32_MAX - 64)
 		return FALSE;
 
-	Stream_Write_UINT32(output, (UINT32)(64 + length));                        /* Length */
 	Stream_Write_UINT32(output, 0);                                            /* NextEntryOffset */
 	Stream_Write_UINT32(output, 0);                                            /* FileIndex */
 	Stream_Write_UINT32(output, file->find_data.ftCreationTime.dwLowDateTime); /* CreationTime */
@@ -938,13 +900,12 @@ static BOOL drive_file_query_full_dir_info(DRIVE_FILE* file, wStream* output, si
 	WINPR_ASSERT(file);
 	WINPR_ASSERT(output);
 	/* http://msdn.microsoft.com/en-us/library/cc232068.aspx */
-	if (!Stream_EnsureRemainingCapacity(output, 4 + 68 + length))
+	if (!Stream_EnsureRemainingCapacity(output, 68 + length))
 		return FALSE;
 
 	if (length > UINT32_MAX - 68)
 		return FALSE;
 
-	Stream_Write_UINT32(output, (UINT32)(68 + length));                        /* Length */
 	Stream_Write_UINT32(output, 0);                                            /* NextEntryOffset */
 	Stream_Write_UINT32(output, 0);                                            /* FileIndex */
 	Stream_Write_UINT32(output, file->find_data.ftCreationTime.dwLowDateTime); /* CreationTime */
@@ -973,13 +934,12 @@ static BOOL drive_file_query_both_dir_info(DRIVE_FILE* file, wStream* output, si
 	WINPR_ASSERT(file);
 	WINPR_ASSERT(output);
 	/* http://msdn.microsoft.com/en-us/library/cc232095.aspx */
-	if (!Stream_EnsureRemainingCapacity(output, 4 + 93 + length))
+	if (!Stream_EnsureRemainingCapacity(output, 93 + length))
 		return FALSE;
 
 	if (length > UINT32_MAX - 93)
 		return FALSE;
 
-	Stream_Write_UINT32(output, (UINT32)(93 + length));                        /* Length */
 	Stream_Write_UINT32(output, 0);                                            /* NextEntryOffset */
 	Stream_Write_UINT32(output, 0);                                            /* FileIndex */
 	Stream_Write_UINT32(output, file->find_data.ftCreationTime.dwLowDateTime); /* CreationTime */
@@ -1011,77 +971,189 @@ static BOOL drive_file_query_names_info(DRIVE_FILE* file, wStream* output, size_
 	WINPR_ASSERT(file);
 	WINPR_ASSERT(output);
 	/* http://msdn.microsoft.com/en-us/library/cc232077.aspx */
-	if (!Stream_EnsureRemainingCapacity(output, 4 + 12 + length))
+	if (!Stream_EnsureRemainingCapacity(output, 12 + length))
 		return FALSE;
 
 	if (length > UINT32_MAX - 12)
 		return FALSE;
 
-	Stream_Write_UINT32(output, (UINT32)(12 + length)); /* Length */
-	Stream_Write_UINT32(output, 0);                     /* NextEntryOffset */
-	Stream_Write_UINT32(output, 0);                     /* FileIndex */
-	Stream_Write_UINT32(output, (UINT32)length);        /* FileNameLength */
+	Stream_Write_UINT32(output, 0);              /* NextEntryOffset */
+	Stream_Write_UINT32(output, 0);              /* FileIndex */
+	Stream_Write_UINT32(output, (UINT32)length); /* FileNameLength */
 	Stream_Write(output, file->find_data.cFileName, length);
 	return TRUE;
 }
 
+static size_t drive_file_dir_entry_size(UINT32 FsInformationClass, size_t length)
+{
+	switch (FsInformationClass)
+	{
+		case FileDirectoryInformation:
+			return 64 + length;
+
+		case FileFullDirectoryInformation:
+			return 68 + length;
+
+		case FileBothDirectoryInformation:
+			return 93 + length;
+
+		case FileNamesInformation:
+			return 12 + length;
+
+		default:
+			return 0;
+	}
+}
+
+static BOOL drive_file_write_dir_entry(DRIVE_FILE* file, UINT32 FsInformationClass,
+                                       wStream* output)
+{
+	const size_t length = _wcslen(file->find_data.cFileName) * sizeof(WCHAR);
+
+	switch (FsInformationClass)
+	{
+		case FileDirectoryInformation:
+			return drive_file_query_dir_info(file, output, length);
+
+		case FileFullDirectoryInformation:
+			return drive_file_query_full_dir_info(file, output, length);
+
+		case FileBothDirectoryInformation:
+			return drive_file_query_both_dir_info(file, output, length);
+
+		case FileNamesInformation:
+			return drive_file_query_names_info(file, output, length);
+
+		default:
+			WLog_WARN(TAG, "Unhandled FSInformationClass %s [0x%08" PRIx32 "]",
+			          FSInformationClass2Tag(FsInformationClass), FsInformationClass);
+			/* Unhandled FsInformationClass */
+			return FALSE;
+	}
+}
+
+/* the following query_information of each entry is then served from the cache */
+static void drive_file_cache_find_data(DRIVE_FILE* file)
+{
+	const WIN32_FIND_DATAW* data = &file->find_data;
+	const WCHAR* name = data->cFileName;
+
+	if (!file->cache || !file->find_dir)
+		return;
+
+	if ((name[0] == '.') && ((name[1] == '\0') || ((name[1] == '.') && (name[2] == '\0'))))
+		return;
+
+	const BY_HANDLE_FILE_INFORMATION info = { .dwFileAttributes = data->dwFileAttributes,
+		                                      .ftCreationTime = data->ftCreationTime,
+		                                      .ftLastAccessTime = data->ftLastAccessTime,
+		                                      .ftLastWriteTime = data->ftLastWriteTime,
+		                                      .nFileSizeHigh = data->nFileSizeHigh,
+		                                      .nFileSizeLow = data->nFileSizeLow,
+		                                      .nNumberOfLinks = 1 };
+	drive_cache_put(file->cache, file->find_dir, name, &info);
+}
+
+static WCHAR* drive_file_search_dir(const WCHAR* pattern)
+{
+	WCHAR* dir = _wcsdup(pattern);
+	if (!dir)
+		return NULL;
+
+	WCHAR* sep = _wcsrchr(dir, PathGetSeparatorW(PATH_STYLE_NATIVE));
+	if (!sep)
+	{
+		free(dir);
+		return NULL;
+	}
+	*sep = '\0';
+	return dir;
+}
+
 BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYTE InitialQuery,
-                                const WCHAR* path, UINT32 PathWCharLength, wStream* output)
+                                const WCHAR* path, UINT32 PathWCharLength, UINT32 maxLength,
+                                wStream* output)
 {
 	BOOL rc = FALSE;
-	size_t length = 0;
 	WCHAR* ent_path = NULL;
 
 	if (!file || !path || !output)
 		return FALSE;
 
+	const size_t start = Stream_GetPosition(output);
+
 	if (InitialQuery != 0)
 	{
 		/* release search handle */
 		if (file->find_handle != INVALID_HANDLE_VALUE)
 			FindClose(file->find_handle);
 
+		free(file->find_dir);
+		file->find_dir = NULL;
+		file->find_pending = FALSE;
+
 		ent_path = drive_file_combine_fullpath(file->basepath, path, PathWCharLength);
 		/* open new search handle and retrieve the first entry */
 		file->find_handle = FindFirstFileW(ent_path, &file->find_data);
+		if (ent_path)
+			file->find_dir = drive_file_search_dir(ent_path);
 		free(ent_path);
 
 		if (file->find_handle == INVALID_HANDLE_VALUE)
 			goto out_fail;
 	}
-	else if (!FindNextFileW(file->find_handle, &file->find_data))
+	else if (!file->find_pending && !FindNextFileW(file->find_handle, &file->find_data))
 		goto out_fail;
 
-	length = _wcslen(file->find_data.cFileName) * sizeof(WCHAR);
+	file->find_pending = FALSE;
 
-	switch (FsInformationClass)
+	if (!Stream_EnsureRemainingCapacity(output, 4))
+		goto out_fail;
+	Stream_Write_UINT32(output, 0); /* Length, updated below */
+
+	size_t entry = Stream_GetPosition(output);
+	if (!drive_file_write_dir_entry(file, FsInformationClass, output))
+		goto out_fail;
+	drive_file_cache_find_data(file);
+
+	/* MS-FSCC entries are chained by NextEntryOffset and 8 byte aligned */
+	while (maxLength > 0)
 	{
-		case FileDirectoryInformation:
-			rc = drive_file_query_dir_info(file, output, length);
+		if (!FindNextFileW(file->find_handle, &file->find_data))
 			break;
 
-		case FileFullDirectoryInformation:
-			rc = drive_file_query_full_dir_info(file, output, length);
+		const size_t used = Stream_GetPosition(output) - start - 4;
+		const size_t aligned = (used + 7) & ~(size_t)7;
+		const size_t size = drive_file_dir_entry_size(
+		    FsInformationClass, _wcslen(file->find_data.cFileName) * sizeof(WCHAR));
+		if (aligned + size > maxLength)
+		{
+			/* returned with the next request */
+			file->find_pending = TRUE;
 			break;
+		}
 
-		case FileBothDirectoryInformation:
-			rc = drive_file_query_both_dir_info(file, output, length);
-			break;
+		if (!Stream_EnsureRemainingCapacity(output, aligned - used))
+			goto out_fail;
+		Stream_Zero(output, aligned - used);
 
-		case FileNamesInformation:
-			rc = drive_file_query_names_info(file, output, length);
-			break;
+		const size_t next = Stream_GetPosition(output);
+		winpr_Data_Write_UINT32(Stream_Buffer(output) + entry, (UINT32)(next - entry));
+		entry = next;
 
-		default:
-			WLog_WARN(TAG, "Unhandled FSInformationClass %s [0x%08" PRIx32 "]",
-			          FSInformationClass2Tag(FsInformationClass), FsInformationClass);
-			/* Unhandled FsInformationClass */
+		if (!drive_file_write_dir_entry(file, FsInformationClass, output))
 			goto out_fail;
+		drive_file_cache_find_data(file);
 	}
 
+	const size_t length = Stream_GetPosition(output) - start - 4;
+	winpr_Data_Write_UINT32(Stream_Buffer(output) + start, (UINT32)length);
+	rc = TRUE;
+
 out_fail:
 	if (!rc)
 	{
+		Stream_SetPosition(output, start);
 		Stream_Write_UINT32(output, 0); /* Length */
 		Stream_Write_UINT8(output, 0);  /* Padding */
 	}
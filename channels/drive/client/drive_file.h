@@ -30,6 +30,8 @@
 #include <winpr/file.h>
 #include <freerdp/channels/log.h>
 
+#include "drive_cache.h"
+
 #define TAG CHANNELS_TAG("drive.client")
 
 typedef struct
@@ -39,6 +41,9 @@ typedef struct
 	HANDLE file_handle;
 	HANDLE find_handle;
 	WIN32_FIND_DATAW find_data;
+	BOOL find_pending; /* find_data has not been returned yet */
+	WCHAR* find_dir;
+	DRIVE_CACHE* cache;
 	const WCHAR* basepath;
 	WCHAR* fullpath;
 	BOOL delete_pending;
@@ -51,7 +56,8 @@ typedef struct
 
 DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 PathWCharLength,
                            UINT32 id, UINT32 DesiredAccess, UINT32 CreateDisposition,
-                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess);
+                           UINT32 CreateOptions, UINT32 FileAttributes, UINT32 SharedAccess,
+                           DRIVE_CACHE* cache);
 BOOL drive_file_free(DRIVE_FILE* file);
 
 BOOL drive_file_open(DRIVE_FILE* file);
@@ -61,7 +67,9 @@ BOOL drive_file_write(DRIVE_FILE* file, const BYTE* buffer, UINT32 Length);
 BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, wStream* output);
 BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UINT32 Length,
                                 wStream* input);
+/* maxLength > 0 packs entries into the response as long as the buffer stays below it */
 BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYTE InitialQuery,
-                                const WCHAR* path, UINT32 PathWCharLength, wStream* output);
+                                const WCHAR* path, UINT32 PathWCharLength, UINT32 maxLength,
+                                wStream* output);
 
 #endif /* FREERDP_CHANNEL_DRIVE_FILE_H */
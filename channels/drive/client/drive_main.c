@@ -48,6 +48,20 @@
 
 #include "drive_file.h"
 
+/* IRPs for different files are processed concurrently by this many threads */
+#define DRIVE_WORKER_COUNT 4
+
+/* IrpQueue message ids, 0 carries an IRP to be discarded on shutdown */
+#define DRIVE_WORK_IRP 0
+#define DRIVE_WORK_LANE 1
+
+/* IRPs of one file, processed in order by one worker at a time */
+typedef struct
+{
+	UINT32 FileId;
+	wQueue* irps;
+} DRIVE_IRP_LANE;
+
 typedef struct
 {
 	DEVICE device;
@@ -57,10 +71,19 @@ typedef struct
 	UINT32 PathLength;
 	wListDictionary* files;
 
-	HANDLE thread;
+	HANDLE threads[DRIVE_WORKER_COUNT];
+	size_t threadCount;
 	BOOL async;
 	wMessageQueue* IrpQueue;
 
+	/* a lane is in the dictionary while exactly one IrpQueue message refers to it */
+	CRITICAL_SECTION lock;
+	wListDictionary* lanes;
+
+	/* shared by all files, NULL if disabled */
+	DRIVE_CACHE* cache;
+	UINT32 batchSize;
+
 	DEVMAN* devman;
 
 	rdpContext* rdpcontext;
@@ -178,10 +201,14 @@ static UINT drive_process_irp_create(DRIVE_DEVICE* drive, IRP* irp)
 		return ERROR_INVALID_DATA;
 
 	const WCHAR* path = Stream_ConstPointer(irp->input);
-	UINT32 FileId = irp->devman->id_sequence++;
+
+	/* creates run concurrently on the worker threads and other drives share the sequence */
+	UINT32 FileId =
+	    (UINT32)InterlockedIncrement((volatile LONG*)&irp->devman->id_sequence) - 1;
 	DRIVE_FILE* file =
 	    drive_file_new(drive->path, path, PathLength / sizeof(WCHAR), FileId, DesiredAccess,
-	                   CreateDisposition, CreateOptions, FileAttributes, SharedAccess);
+	                   CreateDisposition, CreateOptions, FileAttributes, SharedAccess,
+	                   drive->cache);
 
 	if (!file)
 	{
@@ -651,7 +678,7 @@ static UINT drive_process_irp_query_directory(DRIVE_DEVICE* drive, IRP* irp)
 		Stream_Write_UINT32(irp->output, 0); /* Length */
 	}
 	else if (!drive_file_query_directory(file, FsInformationClass, InitialQuery, path,
-	                                     PathLength / sizeof(WCHAR), irp->output))
+	                                     PathLength / sizeof(WCHAR), drive->batchSize, irp->output))
 	{
 		irp->IoStatus = drive_map_windows_err(GetLastError());
 	}
@@ -797,6 +824,81 @@ static BOOL drive_poll_run(DRIVE_DEVICE* drive, IRP* irp)
 	return TRUE;
 }
 
+static void drive_lane_free(void* obj)
+{
+	DRIVE_IRP_LANE* lane = obj;
+	if (!lane)
+		return;
+
+	if (lane->irps)
+	{
+		IRP* irp = NULL;
+		while ((irp = Queue_Dequeue(lane->irps)))
+		{
+			WINPR_ASSERT(irp->Discard);
+			irp->Discard(irp);
+		}
+		Queue_Free(lane->irps);
+	}
+	free(lane);
+}
+
+static DRIVE_IRP_LANE* drive_lane_new(UINT32 FileId)
+{
+	DRIVE_IRP_LANE* lane = calloc(1, sizeof(DRIVE_IRP_LANE));
+	if (!lane)
+		return NULL;
+
+	lane->FileId = FileId;
+	lane->irps = Queue_New(FALSE, 0, 0);
+	if (!lane->irps)
+	{
+		drive_lane_free(lane);
+		return NULL;
+	}
+	return lane;
+}
+
+/**
+ * Process the next IRP of a file, then hand the lane back to the queue so that
+ * busy files do not starve others.
+ */
+static BOOL drive_lane_run(DRIVE_DEVICE* drive, DRIVE_IRP_LANE* lane)
+{
+	WINPR_ASSERT(drive);
+	WINPR_ASSERT(lane);
+
+	EnterCriticalSection(&drive->lock);
+	IRP* irp = Queue_Dequeue(lane->irps);
+	LeaveCriticalSection(&drive->lock);
+
+	BOOL rc = drive_poll_run(drive, irp);
+
+	EnterCriticalSection(&drive->lock);
+	void* key = (void*)(size_t)lane->FileId;
+
+	/* the queue refuses messages once shutdown started, remaining IRPs are discarded */
+	if ((Queue_Count(lane->irps) == 0) ||
+	    !MessageQueue_Post(drive->IrpQueue, NULL, DRIVE_WORK_LANE, lane, NULL))
+		ListDictionary_Remove(drive->lanes, key);
+	LeaveCriticalSection(&drive->lock);
+	return rc;
+}
+
+/* the quit message is left in the queue so that every worker sees it */
+static BOOL drive_next_message(DRIVE_DEVICE* drive, wMessage* message)
+{
+	WINPR_ASSERT(drive);
+	WINPR_ASSERT(message);
+
+	EnterCriticalSection(&drive->lock);
+	BOOL rc = MessageQueue_Peek(drive->IrpQueue, message, FALSE) != 0;
+	if (rc && (message->id != WMQ_QUIT))
+		rc = MessageQueue_Peek(drive->IrpQueue, message, TRUE) != 0;
+	LeaveCriticalSection(&drive->lock);
+	return rc;
+}
+
 static DWORD WINAPI drive_thread_func(LPVOID arg)
 {
 	DRIVE_DEVICE* drive = (DRIVE_DEVICE*)arg;
@@ -817,21 +919,21 @@ static DWORD WINAPI drive_thread_func(LPVOID arg)
 			break;
 		}
 
-		if (MessageQueue_Size(drive->IrpQueue) < 1)
-			continue;
-
+		/* another worker might have been faster */
 		wMessage message = { 0 };
-		if (!MessageQueue_Peek(drive->IrpQueue, &message, TRUE))
-		{
-			WLog_ERR(TAG, "MessageQueue_Peek failed!");
+		if (!drive_next_message(drive, &message))
 			continue;
-		}
 
 		if (message.id == WMQ_QUIT)
 			break;
 
-		IRP* irp = (IRP*)message.wParam;
-		if (!drive_poll_run(drive, irp))
+		BOOL rc = FALSE;
+		if (message.id == DRIVE_WORK_LANE)
+			rc = drive_lane_run(drive, (DRIVE_IRP_LANE*)message.wParam);
+		else
+			rc = drive_poll_run(drive, (IRP*)message.wParam);
+
+		if (!rc)
 			break;
 	}
 
@@ -844,6 +946,40 @@ fail:
 	return error;
 }
 
+static BOOL drive_irp_enqueue(DRIVE_DEVICE* drive, IRP* irp)
+{
+	WINPR_ASSERT(drive);
+	WINPR_ASSERT(irp);
+
+	/* a new file does not depend on anything queued */
+	if (irp->MajorFunction == IRP_MJ_CREATE)
+		return MessageQueue_Post(drive->IrpQueue, NULL, DRIVE_WORK_IRP, irp, NULL);
+
+	BOOL rc = FALSE;
+	void* key = (void*)(size_t)irp->FileId;
+
+	EnterCriticalSection(&drive->lock);
+	DRIVE_IRP_LANE* lane = ListDictionary_GetItemValue(drive->lanes, key);
+	if (lane)
+		rc = Queue_Enqueue(lane->irps, irp);
+	else
+	{
+		lane = drive_lane_new(irp->FileId);
+		if (lane && ListDictionary_Add(drive->lanes, key, lane))
+		{
+			if (MessageQueue_Post(drive->IrpQueue, NULL, DRIVE_WORK_LANE, lane, NULL))
+				rc = Queue_Enqueue(lane->irps, irp);
+			else
+				ListDictionary_Remove(drive->lanes, key);
+		}
+		else
+			drive_lane_free(lane);
+	}
+	LeaveCriticalSection(&drive->lock);
+
+	return rc;
+}
+
 /**
  * Function description
  *
@@ -858,7 +994,7 @@ static UINT drive_irp_request(DEVICE* device, IRP* irp)
 
 	if (drive->async)
 	{
-		if (!MessageQueue_Post(drive->IrpQueue, NULL, 0, (void*)irp, NULL))
+		if (!drive_irp_enqueue(drive, irp))
 		{
 			WLog_ERR(TAG, "MessageQueue_Post failed!");
 			return ERROR_INTERNAL_ERROR;
@@ -880,9 +1016,13 @@ static UINT drive_free_int(DRIVE_DEVICE* drive)
 	if (!drive)
 		return ERROR_INVALID_PARAMETER;
 
-	(void)CloseHandle(drive->thread);
-	ListDictionary_Free(drive->files);
+	for (size_t x = 0; x < drive->threadCount; x++)
+		(void)CloseHandle(drive->threads[x]);
 	MessageQueue_Free(drive->IrpQueue);
+	ListDictionary_Free(drive->lanes);
+	ListDictionary_Free(drive->files);
+	drive_cache_free(drive->cache);
+	DeleteCriticalSection(&drive->lock);
 	Stream_Free(drive->device.data, TRUE);
 	free(drive->path);
 	free(drive);
@@ -902,11 +1042,13 @@ static UINT drive_free(DEVICE* device)
 	if (!drive)
 		return ERROR_INVALID_PARAMETER;
 
-	if (MessageQueue_PostQuit(drive->IrpQueue, 0) &&
-	    (WaitForSingleObject(drive->thread, INFINITE) == WAIT_FAILED))
+	/* queued work ahead of the quit message is still processed */
+	if ((drive->threadCount > 0) && MessageQueue_PostQuit(drive->IrpQueue, 0) &&
+	    (WaitForMultipleObjects((DWORD)drive->threadCount, drive->threads, TRUE, INFINITE) ==
+	     WAIT_FAILED))
 	{
 		error = GetLastError();
-		WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "", error);
+		WLog_ERR(TAG, "WaitForMultipleObjects failed with error %" PRIu32 "", error);
 		return error;
 	}
 
@@ -970,6 +1112,7 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 			return CHANNEL_RC_NO_MEMORY;
 		}
 
+		InitializeCriticalSection(&drive->lock);
 		drive->device.type = RDPDR_DTYP_FILESYSTEM;
 		drive->device.IRPRequest = drive_irp_request;
 		drive->device.Free = drive_free;
@@ -1031,6 +1174,16 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 		}
 
 		ListDictionary_ValueObject(drive->files)->fnObjectFree = drive_file_objfree;
+
+		drive->lanes = ListDictionary_New(FALSE);
+		if (!drive->lanes)
+		{
+			WLog_ERR(TAG, "ListDictionary_New failed!");
+			error = CHANNEL_RC_NO_MEMORY;
+			goto out_error;
+		}
+
+		ListDictionary_ValueObject(drive->lanes)->fnObjectFree = drive_lane_free;
 		drive->IrpQueue = MessageQueue_New(NULL);
 
 		if (!drive->IrpQueue)
@@ -1044,6 +1197,11 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 		WINPR_ASSERT(obj);
 		obj->fnObjectFree = drive_message_free;
 
+		/* without the cache every query goes to the file system */
+		drive->cache = drive_cache_new(DRIVE_CACHE_TTL);
+		drive->batchSize = freerdp_settings_get_uint32(drive->rdpcontext->settings,
+		                                               FreeRDP_DriveDirectoryBatchSize);
+
 		if ((error = pEntryPoints->RegisterDevice(pEntryPoints->devman, &drive->device)))
 		{
 			WLog_ERR(TAG, "RegisterDevice failed with error %" PRIu32 "!", error);
@@ -1055,14 +1213,23 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 		                                          FreeRDP_SynchronousStaticChannels);
 		if (drive->async)
 		{
-			if (!(drive->thread =
-			          CreateThread(NULL, 0, drive_thread_func, drive, CREATE_SUSPENDED, NULL)))
+			for (size_t x = 0; x < ARRAYSIZE(drive->threads); x++)
 			{
-				WLog_ERR(TAG, "CreateThread failed!");
-				goto out_error;
+				HANDLE thread =
+				    CreateThread(NULL, 0, drive_thread_func, drive, CREATE_SUSPENDED, NULL);
+				if (!thread)
+				{
+					WLog_ERR(TAG, "CreateThread failed!");
+
+					/* already running workers own the device, continue with fewer */
+					if (drive->threadCount > 0)
+						break;
+					goto out_error;
+				}
+
+				drive->threads[drive->threadCount++] = thread;
+				ResumeThread(thread);
 			}
-
-			ResumeThread(drive->thread);
 		}
 	}
 
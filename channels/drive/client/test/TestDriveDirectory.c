@@ -0,0 +1,363 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/addin.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/settings.h>
+#include <freerdp/client/channels.h>
+#include <freerdp/channels/rdpdr.h>
+
+#include "TestDriveHelpers.h"
+
+#define TEST_FILE_COUNT 10000
+#define TEST_STAT_COUNT 2000
+#define TEST_BATCH_SIZE (64 * 1024)
+
+/* FILE_BOTH_DIR_INFORMATION, https://msdn.microsoft.com/en-us/library/cc232095.aspx */
+#define TEST_BOTH_DIR_NAME_LENGTH_OFFSET 60
+#define TEST_BOTH_DIR_NAME_OFFSET 93
+
+typedef struct
+{
+	test_drive drive;
+	BYTE* seen;
+	size_t requests;
+	size_t entries;
+} test_context;
+
+/* sends a single IRP and returns it once completed, the response is positioned at the payload */
+static IRP* test_request(test_context* context, UINT32 FileId, UINT32 MajorFunction,
+                         UINT32 MinorFunction, wStream* input)
+{
+	if (!test_drive_send(&context->drive, FileId, MajorFunction, MinorFunction, input, NULL))
+		return NULL;
+
+	IRP* irp = test_drive_wait(&context->drive);
+	if (irp)
+		context->requests++;
+	return irp;
+}
+
+static wStream* test_path_input(const char* path, size_t headerLength, size_t pathOffset)
+{
+	size_t length = 0;
+	WCHAR* wpath = ConvertUtf8ToWCharAlloc(path, &length);
+	wStream* s = wpath ? Stream_New(NULL, headerLength + (length + 1) * sizeof(WCHAR)) : NULL;
+	if (!s)
+	{
+		free(wpath);
+		return NULL;
+	}
+
+	Stream_Zero(s, headerLength);
+	Stream_SetPosition(s, pathOffset);
+	Stream_Write_UINT32(s, (UINT32)((length + 1) * sizeof(WCHAR))); /* PathLength */
+	Stream_SetPosition(s, headerLength);
+	Stream_Write(s, wpath, (length + 1) * sizeof(WCHAR));
+	free(wpath);
+	return s;
+}
+
+static BOOL test_open(test_context* context, const char* path, UINT32 CreateOptions,
+                      UINT32* FileId)
+{
+	wStream* s = test_path_input(path, 32, 28);
+	if (!s)
+		return FALSE;
+
+	Stream_SetPosition(s, 0);
+	Stream_Write_UINT32(s, GENERIC_READ);    /* DesiredAccess */
+	Stream_Write_UINT64(s, 0);               /* AllocationSize */
+	Stream_Write_UINT32(s, 0);               /* FileAttributes */
+	Stream_Write_UINT32(s, FILE_SHARE_READ); /* SharedAccess */
+	Stream_Write_UINT32(s, FILE_OPEN);       /* CreateDisposition */
+	Stream_Write_UINT32(s, CreateOptions);   /* CreateOptions */
+	Stream_SetPosition(s, Stream_Capacity(s));
+
+	IRP* irp = test_request(context, 0, IRP_MJ_CREATE, 0, s);
+	if (!irp)
+		return FALSE;
+
+	const BOOL rc = (irp->IoStatus == STATUS_SUCCESS) &&
+	                Stream_CheckAndLogRequiredLength("test", irp->output, 4);
+	if (rc)
+		Stream_Read_UINT32(irp->output, *FileId);
+	test_drive_irp_free(irp);
+	return rc;
+}
+
+static BOOL test_close(test_context* context, UINT32 FileId)
+{
+	wStream* s = Stream_New(NULL, 32);
+	if (!s)
+		return FALSE;
+
+	Stream_Zero(s, 32); /* Padding */
+	IRP* irp = test_request(context, FileId, IRP_MJ_CLOSE, 0, s);
+	if (!irp)
+		return FALSE;
+
+	const BOOL rc = irp->IoStatus == STATUS_SUCCESS;
+	test_drive_irp_free(irp);
+	return rc;
+}
+
+static BOOL test_parse_entries(test_context* context, wStream* s)
+{
+	if (!Stream_CheckAndLogRequiredLength("test", s, 4))
+		return FALSE;
+
+	const UINT32 length = Stream_Get_UINT32(s);
+	if (!Stream_CheckAndLogRequiredLength("test", s, length))
+		return FALSE;
+
+	const BYTE* buffer = Stream_ConstPointer(s);
+	size_t offset = 0;
+	while (TRUE)
+	{
+		if (length - offset < TEST_BOTH_DIR_NAME_OFFSET)
+			return FALSE;
+
+		const BYTE* entry = &buffer[offset];
+		const UINT32 next = winpr_Data_Get_UINT32(entry);
+		const UINT32 nameLength = winpr_Data_Get_UINT32(&entry[TEST_BOTH_DIR_NAME_LENGTH_OFFSET]);
+		if (length - offset - TEST_BOTH_DIR_NAME_OFFSET < nameLength)
+			return FALSE;
+
+		char name[MAX_PATH] = { 0 };
+		if (ConvertWCharNToUtf8((const WCHAR*)&entry[TEST_BOTH_DIR_NAME_OFFSET],
+		                        nameLength / sizeof(WCHAR), name, sizeof(name) - 1) < 0)
+			return FALSE;
+
+		unsigned index = 0;
+		if (sscanf(name, "file-%u.txt", &index) == 1)
+		{
+			if ((index >= TEST_FILE_COUNT) || context->seen[index])
+			{
+				(void)fprintf(stderr, "unexpected entry %s\n", name);
+				return FALSE;
+			}
+			context->seen[index] = 1;
+			context->entries++;
+		}
+
+		if (next == 0)
+			return TRUE;
+		if ((next % 8) != 0)
+			return FALSE;
+		offset += next;
+	}
+}
+
+/* list the directory like a server, every query returns one or more entries */
+static BOOL test_list(test_context* context, size_t* requests)
+{
+	UINT32 FileId = 0;
+	if (!test_open(context, "\\", FILE_DIRECTORY_FILE, &FileId))
+		return FALSE;
+
+	BOOL rc = FALSE;
+	memset(context->seen, 0, TEST_FILE_COUNT);
+	context->entries = 0;
+	const size_t start = context->requests;
+
+	for (BYTE initial = 1;; initial = 0)
+	{
+		wStream* s = test_path_input(initial ? "\\*" : "", 32, 5);
+		if (!s)
+			goto fail;
+
+		Stream_SetPosition(s, 0);
+		Stream_Write_UINT32(s, FileBothDirectoryInformation); /* FsInformationClass */
+		Stream_Write_UINT8(s, initial);                        /* InitialQuery */
+		if (!initial)
+			Stream_Write_UINT32(s, 0); /* PathLength */
+		Stream_SetPosition(s, initial ? Stream_Capacity(s) : 32);
+
+		IRP* irp = test_request(context, FileId, IRP_MJ_DIRECTORY_CONTROL,
+		                        IRP_MN_QUERY_DIRECTORY, s);
+		if (!irp)
+			goto fail;
+
+		const NTSTATUS status = irp->IoStatus;
+		const BOOL parsed = (status != STATUS_SUCCESS) || test_parse_entries(context, irp->output);
+		test_drive_irp_free(irp);
+
+		if (status == STATUS_NO_MORE_FILES)
+			break;
+		if ((status != STATUS_SUCCESS) || !parsed)
+			goto fail;
+	}
+
+	*requests = context->requests - start;
+	rc = context->entries == TEST_FILE_COUNT;
+	if (!rc)
+		(void)fprintf(stderr, "listed %" PRIuz " of %d files\n", context->entries,
+		              TEST_FILE_COUNT);
+
+fail:
+	if (!test_close(context, FileId))
+		rc = FALSE;
+	return rc;
+}
+
+/* the metadata of a listed file is served without touching the file system again */
+static BOOL test_stat(test_context* context, size_t count)
+{
+	for (size_t x = 0; x < count; x++)
+	{
+		char path[64] = { 0 };
+		(void)_snprintf(path, sizeof(path), "\\file-%05" PRIuz ".txt", x);
+
+		UINT32 FileId = 0;
+		if (!test_open(context, path, FILE_NON_DIRECTORY_FILE, &FileId))
+			return FALSE;
+
+		wStream* s = Stream_New(NULL, 32);
+		if (!s)
+			return FALSE;
+		Stream_Write_UINT32(s, FileBasicInformation); /* FsInformationClass */
+		Stream_Write_UINT32(s, 0);                    /* Length */
+		Stream_Zero(s, 24);                           /* Padding */
+
+		IRP* irp = test_request(context, FileId, IRP_MJ_QUERY_INFORMATION, 0, s);
+		const BOOL rc = irp && (irp->IoStatus == STATUS_SUCCESS) &&
+		                Stream_CheckAndLogRequiredLength("test", irp->output, 4) &&
+		                (Stream_Get_UINT32(irp->output) == 36);
+		test_drive_irp_free(irp);
+		if (!test_close(context, FileId) || !rc)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL test_run(test_context* context, rdpContext* rdpcontext, const char* path,
+                     UINT32 batchSize, size_t* requests)
+{
+	BOOL rc = FALSE;
+	if (!freerdp_settings_set_uint32(rdpcontext->settings, FreeRDP_DriveDirectoryBatchSize,
+	                                 batchSize))
+		return FALSE;
+
+	if (!test_drive_load(&context->drive, rdpcontext, path))
+		return FALSE;
+
+	UINT64 start = winpr_GetTickCount64NS();
+	if (!test_list(context, requests))
+		goto fail;
+	const UINT64 list = MAX(1, winpr_GetTickCount64NS() - start);
+
+	start = winpr_GetTickCount64NS();
+	if (!test_stat(context, TEST_STAT_COUNT))
+		goto fail;
+	const UINT64 stat = MAX(1, winpr_GetTickCount64NS() - start);
+
+	printf("batch %5" PRIu32 ": %d files listed with %" PRIuz " queries in %.1fms, "
+	       "%d open/query/close in %.1fms\n",
+	       batchSize, TEST_FILE_COUNT, *requests, (double)list / 1000000.0, TEST_STAT_COUNT,
+	       (double)stat / 1000000.0);
+	rc = TRUE;
+
+fail:
+	test_drive_unload(&context->drive);
+	return rc;
+}
+
+static BOOL test_create_files(const char* path)
+{
+	for (size_t x = 0; x < TEST_FILE_COUNT; x++)
+	{
+		char name[64] = { 0 };
+		(void)_snprintf(name, sizeof(name), "file-%05" PRIuz ".txt", x);
+
+		char* fullpath = GetCombinedPath(path, name);
+		FILE* fp = fullpath ? winpr_fopen(fullpath, "wb") : NULL;
+		free(fullpath);
+		if (!fp)
+			return FALSE;
+		(void)fclose(fp);
+	}
+	return TRUE;
+}
+
+int TestDriveDirectory(int argc, char* argv[])
+{
+	int rc = -1;
+	test_context context = { 0 };
+	rdpContext rdpcontext = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (freerdp_register_addin_provider(freerdp_channels_load_static_addin_entry, 0) != 0)
+		return -1;
+
+	if (!freerdp_load_channel_addin_entry("drive", NULL, "DeviceServiceEntry", 0))
+	{
+		printf("drive channel not built in, skipping\n");
+		return 0;
+	}
+
+	char* path =
+	    GetKnownSubPathV(KNOWN_PATH_TEMP, "TestDriveDirectory-%" PRIu32, GetCurrentProcessId());
+	if (!path || !winpr_PathMakePath(path, NULL))
+		goto fail;
+
+	context.seen = calloc(TEST_FILE_COUNT, sizeof(BYTE));
+	rdpcontext.settings = freerdp_settings_new(0);
+	if (!test_drive_init(&context.drive) || !context.seen || !rdpcontext.settings)
+		goto fail;
+
+	/* one request at a time, the completion is queued before IRPRequest returns */
+	if (!freerdp_settings_set_bool(rdpcontext.settings, FreeRDP_SynchronousStaticChannels, TRUE))
+		goto fail;
+
+	if (!test_create_files(path))
+		goto fail;
+
+	size_t single = 0;
+	size_t batched = 0;
+	if (!test_run(&context, &rdpcontext, path, 0, &single))
+		goto fail;
+	if (!test_run(&context, &rdpcontext, path, TEST_BATCH_SIZE, &batched))
+		goto fail;
+
+	if (batched * 10 > single)
+	{
+		(void)fprintf(stderr,
+		              "expected far fewer queries with batching: %" PRIuz " vs %" PRIuz "\n",
+		              batched, single);
+		goto fail;
+	}
+	rc = 0;
+
+fail:
+	if (path)
+		winpr_RemoveDirectory_RecursiveA(path);
+	free(path);
+	free(context.seen);
+	freerdp_settings_free(rdpcontext.settings);
+	test_drive_uninit(&context.drive);
+	return rc;
+}
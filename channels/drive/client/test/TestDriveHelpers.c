@@ -0,0 +1,197 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+
+#include <freerdp/addin.h>
+#include <freerdp/client/channels.h>
+
+#include "TestDriveHelpers.h"
+
+/* the drive only knows the IRP, the test finds its own data through the wrapper */
+typedef struct
+{
+	IRP irp;
+	void* userdata;
+} test_drive_irp;
+
+static UINT test_drive_register_device(DEVMAN* devman, DEVICE* device)
+{
+	test_drive* drive = devman->plugin;
+	drive->device = device;
+	device->id = devman->id_sequence++;
+	return CHANNEL_RC_OK;
+}
+
+void test_drive_irp_free(IRP* irp)
+{
+	if (!irp)
+		return;
+	Stream_Free(irp->input, TRUE);
+	Stream_Free(irp->output, TRUE);
+	free(irp);
+}
+
+void* test_drive_irp_userdata(IRP* irp)
+{
+	WINPR_ASSERT(irp);
+	return ((test_drive_irp*)irp)->userdata;
+}
+
+static void test_drive_message_free(void* obj)
+{
+	wMessage* msg = obj;
+	if (msg && (msg->id == 0))
+		test_drive_irp_free(msg->wParam);
+}
+
+/* if the completion can not be queued the IRP stays with the caller of IRPRequest */
+static UINT test_drive_irp_complete(IRP* irp)
+{
+	test_drive* drive = irp->devman->plugin;
+	if (!MessageQueue_Post(drive->completions, NULL, 0, irp, NULL))
+		return ERROR_INTERNAL_ERROR;
+	return CHANNEL_RC_OK;
+}
+
+static UINT test_drive_irp_discard(IRP* irp)
+{
+	test_drive* drive = irp->devman->plugin;
+	(void)fprintf(stderr, "IRP 0x%08" PRIx32 " discarded\n", irp->MajorFunction);
+	(void)MessageQueue_PostQuit(drive->completions, 0);
+	test_drive_irp_free(irp);
+	return CHANNEL_RC_OK;
+}
+
+BOOL test_drive_init(test_drive* drive)
+{
+	WINPR_ASSERT(drive);
+
+	drive->devman.plugin = drive;
+	drive->devman.id_sequence = 1;
+	drive->completions = MessageQueue_New(NULL);
+	if (!drive->completions)
+		return FALSE;
+	MessageQueue_Object(drive->completions)->fnObjectFree = test_drive_message_free;
+	return TRUE;
+}
+
+void test_drive_uninit(test_drive* drive)
+{
+	WINPR_ASSERT(drive);
+	MessageQueue_Free(drive->completions);
+	drive->completions = NULL;
+}
+
+DEVICE* test_drive_load(test_drive* drive, rdpContext* rdpcontext, const char* path)
+{
+	WINPR_ASSERT(drive);
+
+	const char* args[] = { "test", path };
+	RDPDR_DEVICE* device = freerdp_device_new(RDPDR_DTYP_FILESYSTEM, ARRAYSIZE(args), args);
+	if (!device)
+		return NULL;
+
+	PVIRTUALCHANNELENTRY pvce =
+	    freerdp_load_channel_addin_entry("drive", NULL, "DeviceServiceEntry", 0);
+	PDEVICE_SERVICE_ENTRY entry = WINPR_FUNC_PTR_CAST(pvce, PDEVICE_SERVICE_ENTRY);
+
+	DEVICE_SERVICE_ENTRY_POINTS ep = { .devman = &drive->devman,
+		                               .RegisterDevice = test_drive_register_device,
+		                               .device = device,
+		                               .rdpcontext = rdpcontext };
+
+	/* a failing entry frees the device even if it was registered already */
+	drive->device = NULL;
+	if (!entry || (entry(&ep) != CHANNEL_RC_OK))
+		drive->device = NULL;
+
+	freerdp_device_free(device);
+	return drive->device;
+}
+
+void test_drive_unload(test_drive* drive)
+{
+	WINPR_ASSERT(drive);
+
+	/* outstanding IRPs are discarded by the drive */
+	if (drive->device)
+		drive->device->Free(drive->device);
+	drive->device = NULL;
+	MessageQueue_Clear(drive->completions);
+}
+
+BOOL test_drive_send(test_drive* drive, UINT32 FileId, UINT32 MajorFunction,
+                     UINT32 MinorFunction, wStream* input, void* userdata)
+{
+	WINPR_ASSERT(drive);
+	WINPR_ASSERT(drive->device);
+
+	test_drive_irp* tirp = calloc(1, sizeof(test_drive_irp));
+	if (!tirp)
+	{
+		Stream_Free(input, TRUE);
+		return FALSE;
+	}
+
+	IRP* irp = &tirp->irp;
+	tirp->userdata = userdata;
+	irp->device = drive->device;
+	irp->devman = &drive->devman;
+	irp->FileId = FileId;
+	irp->MajorFunction = MajorFunction;
+	irp->MinorFunction = MinorFunction;
+	irp->input = input;
+	irp->output = Stream_New(NULL, 256);
+	irp->Complete = test_drive_irp_complete;
+	irp->Discard = test_drive_irp_discard;
+	if (!irp->input || !irp->output)
+	{
+		test_drive_irp_free(irp);
+		return FALSE;
+	}
+
+	Stream_SealLength(irp->input);
+	Stream_SetPosition(irp->input, 0);
+	Stream_Zero(irp->output, RDPDR_DEVICE_IO_RESPONSE_LENGTH);
+
+	/* a failed request was neither queued by the drive nor completed */
+	if (drive->device->IRPRequest(drive->device, irp) != CHANNEL_RC_OK)
+	{
+		test_drive_irp_free(irp);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+IRP* test_drive_wait(test_drive* drive)
+{
+	WINPR_ASSERT(drive);
+
+	wMessage message = { 0 };
+	if (!MessageQueue_Wait(drive->completions) ||
+	    !MessageQueue_Peek(drive->completions, &message, TRUE) || (message.id == WMQ_QUIT))
+		return NULL;
+
+	IRP* irp = message.wParam;
+	const size_t end = Stream_GetPosition(irp->output);
+	Stream_SetPosition(irp->output, RDPDR_DEVICE_IO_RESPONSE_LENGTH);
+	Stream_SetLength(irp->output, end);
+	return irp;
+}
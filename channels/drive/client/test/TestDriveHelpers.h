@@ -0,0 +1,49 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <winpr/stream.h>
+#include <winpr/collections.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/channels/rdpdr.h>
+
+/* stands in for rdpdr, completed IRPs are queued to completions */
+typedef struct
+{
+	DEVMAN devman;
+	DEVICE* device;
+	wMessageQueue* completions;
+} test_drive;
+
+BOOL test_drive_init(test_drive* drive);
+void test_drive_uninit(test_drive* drive);
+
+/* loads the drive channel for path, test_drive_unload frees it and drops pending completions */
+DEVICE* test_drive_load(test_drive* drive, rdpContext* rdpcontext, const char* path);
+void test_drive_unload(test_drive* drive);
+
+/* sends an IRP, input is owned by the IRP. On failure the IRP is freed. */
+BOOL test_drive_send(test_drive* drive, UINT32 FileId, UINT32 MajorFunction,
+                     UINT32 MinorFunction, wStream* input, void* userdata);
+
+/* waits for the next completed IRP, the response is positioned at the payload.
+ * Returns NULL if an IRP was discarded. */
+IRP* test_drive_wait(test_drive* drive);
+
+void* test_drive_irp_userdata(IRP* irp);
+void test_drive_irp_free(IRP* irp);
@@ -0,0 +1,318 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/addin.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/settings.h>
+#include <freerdp/client/channels.h>
+#include <freerdp/channels/rdpdr.h>
+
+#include "TestDriveHelpers.h"
+
+#define TEST_SMALL_COUNT 512
+#define TEST_SMALL_SIZE (4 * 1024)
+#define TEST_LARGE_COUNT 4
+#define TEST_LARGE_SIZE (16 * 1024 * 1024)
+#define TEST_READ_SIZE (64 * 1024)
+#define TEST_FILES_IN_FLIGHT 16
+
+typedef struct
+{
+	char* name;
+	BYTE* data;
+	size_t size;
+	UINT32 FileId;
+	UINT64 offset;
+} test_file;
+
+typedef struct
+{
+	test_drive drive;
+	test_file* files;
+	size_t count;
+	UINT64 bytes;
+} test_context;
+
+static BOOL test_send(test_context* context, test_file* file, UINT32 MajorFunction,
+                      wStream* input)
+{
+	return test_drive_send(&context->drive, file->FileId, MajorFunction, 0, input, file);
+}
+
+static BOOL test_send_create(test_context* context, test_file* file)
+{
+	char path[64] = { 0 };
+	(void)_snprintf(path, sizeof(path), "\\%s", file->name);
+
+	size_t length = 0;
+	WCHAR* wpath = ConvertUtf8ToWCharAlloc(path, &length);
+	wStream* s = Stream_New(NULL, 32 + (length + 1) * sizeof(WCHAR));
+	if (!wpath || !s)
+	{
+		free(wpath);
+		Stream_Free(s, TRUE);
+		return FALSE;
+	}
+
+	Stream_Write_UINT32(s, GENERIC_READ);             /* DesiredAccess */
+	Stream_Write_UINT64(s, 0);                        /* AllocationSize */
+	Stream_Write_UINT32(s, FILE_ATTRIBUTE_NORMAL);    /* FileAttributes */
+	Stream_Write_UINT32(s, FILE_SHARE_READ);          /* SharedAccess */
+	Stream_Write_UINT32(s, FILE_OPEN);                /* CreateDisposition */
+	Stream_Write_UINT32(s, FILE_NON_DIRECTORY_FILE);  /* CreateOptions */
+	Stream_Write_UINT32(s, (UINT32)((length + 1) * sizeof(WCHAR))); /* PathLength */
+	Stream_Write(s, wpath, (length + 1) * sizeof(WCHAR));
+	free(wpath);
+
+	file->offset = 0;
+	return test_send(context, file, IRP_MJ_CREATE, s);
+}
+
+static BOOL test_send_read(test_context* context, test_file* file)
+{
+	wStream* s = Stream_New(NULL, 12);
+	if (!s)
+		return FALSE;
+
+	Stream_Write_UINT32(s, TEST_READ_SIZE); /* Length */
+	Stream_Write_UINT64(s, file->offset);   /* Offset */
+	return test_send(context, file, IRP_MJ_READ, s);
+}
+
+static BOOL test_send_close(test_context* context, test_file* file)
+{
+	wStream* s = Stream_New(NULL, 32);
+	if (!s)
+		return FALSE;
+
+	Stream_Zero(s, 32); /* Padding */
+	return test_send(context, file, IRP_MJ_CLOSE, s);
+}
+
+/* act like a server copying the file: open, read sequentially, close */
+static BOOL test_handle_completion(test_context* context, IRP* irp, BOOL* closed)
+{
+	test_file* file = test_drive_irp_userdata(irp);
+	BOOL rc = FALSE;
+
+	*closed = FALSE;
+	if (irp->IoStatus != STATUS_SUCCESS)
+	{
+		(void)fprintf(stderr, "%s: IRP 0x%08" PRIx32 " failed with 0x%08" PRIx32 "\n",
+		              file->name, irp->MajorFunction, (UINT32)irp->IoStatus);
+		goto fail;
+	}
+
+	switch (irp->MajorFunction)
+	{
+		case IRP_MJ_CREATE:
+			if (!Stream_CheckAndLogRequiredLength("test", irp->output, 5))
+				goto fail;
+			Stream_Read_UINT32(irp->output, file->FileId);
+			rc = test_send_read(context, file);
+			break;
+
+		case IRP_MJ_READ:
+		{
+			if (!Stream_CheckAndLogRequiredLength("test", irp->output, 4))
+				goto fail;
+			const UINT32 length = Stream_Get_UINT32(irp->output);
+			if ((length == 0) || (length > file->size - file->offset) ||
+			    !Stream_CheckAndLogRequiredLength("test", irp->output, length))
+				goto fail;
+			if (memcmp(Stream_ConstPointer(irp->output), &file->data[file->offset], length) != 0)
+			{
+				(void)fprintf(stderr, "%s: data mismatch at offset %" PRIu64 "\n", file->name,
+				              file->offset);
+				goto fail;
+			}
+
+			file->offset += length;
+			context->bytes += length;
+			if (file->offset < file->size)
+				rc = test_send_read(context, file);
+			else
+				rc = test_send_close(context, file);
+		}
+		break;
+
+		case IRP_MJ_CLOSE:
+			*closed = TRUE;
+			rc = TRUE;
+			break;
+
+		default:
+			break;
+	}
+
+fail:
+	test_drive_irp_free(irp);
+	return rc;
+}
+
+static BOOL test_copy(test_context* context, rdpContext* rdpcontext, const char* path, BOOL async)
+{
+	BOOL rc = FALSE;
+	if (!freerdp_settings_set_bool(rdpcontext->settings, FreeRDP_SynchronousStaticChannels,
+	                               !async))
+		return FALSE;
+
+	if (!test_drive_load(&context->drive, rdpcontext, path))
+		return FALSE;
+
+	context->bytes = 0;
+	size_t next = 0;
+	size_t active = 0;
+	size_t done = 0;
+	const UINT64 start = winpr_GetTickCount64NS();
+	while (done < context->count)
+	{
+		while ((active < TEST_FILES_IN_FLIGHT) && (next < context->count))
+		{
+			if (!test_send_create(context, &context->files[next++]))
+				goto fail;
+			active++;
+		}
+
+		IRP* irp = test_drive_wait(&context->drive);
+		if (!irp)
+			goto fail;
+
+		BOOL closed = FALSE;
+		if (!test_handle_completion(context, irp, &closed))
+			goto fail;
+		if (closed)
+		{
+			active--;
+			done++;
+		}
+	}
+
+	const UINT64 diff = MAX(1, winpr_GetTickCount64NS() - start);
+	printf("%-5s: %" PRIuz " files, %.1f MiB in %.1fms, %.1f MiB/s\n", async ? "async" : "sync",
+	       context->count, (double)context->bytes / 1024.0 / 1024.0, (double)diff / 1000000.0,
+	       (double)context->bytes * 1000000000.0 / 1024.0 / 1024.0 / (double)diff);
+	rc = TRUE;
+
+fail:
+	test_drive_unload(&context->drive);
+	return rc;
+}
+
+static BOOL test_create_files(test_context* context, const char* path)
+{
+	UINT32 seed = 0x12345678;
+
+	context->count = TEST_SMALL_COUNT + TEST_LARGE_COUNT;
+	context->files = calloc(context->count, sizeof(test_file));
+	if (!context->files)
+		return FALSE;
+
+	for (size_t x = 0; x < context->count; x++)
+	{
+		test_file* file = &context->files[x];
+		const BOOL large = x % (context->count / TEST_LARGE_COUNT) == 0;
+		char name[64] = { 0 };
+
+		(void)_snprintf(name, sizeof(name), "%s-%04" PRIuz ".bin", large ? "large" : "small", x);
+		file->name = _strdup(name);
+		file->size = large ? TEST_LARGE_SIZE : TEST_SMALL_SIZE;
+		file->data = malloc(file->size);
+		if (!file->name || !file->data)
+			return FALSE;
+
+		for (size_t y = 0; y < file->size; y++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			file->data[y] = (BYTE)(seed >> 16);
+		}
+
+		char* fullpath = GetCombinedPath(path, name);
+		FILE* fp = fullpath ? winpr_fopen(fullpath, "wb") : NULL;
+		free(fullpath);
+		if (!fp)
+			return FALSE;
+		const size_t written = fwrite(file->data, 1, file->size, fp);
+		(void)fclose(fp);
+		if (written != file->size)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void test_free_files(test_context* context)
+{
+	for (size_t x = 0; x < context->count; x++)
+	{
+		free(context->files[x].name);
+		free(context->files[x].data);
+	}
+	free(context->files);
+}
+
+int TestDriveThroughput(int argc, char* argv[])
+{
+	int rc = -1;
+	test_context context = { 0 };
+	rdpContext rdpcontext = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (freerdp_register_addin_provider(freerdp_channels_load_static_addin_entry, 0) != 0)
+		return -1;
+
+	if (!freerdp_load_channel_addin_entry("drive", NULL, "DeviceServiceEntry", 0))
+	{
+		printf("drive channel not built in, skipping\n");
+		return 0;
+	}
+
+	char* path =
+	    GetKnownSubPathV(KNOWN_PATH_TEMP, "TestDriveThroughput-%" PRIu32, GetCurrentProcessId());
+	if (!path || !winpr_PathMakePath(path, NULL))
+		goto fail;
+
+	rdpcontext.settings = freerdp_settings_new(0);
+	if (!test_drive_init(&context.drive) || !rdpcontext.settings)
+		goto fail;
+
+	if (!test_create_files(&context, path))
+		goto fail;
+
+	if (!test_copy(&context, &rdpcontext, path, FALSE))
+		goto fail;
+	if (!test_copy(&context, &rdpcontext, path, TRUE))
+		goto fail;
+	rc = 0;
+
+fail:
+	if (path)
+		winpr_RemoveDirectory_RecursiveA(path);
+	free(path);
+	test_free_files(&context);
+	freerdp_settings_free(rdpcontext.settings);
+	test_drive_uninit(&context.drive);
+	return rc;
+}
@@ -105,6 +105,7 @@ typedef struct
 	volatile LONG samplesRequested;
 	wStream* pendingSample;
 	volatile BOOL haveSample;
+	BOOL directInput; /* raw frames go straight into the encoder input, pendingSample unused */
 	wStream* sampleRespBuffer;
 
 	H264_CONTEXT* h264;
@@ -278,6 +279,9 @@ BOOL ecam_encoder_context_init(CameraDeviceStream* stream);
 BOOL ecam_encoder_context_free(CameraDeviceStream* stream);
 BOOL ecam_encoder_compress(CameraDeviceStream* stream, const BYTE* srcData, size_t srcSize,
                            BYTE** ppDstData, size_t* pDstSize);
+BOOL ecam_encoder_direct_input(CameraDeviceStream* stream);
+BOOL ecam_encoder_stage(CameraDeviceStream* stream, const BYTE* srcData, size_t srcSize);
+BOOL ecam_encoder_compress_staged(CameraDeviceStream* stream, BYTE** ppDstData, size_t* pDstSize);
 UINT32 h264_get_max_bitrate(UINT32 height);
 
 #endif /* FREERDP_CLIENT_CAMERA_H */
@@ -147,25 +147,37 @@ static UINT ecam_dev_send_pending(CameraDevice* dev, size_t streamIndex, CameraD
 		return CHANNEL_RC_OK;
 	}
 
-	BYTE* encodedSample = Stream_Buffer(stream->pendingSample);
-	size_t encodedSize = Stream_Length(stream->pendingSample);
-	if (streamInputFormat(stream) != streamOutputFormat(stream))
+	BYTE* encodedSample = NULL;
+	size_t encodedSize = 0;
+	if (stream->directInput)
 	{
-		if (!ecam_encoder_compress(stream, encodedSample, encodedSize, &encodedSample,
-		                           &encodedSize))
+		if (!ecam_encoder_compress_staged(stream, &encodedSample, &encodedSize))
 		{
-			WLog_DBG(TAG, "Frame dropped: error in ecam_encoder_compress");
+			WLog_DBG(TAG, "Frame dropped: error in ecam_encoder_compress_staged");
 			stream->haveSample = FALSE;
 			return CHANNEL_RC_OK;
 		}
-
-		if (!stream->streaming)
+	}
+	else
+	{
+		encodedSample = Stream_Buffer(stream->pendingSample);
+		encodedSize = Stream_Length(stream->pendingSample);
+		if ((streamInputFormat(stream) != streamOutputFormat(stream)) &&
+		    !ecam_encoder_compress(stream, encodedSample, encodedSize, &encodedSample,
+		                           &encodedSize))
 		{
-			WLog_DBG(TAG, "Frame delayed/dropped: stream stopped");
+			WLog_DBG(TAG, "Frame dropped: error in ecam_encoder_compress");
+			stream->haveSample = FALSE;
 			return CHANNEL_RC_OK;
 		}
 	}
 
+	if (!stream->streaming)
+	{
+		WLog_DBG(TAG, "Frame delayed/dropped: stream stopped");
+		return CHANNEL_RC_OK;
+	}
+
 	stream->samplesRequested--;
 	stream->haveSample = FALSE;
 
@@ -229,12 +241,26 @@ static UINT ecam_dev_sample_captured_callback(CameraDevice* dev, size_t streamIn
 		}
 	}
 
-	Stream_SetPosition(stream->pendingSample, 0);
-	if (!Stream_EnsureRemainingCapacity(stream->pendingSample, size))
-		goto out;
+	if (stream->directInput)
+	{
+		/* convert straight from the capture buffer into the encoder input, the next frame
+		 * simply overwrites it if this one is not requested in time */
+		if (!ecam_encoder_stage(stream, sample, size))
+		{
+			WLog_DBG(TAG, "Frame dropped: error in ecam_encoder_stage");
+			ret = CHANNEL_RC_OK;
+			goto out;
+		}
+	}
+	else
+	{
+		Stream_SetPosition(stream->pendingSample, 0);
+		if (!Stream_EnsureRemainingCapacity(stream->pendingSample, size))
+			goto out;
 
-	Stream_Write(stream->pendingSample, sample, size);
-	Stream_SealLength(stream->pendingSample);
+		Stream_Write(stream->pendingSample, sample, size);
+		Stream_SealLength(stream->pendingSample);
+	}
 	stream->haveSample = TRUE;
 
 	ret = ecam_dev_send_pending(dev, streamIndex, stream);
@@ -266,6 +292,7 @@ static void ecam_dev_stop_stream(CameraDevice* dev, size_t streamIndex)
 
 	Stream_Free(stream->pendingSample, TRUE);
 	stream->pendingSample = NULL;
+	stream->directInput = FALSE;
 
 	ecam_encoder_context_free(stream);
 }
@@ -367,8 +394,10 @@ static UINT ecam_dev_process_start_streams_request(CameraDevice* dev,
 		return ERROR_INVALID_DATA;
 	}
 
-	stream->pendingSample = Stream_New(NULL, 4ull * mediaType.Width * mediaType.Height);
-	if (!stream->pendingSample)
+	stream->directInput = ecam_encoder_direct_input(stream);
+	if (!stream->directInput)
+		stream->pendingSample = Stream_New(NULL, 4ull * mediaType.Width * mediaType.Height);
+	if (!stream->directInput && !stream->pendingSample)
 	{
 		WLog_ERR(TAG, "pending stream failed");
 		ecam_dev_stop_stream(dev, streamIndex);
@@ -0,0 +1,161 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * MS-RDPECAM Implementation, raw YUV frame conversion
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/wlog.h>
+
+#include <freerdp/channels/log.h>
+#include <freerdp/primitives.h>
+
+#include "camera_yuv.h"
+
+#define TAG CHANNELS_TAG("rdpecam-yuv.client")
+
+/* Camera frames are tightly packed (no row padding), the chroma planes of NV12 and I420 and
+ * the macro pixels of YUY2 cover 2 pixels horizontally, so odd widths are rounded up. */
+
+BOOL ecam_yuv_supported(CAM_MEDIA_FORMAT format)
+{
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_YUY2:
+		case CAM_MEDIA_FORMAT_NV12:
+		case CAM_MEDIA_FORMAT_I420:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+size_t ecam_yuv_frame_size(CAM_MEDIA_FORMAT format, UINT32 width, UINT32 height)
+{
+	const size_t cw = (1ull * width + 1ull) / 2ull;
+	const size_t ch = (1ull * height + 1ull) / 2ull;
+
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_YUY2:
+			return 4ull * cw * height;
+		case CAM_MEDIA_FORMAT_NV12:
+		case CAM_MEDIA_FORMAT_I420:
+			return 1ull * width * height + 2ull * cw * ch;
+		default:
+			return 0;
+	}
+}
+
+static BOOL copy_plane(const primitives_t* prims, const BYTE* WINPR_RESTRICT src, size_t srcStride,
+                       BYTE* WINPR_RESTRICT dst, size_t dstStride, size_t rowBytes, size_t rows)
+{
+	if ((srcStride == rowBytes) && (dstStride == rowBytes) && (rowBytes * rows <= INT32_MAX))
+	{
+		rowBytes *= rows;
+		rows = 1;
+	}
+
+	if (rowBytes > INT32_MAX)
+		return FALSE;
+
+	for (size_t y = 0; y < rows; y++)
+	{
+		if (prims->copy_8u(&src[y * srcStride], &dst[y * dstStride], (INT32)rowBytes) !=
+		    PRIMITIVES_SUCCESS)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL ecam_yuv_convert(CAM_MEDIA_FORMAT format, const BYTE* src, size_t srcSize, UINT32 width,
+                      UINT32 height, BYTE* dst[3], const UINT32 dstStride[3])
+{
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(dstStride);
+
+	const size_t needed = ecam_yuv_frame_size(format, width, height);
+	if (needed == 0)
+		return FALSE;
+	if (!src || (srcSize < needed))
+	{
+		WLog_ERR(TAG, "Frame too small, got %" PRIuz " bytes, expected %" PRIuz, srcSize, needed);
+		return FALSE;
+	}
+
+	const primitives_t* prims = primitives_get();
+	WINPR_ASSERT(prims);
+
+	const BOOL nv12 = dstStride[2] == 0;
+	const size_t cw = (1ull * width + 1ull) / 2ull;
+	const size_t ch = (1ull * height + 1ull) / 2ull;
+
+	if (dstStride[0] < width)
+		return FALSE;
+	if (dstStride[1] < (nv12 ? 2 * cw : cw))
+		return FALSE;
+	if (!nv12 && (dstStride[2] < cw))
+		return FALSE;
+
+	const prim_size_t roi = { .width = width, .height = height };
+
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_YUY2:
+		{
+			const UINT32 srcStep = (UINT32)(4 * cw);
+			if (nv12)
+				return prims->YUY2ToNV12_8u_C2P2R(src, srcStep, dst, dstStride, &roi) ==
+				       PRIMITIVES_SUCCESS;
+			return prims->YUY2ToYUV420_8u_C2P3R(src, srcStep, dst, dstStride, &roi) ==
+			       PRIMITIVES_SUCCESS;
+		}
+
+		case CAM_MEDIA_FORMAT_NV12:
+		{
+			const BYTE* uv = &src[1ull * width * height];
+			if (!nv12)
+			{
+				const BYTE* planes[3] = { src, uv, NULL };
+				const UINT32 steps[3] = { width, (UINT32)(2 * cw), 0 };
+				return prims->NV12ToYUV420_8u_P2P3R(planes, steps, dst, dstStride, &roi) ==
+				       PRIMITIVES_SUCCESS;
+			}
+			if (!copy_plane(prims, src, width, dst[0], dstStride[0], width, height))
+				return FALSE;
+			return copy_plane(prims, uv, 2 * cw, dst[1], dstStride[1], 2 * cw, ch);
+		}
+
+		case CAM_MEDIA_FORMAT_I420:
+		{
+			const BYTE* u = &src[1ull * width * height];
+			const BYTE* v = &u[cw * ch];
+			if (nv12)
+			{
+				const BYTE* planes[3] = { src, u, v };
+				const UINT32 steps[3] = { width, (UINT32)cw, (UINT32)cw };
+				return prims->YUV420ToNV12_8u_P3P2R(planes, steps, dst, dstStride, &roi) ==
+				       PRIMITIVES_SUCCESS;
+			}
+			if (!copy_plane(prims, src, width, dst[0], dstStride[0], width, height))
+				return FALSE;
+			if (!copy_plane(prims, u, cw, dst[1], dstStride[1], cw, ch))
+				return FALSE;
+			return copy_plane(prims, v, cw, dst[2], dstStride[2], cw, ch);
+		}
+
+		default:
+			return FALSE;
+	}
+}
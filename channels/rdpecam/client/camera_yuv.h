@@ -0,0 +1,51 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * MS-RDPECAM Implementation, raw YUV frame conversion
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CLIENT_CAMERA_YUV_H
+#define FREERDP_CLIENT_CAMERA_YUV_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+#include <freerdp/channels/rdpecam.h>
+
+/** @brief checks if frames in format can be converted with ecam_yuv_convert */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL BOOL ecam_yuv_supported(CAM_MEDIA_FORMAT format);
+
+/** @brief number of bytes of a tightly packed frame as delivered by the camera, 0 if unsupported */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL size_t ecam_yuv_frame_size(CAM_MEDIA_FORMAT format, UINT32 width, UINT32 height);
+
+/**
+ * @brief converts a tightly packed YUY2, NV12 or I420 camera frame to the encoder input planes
+ *
+ * @param format the format of src
+ * @param src the camera frame, may be a mapped capture buffer
+ * @param srcSize the number of bytes in src
+ * @param width the frame width
+ * @param height the frame height
+ * @param dst the destination planes
+ * @param dstStride the destination strides, dstStride[2] == 0 selects NV12 instead of I420
+ * @return TRUE on success, FALSE if the format is unsupported or src is too small
+ */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL BOOL ecam_yuv_convert(CAM_MEDIA_FORMAT format, const BYTE* src, size_t srcSize,
+                                    UINT32 width, UINT32 height, BYTE* dst[3],
+                                    const UINT32 dstStride[3]);
+
+#endif /* FREERDP_CLIENT_CAMERA_YUV_H */
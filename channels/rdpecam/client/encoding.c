@@ -21,6 +21,7 @@
 #include <winpr/winpr.h>
 
 #include "camera.h"
+#include "camera_yuv.h"
 
 #define TAG CHANNELS_TAG("rdpecam-video.client")
 
@@ -311,6 +312,27 @@ static BOOL ecam_init_sws_context(CameraDeviceStream* stream, enum AVPixelFormat
 	return TRUE;
 }
 
+/**
+ * Function description
+ *
+ * @return success/failure
+ */
+static BOOL ecam_encoder_stage_h264(CameraDeviceStream* stream, const BYTE* srcData,
+                                    size_t srcSize)
+{
+	BYTE* yuvData[3] = { 0 };
+	UINT32 yuvLineSizes[3] = { 0 };
+	const UINT32 width = stream->currMediaType.Width;
+	const UINT32 height = stream->currMediaType.Height;
+
+	/* get buffers for YUV420P or NV12 */
+	if (h264_get_yuv_buffer(stream->h264, 0, width, height, yuvData, yuvLineSizes) < 0)
+		return FALSE;
+
+	return ecam_yuv_convert(streamInputFormat(stream), srcData, srcSize, width, height, yuvData,
+	                        yuvLineSizes);
+}
+
 /**
  * Function description
  *
@@ -371,6 +393,15 @@ static BOOL ecam_encoder_compress_h264(CameraDeviceStream* stream, const BYTE* s
 	}
 	else
 #endif
+	    if (ecam_yuv_supported(inputFormat))
+	{
+		/* common raw formats are converted directly, no need for sws_scale */
+		if (!ecam_encoder_stage_h264(stream, srcData, srcSize))
+			return FALSE;
+
+		return ecam_encoder_compress_staged(stream, ppDstData, pDstSize);
+	}
+	else
 	{
 		pixFormat = ecamToAVPixFormat(inputFormat);
 
@@ -640,3 +671,65 @@ BOOL ecam_encoder_compress(CameraDeviceStream* stream, const BYTE* srcData, size
 			return FALSE;
 	}
 }
+
+/**
+ * Function description
+ *
+ * @return TRUE if captured frames can be converted directly into the encoder input
+ */
+BOOL ecam_encoder_direct_input(CameraDeviceStream* stream)
+{
+	WINPR_ASSERT(stream);
+
+	switch (streamOutputFormat(stream))
+	{
+		case CAM_MEDIA_FORMAT_H264:
+			return stream->h264 && ecam_yuv_supported(streamInputFormat(stream));
+		default:
+			return FALSE;
+	}
+}
+
+/**
+ * Function description
+ * convert a captured frame into the encoder input, srcData is not used after returning
+ *
+ * @return success/failure
+ */
+BOOL ecam_encoder_stage(CameraDeviceStream* stream, const BYTE* srcData, size_t srcSize)
+{
+	CAM_MEDIA_FORMAT format = streamOutputFormat(stream);
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_H264:
+			return ecam_encoder_stage_h264(stream, srcData, srcSize);
+		default:
+			WLog_ERR(TAG, "Unsupported output format %u", format);
+			return FALSE;
+	}
+}
+
+/**
+ * Function description
+ * compress the frame previously passed to ecam_encoder_stage
+ *
+ * @return success/failure
+ */
+BOOL ecam_encoder_compress_staged(CameraDeviceStream* stream, BYTE** ppDstData, size_t* pDstSize)
+{
+	CAM_MEDIA_FORMAT format = streamOutputFormat(stream);
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_H264:
+		{
+			UINT32 dstSize = 0;
+			if (h264_compress(stream->h264, ppDstData, &dstSize) < 0)
+				return FALSE;
+			*pDstSize = dstSize;
+			return TRUE;
+		}
+		default:
+			WLog_ERR(TAG, "Unsupported output format %u", format);
+			return FALSE;
+	}
+}
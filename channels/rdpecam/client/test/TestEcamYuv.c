@@ -0,0 +1,335 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/types.h>
+
+#include "../camera_yuv.h"
+#include "../../../../libfreerdp/test/test_performance.h"
+
+/* the number of mapped capture buffers a V4L2 camera cycles through */
+#define TEST_CAPTURE_BUFFERS 4
+#define TEST_BENCH_FRAMES 120
+
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	BOOL nv12;
+	BYTE* plane[3];
+	UINT32 stride[3];
+} test_yuv_buffer;
+
+static BYTE test_luma(size_t x, size_t y, UINT32 seed)
+{
+	return (BYTE)(x * 3 + y * 7 + seed);
+}
+
+static BYTE test_chroma(size_t x, size_t y, size_t plane, UINT32 seed)
+{
+	return (BYTE)(x * 5 + y * 11 + plane * 101 + seed);
+}
+
+static const char* test_format_name(CAM_MEDIA_FORMAT format)
+{
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_YUY2:
+			return "YUY2";
+		case CAM_MEDIA_FORMAT_NV12:
+			return "NV12";
+		case CAM_MEDIA_FORMAT_I420:
+			return "I420";
+		default:
+			return "unknown";
+	}
+}
+
+/* synthetic camera frame, tightly packed like a V4L2 capture buffer */
+static BYTE* test_frame_new(CAM_MEDIA_FORMAT format, UINT32 width, UINT32 height, UINT32 seed,
+                            size_t* size)
+{
+	const size_t cw = (width + 1ull) / 2ull;
+	const size_t ch = (height + 1ull) / 2ull;
+
+	*size = ecam_yuv_frame_size(format, width, height);
+	BYTE* frame = malloc(*size);
+	if (!frame)
+		return NULL;
+
+	switch (format)
+	{
+		case CAM_MEDIA_FORMAT_YUY2:
+			for (size_t y = 0; y < height; y++)
+			{
+				BYTE* row = &frame[y * 4 * cw];
+				for (size_t x = 0; x < cw; x++)
+				{
+					row[4 * x] = test_luma(2 * x, y, seed);
+					row[4 * x + 1] = test_chroma(x, y, 1, seed);
+					row[4 * x + 2] = test_luma(2 * x + 1, y, seed);
+					row[4 * x + 3] = test_chroma(x, y, 2, seed);
+				}
+			}
+			break;
+
+		case CAM_MEDIA_FORMAT_NV12:
+		case CAM_MEDIA_FORMAT_I420:
+		{
+			BYTE* chroma = &frame[1ull * width * height];
+			for (size_t y = 0; y < height; y++)
+			{
+				for (size_t x = 0; x < width; x++)
+					frame[y * width + x] = test_luma(x, y, seed);
+			}
+			for (size_t y = 0; y < ch; y++)
+			{
+				for (size_t x = 0; x < cw; x++)
+				{
+					if (format == CAM_MEDIA_FORMAT_NV12)
+					{
+						chroma[y * 2 * cw + 2 * x] = test_chroma(x, y, 1, seed);
+						chroma[y * 2 * cw + 2 * x + 1] = test_chroma(x, y, 2, seed);
+					}
+					else
+					{
+						chroma[y * cw + x] = test_chroma(x, y, 1, seed);
+						chroma[cw * ch + y * cw + x] = test_chroma(x, y, 2, seed);
+					}
+				}
+			}
+		}
+		break;
+
+		default:
+			free(frame);
+			return NULL;
+	}
+	return frame;
+}
+
+static BYTE test_expected_chroma(CAM_MEDIA_FORMAT format, UINT32 height, size_t x, size_t y,
+                                 size_t plane, UINT32 seed)
+{
+	if (format != CAM_MEDIA_FORMAT_YUY2)
+		return test_chroma(x, y, plane, seed);
+
+	const size_t y1 = MIN(2 * y + 1, height - 1ull);
+	return (BYTE)((test_chroma(x, 2 * y, plane, seed) + test_chroma(x, y1, plane, seed) + 1) >> 1);
+}
+
+static BOOL test_verify(CAM_MEDIA_FORMAT format, const test_yuv_buffer* dst, UINT32 seed)
+{
+	const size_t cw = (dst->width + 1ull) / 2ull;
+	const size_t ch = (dst->height + 1ull) / 2ull;
+
+	for (size_t y = 0; y < dst->height; y++)
+	{
+		for (size_t x = 0; x < dst->width; x++)
+		{
+			if (dst->plane[0][y * dst->stride[0] + x] != test_luma(x, y, seed))
+			{
+				(void)fprintf(stderr, "%s: luma mismatch at %" PRIuz "x%" PRIuz "\n",
+				              test_format_name(format), x, y);
+				return FALSE;
+			}
+		}
+	}
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		for (size_t x = 0; x < cw; x++)
+		{
+			BYTE u = 0;
+			BYTE v = 0;
+			if (dst->nv12)
+			{
+				u = dst->plane[1][y * dst->stride[1] + 2 * x];
+				v = dst->plane[1][y * dst->stride[1] + 2 * x + 1];
+			}
+			else
+			{
+				u = dst->plane[1][y * dst->stride[1] + x];
+				v = dst->plane[2][y * dst->stride[2] + x];
+			}
+
+			if ((u != test_expected_chroma(format, dst->height, x, y, 1, seed)) ||
+			    (v != test_expected_chroma(format, dst->height, x, y, 2, seed)))
+			{
+				(void)fprintf(stderr, "%s: chroma mismatch at %" PRIuz "x%" PRIuz "\n",
+				              test_format_name(format), x, y);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+static void test_yuv_buffer_free(test_yuv_buffer* buffer)
+{
+	for (size_t x = 0; x < 3; x++)
+		free(buffer->plane[x]);
+}
+
+/* strides padded to 16 like the H264 encoder input buffers */
+static BOOL test_yuv_buffer_init(test_yuv_buffer* buffer, UINT32 width, UINT32 height, BOOL nv12)
+{
+	const UINT32 stride = (width + 15) & ~15u;
+	const size_t ch = (height + 1ull) / 2ull;
+
+	buffer->width = width;
+	buffer->height = height;
+	buffer->nv12 = nv12;
+	buffer->stride[0] = stride;
+	buffer->stride[1] = nv12 ? stride : stride / 2;
+	buffer->stride[2] = nv12 ? 0 : stride / 2;
+
+	buffer->plane[0] = calloc(height, stride);
+	buffer->plane[1] = calloc(ch, buffer->stride[1]);
+	if (!nv12)
+		buffer->plane[2] = calloc(ch, buffer->stride[2]);
+	if (!buffer->plane[0] || !buffer->plane[1] || (!nv12 && !buffer->plane[2]))
+	{
+		test_yuv_buffer_free(buffer);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL test_convert(CAM_MEDIA_FORMAT format, UINT32 width, UINT32 height, BOOL nv12)
+{
+	BOOL rc = FALSE;
+	size_t size = 0;
+	test_yuv_buffer dst = { 0 };
+	BYTE* frame = test_frame_new(format, width, height, width ^ height, &size);
+
+	if (!frame || !test_yuv_buffer_init(&dst, width, height, nv12))
+		goto fail;
+
+	if (!ecam_yuv_convert(format, frame, size, width, height, dst.plane, dst.stride))
+		goto fail;
+	if (!test_verify(format, &dst, width ^ height))
+		goto fail;
+
+	/* truncated frames must be rejected */
+	if (ecam_yuv_convert(format, frame, size - 1, width, height, dst.plane, dst.stride))
+		goto fail;
+	rc = TRUE;
+
+fail:
+	if (!rc)
+		(void)fprintf(stderr, "%s %" PRIu32 "x%" PRIu32 " to %s failed\n",
+		              test_format_name(format), width, height, nv12 ? "NV12" : "I420");
+	test_yuv_buffer_free(&dst);
+	free(frame);
+	return rc;
+}
+
+/* Synthetic camera: frames are converted straight from a ring of capture buffers, compared
+ * to copying each frame to a pending buffer first as the sample callback did before. */
+static BOOL test_bench(CAM_MEDIA_FORMAT format, UINT32 width, UINT32 height, BOOL nv12)
+{
+	BOOL rc = FALSE;
+	size_t size = 0;
+	BYTE* pending = NULL;
+	BYTE* capture[TEST_CAPTURE_BUFFERS] = { 0 };
+	test_yuv_buffer dst = { 0 };
+
+	for (size_t x = 0; x < TEST_CAPTURE_BUFFERS; x++)
+	{
+		capture[x] = test_frame_new(format, width, height, (UINT32)x, &size);
+		if (!capture[x])
+			goto fail;
+	}
+	pending = malloc(size);
+	if (!pending || !test_yuv_buffer_init(&dst, width, height, nv12))
+		goto fail;
+
+	UINT64 elapsed[2] = { 0 };
+	for (size_t pass = 0; pass < 2; pass++)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		for (size_t x = 0; x < TEST_BENCH_FRAMES; x++)
+		{
+			const BYTE* sample = capture[x % TEST_CAPTURE_BUFFERS];
+			if (pass == 1)
+			{
+				memcpy(pending, sample, size);
+				sample = pending;
+			}
+			if (!ecam_yuv_convert(format, sample, size, width, height, dst.plane, dst.stride))
+				goto fail;
+		}
+		elapsed[pass] = MAX(1, winpr_GetTickCount64NS() - start);
+	}
+
+	if (!test_verify(format, &dst, (TEST_BENCH_FRAMES - 1) % TEST_CAPTURE_BUFFERS))
+		goto fail;
+
+	printf("%s -> %s %" PRIu32 "x%" PRIu32 ": direct %.0f fps, with pending copy %.0f fps\n",
+	       test_format_name(format), nv12 ? "NV12" : "I420", width, height,
+	       TEST_BENCH_FRAMES * 1000000000.0 / (double)elapsed[0],
+	       TEST_BENCH_FRAMES * 1000000000.0 / (double)elapsed[1]);
+	rc = TRUE;
+
+fail:
+	test_yuv_buffer_free(&dst);
+	free(pending);
+	for (size_t x = 0; x < TEST_CAPTURE_BUFFERS; x++)
+		free(capture[x]);
+	return rc;
+}
+
+int TestEcamYuv(int argc, char* argv[])
+{
+	const CAM_MEDIA_FORMAT formats[] = { CAM_MEDIA_FORMAT_YUY2, CAM_MEDIA_FORMAT_NV12,
+		                                 CAM_MEDIA_FORMAT_I420 };
+	const UINT32 sizes[][2] = { { 640, 480 }, { 33, 17 }, { 2, 1 }, { 1, 1 } };
+
+	if (ecam_yuv_supported(CAM_MEDIA_FORMAT_MJPG) || ecam_yuv_supported(CAM_MEDIA_FORMAT_H264))
+		return -1;
+
+	for (size_t f = 0; f < ARRAYSIZE(formats); f++)
+	{
+		if (!ecam_yuv_supported(formats[f]))
+			return -1;
+
+		for (size_t s = 0; s < ARRAYSIZE(sizes); s++)
+		{
+			if (!test_convert(formats[f], sizes[s][0], sizes[s][1], FALSE))
+				return -1;
+			if (!test_convert(formats[f], sizes[s][0], sizes[s][1], TRUE))
+				return -1;
+		}
+	}
+
+	test_performance_setup(argc, argv);
+	if (!g_TestPerformance)
+		return 0;
+
+	for (size_t f = 0; f < ARRAYSIZE(formats); f++)
+	{
+		if (!test_bench(formats[f], 1280, 720, FALSE))
+			return -1;
+		if (!test_bench(formats[f], 1280, 720, TRUE))
+			return -1;
+	}
+	return 0;
+}
@@ -49,6 +49,7 @@
 #include <freerdp/client/channels.h>
 
 #include "rdpsnd_common.h"
+#include "rdpsnd_jitter.h"
 #include "rdpsnd_main.h"
 
 struct rdpsnd_plugin
@@ -86,14 +87,14 @@ struct rdpsnd_plugin
 	BYTE waveData[4];
 	UINT16 waveDataSize;
 	UINT16 wTimeStamp;
-	UINT64 wArrivalTime;
+	UINT64 wArrivalTimeNS;
 
 	UINT32 latency;
 	BOOL isOpen;
 	AUDIO_FORMAT* fixed_format;
 
-	UINT32 startPlayTime;
-	size_t totalPlaySize;
+	RDPSND_JITTER* jitter;
+	UINT32 jitterMaxDelay;
 
 	char* subsystem;
 	char* device_name;
@@ -429,16 +430,26 @@ static BOOL rdpsnd_ensure_device_is_open(rdpsndPlugin* rdpsnd, UINT16 wFormatNo,
 		if (!rc)
 			return FALSE;
 
+		/* the jitter buffer sees the data as passed to the device */
+		AUDIO_FORMAT playFormat = *format;
 		if (!supported)
 		{
 			if (!freerdp_dsp_context_reset(rdpsnd->dsp_context, format, 0u))
 				return FALSE;
+
+			if (format->wFormatTag != WAVE_FORMAT_PCM)
+			{
+				playFormat.wFormatTag = WAVE_FORMAT_PCM;
+				playFormat.wBitsPerSample = 16;
+				playFormat.nBlockAlign = 2 * format->nChannels;
+				playFormat.nAvgBytesPerSec = playFormat.nBlockAlign * format->nSamplesPerSec;
+				playFormat.cbSize = 0;
+			}
 		}
 
 		rdpsnd->isOpen = TRUE;
 		rdpsnd->wCurrentFormatNo = wFormatNo;
-		rdpsnd->startPlayTime = 0;
-		rdpsnd->totalPlaySize = 0;
+		rdpsnd_jitter_reset(rdpsnd->jitter, &playFormat, rdpsnd->latency);
 	}
 
 	return rdpsnd_apply_volume(rdpsnd);
@@ -459,7 +470,7 @@ static UINT rdpsnd_recv_wave_info_pdu(rdpsndPlugin* rdpsnd, wStream* s, UINT16 B
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 12))
 		return ERROR_BAD_LENGTH;
 
-	rdpsnd->wArrivalTime = GetTickCount64();
+	rdpsnd->wArrivalTimeNS = winpr_GetTickCount64NS();
 	Stream_Read_UINT16(s, rdpsnd->wTimeStamp);
 	Stream_Read_UINT16(s, wFormatNo);
 
@@ -510,101 +521,91 @@ static UINT rdpsnd_send_wave_confirm_pdu(rdpsndPlugin* rdpsnd, UINT16 wTimeStamp
 	return rdpsnd_virtual_channel_write(rdpsnd, pdu);
 }
 
-static BOOL rdpsnd_detect_overrun(rdpsndPlugin* rdpsnd, const AUDIO_FORMAT* format, size_t size)
+static void rdpsnd_update_metrics(rdpsndPlugin* rdpsnd, UINT64 latency)
 {
-	UINT32 bpf = 0;
-	UINT32 now = 0;
-	UINT32 duration = 0;
-	UINT32 totalDuration = 0;
-	UINT32 remainingDuration = 0;
-	UINT32 maxDuration = 0;
-
-	if (!rdpsnd || !format)
-		return FALSE;
+	RDPSND_JITTER_STATS stats = { 0 };
+	rdpContext* context = rdpsnd->rdpcontext;
 
-	/* Older windows RDP servers do not limit the send buffer, which can
-	 * cause quite a large amount of sound data buffered client side.
-	 * If e.g. sound is paused server side the client will keep playing
-	 * for a long time instead of pausing playback.
-	 *
-	 * To avoid this we check:
-	 *
-	 * 1. Is the sound sample received from a known format these servers
-	 *    support
-	 * 2. If it is calculate the size of the client side sound buffer
-	 * 3. If the buffer is too large silently drop the sample which will
-	 *    trigger a retransmit later on.
-	 *
-	 * This check must only be applied to these known formats, because
-	 * with newer and other formats the sample size can not be calculated
-	 * without decompressing the sample first.
-	 */
-	switch (format->wFormatTag)
-	{
-		case WAVE_FORMAT_PCM:
-		case WAVE_FORMAT_DVI_ADPCM:
-		case WAVE_FORMAT_ADPCM:
-		case WAVE_FORMAT_ALAW:
-		case WAVE_FORMAT_MULAW:
-			break;
-		case WAVE_FORMAT_MSG723:
-		case WAVE_FORMAT_GSM610:
-		case WAVE_FORMAT_AAC_MS:
-		default:
-			return FALSE;
-	}
+	if (!context || !context->metrics)
+		return;
 
-	audio_format_print(WLog_Get(TAG), WLOG_DEBUG, format);
-	bpf = format->nChannels * format->wBitsPerSample * format->nSamplesPerSec / 8;
-	if (bpf == 0)
-		return FALSE;
+	rdpsnd_jitter_get_stats(rdpsnd->jitter, &stats);
+
+	rdpMetrics* metrics = context->metrics;
+	metrics->AudioLatency = latency;
+	metrics->AudioLatencyMax = MAX(metrics->AudioLatencyMax, latency);
+	metrics->AudioJitter = stats.jitter;
+	metrics->AudioBufferTarget = stats.target;
+	metrics->AudioUnderruns = stats.underruns;
+	metrics->AudioOverruns = stats.overruns;
+	metrics->AudioDrift = stats.drift;
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpsnd_play_wave(rdpsndPlugin* rdpsnd, const AUDIO_FORMAT* format, const BYTE* data,
+                             size_t size, UINT* latency, UINT32* delay)
+{
+	UINT status = CHANNEL_RC_OK;
+	wStream* pcmData = StreamPool_Take(rdpsnd->pool, 4096);
+	wStream* playData = StreamPool_Take(rdpsnd->pool, 4096);
 
-	duration = (UINT32)(1000 * size / bpf);
-	totalDuration = (UINT32)(1000 * rdpsnd->totalPlaySize / bpf);
-	now = GetTickCountPrecise();
-	if (rdpsnd->startPlayTime == 0)
+	if (!pcmData || !playData)
 	{
-		rdpsnd->startPlayTime = now;
-		rdpsnd->totalPlaySize = size;
-		return FALSE;
+		status = CHANNEL_RC_NO_MEMORY;
+		goto out;
 	}
-	else if (now - rdpsnd->startPlayTime > totalDuration + 10)
+
+	if (!rdpsnd->device->FormatSupported(rdpsnd->device, format))
 	{
-		/* Buffer underrun */
-		WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Buffer underrun by %u ms",
-		           rdpsnd_is_dyn_str(rdpsnd->dynamic),
-		           (UINT)(now - rdpsnd->startPlayTime - totalDuration));
-		rdpsnd->startPlayTime = now;
-		rdpsnd->totalPlaySize = size;
-		return FALSE;
+		if (!freerdp_dsp_decode(rdpsnd->dsp_context, format, data, size, pcmData))
+		{
+			status = ERROR_INTERNAL_ERROR;
+			goto out;
+		}
+
+		Stream_SealLength(pcmData);
+		data = Stream_Buffer(pcmData);
+		size = Stream_Length(pcmData);
 	}
-	else
+
+	if (rdpsnd_jitter_process(rdpsnd->jitter, data, size, winpr_GetTickCount64NS(), playData,
+	                          delay) != RDPSND_JITTER_PLAY)
 	{
-		/* Calculate remaining duration to be played */
-		remainingDuration = totalDuration - (now - rdpsnd->startPlayTime);
+		WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Buffer overrun, dropping %" PRIuz " bytes",
+		           rdpsnd_is_dyn_str(rdpsnd->dynamic), size);
+		goto out;
+	}
 
-		/* Maximum allow duration calculation */
-		maxDuration = duration * 2 + rdpsnd->latency;
+	if (rdpsnd->device->PlayEx)
+		*latency = rdpsnd->device->PlayEx(rdpsnd->device, format, Stream_Buffer(playData),
+		                                  Stream_Length(playData));
+	else
+		*latency = IFCALLRESULT(0, rdpsnd->device->Play, rdpsnd->device, Stream_Buffer(playData),
+		                        Stream_Length(playData));
 
-		if (remainingDuration + duration > maxDuration)
-		{
-			WLog_Print(rdpsnd->log, WLOG_DEBUG, "%s Buffer overrun pending %u ms dropping %u ms",
-			           rdpsnd_is_dyn_str(rdpsnd->dynamic), remainingDuration, duration);
-			return TRUE;
-		}
+	/* from arrival until the wave is audible */
+	const UINT64 processing = (winpr_GetTickCount64NS() - rdpsnd->wArrivalTimeNS) / 1000000ull;
+	rdpsnd_update_metrics(rdpsnd, processing + *delay + *latency);
 
-		rdpsnd->totalPlaySize += size;
-		return FALSE;
-	}
+out:
+	if (pcmData)
+		Stream_Release(pcmData);
+	if (playData)
+		Stream_Release(playData);
+	return status;
 }
 
 static UINT rdpsnd_treat_wave(rdpsndPlugin* rdpsnd, wStream* s, size_t size)
 {
 	AUDIO_FORMAT* format = NULL;
-	UINT64 end = 0;
 	UINT64 diffMS = 0;
 	UINT64 ts = 0;
 	UINT latency = 0;
+	UINT32 delay = 0;
 	UINT error = 0;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, size))
@@ -628,46 +629,22 @@ static UINT rdpsnd_treat_wave(rdpsndPlugin* rdpsnd, wStream* s, size_t size)
 	           "%s Wave: cBlockNo: %" PRIu8 " wTimeStamp: %" PRIu16 ", size: %" PRIuz,
 	           rdpsnd_is_dyn_str(rdpsnd->dynamic), rdpsnd->cBlockNo, rdpsnd->wTimeStamp, size);
 
-	if (rdpsnd->device && rdpsnd->attached && !rdpsnd_detect_overrun(rdpsnd, format, size))
-	{
-		UINT status = CHANNEL_RC_OK;
-		wStream* pcmData = StreamPool_Take(rdpsnd->pool, 4096);
-
-		if (rdpsnd->device->FormatSupported(rdpsnd->device, format))
-		{
-			if (rdpsnd->device->PlayEx)
-				latency = rdpsnd->device->PlayEx(rdpsnd->device, format, data, size);
-			else
-				latency = IFCALLRESULT(0, rdpsnd->device->Play, rdpsnd->device, data, size);
-		}
-		else if (freerdp_dsp_decode(rdpsnd->dsp_context, format, data, size, pcmData))
-		{
-			Stream_SealLength(pcmData);
-
-			if (rdpsnd->device->PlayEx)
-				latency = rdpsnd->device->PlayEx(rdpsnd->device, format, Stream_Buffer(pcmData),
-				                                 Stream_Length(pcmData));
-			else
-				latency = IFCALLRESULT(0, rdpsnd->device->Play, rdpsnd->device,
-				                       Stream_Buffer(pcmData), Stream_Length(pcmData));
-		}
-		else
-			status = ERROR_INTERNAL_ERROR;
-
-		Stream_Release(pcmData);
+	rdpsnd_jitter_arrival(rdpsnd->jitter, rdpsnd->wTimeStamp, rdpsnd->wArrivalTimeNS);
 
+	if (rdpsnd->device && rdpsnd->attached)
+	{
+		const UINT status = rdpsnd_play_wave(rdpsnd, format, data, size, &latency, &delay);
 		if (status != CHANNEL_RC_OK)
 			return status;
 	}
 
-	end = GetTickCount64();
-	diffMS = end - rdpsnd->wArrivalTime + latency;
+	diffMS = (winpr_GetTickCount64NS() - rdpsnd->wArrivalTimeNS) / 1000000ull + delay + latency;
 	ts = (rdpsnd->wTimeStamp + diffMS) % UINT16_MAX;
 
 	/*
 	 * Send the second WaveConfirm PDU. With the first WaveConfirm PDU,
 	 * the server side uses this second WaveConfirm PDU to determine the actual
-	 * render latency.
+	 * render latency, which includes the time the wave waits in the jitter buffer.
 	 */
 	return rdpsnd_send_wave_confirm_pdu(rdpsnd, (UINT16)ts, rdpsnd->cBlockNo);
 }
@@ -712,7 +689,7 @@ static UINT rdpsnd_recv_wave2_pdu(rdpsndPlugin* rdpsnd, wStream* s, UINT16 BodyS
 		return ERROR_INVALID_DATA;
 	format = &rdpsnd->ClientFormats[wFormatNo];
 	rdpsnd->waveDataSize = BodySize - 12;
-	rdpsnd->wArrivalTime = GetTickCount64();
+	rdpsnd->wArrivalTimeNS = winpr_GetTickCount64NS();
 	WLog_Print(rdpsnd->log, WLOG_DEBUG,
 	           "%s Wave2PDU: cBlockNo: %" PRIu8 " wFormatNo: %" PRIu16
 	           " [%s] , align=%hu wTimeStamp=0x%04" PRIx16 ", dwAudioTimeStamp=0x%08" PRIx32,
@@ -910,6 +887,8 @@ static UINT rdpsnd_process_addin_args(rdpsndPlugin* rdpsnd, const ADDIN_ARGV* ar
 		{ "latency", COMMAND_LINE_VALUE_REQUIRED, "<latency>", NULL, NULL, -1, NULL, "latency" },
 		{ "quality", COMMAND_LINE_VALUE_REQUIRED, "<quality mode>", NULL, NULL, -1, NULL,
 		  "quality mode" },
+		{ "jitter", COMMAND_LINE_VALUE_REQUIRED, "<max delay>", NULL, NULL, -1, NULL,
+		  "jitter buffer" },
 		{ NULL, 0, NULL, NULL, NULL, -1, NULL, NULL }
 	};
 	rdpsnd->wQualityMode = HIGH_QUALITY; /* default quality mode */
@@ -977,6 +956,15 @@ static UINT rdpsnd_process_addin_args(rdpsndPlugin* rdpsnd, const ADDIN_ARGV* ar
 
 				rdpsnd->latency = (UINT32)val;
 			}
+			CommandLineSwitchCase(arg, "jitter")
+			{
+				unsigned long val = strtoul(arg->Value, NULL, 0);
+
+				if ((errno != 0) || (val > UINT32_MAX))
+					return CHANNEL_RC_INITIALIZATION_ERROR;
+
+				rdpsnd->jitterMaxDelay = (UINT32)val;
+			}
 			CommandLineSwitchCase(arg, "quality")
 			{
 				long wQualityMode = DYNAMIC_QUALITY;
@@ -1052,6 +1040,7 @@ static UINT rdpsnd_process_connect(rdpsndPlugin* rdpsnd)
 	UINT status = ERROR_INTERNAL_ERROR;
 	WINPR_ASSERT(rdpsnd);
 	rdpsnd->latency = 0;
+	rdpsnd->jitterMaxDelay = RDPSND_JITTER_DEFAULT_MAX_DELAY;
 	args = (const ADDIN_ARGV*)rdpsnd->channelEntryPoints.pExtendedData;
 
 	if (args)
@@ -1062,6 +1051,11 @@ static UINT rdpsnd_process_connect(rdpsndPlugin* rdpsnd)
 			return status;
 	}
 
+	rdpsnd_jitter_free(rdpsnd->jitter);
+	rdpsnd->jitter = rdpsnd_jitter_new(rdpsnd->jitterMaxDelay);
+	if (!rdpsnd->jitter)
+		return CHANNEL_RC_NO_MEMORY;
+
 	if (rdpsnd->subsystem)
 	{
 		if ((status = rdpsnd_load_device_plugin(rdpsnd, rdpsnd->subsystem, args)))
@@ -1379,9 +1373,11 @@ static void free_internals(rdpsndPlugin* rdpsnd)
 
 	rdpsnd_terminate_thread(rdpsnd);
 	freerdp_dsp_context_free(rdpsnd->dsp_context);
+	rdpsnd_jitter_free(rdpsnd->jitter);
 	StreamPool_Free(rdpsnd->pool);
 	rdpsnd->pool = NULL;
 	rdpsnd->dsp_context = NULL;
+	rdpsnd->jitter = NULL;
 }
 
 static BOOL allocate_internals(rdpsndPlugin* rdpsnd)
@@ -0,0 +1,330 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Audio Output Virtual Channel - adaptive jitter buffer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/endian.h>
+
+#include <freerdp/types.h>
+
+#include "rdpsnd_jitter.h"
+
+/* The device buffer is modelled from the wall clock: every wave extends the time the queued
+ * audio runs out by its duration. The playout delay target follows the smoothed arrival
+ * jitter of the server timestamps (RFC 3550 style estimator). The difference between queued
+ * audio and the target (network burstiness and server/device clock drift) is corrected by
+ * slightly resampling 16bit PCM, an empty buffer is refilled with silence. */
+
+#define RDPSND_JITTER_MAX_CHANNELS 8
+
+/* jitter multiplier for the playout delay target */
+#define RDPSND_JITTER_TARGET_FACTOR 3
+
+/* arrival gaps above this are treated as a stream restart, in ms */
+#define RDPSND_JITTER_RESTART_GAP 1000
+
+/* queued audio within target +/- this is not corrected, in ms */
+#define RDPSND_JITTER_DEADBAND 2
+
+/* rate correction per ms of (smoothed) buffer error */
+#define RDPSND_JITTER_PPM_PER_MS 500
+
+struct S_RDPSND_JITTER
+{
+	UINT32 maxDelay;
+	UINT32 deviceLatency;
+	AUDIO_FORMAT format;
+	size_t frameSize;
+	UINT32 bytesPerSecond;
+	BOOL canResample;
+
+	BOOL started;
+	UINT64 playedUntilNS;
+	double fillError;
+
+	BOOL haveArrival;
+	UINT16 lastTimeStamp;
+	UINT64 lastArrivalNS;
+	double jitter;
+
+	/* resampler read position, -1 is the last frame of the previous wave */
+	double position;
+	INT16 last[RDPSND_JITTER_MAX_CHANNELS];
+
+	RDPSND_JITTER_STATS stats;
+};
+
+static double jitter_abs(double value)
+{
+	if (value < 0.0)
+		return -value;
+	return value;
+}
+
+static UINT32 jitter_target(const RDPSND_JITTER* jitter)
+{
+	if (jitter->maxDelay == 0)
+		return 0;
+
+	const double target = RDPSND_JITTER_MIN_DELAY + RDPSND_JITTER_TARGET_FACTOR * jitter->jitter;
+	if (target > jitter->maxDelay)
+		return MAX(jitter->maxDelay, RDPSND_JITTER_MIN_DELAY);
+	return (UINT32)target;
+}
+
+RDPSND_JITTER* rdpsnd_jitter_new(UINT32 maxDelay)
+{
+	RDPSND_JITTER* jitter = calloc(1, sizeof(RDPSND_JITTER));
+	if (!jitter)
+		return NULL;
+
+	jitter->maxDelay = maxDelay;
+	jitter->stats.target = jitter_target(jitter);
+	return jitter;
+}
+
+void rdpsnd_jitter_free(RDPSND_JITTER* jitter)
+{
+	free(jitter);
+}
+
+void rdpsnd_jitter_reset(RDPSND_JITTER* jitter, const AUDIO_FORMAT* format, UINT32 deviceLatency)
+{
+	WINPR_ASSERT(jitter);
+	WINPR_ASSERT(format);
+
+	jitter->format = *format;
+	jitter->deviceLatency = deviceLatency;
+	jitter->frameSize = 1ull * format->nChannels * format->wBitsPerSample / 8;
+	jitter->bytesPerSecond = 0;
+	jitter->canResample = FALSE;
+
+	/* only these formats allow calculating the duration without decoding */
+	switch (format->wFormatTag)
+	{
+		case WAVE_FORMAT_PCM:
+		case WAVE_FORMAT_DVI_ADPCM:
+		case WAVE_FORMAT_ADPCM:
+		case WAVE_FORMAT_ALAW:
+		case WAVE_FORMAT_MULAW:
+			jitter->bytesPerSecond =
+			    format->nChannels * format->wBitsPerSample * format->nSamplesPerSec / 8;
+			break;
+		default:
+			break;
+	}
+
+	if ((format->wFormatTag == WAVE_FORMAT_PCM) && (format->wBitsPerSample == 16) &&
+	    (format->nChannels > 0) && (format->nChannels <= RDPSND_JITTER_MAX_CHANNELS))
+		jitter->canResample = TRUE;
+
+	jitter->started = FALSE;
+	jitter->playedUntilNS = 0;
+	jitter->fillError = 0.0;
+	jitter->position = -1.0;
+	memset(jitter->last, 0, sizeof(jitter->last));
+	jitter->stats.buffered = 0;
+	jitter->stats.drift = 0;
+}
+
+void rdpsnd_jitter_arrival(RDPSND_JITTER* jitter, UINT16 wTimeStamp, UINT64 arrivalNS)
+{
+	WINPR_ASSERT(jitter);
+
+	if (jitter->haveArrival && (arrivalNS >= jitter->lastArrivalNS))
+	{
+		const double arrival = (double)(arrivalNS - jitter->lastArrivalNS) / 1000000.0;
+		const INT16 sent = (INT16)(UINT16)(wTimeStamp - jitter->lastTimeStamp);
+
+		if ((sent >= 0) && (arrival < RDPSND_JITTER_RESTART_GAP))
+		{
+			const double d = jitter_abs(arrival - sent);
+			jitter->jitter += (d - jitter->jitter) / 16.0;
+		}
+	}
+
+	jitter->haveArrival = TRUE;
+	jitter->lastTimeStamp = wTimeStamp;
+	jitter->lastArrivalNS = arrivalNS;
+	jitter->stats.jitter = (UINT32)(jitter->jitter + 0.5);
+	jitter->stats.target = jitter_target(jitter);
+}
+
+static BOOL jitter_write_silence(RDPSND_JITTER* jitter, UINT32 ms, wStream* out)
+{
+	const size_t frames = 1ull * jitter->format.nSamplesPerSec * ms / 1000;
+	const size_t size = frames * jitter->frameSize;
+
+	if (!Stream_EnsureRemainingCapacity(out, size))
+		return FALSE;
+
+	/* 8bit PCM is unsigned */
+	Stream_Fill(out, (jitter->format.wBitsPerSample == 8) ? 0x80 : 0x00, size);
+	jitter->stats.silence += ms;
+	return TRUE;
+}
+
+/* linear interpolation, only used for corrections of a few permille */
+static BOOL jitter_resample(RDPSND_JITTER* jitter, const BYTE* data, size_t frames, double step,
+                            wStream* out)
+{
+	const size_t channels = jitter->format.nChannels;
+	const size_t maxFrames = (size_t)((double)frames / step) + 2;
+
+	if (frames == 0)
+		return TRUE;
+
+	if (!Stream_EnsureRemainingCapacity(out, maxFrames * jitter->frameSize))
+		return FALSE;
+
+	size_t written = 0;
+	double pos = jitter->position;
+	while ((pos < (double)frames - 1.0) && (written < maxFrames))
+	{
+		/* pos >= -1, so the truncation rounds down */
+		const SSIZE_T index = (SSIZE_T)(pos + 1.0) - 1;
+		const double frac = pos - (double)index;
+
+		for (size_t c = 0; c < channels; c++)
+		{
+			const INT16 a =
+			    (index < 0) ? jitter->last[c]
+			                : winpr_Data_Get_INT16(&data[((size_t)index * channels + c) * 2]);
+			const INT16 b = winpr_Data_Get_INT16(&data[((size_t)(index + 1) * channels + c) * 2]);
+			const double v = a + frac * (b - a);
+			Stream_Write_INT16(out, (INT16)(v < 0.0 ? v - 0.5 : v + 0.5));
+		}
+
+		written++;
+		pos += step;
+	}
+
+	jitter->position = pos - (double)frames;
+	for (size_t c = 0; c < channels; c++)
+		jitter->last[c] = winpr_Data_Get_INT16(&data[((frames - 1) * channels + c) * 2]);
+	jitter->stats.corrected += (INT64)written - (INT64)frames;
+	return TRUE;
+}
+
+static INT32 jitter_drift(RDPSND_JITTER* jitter, double fill)
+{
+	const double error = fill - jitter->stats.target;
+	jitter->fillError += (error - jitter->fillError) / 8.0;
+
+	const double excess = jitter_abs(jitter->fillError) - RDPSND_JITTER_DEADBAND;
+	if (excess <= 0.0)
+		return 0;
+
+	const double ppm = MIN(excess * RDPSND_JITTER_PPM_PER_MS, RDPSND_JITTER_MAX_DRIFT_PPM);
+	if (jitter->fillError < 0.0)
+		return -(INT32)ppm;
+	return (INT32)ppm;
+}
+
+RDPSND_JITTER_ACTION rdpsnd_jitter_process(RDPSND_JITTER* jitter, const BYTE* data, size_t size,
+                                           UINT64 nowNS, wStream* out, UINT32* delay)
+{
+	WINPR_ASSERT(jitter);
+	WINPR_ASSERT(data || (size == 0));
+	WINPR_ASSERT(out);
+	WINPR_ASSERT(delay);
+
+	*delay = 0;
+	Stream_SetPosition(out, 0);
+
+	/* compressed data played by the device, nothing we can measure */
+	if (jitter->bytesPerSecond == 0)
+	{
+		if (!Stream_EnsureRemainingCapacity(out, size))
+			return RDPSND_JITTER_DROP;
+		Stream_Write(out, data, size);
+		Stream_SealLength(out);
+		return RDPSND_JITTER_PLAY;
+	}
+
+	const double duration = 1000.0 * (double)size / jitter->bytesPerSecond;
+	double fill = 0.0;
+	if (jitter->started)
+	{
+		if (jitter->playedUntilNS >= nowNS)
+			fill = (double)(jitter->playedUntilNS - nowNS) / 1000000.0;
+		else
+			jitter->stats.underruns++;
+	}
+	jitter->stats.buffered = (UINT32)fill;
+
+	const BOOL adaptive = (jitter->maxDelay > 0);
+	const double target = jitter->stats.target;
+	const double limit =
+	    adaptive ? (2.0 * target + duration) : (duration + jitter->deviceLatency);
+	if (jitter->started && (fill > limit))
+	{
+		jitter->stats.overruns++;
+		return RDPSND_JITTER_DROP;
+	}
+
+	UINT32 silence = 0;
+	INT32 drift = 0;
+	if (adaptive && (jitter->format.wFormatTag == WAVE_FORMAT_PCM))
+	{
+		if (!jitter->started || (fill <= 0.0))
+		{
+			silence = jitter->stats.target;
+			if (!jitter_write_silence(jitter, silence, out))
+				return RDPSND_JITTER_DROP;
+			jitter->fillError = 0.0;
+		}
+		else if (jitter->canResample)
+			drift = jitter_drift(jitter, fill);
+	}
+	jitter->stats.drift = drift;
+
+	const size_t start = Stream_GetPosition(out);
+	if (jitter->canResample && adaptive)
+	{
+		const double step = 1.0 + drift / 1000000.0;
+		if (!jitter_resample(jitter, data, size / jitter->frameSize, step, out))
+			return RDPSND_JITTER_DROP;
+	}
+	else
+	{
+		if (!Stream_EnsureRemainingCapacity(out, size))
+			return RDPSND_JITTER_DROP;
+		Stream_Write(out, data, size);
+	}
+	Stream_SealLength(out);
+
+	const double played =
+	    silence + 1000.0 * (double)(Stream_GetPosition(out) - start) / jitter->bytesPerSecond;
+	if (!jitter->started || (jitter->playedUntilNS < nowNS))
+		jitter->playedUntilNS = nowNS;
+	jitter->playedUntilNS += (UINT64)(played * 1000000.0);
+	jitter->started = TRUE;
+
+	*delay = (UINT32)(fill + silence + 0.5);
+	return RDPSND_JITTER_PLAY;
+}
+
+void rdpsnd_jitter_get_stats(const RDPSND_JITTER* jitter, RDPSND_JITTER_STATS* stats)
+{
+	WINPR_ASSERT(jitter);
+	WINPR_ASSERT(stats);
+
+	*stats = jitter->stats;
+}
@@ -0,0 +1,110 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Audio Output Virtual Channel - adaptive jitter buffer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_RDPSND_COMMON_JITTER_H
+#define FREERDP_CHANNEL_RDPSND_COMMON_JITTER_H
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+#include <freerdp/api.h>
+#include <freerdp/codec/audio.h>
+
+/** Lower bound of the adaptive playout delay in ms */
+#define RDPSND_JITTER_MIN_DELAY 20
+
+/** Default upper bound of the adaptive playout delay in ms */
+#define RDPSND_JITTER_DEFAULT_MAX_DELAY 200
+
+/** Maximum playback rate correction in parts per million */
+#define RDPSND_JITTER_MAX_DRIFT_PPM 5000
+
+typedef enum
+{
+	RDPSND_JITTER_PLAY,
+	RDPSND_JITTER_DROP
+} RDPSND_JITTER_ACTION;
+
+typedef struct
+{
+	UINT32 target;    /** current playout delay target in ms */
+	UINT32 jitter;    /** smoothed wave arrival jitter in ms */
+	UINT32 buffered;  /** audio queued at the device before the last wave in ms */
+	INT32 drift;      /** current playback rate correction in ppm, > 0 plays faster */
+	UINT64 underruns; /** number of times the device ran dry */
+	UINT64 overruns;  /** number of waves dropped because too much audio was queued */
+	UINT64 silence;   /** ms of silence inserted to refill the buffer */
+	INT64 corrected;  /** net frames inserted (> 0) or removed (< 0) by drift correction */
+} RDPSND_JITTER_STATS;
+
+typedef struct S_RDPSND_JITTER RDPSND_JITTER;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	FREERDP_LOCAL void rdpsnd_jitter_free(RDPSND_JITTER* jitter);
+
+	/** @brief Create a jitter buffer
+	 *
+	 *  @param maxDelay The upper bound of the playout delay in ms, \b 0 disables adaptive
+	 *  buffering and only keeps the overrun check
+	 */
+	WINPR_ATTR_MALLOC(rdpsnd_jitter_free, 1)
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL RDPSND_JITTER* rdpsnd_jitter_new(UINT32 maxDelay);
+
+	/** @brief Restart buffering for a newly opened device
+	 *
+	 *  @param format The format of the data passed to \b rdpsnd_jitter_process
+	 *  @param deviceLatency The latency the device was opened with in ms
+	 */
+	FREERDP_LOCAL void rdpsnd_jitter_reset(RDPSND_JITTER* jitter, const AUDIO_FORMAT* format,
+	                                       UINT32 deviceLatency);
+
+	/** @brief Account the arrival of a wave with server timestamp \b wTimeStamp */
+	FREERDP_LOCAL void rdpsnd_jitter_arrival(RDPSND_JITTER* jitter, UINT16 wTimeStamp,
+	                                         UINT64 arrivalNS);
+
+	/** @brief Prepare a decoded wave for playback
+	 *
+	 *  Refills the buffer with silence after an underrun and micro-resamples 16bit PCM
+	 *  to keep the amount of queued audio at the current target.
+	 *
+	 *  @param data The wave in the format given to \b rdpsnd_jitter_reset
+	 *  @param size The size of \b data in bytes
+	 *  @param nowNS The current time
+	 *  @param out Receives the data to play, replacing its content
+	 *  @param delay Receives the ms this wave waits in the queue before it is played
+	 *
+	 *  @return \b RDPSND_JITTER_DROP if the wave must be dropped
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL RDPSND_JITTER_ACTION rdpsnd_jitter_process(RDPSND_JITTER* jitter,
+	                                                         const BYTE* data, size_t size,
+	                                                         UINT64 nowNS, wStream* out,
+	                                                         UINT32* delay);
+
+	FREERDP_LOCAL void rdpsnd_jitter_get_stats(const RDPSND_JITTER* jitter,
+	                                           RDPSND_JITTER_STATS* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_CHANNEL_RDPSND_COMMON_JITTER_H */
@@ -0,0 +1,242 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/endian.h>
+#include <winpr/stream.h>
+
+#include "../rdpsnd_jitter.h"
+
+#define TEST_RATE 48000
+#define TEST_CHANNELS 2
+#define TEST_WAVE_MS 20
+#define TEST_WAVE_FRAMES (TEST_RATE * TEST_WAVE_MS / 1000)
+
+/* a triangle wave, max step between frames is TEST_SLOPE */
+#define TEST_PERIOD_FRAMES 200
+#define TEST_SLOPE 200
+
+typedef struct
+{
+	const char* name;
+	UINT32 maxDelay;
+	double speed;   /* server clock relative to the device clock, > 1 sends faster */
+	UINT32 jitter;  /* maximum additional network delay in ms */
+	size_t seconds; /* simulated duration */
+} test_scenario;
+
+typedef struct
+{
+	RDPSND_JITTER_STATS stats;
+	double avgDelay;
+	UINT32 maxBuffered;
+	INT32 maxStep;
+	size_t waves;
+} test_result;
+
+static UINT32 test_random(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return (*state >> 16) & 0x7fff;
+}
+
+static INT16 test_sample(size_t frame)
+{
+	const size_t pos = frame % TEST_PERIOD_FRAMES;
+	const INT32 half = TEST_PERIOD_FRAMES / 2;
+	const INT32 v = (pos < (size_t)half) ? (INT32)pos : TEST_PERIOD_FRAMES - (INT32)pos;
+	return (INT16)((v - half / 2) * TEST_SLOPE);
+}
+
+/* feed the jitter buffer like rdpsnd does with the fake backend, which plays everything
+ * immediately; the buffer models the device consumption from the clock passed in */
+static BOOL simulate(const test_scenario* scenario, test_result* result)
+{
+	BOOL rc = FALSE;
+	UINT32 seed = 42;
+	BYTE wave[TEST_WAVE_FRAMES * TEST_CHANNELS * 2] = { 0 };
+	const AUDIO_FORMAT format = { .wFormatTag = WAVE_FORMAT_PCM,
+		                          .nChannels = TEST_CHANNELS,
+		                          .nSamplesPerSec = TEST_RATE,
+		                          .nAvgBytesPerSec = TEST_RATE * TEST_CHANNELS * 2,
+		                          .nBlockAlign = TEST_CHANNELS * 2,
+		                          .wBitsPerSample = 16 };
+
+	RDPSND_JITTER* jitter = rdpsnd_jitter_new(scenario->maxDelay);
+	wStream* out = Stream_New(NULL, sizeof(wave));
+	if (!jitter || !out)
+		goto fail;
+
+	rdpsnd_jitter_reset(jitter, &format, 0);
+
+	const size_t count = scenario->seconds * 1000 / TEST_WAVE_MS;
+	const UINT64 sendPeriodNS = (UINT64)(TEST_WAVE_MS * 1000000.0 / scenario->speed);
+	UINT64 lastArrival = 0;
+	UINT64 totalDelay = 0;
+	INT16 previous = test_sample(0);
+	UINT64 silence = 0;
+
+	*result = (test_result){ 0 };
+	for (size_t x = 0; x < count; x++)
+	{
+		for (size_t f = 0; f < TEST_WAVE_FRAMES; f++)
+		{
+			const INT16 v = test_sample(x * TEST_WAVE_FRAMES + f);
+			for (size_t c = 0; c < TEST_CHANNELS; c++)
+				winpr_Data_Write_INT16(&wave[(f * TEST_CHANNELS + c) * 2], v);
+		}
+
+		/* TCP delivers in order, a delayed wave delays all following ones */
+		UINT64 arrival = x * sendPeriodNS;
+		if (scenario->jitter > 0)
+			arrival += 1000000ull * (test_random(&seed) % scenario->jitter);
+		arrival = MAX(arrival, lastArrival);
+		lastArrival = arrival;
+
+		rdpsnd_jitter_arrival(jitter, (UINT16)(x * TEST_WAVE_MS), arrival);
+
+		UINT32 delay = 0;
+		if (rdpsnd_jitter_process(jitter, wave, sizeof(wave), arrival, out, &delay) !=
+		    RDPSND_JITTER_PLAY)
+			continue;
+
+		rdpsnd_jitter_get_stats(jitter, &result->stats);
+		result->maxBuffered = MAX(result->maxBuffered, result->stats.buffered);
+		totalDelay += delay;
+		result->waves++;
+
+		/* silence refills break the waveform on purpose, check everything else */
+		const BYTE* data = Stream_Buffer(out);
+		const size_t frames = Stream_Length(out) / (TEST_CHANNELS * 2);
+		if ((frames == 0) || (result->stats.silence != silence))
+		{
+			silence = result->stats.silence;
+			if (frames > 0)
+				previous = winpr_Data_Get_INT16(&data[(frames - 1) * TEST_CHANNELS * 2]);
+			continue;
+		}
+		for (size_t f = 0; f < frames; f++)
+		{
+			const INT16 v = winpr_Data_Get_INT16(&data[f * TEST_CHANNELS * 2]);
+			result->maxStep = MAX(result->maxStep, abs(v - previous));
+			previous = v;
+		}
+	}
+
+	rdpsnd_jitter_get_stats(jitter, &result->stats);
+	if (result->waves > 0)
+		result->avgDelay = (double)totalDelay / (double)result->waves;
+
+	printf("%-12s: target %" PRIu32 "ms, jitter %" PRIu32 "ms, delay %.1fms, max buffered %" PRIu32
+	       "ms, drift %" PRId32 "ppm, corrected %" PRId64 " frames, underruns %" PRIu64
+	       ", overruns %" PRIu64 "\n",
+	       scenario->name, result->stats.target, result->stats.jitter, result->avgDelay,
+	       result->maxBuffered, result->stats.drift, result->stats.corrected,
+	       result->stats.underruns, result->stats.overruns);
+	rc = TRUE;
+
+fail:
+	Stream_Free(out, TRUE);
+	rdpsnd_jitter_free(jitter);
+	return rc;
+}
+
+static BOOL test_steady(void)
+{
+	const test_scenario scenario = { "steady", RDPSND_JITTER_DEFAULT_MAX_DELAY, 1.0, 0, 10 };
+	test_result result = { 0 };
+	if (!simulate(&scenario, &result))
+		return FALSE;
+
+	if ((result.stats.underruns != 0) || (result.stats.overruns != 0))
+		return FALSE;
+	if (result.stats.target != RDPSND_JITTER_MIN_DELAY)
+		return FALSE;
+	if (result.stats.corrected != 0)
+		return FALSE;
+	return result.maxStep <= TEST_SLOPE;
+}
+
+static BOOL test_jitter(void)
+{
+	const test_scenario scenario = { "jitter", RDPSND_JITTER_DEFAULT_MAX_DELAY, 1.0, 60, 60 };
+	test_result result = { 0 };
+	if (!simulate(&scenario, &result))
+		return FALSE;
+
+	/* the target follows the jitter and keeps underruns rare */
+	if ((result.stats.target <= RDPSND_JITTER_MIN_DELAY) ||
+	    (result.stats.target > RDPSND_JITTER_DEFAULT_MAX_DELAY))
+		return FALSE;
+	if (result.stats.underruns * 100 > result.waves)
+		return FALSE;
+	return result.stats.overruns == 0;
+}
+
+static BOOL test_drift(double speed)
+{
+	const test_scenario scenario = { (speed > 1.0) ? "drift fast" : "drift slow",
+		                             RDPSND_JITTER_DEFAULT_MAX_DELAY, speed, 0, 120 };
+	test_result result = { 0 };
+	if (!simulate(&scenario, &result))
+		return FALSE;
+
+	/* the clock difference is absorbed by resampling, without drops or refills */
+	if ((result.stats.overruns != 0) || (result.stats.underruns != 0))
+		return FALSE;
+	if (result.maxBuffered > result.stats.target + 2 * TEST_WAVE_MS)
+		return FALSE;
+
+	const INT64 expected = (INT64)((1.0 / speed - 1.0) * TEST_RATE * (double)scenario.seconds);
+	if ((expected < 0) != (result.stats.corrected < 0))
+		return FALSE;
+	if (llabs(result.stats.corrected - expected) > TEST_RATE / 10)
+		return FALSE;
+
+	/* interpolation must not add discontinuities at wave boundaries */
+	return result.maxStep <= TEST_SLOPE + 1;
+}
+
+static BOOL test_legacy(void)
+{
+	const test_scenario scenario = { "legacy", 0, 1.002, 0, 120 };
+	test_result result = { 0 };
+	if (!simulate(&scenario, &result))
+		return FALSE;
+
+	/* without adaptive buffering the faster server clock ends in drops */
+	return (result.stats.overruns > 0) && (result.stats.corrected == 0);
+}
+
+int TestRdpsndJitter(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_steady())
+		return -1;
+	if (!test_jitter())
+		return -1;
+	if (!test_drift(1.002))
+		return -1;
+	if (!test_drift(0.998))
+		return -1;
+	if (!test_legacy())
+		return -1;
+	return 0;
+}
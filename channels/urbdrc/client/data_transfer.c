@@ -29,6 +29,7 @@
 
 #include "urbdrc_types.h"
 #include "data_transfer.h"
+#include "isoch_pipeline.h"
 #include "msusb.h"
 
 static void usb_process_get_port_status(IUDEVICE* pdev, wStream* out)
@@ -107,7 +108,7 @@ static UINT urb_write_completion(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 
 	if (Stream_Capacity(out) < OutputBufferSize + 36)
 	{
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 		return ERROR_INVALID_PARAMETER;
 	}
 
@@ -116,7 +117,7 @@ static UINT urb_write_completion(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 	const UINT32 FunctionId = (OutputBufferSize != 0) ? URB_COMPLETION : URB_COMPLETION_NO_DATA;
 	if (!write_shared_message_header_with_functionid(out, InterfaceId, MessageId, FunctionId))
 	{
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 		return ERROR_OUTOFMEMORY;
 	}
 
@@ -125,7 +126,7 @@ static UINT urb_write_completion(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 
 	if (!write_urb_result_header(out, 8, usbd_status))
 	{
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 		return ERROR_OUTOFMEMORY;
 	}
 
@@ -136,7 +137,7 @@ static UINT urb_write_completion(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 	if (!noAck)
 		return stream_write_and_free(callback->plugin, callback->channel, out);
 	else
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 
 	return ERROR_SUCCESS;
 }
@@ -801,7 +802,7 @@ static void urb_bulk_transfer_cb(IUDEVICE* pdev, GENERIC_CHANNEL_CALLBACK* callb
 		urb_write_completion(pdev, callback, noAck, out, InterfaceId, MessageId, RequestId, status,
 		                     OutputBufferSize);
 	else
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 }
 
 static UINT urb_bulk_or_interrupt_transfer(IUDEVICE* pdev, GENERIC_CHANNEL_CALLBACK* callback,
@@ -857,7 +858,7 @@ static void urb_isoch_transfer_cb(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 		const UINT32 FunctionId = (OutputBufferSize == 0) ? URB_COMPLETION_NO_DATA : URB_COMPLETION;
 		if (!write_shared_message_header_with_functionid(out, InterfaceId, MessageId, FunctionId))
 		{
-			Stream_Free(out, TRUE);
+			Stream_Release(out);
 			return;
 		}
 
@@ -866,7 +867,7 @@ static void urb_isoch_transfer_cb(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 		if (!write_urb_result_header(out, WINPR_ASSERTING_INT_CAST(uint16_t, 20 + packetSize),
 		                             status))
 		{
-			Stream_Free(out, TRUE);
+			Stream_Release(out);
 			return;
 		}
 
@@ -891,6 +892,8 @@ static void urb_isoch_transfer_cb(WINPR_ATTR_UNUSED IUDEVICE* pdev,
 
 		stream_write_and_free(callback->plugin, callback->channel, out);
 	}
+	else
+		Stream_Release(out);
 }
 
 static UINT urb_isoch_transfer(IUDEVICE* pdev, GENERIC_CHANNEL_CALLBACK* callback, wStream* s,
@@ -938,9 +941,12 @@ static UINT urb_isoch_transfer(IUDEVICE* pdev, GENERIC_CHANNEL_CALLBACK* callbac
 			return ERROR_INVALID_DATA;
 	}
 
-	rc = pdev->isoch_transfer(
-	    pdev, callback, MessageId, RequestId, EndpointAddress, TransferFlags, StartFrame,
-	    ErrorCount, noAck, packetDescriptorData, NumberOfPackets, OutputBufferSize,
+	URBDRC_PLUGIN* urbdrc = (URBDRC_PLUGIN*)callback->plugin;
+	WINPR_ASSERT(urbdrc);
+
+	rc = urbdrc_isoch_transfer(
+	    urbdrc->isoch, pdev, callback, MessageId, RequestId, EndpointAddress, TransferFlags,
+	    StartFrame, ErrorCount, noAck, packetDescriptorData, NumberOfPackets, OutputBufferSize,
 	    (transferDir == USBD_TRANSFER_DIRECTION_OUT) ? Stream_Pointer(s) : NULL,
 	    urb_isoch_transfer_cb, 2000);
 
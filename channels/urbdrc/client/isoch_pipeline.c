@@ -0,0 +1,474 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RemoteFX USB Redirection
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/collections.h>
+
+#include <freerdp/types.h>
+
+#include "isoch_pipeline.h"
+
+/* The server keeps several isochronous URBs outstanding per endpoint. Up to depth of them are
+ * submitted to the device, the remaining ones wait in arrival order and are submitted as soon
+ * as a transfer completes, so the endpoint never idles between two URBs. Completions are held
+ * back until all earlier requests of the endpoint completed and are then written in one go. */
+
+#define ISOCH_MAX_DEPTH 64
+#define ISOCH_ENDPOINTS 32
+
+typedef struct
+{
+	IUDEVICE* idev;
+	GENERIC_CHANNEL_CALLBACK* callback;
+	t_isoch_transfer_cb cb;
+	UINT32 MessageId;
+	UINT32 RequestId;
+	UINT32 EndpointAddress;
+	UINT32 TransferFlags;
+	UINT32 StartFrame;
+	UINT32 ErrorCount;
+	BOOL NoAck;
+	UINT32 NumberOfPackets;
+	UINT32 BufferSize;
+	UINT32 Timeout;
+
+	/* packet descriptors followed by the OUT data of a queued request */
+	wStream* data;
+	BOOL hasBuffer;
+
+	/* arguments of the completion callback */
+	BOOL completed;
+	wStream* out;
+	UINT32 InterfaceId;
+	UINT32 CompletedPackets;
+	UINT32 status;
+	UINT32 CompletedStartFrame;
+	UINT32 CompletedErrorCount;
+	UINT32 OutputBufferSize;
+} ISOCH_REQUEST;
+
+typedef struct
+{
+	/* requests in arrival order, the first submitted of them are on the device */
+	wArrayList* requests;
+	size_t submitted;
+} ISOCH_ENDPOINT;
+
+typedef struct
+{
+	IUDEVICE* idev;
+	UINT32 channelId;
+	ISOCH_ENDPOINT endpoints[ISOCH_ENDPOINTS];
+} ISOCH_DEVICE;
+
+struct s_urbdrc_isoch
+{
+	CRITICAL_SECTION lock;
+	wStreamPool* pool;
+	size_t depth;
+	wArrayList* devices;
+};
+
+typedef struct
+{
+	ISOCH_REQUEST* done[ISOCH_MAX_DEPTH];
+	size_t count;
+} ISOCH_BATCH;
+
+static void isoch_completed(IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK* callback, wStream* out,
+                            UINT32 InterfaceId, BOOL noAck, UINT32 MessageId, UINT32 RequestId,
+                            UINT32 NumberOfPackets, UINT32 status, UINT32 StartFrame,
+                            UINT32 ErrorCount, UINT32 OutputBufferSize);
+
+static void isoch_request_free(ISOCH_REQUEST* request)
+{
+	if (!request)
+		return;
+
+	if (request->data)
+		Stream_Release(request->data);
+	if (request->out)
+		Stream_Release(request->out);
+	free(request);
+}
+
+static void isoch_device_free(void* obj)
+{
+	ISOCH_DEVICE* device = obj;
+	if (!device)
+		return;
+
+	for (size_t x = 0; x < ARRAYSIZE(device->endpoints); x++)
+	{
+		wArrayList* requests = device->endpoints[x].requests;
+		if (!requests)
+			continue;
+
+		for (size_t y = 0; y < ArrayList_Count(requests); y++)
+			isoch_request_free(ArrayList_GetItem(requests, y));
+		ArrayList_Free(requests);
+	}
+	free(device);
+}
+
+static ISOCH_DEVICE* isoch_device_find(URBDRC_ISOCH* isoch, const IUDEVICE* idev)
+{
+	for (size_t x = 0; x < ArrayList_Count(isoch->devices); x++)
+	{
+		ISOCH_DEVICE* device = ArrayList_GetItem(isoch->devices, x);
+		if (device->idev == idev)
+			return device;
+	}
+	return NULL;
+}
+
+static ISOCH_ENDPOINT* isoch_endpoint_get(URBDRC_ISOCH* isoch, IUDEVICE* idev,
+                                          UINT32 EndpointAddress)
+{
+	ISOCH_DEVICE* device = isoch_device_find(isoch, idev);
+	if (!device)
+	{
+		device = calloc(1, sizeof(ISOCH_DEVICE));
+		if (!device)
+			return NULL;
+
+		device->idev = idev;
+		device->channelId = idev->get_channelID(idev);
+		if (!ArrayList_Append(isoch->devices, device))
+		{
+			isoch_device_free(device);
+			return NULL;
+		}
+	}
+
+	const size_t index = (EndpointAddress & 0x0F) | ((EndpointAddress & 0x80) ? 0x10 : 0x00);
+	ISOCH_ENDPOINT* endpoint = &device->endpoints[index];
+	if (!endpoint->requests)
+	{
+		endpoint->requests = ArrayList_New(FALSE);
+		if (!endpoint->requests)
+			return NULL;
+	}
+	return endpoint;
+}
+
+static BOOL isoch_submit(ISOCH_REQUEST* request, const BYTE* packetDescriptorData,
+                         const BYTE* Buffer)
+{
+	IUDEVICE* idev = request->idev;
+	const int rc = idev->isoch_transfer(
+	    idev, request->callback, request->MessageId, request->RequestId, request->EndpointAddress,
+	    request->TransferFlags, request->StartFrame, request->ErrorCount, request->NoAck,
+	    packetDescriptorData, request->NumberOfPackets, request->BufferSize, Buffer,
+	    isoch_completed, request->Timeout);
+	return rc >= 0;
+}
+
+static BOOL isoch_submit_queued(ISOCH_REQUEST* request)
+{
+	const BYTE* packetDescriptorData = Stream_Buffer(request->data);
+	const BYTE* Buffer = NULL;
+	if (request->hasBuffer)
+		Buffer = &packetDescriptorData[12ull * request->NumberOfPackets];
+	return isoch_submit(request, packetDescriptorData, Buffer);
+}
+
+/* hands out completions in order and refills the pipeline, called with the lock held */
+static void isoch_endpoint_process(URBDRC_ISOCH* isoch, ISOCH_ENDPOINT* endpoint,
+                                   ISOCH_BATCH* batch)
+{
+	while (TRUE)
+	{
+		while (ArrayList_Count(endpoint->requests) > 0)
+		{
+			ISOCH_REQUEST* request = ArrayList_GetItem(endpoint->requests, 0);
+			if (!request->completed)
+				break;
+
+			ArrayList_RemoveAt(endpoint->requests, 0);
+			WINPR_ASSERT(endpoint->submitted > 0);
+			endpoint->submitted--;
+
+			/* submission failed, there is nothing to report */
+			if (!request->out)
+				isoch_request_free(request);
+			else
+			{
+				WINPR_ASSERT(batch->count < ARRAYSIZE(batch->done));
+				batch->done[batch->count++] = request;
+			}
+		}
+
+		const size_t count = ArrayList_Count(endpoint->requests);
+		if ((endpoint->submitted >= isoch->depth) || (endpoint->submitted >= count))
+			return;
+
+		ISOCH_REQUEST* request = ArrayList_GetItem(endpoint->requests, endpoint->submitted++);
+		if (!isoch_submit_queued(request))
+			request->completed = TRUE;
+	}
+}
+
+static void isoch_batch_flush(ISOCH_BATCH* batch)
+{
+	for (size_t x = 0; x < batch->count; x++)
+	{
+		ISOCH_REQUEST* request = batch->done[x];
+		wStream* out = request->out;
+		request->out = NULL;
+
+		request->cb(request->idev, request->callback, out, request->InterfaceId, request->NoAck,
+		            request->MessageId, request->RequestId, request->CompletedPackets,
+		            request->status, request->CompletedStartFrame, request->CompletedErrorCount,
+		            request->OutputBufferSize);
+		isoch_request_free(request);
+	}
+	batch->count = 0;
+}
+
+static ISOCH_REQUEST* isoch_request_find(ISOCH_DEVICE* device, UINT32 RequestId,
+                                         ISOCH_ENDPOINT** pendpoint)
+{
+	for (size_t x = 0; x < ARRAYSIZE(device->endpoints); x++)
+	{
+		ISOCH_ENDPOINT* endpoint = &device->endpoints[x];
+		if (!endpoint->requests)
+			continue;
+
+		for (size_t y = 0; y < endpoint->submitted; y++)
+		{
+			ISOCH_REQUEST* request = ArrayList_GetItem(endpoint->requests, y);
+			if (!request->completed && (request->RequestId == RequestId))
+			{
+				*pendpoint = endpoint;
+				return request;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void isoch_completed(IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK* callback, wStream* out,
+                            UINT32 InterfaceId, WINPR_ATTR_UNUSED BOOL noAck,
+                            WINPR_ATTR_UNUSED UINT32 MessageId, UINT32 RequestId,
+                            UINT32 NumberOfPackets, UINT32 status, UINT32 StartFrame,
+                            UINT32 ErrorCount, UINT32 OutputBufferSize)
+{
+	WINPR_ASSERT(idev);
+	WINPR_ASSERT(callback);
+
+	if (idev->isChannelClosed(idev))
+	{
+		if (out)
+			Stream_Release(out);
+		return;
+	}
+
+	URBDRC_PLUGIN* urbdrc = (URBDRC_PLUGIN*)callback->plugin;
+	WINPR_ASSERT(urbdrc);
+	URBDRC_ISOCH* isoch = urbdrc->isoch;
+	WINPR_ASSERT(isoch);
+
+	ISOCH_BATCH batch = { 0 };
+	ISOCH_ENDPOINT* endpoint = NULL;
+	ISOCH_REQUEST* request = NULL;
+
+	EnterCriticalSection(&isoch->lock);
+	ISOCH_DEVICE* device = isoch_device_find(isoch, idev);
+	if (device)
+		request = isoch_request_find(device, RequestId, &endpoint);
+
+	if (request)
+	{
+		request->completed = TRUE;
+		request->out = out;
+		request->InterfaceId = InterfaceId;
+		request->CompletedPackets = NumberOfPackets;
+		request->status = status;
+		request->CompletedStartFrame = StartFrame;
+		request->CompletedErrorCount = ErrorCount;
+		request->OutputBufferSize = OutputBufferSize;
+		isoch_endpoint_process(isoch, endpoint, &batch);
+	}
+	LeaveCriticalSection(&isoch->lock);
+
+	if (!request && out)
+		Stream_Release(out);
+	isoch_batch_flush(&batch);
+}
+
+static ISOCH_REQUEST* isoch_request_new(IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK* callback,
+                                        UINT32 MessageId, UINT32 RequestId,
+                                        UINT32 EndpointAddress, UINT32 TransferFlags,
+                                        UINT32 StartFrame, UINT32 ErrorCount, BOOL NoAck,
+                                        UINT32 NumberOfPackets, UINT32 BufferSize,
+                                        t_isoch_transfer_cb cb, UINT32 Timeout)
+{
+	ISOCH_REQUEST* request = calloc(1, sizeof(ISOCH_REQUEST));
+	if (!request)
+		return NULL;
+
+	request->idev = idev;
+	request->callback = callback;
+	request->cb = cb;
+	request->MessageId = MessageId;
+	request->RequestId = RequestId;
+	request->EndpointAddress = EndpointAddress;
+	request->TransferFlags = TransferFlags;
+	request->StartFrame = StartFrame;
+	request->ErrorCount = ErrorCount;
+	request->NoAck = NoAck;
+	request->NumberOfPackets = NumberOfPackets;
+	request->BufferSize = BufferSize;
+	request->Timeout = Timeout;
+	return request;
+}
+
+static BOOL isoch_request_copy(URBDRC_ISOCH* isoch, ISOCH_REQUEST* request,
+                               const BYTE* packetDescriptorData, const BYTE* Buffer)
+{
+	const size_t descriptorSize = 12ull * request->NumberOfPackets;
+	const size_t size = descriptorSize + (Buffer ? request->BufferSize : 0);
+
+	request->data = StreamPool_Take(isoch->pool, MAX(1, size));
+	if (!request->data)
+		return FALSE;
+
+	if (packetDescriptorData)
+		Stream_Write(request->data, packetDescriptorData, descriptorSize);
+	else
+		Stream_Zero(request->data, descriptorSize);
+
+	if (Buffer)
+	{
+		Stream_Write(request->data, Buffer, request->BufferSize);
+		request->hasBuffer = TRUE;
+	}
+	return TRUE;
+}
+
+int urbdrc_isoch_transfer(URBDRC_ISOCH* isoch, IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK* callback,
+                          UINT32 MessageId, UINT32 RequestId, UINT32 EndpointAddress,
+                          UINT32 TransferFlags, UINT32 StartFrame, UINT32 ErrorCount, BOOL NoAck,
+                          const BYTE* packetDescriptorData, UINT32 NumberOfPackets,
+                          UINT32 BufferSize, const BYTE* Buffer, t_isoch_transfer_cb cb,
+                          UINT32 Timeout)
+{
+	int rc = -1;
+	ISOCH_BATCH batch = { 0 };
+
+	WINPR_ASSERT(isoch);
+	WINPR_ASSERT(idev);
+	WINPR_ASSERT(cb);
+
+	ISOCH_REQUEST* request =
+	    isoch_request_new(idev, callback, MessageId, RequestId, EndpointAddress, TransferFlags,
+	                      StartFrame, ErrorCount, NoAck, NumberOfPackets, BufferSize, cb, Timeout);
+	if (!request)
+		return -1;
+
+	EnterCriticalSection(&isoch->lock);
+	ISOCH_ENDPOINT* endpoint = isoch_endpoint_get(isoch, idev, EndpointAddress);
+	if (!endpoint)
+		goto fail;
+
+	if ((endpoint->submitted < isoch->depth) &&
+	    (endpoint->submitted == ArrayList_Count(endpoint->requests)))
+	{
+		/* the pipeline has room, the request data is still valid */
+		if (!ArrayList_Append(endpoint->requests, request))
+			goto fail;
+		endpoint->submitted++;
+
+		if (!isoch_submit(request, packetDescriptorData, Buffer))
+		{
+			ArrayList_Remove(endpoint->requests, request);
+			endpoint->submitted--;
+			goto fail;
+		}
+	}
+	else
+	{
+		if (!isoch_request_copy(isoch, request, packetDescriptorData, Buffer))
+			goto fail;
+		if (!ArrayList_Append(endpoint->requests, request))
+			goto fail;
+	}
+
+	request = NULL;
+	isoch_endpoint_process(isoch, endpoint, &batch);
+	rc = 0;
+
+fail:
+	LeaveCriticalSection(&isoch->lock);
+	isoch_request_free(request);
+	isoch_batch_flush(&batch);
+	return rc;
+}
+
+void urbdrc_isoch_remove(URBDRC_ISOCH* isoch, UINT32 channelId)
+{
+	if (!isoch)
+		return;
+
+	EnterCriticalSection(&isoch->lock);
+	for (size_t x = 0; x < ArrayList_Count(isoch->devices);)
+	{
+		ISOCH_DEVICE* device = ArrayList_GetItem(isoch->devices, x);
+		if (device->channelId == channelId)
+			ArrayList_RemoveAt(isoch->devices, x);
+		else
+			x++;
+	}
+	LeaveCriticalSection(&isoch->lock);
+}
+
+void urbdrc_isoch_free(URBDRC_ISOCH* isoch)
+{
+	if (!isoch)
+		return;
+
+	ArrayList_Free(isoch->devices);
+	DeleteCriticalSection(&isoch->lock);
+	free(isoch);
+}
+
+URBDRC_ISOCH* urbdrc_isoch_new(wStreamPool* pool, size_t depth)
+{
+	WINPR_ASSERT(pool);
+
+	URBDRC_ISOCH* isoch = calloc(1, sizeof(URBDRC_ISOCH));
+	if (!isoch)
+		return NULL;
+
+	InitializeCriticalSection(&isoch->lock);
+	isoch->pool = pool;
+	isoch->depth = MAX(1, MIN(depth, ISOCH_MAX_DEPTH));
+	isoch->devices = ArrayList_New(FALSE);
+	if (!isoch->devices)
+		goto fail;
+	ArrayList_Object(isoch->devices)->fnObjectFree = isoch_device_free;
+	return isoch;
+
+fail:
+	urbdrc_isoch_free(isoch);
+	return NULL;
+}
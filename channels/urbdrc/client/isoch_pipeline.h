@@ -0,0 +1,52 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RemoteFX USB Redirection
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_URBDRC_CLIENT_ISOCH_PIPELINE_H
+#define FREERDP_CHANNEL_URBDRC_CLIENT_ISOCH_PIPELINE_H
+
+#include <winpr/stream.h>
+
+#include <freerdp/api.h>
+
+#include "urbdrc_main.h"
+
+/* isochronous transfers submitted to the device per endpoint */
+#define URBDRC_ISOCH_DEFAULT_DEPTH 8
+
+/* Requests beyond the depth are queued, with OUT data copied to buffers taken from pool.
+ * Completions are passed on in the order the requests were received per endpoint. */
+FREERDP_LOCAL void urbdrc_isoch_free(URBDRC_ISOCH* isoch);
+
+WINPR_ATTR_MALLOC(urbdrc_isoch_free, 1)
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL URBDRC_ISOCH* urbdrc_isoch_new(wStreamPool* pool, size_t depth);
+
+/* drops the requests of the device on channelId, completions arriving later are discarded */
+FREERDP_LOCAL void urbdrc_isoch_remove(URBDRC_ISOCH* isoch, UINT32 channelId);
+
+/* same arguments as IUDEVICE::isoch_transfer, cb is called for every request that was submitted */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL int urbdrc_isoch_transfer(URBDRC_ISOCH* isoch, IUDEVICE* idev,
+                                        GENERIC_CHANNEL_CALLBACK* callback, UINT32 MessageId,
+                                        UINT32 RequestId, UINT32 EndpointAddress,
+                                        UINT32 TransferFlags, UINT32 StartFrame, UINT32 ErrorCount,
+                                        BOOL NoAck, const BYTE* packetDescriptorData,
+                                        UINT32 NumberOfPackets, UINT32 BufferSize,
+                                        const BYTE* Buffer, t_isoch_transfer_cb cb,
+                                        UINT32 Timeout);
+
+#endif /* FREERDP_CHANNEL_URBDRC_CLIENT_ISOCH_PIPELINE_H */
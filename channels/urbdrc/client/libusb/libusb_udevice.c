@@ -218,7 +218,7 @@ static ASYNC_TRANSFER_USER_DATA* async_transfer_user_data_new(IUDEVICE* idev, UI
 	if (!user_data)
 		return NULL;
 
-	user_data->data = Stream_New(NULL, offset + BufferSize + packetSize);
+	user_data->data = StreamPool_Take(pdev->urbdrc->pool, offset + BufferSize + packetSize);
 
 	if (!user_data->data)
 	{
@@ -247,7 +247,8 @@ static void async_transfer_user_data_free(ASYNC_TRANSFER_USER_DATA* user_data)
 {
 	if (user_data)
 	{
-		Stream_Free(user_data->data, TRUE);
+		if (user_data->data)
+			Stream_Release(user_data->data);
 		free(user_data);
 	}
 }
@@ -258,72 +259,70 @@ static void LIBUSB_CALL func_iso_callback(struct libusb_transfer* transfer)
 	const UINT32 streamID = stream_id_from_buffer(transfer);
 	wArrayList* list = user_data->queue;
 
-	ArrayList_Lock(list);
-	switch (transfer->status)
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
 	{
-		case LIBUSB_TRANSFER_COMPLETED:
-		{
-			UINT32 index = 0;
-			BYTE* dataStart = Stream_Pointer(user_data->data);
-			Stream_SetPosition(user_data->data,
-			                   40); /* TS_URB_ISOCH_TRANSFER_RESULT IsoPacket offset */
+		UINT32 index = 0;
+		BYTE* dataStart = Stream_Pointer(user_data->data);
+		Stream_SetPosition(user_data->data, 40); /* TS_URB_ISOCH_TRANSFER_RESULT IsoPacket offset */
 
-			for (uint32_t i = 0; i < WINPR_ASSERTING_INT_CAST(uint32_t, transfer->num_iso_packets);
-			     i++)
-			{
-				const UINT32 act_len = transfer->iso_packet_desc[i].actual_length;
-				Stream_Write_UINT32(user_data->data, index);
-				Stream_Write_UINT32(user_data->data, act_len);
-				Stream_Write_UINT32(user_data->data, transfer->iso_packet_desc[i].status);
-
-				if (transfer->iso_packet_desc[i].status != USBD_STATUS_SUCCESS)
-					user_data->ErrorCount++;
-				else
-				{
-					const unsigned char* packetBuffer =
-					    libusb_get_iso_packet_buffer_simple(transfer, i);
-					BYTE* data = dataStart + index;
-
-					if (data != packetBuffer)
-						memmove(data, packetBuffer, act_len);
-
-					index += act_len;
-				}
-			}
-		}
-			/* fallthrough */
-			WINPR_FALLTHROUGH
-		case LIBUSB_TRANSFER_CANCELLED:
-			/* fallthrough */
-			WINPR_FALLTHROUGH
-		case LIBUSB_TRANSFER_TIMED_OUT:
-			/* fallthrough */
-			WINPR_FALLTHROUGH
-		case LIBUSB_TRANSFER_ERROR:
+		for (uint32_t i = 0; i < WINPR_ASSERTING_INT_CAST(uint32_t, transfer->num_iso_packets); i++)
 		{
-			const UINT32 InterfaceId =
-			    ((STREAM_ID_PROXY << 30) | user_data->idev->get_ReqCompletion(user_data->idev));
+			const UINT32 act_len = transfer->iso_packet_desc[i].actual_length;
+			Stream_Write_UINT32(user_data->data, index);
+			Stream_Write_UINT32(user_data->data, act_len);
+			Stream_Write_UINT32(user_data->data, transfer->iso_packet_desc[i].status);
 
-			if (list_contains(list, streamID))
+			if (transfer->iso_packet_desc[i].status != USBD_STATUS_SUCCESS)
+				user_data->ErrorCount++;
+			else
 			{
-				if (!user_data->noack)
-				{
-					const UINT32 RequestID = streamID & INTERFACE_ID_MASK;
-					user_data->cb(user_data->idev, user_data->callback, user_data->data,
-					              InterfaceId, user_data->noack, user_data->MessageId, RequestID,
-					              WINPR_ASSERTING_INT_CAST(uint32_t, transfer->num_iso_packets),
-					              transfer->status, user_data->StartFrame, user_data->ErrorCount,
-					              user_data->OutputBufferSize);
-					user_data->data = NULL;
-				}
-				ArrayList_Remove(list, transfer);
+				const unsigned char* packetBuffer =
+				    libusb_get_iso_packet_buffer_simple(transfer, i);
+				BYTE* data = dataStart + index;
+
+				if (data != packetBuffer)
+					memmove(data, packetBuffer, act_len);
+
+				index += act_len;
 			}
 		}
-		break;
-		default:
-			break;
 	}
+
+	/* Every submitted transfer is reported, also with noack, so the isochronous pipeline can
+	 * submit the next one. The callback is invoked without holding the list lock as it may
+	 * submit further transfers, callbackLock lets a closing channel wait for it instead. */
+	IUDEVICE* idev = user_data->idev;
+	UDEVICE* pdev = (UDEVICE*)idev;
+	EnterCriticalSection(&pdev->callbackLock);
+	ArrayList_Lock(list);
+	if (!list_contains(list, streamID))
+	{
+		ArrayList_Unlock(list);
+		LeaveCriticalSection(&pdev->callbackLock);
+		return;
+	}
+
+	GENERIC_CHANNEL_CALLBACK* callback = user_data->callback;
+	t_isoch_transfer_cb cb = user_data->cb;
+	wStream* data = user_data->data;
+	const BOOL noack = user_data->noack;
+	const UINT32 MessageId = user_data->MessageId;
+	const UINT32 StartFrame = user_data->StartFrame;
+	const UINT32 ErrorCount = user_data->ErrorCount;
+	const UINT32 OutputBufferSize = user_data->OutputBufferSize;
+	const UINT32 NumberOfPackets = WINPR_ASSERTING_INT_CAST(uint32_t, transfer->num_iso_packets);
+	const UINT32 status = WINPR_ASSERTING_INT_CAST(uint32_t, transfer->status);
+
+	const UINT32 InterfaceId = ((STREAM_ID_PROXY << 30) | idev->get_ReqCompletion(idev));
+	const UINT32 RequestID = streamID & INTERFACE_ID_MASK;
+
+	user_data->data = NULL;
+	ArrayList_Remove(list, transfer);
 	ArrayList_Unlock(list);
+
+	cb(idev, callback, data, InterfaceId, noack, MessageId, RequestID, NumberOfPackets, status,
+	   StartFrame, ErrorCount, OutputBufferSize);
+	LeaveCriticalSection(&pdev->callbackLock);
 }
 
 static const LIBUSB_ENDPOINT_DESCEIPTOR* func_get_ep_desc(LIBUSB_CONFIG_DESCRIPTOR* LibusbConfig,
@@ -1169,6 +1168,11 @@ static void libusb_udev_mark_channel_closed(IUDEVICE* idev)
 
 		pdev->status |= URBDRC_DEVICE_CHANNEL_CLOSED;
 		pdev->iface.cancel_all_transfer_request(&pdev->iface);
+
+		/* the channel callback is freed next, wait for a completion still using it */
+		EnterCriticalSection(&pdev->callbackLock);
+		LeaveCriticalSection(&pdev->callbackLock);
+
 		if (!urbdrc->udevman->unregister_udevice(urbdrc->udevman, busNr, devNr))
 		{
 			WLog_Print(pdev->urbdrc->log, WLOG_WARN, "unregister_udevice failed for %d, %d", busNr,
@@ -1322,7 +1326,10 @@ static int libusb_udev_isoch_transfer(IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK*
 	}
 	rc = libusb_submit_transfer(iso_transfer);
 	if (log_libusb_result(urbdrc->log, WLOG_ERROR, "libusb_submit_transfer", rc))
+	{
+		ArrayList_Remove(pdev->request_queue, iso_transfer);
 		return -1;
+	}
 	return rc;
 }
 
@@ -1575,6 +1582,7 @@ static void udev_free(IUDEVICE* idev)
 	if (!udev->iface.attach_kernel_driver(idev))
 		WLog_Print(udev->urbdrc->log, WLOG_WARN, "attach_kernel_driver failed for device");
 	ArrayList_Free(udev->request_queue);
+	DeleteCriticalSection(&udev->callbackLock);
 	/* free the config descriptor that send from windows */
 	msusb_msconfig_free(udev->MsConfig);
 	libusb_unref_device(udev->libusb_dev);
@@ -1751,6 +1759,11 @@ static IUDEVICE* udev_init(URBDRC_PLUGIN* urbdrc, libusb_context* context, LIBUS
 		return NULL;
 
 	pdev->urbdrc = urbdrc;
+	if (!InitializeCriticalSectionAndSpinCount(&pdev->callbackLock, 4000))
+	{
+		free(pdev);
+		return NULL;
+	}
 	udev_load_interface(pdev);
 
 	if (device)
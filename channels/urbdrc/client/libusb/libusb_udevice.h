@@ -63,6 +63,8 @@ typedef struct
 	LIBUSB_CONFIG_DESCRIPTOR* LibusbConfig;
 
 	wArrayList* request_queue;
+	/* held while an isochronous completion is passed on, closing the channel waits for it */
+	CRITICAL_SECTION callbackLock;
 
 	URBDRC_PLUGIN* urbdrc;
 } UDEVICE;
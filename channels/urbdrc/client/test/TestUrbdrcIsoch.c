@@ -0,0 +1,386 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
+
+#include <freerdp/types.h>
+
+#include "../isoch_pipeline.h"
+
+#define TEST_REQUESTS 64
+#define TEST_PACKETS 8
+#define TEST_PACKET_SIZE 192
+#define TEST_MICROFRAME_NS 125000ull
+#define TEST_LATENCY_NS 1000000ull
+#define TEST_ENDPOINT 0x01
+
+/* A software isochronous OUT endpoint. Transfers are scheduled back to back, one packet per
+ * microframe, but a transfer submitted while the endpoint is idle only starts after the
+ * scheduling latency of the host controller. */
+typedef struct
+{
+	IUDEVICE iface;
+	CRITICAL_SECTION lock;
+	wStreamPool* pool;
+	wMessageQueue* queue;
+	HANDLE thread;
+	UINT64 busyUntil;
+	size_t inflight;
+	size_t maxInflight;
+	size_t badData;
+} test_device;
+
+typedef struct
+{
+	wStream* out;
+	GENERIC_CHANNEL_CALLBACK* callback;
+	t_isoch_transfer_cb cb;
+	UINT32 MessageId;
+	UINT32 RequestId;
+	UINT32 NumberOfPackets;
+	UINT32 StartFrame;
+	UINT32 BufferSize;
+	UINT64 due;
+} test_transfer;
+
+typedef struct
+{
+	HANDLE done;
+	UINT32 expected;
+	size_t count;
+	size_t outOfOrder;
+} test_server;
+
+static test_server server = { 0 };
+
+static int test_isoch_transfer(IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK* callback,
+                               UINT32 MessageId, UINT32 RequestId,
+                               WINPR_ATTR_UNUSED UINT32 EndpointAddress,
+                               WINPR_ATTR_UNUSED UINT32 TransferFlags, UINT32 StartFrame,
+                               WINPR_ATTR_UNUSED UINT32 ErrorCount, WINPR_ATTR_UNUSED BOOL NoAck,
+                               WINPR_ATTR_UNUSED const BYTE* packetDescriptorData,
+                               UINT32 NumberOfPackets, UINT32 BufferSize, const BYTE* Buffer,
+                               t_isoch_transfer_cb cb, WINPR_ATTR_UNUSED UINT32 Timeout)
+{
+	test_device* dev = (test_device*)idev;
+
+	/* the OUT data must still be valid, also for requests that had to wait */
+	for (UINT32 x = 0; x < BufferSize; x++)
+	{
+		if (Buffer[x] != (BYTE)(RequestId + x))
+		{
+			dev->badData++;
+			break;
+		}
+	}
+
+	test_transfer* transfer = calloc(1, sizeof(test_transfer));
+	if (!transfer)
+		return -1;
+
+	transfer->out = StreamPool_Take(dev->pool, 48ull + 12ull * NumberOfPackets);
+	if (!transfer->out)
+	{
+		free(transfer);
+		return -1;
+	}
+	transfer->callback = callback;
+	transfer->cb = cb;
+	transfer->MessageId = MessageId;
+	transfer->RequestId = RequestId;
+	transfer->NumberOfPackets = NumberOfPackets;
+	transfer->StartFrame = StartFrame;
+	transfer->BufferSize = BufferSize;
+
+	EnterCriticalSection(&dev->lock);
+	const UINT64 now = winpr_GetTickCount64NS();
+	const UINT64 start = MAX(now + TEST_LATENCY_NS, dev->busyUntil);
+	transfer->due = start + NumberOfPackets * TEST_MICROFRAME_NS;
+	dev->busyUntil = transfer->due;
+	dev->inflight++;
+	dev->maxInflight = MAX(dev->maxInflight, dev->inflight);
+	LeaveCriticalSection(&dev->lock);
+
+	if (!MessageQueue_Post(dev->queue, NULL, 0, transfer, NULL))
+	{
+		Stream_Release(transfer->out);
+		free(transfer);
+		return -1;
+	}
+	return 0;
+}
+
+static int test_is_channel_closed(WINPR_ATTR_UNUSED IUDEVICE* idev)
+{
+	return 0;
+}
+
+static UINT32 test_get_channel_id(WINPR_ATTR_UNUSED IUDEVICE* idev)
+{
+	return 7;
+}
+
+/* completes transfers in the order they were scheduled, like the libusb event thread */
+static DWORD WINAPI test_device_thread(LPVOID arg)
+{
+	test_device* dev = arg;
+
+	while (MessageQueue_Wait(dev->queue))
+	{
+		wMessage message = { 0 };
+		if (!MessageQueue_Peek(dev->queue, &message, TRUE) || (message.id == WMQ_QUIT))
+			break;
+
+		test_transfer* transfer = message.wParam;
+		const UINT64 now = winpr_GetTickCount64NS();
+		if (transfer->due > now)
+			USleep((DWORD)((transfer->due - now) / 1000));
+
+		EnterCriticalSection(&dev->lock);
+		dev->inflight--;
+		LeaveCriticalSection(&dev->lock);
+
+		transfer->cb(&dev->iface, transfer->callback, transfer->out, 0, FALSE,
+		             transfer->MessageId, transfer->RequestId, transfer->NumberOfPackets, 0,
+		             transfer->StartFrame, 0, 0);
+		free(transfer);
+	}
+	return 0;
+}
+
+static void test_message_free(void* obj)
+{
+	wMessage* msg = obj;
+	if (msg && (msg->id == 0))
+	{
+		test_transfer* transfer = msg->wParam;
+		Stream_Release(transfer->out);
+		free(transfer);
+	}
+}
+
+/* what the URB_COMPLETION writer sees */
+static void test_completed(WINPR_ATTR_UNUSED IUDEVICE* idev,
+                           WINPR_ATTR_UNUSED GENERIC_CHANNEL_CALLBACK* callback, wStream* out,
+                           WINPR_ATTR_UNUSED UINT32 InterfaceId, WINPR_ATTR_UNUSED BOOL noAck,
+                           WINPR_ATTR_UNUSED UINT32 MessageId, UINT32 RequestId,
+                           WINPR_ATTR_UNUSED UINT32 NumberOfPackets,
+                           WINPR_ATTR_UNUSED UINT32 status, WINPR_ATTR_UNUSED UINT32 StartFrame,
+                           WINPR_ATTR_UNUSED UINT32 ErrorCount,
+                           WINPR_ATTR_UNUSED UINT32 OutputBufferSize)
+{
+	if (RequestId != server.expected)
+		server.outOfOrder++;
+	server.expected = RequestId + 1;
+	server.count++;
+	Stream_Release(out);
+
+	if (server.count == TEST_REQUESTS)
+		(void)SetEvent(server.done);
+}
+
+static BOOL test_device_init(test_device* dev, wStreamPool* pool)
+{
+	dev->iface.isoch_transfer = test_isoch_transfer;
+	dev->iface.isChannelClosed = test_is_channel_closed;
+	dev->iface.get_channelID = test_get_channel_id;
+	dev->pool = pool;
+	InitializeCriticalSection(&dev->lock);
+
+	dev->queue = MessageQueue_New(NULL);
+	if (!dev->queue)
+		return FALSE;
+	MessageQueue_Object(dev->queue)->fnObjectFree = test_message_free;
+
+	dev->thread = CreateThread(NULL, 0, test_device_thread, dev, 0, NULL);
+	return dev->thread != NULL;
+}
+
+static void test_device_uninit(test_device* dev)
+{
+	if (!dev->pool)
+		return;
+
+	if (dev->thread)
+	{
+		(void)MessageQueue_PostQuit(dev->queue, 0);
+		(void)WaitForSingleObject(dev->thread, INFINITE);
+		(void)CloseHandle(dev->thread);
+	}
+	MessageQueue_Free(dev->queue);
+	DeleteCriticalSection(&dev->lock);
+}
+
+/* the server sends all URBs at once, as it does to keep an audio stream going */
+static BOOL test_stream(wStreamPool* pool, size_t depth, UINT64* duration)
+{
+	BOOL rc = FALSE;
+	test_device dev = { 0 };
+	URBDRC_PLUGIN urbdrc = { 0 };
+	GENERIC_CHANNEL_CALLBACK callback = { 0 };
+	BYTE buffer[TEST_PACKETS * TEST_PACKET_SIZE] = { 0 };
+
+	callback.plugin = &urbdrc.iface;
+	urbdrc.isoch = urbdrc_isoch_new(pool, depth);
+	if (!urbdrc.isoch || !test_device_init(&dev, pool))
+		goto fail;
+
+	server.expected = 1;
+	server.count = 0;
+	server.outOfOrder = 0;
+	(void)ResetEvent(server.done);
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (UINT32 id = 1; id <= TEST_REQUESTS; id++)
+	{
+		for (size_t x = 0; x < sizeof(buffer); x++)
+			buffer[x] = (BYTE)(id + x);
+
+		if (urbdrc_isoch_transfer(urbdrc.isoch, &dev.iface, &callback, id, id, TEST_ENDPOINT, 0,
+		                          0, 0, FALSE, NULL, TEST_PACKETS, sizeof(buffer), buffer,
+		                          test_completed, 2000) < 0)
+			goto fail;
+	}
+
+	if (WaitForSingleObject(server.done, 10000) != WAIT_OBJECT_0)
+	{
+		(void)fprintf(stderr, "depth %" PRIuz ": %" PRIuz " of %d completions\n", depth,
+		              server.count, TEST_REQUESTS);
+		goto fail;
+	}
+	*duration = winpr_GetTickCount64NS() - start;
+
+	printf("depth %2" PRIuz ": %d transfers in %.1fms, %" PRIuz " in flight\n", depth,
+	       TEST_REQUESTS, (double)*duration / 1000000.0, dev.maxInflight);
+
+	if (server.outOfOrder != 0)
+	{
+		(void)fprintf(stderr, "%" PRIuz " completions out of order\n", server.outOfOrder);
+		goto fail;
+	}
+	if (dev.badData != 0)
+	{
+		(void)fprintf(stderr, "%" PRIuz " transfers with bad OUT data\n", dev.badData);
+		goto fail;
+	}
+	if (dev.maxInflight != MIN(depth, TEST_REQUESTS))
+	{
+		(void)fprintf(stderr, "%" PRIuz " transfers in flight, expected %" PRIuz "\n",
+		              dev.maxInflight, depth);
+		goto fail;
+	}
+	rc = TRUE;
+
+fail:
+	test_device_uninit(&dev);
+	urbdrc_isoch_free(urbdrc.isoch);
+	return rc;
+}
+
+/* closing the device channel drops queued requests, late completions are discarded */
+static BOOL test_remove(wStreamPool* pool)
+{
+	BOOL rc = FALSE;
+	test_device dev = { 0 };
+	URBDRC_PLUGIN urbdrc = { 0 };
+	GENERIC_CHANNEL_CALLBACK callback = { 0 };
+	BYTE buffer[TEST_PACKET_SIZE] = { 0 };
+
+	callback.plugin = &urbdrc.iface;
+	urbdrc.isoch = urbdrc_isoch_new(pool, 4);
+	if (!urbdrc.isoch || !test_device_init(&dev, pool))
+		goto fail;
+
+	server.count = 0;
+	for (UINT32 id = 1; id <= 16; id++)
+	{
+		for (size_t x = 0; x < sizeof(buffer); x++)
+			buffer[x] = (BYTE)(id + x);
+
+		if (urbdrc_isoch_transfer(urbdrc.isoch, &dev.iface, &callback, id, id, TEST_ENDPOINT, 0,
+		                          0, 0, FALSE, NULL, 1, sizeof(buffer), buffer, test_completed,
+		                          2000) < 0)
+			goto fail;
+	}
+	urbdrc_isoch_remove(urbdrc.isoch, 7);
+
+	while (TRUE)
+	{
+		EnterCriticalSection(&dev.lock);
+		const size_t inflight = dev.inflight;
+		LeaveCriticalSection(&dev.lock);
+		if (inflight == 0)
+			break;
+		Sleep(1);
+	}
+
+	/* only transfers completed before the removal may have been reported */
+	rc = (server.count <= 4) && (dev.maxInflight == 4);
+
+fail:
+	test_device_uninit(&dev);
+	urbdrc_isoch_free(urbdrc.isoch);
+	return rc;
+}
+
+int TestUrbdrcIsoch(int argc, char* argv[])
+{
+	int rc = -1;
+	UINT64 serial = 0;
+	UINT64 pipelined = 0;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	wStreamPool* pool = StreamPool_New(TRUE, 0);
+	server.done = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!pool || !server.done)
+		goto fail;
+
+	if (!test_stream(pool, 1, &serial))
+		goto fail;
+	if (!test_stream(pool, URBDRC_ISOCH_DEFAULT_DEPTH, &pipelined))
+		goto fail;
+	if (!test_remove(pool))
+		goto fail;
+
+	if (StreamPool_UsedCount(pool) != 0)
+	{
+		(void)fprintf(stderr, "%" PRIuz " buffers not returned\n", StreamPool_UsedCount(pool));
+		goto fail;
+	}
+
+	/* one transfer at a time leaves the endpoint idle for the scheduling latency every time */
+	if (3 * pipelined > 2 * serial)
+	{
+		(void)fprintf(stderr, "pipelining is not faster: %.1fms vs %.1fms\n",
+		              (double)pipelined / 1000000.0, (double)serial / 1000000.0);
+		goto fail;
+	}
+	rc = 0;
+
+fail:
+	if (server.done)
+		(void)CloseHandle(server.done);
+	StreamPool_Free(pool);
+	return rc;
+}
@@ -40,6 +40,7 @@
 #include "urbdrc_types.h"
 #include "urbdrc_main.h"
 #include "data_transfer.h"
+#include "isoch_pipeline.h"
 
 #include <urbdrc_helpers.h>
 
@@ -679,6 +680,8 @@ static UINT urbdrc_on_close(IWTSVirtualChannelCallback* pChannelCallback)
 					udevman->status |= URBDRC_DEVICE_CHANNEL_CLOSED;
 				else
 				{ /* Need to notify the local backend the device is gone */
+					urbdrc_isoch_remove(urbdrc->isoch, control);
+
 					IUDEVICE* pdev = udevman->get_udevice_by_ChannelID(udevman, control);
 					if (pdev)
 						pdev->markChannelClosed(pdev);
@@ -793,6 +796,8 @@ static UINT urbdrc_plugin_terminated(IWTSPlugin* pPlugin)
 		udevman = NULL;
 	}
 
+	urbdrc_isoch_free(urbdrc->isoch);
+	StreamPool_Free(urbdrc->pool);
 	free(urbdrc->subsystem);
 	free(urbdrc->listener_callback);
 	free(urbdrc);
@@ -867,6 +872,8 @@ static UINT urbdrc_process_addin_args(URBDRC_PLUGIN* urbdrc, const ADDIN_ARGV* a
 		{ "encode", COMMAND_LINE_VALUE_FLAG, "", NULL, NULL, -1, NULL, "encode" },
 		{ "quality", COMMAND_LINE_VALUE_REQUIRED, "<[0-2] -> [high-medium-low]>", NULL, NULL, -1,
 		  NULL, "quality" },
+		{ "isoch-depth", COMMAND_LINE_VALUE_REQUIRED, "<transfers>", NULL, NULL, -1, NULL,
+		  "isochronous transfers in flight per endpoint" },
 		{ NULL, 0, NULL, NULL, NULL, -1, NULL, NULL }
 	};
 
@@ -895,6 +902,14 @@ static UINT urbdrc_process_addin_args(URBDRC_PLUGIN* urbdrc, const ADDIN_ARGV* a
 			if (!urbdrc_set_subsystem(urbdrc, arg->Value))
 				return ERROR_OUTOFMEMORY;
 		}
+		CommandLineSwitchCase(arg, "isoch-depth")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+			if ((errno != 0) || (val == 0) || (val > 64))
+				return ERROR_INVALID_DATA;
+			urbdrc->isochDepth = val;
+		}
 		CommandLineSwitchDefault(arg)
 		{
 		}
@@ -1034,6 +1049,8 @@ FREERDP_ENTRY_POINT(UINT VCAPITYPE urbdrc_DVCPluginEntry(IDRDYNVC_ENTRY_POINTS*
 
 		if (!urbdrc->log)
 			goto fail;
+
+		urbdrc->isochDepth = URBDRC_ISOCH_DEFAULT_DEPTH;
 	}
 
 	status = urbdrc_process_addin_args(urbdrc, args);
@@ -1041,6 +1058,20 @@ FREERDP_ENTRY_POINT(UINT VCAPITYPE urbdrc_DVCPluginEntry(IDRDYNVC_ENTRY_POINTS*
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
+	if (!urbdrc->pool)
+	{
+		urbdrc->pool = StreamPool_New(TRUE, 0);
+		if (!urbdrc->pool)
+			return CHANNEL_RC_NO_MEMORY;
+	}
+
+	if (!urbdrc->isoch)
+	{
+		urbdrc->isoch = urbdrc_isoch_new(urbdrc->pool, urbdrc->isochDepth);
+		if (!urbdrc->isoch)
+			return CHANNEL_RC_NO_MEMORY;
+	}
+
 	if (!urbdrc->subsystem && !urbdrc_set_subsystem(urbdrc, "libusb"))
 		goto fail;
 
@@ -1058,13 +1089,13 @@ UINT stream_write_and_free(IWTSPlugin* plugin, IWTSVirtualChannel* channel, wStr
 
 	if (!channel || !out || !urbdrc)
 	{
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 		return ERROR_INVALID_PARAMETER;
 	}
 
 	if (!channel->Write)
 	{
-		Stream_Free(out, TRUE);
+		Stream_Release(out);
 		return ERROR_INTERNAL_ERROR;
 	}
 
@@ -1073,6 +1104,6 @@ UINT stream_write_and_free(IWTSPlugin* plugin, IWTSVirtualChannel* channel, wStr
 	UINT rc = ERROR_INTERNAL_ERROR;
 	if (len <= UINT32_MAX)
 		rc = channel->Write(channel, (UINT32)len, Stream_Buffer(out), NULL);
-	Stream_Free(out, TRUE);
+	Stream_Release(out);
 	return rc;
 }
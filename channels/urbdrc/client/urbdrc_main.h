@@ -22,6 +22,7 @@
 #define FREERDP_CHANNEL_URBDRC_CLIENT_MAIN_H
 
 #include <winpr/pool.h>
+#include <winpr/stream.h>
 #include <freerdp/channels/log.h>
 #include <freerdp/client/channels.h>
 
@@ -44,6 +45,7 @@
 
 typedef struct S_IUDEVICE IUDEVICE;
 typedef struct S_IUDEVMAN IUDEVMAN;
+typedef struct s_urbdrc_isoch URBDRC_ISOCH;
 
 #define BASIC_DEV_STATE_DEFINED(_arg, _type)                   \
 	WINPR_ATTR_NODISCARD _type (*get_##_arg)(IUDEVICE * pdev); \
@@ -66,6 +68,10 @@ typedef struct
 	wLog* log;
 	IWTSListener* listener;
 	BOOL initialized;
+
+	wStreamPool* pool;
+	URBDRC_ISOCH* isoch;
+	size_t isochDepth;
 } URBDRC_PLUGIN;
 
 typedef BOOL (*PREGISTERURBDRCSERVICE)(IWTSPlugin* plugin, IUDEVMAN* udevman);
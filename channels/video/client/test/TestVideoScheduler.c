@@ -0,0 +1,376 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/stream.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+
+#include <freerdp/types.h>
+#include <freerdp/channels/video.h>
+
+#include "../video_scheduler.h"
+
+#define TEST_HNS_DURATION 166666ull /* 60 fps */
+#define TEST_SAMPLES 90
+#define TEST_SAMPLE_SIZE 3000
+#define TEST_POLL_NS 5000000ull
+
+typedef struct
+{
+	CRITICAL_SECTION lock;
+	LONG contexts;
+	UINT32 lastPresented;
+	BOOL outOfOrder;
+} test_context;
+
+typedef struct
+{
+	UINT32 sampleNumber;
+} test_frame;
+
+/* synthetic encoded sample: decode cost in us and sample number, then filler */
+static void* test_decode(void* arg, void* context, const BYTE* data, size_t size)
+{
+	WINPR_UNUSED(arg);
+	WINPR_UNUSED(context);
+
+	if (size < 8)
+		return NULL;
+
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticConstInit(&sbuffer, data, size);
+	const UINT32 costUs = Stream_Get_UINT32(s);
+
+	test_frame* frame = calloc(1, sizeof(test_frame));
+	if (!frame)
+		return NULL;
+	Stream_Read_UINT32(s, frame->sampleNumber);
+
+	const UINT64 end = winpr_GetTickCount64NS() + costUs * 1000ull;
+	while (winpr_GetTickCount64NS() < end)
+		Sleep(1);
+	return frame;
+}
+
+static void test_context_free(void* arg, void* context)
+{
+	test_context* test = arg;
+	WINPR_ASSERT(context == test);
+	(void)InterlockedDecrement(&test->contexts);
+}
+
+static BOOL test_present(void* arg, void* pframe)
+{
+	test_context* test = arg;
+	const test_frame* frame = pframe;
+
+	EnterCriticalSection(&test->lock);
+	if (frame->sampleNumber <= test->lastPresented)
+		test->outOfOrder = TRUE;
+	test->lastPresented = frame->sampleNumber;
+	LeaveCriticalSection(&test->lock);
+	return TRUE;
+}
+
+static void test_frame_free(void* arg, void* frame)
+{
+	WINPR_UNUSED(arg);
+	free(frame);
+}
+
+static const VideoSchedulerCallbacks test_callbacks = {
+	.Decode = test_decode,
+	.ContextFree = test_context_free,
+	.Present = test_present,
+	.FrameFree = test_frame_free,
+};
+
+static UINT32 test_random(UINT32* seed)
+{
+	*seed = *seed * 1103515245u + 12345u;
+	return (*seed >> 16) & 0x7fff;
+}
+
+/* Records a TSMM VIDEO_DATA stream as it arrives on the data channel: each record is the
+ * arrival time in us followed by the PDU. Samples are split into up to 3 packets. */
+static wStream* test_record_stream(UINT32 decodeCostUs, UINT32 keyframeCostUs, UINT32 jitterUs)
+{
+	UINT32 seed = 42;
+	wStream* s = Stream_New(NULL, 1024);
+	if (!s)
+		return NULL;
+
+	for (UINT32 sample = 1; sample <= TEST_SAMPLES; sample++)
+	{
+		const UINT16 packets = (UINT16)(1 + test_random(&seed) % 3);
+		const UINT32 cost = (sample % 30 == 1) ? keyframeCostUs : decodeCostUs;
+		const UINT64 sent = (sample - 1) * TEST_HNS_DURATION / 10ull;
+		const UINT32 arrival = (UINT32)(sent + test_random(&seed) % (jitterUs + 1));
+
+		BYTE payload[TEST_SAMPLE_SIZE] = { 0 };
+		wStream pbuffer = { 0 };
+		wStream* p = Stream_StaticInit(&pbuffer, payload, sizeof(payload));
+		Stream_Write_UINT32(p, cost);
+		Stream_Write_UINT32(p, sample);
+
+		for (UINT16 packet = 1; packet <= packets; packet++)
+		{
+			const size_t offset = (packet - 1ull) * TEST_SAMPLE_SIZE / packets;
+			const size_t end = 1ull * packet * TEST_SAMPLE_SIZE / packets;
+			const UINT32 cbSample = (UINT32)(end - offset);
+
+			if (!Stream_EnsureRemainingCapacity(s, 4ull + 40ull + cbSample))
+			{
+				Stream_Free(s, TRUE);
+				return NULL;
+			}
+			Stream_Write_UINT32(s, arrival);
+			Stream_Write_UINT32(s, 40 + cbSample); /* cbSize */
+			Stream_Write_UINT32(s, TSMM_PACKET_TYPE_VIDEO_DATA);
+			Stream_Write_UINT8(s, 1); /* PresentationId */
+			Stream_Write_UINT8(s, 1); /* Version */
+			Stream_Write_UINT8(s, 0); /* Flags */
+			Stream_Write_UINT8(s, 0); /* reserved */
+			Stream_Write_UINT64(s, (sample - 1) * TEST_HNS_DURATION);
+			Stream_Write_UINT64(s, TEST_HNS_DURATION);
+			Stream_Write_UINT16(s, packet);
+			Stream_Write_UINT16(s, packets);
+			Stream_Write_UINT32(s, sample);
+			Stream_Write_UINT32(s, cbSample);
+			Stream_Write(s, &payload[offset], cbSample);
+		}
+	}
+	Stream_SealLength(s);
+	Stream_SetPosition(s, 0);
+	return s;
+}
+
+typedef struct
+{
+	VideoScheduler* scheduler;
+	test_context* test;
+	wStream* recording;
+	volatile LONG done;
+	volatile LONG pushed;
+} test_replay;
+
+/* parses and reassembles the recording like the video data channel does */
+static DWORD WINAPI test_replay_thread(LPVOID arg)
+{
+	test_replay* replay = arg;
+	wStream* s = replay->recording;
+	wStream* sample = Stream_New(NULL, TEST_SAMPLE_SIZE);
+	const UINT64 start = winpr_GetTickCount64NS();
+	UINT64 publishTime = 0;
+
+	while (sample && Stream_GetRemainingLength(s) >= 44)
+	{
+		TSMM_VIDEO_DATA data = { 0 };
+		const UINT32 arrival = Stream_Get_UINT32(s);
+		const UINT32 cbSize = Stream_Get_UINT32(s);
+		Stream_Seek_UINT32(s); /* PacketType */
+		Stream_Read_UINT8(s, data.PresentationId);
+		Stream_Read_UINT8(s, data.Version);
+		Stream_Read_UINT8(s, data.Flags);
+		Stream_Seek_UINT8(s); /* reserved */
+		Stream_Read_UINT64(s, data.hnsTimestamp);
+		Stream_Read_UINT64(s, data.hnsDuration);
+		Stream_Read_UINT16(s, data.CurrentPacketIndex);
+		Stream_Read_UINT16(s, data.PacketsInSample);
+		Stream_Read_UINT32(s, data.SampleNumber);
+		Stream_Read_UINT32(s, data.cbSample);
+		if ((cbSize != 40 + data.cbSample) ||
+		    !Stream_CheckAndLogRequiredLength("TestVideoScheduler", s, data.cbSample))
+			break;
+		data.pSample = Stream_Pointer(s);
+		Stream_Seek(s, data.cbSample);
+
+		const UINT64 due = start + arrival * 1000ull;
+		const UINT64 now = winpr_GetTickCount64NS();
+		if (due > now)
+			USleep((DWORD)((due - now) / 1000ull));
+
+		if (!Stream_EnsureRemainingCapacity(sample, data.cbSample))
+			break;
+		Stream_Write(sample, data.pSample, data.cbSample);
+		if (data.CurrentPacketIndex != data.PacketsInSample)
+			continue;
+
+		if (data.SampleNumber == 1)
+			publishTime = winpr_GetTickCount64NS();
+		publishTime += 100ull * data.hnsDuration;
+
+		(void)InterlockedIncrement(&replay->test->contexts);
+		if (!video_scheduler_push(replay->scheduler, publishTime, Stream_Buffer(sample),
+		                          Stream_GetPosition(sample), replay->test))
+		{
+			(void)InterlockedDecrement(&replay->test->contexts);
+			break;
+		}
+		(void)InterlockedIncrement(&replay->pushed);
+		Stream_SetPosition(sample, 0);
+	}
+
+	Stream_Free(sample, TRUE);
+	(void)InterlockedExchange(&replay->done, 1);
+	return 0;
+}
+
+/* presents like the channel timer, waking up for the next deadline */
+static BOOL test_run(const char* name, UINT32 decodeCostUs, UINT32 keyframeCostUs,
+                     UINT32 jitterUs, VideoSchedulerStats* stats)
+{
+	BOOL rc = FALSE;
+	HANDLE thread = NULL;
+	test_context test = { 0 };
+	test_replay replay = { 0 };
+
+	InitializeCriticalSection(&test.lock);
+	replay.test = &test;
+	replay.recording = test_record_stream(decodeCostUs, keyframeCostUs, jitterUs);
+	replay.scheduler =
+	    video_scheduler_new(&test_callbacks, &test, VIDEO_SCHEDULER_DEFAULT_LOOKAHEAD);
+	if (!replay.recording || !replay.scheduler)
+		goto fail;
+
+	thread = CreateThread(NULL, 0, test_replay_thread, &replay, 0, NULL);
+	if (!thread)
+		goto fail;
+
+	const UINT64 timeout = winpr_GetTickCount64NS() + 20000000000ull;
+	for (;;)
+	{
+		const UINT64 now = winpr_GetTickCount64NS();
+		(void)video_scheduler_present(replay.scheduler, now);
+
+		video_scheduler_get_stats(replay.scheduler, stats, FALSE);
+		const size_t handled = 1ull * stats->presented + stats->dropped + stats->late;
+		if (replay.done && (handled >= (size_t)replay.pushed))
+			break;
+		if (now > timeout)
+		{
+			(void)fprintf(stderr, "%s: timed out after %" PRIuz " of %" PRId32 " frames\n", name,
+			              handled, replay.pushed);
+			goto fail;
+		}
+
+		const UINT64 next = video_scheduler_next_deadline(replay.scheduler);
+		const UINT64 wait = (next > now) ? MIN(next - now, TEST_POLL_NS) : 0;
+		Sleep((DWORD)(wait / 1000000ull));
+	}
+
+	printf("%s: presented %" PRIu32 " dropped %" PRIu32 " late %" PRIu32
+	       ", jitter avg %.2f ms max %.2f ms\n",
+	       name, stats->presented, stats->dropped, stats->late,
+	       stats->presented ? (double)stats->jitterSumNS / stats->presented / 1000000.0 : 0.0,
+	       (double)stats->jitterMaxNS / 1000000.0);
+
+	if (replay.pushed != TEST_SAMPLES)
+		goto fail;
+	if (test.outOfOrder)
+	{
+		(void)fprintf(stderr, "%s: frames presented out of order\n", name);
+		goto fail;
+	}
+	rc = TRUE;
+
+fail:
+	if (thread)
+	{
+		(void)WaitForSingleObject(thread, INFINITE);
+		(void)CloseHandle(thread);
+	}
+	video_scheduler_free(replay.scheduler);
+	if (test.contexts != 0)
+	{
+		(void)fprintf(stderr, "%s: %" PRId32 " sample contexts leaked\n", name, test.contexts);
+		rc = FALSE;
+	}
+	Stream_Free(replay.recording, TRUE);
+	DeleteCriticalSection(&test.lock);
+	return rc;
+}
+
+static BOOL test_flush(void)
+{
+	BOOL rc = FALSE;
+	test_context test = { 0 };
+	BYTE sample[8] = { 0 };
+
+	InitializeCriticalSection(&test.lock);
+	VideoScheduler* scheduler = video_scheduler_new(&test_callbacks, &test, 2);
+	if (!scheduler)
+		goto fail;
+
+	const UINT64 deadline = winpr_GetTickCount64NS() + 60000000000ull;
+	for (UINT32 x = 0; x < 20; x++)
+	{
+		sample[4] = (BYTE)(x + 1);
+		(void)InterlockedIncrement(&test.contexts);
+		if (!video_scheduler_push(scheduler, deadline + x, sample, sizeof(sample), &test))
+			goto fail;
+	}
+
+	video_scheduler_flush(scheduler);
+	if (video_scheduler_next_deadline(scheduler) != UINT64_MAX)
+		goto fail;
+	if (video_scheduler_present(scheduler, UINT64_MAX - 1))
+		goto fail;
+	rc = TRUE;
+
+fail:
+	video_scheduler_free(scheduler);
+	if (test.contexts != 0)
+		rc = FALSE;
+	DeleteCriticalSection(&test.lock);
+	return rc;
+}
+
+int TestVideoScheduler(int argc, char* argv[])
+{
+	VideoSchedulerStats stats = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_flush())
+		return -1;
+
+	/* decoding keeps up, keyframes take longer than a frame interval */
+	if (!test_run("realtime", 2000, 25000, 6000, &stats))
+		return -1;
+	if ((stats.presented < TEST_SAMPLES * 9 / 10) ||
+	    (stats.jitterSumNS / stats.presented > 5000000ull))
+	{
+		(void)fprintf(stderr, "realtime replay presented too few frames or too late\n");
+		return -1;
+	}
+
+	/* decoding takes twice the frame interval, late frames must be dropped */
+	if (!test_run("overload", 33000, 33000, 0, &stats))
+		return -1;
+	if ((stats.late == 0) || (stats.presented == 0))
+	{
+		(void)fprintf(stderr, "overloaded replay did not drop late frames\n");
+		return -1;
+	}
+	return 0;
+}
@@ -47,6 +47,7 @@
 #define TAG CHANNELS_TAG("video")
 
 #include "video_main.h"
+#include "video_scheduler.h"
 
 typedef struct
 {
@@ -64,6 +65,11 @@ typedef struct
 
 #define XF_VIDEO_UNLIMITED_RATE 31
 
+/* timer interval without a presentation, and the longest wait while one is running */
+#define VIDEO_TIMER_INTERVAL_NS 20000000ull
+#define VIDEO_TIMER_POLL_NS 5000000ull
+#define VIDEO_FEEDBACK_INTERVAL_NS 1000000000ull
+
 static const BYTE MFVideoFormat_H264[] = { 'H',  '2',  '6',  '4',  0x00, 0x00, 0x10, 0x00,
 	                                       0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
 
@@ -85,9 +91,6 @@ typedef struct
 
 typedef struct
 {
-	UINT64 publishTime;
-	UINT64 hnsDuration;
-	MAPPED_GEOMETRY* geometry;
 	UINT32 w, h;
 	UINT32 scanline;
 	BYTE* surfaceData;
@@ -99,11 +102,8 @@ struct s_VideoClientContextPriv
 {
 	VideoClientContext* video;
 	GeometryClientContext* geometry;
-	wQueue* frames;
-	CRITICAL_SECTION framesLock;
+	VideoScheduler* scheduler;
 	wBufferPool* surfacePool;
-	UINT32 publishedFrames;
-	UINT32 droppedFrames;
 	UINT32 lastSentRate;
 	UINT64 nextFeedbackTime;
 	PresentationContext* currentPresentation;
@@ -112,6 +112,7 @@ struct s_VideoClientContextPriv
 
 static void PresentationContext_unref(PresentationContext** presentation);
 static void VideoClientContextPriv_free(VideoClientContextPriv* priv);
+static const VideoSchedulerCallbacks video_scheduler_callbacks;
 
 static const char* video_command_name(BYTE cmd)
 {
@@ -143,23 +144,19 @@ static VideoClientContextPriv* VideoClientContextPriv_new(VideoClientContext* vi
 	if (!ret)
 		return NULL;
 
-	ret->frames = Queue_New(TRUE, 10, 2);
-	if (!ret->frames)
-	{
-		WLog_ERR(TAG, "unable to allocate frames queue");
-		goto fail;
-	}
-
-	ret->surfacePool = BufferPool_New(FALSE, 0, 16);
+	/* frames are decoded on the scheduler thread and returned on the timer */
+	ret->surfacePool = BufferPool_New(TRUE, 0, 16);
 	if (!ret->surfacePool)
 	{
 		WLog_ERR(TAG, "unable to create surface pool");
 		goto fail;
 	}
 
-	if (!InitializeCriticalSectionAndSpinCount(&ret->framesLock, 4 * 1000))
+	ret->scheduler =
+	    video_scheduler_new(&video_scheduler_callbacks, ret, VIDEO_SCHEDULER_DEFAULT_LOOKAHEAD);
+	if (!ret->scheduler)
 	{
-		WLog_ERR(TAG, "unable to initialize frames lock");
+		WLog_ERR(TAG, "unable to create frame scheduler");
 		goto fail;
 	}
 
@@ -274,8 +271,6 @@ static void VideoFrame_free(VideoFrame** pframe)
 	if (!frame)
 		return;
 
-	mappedGeometryUnref(frame->geometry);
-
 	WINPR_ASSERT(frame->presentation);
 	WINPR_ASSERT(frame->presentation->video);
 	WINPR_ASSERT(frame->presentation->video->priv);
@@ -285,15 +280,13 @@ static void VideoFrame_free(VideoFrame** pframe)
 	*pframe = NULL;
 }
 
-static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationContext* presentation,
-                                  MAPPED_GEOMETRY* geom)
+static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationContext* presentation)
 {
 	VideoFrame* frame = NULL;
 	const VideoSurface* surface = NULL;
 
 	WINPR_ASSERT(priv);
 	WINPR_ASSERT(presentation);
-	WINPR_ASSERT(geom);
 
 	surface = presentation->surface;
 	WINPR_ASSERT(surface);
@@ -302,10 +295,6 @@ static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationCont
 	if (!frame)
 		goto fail;
 
-	mappedGeometryRef(geom);
-
-	frame->publishTime = presentation->lastPublishTime;
-	frame->geometry = geom;
 	frame->w = surface->alignedWidth;
 	frame->h = surface->alignedHeight;
 	frame->scanline = surface->scanline;
@@ -321,31 +310,91 @@ static VideoFrame* VideoFrame_new(VideoClientContextPriv* priv, PresentationCont
 	return frame;
 
 fail:
-	VideoFrame_free(&frame);
+	if (frame && frame->surfaceData)
+		BufferPool_Return(priv->surfacePool, frame->surfaceData);
+	free(frame);
 	return NULL;
 }
 
-void VideoClientContextPriv_free(VideoClientContextPriv* priv)
+static void* video_frame_decode(void* arg, void* context, const BYTE* data, size_t size)
 {
-	if (!priv)
-		return;
+	VideoClientContextPriv* priv = arg;
+	PresentationContext* presentation = context;
 
-	EnterCriticalSection(&priv->framesLock);
+	WINPR_ASSERT(priv);
+	WINPR_ASSERT(presentation);
+
+	if (size > UINT32_MAX)
+		return NULL;
 
-	if (priv->frames)
+	const VideoSurface* surface = presentation->surface;
+	const RECTANGLE_16 rect = { 0, 0, WINPR_ASSERTING_INT_CAST(UINT16, surface->alignedWidth),
+		                        WINPR_ASSERTING_INT_CAST(UINT16, surface->alignedHeight) };
+
+	VideoFrame* frame = VideoFrame_new(priv, presentation);
+	if (!frame)
 	{
-		while (Queue_Count(priv->frames))
-		{
-			VideoFrame* frame = Queue_Dequeue(priv->frames);
-			if (frame)
-				VideoFrame_free(&frame);
-		}
+		WLog_ERR(TAG, "unable to create frame");
+		return NULL;
+	}
+
+	const int status = avc420_decompress(presentation->h264, data, (UINT32)size,
+	                                     frame->surfaceData, surface->format, surface->scanline,
+	                                     surface->alignedWidth, surface->alignedHeight, &rect, 1);
+	if (status < 0)
+	{
+		VideoFrame_free(&frame);
+		return NULL;
 	}
+	return frame;
+}
+
+static BOOL video_frame_present(void* arg, void* pframe)
+{
+	VideoClientContextPriv* priv = arg;
+	VideoFrame* frame = pframe;
+
+	WINPR_ASSERT(priv);
+	WINPR_ASSERT(frame);
+
+	VideoClientContext* video = priv->video;
+	PresentationContext* presentation = frame->presentation;
+	WINPR_ASSERT(video);
+	WINPR_ASSERT(presentation);
+
+	memcpy(presentation->surface->data, frame->surfaceData, 1ull * frame->scanline * frame->h);
+
+	WINPR_ASSERT(video->showSurface);
+	return video->showSurface(video, presentation->surface, presentation->ScaledWidth,
+	                          presentation->ScaledHeight);
+}
 
-	Queue_Free(priv->frames);
-	LeaveCriticalSection(&priv->framesLock);
+static void video_frame_free(WINPR_ATTR_UNUSED void* arg, void* frame)
+{
+	VideoFrame* pframe = frame;
+	VideoFrame_free(&pframe);
+}
+
+static void video_presentation_free(WINPR_ATTR_UNUSED void* arg, void* context)
+{
+	PresentationContext* presentation = context;
+	PresentationContext_unref(&presentation);
+}
+
+static const VideoSchedulerCallbacks video_scheduler_callbacks = {
+	.Decode = video_frame_decode,
+	.ContextFree = video_presentation_free,
+	.Present = video_frame_present,
+	.FrameFree = video_frame_free,
+};
+
+void VideoClientContextPriv_free(VideoClientContextPriv* priv)
+{
+	if (!priv)
+		return;
 
-	DeleteCriticalSection(&priv->framesLock);
+	/* releases all frames, before their surfaces and pool go away */
+	video_scheduler_free(priv->scheduler);
 
 	if (priv->currentPresentation)
 		PresentationContext_unref(&priv->currentPresentation);
@@ -464,6 +513,7 @@ static UINT video_PresentationRequest(VideoClientContext* video,
 			}
 
 			WLog_ERR(TAG, "releasing current presentation %" PRIu8, req->PresentationId);
+			video_scheduler_flush(priv->scheduler);
 			PresentationContext_unref(&priv->currentPresentation);
 		}
 
@@ -516,8 +566,9 @@ static UINT video_PresentationRequest(VideoClientContext* video,
 			return CHANNEL_RC_OK;
 		}
 
-		priv->droppedFrames = 0;
-		priv->publishedFrames = 0;
+		VideoSchedulerStats stats = { 0 };
+		video_scheduler_flush(priv->scheduler);
+		video_scheduler_get_stats(priv->scheduler, &stats, TRUE);
 		PresentationContext_unref(&priv->currentPresentation);
 	}
 
@@ -679,65 +730,31 @@ static UINT video_control_send_client_notification(VideoClientContext* context,
 
 static void video_timer(VideoClientContext* video, UINT64 now)
 {
-	PresentationContext* presentation = NULL;
-	VideoFrame* frame = NULL;
-
 	WINPR_ASSERT(video);
 
 	VideoClientContextPriv* priv = video->priv;
 	WINPR_ASSERT(priv);
 
-	EnterCriticalSection(&priv->framesLock);
-	do
-	{
-		VideoFrame* peekFrame = (VideoFrame*)Queue_Peek(priv->frames);
-		if (!peekFrame)
-			break;
-
-		if (peekFrame->publishTime > now)
-			break;
-
-		if (frame)
-		{
-			WLog_DBG(TAG, "dropping frame @%" PRIu64, frame->publishTime);
-			priv->droppedFrames++;
-			VideoFrame_free(&frame);
-		}
-		frame = peekFrame;
-		Queue_Dequeue(priv->frames);
-	} while (1);
-	LeaveCriticalSection(&priv->framesLock);
-
-	if (frame)
-	{
-		presentation = frame->presentation;
-
-		priv->publishedFrames++;
-		memcpy(presentation->surface->data, frame->surfaceData, 1ull * frame->scanline * frame->h);
-
-		WINPR_ASSERT(video->showSurface);
-		if (!video->showSurface(video, presentation->surface, presentation->ScaledWidth,
-		                        presentation->ScaledHeight))
-			WLog_WARN(TAG, "showSurface failed");
-
-		VideoFrame_free(&frame);
-	}
+	(void)video_scheduler_present(priv->scheduler, now);
 
 	if (priv->nextFeedbackTime < now)
 	{
+		VideoSchedulerStats stats = { 0 };
+		video_scheduler_get_stats(priv->scheduler, &stats, TRUE);
+
 		/* we can compute some feedback only if we have some published frames and
 		 * a current presentation
 		 */
-		if (priv->publishedFrames && priv->currentPresentation)
+		if (stats.presented && priv->currentPresentation)
 		{
 			UINT32 computedRate = 0;
 
 			PresentationContext_ref(priv->currentPresentation);
 
-			if (priv->droppedFrames)
+			if (stats.dropped || stats.late)
 			{
 				/**
-				 * some dropped frames, looks like we're asking too many frames per seconds,
+				 * some dropped or late frames, looks like we're asking too many frames per seconds,
 				 * try lowering rate. We go directly from unlimited rate to 24 frames/seconds
 				 * otherwise we lower rate by 2 frames by seconds
 				 */
@@ -789,16 +806,17 @@ static void video_timer(VideoClientContext* video, UINT64 now)
 
 				WLog_VRB(TAG,
 				         "server notified with rate %" PRIu32 " published=%" PRIu32
-				         " dropped=%" PRIu32,
-				         priv->lastSentRate, priv->publishedFrames, priv->droppedFrames);
+				         " dropped=%" PRIu32 " late=%" PRIu32 " jitter avg=%" PRIu64
+				         "us max=%" PRIu64 "us",
+				         priv->lastSentRate, stats.presented, stats.dropped, stats.late,
+				         stats.jitterSumNS / stats.presented / 1000ull,
+				         stats.jitterMaxNS / 1000ull);
 			}
 
 			PresentationContext_unref(&priv->currentPresentation);
 		}
 
-		priv->droppedFrames = 0;
-		priv->publishedFrames = 0;
-		priv->nextFeedbackTime = now + 1000;
+		priv->nextFeedbackTime = now + VIDEO_FEEDBACK_INTERVAL_NS;
 	}
 }
 
@@ -806,7 +824,6 @@ static UINT video_VideoData(VideoClientContext* context, const TSMM_VIDEO_DATA*
 {
 	VideoClientContextPriv* priv = NULL;
 	PresentationContext* presentation = NULL;
-	int status = 0;
 
 	WINPR_ASSERT(context);
 	WINPR_ASSERT(data);
@@ -838,102 +855,32 @@ static UINT video_VideoData(VideoClientContext* context, const TSMM_VIDEO_DATA*
 
 	if (data->CurrentPacketIndex == data->PacketsInSample)
 	{
-		VideoSurface* surface = presentation->surface;
-		H264_CONTEXT* h264 = presentation->h264;
 		const UINT64 startTime = winpr_GetTickCount64NS();
-		MAPPED_GEOMETRY* geom = presentation->geometry;
 
-		const RECTANGLE_16 rect = { 0, 0, WINPR_ASSERTING_INT_CAST(UINT16, surface->alignedWidth),
-			                        WINPR_ASSERTING_INT_CAST(UINT16, surface->alignedHeight) };
 		Stream_SealLength(presentation->currentSample);
 		Stream_SetPosition(presentation->currentSample, 0);
 
-		const UINT64 timeAfterH264 = winpr_GetTickCount64NS();
 		if (data->SampleNumber == 1)
 		{
 			presentation->lastPublishTime = startTime;
 		}
 
 		presentation->lastPublishTime += 100ull * data->hnsDuration;
-		if (presentation->lastPublishTime <= (10000000ull + timeAfterH264))
-		{
-			int dropped = 0;
-
-			const size_t len = Stream_Length(presentation->currentSample);
-			if (len > UINT32_MAX)
-				return CHANNEL_RC_OK;
-
-			/* if the frame is to be published in less than 10 ms, let's consider it's now */
-			status =
-			    avc420_decompress(h264, Stream_Pointer(presentation->currentSample), (UINT32)len,
-			                      surface->data, surface->format, surface->scanline,
-			                      surface->alignedWidth, surface->alignedHeight, &rect, 1);
-
-			if (status < 0)
-				return CHANNEL_RC_OK;
-
-			WINPR_ASSERT(context->showSurface);
-			if (!context->showSurface(context, presentation->surface, presentation->ScaledWidth,
-			                          presentation->ScaledHeight))
-				return CHANNEL_RC_NOT_INITIALIZED;
 
-			priv->publishedFrames++;
-
-			/* cleanup previously scheduled frames */
-			EnterCriticalSection(&priv->framesLock);
-			while (Queue_Count(priv->frames) > 0)
-			{
-				VideoFrame* frame = Queue_Dequeue(priv->frames);
-				if (frame)
-				{
-					priv->droppedFrames++;
-					VideoFrame_free(&frame);
-					dropped++;
-				}
-			}
-			LeaveCriticalSection(&priv->framesLock);
-
-			if (dropped)
-				WLog_DBG(TAG, "showing frame (%d dropped)", dropped);
-		}
-		else
+		/* decoded ahead on the scheduler thread and shown by the timer at lastPublishTime */
+		if (!PresentationContext_ref(presentation))
+			return CHANNEL_RC_NO_MEMORY;
+		if (!video_scheduler_push(priv->scheduler, presentation->lastPublishTime,
+		                          Stream_Pointer(presentation->currentSample),
+		                          Stream_Length(presentation->currentSample), presentation))
 		{
-			const size_t len = Stream_Length(presentation->currentSample);
-			if (len > UINT32_MAX)
-				return CHANNEL_RC_OK;
-
-			BOOL enqueueResult = 0;
-			VideoFrame* frame = VideoFrame_new(priv, presentation, geom);
-			if (!frame)
-			{
-				WLog_ERR(TAG, "unable to create frame");
-				return CHANNEL_RC_NO_MEMORY;
-			}
-
-			status =
-			    avc420_decompress(h264, Stream_Pointer(presentation->currentSample), (UINT32)len,
-			                      frame->surfaceData, surface->format, surface->scanline,
-			                      surface->alignedWidth, surface->alignedHeight, &rect, 1);
-			if (status < 0)
-			{
-				VideoFrame_free(&frame);
-				return CHANNEL_RC_OK;
-			}
-
-			EnterCriticalSection(&priv->framesLock);
-			enqueueResult = Queue_Enqueue(priv->frames, frame);
-			LeaveCriticalSection(&priv->framesLock);
-
-			if (!enqueueResult)
-			{
-				WLog_ERR(TAG, "unable to enqueue frame");
-				VideoFrame_free(&frame);
-				return CHANNEL_RC_NO_MEMORY;
-			}
-
-			// NOLINTNEXTLINE(clang-analyzer-unix.Malloc): Queue_Enqueue owns frame
-			WLog_DBG(TAG, "scheduling frame in %" PRIu64 " ms", (frame->publishTime - startTime));
+			WLog_ERR(TAG, "unable to schedule frame");
+			PresentationContext_unref(&presentation);
+			return CHANNEL_RC_NO_MEMORY;
 		}
+
+		WLog_DBG(TAG, "scheduling frame in %" PRIu64 " ms",
+		         (presentation->lastPublishTime - startTime) / 1000000ull);
 	}
 
 	return CHANNEL_RC_OK;
@@ -1087,7 +1034,7 @@ static UINT video_data_on_new_channel_connection(IWTSListenerCallback* pListener
 
 static uint64_t timer_cb(WINPR_ATTR_UNUSED rdpContext* context, void* userdata,
                          WINPR_ATTR_UNUSED FreeRDP_TimerID timerID, uint64_t timestamp,
-                         uint64_t interval)
+                         WINPR_ATTR_UNUSED uint64_t interval)
 {
 	VideoClientContext* video = userdata;
 	if (!video)
@@ -1097,7 +1044,15 @@ static uint64_t timer_cb(WINPR_ATTR_UNUSED rdpContext* context, void* userdata,
 
 	video->timer(video, timestamp);
 
-	return interval;
+	/* wake up in time for the next decoded frame */
+	if (!video->priv->currentPresentation)
+		return VIDEO_TIMER_INTERVAL_NS;
+
+	const uint64_t now = winpr_GetTickCount64NS();
+	const uint64_t next = video_scheduler_next_deadline(video->priv->scheduler);
+	if (next <= now)
+		return 1;
+	return MIN(next - now, VIDEO_TIMER_POLL_NS);
 }
 
 /**
@@ -1155,7 +1110,8 @@ static UINT video_plugin_initialize(IWTSPlugin* plugin, IWTSVirtualChannelManage
 
 	if (status == CHANNEL_RC_OK)
 		video->context->priv->timerID =
-		    freerdp_timer_add(video->rdpcontext, 20000000, timer_cb, video->context, true);
+		    freerdp_timer_add(video->rdpcontext, VIDEO_TIMER_INTERVAL_NS, timer_cb, video->context,
+		                      true);
 	video->initialized = video->context->priv->timerID != 0;
 	if (!video->initialized)
 		status = ERROR_INTERNAL_ERROR;
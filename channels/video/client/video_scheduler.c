@@ -0,0 +1,388 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Video Optimized Remoting Virtual Channel Extension
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
+
+#include <freerdp/types.h>
+#include <freerdp/channels/log.h>
+
+#include "video_scheduler.h"
+
+#define TAG CHANNELS_TAG("video")
+
+typedef struct
+{
+	UINT64 deadline;
+	UINT32 generation;
+	void* context;
+	wStream* data;
+} VideoSample;
+
+typedef struct
+{
+	UINT64 deadline;
+	void* frame;
+} VideoReadyFrame;
+
+struct s_VideoScheduler
+{
+	VideoSchedulerCallbacks cb;
+	void* arg;
+
+	wStreamPool* pool;
+	wMessageQueue* samples;
+	HANDLE thread;
+
+	/* held while a sample is decoded, so flushing can wait for it */
+	CRITICAL_SECTION decodeLock;
+
+	CRITICAL_SECTION lock;
+	HANDLE space; /* set while there is room for another decoded frame */
+	BOOL stopping;
+	UINT32 generation;
+	UINT64 lastDeadline; /* of the last frame queued for presentation */
+	VideoReadyFrame* ready;
+	size_t readyCount;
+	size_t lookahead;
+	VideoSchedulerStats stats;
+};
+
+static void video_sample_free(VideoScheduler* scheduler, VideoSample* sample)
+{
+	if (!sample)
+		return;
+
+	if (sample->context && scheduler->cb.ContextFree)
+		scheduler->cb.ContextFree(scheduler->arg, sample->context);
+	if (sample->data)
+		Stream_Release(sample->data);
+	free(sample);
+}
+
+static void video_sample_message_free(void* obj)
+{
+	wMessage* msg = obj;
+	if (msg && (msg->id == 0))
+		video_sample_free(msg->context, msg->wParam);
+}
+
+static BOOL video_scheduler_wait_space(VideoScheduler* scheduler)
+{
+	for (;;)
+	{
+		EnterCriticalSection(&scheduler->lock);
+		const BOOL stopping = scheduler->stopping;
+		const BOOL full = scheduler->readyCount >= scheduler->lookahead;
+		if (full)
+			(void)ResetEvent(scheduler->space);
+		LeaveCriticalSection(&scheduler->lock);
+
+		if (stopping)
+			return FALSE;
+		if (!full)
+			return TRUE;
+		if (WaitForSingleObject(scheduler->space, INFINITE) != WAIT_OBJECT_0)
+			return FALSE;
+	}
+}
+
+static void video_scheduler_decode(VideoScheduler* scheduler, const VideoSample* sample)
+{
+	void* frame = NULL;
+
+	if (!video_scheduler_wait_space(scheduler))
+		return;
+
+	EnterCriticalSection(&scheduler->decodeLock);
+
+	EnterCriticalSection(&scheduler->lock);
+	const BOOL current = sample->generation == scheduler->generation;
+	LeaveCriticalSection(&scheduler->lock);
+
+	/* every sample is decoded to keep the reference frames intact, late ones are just not
+	 * presented */
+	if (current)
+		frame = scheduler->cb.Decode(scheduler->arg, sample->context,
+		                             Stream_Buffer(sample->data), Stream_Length(sample->data));
+
+	if (frame)
+	{
+		const UINT64 now = winpr_GetTickCount64NS();
+		const BOOL behind = MessageQueue_Size(scheduler->samples) > 0;
+
+		EnterCriticalSection(&scheduler->lock);
+		scheduler->stats.decoded++;
+		if (sample->generation != scheduler->generation)
+		{
+			/* flushed while decoding */
+		}
+		else if (behind && (now > sample->deadline + VIDEO_SCHEDULER_MAX_LATENESS_NS) &&
+		         (sample->deadline < scheduler->lastDeadline + VIDEO_SCHEDULER_MAX_LATENESS_NS))
+		{
+			WLog_DBG(TAG, "dropping late frame, %" PRIu64 " ms after its deadline",
+			         (now - sample->deadline) / 1000000ull);
+			scheduler->stats.late++;
+		}
+		else
+		{
+			WINPR_ASSERT(scheduler->readyCount < scheduler->lookahead);
+			VideoReadyFrame* ready = &scheduler->ready[scheduler->readyCount++];
+			ready->deadline = sample->deadline;
+			ready->frame = frame;
+			scheduler->lastDeadline = sample->deadline;
+			frame = NULL;
+		}
+		LeaveCriticalSection(&scheduler->lock);
+
+		if (frame)
+			scheduler->cb.FrameFree(scheduler->arg, frame);
+	}
+
+	LeaveCriticalSection(&scheduler->decodeLock);
+}
+
+static DWORD WINAPI video_scheduler_thread(LPVOID arg)
+{
+	VideoScheduler* scheduler = arg;
+	WINPR_ASSERT(scheduler);
+
+	while (MessageQueue_Wait(scheduler->samples))
+	{
+		wMessage message = { 0 };
+		if (!MessageQueue_Peek(scheduler->samples, &message, TRUE) || (message.id == WMQ_QUIT))
+			break;
+
+		VideoSample* sample = message.wParam;
+		video_scheduler_decode(scheduler, sample);
+		video_sample_free(scheduler, sample);
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+/* removes the first count decoded frames, the caller holds the lock */
+static void video_scheduler_remove_ready(VideoScheduler* scheduler, size_t count)
+{
+	WINPR_ASSERT(count <= scheduler->readyCount);
+
+	scheduler->readyCount -= count;
+	memmove(scheduler->ready, &scheduler->ready[count],
+	        scheduler->readyCount * sizeof(VideoReadyFrame));
+	if (count > 0)
+		(void)SetEvent(scheduler->space);
+}
+
+BOOL video_scheduler_present(VideoScheduler* scheduler, UINT64 now)
+{
+	void* frame = NULL;
+	size_t superseded = 0;
+
+	WINPR_ASSERT(scheduler);
+
+	EnterCriticalSection(&scheduler->lock);
+	while ((superseded + 1 < scheduler->readyCount) &&
+	       (scheduler->ready[superseded + 1].deadline <= now))
+	{
+		scheduler->cb.FrameFree(scheduler->arg, scheduler->ready[superseded].frame);
+		superseded++;
+	}
+	scheduler->stats.dropped += (UINT32)superseded;
+	if (superseded > 0)
+		WLog_DBG(TAG, "dropping %" PRIuz " superseded frames", superseded);
+
+	if ((superseded < scheduler->readyCount) && (scheduler->ready[superseded].deadline <= now))
+	{
+		const UINT64 jitter = now - scheduler->ready[superseded].deadline;
+		frame = scheduler->ready[superseded].frame;
+		superseded++;
+
+		scheduler->stats.presented++;
+		scheduler->stats.jitterSumNS += jitter;
+		scheduler->stats.jitterMaxNS = MAX(scheduler->stats.jitterMaxNS, jitter);
+	}
+	video_scheduler_remove_ready(scheduler, superseded);
+	LeaveCriticalSection(&scheduler->lock);
+
+	if (!frame)
+		return FALSE;
+
+	if (!scheduler->cb.Present(scheduler->arg, frame))
+		WLog_WARN(TAG, "presenting frame failed");
+	scheduler->cb.FrameFree(scheduler->arg, frame);
+	return TRUE;
+}
+
+UINT64 video_scheduler_next_deadline(VideoScheduler* scheduler)
+{
+	UINT64 deadline = UINT64_MAX;
+
+	WINPR_ASSERT(scheduler);
+
+	EnterCriticalSection(&scheduler->lock);
+	if (scheduler->readyCount > 0)
+		deadline = scheduler->ready[0].deadline;
+	LeaveCriticalSection(&scheduler->lock);
+	return deadline;
+}
+
+BOOL video_scheduler_push(VideoScheduler* scheduler, UINT64 deadline, const BYTE* data,
+                          size_t size, void* context)
+{
+	WINPR_ASSERT(scheduler);
+	WINPR_ASSERT(data || (size == 0));
+
+	VideoSample* sample = calloc(1, sizeof(VideoSample));
+	if (!sample)
+		return FALSE;
+
+	sample->data = StreamPool_Take(scheduler->pool, size);
+	if (!sample->data)
+		goto fail;
+	Stream_Write(sample->data, data, size);
+	Stream_SealLength(sample->data);
+
+	sample->deadline = deadline;
+	sample->context = context;
+	EnterCriticalSection(&scheduler->lock);
+	sample->generation = scheduler->generation;
+	LeaveCriticalSection(&scheduler->lock);
+
+	if (MessageQueue_Post(scheduler->samples, scheduler, 0, sample, NULL))
+		return TRUE;
+
+fail:
+	/* the context stays with the caller on failure */
+	sample->context = NULL;
+	video_sample_free(scheduler, sample);
+	return FALSE;
+}
+
+void video_scheduler_flush(VideoScheduler* scheduler)
+{
+	WINPR_ASSERT(scheduler);
+
+	EnterCriticalSection(&scheduler->lock);
+	scheduler->generation++;
+	scheduler->lastDeadline = 0;
+	LeaveCriticalSection(&scheduler->lock);
+
+	(void)MessageQueue_Clear(scheduler->samples);
+
+	EnterCriticalSection(&scheduler->decodeLock);
+	EnterCriticalSection(&scheduler->lock);
+	for (size_t x = 0; x < scheduler->readyCount; x++)
+		scheduler->cb.FrameFree(scheduler->arg, scheduler->ready[x].frame);
+	video_scheduler_remove_ready(scheduler, scheduler->readyCount);
+	LeaveCriticalSection(&scheduler->lock);
+	LeaveCriticalSection(&scheduler->decodeLock);
+}
+
+void video_scheduler_get_stats(VideoScheduler* scheduler, VideoSchedulerStats* stats, BOOL reset)
+{
+	WINPR_ASSERT(scheduler);
+	WINPR_ASSERT(stats);
+
+	EnterCriticalSection(&scheduler->lock);
+	*stats = scheduler->stats;
+	if (reset)
+	{
+		const VideoSchedulerStats empty = { 0 };
+		scheduler->stats = empty;
+	}
+	LeaveCriticalSection(&scheduler->lock);
+}
+
+void video_scheduler_free(VideoScheduler* scheduler)
+{
+	if (!scheduler)
+		return;
+
+	if (scheduler->thread)
+	{
+		EnterCriticalSection(&scheduler->lock);
+		scheduler->stopping = TRUE;
+		(void)SetEvent(scheduler->space);
+		LeaveCriticalSection(&scheduler->lock);
+
+		(void)MessageQueue_PostQuit(scheduler->samples, 0);
+		(void)WaitForSingleObject(scheduler->thread, INFINITE);
+		(void)CloseHandle(scheduler->thread);
+	}
+
+	/* frees the samples that were not decoded */
+	MessageQueue_Free(scheduler->samples);
+
+	for (size_t x = 0; x < scheduler->readyCount; x++)
+		scheduler->cb.FrameFree(scheduler->arg, scheduler->ready[x].frame);
+	free(scheduler->ready);
+
+	if (scheduler->space)
+		(void)CloseHandle(scheduler->space);
+	DeleteCriticalSection(&scheduler->lock);
+	DeleteCriticalSection(&scheduler->decodeLock);
+	StreamPool_Free(scheduler->pool);
+	free(scheduler);
+}
+
+VideoScheduler* video_scheduler_new(const VideoSchedulerCallbacks* cb, void* arg,
+                                    size_t lookahead)
+{
+	WINPR_ASSERT(cb);
+	WINPR_ASSERT(cb->Decode);
+	WINPR_ASSERT(cb->Present);
+	WINPR_ASSERT(cb->FrameFree);
+
+	if (lookahead == 0)
+		return NULL;
+
+	VideoScheduler* scheduler = calloc(1, sizeof(VideoScheduler));
+	if (!scheduler)
+		return NULL;
+
+	scheduler->cb = *cb;
+	scheduler->arg = arg;
+	scheduler->lookahead = lookahead;
+	InitializeCriticalSection(&scheduler->lock);
+	InitializeCriticalSection(&scheduler->decodeLock);
+
+	scheduler->ready = calloc(lookahead, sizeof(VideoReadyFrame));
+	scheduler->space = CreateEventA(NULL, TRUE, TRUE, NULL);
+	scheduler->pool = StreamPool_New(TRUE, 4096);
+	scheduler->samples = MessageQueue_New(NULL);
+	if (!scheduler->ready || !scheduler->space || !scheduler->pool || !scheduler->samples)
+		goto fail;
+	MessageQueue_Object(scheduler->samples)->fnObjectFree = video_sample_message_free;
+
+	scheduler->thread = CreateThread(NULL, 0, video_scheduler_thread, scheduler, 0, NULL);
+	if (!scheduler->thread)
+		goto fail;
+
+	return scheduler;
+
+fail:
+	video_scheduler_free(scheduler);
+	return NULL;
+}
@@ -0,0 +1,82 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Video Optimized Remoting Virtual Channel Extension
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_VIDEO_CLIENT_SCHEDULER_H
+#define FREERDP_CHANNEL_VIDEO_CLIENT_SCHEDULER_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+/* decoded frames waiting for their presentation time */
+#define VIDEO_SCHEDULER_DEFAULT_LOOKAHEAD 4
+
+/* frames decoded later than this after their presentation time are dropped if a newer sample
+ * is already waiting to be decoded, but at least one frame per interval is presented */
+#define VIDEO_SCHEDULER_MAX_LATENESS_NS 50000000ull
+
+typedef struct s_VideoScheduler VideoScheduler;
+
+typedef struct
+{
+	/** decodes a sample on the scheduler thread, returns the frame or NULL on failure */
+	void* (*Decode)(void* arg, void* context, const BYTE* data, size_t size);
+	/** releases the context of a sample once it was decoded or discarded */
+	void (*ContextFree)(void* arg, void* context);
+	/** shows a frame, called from video_scheduler_present */
+	BOOL (*Present)(void* arg, void* frame);
+	void (*FrameFree)(void* arg, void* frame);
+} VideoSchedulerCallbacks;
+
+typedef struct
+{
+	UINT32 decoded;
+	UINT32 presented;
+	UINT32 dropped; /* replaced by a newer frame before it was presented */
+	UINT32 late;    /* decoded too late to be presented */
+	UINT64 jitterSumNS; /* sum of the presentation delays of presented frames */
+	UINT64 jitterMaxNS;
+} VideoSchedulerStats;
+
+FREERDP_LOCAL void video_scheduler_free(VideoScheduler* scheduler);
+
+WINPR_ATTR_MALLOC(video_scheduler_free, 1)
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL VideoScheduler* video_scheduler_new(const VideoSchedulerCallbacks* cb, void* arg,
+                                                  size_t lookahead);
+
+/** @brief queues a sample for decoding, on success context is owned by the scheduler */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL BOOL video_scheduler_push(VideoScheduler* scheduler, UINT64 deadline,
+                                        const BYTE* data, size_t size, void* context);
+
+/** @brief presents the newest decoded frame that is due at now, older ones are dropped
+ *  @return TRUE if a frame was presented */
+FREERDP_LOCAL BOOL video_scheduler_present(VideoScheduler* scheduler, UINT64 now);
+
+/** @brief the presentation time of the next decoded frame, UINT64_MAX if there is none */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL UINT64 video_scheduler_next_deadline(VideoScheduler* scheduler);
+
+/** @brief discards all queued samples and decoded frames, waits for a running decode.
+ *  A sample already taken by the decoder thread is released without decoding it. */
+FREERDP_LOCAL void video_scheduler_flush(VideoScheduler* scheduler);
+
+FREERDP_LOCAL void video_scheduler_get_stats(VideoScheduler* scheduler, VideoSchedulerStats* stats,
+                                             BOOL reset);
+
+#endif /* FREERDP_CHANNEL_VIDEO_CLIENT_SCHEDULER_H */
@@ -1577,6 +1577,7 @@ static DWORD WINAPI xf_client_thread(LPVOID param)
 	DWORD exit_code = 0;
 	DWORD waitStatus = 0;
 	HANDLE inputEvent = NULL;
+	WINPR_WAIT_SET* waitSet = NULL;
 
 	freerdp* instance = (freerdp*)param;
 	WINPR_ASSERT(instance);
@@ -1622,12 +1623,18 @@ static DWORD WINAPI xf_client_thread(LPVOID param)
 	}
 
 	inputEvent = xfc->x11event;
+	waitSet = CreateWaitSet();
+
+	if (!waitSet || !WaitSetAdd(waitSet, inputEvent))
+	{
+		WLog_ERR(TAG, "failed to create the wait set");
+		goto disconnect;
+	}
 
 	while (!freerdp_shall_disconnect_context(instance->context))
 	{
-		HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+		HANDLE handles[MAXIMUM_WAIT_OBJECTS - 1] = { 0 };
 		DWORD nCount = 0;
-		handles[nCount++] = inputEvent;
 
 		/*
 		 * win8 and server 2k12 seem to have some timing issue/race condition
@@ -1656,7 +1663,11 @@ static DWORD WINAPI xf_client_thread(LPVOID param)
 		if (xfc->window)
 			xf_floatbar_hide_and_show(xfc->window->floatbar);
 
-		waitStatus = WaitForMultipleObjects(nCount, handles, FALSE, INFINITE);
+		/* inputEvent stays at index 0, only the transport handles may change */
+		if (!WaitSetAssign(waitSet, 1, handles, nCount))
+			break;
+
+		waitStatus = WaitSetWait(waitSet, INFINITE);
 
 		if (waitStatus == WAIT_FAILED)
 			break;
@@ -1705,6 +1716,7 @@ static DWORD WINAPI xf_client_thread(LPVOID param)
 
 disconnect:
 
+	CloseWaitSet(waitSet);
 	freerdp_disconnect(instance);
 end:
 	ExitThread(exit_code);
@@ -0,0 +1,1057 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Headless stream dump replay benchmark
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Replays a transport dump recorded with /dump:record,file:<file> through the client
+ * stack (bulk decompression, fast-path, RDPGFX, codecs and GDI) without any output and reports
+ * where the time went.
+ *
+ * Stage times are exclusive, a stage called from within another one is only accounted once.
+ * In replay mode dynamic channels are processed synchronously, so all stages run on the thread
+ * that runs the event loop and the thread CPU time is meaningful for all of them.
+ *
+ * A frame is a RDPGFX StartFrame/EndFrame pair, or a BeginPaint/EndPaint pair outside of a
+ * RDPGFX frame that invalidated some part of the screen. */
+
+#include <freerdp/config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+#include <winpr/crt.h>
+#include <winpr/path.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/gfx.h>
+#include <freerdp/streamdump.h>
+#include <freerdp/transport_io.h>
+#include <freerdp/client/cmdline.h>
+#include <freerdp/client/rdpgfx.h>
+#include <freerdp/channels/rdpgfx.h>
+#include <freerdp/log.h>
+
+#define TAG CLIENT_TAG("replay-bench")
+
+#define BENCH_MAX_DEPTH 16
+
+/* Allocations are counted by replacing the allocator of the C library, this only works where
+ * the original implementation is reachable under another name and no sanitizer does the same. */
+#if defined(__GLIBC__)
+#define BENCH_COUNT_ALLOCATIONS
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#undef BENCH_COUNT_ALLOCATIONS
+#endif
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer)
+#undef BENCH_COUNT_ALLOCATIONS
+#endif
+#endif
+
+typedef enum
+{
+	BENCH_STAGE_TRANSPORT,
+	BENCH_STAGE_PROTOCOL,
+	BENCH_STAGE_BITMAP,
+	BENCH_STAGE_SURFACE_BITS,
+	BENCH_STAGE_ORDERS,
+	BENCH_STAGE_GFX_CODEC,
+	BENCH_STAGE_GFX_GDI,
+	BENCH_STAGE_GFX_OUTPUT,
+	BENCH_STAGE_COUNT
+} benchStageId;
+
+static const char* bench_stage_names[BENCH_STAGE_COUNT] = {
+	"transport",    /* reading the dump, in real time mode including the pacing */
+	"protocol",     /* bulk decompression, fast-path, slow-path and channel parsing */
+	"bitmap",       /* bitmap updates, interleaved and planar codecs */
+	"surface_bits", /* surface commands, RemoteFX and NSCodec */
+	"orders",       /* drawing and cache orders */
+	"gfx_codec",    /* RDPGFX surface commands, all RDPGFX codecs */
+	"gfx_gdi",      /* RDPGFX fills, surface and cache copies */
+	"gfx_output"    /* composition of RDPGFX surfaces to the primary surface */
+};
+
+typedef struct
+{
+	UINT64 wall;
+	UINT64 cpu;
+} benchClock;
+
+typedef struct
+{
+	UINT64 calls;
+	benchClock time;
+} benchStage;
+
+typedef struct
+{
+	benchStageId id;
+	benchClock start;
+	benchClock child;
+} benchActiveStage;
+
+typedef struct
+{
+	rdpClientContext common;
+
+	BOOL realtime;
+	BOOL eof;
+
+	benchStage stages[BENCH_STAGE_COUNT];
+	benchActiveStage active[BENCH_MAX_DEPTH];
+	size_t depth;
+
+	BOOL inGfxFrame;
+	UINT64 gfxFrameStart;
+	size_t paintDepth;
+	UINT64 paintStart;
+	UINT64 gfxFrames;
+	UINT64 paintFrames;
+	UINT64* latencies;
+	size_t latencyCount;
+	size_t latencySize;
+
+	pTransportRWFkt ReadPdu;
+	rdpPrimaryUpdate primary;
+	rdpSecondaryUpdate secondary;
+	pBitmapUpdate BitmapUpdate;
+	pSurfaceBits SurfaceBits;
+	RdpgfxClientContext gfx;
+} benchContext;
+
+typedef struct
+{
+	benchClock wall;
+	UINT64 user;
+	UINT64 system;
+	UINT64 allocations;
+} benchSnapshot;
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+static UINT64 bench_allocations = 0;
+
+static inline void bench_count_allocation(void)
+{
+	(void)__atomic_fetch_add(&bench_allocations, 1, __ATOMIC_RELAXED);
+}
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+	bench_count_allocation();
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+	bench_count_allocation();
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	bench_count_allocation();
+	return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+	bench_count_allocation();
+	return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+	bench_count_allocation();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+	if ((alignment < sizeof(void*)) || ((alignment & (alignment - 1)) != 0))
+		return EINVAL;
+
+	bench_count_allocation();
+	void* ptr = __libc_memalign(alignment, size);
+	if (!ptr)
+		return ENOMEM;
+	*memptr = ptr;
+	return 0;
+}
+
+void free(void* ptr)
+{
+	__libc_free(ptr);
+}
+#endif
+
+static UINT64 bench_allocation_count(void)
+{
+#if defined(BENCH_COUNT_ALLOCATIONS)
+	return __atomic_load_n(&bench_allocations, __ATOMIC_RELAXED);
+#else
+	return 0;
+#endif
+}
+
+static UINT64 bench_thread_cpu(void)
+{
+#if defined(_WIN32)
+	FILETIME creation = { 0 };
+	FILETIME exit = { 0 };
+	FILETIME kernel = { 0 };
+	FILETIME user = { 0 };
+
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+
+	const UINT64 k = ((UINT64)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	const UINT64 u = ((UINT64)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (k + u) * 100ull;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts = { 0 };
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+	return (UINT64)ts.tv_sec * 1000000000ull + (UINT64)ts.tv_nsec;
+#else
+	return 0;
+#endif
+}
+
+static benchClock bench_now(void)
+{
+	const benchClock now = { winpr_GetTickCount64NS(), bench_thread_cpu() };
+	return now;
+}
+
+static benchSnapshot bench_snapshot(void)
+{
+	benchSnapshot snap = { 0 };
+
+	snap.wall = bench_now();
+	snap.allocations = bench_allocation_count();
+#if defined(_WIN32)
+	FILETIME creation = { 0 };
+	FILETIME exit = { 0 };
+	FILETIME kernel = { 0 };
+	FILETIME user = { 0 };
+
+	if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+	{
+		snap.user = (((UINT64)user.dwHighDateTime << 32) | user.dwLowDateTime) * 100ull;
+		snap.system = (((UINT64)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) * 100ull;
+	}
+#else
+	struct rusage usage = { 0 };
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		snap.user = (UINT64)usage.ru_utime.tv_sec * 1000000000ull +
+		            (UINT64)usage.ru_utime.tv_usec * 1000ull;
+		snap.system = (UINT64)usage.ru_stime.tv_sec * 1000000000ull +
+		              (UINT64)usage.ru_stime.tv_usec * 1000ull;
+	}
+#endif
+	return snap;
+}
+
+static void bench_stage_enter(benchContext* bench, benchStageId id)
+{
+	WINPR_ASSERT(bench);
+
+	if (bench->depth < BENCH_MAX_DEPTH)
+	{
+		benchActiveStage* stage = &bench->active[bench->depth];
+		const benchActiveStage empty = { 0 };
+
+		*stage = empty;
+		stage->id = id;
+		stage->start = bench_now();
+	}
+	bench->depth++;
+}
+
+static void bench_stage_leave(benchContext* bench)
+{
+	WINPR_ASSERT(bench);
+	WINPR_ASSERT(bench->depth > 0);
+
+	bench->depth--;
+	if (bench->depth >= BENCH_MAX_DEPTH)
+		return;
+
+	const benchActiveStage* stage = &bench->active[bench->depth];
+	const benchClock now = bench_now();
+	const benchClock elapsed = { now.wall - stage->start.wall, now.cpu - stage->start.cpu };
+	benchStage* total = &bench->stages[stage->id];
+
+	total->calls++;
+	total->time.wall += elapsed.wall - MIN(elapsed.wall, stage->child.wall);
+	total->time.cpu += elapsed.cpu - MIN(elapsed.cpu, stage->child.cpu);
+
+	if (bench->depth > 0)
+	{
+		benchActiveStage* parent = &bench->active[bench->depth - 1];
+		parent->child.wall += elapsed.wall;
+		parent->child.cpu += elapsed.cpu;
+	}
+}
+
+static BOOL bench_frame_add(benchContext* bench, UINT64 latency)
+{
+	WINPR_ASSERT(bench);
+
+	if (bench->latencyCount >= bench->latencySize)
+	{
+		const size_t size = MAX(4096, bench->latencySize * 2);
+		UINT64* tmp = realloc(bench->latencies, size * sizeof(UINT64));
+		if (!tmp)
+			return FALSE;
+		bench->latencies = tmp;
+		bench->latencySize = size;
+	}
+
+	bench->latencies[bench->latencyCount++] = latency;
+	return TRUE;
+}
+
+static int bench_read_pdu(rdpTransport* transport, wStream* s)
+{
+	benchContext* bench = (benchContext*)transport_get_context(transport);
+	WINPR_ASSERT(bench);
+	WINPR_ASSERT(bench->ReadPdu);
+
+	bench_stage_enter(bench, BENCH_STAGE_TRANSPORT);
+	const int rc = bench->ReadPdu(transport, s);
+	bench_stage_leave(bench);
+
+	/* the replay transport fails once the dump is exhausted */
+	if (rc < 0)
+		bench->eof = TRUE;
+	return rc;
+}
+
+static BOOL bench_begin_paint(rdpContext* context)
+{
+	benchContext* bench = (benchContext*)context;
+	WINPR_ASSERT(bench);
+
+	rdpGdi* gdi = context->gdi;
+	WINPR_ASSERT(gdi);
+	WINPR_ASSERT(gdi->primary);
+	WINPR_ASSERT(gdi->primary->hdc);
+	WINPR_ASSERT(gdi->primary->hdc->hwnd);
+	WINPR_ASSERT(gdi->primary->hdc->hwnd->invalid);
+	gdi->primary->hdc->hwnd->invalid->null = TRUE;
+
+	if (bench->paintDepth++ == 0)
+		bench->paintStart = winpr_GetTickCount64NS();
+	return TRUE;
+}
+
+static BOOL bench_end_paint(rdpContext* context)
+{
+	benchContext* bench = (benchContext*)context;
+	WINPR_ASSERT(bench);
+
+	if ((bench->paintDepth == 0) || (--bench->paintDepth > 0) || bench->inGfxFrame)
+		return TRUE;
+
+	rdpGdi* gdi = context->gdi;
+	WINPR_ASSERT(gdi);
+	WINPR_ASSERT(gdi->primary);
+
+	const HGDI_WND hwnd = gdi->primary->hdc->hwnd;
+	if (!hwnd || hwnd->invalid->null)
+		return TRUE;
+
+	bench->paintFrames++;
+	return bench_frame_add(bench, winpr_GetTickCount64NS() - bench->paintStart);
+}
+
+static BOOL bench_desktop_resize(rdpContext* context)
+{
+	WINPR_ASSERT(context);
+
+	rdpSettings* settings = context->settings;
+	WINPR_ASSERT(settings);
+
+	return gdi_resize(context->gdi, freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth),
+	                  freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight));
+}
+
+static BOOL bench_bitmap_update(rdpContext* context, const BITMAP_UPDATE* bitmap)
+{
+	benchContext* bench = (benchContext*)context;
+	WINPR_ASSERT(bench);
+
+	bench_stage_enter(bench, BENCH_STAGE_BITMAP);
+	const BOOL rc = bench->BitmapUpdate(context, bitmap);
+	bench_stage_leave(bench);
+	return rc;
+}
+
+static BOOL bench_surface_bits(rdpContext* context, const SURFACE_BITS_COMMAND* cmd)
+{
+	benchContext* bench = (benchContext*)context;
+	WINPR_ASSERT(bench);
+
+	bench_stage_enter(bench, BENCH_STAGE_SURFACE_BITS);
+	const BOOL rc = bench->SurfaceBits(context, cmd);
+	bench_stage_leave(bench);
+	return rc;
+}
+
+#define BENCH_ORDER(table, name, type)                                  \
+	static BOOL bench_##name(rdpContext* context, type order)           \
+	{                                                                   \
+		benchContext* bench = (benchContext*)context;                   \
+		WINPR_ASSERT(bench);                                            \
+                                                                        \
+		bench_stage_enter(bench, BENCH_STAGE_ORDERS);                   \
+		const BOOL rc = bench->table.name(context, order);              \
+		bench_stage_leave(bench);                                       \
+		return rc;                                                      \
+	}
+
+BENCH_ORDER(primary, DstBlt, const DSTBLT_ORDER*)
+BENCH_ORDER(primary, PatBlt, PATBLT_ORDER*)
+BENCH_ORDER(primary, ScrBlt, const SCRBLT_ORDER*)
+BENCH_ORDER(primary, OpaqueRect, const OPAQUE_RECT_ORDER*)
+BENCH_ORDER(primary, DrawNineGrid, const DRAW_NINE_GRID_ORDER*)
+BENCH_ORDER(primary, MultiDstBlt, const MULTI_DSTBLT_ORDER*)
+BENCH_ORDER(primary, MultiPatBlt, const MULTI_PATBLT_ORDER*)
+BENCH_ORDER(primary, MultiScrBlt, const MULTI_SCRBLT_ORDER*)
+BENCH_ORDER(primary, MultiOpaqueRect, const MULTI_OPAQUE_RECT_ORDER*)
+BENCH_ORDER(primary, MultiDrawNineGrid, const MULTI_DRAW_NINE_GRID_ORDER*)
+BENCH_ORDER(primary, LineTo, const LINE_TO_ORDER*)
+BENCH_ORDER(primary, Polyline, const POLYLINE_ORDER*)
+BENCH_ORDER(primary, MemBlt, MEMBLT_ORDER*)
+BENCH_ORDER(primary, Mem3Blt, MEM3BLT_ORDER*)
+BENCH_ORDER(primary, SaveBitmap, const SAVE_BITMAP_ORDER*)
+BENCH_ORDER(primary, GlyphIndex, GLYPH_INDEX_ORDER*)
+BENCH_ORDER(primary, FastIndex, const FAST_INDEX_ORDER*)
+BENCH_ORDER(primary, FastGlyph, const FAST_GLYPH_ORDER*)
+BENCH_ORDER(primary, PolygonSC, const POLYGON_SC_ORDER*)
+BENCH_ORDER(primary, PolygonCB, POLYGON_CB_ORDER*)
+BENCH_ORDER(primary, EllipseSC, const ELLIPSE_SC_ORDER*)
+BENCH_ORDER(primary, EllipseCB, const ELLIPSE_CB_ORDER*)
+BENCH_ORDER(secondary, CacheBitmap, const CACHE_BITMAP_ORDER*)
+BENCH_ORDER(secondary, CacheBitmapV2, CACHE_BITMAP_V2_ORDER*)
+BENCH_ORDER(secondary, CacheBitmapV3, CACHE_BITMAP_V3_ORDER*)
+BENCH_ORDER(secondary, CacheGlyph, const CACHE_GLYPH_ORDER*)
+BENCH_ORDER(secondary, CacheGlyphV2, const CACHE_GLYPH_V2_ORDER*)
+BENCH_ORDER(secondary, CacheBrush, const CACHE_BRUSH_ORDER*)
+
+/* only hook callbacks that are implemented, NULL has a meaning for some of them */
+#define BENCH_HOOK(bench, update, table, name) \
+	do                                         \
+	{                                          \
+		(bench)->table.name = (update)->name;  \
+		if ((update)->name)                    \
+			(update)->name = bench_##name;     \
+	} while (0)
+
+static void bench_register_update_callbacks(benchContext* bench)
+{
+	WINPR_ASSERT(bench);
+
+	rdpUpdate* update = bench->common.context.update;
+	WINPR_ASSERT(update);
+
+	rdpPrimaryUpdate* primary = update->primary;
+	WINPR_ASSERT(primary);
+	BENCH_HOOK(bench, primary, primary, DstBlt);
+	BENCH_HOOK(bench, primary, primary, PatBlt);
+	BENCH_HOOK(bench, primary, primary, ScrBlt);
+	BENCH_HOOK(bench, primary, primary, OpaqueRect);
+	BENCH_HOOK(bench, primary, primary, DrawNineGrid);
+	BENCH_HOOK(bench, primary, primary, MultiDstBlt);
+	BENCH_HOOK(bench, primary, primary, MultiPatBlt);
+	BENCH_HOOK(bench, primary, primary, MultiScrBlt);
+	BENCH_HOOK(bench, primary, primary, MultiOpaqueRect);
+	BENCH_HOOK(bench, primary, primary, MultiDrawNineGrid);
+	BENCH_HOOK(bench, primary, primary, LineTo);
+	BENCH_HOOK(bench, primary, primary, Polyline);
+	BENCH_HOOK(bench, primary, primary, MemBlt);
+	BENCH_HOOK(bench, primary, primary, Mem3Blt);
+	BENCH_HOOK(bench, primary, primary, SaveBitmap);
+	BENCH_HOOK(bench, primary, primary, GlyphIndex);
+	BENCH_HOOK(bench, primary, primary, FastIndex);
+	BENCH_HOOK(bench, primary, primary, FastGlyph);
+	BENCH_HOOK(bench, primary, primary, PolygonSC);
+	BENCH_HOOK(bench, primary, primary, PolygonCB);
+	BENCH_HOOK(bench, primary, primary, EllipseSC);
+	BENCH_HOOK(bench, primary, primary, EllipseCB);
+
+	rdpSecondaryUpdate* secondary = update->secondary;
+	WINPR_ASSERT(secondary);
+	BENCH_HOOK(bench, secondary, secondary, CacheBitmap);
+	BENCH_HOOK(bench, secondary, secondary, CacheBitmapV2);
+	BENCH_HOOK(bench, secondary, secondary, CacheBitmapV3);
+	BENCH_HOOK(bench, secondary, secondary, CacheGlyph);
+	BENCH_HOOK(bench, secondary, secondary, CacheGlyphV2);
+	BENCH_HOOK(bench, secondary, secondary, CacheBrush);
+
+	bench->BitmapUpdate = update->BitmapUpdate;
+	if (update->BitmapUpdate)
+		update->BitmapUpdate = bench_bitmap_update;
+	bench->SurfaceBits = update->SurfaceBits;
+	if (update->SurfaceBits)
+		update->SurfaceBits = bench_surface_bits;
+
+	update->BeginPaint = bench_begin_paint;
+	update->EndPaint = bench_end_paint;
+	update->DesktopResize = bench_desktop_resize;
+}
+
+static benchContext* bench_from_gfx(RdpgfxClientContext* context)
+{
+	WINPR_ASSERT(context);
+
+	rdpGdi* gdi = (rdpGdi*)context->custom;
+	WINPR_ASSERT(gdi);
+	return (benchContext*)gdi->context;
+}
+
+static UINT bench_gfx_start_frame(RdpgfxClientContext* context,
+                                  const RDPGFX_START_FRAME_PDU* startFrame)
+{
+	benchContext* bench = bench_from_gfx(context);
+	WINPR_ASSERT(bench);
+
+	bench->inGfxFrame = TRUE;
+	bench->gfxFrameStart = winpr_GetTickCount64NS();
+	return bench->gfx.StartFrame(context, startFrame);
+}
+
+static UINT bench_gfx_end_frame(RdpgfxClientContext* context,
+                                const RDPGFX_END_FRAME_PDU* endFrame)
+{
+	benchContext* bench = bench_from_gfx(context);
+	WINPR_ASSERT(bench);
+
+	const UINT rc = bench->gfx.EndFrame(context, endFrame);
+	if (bench->inGfxFrame)
+	{
+		bench->inGfxFrame = FALSE;
+		bench->gfxFrames++;
+		if (!bench_frame_add(bench, winpr_GetTickCount64NS() - bench->gfxFrameStart))
+			return CHANNEL_RC_NO_MEMORY;
+	}
+	return rc;
+}
+
+#define BENCH_GFX(name, stage, type)                                         \
+	static UINT bench_gfx_##name(RdpgfxClientContext* context, type pdu)     \
+	{                                                                        \
+		benchContext* bench = bench_from_gfx(context);                       \
+		WINPR_ASSERT(bench);                                                 \
+                                                                             \
+		bench_stage_enter(bench, stage);                                     \
+		const UINT rc = bench->gfx.name(context, pdu);                       \
+		bench_stage_leave(bench);                                            \
+		return rc;                                                           \
+	}
+
+BENCH_GFX(SurfaceCommand, BENCH_STAGE_GFX_CODEC, const RDPGFX_SURFACE_COMMAND*)
+BENCH_GFX(SolidFill, BENCH_STAGE_GFX_GDI, const RDPGFX_SOLID_FILL_PDU*)
+BENCH_GFX(SurfaceToSurface, BENCH_STAGE_GFX_GDI, const RDPGFX_SURFACE_TO_SURFACE_PDU*)
+BENCH_GFX(SurfaceToCache, BENCH_STAGE_GFX_GDI, const RDPGFX_SURFACE_TO_CACHE_PDU*)
+BENCH_GFX(CacheToSurface, BENCH_STAGE_GFX_GDI, const RDPGFX_CACHE_TO_SURFACE_PDU*)
+
+static UINT bench_gfx_UpdateSurfaces(RdpgfxClientContext* context)
+{
+	benchContext* bench = bench_from_gfx(context);
+	WINPR_ASSERT(bench);
+
+	bench_stage_enter(bench, BENCH_STAGE_GFX_OUTPUT);
+	const UINT rc = bench->gfx.UpdateSurfaces(context);
+	bench_stage_leave(bench);
+	return rc;
+}
+
+static void bench_register_gfx_callbacks(benchContext* bench, RdpgfxClientContext* gfx)
+{
+	WINPR_ASSERT(bench);
+	WINPR_ASSERT(gfx);
+
+	bench->gfx = *gfx;
+	if (gfx->StartFrame && gfx->EndFrame)
+	{
+		gfx->StartFrame = bench_gfx_start_frame;
+		gfx->EndFrame = bench_gfx_end_frame;
+	}
+	if (gfx->SurfaceCommand)
+		gfx->SurfaceCommand = bench_gfx_SurfaceCommand;
+	if (gfx->SolidFill)
+		gfx->SolidFill = bench_gfx_SolidFill;
+	if (gfx->SurfaceToSurface)
+		gfx->SurfaceToSurface = bench_gfx_SurfaceToSurface;
+	if (gfx->SurfaceToCache)
+		gfx->SurfaceToCache = bench_gfx_SurfaceToCache;
+	if (gfx->CacheToSurface)
+		gfx->CacheToSurface = bench_gfx_CacheToSurface;
+	if (gfx->UpdateSurfaces)
+		gfx->UpdateSurfaces = bench_gfx_UpdateSurfaces;
+}
+
+static void bench_OnChannelConnectedEventHandler(void* context, const ChannelConnectedEventArgs* e)
+{
+	benchContext* bench = (benchContext*)context;
+
+	WINPR_ASSERT(bench);
+	WINPR_ASSERT(e);
+
+	freerdp_client_OnChannelConnectedEventHandler(&bench->common, e);
+	if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0)
+		bench_register_gfx_callbacks(bench, (RdpgfxClientContext*)e->pInterface);
+}
+
+static void bench_OnChannelDisconnectedEventHandler(void* context,
+                                                    const ChannelDisconnectedEventArgs* e)
+{
+	benchContext* bench = (benchContext*)context;
+
+	WINPR_ASSERT(bench);
+	WINPR_ASSERT(e);
+
+	freerdp_client_OnChannelDisconnectedEventHandler(&bench->common, e);
+}
+
+static BOOL bench_pre_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+	WINPR_ASSERT(instance->context);
+
+	PubSub_SubscribeChannelConnected(instance->context->pubSub,
+	                                 bench_OnChannelConnectedEventHandler);
+	PubSub_SubscribeChannelDisconnected(instance->context->pubSub,
+	                                    bench_OnChannelDisconnectedEventHandler);
+	return TRUE;
+}
+
+static BOOL bench_post_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+
+	if (!gdi_init(instance, PIXEL_FORMAT_BGRX32))
+		return FALSE;
+
+	bench_register_update_callbacks((benchContext*)instance->context);
+	return TRUE;
+}
+
+static void bench_post_disconnect(freerdp* instance)
+{
+	if (!instance || !instance->context)
+		return;
+
+	PubSub_UnsubscribeChannelConnected(instance->context->pubSub,
+	                                   bench_OnChannelConnectedEventHandler);
+	PubSub_UnsubscribeChannelDisconnected(instance->context->pubSub,
+	                                      bench_OnChannelDisconnectedEventHandler);
+	gdi_free(instance);
+}
+
+static BOOL bench_client_new(freerdp* instance, rdpContext* context)
+{
+	if (!instance || !context)
+		return FALSE;
+
+	instance->PreConnect = bench_pre_connect;
+	instance->PostConnect = bench_post_connect;
+	instance->PostDisconnect = bench_post_disconnect;
+	return TRUE;
+}
+
+static void bench_client_free(WINPR_ATTR_UNUSED freerdp* instance, rdpContext* context)
+{
+	benchContext* bench = (benchContext*)context;
+
+	if (!bench)
+		return;
+
+	free(bench->latencies);
+}
+
+static int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints)
+{
+	WINPR_ASSERT(pEntryPoints);
+
+	ZeroMemory(pEntryPoints, sizeof(RDP_CLIENT_ENTRY_POINTS));
+	pEntryPoints->Version = RDP_CLIENT_INTERFACE_VERSION;
+	pEntryPoints->Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	pEntryPoints->ContextSize = sizeof(benchContext);
+	pEntryPoints->ClientNew = bench_client_new;
+	pEntryPoints->ClientFree = bench_client_free;
+	return 0;
+}
+
+static BOOL bench_register_transport(benchContext* bench)
+{
+	WINPR_ASSERT(bench);
+
+	rdpContext* context = &bench->common.context;
+	const rdpTransportIo* io = freerdp_get_io_callbacks(context);
+	if (!io)
+		return FALSE;
+
+	rdpTransportIo bio = *io;
+	bench->ReadPdu = io->ReadPdu;
+	bio.ReadPdu = bench_read_pdu;
+	return freerdp_set_io_callbacks(context, &bio);
+}
+
+static void bench_run(benchContext* bench)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+
+	WINPR_ASSERT(bench);
+
+	rdpContext* context = &bench->common.context;
+	freerdp* instance = context->instance;
+
+	bench_stage_enter(bench, BENCH_STAGE_PROTOCOL);
+	const BOOL connected = freerdp_connect(instance);
+	bench_stage_leave(bench);
+
+	if (!connected)
+	{
+		WLog_ERR(TAG, "replaying the connection sequence failed 0x%08" PRIx32,
+		         freerdp_get_last_error(context));
+		return;
+	}
+
+	while (!freerdp_shall_disconnect_context(context))
+	{
+		const DWORD count = freerdp_get_event_handles(context, handles, ARRAYSIZE(handles));
+		if (count == 0)
+		{
+			WLog_ERR(TAG, "freerdp_get_event_handles failed");
+			break;
+		}
+
+		const DWORD status = WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+		if (status == WAIT_FAILED)
+		{
+			WLog_ERR(TAG, "WaitForMultipleObjects failed with %" PRIu32 "", status);
+			break;
+		}
+
+		bench_stage_enter(bench, BENCH_STAGE_PROTOCOL);
+		const BOOL rc = freerdp_check_event_handles(context);
+		bench_stage_leave(bench);
+
+		if (!rc)
+		{
+			if (!bench->eof)
+				WLog_ERR(TAG, "Failed to check FreeRDP event handles");
+			break;
+		}
+	}
+
+	freerdp_disconnect(instance);
+}
+
+static int bench_compare_latency(const void* pva, const void* pvb)
+{
+	const UINT64* a = pva;
+	const UINT64* b = pvb;
+
+	if (*a < *b)
+		return -1;
+	if (*a > *b)
+		return 1;
+	return 0;
+}
+
+/* nearest rank percentile of the sorted latencies */
+static double bench_percentile(const benchContext* bench, size_t percent)
+{
+	if (bench->latencyCount == 0)
+		return 0.0;
+
+	const size_t rank = (percent * bench->latencyCount + 99) / 100;
+	return (double)bench->latencies[MAX(rank, 1) - 1] / 1000.0;
+}
+
+static void bench_print_json_string(FILE* fp, const char* str)
+{
+	(void)fputc('"', fp);
+	for (; *str != '\0'; str++)
+	{
+		const unsigned char c = (unsigned char)*str;
+		if ((c == '"') || (c == '\\'))
+			(void)fprintf(fp, "\\%c", c);
+		else if (c < 0x20)
+			(void)fprintf(fp, "\\u%04x", c);
+		else
+			(void)fputc(c, fp);
+	}
+	(void)fputc('"', fp);
+}
+
+static void bench_print(FILE* fp, benchContext* bench, const char* file, BOOL csv,
+                        const benchSnapshot* start, const benchSnapshot* end)
+{
+	WINPR_ASSERT(bench);
+
+	const UINT64 frames = bench->gfxFrames + bench->paintFrames;
+	const double duration = (double)(end->wall.wall - start->wall.wall) / 1000000.0;
+	const double fps = (duration > 0.0) ? (double)frames * 1000.0 / duration : 0.0;
+	const double user = (double)(end->user - start->user) / 1000000.0;
+	const double system = (double)(end->system - start->system) / 1000000.0;
+	const UINT64 allocations = end->allocations - start->allocations;
+	UINT64 sum = 0;
+
+	qsort(bench->latencies, bench->latencyCount, sizeof(UINT64), bench_compare_latency);
+	for (size_t x = 0; x < bench->latencyCount; x++)
+		sum += bench->latencies[x];
+
+	const double mean =
+	    (bench->latencyCount > 0) ? (double)sum / (double)bench->latencyCount / 1000.0 : 0.0;
+	const double p50 = bench_percentile(bench, 50);
+	const double p99 = bench_percentile(bench, 99);
+	const double max = bench_percentile(bench, 100);
+#if defined(BENCH_COUNT_ALLOCATIONS)
+	const BOOL counted = TRUE;
+#else
+	const BOOL counted = FALSE;
+#endif
+	const double perFrame = (frames > 0) ? (double)allocations / (double)frames : 0.0;
+
+	if (csv)
+	{
+		(void)fprintf(fp, "file,realtime,complete,duration_ms,cpu_user_ms,cpu_system_ms,frames,"
+		                  "gfx_frames,paint_frames,fps,latency_mean_us,latency_p50_us,"
+		                  "latency_p99_us,latency_max_us,allocations,allocations_per_frame");
+		for (size_t x = 0; x < BENCH_STAGE_COUNT; x++)
+			(void)fprintf(fp, ",%s_calls,%s_wall_ms,%s_cpu_ms", bench_stage_names[x],
+			              bench_stage_names[x], bench_stage_names[x]);
+		(void)fprintf(fp, "\n");
+
+		bench_print_json_string(fp, file);
+		(void)fprintf(fp,
+		              ",%d,%d,%.3f,%.3f,%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+		              ",%.2f,%.1f,%.1f,%.1f,%.1f,",
+		              bench->realtime ? 1 : 0, bench->eof ? 1 : 0, duration, user, system, frames,
+		              bench->gfxFrames, bench->paintFrames, fps, mean, p50, p99, max);
+		if (counted)
+			(void)fprintf(fp, "%" PRIu64 ",%.1f", allocations, perFrame);
+		else
+			(void)fprintf(fp, ",");
+		for (size_t x = 0; x < BENCH_STAGE_COUNT; x++)
+		{
+			const benchStage* stage = &bench->stages[x];
+			(void)fprintf(fp, ",%" PRIu64 ",%.3f,%.3f", stage->calls,
+			              (double)stage->time.wall / 1000000.0,
+			              (double)stage->time.cpu / 1000000.0);
+		}
+		(void)fprintf(fp, "\n");
+		return;
+	}
+
+	(void)fprintf(fp, "{\n  \"file\": ");
+	bench_print_json_string(fp, file);
+	(void)fprintf(fp, ",\n  \"realtime\": %s,\n  \"complete\": %s,\n",
+	              bench->realtime ? "true" : "false", bench->eof ? "true" : "false");
+	(void)fprintf(fp, "  \"duration_ms\": %.3f,\n", duration);
+	(void)fprintf(fp, "  \"cpu_ms\": { \"user\": %.3f, \"system\": %.3f },\n", user, system);
+	(void)fprintf(fp,
+	              "  \"frames\": { \"total\": %" PRIu64 ", \"gfx\": %" PRIu64
+	              ", \"paint\": %" PRIu64 ", \"fps\": %.2f },\n",
+	              frames, bench->gfxFrames, bench->paintFrames, fps);
+	(void)fprintf(fp,
+	              "  \"latency_us\": { \"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f "
+	              "},\n",
+	              mean, p50, p99, max);
+	if (counted)
+		(void)fprintf(fp,
+		              "  \"allocations\": { \"total\": %" PRIu64 ", \"per_frame\": %.1f },\n",
+		              allocations, perFrame);
+	else
+		(void)fprintf(fp, "  \"allocations\": null,\n");
+	(void)fprintf(fp, "  \"stages\": {\n");
+	for (size_t x = 0; x < BENCH_STAGE_COUNT; x++)
+	{
+		const benchStage* stage = &bench->stages[x];
+		(void)fprintf(fp,
+		              "    \"%s\": { \"calls\": %" PRIu64
+		              ", \"wall_ms\": %.3f, \"cpu_ms\": %.3f }%s\n",
+		              bench_stage_names[x], stage->calls, (double)stage->time.wall / 1000000.0,
+		              (double)stage->time.cpu / 1000000.0,
+		              (x + 1 < BENCH_STAGE_COUNT) ? "," : "");
+	}
+	(void)fprintf(fp, "  }\n}\n");
+}
+
+/* the report goes to stdout, keep it free of log messages. Fails harmlessly if WLOG_APPENDER
+ * selected something else than the console. */
+static void bench_log_to_stderr(void)
+{
+	wLogAppender* appender = WLog_GetLogAppender(WLog_GetRoot());
+	if (appender)
+		(void)WLog_ConfigureAppender(appender, "outputstream", "stderr");
+}
+
+static int usage(const char* app)
+{
+	(void)fprintf(stderr, "Usage: %s [--realtime] [--csv] [--output=<file>] <dump file> "
+	                      "[client options]\n",
+	              app);
+	(void)fprintf(stderr, "\t--realtime\treplay with the timing of the recording\n");
+	(void)fprintf(stderr, "\t--csv\t\tprint a CSV header and row instead of JSON\n");
+	(void)fprintf(stderr, "\t--output=<file>\twrite the report to <file>\n");
+	(void)fprintf(stderr, "Client options must match the ones used for the recording, "
+	                      "e.g. /gfx or /bpp:<depth>\n");
+	return -1;
+}
+
+int main(int argc, char* argv[])
+{
+	int rc = -1;
+	BOOL realtime = FALSE;
+	BOOL csv = FALSE;
+	const char* output = NULL;
+	const char* file = NULL;
+	char** args = NULL;
+	int nargs = 1;
+	int i = 1;
+	RDP_CLIENT_ENTRY_POINTS clientEntryPoints = { 0 };
+	rdpContext* context = NULL;
+	FILE* fp = stdout;
+
+	bench_log_to_stderr();
+
+	for (; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--realtime") == 0)
+			realtime = TRUE;
+		else if (strcmp(arg, "--csv") == 0)
+			csv = TRUE;
+		else if (strncmp(arg, "--output=", 9) == 0)
+			output = &arg[9];
+		else if (strncmp(arg, "--", 2) == 0)
+			return usage(argv[0]);
+		else
+			break;
+	}
+
+	if (i >= argc)
+		return usage(argv[0]);
+	file = argv[i++];
+	if (!winpr_PathFileExists(file))
+		return usage(argv[0]);
+
+	args = calloc((size_t)(argc - i) + 1, sizeof(char*));
+	if (!args)
+		return -1;
+	args[0] = argv[0];
+	for (; i < argc; i++)
+		args[nargs++] = argv[i];
+
+	RdpClientEntry(&clientEntryPoints);
+	context = freerdp_client_context_new(&clientEntryPoints);
+	if (!context)
+		goto fail;
+
+	if (nargs > 1)
+	{
+		const int status =
+		    freerdp_client_settings_parse_command_line(context->settings, nargs, args, FALSE);
+		if (status)
+		{
+			rc = freerdp_client_settings_command_line_status_print(context->settings, status,
+			                                                       nargs, args);
+			goto fail;
+		}
+	}
+
+	{
+		benchContext* bench = (benchContext*)context;
+		rdpSettings* settings = context->settings;
+
+		bench->realtime = realtime;
+		if (!freerdp_settings_set_bool(settings, FreeRDP_TransportDump, FALSE) ||
+		    !freerdp_settings_set_bool(settings, FreeRDP_TransportDumpReplay, TRUE) ||
+		    !freerdp_settings_set_bool(settings, FreeRDP_TransportDumpReplayNodelay, !realtime) ||
+		    !freerdp_settings_set_string(settings, FreeRDP_TransportDumpFile, file))
+			goto fail;
+
+		if (!freerdp_settings_get_string(settings, FreeRDP_ServerHostname) &&
+		    !freerdp_settings_set_string(settings, FreeRDP_ServerHostname, "replay"))
+			goto fail;
+
+		if (!stream_dump_register_handlers(context, CONNECTION_STATE_MCS_CREATE_REQUEST, FALSE))
+			goto fail;
+		if (!bench_register_transport(bench))
+			goto fail;
+
+		if (freerdp_client_start(context) != 0)
+			goto fail;
+
+		const benchSnapshot start = bench_snapshot();
+		bench_run(bench);
+		const benchSnapshot end = bench_snapshot();
+
+		if (freerdp_client_stop(context) != 0)
+			goto fail;
+
+		if (output)
+		{
+			fp = winpr_fopen(output, "w");
+			if (!fp)
+			{
+				WLog_ERR(TAG, "failed to open %s", output);
+				fp = stdout;
+				goto fail;
+			}
+		}
+
+		bench_print(fp, bench, file, csv, &start, &end);
+		rc = bench->eof ? 0 : -1;
+	}
+
+fail:
+	if (fp != stdout)
+		(void)fclose(fp);
+	freerdp_client_context_free(context);
+	free((void*)args);
+	return rc;
+}
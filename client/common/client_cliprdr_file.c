@@ -54,6 +54,10 @@
 
 #include <freerdp/client/client_cliprdr_file.h>
 
+#if defined(WITH_FUSE)
+#include "cliprdr_readahead.h"
+#endif
+
 #define NO_CLIP_DATA_ID (UINT64_C(1) << 32)
 #define WIN32_FILETIME_TO_UNIX_EPOCH INT64_C(11644473600)
 
@@ -101,6 +105,10 @@ struct sCliprdrFuseFile
 
 	BOOL has_clip_data_id;
 	UINT32 clip_data_id;
+
+	/* created by the first read, once the size is known */
+	CliprdrFileContext* file_context;
+	CliprdrReadahead* readahead;
 };
 
 typedef struct
@@ -124,6 +132,7 @@ typedef struct
 	UINT32 clip_data_id;
 } FuseFileClearContext;
 
+/* FUSE_LL_OPERATION_READ requests fetch a chunk for fuse_file->readahead, fuse_req is NULL */
 typedef struct
 {
 	FuseLowlevelOperationType operation_type;
@@ -206,6 +215,8 @@ static void fuse_file_free(void* data)
 	if (!fuse_file)
 		return;
 
+	/* replies EIO to reads still waiting for data */
+	cliprdr_readahead_free(fuse_file->readahead);
 	ArrayList_Free(fuse_file->children);
 	free(fuse_file->filename_with_root);
 
@@ -380,7 +391,8 @@ static BOOL maybe_clear_fuse_request(const void* key, void* value, void* arg)
 	DEBUG_CLIPRDR(file_context->log, "Clearing FileContentsRequest for file \"%s\"",
 	              fuse_file->filename_with_root);
 
-	fuse_reply_err(fuse_request->fuse_req, EIO);
+	if (fuse_request->fuse_req)
+		fuse_reply_err(fuse_request->fuse_req, EIO);
 	HashTable_Remove(file_context->request_table, key);
 
 	return TRUE;
@@ -939,19 +951,20 @@ static void cliprdr_file_fuse_open(fuse_req_t fuse_req, fuse_ino_t fuse_ino,
 	fuse_reply_open(fuse_req, file_info);
 }
 
-static BOOL request_file_range_async(CliprdrFileContext* file_context, CliprdrFuseFile* fuse_file,
-                                     fuse_req_t fuse_req, off_t offset, size_t requested_size)
+static BOOL request_file_range_async(void* arg, UINT64 offset, UINT32 requested_size,
+                                     UINT32* stream_id)
 {
+	CliprdrFuseFile* fuse_file = arg;
 	CLIPRDR_FILE_CONTENTS_REQUEST file_contents_request = { 0 };
 
-	WINPR_ASSERT(file_context);
 	WINPR_ASSERT(fuse_file);
+	WINPR_ASSERT(stream_id);
 
-	if (requested_size > UINT32_MAX)
-		return FALSE;
+	CliprdrFileContext* file_context = fuse_file->file_context;
+	WINPR_ASSERT(file_context);
 
 	CliprdrFuseRequest* fuse_request =
-	    cliprdr_fuse_request_new(file_context, fuse_file, fuse_req, FUSE_LL_OPERATION_READ);
+	    cliprdr_fuse_request_new(file_context, fuse_file, NULL, FUSE_LL_OPERATION_READ);
 	if (!fuse_request)
 		return FALSE;
 
@@ -961,7 +974,7 @@ static BOOL request_file_range_async(CliprdrFileContext* file_context, CliprdrFu
 	file_contents_request.dwFlags = FILECONTENTS_RANGE;
 	file_contents_request.nPositionLow = (UINT32)(offset & 0xFFFFFFFF);
 	file_contents_request.nPositionHigh = (UINT32)((offset >> 32) & 0xFFFFFFFF);
-	file_contents_request.cbRequested = (UINT32)requested_size;
+	file_contents_request.cbRequested = requested_size;
 	file_contents_request.haveClipDataId = fuse_file->has_clip_data_id;
 	file_contents_request.clipDataId = fuse_file->clip_data_id;
 
@@ -977,15 +990,27 @@ static BOOL request_file_range_async(CliprdrFileContext* file_context, CliprdrFu
 
 	// file_context->request_table owns fuse_request
 	// NOLINTBEGIN(clang-analyzer-unix.Malloc)
-	DEBUG_CLIPRDR(
-	    file_context->log,
-	    "Requested file range (%zu Bytes at offset %lu) for file \"%s\" with stream id %u",
-	    requested_size, offset, fuse_file->filename, fuse_request->stream_id);
+	DEBUG_CLIPRDR(file_context->log,
+	              "Requested file range (%" PRIu32 " Bytes at offset %" PRIu64
+	              ") for file \"%s\" with stream id %u",
+	              requested_size, offset, fuse_file->filename, fuse_request->stream_id);
 
+	*stream_id = fuse_request->stream_id;
 	return TRUE;
 	// NOLINTEND(clang-analyzer-unix.Malloc)
 }
 
+static void reply_file_range(WINPR_ATTR_UNUSED void* arg, void* request, const BYTE* data,
+                             size_t size, int error)
+{
+	fuse_req_t fuse_req = request;
+
+	if (error != 0)
+		fuse_reply_err(fuse_req, error);
+	else
+		fuse_reply_buf(fuse_req, (const char*)data, size);
+}
+
 static void cliprdr_file_fuse_read(fuse_req_t fuse_req, fuse_ino_t fuse_ino, size_t size,
                                    off_t offset, WINPR_ATTR_UNUSED struct fuse_file_info* file_info)
 {
@@ -1017,7 +1042,15 @@ static void cliprdr_file_fuse_read(fuse_req_t fuse_req, fuse_ino_t fuse_ino, siz
 
 	size = MIN(size, 8ULL * 1024ULL * 1024ULL);
 
-	result = request_file_range_async(file_context, fuse_file, fuse_req, offset, size);
+	/* replied once the chunks covering the range arrived, sequential reads fetch ahead */
+	if (!fuse_file->readahead)
+	{
+		fuse_file->file_context = file_context;
+		fuse_file->readahead = cliprdr_readahead_new(fuse_file->size, request_file_range_async,
+		                                             reply_file_range, fuse_file);
+	}
+	if (fuse_file->readahead)
+		result = cliprdr_readahead_read(fuse_file->readahead, fuse_req, (UINT64)offset, size);
 	HashTable_Unlock(file_context->inode_table);
 
 	if (!result)
@@ -1230,6 +1263,32 @@ static UINT cliprdr_file_context_server_file_contents_response(
 		return CHANNEL_RC_OK;
 	}
 
+	if (fuse_request->operation_type == FUSE_LL_OPERATION_READ)
+	{
+		DEBUG_CLIPRDR(file_context->log, "Received file range for file \"%s\" with stream id %u",
+		              fuse_request->fuse_file->filename, file_contents_response->streamId);
+
+		CliprdrReadahead* readahead = fuse_request->fuse_file->readahead;
+		WINPR_ASSERT(readahead);
+
+		if (!(file_contents_response->common.msgFlags & CB_RESPONSE_OK))
+		{
+			WLog_Print(file_context->log, WLOG_WARN,
+			           "FileContentsRequests for file \"%s\" was unsuccessful",
+			           fuse_request->fuse_file->filename);
+			(void)cliprdr_readahead_fail(readahead, file_contents_response->streamId);
+		}
+		else
+			(void)cliprdr_readahead_data(readahead, file_contents_response->streamId,
+			                             file_contents_response->requestedData,
+			                             file_contents_response->cbRequested);
+
+		HashTable_Remove(file_context->request_table,
+		                 (void*)(uintptr_t)file_contents_response->streamId);
+		HashTable_Unlock(file_context->inode_table);
+		return CHANNEL_RC_OK;
+	}
+
 	if (!(file_contents_response->common.msgFlags & CB_RESPONSE_OK))
 	{
 		WLog_Print(file_context->log, WLOG_WARN,
@@ -1271,11 +1330,6 @@ static UINT cliprdr_file_context_server_file_contents_response(
 		entry.attr_timeout = 1.0;
 		entry.entry_timeout = 1.0;
 	}
-	else if (fuse_request->operation_type == FUSE_LL_OPERATION_READ)
-	{
-		DEBUG_CLIPRDR(file_context->log, "Received file range for file \"%s\" with stream id %u",
-		              fuse_request->fuse_file->filename, file_contents_response->streamId);
-	}
 	HashTable_Unlock(file_context->inode_table);
 
 	switch (fuse_request->operation_type)
@@ -1288,11 +1342,6 @@ static UINT cliprdr_file_context_server_file_contents_response(
 		case FUSE_LL_OPERATION_GETATTR:
 			fuse_reply_attr(fuse_request->fuse_req, &entry.attr, entry.attr_timeout);
 			break;
-		case FUSE_LL_OPERATION_READ:
-			fuse_reply_buf(fuse_request->fuse_req,
-			               (const char*)file_contents_response->requestedData,
-			               file_contents_response->cbRequested);
-			break;
 		default:
 			break;
 	}
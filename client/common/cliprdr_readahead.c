@@ -0,0 +1,423 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Clipboard file contents read-ahead
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <errno.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+
+#include <freerdp/types.h>
+
+#include "cliprdr_readahead.h"
+
+/* Reads are served from chunks of CLIPRDR_READAHEAD_CHUNK_SIZE, so the many small reads of a
+ * copy share one FileContents round trip. Once a file is read sequentially the chunks following
+ * the current read are requested as well, keeping up to CLIPRDR_READAHEAD_WINDOW requests in
+ * flight. Reads waiting for a chunk are queued and replied to as soon as it arrives. */
+
+typedef struct
+{
+	UINT64 index;
+	UINT32 id;
+	BOOL ready;
+	BYTE* data;
+	size_t size;
+	UINT64 lastUse;
+} CliprdrReadaheadChunk;
+
+typedef struct
+{
+	void* request;
+	UINT64 offset;
+	size_t size;
+} CliprdrReadaheadRead;
+
+struct s_cliprdr_readahead
+{
+	UINT64 size;
+	pcCliprdrReadaheadFetch fetch;
+	pcCliprdrReadaheadReply reply;
+	void* arg;
+
+	CliprdrReadaheadChunk* chunks;
+	size_t chunkCount;
+	size_t chunkCapacity;
+
+	CliprdrReadaheadRead* reads;
+	size_t readCount;
+	size_t readCapacity;
+
+	/* sequential access detection */
+	UINT64 nextOffset;
+	UINT32 sequential;
+	UINT64 aheadIndex;
+
+	UINT64 useCounter;
+	BYTE* buffer;
+	size_t bufferSize;
+};
+
+static UINT64 chunk_first(UINT64 offset)
+{
+	return offset / CLIPRDR_READAHEAD_CHUNK_SIZE;
+}
+
+static UINT64 chunk_last(UINT64 offset, size_t size)
+{
+	return (offset + size - 1) / CLIPRDR_READAHEAD_CHUNK_SIZE;
+}
+
+static CliprdrReadaheadChunk* chunk_find(CliprdrReadahead* ra, UINT64 index)
+{
+	for (size_t x = 0; x < ra->chunkCount; x++)
+	{
+		if (ra->chunks[x].index == index)
+			return &ra->chunks[x];
+	}
+	return NULL;
+}
+
+static CliprdrReadaheadChunk* chunk_find_id(CliprdrReadahead* ra, UINT32 id)
+{
+	for (size_t x = 0; x < ra->chunkCount; x++)
+	{
+		if (!ra->chunks[x].ready && (ra->chunks[x].id == id))
+			return &ra->chunks[x];
+	}
+	return NULL;
+}
+
+static void chunk_remove(CliprdrReadahead* ra, CliprdrReadaheadChunk* chunk)
+{
+	const size_t x = (size_t)(chunk - ra->chunks);
+	WINPR_ASSERT(x < ra->chunkCount);
+
+	free(chunk->data);
+	ra->chunks[x] = ra->chunks[--ra->chunkCount];
+}
+
+static BOOL chunk_request(CliprdrReadahead* ra, UINT64 index)
+{
+	if (chunk_find(ra, index))
+		return TRUE;
+
+	if (ra->chunkCount == ra->chunkCapacity)
+	{
+		const size_t capacity = MAX(16, ra->chunkCapacity * 2);
+		CliprdrReadaheadChunk* chunks =
+		    realloc(ra->chunks, capacity * sizeof(CliprdrReadaheadChunk));
+		if (!chunks)
+			return FALSE;
+		ra->chunks = chunks;
+		ra->chunkCapacity = capacity;
+	}
+
+	const UINT64 offset = index * CLIPRDR_READAHEAD_CHUNK_SIZE;
+	const UINT32 length = (UINT32)MIN(CLIPRDR_READAHEAD_CHUNK_SIZE, ra->size - offset);
+	CliprdrReadaheadChunk chunk = { .index = index };
+	if (!ra->fetch(ra->arg, offset, length, &chunk.id))
+		return FALSE;
+
+	ra->chunks[ra->chunkCount++] = chunk;
+	return TRUE;
+}
+
+static BOOL read_is_ready(CliprdrReadahead* ra, const CliprdrReadaheadRead* rd)
+{
+	for (UINT64 x = chunk_first(rd->offset); x <= chunk_last(rd->offset, rd->size); x++)
+	{
+		const CliprdrReadaheadChunk* chunk = chunk_find(ra, x);
+		if (!chunk || !chunk->ready)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL read_needs(const CliprdrReadaheadRead* rd, UINT64 index)
+{
+	return (index >= chunk_first(rd->offset)) && (index <= chunk_last(rd->offset, rd->size));
+}
+
+/* a chunk shorter than requested ends the data, like a short read */
+static void read_complete(CliprdrReadahead* ra, const CliprdrReadaheadRead* rd)
+{
+	const UINT64 first = chunk_first(rd->offset);
+	const UINT64 last = chunk_last(rd->offset, rd->size);
+	CliprdrReadaheadChunk* chunk = chunk_find(ra, first);
+	WINPR_ASSERT(chunk);
+
+	const size_t start = (size_t)(rd->offset - first * CLIPRDR_READAHEAD_CHUNK_SIZE);
+	chunk->lastUse = ++ra->useCounter;
+
+	if (first == last)
+	{
+		const size_t size = (chunk->size > start) ? MIN(rd->size, chunk->size - start) : 0;
+		ra->reply(ra->arg, rd->request, chunk->data + MIN(start, chunk->size), size, 0);
+		return;
+	}
+
+	if (ra->bufferSize < rd->size)
+	{
+		BYTE* buffer = realloc(ra->buffer, rd->size);
+		if (!buffer)
+		{
+			ra->reply(ra->arg, rd->request, NULL, 0, ENOMEM);
+			return;
+		}
+		ra->buffer = buffer;
+		ra->bufferSize = rd->size;
+	}
+
+	size_t size = 0;
+	size_t offset = start;
+	for (UINT64 x = first; (x <= last) && (size < rd->size); x++)
+	{
+		chunk = chunk_find(ra, x);
+		WINPR_ASSERT(chunk);
+		chunk->lastUse = ra->useCounter;
+
+		if (chunk->size <= offset)
+			break;
+
+		const size_t length = MIN(rd->size - size, chunk->size - offset);
+		memcpy(&ra->buffer[size], &chunk->data[offset], length);
+		size += length;
+		if (chunk->size < CLIPRDR_READAHEAD_CHUNK_SIZE)
+			break;
+		offset = 0;
+	}
+	ra->reply(ra->arg, rd->request, ra->buffer, size, 0);
+}
+
+static void read_remove(CliprdrReadahead* ra, size_t x)
+{
+	WINPR_ASSERT(x < ra->readCount);
+	memmove(&ra->reads[x], &ra->reads[x + 1], (ra->readCount - x - 1) * sizeof(ra->reads[0]));
+	ra->readCount--;
+}
+
+static BOOL read_queue(CliprdrReadahead* ra, void* request, UINT64 offset, size_t size)
+{
+	if (ra->readCount == ra->readCapacity)
+	{
+		const size_t capacity = MAX(16, ra->readCapacity * 2);
+		CliprdrReadaheadRead* reads = realloc(ra->reads, capacity * sizeof(CliprdrReadaheadRead));
+		if (!reads)
+			return FALSE;
+		ra->reads = reads;
+		ra->readCapacity = capacity;
+	}
+
+	const CliprdrReadaheadRead rd = { .request = request, .offset = offset, .size = size };
+	ra->reads[ra->readCount++] = rd;
+	return TRUE;
+}
+
+static BOOL chunk_is_needed(CliprdrReadahead* ra, UINT64 index)
+{
+	for (size_t x = 0; x < ra->readCount; x++)
+	{
+		if (read_needs(&ra->reads[x], index))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* drops the least recently used chunks no queued read waits for */
+static void cache_trim(CliprdrReadahead* ra)
+{
+	while (TRUE)
+	{
+		size_t ready = 0;
+		CliprdrReadaheadChunk* oldest = NULL;
+
+		for (size_t x = 0; x < ra->chunkCount; x++)
+		{
+			CliprdrReadaheadChunk* chunk = &ra->chunks[x];
+			if (!chunk->ready || chunk_is_needed(ra, chunk->index))
+				continue;
+
+			ready++;
+			if (!oldest || (chunk->lastUse < oldest->lastUse))
+				oldest = chunk;
+		}
+
+		if (ready <= CLIPRDR_READAHEAD_CACHE_CHUNKS)
+			return;
+		chunk_remove(ra, oldest);
+	}
+}
+
+static void complete_ready_reads(CliprdrReadahead* ra)
+{
+	for (size_t x = 0; x < ra->readCount;)
+	{
+		if (!read_is_ready(ra, &ra->reads[x]))
+		{
+			x++;
+			continue;
+		}
+
+		const CliprdrReadaheadRead rd = ra->reads[x];
+		read_remove(ra, x);
+		read_complete(ra, &rd);
+	}
+}
+
+static void read_ahead(CliprdrReadahead* ra, UINT64 last)
+{
+	const UINT32 depth = MIN(ra->sequential, CLIPRDR_READAHEAD_WINDOW);
+	const UINT64 chunks = chunk_last(0, ra->size) + 1;
+
+	ra->aheadIndex = MAX(ra->aheadIndex, last + 1);
+	while ((ra->aheadIndex <= last + depth) && (ra->aheadIndex < chunks))
+	{
+		if (!chunk_request(ra, ra->aheadIndex))
+			return;
+		ra->aheadIndex++;
+	}
+}
+
+CliprdrReadahead* cliprdr_readahead_new(UINT64 size, pcCliprdrReadaheadFetch fetch,
+                                        pcCliprdrReadaheadReply reply, void* arg)
+{
+	WINPR_ASSERT(fetch);
+	WINPR_ASSERT(reply);
+
+	CliprdrReadahead* ra = calloc(1, sizeof(CliprdrReadahead));
+	if (!ra)
+		return NULL;
+
+	ra->size = size;
+	ra->fetch = fetch;
+	ra->reply = reply;
+	ra->arg = arg;
+	return ra;
+}
+
+void cliprdr_readahead_free(CliprdrReadahead* ra)
+{
+	if (!ra)
+		return;
+
+	for (size_t x = 0; x < ra->readCount; x++)
+		ra->reply(ra->arg, ra->reads[x].request, NULL, 0, EIO);
+	for (size_t x = 0; x < ra->chunkCount; x++)
+		free(ra->chunks[x].data);
+
+	free(ra->reads);
+	free(ra->chunks);
+	free(ra->buffer);
+	free(ra);
+}
+
+BOOL cliprdr_readahead_read(CliprdrReadahead* ra, void* request, UINT64 offset, size_t size)
+{
+	WINPR_ASSERT(ra);
+
+	if ((offset >= ra->size) || (size == 0))
+	{
+		ra->reply(ra->arg, request, NULL, 0, 0);
+		return TRUE;
+	}
+	size = (size_t)MIN(size, ra->size - offset);
+
+	if (offset == ra->nextOffset)
+		ra->sequential = MIN(ra->sequential + 1, CLIPRDR_READAHEAD_WINDOW);
+	else
+	{
+		ra->sequential = 0;
+		ra->aheadIndex = 0;
+	}
+	ra->nextOffset = offset + size;
+
+	const UINT64 first = chunk_first(offset);
+	const UINT64 last = chunk_last(offset, size);
+	for (UINT64 x = first; x <= last; x++)
+	{
+		if (!chunk_request(ra, x))
+			return FALSE;
+	}
+
+	const CliprdrReadaheadRead rd = { .request = request, .offset = offset, .size = size };
+	if (read_is_ready(ra, &rd))
+		read_complete(ra, &rd);
+	else if (!read_queue(ra, request, offset, size))
+		return FALSE;
+
+	read_ahead(ra, last);
+	cache_trim(ra);
+	return TRUE;
+}
+
+BOOL cliprdr_readahead_data(CliprdrReadahead* ra, UINT32 id, const BYTE* data, size_t size)
+{
+	WINPR_ASSERT(ra);
+	WINPR_ASSERT(data || (size == 0));
+
+	CliprdrReadaheadChunk* chunk = chunk_find_id(ra, id);
+	if (!chunk)
+		return FALSE;
+
+	const UINT64 offset = chunk->index * CLIPRDR_READAHEAD_CHUNK_SIZE;
+	size = (size_t)MIN(size, MIN(CLIPRDR_READAHEAD_CHUNK_SIZE, ra->size - offset));
+
+	chunk->data = malloc(MAX(size, 1));
+	if (!chunk->data)
+		return cliprdr_readahead_fail(ra, id);
+
+	memcpy(chunk->data, data, size);
+	chunk->size = size;
+	chunk->ready = TRUE;
+	chunk->lastUse = ++ra->useCounter;
+
+	complete_ready_reads(ra);
+	cache_trim(ra);
+	return TRUE;
+}
+
+BOOL cliprdr_readahead_fail(CliprdrReadahead* ra, UINT32 id)
+{
+	WINPR_ASSERT(ra);
+
+	CliprdrReadaheadChunk* chunk = chunk_find_id(ra, id);
+	if (!chunk)
+		return FALSE;
+
+	const UINT64 index = chunk->index;
+	chunk_remove(ra, chunk);
+
+	for (size_t x = 0; x < ra->readCount;)
+	{
+		if (!read_needs(&ra->reads[x], index))
+		{
+			x++;
+			continue;
+		}
+
+		void* request = ra->reads[x].request;
+		read_remove(ra, x);
+		ra->reply(ra->arg, request, NULL, 0, EIO);
+	}
+
+	/* a retry starts over without read-ahead */
+	ra->sequential = 0;
+	ra->aheadIndex = 0;
+	return TRUE;
+}
@@ -0,0 +1,62 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Clipboard file contents read-ahead
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CLIENT_COMMON_CLIPRDR_READAHEAD_H
+#define FREERDP_CLIENT_COMMON_CLIPRDR_READAHEAD_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+/* FileContents range requests are issued for whole chunks of this size */
+#define CLIPRDR_READAHEAD_CHUNK_SIZE (1024 * 1024)
+
+/* chunks requested ahead of a sequential reader */
+#define CLIPRDR_READAHEAD_WINDOW 4
+
+/* received chunks kept per file */
+#define CLIPRDR_READAHEAD_CACHE_CHUNKS 8
+
+typedef struct s_cliprdr_readahead CliprdrReadahead;
+
+/* sends a FILECONTENTS_RANGE request, the response is passed on with the returned id */
+typedef BOOL (*pcCliprdrReadaheadFetch)(void* arg, UINT64 offset, UINT32 length, UINT32* id);
+
+/* completes a read, error is an errno value and data is NULL on failure */
+typedef void (*pcCliprdrReadaheadReply)(void* arg, void* request, const BYTE* data, size_t size,
+                                        int error);
+
+/* Not synchronized, the caller serializes all calls. Replies are delivered from within
+ * cliprdr_readahead_read, cliprdr_readahead_data, cliprdr_readahead_fail and
+ * cliprdr_readahead_free. */
+FREERDP_LOCAL void cliprdr_readahead_free(CliprdrReadahead* ra);
+
+WINPR_ATTR_MALLOC(cliprdr_readahead_free, 1)
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL CliprdrReadahead* cliprdr_readahead_new(UINT64 size, pcCliprdrReadaheadFetch fetch,
+                                                      pcCliprdrReadaheadReply reply, void* arg);
+
+/* returns FALSE without replying if the read could not be queued */
+FREERDP_LOCAL BOOL cliprdr_readahead_read(CliprdrReadahead* ra, void* request, UINT64 offset,
+                                          size_t size);
+
+/* returns FALSE if id does not belong to an outstanding request of ra */
+FREERDP_LOCAL BOOL cliprdr_readahead_data(CliprdrReadahead* ra, UINT32 id, const BYTE* data,
+                                          size_t size);
+FREERDP_LOCAL BOOL cliprdr_readahead_fail(CliprdrReadahead* ra, UINT32 id);
+
+#endif /* FREERDP_CLIENT_COMMON_CLIPRDR_READAHEAD_H */
@@ -3437,6 +3437,18 @@ static int parse_mouse_options(rdpSettings* settings, const COMMAND_LINE_ARGUMEN
 		{
 			const char* cur = ptr[x];
 
+			if (option_starts_with("batch:", cur))
+			{
+				LONGLONG val = 0;
+				if (!value_to_int(&cur[6], &val, 0, 1000) ||
+				    !freerdp_settings_set_uint32(settings, FreeRDP_InputBatchLatency, (UINT32)val))
+				{
+					rc = COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+					break;
+				}
+				continue;
+			}
+
 			const PARSE_ON_OFF_RESULT bval = parse_on_off_option(cur);
 			if (bval == PARSE_FAIL)
 				rc = COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
@@ -4961,6 +4973,13 @@ static int parse_command_line(rdpSettings* settings, const COMMAND_LINE_ARGUMENT
 			if (!freerdp_settings_set_bool(settings, FreeRDP_RedirectDrives, enable))
 				return fail_at(arg, COMMAND_LINE_ERROR);
 		}
+		CommandLineSwitchCase(arg, "drive-batch")
+		{
+			const int rc = parse_command_line_option_uint32(
+			    settings, arg, FreeRDP_DriveDirectoryBatchSize, 0, 65536);
+			if (rc != 0)
+				return fail_at(arg, rc);
+		}
 		CommandLineSwitchCase(arg, "dump")
 		{
 			const int rc = parse_dump_options(settings, arg);
@@ -152,6 +152,9 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  "Redirect directory <path> as named share <name>. Hotplug support is enabled with "
 	  "/drive:hotplug,*. This argument provides the same function as \"Drives that I plug in "
 	  "later\" option in MSTSC." },
+	{ "drive-batch", COMMAND_LINE_VALUE_REQUIRED, "<size>", "0", NULL, -1, NULL,
+	  "Return as many directory entries as fit into <size> bytes per drive directory query "
+	  "[0 (default) returns one entry, the server must accept multiple entries]" },
 	{ "drives", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 	  "Redirect all mount points as shares" },
 	{ "dump", COMMAND_LINE_VALUE_REQUIRED, "<record|replay>,file:<file>[,nodelay]", NULL, NULL, -1,
@@ -336,11 +339,12 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  "Send mouse motion events" },
 	{ "mouse-relative", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 	  "Send mouse motion with relative addressing" },
-	{ "mouse", COMMAND_LINE_VALUE_REQUIRED, "[relative:[on|off],grab:[on|off]]", NULL, NULL, -1,
-	  NULL,
+	{ "mouse", COMMAND_LINE_VALUE_REQUIRED, "[relative:[on|off],grab:[on|off],batch:<ms>]", NULL,
+	  NULL, -1, NULL,
 	  "Mouse related options:\n"
 	  " * relative:   send relative mouse movements if supported by server\n"
-	  " * grab:       grab the mouse if within the window" },
+	  " * grab:       grab the mouse if within the window\n"
+	  " * batch:      coalesce mouse movements for up to <ms> milliseconds (0 disables)" },
 #if defined(CHANNEL_TSMF_CLIENT)
 	{ "multimedia", COMMAND_LINE_VALUE_OPTIONAL, "[sys:<sys>,][dev:<dev>,][decoder:<decoder>]",
 	  NULL, NULL, -1, "mmr", "[DEPRECATED], use /video] Redirect multimedia (video)" },
@@ -452,7 +456,7 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  -1, NULL, "Activates Smartcard (optional certificate) Logon authentication." },
 	{ "sound", COMMAND_LINE_VALUE_OPTIONAL,
 	  "[sys:<sys>,][dev:<dev>,][format:<format>,][rate:<rate>,][channel:<channel>,][latency:<"
-	  "latency>,][quality:<quality>]",
+	  "latency>,][quality:<quality>,][jitter:<max delay ms, 0 disables>]",
 	  NULL, NULL, -1, "audio", "Audio output (sound)" },
 	{ "span", COMMAND_LINE_VALUE_FLAG, NULL, NULL, NULL, -1, NULL,
 	  "Span screen over multiple monitors" },
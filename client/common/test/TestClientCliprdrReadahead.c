@@ -0,0 +1,274 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
+
+#include <freerdp/types.h>
+
+#include "../cliprdr_readahead.h"
+
+#define TEST_FILE_SIZE (64ull * 1024ull * 1024ull + 12345ull)
+#define TEST_READ_SIZE (128 * 1024)
+#define TEST_LATENCY_US 2000
+
+/* a FileContents request in flight to the simulated server */
+typedef struct
+{
+	UINT32 id;
+	UINT64 offset;
+	UINT32 length;
+	UINT64 due;
+	BOOL direct;
+} test_fetch;
+
+typedef struct
+{
+	CRITICAL_SECTION lock;
+	CliprdrReadahead* ra;
+	wMessageQueue* server;
+	UINT32 nextId;
+	size_t fetches;
+
+	/* the single outstanding read of the copying application */
+	HANDLE done;
+	BYTE* buffer;
+	size_t size;
+	int error;
+} test_context;
+
+static BYTE test_pattern(UINT64 offset)
+{
+	return (BYTE)(offset ^ (offset >> 8) ^ (offset >> 16) ^ (offset >> 24));
+}
+
+static BOOL test_post(test_context* context, UINT64 offset, UINT32 length, BOOL direct,
+                      UINT32* id)
+{
+	test_fetch* fetch = calloc(1, sizeof(test_fetch));
+	if (!fetch)
+		return FALSE;
+
+	fetch->id = ++context->nextId;
+	fetch->offset = offset;
+	fetch->length = length;
+	fetch->due = winpr_GetTickCount64NS() + TEST_LATENCY_US * 1000ull;
+	fetch->direct = direct;
+	if (!MessageQueue_Post(context->server, NULL, 0, fetch, NULL))
+	{
+		free(fetch);
+		return FALSE;
+	}
+
+	context->fetches++;
+	if (id)
+		*id = fetch->id;
+	return TRUE;
+}
+
+static BOOL test_fetch_cb(void* arg, UINT64 offset, UINT32 length, UINT32* id)
+{
+	return test_post(arg, offset, length, FALSE, id);
+}
+
+static void test_reply_cb(void* arg, WINPR_ATTR_UNUSED void* request, const BYTE* data,
+                          size_t size, int error)
+{
+	test_context* context = arg;
+
+	context->error = error;
+	context->size = size;
+	if (size > 0)
+		memcpy(context->buffer, data, size);
+	(void)SetEvent(context->done);
+}
+
+/* answers requests in order, each one round trip after it was sent */
+static DWORD WINAPI test_server_thread(LPVOID arg)
+{
+	test_context* context = arg;
+	BYTE* data = malloc(CLIPRDR_READAHEAD_CHUNK_SIZE);
+	if (!data)
+		return 1;
+
+	while (MessageQueue_Wait(context->server))
+	{
+		wMessage message = { 0 };
+		if (!MessageQueue_Peek(context->server, &message, TRUE) || (message.id == WMQ_QUIT))
+			break;
+
+		test_fetch* fetch = message.wParam;
+		const UINT64 now = winpr_GetTickCount64NS();
+		if (fetch->due > now)
+			USleep((DWORD)((fetch->due - now) / 1000));
+
+		const UINT32 length = (UINT32)MIN(fetch->length, CLIPRDR_READAHEAD_CHUNK_SIZE);
+		for (UINT32 x = 0; x < length; x++)
+			data[x] = test_pattern(fetch->offset + x);
+
+		EnterCriticalSection(&context->lock);
+		if (fetch->direct)
+			test_reply_cb(context, NULL, data, length, 0);
+		else if (!cliprdr_readahead_data(context->ra, fetch->id, data, length))
+			(void)fprintf(stderr, "unexpected response %" PRIu32 "\n", fetch->id);
+		LeaveCriticalSection(&context->lock);
+		free(fetch);
+	}
+
+	free(data);
+	return 0;
+}
+
+static void test_message_free(void* obj)
+{
+	wMessage* msg = obj;
+	if (msg && (msg->id == 0))
+		free(msg->wParam);
+}
+
+/* direct reads request exactly the read range, like one FileContents request per FUSE read */
+static BOOL test_read(test_context* context, UINT64 offset, size_t size, BOOL direct)
+{
+	BOOL rc = FALSE;
+
+	EnterCriticalSection(&context->lock);
+	(void)ResetEvent(context->done);
+	if (direct)
+		rc = test_post(context, offset, (UINT32)size, TRUE, NULL);
+	else
+		rc = cliprdr_readahead_read(context->ra, NULL, offset, size);
+	LeaveCriticalSection(&context->lock);
+
+	if (!rc || (WaitForSingleObject(context->done, INFINITE) != WAIT_OBJECT_0))
+		return FALSE;
+	if (context->error != 0)
+		return FALSE;
+
+	const size_t expected = (offset < TEST_FILE_SIZE) ? MIN(size, TEST_FILE_SIZE - offset) : 0;
+	if (context->size != expected)
+	{
+		(void)fprintf(stderr, "read at %" PRIu64 " returned %" PRIuz " instead of %" PRIuz "\n",
+		              offset, context->size, expected);
+		return FALSE;
+	}
+
+	for (size_t x = 0; x < context->size; x++)
+	{
+		if (context->buffer[x] != test_pattern(offset + x))
+		{
+			(void)fprintf(stderr, "data mismatch at %" PRIu64 "\n", offset + x);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL test_copy(test_context* context, BOOL direct, double* rate)
+{
+	context->fetches = 0;
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (UINT64 offset = 0; offset < TEST_FILE_SIZE; offset += TEST_READ_SIZE)
+	{
+		const size_t size = (size_t)MIN(TEST_READ_SIZE, TEST_FILE_SIZE - offset);
+		if (!test_read(context, offset, size, direct))
+			return FALSE;
+	}
+
+	const UINT64 diff = MAX(1, winpr_GetTickCount64NS() - start);
+	*rate = (double)TEST_FILE_SIZE * 1000000000.0 / 1024.0 / 1024.0 / (double)diff;
+	printf("%-10s: %.1f MiB with %" PRIuz " requests in %.1fms, %.1f MiB/s\n",
+	       direct ? "direct" : "read-ahead", (double)TEST_FILE_SIZE / 1024.0 / 1024.0,
+	       context->fetches, (double)diff / 1000000.0, *rate);
+	return TRUE;
+}
+
+/* seeks, reads spanning chunks and reads at the end of the file */
+static BOOL test_random(test_context* context)
+{
+	const UINT64 offsets[] = { 5ull * CLIPRDR_READAHEAD_CHUNK_SIZE - 100,
+		                       17,
+		                       TEST_FILE_SIZE - 10,
+		                       TEST_FILE_SIZE,
+		                       33ull * CLIPRDR_READAHEAD_CHUNK_SIZE + 7,
+		                       4ull * CLIPRDR_READAHEAD_CHUNK_SIZE };
+	const size_t sizes[] = { 3 * CLIPRDR_READAHEAD_CHUNK_SIZE, 4096, 4096, 4096, 1, 65536 };
+
+	for (size_t x = 0; x < ARRAYSIZE(offsets); x++)
+	{
+		if (!test_read(context, offsets[x], sizes[x], FALSE))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+int TestClientCliprdrReadahead(int argc, char* argv[])
+{
+	int rc = -1;
+	HANDLE thread = NULL;
+	test_context context = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	InitializeCriticalSection(&context.lock);
+	context.server = MessageQueue_New(NULL);
+	context.done = CreateEventA(NULL, TRUE, FALSE, NULL);
+	context.buffer = malloc(3 * CLIPRDR_READAHEAD_CHUNK_SIZE);
+	context.ra = cliprdr_readahead_new(TEST_FILE_SIZE, test_fetch_cb, test_reply_cb, &context);
+	if (!context.server || !context.done || !context.buffer || !context.ra)
+		goto fail;
+	MessageQueue_Object(context.server)->fnObjectFree = test_message_free;
+
+	thread = CreateThread(NULL, 0, test_server_thread, &context, 0, NULL);
+	if (!thread)
+		goto fail;
+
+	double direct = 0.0;
+	double readahead = 0.0;
+	if (!test_copy(&context, TRUE, &direct))
+		goto fail;
+	if (!test_copy(&context, FALSE, &readahead))
+		goto fail;
+	if (!test_random(&context))
+		goto fail;
+
+	if (readahead < 2.0 * direct)
+	{
+		(void)fprintf(stderr, "read-ahead is not faster: %.1f vs %.1f MiB/s\n", readahead, direct);
+		goto fail;
+	}
+	rc = 0;
+
+fail:
+	if (thread)
+	{
+		(void)MessageQueue_PostQuit(context.server, 0);
+		(void)WaitForSingleObject(thread, INFINITE);
+		(void)CloseHandle(thread);
+	}
+	cliprdr_readahead_free(context.ra);
+	MessageQueue_Free(context.server);
+	if (context.done)
+		(void)CloseHandle(context.done);
+	free(context.buffer);
+	DeleteCriticalSection(&context.lock);
+	return rc;
+}
@@ -107,6 +107,31 @@ static BOOL check_settings_smartcard_no_redirection(rdpSettings* settings)
 	return result;
 }
 
+static BOOL check_settings_input_batch_latency(rdpSettings* settings)
+{
+	const UINT32 latency = freerdp_settings_get_uint32(settings, FreeRDP_InputBatchLatency);
+	if (latency != 2)
+	{
+		TEST_FAILURE("Expected InputBatchLatency = 2,  but InputBatchLatency = %" PRIu32 "!\n",
+		             latency);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL check_settings_drive_batch(rdpSettings* settings)
+{
+	const UINT32 size = freerdp_settings_get_uint32(settings, FreeRDP_DriveDirectoryBatchSize);
+	if (size != 16384)
+	{
+		TEST_FAILURE("Expected DriveDirectoryBatchSize = 16384,  but "
+		             "DriveDirectoryBatchSize = %" PRIu32 "!\n",
+		             size);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 typedef struct
 {
 	int expected_status;
@@ -203,6 +228,18 @@ static const test tests[] = {
 	  check_settings_smartcard_no_redirection,
 	  { "testfreerdp", "/sound", "/drive:media,/foo/bar/blabla", "/v:test.freerdp.com", 0 },
 	  { { 0 } } },
+	{ 0,
+	  check_settings_input_batch_latency,
+	  { "testfreerdp", "/mouse:relative:on,batch:2", "/v:test.freerdp.com", 0 },
+	  { { 0 } } },
+	{ COMMAND_LINE_ERROR_UNEXPECTED_VALUE,
+	  NULL,
+	  { "testfreerdp", "/mouse:batch:5000", "/v:test.freerdp.com", 0 },
+	  { { 0 } } },
+	{ 0,
+	  check_settings_drive_batch,
+	  { "testfreerdp", "/drive-batch:16384", "/v:test.freerdp.com", 0 },
+	  { { 0 } } },
 };
 // NOLINTEND(bugprone-suspicious-missing-comma)
 
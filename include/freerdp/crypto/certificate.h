@@ -24,6 +24,7 @@
 #include <winpr/crypto.h>
 
 #include <freerdp/api.h>
+#include <freerdp/crypto/privatekey.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -165,6 +166,27 @@ extern "C"
 	FREERDP_API char* freerdp_certificate_get_param(const rdpCertificate* cert,
 	                                                enum FREERDP_CERT_PARAM what, size_t* psize);
 
+	/** @brief Create a copy of a certificate (including the chain)
+	 *
+	 *  @param certificate The certificate to copy
+	 *  @return A new certificate that must be freed with \b freerdp_certificate_free or \b NULL
+	 *  @since version 3.23.0
+	 */
+	WINPR_ATTR_MALLOC(freerdp_certificate_free, 1)
+	WINPR_ATTR_NODISCARD
+	FREERDP_API rdpCertificate* freerdp_certificate_clone(const rdpCertificate* certificate);
+
+	/** @brief Check if a private key belongs to the public key of a certificate
+	 *
+	 *  @param cert The certificate to check
+	 *  @param key The private key to check
+	 *  @return \b TRUE if \b key matches \b cert, \b FALSE otherwise
+	 *  @since version 3.23.0
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_API BOOL freerdp_certificate_is_key_match(const rdpCertificate* cert,
+	                                                  const rdpPrivateKey* key);
+
 #ifdef __cplusplus
 }
 #endif
@@ -97,6 +97,16 @@ extern "C"
 	WINPR_ATTR_NODISCARD
 	FREERDP_API BOOL freerdp_key_generate(rdpPrivateKey* key, const char* type, size_t count, ...);
 
+	/** @brief Create a copy of a private key
+	 *
+	 *  @param key The key to copy
+	 *  @return A new key that must be freed with \b freerdp_key_free or \b NULL on failure
+	 *  @since version 3.23.0
+	 */
+	WINPR_ATTR_MALLOC(freerdp_key_free, 1)
+	WINPR_ATTR_NODISCARD
+	FREERDP_API rdpPrivateKey* freerdp_key_clone(const rdpPrivateKey* key);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,15 @@
 #include <freerdp/api.h>
 #include <freerdp/gdi/gdi.h>
 
+/** @brief Upper limit of GDI_WND::ninvalid, further rectangles are merged
+ *  @since version 3.23.0 */
+#define GDI_INVALID_MAX_RECTS 64
+
+/** @brief The cost of an invalid rectangle in pixels. Two rectangles are merged if their
+ *  bounding box adds at most that many pixels that did not change.
+ *  @since version 3.23.0 */
+#define GDI_INVALID_RECT_COST 4096
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -89,9 +98,19 @@ extern "C"
 	WINPR_ATTR_NODISCARD
 	FREERDP_API BOOL gdi_PtInRect(const GDI_RECT* rc, INT32 x, INT32 y);
 
+	/** @brief Adds a rectangle to the invalid region (the bounding box) and the list of
+	 *  invalid rectangles of hdc. Overlapping and adjacent rectangles are merged, see
+	 *  GDI_INVALID_RECT_COST and GDI_INVALID_MAX_RECTS.
+	 */
 	WINPR_ATTR_NODISCARD
 	FREERDP_API BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h);
 
+	/** @brief The cost of pushing the invalid rectangles of hwnd: the number of pixels plus
+	 *  GDI_INVALID_RECT_COST per rectangle.
+	 *  @since version 3.23.0 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_API UINT64 gdi_InvalidRegionCost(const GDI_WND* hwnd);
+
 #ifdef __cplusplus
 }
 #endif
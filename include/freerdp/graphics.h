@@ -124,6 +124,25 @@ extern "C"
 	typedef BOOL (*pGlyph_SetBounds)(rdpContext* context, INT32 x, INT32 y, INT32 width,
 	                                 INT32 height);
 
+	/** @brief A glyph of a text run, the arguments of a pGlyph_Draw call
+	 *  @since version 3.23.0 */
+	typedef struct
+	{
+		const rdpGlyph* glyph;
+		INT32 x;
+		INT32 y;
+		INT32 w;
+		INT32 h;
+		INT32 sx;
+		INT32 sy;
+	} rdpGlyphRunEntry;
+
+	/** @brief Draws all glyphs of a text run between BeginDraw and EndDraw in order, the result
+	 *  must be the same as calling Draw for each entry.
+	 *  @since version 3.23.0 */
+	typedef BOOL (*pGlyph_DrawRun)(rdpContext* context, const rdpGlyphRunEntry* entries,
+	                               size_t count, BOOL fOpRedundant);
+
 	struct rdp_glyph
 	{
 		size_t size;                /* 0 */
@@ -133,7 +152,12 @@ extern "C"
 		WINPR_ATTR_NODISCARD pGlyph_BeginDraw BeginDraw; /* 4 */
 		WINPR_ATTR_NODISCARD pGlyph_EndDraw EndDraw;     /* 5 */
 		WINPR_ATTR_NODISCARD pGlyph_SetBounds SetBounds; /* 6 */
-		UINT32 paddingA[16 - 7];    /* 7 */
+		union
+		{
+			WINPR_ATTR_NODISCARD pGlyph_DrawRun DrawRun; /* 7 */
+			UINT32 reservedDrawRun[2]; /* keeps the following offsets on 32 and 64 bit */
+		};
+		UINT32 paddingA[16 - 9]; /* 9 */
 
 		INT32 x;                  /* 16 */
 		INT32 y;                  /* 17 */
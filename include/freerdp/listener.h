@@ -80,6 +80,38 @@ extern "C"
 	WINPR_ATTR_NODISCARD
 	FREERDP_API freerdp_listener* freerdp_listener_new(void);
 
+	/** @brief Set up the TLS server context shared by all peers accepted by \b instance
+	 *
+	 *  Key, certificate and TLS options are taken from \b settings once, an accepted peer
+	 *  only needs a new TLS connection from it as long as it is configured with the same
+	 *  certificate. Peers keep the context they got when it is replaced (e.g. after a
+	 *  certificate reload), \b NULL settings remove it.
+	 *
+	 *  @param instance The listener
+	 *  @param settings The server settings, \b FreeRDP_RdpServerRsaKey and
+	 * \b FreeRDP_RdpServerCertificate are required
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.23.0
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_API BOOL freerdp_listener_set_tls_settings(freerdp_listener* instance,
+	                                                   const rdpSettings* settings);
+
+	/** @brief Share the current TLS server context of \b instance with \b client
+	 *
+	 *  Done for every peer the listener accepts, needed for peers created from another socket
+	 *  with \b freerdp_peer_new. Replaces the context \b client had before.
+	 *
+	 *  @param instance The listener
+	 *  @param client The peer
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.23.0
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_API BOOL freerdp_listener_attach_tls(freerdp_listener* instance, freerdp_peer* client);
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,6 +34,34 @@ extern "C"
 		UINT64 TotalCompressedBytes;
 		UINT64 TotalUncompressedBytes;
 		double TotalCompressionRatio;
+
+		UINT64 TotalTlsHandshakes;        /** @since version 3.23.0 */
+		UINT64 TotalTlsResumedHandshakes; /** @since version 3.23.0 */
+
+		UINT64 UpdateQueueMaxDepth;  /** @since version 3.23.0 */
+		UINT64 UpdateQueueCoalesced; /** @since version 3.23.0 */
+		UINT64 UpdateQueueDropped;   /** @since version 3.23.0 */
+
+		UINT64 TotalUpdateBytesCopied;     /** @since version 3.23.0 */
+		UINT64 TotalUpdateBytesReferenced; /** @since version 3.23.0 */
+
+		/** Input PDUs sent by number of client input events they carry, bucket \b n counts
+		 * PDUs with [2^n, 2^(n+1)) events (coalesced mouse moves count every merged event),
+		 * the last bucket everything above.
+		 *  @since version 3.23.0 */
+		UINT64 InputBatchSizes[8];
+		UINT64 InputEventsCoalesced; /** @since version 3.23.0 */
+
+		/** Audio output latency in ms from wave arrival until it is audible, including the
+		 * time queued in the jitter buffer and the reported device latency.
+		 *  @since version 3.23.0 */
+		UINT64 AudioLatency;
+		UINT64 AudioLatencyMax;   /** @since version 3.23.0 */
+		UINT64 AudioJitter;       /** smoothed wave arrival jitter in ms @since version 3.23.0 */
+		UINT64 AudioBufferTarget; /** jitter buffer target in ms @since version 3.23.0 */
+		UINT64 AudioUnderruns;    /** @since version 3.23.0 */
+		UINT64 AudioOverruns;     /** @since version 3.23.0 */
+		INT64 AudioDrift;         /** playback rate correction in ppm @since version 3.23.0 */
 	};
 	typedef struct rdp_metrics rdpMetrics;
 
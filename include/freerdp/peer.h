@@ -217,6 +217,13 @@ extern "C"
 		 * and supplementary creds (NTLM).
 		 */
 		ALIGN64 WINPR_ATTR_NODISCARD psPeerRemoteCredentials RemoteCredentials;
+		/**
+		 * @brief TlsServerContext The TLS server context shared with a listener, see
+		 * \b freerdp_listener_attach_tls. Owned by the library, do not modify.
+		 *
+		 * @since version 3.23.0
+		 */
+		ALIGN64 rdpTlsServerContext* TlsServerContext;
 	};
 
 	FREERDP_API void freerdp_peer_context_free(freerdp_peer* client);
@@ -139,6 +139,64 @@ typedef pstatus_t (*fn_copy_no_overlap_t)(BYTE* WINPR_RESTRICT pDstData, DWORD D
 	                                      const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
 	                                      UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
 	                                      const gdiPalette* WINPR_RESTRICT palette, UINT32 flags);
+/**
+ * @brief Convert a pointer shape (XOR and AND mask) to an image
+ *
+ * Pixels with the AND mask bit set are transparent if the XOR color is black and inverted if it
+ * is white. Inverted pixels are drawn in black and white, alternating with the pixel position.
+ *
+ * @param pXorMask The first source line of the XOR mask
+ * @param xorStep The XOR mask line width in bytes, negative for bottom up masks
+ * @param xorBpp The XOR mask color depth, one of 1, 24 or 32
+ * @param pAndMask The first source line of the AND mask, may be \b NULL if \b xorBpp > 1
+ * @param andStep The AND mask line width in bytes, negative for bottom up masks
+ * @param pDst The destination image buffer
+ * @param dstStep The destination image line width in bytes (including padding)
+ * @param DstFormat The destination image format @ref PIXEL_FORMAT
+ * @param width The width of the pointer in pixels
+ * @param height The height of the pointer in pixels
+ * @return \b <=0 for failure, success otherwise
+ * @since version 3.23.0
+ */
+typedef pstatus_t (*fn_pointerToRGB_8u_AC4R_t)(const BYTE* WINPR_RESTRICT pXorMask, INT32 xorStep,
+	                                           UINT32 xorBpp, const BYTE* WINPR_RESTRICT pAndMask,
+	                                           INT32 andStep, BYTE* WINPR_RESTRICT pDst,
+	                                           UINT32 dstStep, UINT32 DstFormat, UINT32 width,
+	                                           UINT32 height);
+/**
+ * @brief Convert a packed YUY2 (4:2:2) image to planar 4:2:0, as delivered by cameras
+ *
+ * The chroma of two vertically adjacent source lines is averaged, odd sizes are rounded up.
+ *
+ * @param pSrc The first source line, 4 bytes (Y0 U Y1 V) for every 2 pixels
+ * @param srcStep The source line width in bytes (including padding)
+ * @param pDst The destination planes, Y, U and V for I420 or Y and interleaved UV for NV12
+ *             (the third entry is not used then)
+ * @param dstStep The destination line widths in bytes (including padding)
+ * @param roi The size of the image in pixels
+ * @return \b <=0 for failure, success otherwise
+ * @since version 3.23.0
+ */
+typedef pstatus_t (*fn_YUY2ToYUV420_8u_C2P3R_t)(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+	                                            BYTE* WINPR_RESTRICT pDst[3],
+	                                            const UINT32 dstStep[3],
+	                                            const prim_size_t* WINPR_RESTRICT roi);
+
+/**
+ * @brief Convert between NV12 and I420, the luma is copied and the chroma (de)interleaved
+ *
+ * @param pSrc The source planes, 2 for NV12 (the third entry is not used) or 3 for I420
+ * @param srcStep The source line widths in bytes (including padding)
+ * @param pDst The destination planes, 3 for I420 or 2 for NV12 (the third entry is not used)
+ * @param dstStep The destination line widths in bytes (including padding)
+ * @param roi The size of the image in pixels, odd sizes are rounded up for the chroma
+ * @return \b <=0 for failure, success otherwise
+ * @since version 3.23.0
+ */
+typedef pstatus_t (*fn_YUV420Interleave_8u_t)(const BYTE* WINPR_RESTRICT pSrc[3],
+	                                          const UINT32 srcStep[3],
+	                                          BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+	                                          const prim_size_t* WINPR_RESTRICT roi);
 typedef pstatus_t (*fn_lShiftC_16s_inplace_t)(INT16* WINPR_RESTRICT pSrcDst, UINT32 val,
 	                                          UINT32 len);
 typedef pstatus_t (*fn_lShiftC_16s_t)(const INT16* WINPR_RESTRICT pSrc, UINT32 val,
@@ -302,6 +360,16 @@ typedef struct
 	WINPR_ATTR_NODISCARD fn_add_16s_inplace_t add_16s_inplace;         /** @since version 3.6.0 */
 	WINPR_ATTR_NODISCARD fn_lShiftC_16s_inplace_t lShiftC_16s_inplace; /** @since version 3.6.0 */
 	WINPR_ATTR_NODISCARD fn_copy_no_overlap_t copy_no_overlap;         /** @since version 3.6.0 */
+	/** @since version 3.23.0 */
+	WINPR_ATTR_NODISCARD fn_pointerToRGB_8u_AC4R_t pointerToRGB_8u_AC4R;
+	/** YUY2 to I420 (Y, U and V planes) @since version 3.23.0 */
+	WINPR_ATTR_NODISCARD fn_YUY2ToYUV420_8u_C2P3R_t YUY2ToYUV420_8u_C2P3R;
+	/** YUY2 to NV12 (Y and interleaved UV planes) @since version 3.23.0 */
+	WINPR_ATTR_NODISCARD fn_YUY2ToYUV420_8u_C2P3R_t YUY2ToNV12_8u_C2P2R;
+	/** NV12 to I420 @since version 3.23.0 */
+	WINPR_ATTR_NODISCARD fn_YUV420Interleave_8u_t NV12ToYUV420_8u_P2P3R;
+	/** I420 to NV12 @since version 3.23.0 */
+	WINPR_ATTR_NODISCARD fn_YUV420Interleave_8u_t YUV420ToNV12_8u_P3P2R;
 } primitives_t;
 
 typedef enum
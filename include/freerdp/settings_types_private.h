@@ -291,7 +291,9 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RemoteCredentialGuard);        /* 1114 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RestrictedAdminModeSupported); /** 1115
 		                                                             * @since version 3.16.0 */
-	UINT64 padding1152[1152 - 1116];                                /* 1116 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL TlsSessionResumption);         /** 1116
+	                                                                 * @since version 3.23.0 */
+	UINT64 padding1152[1152 - 1117];                                /* 1117 */
 
 	/* Connection Cookie */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL MstscCookieMode);      /* 1152 */
@@ -633,7 +635,8 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 char* KeyboardPipeName);     /* 2637 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL HasRelativeMouseEvent); /* 2638 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL HasQoeEvent);           /* 2639 */
-	UINT64 padding2688[2688 - 2640];                         /* 2640 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 InputBatchLatency);   /* 2640 */
+	UINT64 padding2688[2688 - 2641];                         /* 2641 */
 
 	/* Brush Capabilities */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 BrushSupportLevel); /* 2688 */
@@ -778,10 +781,11 @@ struct rdp_settings
 	UINT64 padding4288[4288 - 4165];                         /* 4165 */
 
 	/* Drive Redirection */
-	SETTINGS_DEPRECATED(ALIGN64 BOOL RedirectDrives);    /* 4288 */
-	SETTINGS_DEPRECATED(ALIGN64 BOOL RedirectHomeDrive); /* 4289 */
-	SETTINGS_DEPRECATED(ALIGN64 char* DrivesToRedirect); /* 4290 */
-	UINT64 padding4416[4416 - 4291];                     /* 4291 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL RedirectDrives);             /* 4288 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL RedirectHomeDrive);          /* 4289 */
+	SETTINGS_DEPRECATED(ALIGN64 char* DrivesToRedirect);          /* 4290 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 DriveDirectoryBatchSize); /* 4291 */
+	UINT64 padding4416[4416 - 4292];                             /* 4292 */
 
 	/* Smartcard Redirection */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RedirectSmartCards); /* 4416 */
@@ -76,7 +76,8 @@ extern "C"
 	typedef struct rdp_freerdp freerdp;
 	typedef struct rdp_context rdpContext;
 	typedef struct rdp_freerdp_peer freerdp_peer;
-	typedef struct rdp_transport rdpTransport; /* Opaque */
+	typedef struct rdp_transport rdpTransport;                 /* Opaque */
+	typedef struct rdp_tls_server_context rdpTlsServerContext; /* Opaque */
 
 	typedef struct
 	{
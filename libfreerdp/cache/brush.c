@@ -37,6 +37,7 @@ typedef struct
 {
 	UINT32 bpp;
 	void* entry;
+	void* expanded;
 } BRUSH_ENTRY;
 
 struct rdp_brush_cache
@@ -198,7 +199,9 @@ void brush_cache_put(rdpBrushCache* brushCache, UINT32 index, void* entry, UINT3
 
 		WINPR_ASSERT(brushCache->monoEntries);
 		free(brushCache->monoEntries[index].entry);
+		free(brushCache->monoEntries[index].expanded);
 		brushCache->monoEntries[index].bpp = bpp;
+		brushCache->monoEntries[index].expanded = NULL;
 		brushCache->monoEntries[index].entry = entry;
 	}
 	else
@@ -212,11 +215,41 @@ void brush_cache_put(rdpBrushCache* brushCache, UINT32 index, void* entry, UINT3
 
 		WINPR_ASSERT(brushCache->entries);
 		free(brushCache->entries[index].entry);
+		free(brushCache->entries[index].expanded);
 		brushCache->entries[index].bpp = bpp;
+		brushCache->entries[index].expanded = NULL;
 		brushCache->entries[index].entry = entry;
 	}
 }
 
+void** brush_cache_expanded(rdpBrushCache* brushCache, UINT32 index, UINT32 bpp,
+                            const void* entry)
+{
+	BRUSH_ENTRY* cached = NULL;
+
+	if (!brushCache || !entry)
+		return NULL;
+
+	if (bpp == 1)
+	{
+		if (index >= brushCache->maxMonoEntries)
+			return NULL;
+		cached = &brushCache->monoEntries[index];
+	}
+	else
+	{
+		if (index >= brushCache->maxEntries)
+			return NULL;
+		cached = &brushCache->entries[index];
+	}
+
+	/* brush data of an order that does not come from the cache */
+	if ((cached->entry != entry) || (cached->bpp != bpp))
+		return NULL;
+
+	return &cached->expanded;
+}
+
 void brush_cache_register_callbacks(rdpUpdate* update)
 {
 	WINPR_ASSERT(update);
@@ -280,7 +313,10 @@ void brush_cache_free(rdpBrushCache* brushCache)
 		if (brushCache->entries)
 		{
 			for (size_t i = 0; i < brushCache->maxEntries; i++)
+			{
 				free(brushCache->entries[i].entry);
+				free(brushCache->entries[i].expanded);
+			}
 
 			free(brushCache->entries);
 		}
@@ -288,7 +324,10 @@ void brush_cache_free(rdpBrushCache* brushCache)
 		if (brushCache->monoEntries)
 		{
 			for (size_t i = 0; i < brushCache->maxMonoEntries; i++)
+			{
 				free(brushCache->monoEntries[i].entry);
+				free(brushCache->monoEntries[i].expanded);
+			}
 
 			free(brushCache->monoEntries);
 		}
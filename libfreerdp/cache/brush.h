@@ -37,6 +37,15 @@ extern "C"
 	FREERDP_LOCAL void* brush_cache_get(rdpBrushCache* brush, UINT32 index, UINT32* bpp);
 	FREERDP_LOCAL void brush_cache_put(rdpBrushCache* brush, UINT32 index, void* entry, UINT32 bpp);
 
+	/** @brief slot for a pre-expanded form of the cached brush entry.
+	 *
+	 *  Returns NULL if entry is not the data cached at index for bpp (see brush_cache_get).
+	 *  What is stored in the slot belongs to the cache and is released with free() when the
+	 *  entry is replaced. */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL void** brush_cache_expanded(rdpBrushCache* brush, UINT32 index, UINT32 bpp,
+	                                          const void* entry);
+
 	FREERDP_LOCAL void brush_cache_register_callbacks(rdpUpdate* update);
 
 	FREERDP_LOCAL void brush_cache_free(rdpBrushCache* brush);
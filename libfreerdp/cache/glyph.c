@@ -42,6 +42,29 @@ static const void* glyph_cache_fragment_get(rdpGlyphCache* glyphCache, UINT32 in
 static BOOL glyph_cache_fragment_put(rdpGlyphCache* glyphCache, UINT32 index, UINT32 size,
                                      const void* fragment);
 
+static BOOL glyph_cache_run_add(rdpGlyphCache* glyphCache, const rdpGlyph* glyph, INT32 x,
+                                INT32 y, INT32 w, INT32 h, INT32 sx, INT32 sy)
+{
+	WINPR_ASSERT(glyphCache);
+
+	if (glyphCache->runCount >= glyphCache->runSize)
+	{
+		const size_t size = MAX(64, glyphCache->runSize * 2);
+		rdpGlyphRunEntry* run =
+		    (rdpGlyphRunEntry*)realloc(glyphCache->run, size * sizeof(rdpGlyphRunEntry));
+
+		if (!run)
+			return FALSE;
+
+		glyphCache->run = run;
+		glyphCache->runSize = size;
+	}
+
+	const rdpGlyphRunEntry entry = { glyph, x, y, w, h, sx, sy };
+	glyphCache->run[glyphCache->runCount++] = entry;
+	return TRUE;
+}
+
 static UINT32 update_glyph_offset(const BYTE* data, size_t length, UINT32 index, INT32* x, INT32* y,
                                   UINT32 ulCharInc, UINT32 flAccel)
 {
@@ -117,7 +140,13 @@ static BOOL update_process_glyph(rdpContext* context, const BYTE* data, UINT32 c
 
 		if ((dh > 0) && (dw > 0))
 		{
-			if (!glyph->Draw(context, glyph, dx, dy, dw, dh, sx, sy, fOpRedundant))
+			/* glyphs are collected and drawn as one run in update_process_glyph_fragments */
+			if (glyph->DrawRun)
+			{
+				if (!glyph_cache_run_add(glyph_cache, glyph, dx, dy, dw, dh, sx, sy))
+					return FALSE;
+			}
+			else if (!glyph->Draw(context, glyph, dx, dy, dw, dh, sx, sy, fOpRedundant))
 				return FALSE;
 		}
 	}
@@ -231,6 +260,8 @@ static BOOL update_process_glyph_fragments(rdpContext* context, const BYTE* data
 		bound.width = WINPR_ASSERTING_INT_CAST(INT16, bkWidth);
 		bound.height = WINPR_ASSERTING_INT_CAST(INT16, bkHeight);
 
+		glyph_cache->runCount = 0;
+
 		if (!glyph->BeginDraw(context, opX, opY, opWidth, opHeight, bgcolor, fgcolor, fOpRedundant))
 			goto fail;
 
@@ -285,6 +316,12 @@ static BOOL update_process_glyph_fragments(rdpContext* context, const BYTE* data
 			}
 		}
 
+		if (glyph_cache->runCount > 0)
+		{
+			if (!glyph->DrawRun(context, glyph_cache->run, glyph_cache->runCount, fOpRedundant))
+				goto fail;
+		}
+
 		if (!glyph->EndDraw(context, opX, opY, opWidth, opHeight, bgcolor, fgcolor))
 			goto fail;
 	}
@@ -756,6 +793,8 @@ void glyph_cache_free(rdpGlyphCache* glyphCache)
 			glyphCache->fragCache.entries[i].fragment = NULL;
 		}
 
+		free(glyphCache->run);
+
 		free(glyphCache);
 	}
 }
@@ -47,6 +47,11 @@ typedef struct
 	FRAGMENT_CACHE fragCache;
 	GLYPH_CACHE glyphCache[10];
 
+	/* glyphs of the text run being drawn, see pGlyph_DrawRun */
+	rdpGlyphRunEntry* run;
+	size_t runCount;
+	size_t runSize;
+
 	wLog* log;
 	rdpContext* context;
 } rdpGlyphCache;
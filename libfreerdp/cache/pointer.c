@@ -33,7 +33,7 @@
 #define TAG FREERDP_TAG("cache.pointer")
 
 static BOOL pointer_cache_put(rdpPointerCache* pointer_cache, UINT32 index, rdpPointer* pointer,
-                              BOOL colorCache);
+                              BOOL colorCache, UINT64 hash);
 static rdpPointer* pointer_cache_get(rdpPointerCache* pointer_cache, UINT32 index);
 
 static void pointer_clear(rdpPointer* pointer)
@@ -135,74 +135,121 @@ static BOOL upate_pointer_copy_andxor(rdpPointer* pointer, const BYTE* andMaskDa
 	return TRUE;
 }
 
-static BOOL update_pointer_color(rdpContext* context, const POINTER_COLOR_UPDATE* pointer_color)
+static UINT64 pointer_hash_data(UINT64 hash, const BYTE* data, size_t length)
 {
-	rdpPointer* pointer = NULL;
-	rdpCache* cache = NULL;
+	const UINT64 prime = 0x100000001b3ull;
+	size_t x = 0;
 
-	WINPR_ASSERT(context);
-	WINPR_ASSERT(pointer_color);
+	if (!data)
+		return hash;
 
-	cache = context->cache;
-	WINPR_ASSERT(cache);
+	/* FNV-1a on 64 bit words, collisions are ruled out by comparing the masks */
+	for (; x + sizeof(UINT64) <= length; x += sizeof(UINT64))
+	{
+		UINT64 word = 0;
+		memcpy(&word, &data[x], sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; x < length; x++)
+		hash = (hash ^ data[x]) * prime;
+	return hash;
+}
 
-	pointer = Pointer_Alloc(context);
+static UINT64 pointer_shape_hash(const rdpPointer* pointer)
+{
+	WINPR_ASSERT(pointer);
 
-	if (pointer == NULL)
+	const UINT32 attributes[] = { pointer->xorBpp, pointer->xPos, pointer->yPos, pointer->width,
+		                          pointer->height };
+	UINT64 hash = pointer_hash_data(0xcbf29ce484222325ull, (const BYTE*)attributes,
+	                                sizeof(attributes));
+	hash = pointer_hash_data(hash, pointer->andMaskData, pointer->lengthAndMask);
+	return pointer_hash_data(hash, pointer->xorMaskData, pointer->lengthXorMask);
+}
+
+static BOOL pointer_mask_equal(const BYTE* a, size_t lengthA, const BYTE* b, size_t lengthB)
+{
+	if (lengthA != lengthB)
 		return FALSE;
-	pointer->xorBpp = 24;
-	pointer->xPos = pointer_color->hotSpotX;
-	pointer->yPos = pointer_color->hotSpotY;
-	pointer->width = pointer_color->width;
-	pointer->height = pointer_color->height;
-
-	if (!upate_pointer_copy_andxor(pointer, pointer_color->andMaskData,
-	                               pointer_color->lengthAndMask, pointer_color->xorMaskData,
-	                               pointer_color->lengthXorMask))
-		goto out_fail;
+	if (lengthA == 0)
+		return TRUE;
+	return memcmp(a, b, lengthA) == 0;
+}
 
-	if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
-		goto out_fail;
+/* Servers resend the same shape to the same cache index, e.g. large pointers while dragging.
+ * Reuse the entry converted by the client instead of converting the shape again. */
+static rdpPointer* pointer_cache_find_shape(rdpPointerCache* pointer_cache, UINT32 index,
+                                            const rdpPointer* shape, UINT64 hash)
+{
+	WINPR_ASSERT(pointer_cache);
+	WINPR_ASSERT(shape);
 
-	if (!pointer_cache_put(cache->pointer, pointer_color->cacheIndex, pointer, TRUE))
-		goto out_fail;
+	if (index >= pointer_cache->cacheSize)
+		return NULL;
 
-	return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
+	rdpPointer* pointer = pointer_cache->entries[index];
+	if (!pointer || (pointer_cache->hashes[index] != hash))
+		return NULL;
 
-out_fail:
-	pointer_free(context, pointer);
-	return FALSE;
+	if ((pointer->xorBpp != shape->xorBpp) || (pointer->xPos != shape->xPos) ||
+	    (pointer->yPos != shape->yPos) || (pointer->width != shape->width) ||
+	    (pointer->height != shape->height))
+		return NULL;
+
+	if (!pointer_mask_equal(pointer->andMaskData, pointer->lengthAndMask, shape->andMaskData,
+	                        shape->lengthAndMask) ||
+	    !pointer_mask_equal(pointer->xorMaskData, pointer->lengthXorMask, shape->xorMaskData,
+	                        shape->lengthXorMask))
+		return NULL;
+	return pointer;
 }
 
-static BOOL update_pointer_large(rdpContext* context, const POINTER_LARGE_UPDATE* pointer_large)
+static BOOL update_pointer_shape(rdpContext* context, UINT32 cacheIndex, BOOL colorCache,
+                                 UINT32 xorBpp, UINT32 hotSpotX, UINT32 hotSpotY, UINT32 width,
+                                 UINT32 height, const BYTE* andMaskData, size_t lengthAndMask,
+                                 const BYTE* xorMaskData, size_t lengthXorMask)
 {
-	rdpPointer* pointer = NULL;
-	rdpCache* cache = NULL;
-
 	WINPR_ASSERT(context);
-	WINPR_ASSERT(pointer_large);
 
-	cache = context->cache;
+	rdpCache* cache = context->cache;
 	WINPR_ASSERT(cache);
 
+	if ((lengthAndMask > UINT32_MAX) || (lengthXorMask > UINT32_MAX))
+		return FALSE;
+
+	/* only references the update data, to look up the shape in the cache */
+	const rdpPointer shape = { .xorBpp = xorBpp,
+		                       .xPos = hotSpotX,
+		                       .yPos = hotSpotY,
+		                       .width = width,
+		                       .height = height,
+		                       .lengthAndMask = andMaskData ? (UINT32)lengthAndMask : 0,
+		                       .lengthXorMask = xorMaskData ? (UINT32)lengthXorMask : 0,
+		                       .andMaskData = WINPR_CAST_CONST_PTR_AWAY(andMaskData, BYTE*),
+		                       .xorMaskData = WINPR_CAST_CONST_PTR_AWAY(xorMaskData, BYTE*) };
+	const UINT64 hash = pointer_shape_hash(&shape);
+
+	rdpPointer* pointer = pointer_cache_find_shape(cache->pointer, cacheIndex, &shape, hash);
+	if (pointer)
+		return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
+
 	pointer = Pointer_Alloc(context);
 	if (pointer == NULL)
 		return FALSE;
-	pointer->xorBpp = pointer_large->xorBpp;
-	pointer->xPos = pointer_large->hotSpotX;
-	pointer->yPos = pointer_large->hotSpotY;
-	pointer->width = pointer_large->width;
-	pointer->height = pointer_large->height;
-
-	if (!upate_pointer_copy_andxor(pointer, pointer_large->andMaskData,
-	                               pointer_large->lengthAndMask, pointer_large->xorMaskData,
-	                               pointer_large->lengthXorMask))
+	pointer->xorBpp = xorBpp;
+	pointer->xPos = hotSpotX;
+	pointer->yPos = hotSpotY;
+	pointer->width = width;
+	pointer->height = height;
+
+	if (!upate_pointer_copy_andxor(pointer, andMaskData, lengthAndMask, xorMaskData,
+	                               lengthXorMask))
 		goto out_fail;
 
 	if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
 		goto out_fail;
 
-	if (!pointer_cache_put(cache->pointer, pointer_large->cacheIndex, pointer, FALSE))
+	if (!pointer_cache_put(cache->pointer, cacheIndex, pointer, colorCache, hash))
 		goto out_fail;
 
 	return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
@@ -212,38 +259,40 @@ out_fail:
 	return FALSE;
 }
 
-static BOOL update_pointer_new(rdpContext* context, const POINTER_NEW_UPDATE* pointer_new)
+static BOOL update_pointer_color(rdpContext* context, const POINTER_COLOR_UPDATE* pointer_color)
 {
-	if (!context || !pointer_new)
-		return FALSE;
-
-	rdpCache* cache = context->cache;
-	rdpPointer* pointer = Pointer_Alloc(context);
-
-	if (!pointer)
-		return FALSE;
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(pointer_color);
 
-	pointer->xorBpp = pointer_new->xorBpp;
-	pointer->xPos = pointer_new->colorPtrAttr.hotSpotX;
-	pointer->yPos = pointer_new->colorPtrAttr.hotSpotY;
-	pointer->width = pointer_new->colorPtrAttr.width;
-	pointer->height = pointer_new->colorPtrAttr.height;
-	if (!upate_pointer_copy_andxor(
-	        pointer, pointer_new->colorPtrAttr.andMaskData, pointer_new->colorPtrAttr.lengthAndMask,
-	        pointer_new->colorPtrAttr.xorMaskData, pointer_new->colorPtrAttr.lengthXorMask))
-		goto out_fail;
+	return update_pointer_shape(context, pointer_color->cacheIndex, TRUE, 24,
+	                            pointer_color->hotSpotX, pointer_color->hotSpotY,
+	                            pointer_color->width, pointer_color->height,
+	                            pointer_color->andMaskData, pointer_color->lengthAndMask,
+	                            pointer_color->xorMaskData, pointer_color->lengthXorMask);
+}
 
-	if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
-		goto out_fail;
+static BOOL update_pointer_large(rdpContext* context, const POINTER_LARGE_UPDATE* pointer_large)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(pointer_large);
 
-	if (!pointer_cache_put(cache->pointer, pointer_new->colorPtrAttr.cacheIndex, pointer, FALSE))
-		goto out_fail;
+	return update_pointer_shape(context, pointer_large->cacheIndex, FALSE, pointer_large->xorBpp,
+	                            pointer_large->hotSpotX, pointer_large->hotSpotY,
+	                            pointer_large->width, pointer_large->height,
+	                            pointer_large->andMaskData, pointer_large->lengthAndMask,
+	                            pointer_large->xorMaskData, pointer_large->lengthXorMask);
+}
 
-	return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
+static BOOL update_pointer_new(rdpContext* context, const POINTER_NEW_UPDATE* pointer_new)
+{
+	if (!context || !pointer_new)
+		return FALSE;
 
-out_fail:
-	pointer_free(context, pointer);
-	return FALSE;
+	const POINTER_COLOR_UPDATE* attr = &pointer_new->colorPtrAttr;
+	return update_pointer_shape(context, attr->cacheIndex, FALSE, pointer_new->xorBpp,
+	                            attr->hotSpotX, attr->hotSpotY, attr->width, attr->height,
+	                            attr->andMaskData, attr->lengthAndMask, attr->xorMaskData,
+	                            attr->lengthXorMask);
 }
 
 static BOOL update_pointer_cached(rdpContext* context, const POINTER_CACHED_UPDATE* pointer_cached)
@@ -284,7 +333,7 @@ rdpPointer* pointer_cache_get(rdpPointerCache* pointer_cache, UINT32 index)
 }
 
 BOOL pointer_cache_put(rdpPointerCache* pointer_cache, UINT32 index, rdpPointer* pointer,
-                       BOOL colorCache)
+                       BOOL colorCache, UINT64 hash)
 {
 	rdpPointer* prevPointer = NULL;
 	const FreeRDP_Settings_Keys_UInt32 id =
@@ -315,6 +364,7 @@ BOOL pointer_cache_put(rdpPointerCache* pointer_cache, UINT32 index, rdpPointer*
 	prevPointer = pointer_cache->entries[index];
 	pointer_free(pointer_cache->context, prevPointer);
 	pointer_cache->entries[index] = pointer;
+	pointer_cache->hashes[index] = hash;
 	return TRUE;
 }
 
@@ -363,9 +413,12 @@ rdpPointerCache* pointer_cache_new(rdpContext* context)
 	pointer_cache->cacheSize = MAX(size, colorSize) + 1;
 
 	pointer_cache->entries = (rdpPointer**)calloc(pointer_cache->cacheSize, sizeof(rdpPointer*));
+	pointer_cache->hashes = calloc(pointer_cache->cacheSize, sizeof(UINT64));
 
-	if (!pointer_cache->entries)
+	if (!pointer_cache->entries || !pointer_cache->hashes)
 	{
+		free((void*)pointer_cache->entries);
+		free(pointer_cache->hashes);
 		free(pointer_cache);
 		return NULL;
 	}
@@ -387,6 +440,7 @@ void pointer_cache_free(rdpPointerCache* pointer_cache)
 		}
 
 		free((void*)pointer_cache->entries);
+		free(pointer_cache->hashes);
 		free(pointer_cache);
 	}
 }
@@ -33,6 +33,7 @@ struct rdp_pointer_cache
 
 	/* internal */
 	rdpContext* context;
+	UINT64* hashes; /* shape hash of each entry */
 };
 
 #ifdef __cplusplus
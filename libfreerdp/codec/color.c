@@ -514,6 +514,42 @@ BOOL freerdp_image_copy_from_icon_data(BYTE* WINPR_RESTRICT pDstData, UINT32 Dst
 	return TRUE;
 }
 
+/* 1bpp, 24bpp and 32bpp pointers are converted with the primitives, bottom up masks are passed
+ * with a negative step */
+static BOOL freerdp_image_copy_from_pointer_data_prims(
+    BYTE* WINPR_RESTRICT pDstData, UINT32 DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+    UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT xorMask, size_t xorStep,
+    const BYTE* WINPR_RESTRICT andMask, size_t andStep, UINT32 xorBpp, BOOL vFlip)
+{
+	if ((nWidth == 0) || (nHeight == 0))
+		return TRUE;
+	if ((xorStep > INT32_MAX) || (andStep > INT32_MAX))
+		return FALSE;
+
+	INT32 xorDelta = (INT32)xorStep;
+	INT32 andDelta = (INT32)andStep;
+	if (vFlip)
+	{
+		xorMask = &xorMask[xorStep * (nHeight - 1ull)];
+		xorDelta = -xorDelta;
+		if (andMask)
+		{
+			andMask = &andMask[andStep * (nHeight - 1ull)];
+			andDelta = -andDelta;
+		}
+	}
+
+	const primitives_t* prims = primitives_get();
+	WINPR_ASSERT(prims);
+	WINPR_ASSERT(prims->pointerToRGB_8u_AC4R);
+
+	BYTE* pDst =
+	    &pDstData[(1ull * nYDst * nDstStep) + (1ull * nXDst * FreeRDPGetBytesPerPixel(DstFormat))];
+	return prims->pointerToRGB_8u_AC4R(xorMask, xorDelta, xorBpp, andMask, andDelta, pDst,
+	                                   nDstStep, DstFormat, nWidth,
+	                                   nHeight) == PRIMITIVES_SUCCESS;
+}
+
 static BOOL freerdp_image_copy_from_pointer_data_1bpp(
     BYTE* WINPR_RESTRICT pDstData, UINT32 DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT xorMask, UINT32 xorMaskLength,
@@ -522,10 +558,6 @@ static BOOL freerdp_image_copy_from_pointer_data_1bpp(
 	BOOL vFlip = 0;
 	UINT32 xorStep = 0;
 	UINT32 andStep = 0;
-	UINT32 xorBit = 0;
-	UINT32 andBit = 0;
-	UINT32 xorPixel = 0;
-	UINT32 andPixel = 0;
 
 	vFlip = (xorBpp == 1) ? FALSE : TRUE;
 	andStep = (nWidth + 7) / 8;
@@ -545,59 +577,9 @@ static BOOL freerdp_image_copy_from_pointer_data_1bpp(
 	if (andStep * nHeight > andMaskLength)
 		return FALSE;
 
-	for (UINT32 y = 0; y < nHeight; y++)
-	{
-		const BYTE* andBits = NULL;
-		const BYTE* xorBits = NULL;
-		BYTE* pDstPixel = &pDstData[((1ULL * nYDst + y) * nDstStep) +
-		                            (1ULL * nXDst * FreeRDPGetBytesPerPixel(DstFormat))];
-		xorBit = andBit = 0x80;
-
-		if (!vFlip)
-		{
-			xorBits = &xorMask[1ULL * xorStep * y];
-			andBits = &andMask[1ULL * andStep * y];
-		}
-		else
-		{
-			xorBits = &xorMask[1ULL * xorStep * (nHeight - y - 1)];
-			andBits = &andMask[1ULL * andStep * (nHeight - y - 1)];
-		}
-
-		for (UINT32 x = 0; x < nWidth; x++)
-		{
-			UINT32 color = 0;
-			xorPixel = (*xorBits & xorBit) ? 1 : 0;
-
-			if (!(xorBit >>= 1))
-			{
-				xorBits++;
-				xorBit = 0x80;
-			}
-
-			andPixel = (*andBits & andBit) ? 1 : 0;
-
-			if (!(andBit >>= 1))
-			{
-				andBits++;
-				andBit = 0x80;
-			}
-
-			if (!andPixel && !xorPixel)
-				color = FreeRDPGetColor(DstFormat, 0, 0, 0, 0xFF); /* black */
-			else if (!andPixel && xorPixel)
-				color = FreeRDPGetColor(DstFormat, 0xFF, 0xFF, 0xFF, 0xFF); /* white */
-			else if (andPixel && !xorPixel)
-				color = FreeRDPGetColor(DstFormat, 0, 0, 0, 0); /* transparent */
-			else if (andPixel && xorPixel)
-				color = freerdp_image_inverted_pointer_color(x, y, DstFormat); /* inverted */
-
-			FreeRDPWriteColor_int(pDstPixel, DstFormat, color);
-			pDstPixel += FreeRDPGetBytesPerPixel(DstFormat);
-		}
-	}
-
-	return TRUE;
+	return freerdp_image_copy_from_pointer_data_prims(pDstData, DstFormat, nDstStep, nXDst, nYDst,
+	                                                  nWidth, nHeight, xorMask, xorStep, andMask,
+	                                                  andStep, xorBpp, vFlip);
 }
 
 static BOOL freerdp_image_copy_from_pointer_data_xbpp(
@@ -643,6 +625,11 @@ static BOOL freerdp_image_copy_from_pointer_data_xbpp(
 			return FALSE;
 	}
 
+	if ((xorBpp == 24) || (xorBpp == 32))
+		return freerdp_image_copy_from_pointer_data_prims(pDstData, DstFormat, nDstStep, nXDst,
+		                                                  nYDst, nWidth, nHeight, xorMask, xorStep,
+		                                                  andMask, andStep, xorBpp, vFlip);
+
 	for (UINT32 y = 0; y < nHeight; y++)
 	{
 		const BYTE* xorBits = NULL;
@@ -684,39 +671,16 @@ static BOOL freerdp_image_copy_from_pointer_data_xbpp(
 				}
 			}
 
-			if (xorBpp == 32)
-			{
-				pixelFormat = PIXEL_FORMAT_BGRA32;
-				xorPixel = FreeRDPReadColor_int(xorBits, pixelFormat);
-			}
-			else if (xorBpp == 16)
+			if (xorBpp == 16)
 			{
 				pixelFormat = PIXEL_FORMAT_RGB15;
 				xorPixel = FreeRDPReadColor_int(xorBits, pixelFormat);
 			}
-			else if (xorBpp == 8)
+			else
 			{
 				pixelFormat = palette->format;
 				xorPixel = palette->palette[xorBits[0]];
 			}
-			else
-			{
-				pixelFormat = PIXEL_FORMAT_BGR24;
-				xorPixel = FreeRDPReadColor_int(xorBits, pixelFormat);
-
-				if (andPixel)
-				{
-					if (xorPixel == 0x00FFFFFFUL)
-						xorPixel |= 0xFF000000UL;
-					else
-						xorPixel = 0;
-				}
-				else
-					xorPixel |= 0xFF000000UL;
-
-				// We need a transparent default alpha value, so use a different format here
-				pixelFormat = PIXEL_FORMAT_ABGR32;
-			}
 
 			xorPixel = FreeRDPConvertColor(xorPixel, pixelFormat, PIXEL_FORMAT_ARGB32, palette);
 			xorBits += xorBytesPerPixel;
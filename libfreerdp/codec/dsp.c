@@ -31,6 +31,7 @@
 #include <freerdp/codec/dsp.h>
 
 #include "dsp.h"
+#include "dsp_resample.h"
 
 #if defined(WITH_FDK_AAC)
 #include "dsp_fdk_aac.h"
@@ -118,6 +119,8 @@ struct S_FREERDP_DSP_CONTEXT
 
 #if defined(WITH_SOXR)
 	soxr_t sox;
+#else
+	FREERDP_DSP_RESAMPLER* resampler;
 #endif
 };
 
@@ -168,6 +171,8 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 
 	Stream_SetPosition(context->common.channelmix, 0);
 
+	const FREERDP_DSP_KERNELS* kernels = freerdp_dsp_get_kernels();
+
 	/* Destination has more channels than source */
 	if (context->common.format.nChannels > srcFormat->nChannels)
 	{
@@ -177,13 +182,19 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 				if (!Stream_EnsureCapacity(context->common.channelmix, size * 2))
 					return FALSE;
 
-				for (size_t x = 0; x < samples; x++)
+				if (bpp == 2)
 				{
-					for (size_t y = 0; y < bpp; y++)
-						Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
-
-					for (size_t y = 0; y < bpp; y++)
-						Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
+					kernels->mono_to_stereo(src, Stream_Buffer(context->common.channelmix),
+					                        samples);
+					Stream_SetPosition(context->common.channelmix, samples * 4);
+				}
+				else
+				{
+					for (size_t x = 0; x < samples; x++)
+					{
+						Stream_Write_UINT8(context->common.channelmix, src[x]);
+						Stream_Write_UINT8(context->common.channelmix, src[x]);
+					}
 				}
 
 				Stream_SealLength(context->common.channelmix);
@@ -204,12 +215,17 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 			if (!Stream_EnsureCapacity(context->common.channelmix, size / 2))
 				return FALSE;
 
-			/* Simply drop second channel.
-			 * TODO: Calculate average */
-			for (size_t x = 0; x < samples; x++)
+			if (bpp == 2)
 			{
-				for (size_t y = 0; y < bpp; y++)
-					Stream_Write_UINT8(context->common.channelmix, src[2 * x * bpp + y]);
+				kernels->stereo_to_mono(src, Stream_Buffer(context->common.channelmix), samples);
+				Stream_SetPosition(context->common.channelmix, samples * 2);
+			}
+			else
+			{
+				/* 8bit PCM is unsigned, average around the 0x80 bias */
+				for (size_t x = 0; x < samples; x++)
+					Stream_Write_UINT8(context->common.channelmix,
+					                   (BYTE)((src[2 * x] + src[2 * x + 1] + 1) / 2));
 			}
 
 			Stream_SealLength(context->common.channelmix);
@@ -292,8 +308,33 @@ static BOOL freerdp_dsp_resample(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	*length = Stream_Length(context->common.resample);
 	return (error == 0) ? TRUE : FALSE;
 #else
-	WLog_ERR(TAG, "Missing resample support, recompile -DWITH_SOXR=ON or -DWITH_DSP_FFMPEG=ON");
-	return FALSE;
+	if ((srcFormat->wBitsPerSample != 16) || (srcFormat->nChannels == 0))
+	{
+		WLog_ERR(TAG, "built-in resampler requires 16bit PCM, got %" PRIu16 "bit",
+		         srcFormat->wBitsPerSample);
+		return FALSE;
+	}
+
+	/* The source format is only known here, (re)create the filter on change */
+	if (!freerdp_dsp_resampler_matches(context->resampler, srcFormat->nSamplesPerSec,
+	                                   context->common.format.nSamplesPerSec,
+	                                   srcFormat->nChannels))
+	{
+		freerdp_dsp_resampler_free(context->resampler);
+		context->resampler = freerdp_dsp_resampler_new(srcFormat->nSamplesPerSec,
+		                                               context->common.format.nSamplesPerSec,
+		                                               srcFormat->nChannels, NULL);
+		if (!context->resampler)
+			return FALSE;
+	}
+
+	const size_t frames = size / (2ull * srcFormat->nChannels);
+	if (!freerdp_dsp_resampler_process(context->resampler, src, frames, context->common.resample))
+		return FALSE;
+
+	*data = Stream_Buffer(context->common.resample);
+	*length = Stream_Length(context->common.resample);
+	return TRUE;
 #endif
 }
 
@@ -1233,6 +1274,8 @@ void freerdp_dsp_context_free(FREERDP_DSP_CONTEXT* context)
 #endif
 #if defined(WITH_SOXR)
 		soxr_delete(context->sox);
+#else
+		freerdp_dsp_resampler_free(context->resampler);
 #endif
 	    free(context);
 
@@ -1574,6 +1617,9 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 		if (!context->sox || (error != 0))
 			return FALSE;
 	}
+#else
+	freerdp_dsp_resampler_free(context->resampler);
+	context->resampler = NULL;
 #endif
 	return TRUE;
 #endif
@@ -0,0 +1,363 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - built-in polyphase resampler and channel mixer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <math.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/endian.h>
+#include <winpr/synch.h>
+
+#include <freerdp/log.h>
+#include <freerdp/types.h>
+
+#include "dsp_resample.h"
+#include "sse/dsp_sse2.h"
+#include "sse/dsp_avx2.h"
+#include "neon/dsp_neon.h"
+
+#define TAG FREERDP_TAG("dsp")
+
+/* Kaiser window shape, ~80dB stop band attenuation */
+#define DSP_RESAMPLE_KAISER_BETA 8.0
+/* Pass band edge relative to the lower Nyquist frequency */
+#define DSP_RESAMPLE_ROLLOFF 0.91
+#define DSP_RESAMPLE_MAX_TAPS 256
+#define DSP_RESAMPLE_PI 3.14159265358979323846
+
+struct S_FREERDP_DSP_RESAMPLER
+{
+	const FREERDP_DSP_KERNELS* kernels;
+	UINT32 srcRate;
+	UINT32 dstRate;
+	UINT32 channels;
+
+	UINT32 up;
+	UINT32 down;
+	size_t taps;
+	float* coeffs;
+
+	/* deinterleaved input history, channel c starts at buffer + c * capacity */
+	float* buffer;
+	size_t capacity;
+	size_t filled;
+	size_t index;
+	UINT32 phase;
+};
+
+static float dsp_dot_generic(const float* WINPR_RESTRICT a, const float* WINPR_RESTRICT b,
+                             size_t count)
+{
+	float sum = 0.0f;
+	for (size_t x = 0; x < count; x++)
+		sum += a[x] * b[x];
+	return sum;
+}
+
+static void dsp_stereo_to_mono_generic(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+                                       size_t frames)
+{
+	for (size_t x = 0; x < frames; x++)
+	{
+		const INT32 left = winpr_Data_Get_INT16(&src[4 * x]);
+		const INT32 right = winpr_Data_Get_INT16(&src[4 * x + 2]);
+		winpr_Data_Write_INT16(&dst[2 * x], (INT16)((left + right) >> 1));
+	}
+}
+
+static void dsp_mono_to_stereo_generic(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+                                       size_t frames)
+{
+	for (size_t x = 0; x < frames; x++)
+	{
+		const INT16 sample = winpr_Data_Get_INT16(&src[2 * x]);
+		winpr_Data_Write_INT16(&dst[4 * x], sample);
+		winpr_Data_Write_INT16(&dst[4 * x + 2], sample);
+	}
+}
+
+static const FREERDP_DSP_KERNELS generic_kernels = { dsp_dot_generic, dsp_stereo_to_mono_generic,
+	                                                 dsp_mono_to_stereo_generic };
+
+static FREERDP_DSP_KERNELS optimized_kernels = { 0 };
+static INIT_ONCE kernels_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK dsp_kernels_init(WINPR_ATTR_UNUSED PINIT_ONCE once,
+                                      WINPR_ATTR_UNUSED PVOID param,
+                                      WINPR_ATTR_UNUSED PVOID* context)
+{
+	optimized_kernels = generic_kernels;
+	freerdp_dsp_init_kernels_sse2(&optimized_kernels);
+#if defined(WITH_AVX2)
+	freerdp_dsp_init_kernels_avx2(&optimized_kernels);
+#endif
+	freerdp_dsp_init_kernels_neon(&optimized_kernels);
+	return TRUE;
+}
+
+const FREERDP_DSP_KERNELS* freerdp_dsp_get_kernels_generic(void)
+{
+	return &generic_kernels;
+}
+
+const FREERDP_DSP_KERNELS* freerdp_dsp_get_kernels(void)
+{
+	if (!InitOnceExecuteOnce(&kernels_once, dsp_kernels_init, NULL, NULL))
+		return &generic_kernels;
+	return &optimized_kernels;
+}
+
+static UINT32 dsp_gcd(UINT32 a, UINT32 b)
+{
+	while (b != 0)
+	{
+		const UINT32 t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* zeroth order modified bessel function of the first kind */
+static double dsp_bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (size_t k = 1; k < 64; k++)
+	{
+		const double v = x / (2.0 * (double)k);
+		term *= v * v;
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+/* Kaiser windowed sinc, one row of \b taps coefficients per phase.
+ * Phase p interpolates the input at (taps / 2 - 1) + p / up relative to the window start. */
+static BOOL dsp_resampler_design(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler)
+{
+	const size_t taps = resampler->taps;
+	const double half = (double)taps / 2.0;
+	const double ratio = (resampler->up < resampler->down)
+	                         ? (double)resampler->up / (double)resampler->down
+	                         : 1.0;
+	const double cutoff = 0.5 * ratio * DSP_RESAMPLE_ROLLOFF;
+	const double norm = dsp_bessel_i0(DSP_RESAMPLE_KAISER_BETA);
+
+	resampler->coeffs = winpr_aligned_calloc(1ull * resampler->up * taps, sizeof(float), 32);
+	if (!resampler->coeffs)
+		return FALSE;
+
+	for (UINT32 p = 0; p < resampler->up; p++)
+	{
+		float* row = &resampler->coeffs[1ull * p * taps];
+		double sum = 0.0;
+
+		for (size_t k = 0; k < taps; k++)
+		{
+			const double t = (half - 1.0 - (double)k) + (double)p / (double)resampler->up;
+			const double x = 2.0 * cutoff * t;
+			const double sinc =
+			    (fabs(x) < 1e-9) ? 1.0 : sin(DSP_RESAMPLE_PI * x) / (DSP_RESAMPLE_PI * x);
+			const double w = t / half;
+			double window = 0.0;
+			if (fabs(w) < 1.0)
+				window = dsp_bessel_i0(DSP_RESAMPLE_KAISER_BETA * sqrt(1.0 - w * w)) / norm;
+			const double v = 2.0 * cutoff * sinc * window;
+			row[k] = (float)v;
+			sum += v;
+		}
+
+		/* unity gain for DC in every phase */
+		for (size_t k = 0; k < taps; k++)
+			row[k] = (float)(row[k] / sum);
+	}
+	return TRUE;
+}
+
+static BOOL dsp_resampler_reserve(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler, size_t frames)
+{
+	if (frames <= resampler->capacity)
+		return TRUE;
+
+	const size_t capacity = MAX(frames, resampler->capacity * 2);
+	float* buffer = winpr_aligned_calloc(capacity * resampler->channels, sizeof(float), 32);
+	if (!buffer)
+		return FALSE;
+
+	for (size_t c = 0; c < resampler->channels; c++)
+	{
+		if (resampler->buffer)
+			memcpy(&buffer[c * capacity], &resampler->buffer[c * resampler->capacity],
+			       resampler->filled * sizeof(float));
+	}
+	winpr_aligned_free(resampler->buffer);
+	resampler->buffer = buffer;
+	resampler->capacity = capacity;
+	return TRUE;
+}
+
+void freerdp_dsp_resampler_free(FREERDP_DSP_RESAMPLER* resampler)
+{
+	if (!resampler)
+		return;
+
+	winpr_aligned_free(resampler->coeffs);
+	winpr_aligned_free(resampler->buffer);
+	free(resampler);
+}
+
+FREERDP_DSP_RESAMPLER* freerdp_dsp_resampler_new(UINT32 srcRate, UINT32 dstRate, UINT32 channels,
+                                                 const FREERDP_DSP_KERNELS* kernels)
+{
+	if ((srcRate == 0) || (dstRate == 0) || (channels == 0))
+		return NULL;
+
+	const UINT32 gcd = dsp_gcd(srcRate, dstRate);
+	const UINT32 up = dstRate / gcd;
+	const UINT32 down = srcRate / gcd;
+	if (up > DSP_RESAMPLE_MAX_PHASES)
+	{
+		WLog_ERR(TAG, "unsupported resample ratio %" PRIu32 " -> %" PRIu32, srcRate, dstRate);
+		return NULL;
+	}
+
+	FREERDP_DSP_RESAMPLER* resampler = calloc(1, sizeof(FREERDP_DSP_RESAMPLER));
+	if (!resampler)
+		return NULL;
+
+	resampler->kernels = kernels ? kernels : freerdp_dsp_get_kernels();
+	resampler->srcRate = srcRate;
+	resampler->dstRate = dstRate;
+	resampler->channels = channels;
+	resampler->up = up;
+	resampler->down = down;
+
+	/* widen the filter when decimating to keep the transition band narrow */
+	size_t taps = DSP_RESAMPLE_TAPS;
+	if (down > up)
+		taps = DSP_RESAMPLE_TAPS * ((down + up - 1) / up);
+	resampler->taps = MIN(DSP_RESAMPLE_MAX_TAPS, (taps + 7) & ~(size_t)7);
+
+	if (!dsp_resampler_design(resampler))
+		goto fail;
+
+	/* prime the history so the first output is aligned with the first input frame */
+	if (!dsp_resampler_reserve(resampler, 4096))
+		goto fail;
+	resampler->filled = resampler->taps / 2 - 1;
+	return resampler;
+
+fail:
+	freerdp_dsp_resampler_free(resampler);
+	return NULL;
+}
+
+BOOL freerdp_dsp_resampler_matches(const FREERDP_DSP_RESAMPLER* resampler, UINT32 srcRate,
+                                   UINT32 dstRate, UINT32 channels)
+{
+	if (!resampler)
+		return FALSE;
+	return (resampler->srcRate == srcRate) && (resampler->dstRate == dstRate) &&
+	       (resampler->channels == channels);
+}
+
+static INT16 dsp_clamp_int16(float value)
+{
+	if (value >= 32767.0f)
+		return INT16_MAX;
+	if (value <= -32768.0f)
+		return INT16_MIN;
+	return (INT16)lrintf(value);
+}
+
+BOOL freerdp_dsp_resampler_process(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler,
+                                   const BYTE* WINPR_RESTRICT src, size_t frames,
+                                   wStream* WINPR_RESTRICT out)
+{
+	WINPR_ASSERT(resampler);
+	WINPR_ASSERT(out);
+	WINPR_ASSERT(src || (frames == 0));
+
+	const size_t channels = resampler->channels;
+	const size_t taps = resampler->taps;
+
+	if (!dsp_resampler_reserve(resampler, resampler->filled + frames))
+		return FALSE;
+
+	for (size_t c = 0; c < channels; c++)
+	{
+		float* dst = &resampler->buffer[c * resampler->capacity + resampler->filled];
+		const BYTE* cur = &src[2 * c];
+		for (size_t x = 0; x < frames; x++)
+		{
+			dst[x] = (float)winpr_Data_Get_INT16(cur);
+			cur += 2 * channels;
+		}
+	}
+	resampler->filled += frames;
+
+	/* outputs whose filter window lies completely inside the buffered input */
+	size_t count = 0;
+	if (resampler->filled >= taps)
+	{
+		const UINT64 end = (resampler->filled - taps + 1ull) * resampler->up;
+		const UINT64 start = 1ull * resampler->index * resampler->up + resampler->phase;
+		if (end > start)
+			count = (end - start + resampler->down - 1) / resampler->down;
+	}
+
+	Stream_SetPosition(out, 0);
+	if (!Stream_EnsureCapacity(out, count * channels * sizeof(INT16)))
+		return FALSE;
+
+	const FREERDP_DSP_KERNELS* kernels = resampler->kernels;
+	BYTE* dst = Stream_Buffer(out);
+	size_t index = resampler->index;
+	UINT32 phase = resampler->phase;
+	for (size_t x = 0; x < count; x++)
+	{
+		const float* coeffs = &resampler->coeffs[1ull * phase * taps];
+		for (size_t c = 0; c < channels; c++)
+		{
+			const float* history = &resampler->buffer[c * resampler->capacity + index];
+			winpr_Data_Write_INT16(dst, dsp_clamp_int16(kernels->dot(coeffs, history, taps)));
+			dst += sizeof(INT16);
+		}
+
+		phase += resampler->down;
+		index += phase / resampler->up;
+		phase %= resampler->up;
+	}
+	Stream_SetLength(out, count * channels * sizeof(INT16));
+
+	/* drop the input that no future output window reaches */
+	const size_t keep = resampler->filled - MIN(index, resampler->filled);
+	for (size_t c = 0; c < channels; c++)
+	{
+		float* history = &resampler->buffer[c * resampler->capacity];
+		memmove(history, &history[index], keep * sizeof(float));
+	}
+	resampler->index = index - (resampler->filled - keep);
+	resampler->filled = keep;
+	resampler->phase = phase;
+	return TRUE;
+}
@@ -0,0 +1,95 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - built-in polyphase resampler and channel mixer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_DSP_RESAMPLE_H
+#define FREERDP_LIB_CODEC_DSP_RESAMPLE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+#include <freerdp/api.h>
+
+/** Maximum number of polyphase filter phases (interpolation factor after reduction) */
+#define DSP_RESAMPLE_MAX_PHASES 1024
+
+/** Number of filter taps per phase when upsampling, scaled with the decimation factor */
+#define DSP_RESAMPLE_TAPS 32
+
+typedef struct
+{
+	/** dot product of \b count floats, \b count is a multiple of 8 */
+	float (*dot)(const float* WINPR_RESTRICT a, const float* WINPR_RESTRICT b, size_t count);
+	/** average interleaved little endian 16bit stereo \b frames to mono */
+	void (*stereo_to_mono)(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+	                       size_t frames);
+	/** duplicate little endian 16bit mono \b frames to interleaved stereo */
+	void (*mono_to_stereo)(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+	                       size_t frames);
+} FREERDP_DSP_KERNELS;
+
+typedef struct S_FREERDP_DSP_RESAMPLER FREERDP_DSP_RESAMPLER;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief The best kernels supported by the running CPU */
+	FREERDP_LOCAL const FREERDP_DSP_KERNELS* freerdp_dsp_get_kernels(void);
+
+	/** @brief The plain C kernels, used as reference */
+	FREERDP_LOCAL const FREERDP_DSP_KERNELS* freerdp_dsp_get_kernels_generic(void);
+
+	FREERDP_LOCAL void freerdp_dsp_resampler_free(FREERDP_DSP_RESAMPLER* resampler);
+
+	/** @brief Create a resampler for 16bit interleaved PCM
+	 *
+	 *  @param srcRate The input sample rate
+	 *  @param dstRate The output sample rate
+	 *  @param channels The number of interleaved channels
+	 *  @param kernels The kernels to use or \b NULL for \b freerdp_dsp_get_kernels
+	 *
+	 *  @return A new resampler or \b NULL if the rate ratio is not supported
+	 */
+	WINPR_ATTR_MALLOC(freerdp_dsp_resampler_free, 1)
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL FREERDP_DSP_RESAMPLER*
+	freerdp_dsp_resampler_new(UINT32 srcRate, UINT32 dstRate, UINT32 channels,
+	                          const FREERDP_DSP_KERNELS* kernels);
+
+	/** @brief Check if \b resampler converts between the given rates and channel count */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL freerdp_dsp_resampler_matches(const FREERDP_DSP_RESAMPLER* resampler,
+	                                                 UINT32 srcRate, UINT32 dstRate,
+	                                                 UINT32 channels);
+
+	/** @brief Resample \b frames of 16bit interleaved PCM from \b src
+	 *
+	 *  Filter history is kept between calls, so a continuous stream can be
+	 *  passed in arbitrary sized chunks. The output replaces the content of \b out.
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL
+	freerdp_dsp_resampler_process(FREERDP_DSP_RESAMPLER* WINPR_RESTRICT resampler,
+	                              const BYTE* WINPR_RESTRICT src, size_t frames,
+	                              wStream* WINPR_RESTRICT out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_LIB_CODEC_DSP_RESAMPLE_H */
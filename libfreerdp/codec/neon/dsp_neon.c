@@ -0,0 +1,101 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - NEON Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/endian.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "dsp_neon.h"
+
+#include "../../core/simd.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static float dsp_dot_neon(const float* WINPR_RESTRICT a, const float* WINPR_RESTRICT b,
+                          size_t count)
+{
+	WINPR_ASSERT((count % 8) == 0);
+
+	float32x4_t sum0 = vdupq_n_f32(0.0f);
+	float32x4_t sum1 = vdupq_n_f32(0.0f);
+	for (size_t x = 0; x < count; x += 8)
+	{
+		sum0 = vmlaq_f32(sum0, vld1q_f32(&a[x]), vld1q_f32(&b[x]));
+		sum1 = vmlaq_f32(sum1, vld1q_f32(&a[x + 4]), vld1q_f32(&b[x + 4]));
+	}
+
+	const float32x4_t sum = vaddq_f32(sum0, sum1);
+	float32x2_t res = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+	res = vpadd_f32(res, res);
+	return vget_lane_f32(res, 0);
+}
+
+static void dsp_stereo_to_mono_neon(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const int16x8x2_t val = vld2q_s16((const int16_t*)&src[4 * x]);
+		vst1q_s16((int16_t*)&dst[2 * x], vhaddq_s16(val.val[0], val.val[1]));
+	}
+
+	for (; x < frames; x++)
+	{
+		const INT32 left = winpr_Data_Get_INT16(&src[4 * x]);
+		const INT32 right = winpr_Data_Get_INT16(&src[4 * x + 2]);
+		winpr_Data_Write_INT16(&dst[2 * x], (INT16)((left + right) >> 1));
+	}
+}
+
+static void dsp_mono_to_stereo_neon(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const int16x8_t val = vld1q_s16((const int16_t*)&src[2 * x]);
+		const int16x8x2_t res = { { val, val } };
+		vst2q_s16((int16_t*)&dst[4 * x], res);
+	}
+
+	for (; x < frames; x++)
+	{
+		const INT16 sample = winpr_Data_Get_INT16(&src[2 * x]);
+		winpr_Data_Write_INT16(&dst[4 * x], sample);
+		winpr_Data_Write_INT16(&dst[4 * x + 2], sample);
+	}
+}
+#endif
+
+void freerdp_dsp_init_kernels_neon_int(FREERDP_DSP_KERNELS* WINPR_RESTRICT kernels)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	kernels->dot = dsp_dot_neon;
+	kernels->stereo_to_mono = dsp_stereo_to_mono_neon;
+	kernels->mono_to_stereo = dsp_mono_to_stereo_neon;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or NEON intrinsics not available");
+	WINPR_UNUSED(kernels);
+#endif
+}
@@ -0,0 +1,65 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - AVX2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "dsp_avx2.h"
+
+#include "../../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static float dsp_dot_avx2(const float* WINPR_RESTRICT a, const float* WINPR_RESTRICT b,
+                          size_t count)
+{
+	WINPR_ASSERT((count % 8) == 0);
+
+	__m256 sum0 = _mm256_setzero_ps();
+	__m256 sum1 = _mm256_setzero_ps();
+	size_t x = 0;
+	for (; x + 16 <= count; x += 16)
+	{
+		sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(&a[x]), _mm256_loadu_ps(&b[x])));
+		sum1 = _mm256_add_ps(sum1,
+		                     _mm256_mul_ps(_mm256_loadu_ps(&a[x + 8]), _mm256_loadu_ps(&b[x + 8])));
+	}
+	if (x < count)
+		sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(&a[x]), _mm256_loadu_ps(&b[x])));
+
+	const __m256 sum = _mm256_add_ps(sum0, sum1);
+	__m128 res = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	res = _mm_add_ps(res, _mm_movehl_ps(res, res));
+	res = _mm_add_ss(res, _mm_shuffle_ps(res, res, 0x55));
+	return _mm_cvtss_f32(res);
+}
+#endif
+
+void freerdp_dsp_init_kernels_avx2_int(FREERDP_DSP_KERNELS* WINPR_RESTRICT kernels)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	/* the channel mixers are memory bound, the SSE2 versions are kept */
+	kernels->dot = dsp_dot_avx2;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or AVX2 intrinsics not available");
+	WINPR_UNUSED(kernels);
+#endif
+}
@@ -0,0 +1,107 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/endian.h>
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "dsp_sse2.h"
+
+#include "../../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+static float dsp_dot_sse2(const float* WINPR_RESTRICT a, const float* WINPR_RESTRICT b,
+                          size_t count)
+{
+	WINPR_ASSERT((count % 8) == 0);
+
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	for (size_t x = 0; x < count; x += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(&a[x]), _mm_loadu_ps(&b[x])));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(&a[x + 4]), _mm_loadu_ps(&b[x + 4])));
+	}
+
+	__m128 sum = _mm_add_ps(sum0, sum1);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+	return _mm_cvtss_f32(sum);
+}
+
+static void dsp_stereo_to_mono_sse2(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		/* left + right of 4 frames each as 32bit, then halve and pack back */
+		const __m128i lo = _mm_loadu_si128((const __m128i*)&src[4 * x]);
+		const __m128i hi = _mm_loadu_si128((const __m128i*)&src[4 * x + 16]);
+		const __m128i slo = _mm_srai_epi32(_mm_madd_epi16(lo, ones), 1);
+		const __m128i shi = _mm_srai_epi32(_mm_madd_epi16(hi, ones), 1);
+		_mm_storeu_si128((__m128i*)&dst[2 * x], _mm_packs_epi32(slo, shi));
+	}
+
+	for (; x < frames; x++)
+	{
+		const INT32 left = winpr_Data_Get_INT16(&src[4 * x]);
+		const INT32 right = winpr_Data_Get_INT16(&src[4 * x + 2]);
+		winpr_Data_Write_INT16(&dst[2 * x], (INT16)((left + right) >> 1));
+	}
+}
+
+static void dsp_mono_to_stereo_sse2(const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT dst,
+                                    size_t frames)
+{
+	size_t x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&src[2 * x]);
+		_mm_storeu_si128((__m128i*)&dst[4 * x], _mm_unpacklo_epi16(val, val));
+		_mm_storeu_si128((__m128i*)&dst[4 * x + 16], _mm_unpackhi_epi16(val, val));
+	}
+
+	for (; x < frames; x++)
+	{
+		const INT16 sample = winpr_Data_Get_INT16(&src[2 * x]);
+		winpr_Data_Write_INT16(&dst[4 * x], sample);
+		winpr_Data_Write_INT16(&dst[4 * x + 2], sample);
+	}
+}
+#endif
+
+void freerdp_dsp_init_kernels_sse2_int(FREERDP_DSP_KERNELS* WINPR_RESTRICT kernels)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "SSE2 optimizations");
+	kernels->dot = dsp_dot_sse2;
+	kernels->stereo_to_mono = dsp_stereo_to_mono_sse2;
+	kernels->mono_to_stereo = dsp_mono_to_stereo_sse2;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE2 intrinsics not available");
+	WINPR_UNUSED(kernels);
+#endif
+}
@@ -2,9 +2,13 @@
 
 #include <winpr/path.h>
 #include <winpr/image.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
 #include <freerdp/codec/color.h>
+#include <freerdp/primitives.h>
 
 #include "testcases.h"
+#include "../../test/test_performance.h"
 
 static BOOL run_testcase(size_t x, const gdiPalette* palette, const rdpPointer* pointer,
                          const uint8_t* ref)
@@ -57,8 +61,130 @@ fail:
 	return rc;
 }
 
-int TestFreeRDPCodecCursor(WINPR_ATTR_UNUSED int argc, WINPR_ATTR_UNUSED char* argv[])
+/* the largest pointer a large pointer update can carry */
+#define BENCH_POINTER_SIZE 384
+#define BENCH_ITERATIONS 50
+
+static size_t mask_step(size_t width, size_t bpp)
+{
+	const size_t step = (width * bpp + 7) / 8;
+	return step + (step % 2);
+}
+
+/* random shape, with enough black and white pixels to hit the transparent and inverted cases */
+static BOOL bench_pointer_init(rdpPointer* pointer, UINT32 xorBpp, UINT32 width, UINT32 height)
+{
+	pointer->xorBpp = xorBpp;
+	pointer->width = width;
+	pointer->height = height;
+	pointer->lengthXorMask = (UINT32)(mask_step(width, xorBpp) * height);
+	pointer->lengthAndMask = (UINT32)(mask_step(width, 1) * height);
+	pointer->xorMaskData = malloc(pointer->lengthXorMask);
+	pointer->andMaskData = malloc(pointer->lengthAndMask);
+	if (!pointer->xorMaskData || !pointer->andMaskData)
+		return FALSE;
+
+	if ((winpr_RAND(pointer->xorMaskData, pointer->lengthXorMask) < 0) ||
+	    (winpr_RAND(pointer->andMaskData, pointer->lengthAndMask) < 0))
+		return FALSE;
+
+	const size_t bpp = xorBpp / 8;
+	for (size_t x = 0; bpp && (x + bpp <= pointer->lengthXorMask); x += 3 * bpp)
+	{
+		const BYTE fill = (x % 2) ? 0x00 : 0xFF;
+		memset(&pointer->xorMaskData[x], fill, bpp);
+		if (xorBpp == 32)
+			pointer->xorMaskData[x + 3] = 0xFF;
+	}
+	return TRUE;
+}
+
+static UINT64 bench_convert(const primitives_t* prims, const rdpPointer* pointer, BYTE* dst,
+                            UINT32 format, size_t iterations)
+{
+	const size_t stride = 1ull * pointer->width * FreeRDPGetBytesPerPixel(format);
+	const size_t xorStep = mask_step(pointer->width, pointer->xorBpp);
+	const size_t andStep = mask_step(pointer->width, 1);
+	const BOOL vFlip = pointer->xorBpp != 1;
+	const BYTE* xorMask = pointer->xorMaskData;
+	const BYTE* andMask = pointer->andMaskData;
+	INT32 xorDelta = (INT32)xorStep;
+	INT32 andDelta = (INT32)andStep;
+
+	if (vFlip)
+	{
+		xorMask = &xorMask[xorStep * (pointer->height - 1)];
+		andMask = &andMask[andStep * (pointer->height - 1)];
+		xorDelta = -xorDelta;
+		andDelta = -andDelta;
+	}
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < iterations; x++)
+	{
+		if (prims)
+		{
+			if (prims->pointerToRGB_8u_AC4R(xorMask, xorDelta, pointer->xorBpp, andMask, andDelta,
+			                                dst, (UINT32)stride, format, pointer->width,
+			                                pointer->height) != PRIMITIVES_SUCCESS)
+				return 0;
+		}
+		else if (!freerdp_image_copy_from_pointer_data(
+		             dst, format, (UINT32)stride, 0, 0, pointer->width, pointer->height,
+		             pointer->xorMaskData, pointer->lengthXorMask, pointer->andMaskData,
+		             pointer->lengthAndMask, pointer->xorBpp, NULL))
+			return 0;
+	}
+	return MAX(1, winpr_GetTickCount64NS() - start);
+}
+
+/* Large pointers as sent by pf_client_send_pointer_large while dragging: the generic primitive
+ * (the former per pixel conversion) and freerdp_image_copy_from_pointer_data must match. */
+static BOOL run_benchmark(UINT32 xorBpp, UINT32 format, UINT32 width, UINT32 height,
+                          size_t iterations)
 {
+	BOOL rc = FALSE;
+	rdpPointer pointer = { 0 };
+	const size_t size = 1ull * width * height * FreeRDPGetBytesPerPixel(format);
+	BYTE* ref = calloc(1, size);
+	BYTE* dst = calloc(1, size);
+
+	if (!ref || !dst || !bench_pointer_init(&pointer, xorBpp, width, height))
+		goto fail;
+
+	const UINT64 generic = bench_convert(primitives_get_generic(), &pointer, ref, format,
+	                                     iterations);
+	const UINT64 optimized = bench_convert(NULL, &pointer, dst, format, iterations);
+	if ((generic == 0) || (optimized == 0))
+		goto fail;
+
+	if (memcmp(ref, dst, size) != 0)
+	{
+		printf("pointer %" PRIu32 "bpp %" PRIu32 "x%" PRIu32 " -> %s: output differs\n", xorBpp,
+		       width, height, FreeRDPGetColorFormatName(format));
+		goto fail;
+	}
+
+	if (iterations > 1)
+		printf("pointer %" PRIu32 "bpp %" PRIu32 "x%" PRIu32 " -> %s: generic %.1f us, "
+		       "optimized %.1f us per shape\n",
+		       xorBpp, width, height, FreeRDPGetColorFormatName(format),
+		       (double)generic / 1000.0 / (double)iterations,
+		       (double)optimized / 1000.0 / (double)iterations);
+	rc = TRUE;
+
+fail:
+	free(pointer.xorMaskData);
+	free(pointer.andMaskData);
+	free(ref);
+	free(dst);
+	return rc;
+}
+
+int TestFreeRDPCodecCursor(int argc, char* argv[])
+{
+	test_performance_setup(argc, argv);
+
 	const size_t palette_len = ARRAYSIZE(testcase_palette);
 	const size_t pointer_len = ARRAYSIZE(testcase_pointer);
 	const size_t bmp_len = ARRAYSIZE(testcase_image_bgra32);
@@ -75,5 +201,24 @@ int TestFreeRDPCodecCursor(WINPR_ATTR_UNUSED int argc, WINPR_ATTR_UNUSED char* a
 		if (!run_testcase(x, palette, pointer, bmp))
 			rc = -1;
 	}
+
+	const UINT32 bpps[] = { 1, 24, 32 };
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_XRGB32,
+		                       PIXEL_FORMAT_RGB16 };
+	for (size_t x = 0; x < ARRAYSIZE(bpps); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(formats); y++)
+		{
+			/* odd sizes run the vector and the scalar columns */
+			for (UINT32 w = 1; w < 20; w++)
+			{
+				if (!run_benchmark(bpps[x], formats[y], w, 3, 1))
+					rc = -1;
+			}
+			if (!run_benchmark(bpps[x], formats[y], BENCH_POINTER_SIZE, BENCH_POINTER_SIZE,
+			                   g_TestPerformance ? BENCH_ITERATIONS : 1))
+				rc = -1;
+		}
+	}
 	return rc;
 }
@@ -0,0 +1,388 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/endian.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+#include <freerdp/codec/dsp.h>
+
+#if defined(WITH_SOXR)
+#include <soxr.h>
+#endif
+
+#include "../dsp_resample.h"
+#include "../../test/test_performance.h"
+
+#define TEST_TONE_HZ 1000.0
+#define TEST_CHUNK_FRAMES 441
+#define TEST_MIN_SNR_DB 60.0
+#define TEST_PI 3.14159265358979323846
+
+typedef struct
+{
+	UINT32 src;
+	UINT32 dst;
+} test_rates;
+
+static const test_rates rates[] = { { 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 },
+	                                { 48000, 22050 }, { 16000, 48000 }, { 48000, 16000 },
+	                                { 44100, 22050 }, { 22050, 44100 } };
+
+static BYTE* create_tone(UINT32 rate, UINT32 channels, size_t frames)
+{
+	BYTE* data = calloc(frames * channels, sizeof(INT16));
+	if (!data)
+		return NULL;
+
+	for (size_t x = 0; x < frames; x++)
+	{
+		const double v = 16384.0 * sin(2.0 * TEST_PI * TEST_TONE_HZ * (double)x / rate);
+		for (size_t c = 0; c < channels; c++)
+			winpr_Data_Write_INT16(&data[(x * channels + c) * sizeof(INT16)], (INT16)lrint(v));
+	}
+	return data;
+}
+
+/* least squares fit of a sine at the test frequency, everything else is noise */
+static double measure_snr(const BYTE* data, size_t frames, UINT32 channels, UINT32 rate)
+{
+	/* skip filter settling at both ends */
+	const size_t margin = rate / 100;
+	if (frames <= 2 * margin)
+		return 0.0;
+
+	double ss = 0.0;
+	double cc = 0.0;
+	double sc = 0.0;
+	double ys = 0.0;
+	double yc = 0.0;
+	for (size_t x = margin; x < frames - margin; x++)
+	{
+		const double w = 2.0 * TEST_PI * TEST_TONE_HZ * (double)x / rate;
+		const double s = sin(w);
+		const double c = cos(w);
+		const double y = winpr_Data_Get_INT16(&data[x * channels * sizeof(INT16)]);
+		ss += s * s;
+		cc += c * c;
+		sc += s * c;
+		ys += y * s;
+		yc += y * c;
+	}
+
+	const double det = ss * cc - sc * sc;
+	const double a = (ys * cc - yc * sc) / det;
+	const double b = (yc * ss - ys * sc) / det;
+
+	double signal = 0.0;
+	double noise = 0.0;
+	for (size_t x = margin; x < frames - margin; x++)
+	{
+		const double w = 2.0 * TEST_PI * TEST_TONE_HZ * (double)x / rate;
+		const double fit = a * sin(w) + b * cos(w);
+		const double y = winpr_Data_Get_INT16(&data[x * channels * sizeof(INT16)]);
+		signal += fit * fit;
+		noise += (y - fit) * (y - fit);
+	}
+
+	if (noise <= 0.0)
+		return 200.0;
+	return 10.0 * log10(signal / noise);
+}
+
+/* resample in chunks to exercise the filter history */
+static BOOL run_resampler(const FREERDP_DSP_KERNELS* kernels, const test_rates* rate,
+                          UINT32 channels, const BYTE* src, size_t frames, wStream* out)
+{
+	BOOL rc = FALSE;
+	FREERDP_DSP_RESAMPLER* resampler =
+	    freerdp_dsp_resampler_new(rate->src, rate->dst, channels, kernels);
+	wStream* chunk = Stream_New(NULL, 1024);
+	if (!resampler || !chunk)
+		goto fail;
+
+	Stream_SetPosition(out, 0);
+	for (size_t x = 0; x < frames; x += TEST_CHUNK_FRAMES)
+	{
+		const size_t count = MIN(TEST_CHUNK_FRAMES, frames - x);
+		if (!freerdp_dsp_resampler_process(resampler, &src[x * channels * sizeof(INT16)], count,
+		                                   chunk))
+			goto fail;
+		if (!Stream_EnsureRemainingCapacity(out, Stream_Length(chunk)))
+			goto fail;
+		Stream_Write(out, Stream_Buffer(chunk), Stream_Length(chunk));
+	}
+	Stream_SealLength(out);
+	rc = TRUE;
+
+fail:
+	Stream_Free(chunk, TRUE);
+	freerdp_dsp_resampler_free(resampler);
+	return rc;
+}
+
+#if defined(WITH_SOXR)
+/* soxr as set up by freerdp_dsp_context_reset, fed with the same chunks */
+static BOOL run_soxr(const test_rates* rate, UINT32 channels, const BYTE* src, size_t frames,
+                     wStream* out)
+{
+	BOOL rc = FALSE;
+	soxr_error_t error = NULL;
+	const soxr_io_spec_t iospec = soxr_io_spec(SOXR_INT16, SOXR_INT16);
+	soxr_t sox = soxr_create(rate->src, rate->dst, channels, &error, &iospec, NULL, NULL);
+	const size_t frameSize = channels * sizeof(INT16);
+	const size_t capacity = 1ull * frames * rate->dst / rate->src + TEST_CHUNK_FRAMES;
+	size_t total = 0;
+
+	Stream_SetPosition(out, 0);
+	if (!sox || error || !Stream_EnsureCapacity(out, capacity * frameSize))
+		goto fail;
+
+	for (size_t x = 0; x < frames; x += TEST_CHUNK_FRAMES)
+	{
+		size_t idone = 0;
+		size_t odone = 0;
+		const size_t count = MIN(TEST_CHUNK_FRAMES, frames - x);
+		error = soxr_process(sox, &src[x * frameSize], count, &idone,
+		                     Stream_Buffer(out) + total * frameSize, capacity - total,
+		                     &odone);
+		if (error)
+			goto fail;
+		total += odone;
+	}
+	Stream_SetPosition(out, total * frameSize);
+	Stream_SealLength(out);
+	rc = TRUE;
+
+fail:
+	soxr_delete(sox);
+	return rc;
+}
+#endif
+
+static BOOL test_kernels(void)
+{
+	const FREERDP_DSP_KERNELS* generic = freerdp_dsp_get_kernels_generic();
+	const FREERDP_DSP_KERNELS* optimized = freerdp_dsp_get_kernels();
+
+	float a[64] = { 0 };
+	float b[64] = { 0 };
+	for (size_t x = 0; x < ARRAYSIZE(a); x++)
+	{
+		a[x] = (float)sin((double)x);
+		b[x] = (float)(1000.0 * cos((double)x * 0.3));
+	}
+
+	for (size_t count = 8; count <= ARRAYSIZE(a); count += 8)
+	{
+		const float ref = generic->dot(a, b, count);
+		const float val = optimized->dot(a, b, count);
+		if (fabsf(ref - val) > 0.01f)
+		{
+			(void)fprintf(stderr, "dot product mismatch for %" PRIuz " taps: %f != %f\n", count,
+			              (double)ref, (double)val);
+			return FALSE;
+		}
+	}
+
+	/* odd frame counts to cover the scalar tails */
+	BYTE stereo[4 * 37] = { 0 };
+	BYTE mono[2 * 37] = { 0 };
+	BYTE ref[4 * 37] = { 0 };
+	BYTE val[4 * 37] = { 0 };
+	if ((winpr_RAND(stereo, sizeof(stereo)) < 0) || (winpr_RAND(mono, sizeof(mono)) < 0))
+		return FALSE;
+
+	generic->stereo_to_mono(stereo, ref, 37);
+	optimized->stereo_to_mono(stereo, val, 37);
+	if (memcmp(ref, val, sizeof(mono)) != 0)
+	{
+		(void)fprintf(stderr, "stereo to mono mismatch\n");
+		return FALSE;
+	}
+
+	generic->mono_to_stereo(mono, ref, 37);
+	optimized->mono_to_stereo(mono, val, 37);
+	if (memcmp(ref, val, sizeof(stereo)) != 0)
+	{
+		(void)fprintf(stderr, "mono to stereo mismatch\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL test_quality(void)
+{
+	BOOL rc = FALSE;
+	const UINT32 channels = 2;
+	wStream* generic = Stream_New(NULL, 1024);
+	wStream* optimized = Stream_New(NULL, 1024);
+	if (!generic || !optimized)
+		goto fail;
+
+	for (size_t x = 0; x < ARRAYSIZE(rates); x++)
+	{
+		const test_rates* rate = &rates[x];
+		const size_t frames = rate->src / 2;
+		BYTE* src = create_tone(rate->src, channels, frames);
+		if (!src)
+			goto fail;
+
+		const FREERDP_DSP_KERNELS* kernels = freerdp_dsp_get_kernels_generic();
+		const BOOL res = run_resampler(kernels, rate, channels, src, frames, generic) &&
+		                 run_resampler(NULL, rate, channels, src, frames, optimized);
+		free(src);
+		if (!res)
+			goto fail;
+
+		const size_t outFrames = Stream_Length(optimized) / (channels * sizeof(INT16));
+		const size_t expected = 1ull * frames * rate->dst / rate->src;
+		if ((outFrames > expected) || (outFrames + 64 < expected))
+		{
+			(void)fprintf(stderr,
+			              "%" PRIu32 " -> %" PRIu32 ": got %" PRIuz " frames, expected %" PRIuz
+			              "\n",
+			              rate->src, rate->dst, outFrames, expected);
+			goto fail;
+		}
+
+		const double snr = measure_snr(Stream_Buffer(optimized), outFrames, channels, rate->dst);
+		const double snrGeneric = measure_snr(
+		    Stream_Buffer(generic), Stream_Length(generic) / (channels * sizeof(INT16)), channels,
+		    rate->dst);
+		printf("%5" PRIu32 " -> %5" PRIu32 ": SNR %.1fdB (generic %.1fdB)\n", rate->src,
+		       rate->dst, snr, snrGeneric);
+		if ((snr < TEST_MIN_SNR_DB) || (snrGeneric < TEST_MIN_SNR_DB))
+			goto fail;
+
+#if defined(WITH_SOXR)
+		src = create_tone(rate->src, channels, frames);
+		const BOOL sox = src && run_soxr(rate, channels, src, frames, generic);
+		free(src);
+		if (!sox)
+			goto fail;
+		printf("%5" PRIu32 " -> %5" PRIu32 ": SNR %.1fdB (soxr)\n", rate->src, rate->dst,
+		       measure_snr(Stream_Buffer(generic),
+		                   Stream_Length(generic) / (channels * sizeof(INT16)), channels,
+		                   rate->dst));
+#endif
+	}
+	rc = TRUE;
+
+fail:
+	Stream_Free(generic, TRUE);
+	Stream_Free(optimized, TRUE);
+	return rc;
+}
+
+/* compare the built-in kernels with soxr and the freerdp_dsp_encode path (soxr or ffmpeg if
+ * compiled in) */
+static BOOL test_throughput(void)
+{
+	BOOL rc = FALSE;
+	const test_rates rate = { 44100, 48000 };
+	const UINT32 channels = 2;
+	const size_t frames = 10ull * rate.src;
+	const AUDIO_FORMAT srcFormat = { .wFormatTag = WAVE_FORMAT_PCM,
+		                             .nChannels = 2,
+		                             .nSamplesPerSec = rate.src,
+		                             .nAvgBytesPerSec = rate.src * 4,
+		                             .nBlockAlign = 4,
+		                             .wBitsPerSample = 16 };
+	AUDIO_FORMAT dstFormat = srcFormat;
+	dstFormat.nSamplesPerSec = rate.dst;
+	dstFormat.nAvgBytesPerSec = rate.dst * 4;
+
+	wStream* out = Stream_New(NULL, 1024);
+	FREERDP_DSP_CONTEXT* dsp = freerdp_dsp_context_new(TRUE);
+	BYTE* src = create_tone(rate.src, channels, frames);
+	if (!out || !dsp || !src)
+		goto fail;
+
+	const struct
+	{
+		const char* name;
+		const FREERDP_DSP_KERNELS* kernels;
+	} variants[] = { { "generic", freerdp_dsp_get_kernels_generic() },
+		             { "optimized", freerdp_dsp_get_kernels() } };
+
+	for (size_t x = 0; x < ARRAYSIZE(variants); x++)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		if (!run_resampler(variants[x].kernels, &rate, channels, src, frames, out))
+			goto fail;
+		const UINT64 diff = MAX(1, winpr_GetTickCount64NS() - start);
+		printf("built-in %-9s: %.1f Mframes/s\n", variants[x].name,
+		       (double)frames * 1000.0 / (double)diff);
+	}
+
+#if defined(WITH_SOXR)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		if (!run_soxr(&rate, channels, src, frames, out))
+			goto fail;
+		const UINT64 diff = MAX(1, winpr_GetTickCount64NS() - start);
+		printf("soxr              : %.1f Mframes/s, SNR %.1fdB\n",
+		       (double)frames * 1000.0 / (double)diff,
+		       measure_snr(Stream_Buffer(out), Stream_Length(out) / 4, channels, rate.dst));
+	}
+#endif
+
+	if (!freerdp_dsp_context_reset(dsp, &dstFormat, 0))
+		goto fail;
+
+	Stream_SetPosition(out, 0);
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < frames; x += TEST_CHUNK_FRAMES)
+	{
+		const size_t count = MIN(TEST_CHUNK_FRAMES, frames - x);
+		if (!freerdp_dsp_encode(dsp, &srcFormat, &src[x * 4], count * 4, out))
+			goto fail;
+	}
+	const UINT64 diff = MAX(1, winpr_GetTickCount64NS() - start);
+	Stream_SealLength(out);
+	printf("freerdp_dsp_encode: %.1f Mframes/s, SNR %.1fdB\n",
+	       (double)frames * 1000.0 / (double)diff,
+	       measure_snr(Stream_Buffer(out), Stream_Length(out) / 4, channels, rate.dst));
+	rc = TRUE;
+
+fail:
+	free(src);
+	freerdp_dsp_context_free(dsp);
+	Stream_Free(out, TRUE);
+	return rc;
+}
+
+int TestFreeRDPCodecDsp(int argc, char* argv[])
+{
+	if (!test_kernels())
+		return -1;
+	if (!test_quality())
+		return -1;
+
+	test_performance_setup(argc, argv);
+	if (g_TestPerformance)
+	{
+		if (!test_throughput())
+			return -1;
+	}
+	return 0;
+}
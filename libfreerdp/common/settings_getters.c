@@ -601,6 +601,9 @@ BOOL freerdp_settings_get_bool(WINPR_ATTR_UNUSED const rdpSettings* settings,
 		case FreeRDP_TlsSecurity:
 			return settings->TlsSecurity;
 
+		case FreeRDP_TlsSessionResumption:
+			return settings->TlsSessionResumption;
+
 		case FreeRDP_ToggleFullscreen:
 			return settings->ToggleFullscreen;
 
@@ -1391,6 +1394,10 @@ BOOL freerdp_settings_set_bool(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->TlsSecurity = cnv.c;
 			break;
 
+		case FreeRDP_TlsSessionResumption:
+			settings->TlsSessionResumption = cnv.c;
+			break;
+
 		case FreeRDP_ToggleFullscreen:
 			settings->ToggleFullscreen = cnv.c;
 			break;
@@ -1727,6 +1734,9 @@ UINT32 freerdp_settings_get_uint32(WINPR_ATTR_UNUSED const rdpSettings* settings
 		case FreeRDP_DrawNineGridCacheSize:
 			return settings->DrawNineGridCacheSize;
 
+		case FreeRDP_DriveDirectoryBatchSize:
+			return settings->DriveDirectoryBatchSize;
+
 		case FreeRDP_DynamicChannelArraySize:
 			return settings->DynamicChannelArraySize;
 
@@ -1775,6 +1785,9 @@ UINT32 freerdp_settings_get_uint32(WINPR_ATTR_UNUSED const rdpSettings* settings
 		case FreeRDP_GlyphSupportLevel:
 			return settings->GlyphSupportLevel;
 
+		case FreeRDP_InputBatchLatency:
+			return settings->InputBatchLatency;
+
 		case FreeRDP_JpegCodecId:
 			return settings->JpegCodecId;
 
@@ -2165,6 +2178,10 @@ BOOL freerdp_settings_set_uint32(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->DrawNineGridCacheSize = cnv.c;
 			break;
 
+		case FreeRDP_DriveDirectoryBatchSize:
+			settings->DriveDirectoryBatchSize = cnv.c;
+			break;
+
 		case FreeRDP_DynamicChannelArraySize:
 			settings->DynamicChannelArraySize = cnv.c;
 			break;
@@ -2229,6 +2246,10 @@ BOOL freerdp_settings_set_uint32(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->GlyphSupportLevel = cnv.c;
 			break;
 
+		case FreeRDP_InputBatchLatency:
+			settings->InputBatchLatency = cnv.c;
+			break;
+
 		case FreeRDP_JpegCodecId:
 			settings->JpegCodecId = cnv.c;
 			break;
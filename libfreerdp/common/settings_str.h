@@ -255,6 +255,7 @@ static const struct settings_str_entry settings_map[] = {
 	  "FreeRDP_SynchronousStaticChannels" },
 	{ FreeRDP_TcpKeepAlive, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TcpKeepAlive" },
 	{ FreeRDP_TlsSecurity, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TlsSecurity" },
+	{ FreeRDP_TlsSessionResumption, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TlsSessionResumption" },
 	{ FreeRDP_ToggleFullscreen, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_ToggleFullscreen" },
 	{ FreeRDP_TransportDump, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportDump" },
 	{ FreeRDP_TransportDumpReplay, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportDumpReplay" },
@@ -327,6 +328,8 @@ static const struct settings_str_entry settings_map[] = {
 	  "FreeRDP_DrawNineGridCacheEntries" },
 	{ FreeRDP_DrawNineGridCacheSize, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_DrawNineGridCacheSize" },
+	{ FreeRDP_DriveDirectoryBatchSize, FREERDP_SETTINGS_TYPE_UINT32,
+	  "FreeRDP_DriveDirectoryBatchSize" },
 	{ FreeRDP_DynamicChannelArraySize, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_DynamicChannelArraySize" },
 	{ FreeRDP_DynamicChannelCount, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_DynamicChannelCount" },
@@ -347,6 +350,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_GatewayUsageMethod, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_GatewayUsageMethod" },
 	{ FreeRDP_GfxCapsFilter, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_GfxCapsFilter" },
 	{ FreeRDP_GlyphSupportLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_GlyphSupportLevel" },
+	{ FreeRDP_InputBatchLatency, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_InputBatchLatency" },
 	{ FreeRDP_JpegCodecId, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_JpegCodecId" },
 	{ FreeRDP_JpegQuality, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_JpegQuality" },
 	{ FreeRDP_KeySpec, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_KeySpec" },
@@ -0,0 +1,160 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Update Parsing Arena
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(x) (((x) + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1))
+
+/* merged blocks larger than this are not kept, a single huge PDU should not pin its memory */
+#define ARENA_MAX_RETAINED (16ull * 1024ull * 1024ull)
+
+typedef struct s_arena_block
+{
+	struct s_arena_block* next;
+	size_t size;
+	size_t used;
+} rdpArenaBlock;
+
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(rdpArenaBlock))
+
+struct rdp_arena
+{
+	size_t blockSize;
+	rdpArenaBlock* head; /* the block allocations are served from, older blocks follow */
+	rdpArenaStats stats;
+};
+
+static rdpArenaBlock* arena_block_new(rdpArena* arena, size_t size)
+{
+	WINPR_ASSERT(arena);
+
+	rdpArenaBlock* block = winpr_aligned_malloc(ARENA_HEADER_SIZE + size, ARENA_ALIGNMENT);
+	if (!block)
+		return NULL;
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	arena->stats.heapAllocations++;
+	arena->stats.reserved += size;
+	return block;
+}
+
+static void arena_blocks_free(rdpArena* arena)
+{
+	WINPR_ASSERT(arena);
+
+	rdpArenaBlock* block = arena->head;
+	while (block)
+	{
+		rdpArenaBlock* next = block->next;
+		winpr_aligned_free(block);
+		block = next;
+	}
+	arena->head = NULL;
+	arena->stats.reserved = 0;
+}
+
+void arena_free(rdpArena* arena)
+{
+	if (!arena)
+		return;
+
+	arena_blocks_free(arena);
+	free(arena);
+}
+
+rdpArena* arena_new(size_t blockSize)
+{
+	if (blockSize == 0)
+		return NULL;
+
+	rdpArena* arena = calloc(1, sizeof(rdpArena));
+	if (!arena)
+		return NULL;
+
+	arena->blockSize = ARENA_ALIGN(blockSize);
+	return arena;
+}
+
+void* arena_calloc(rdpArena* arena, size_t nmemb, size_t size)
+{
+	WINPR_ASSERT(arena);
+
+	if ((size != 0) && (nmemb > (SIZE_MAX - ARENA_ALIGNMENT) / size))
+		return NULL;
+
+	const size_t length = ARENA_ALIGN(nmemb * size);
+	rdpArenaBlock* block = arena->head;
+
+	if (!block || (block->size - block->used < length))
+	{
+		block = arena_block_new(arena, (length > arena->blockSize) ? length : arena->blockSize);
+		if (!block)
+			return NULL;
+
+		block->next = arena->head;
+		arena->head = block;
+	}
+
+	BYTE* ptr = &((BYTE*)block)[ARENA_HEADER_SIZE + block->used];
+	block->used += length;
+	arena->stats.allocations++;
+	memset(ptr, 0, length);
+	return ptr;
+}
+
+void arena_reset(rdpArena* arena)
+{
+	WINPR_ASSERT(arena);
+
+	arena->stats.resets++;
+
+	rdpArenaBlock* block = arena->head;
+	if (!block)
+		return;
+
+	if (!block->next)
+	{
+		block->used = 0;
+		return;
+	}
+
+	size_t size = 0;
+	for (rdpArenaBlock* cur = block; cur; cur = cur->next)
+		size += cur->size;
+
+	arena_blocks_free(arena);
+	if (size <= ARENA_MAX_RETAINED)
+		arena->head = arena_block_new(arena, size);
+}
+
+void arena_get_stats(const rdpArena* arena, rdpArenaStats* stats)
+{
+	WINPR_ASSERT(arena);
+	WINPR_ASSERT(stats);
+
+	*stats = arena->stats;
+}
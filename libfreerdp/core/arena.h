@@ -0,0 +1,56 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Update Parsing Arena
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_ARENA_H
+#define FREERDP_LIB_CORE_ARENA_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+/** A bump allocator for structures that only live until the end of the PDU they were parsed
+ *  from. Allocations are never freed individually, arena_reset releases all of them at once. */
+typedef struct rdp_arena rdpArena;
+
+typedef struct
+{
+	size_t allocations;     /* allocations served since arena_new */
+	size_t heapAllocations; /* blocks requested from the heap since arena_new */
+	size_t resets;          /* calls to arena_reset */
+	size_t reserved;        /* bytes currently held in blocks */
+} rdpArenaStats;
+
+FREERDP_LOCAL void arena_free(rdpArena* arena);
+
+WINPR_ATTR_MALLOC(arena_free, 1)
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL rdpArena* arena_new(size_t blockSize);
+
+/** @brief returns nmemb * size zeroed bytes, aligned for any type, or NULL on overflow or
+ *  allocation failure. The memory stays valid until the next arena_reset. */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL void* arena_calloc(rdpArena* arena, size_t nmemb, size_t size);
+
+/** @brief invalidates every allocation of the arena.
+ *
+ *  The block is kept for the next PDU. If the last PDU needed more than one block they are
+ *  merged into a single one, so a steady workload stops hitting the heap. */
+FREERDP_LOCAL void arena_reset(rdpArena* arena);
+
+FREERDP_LOCAL void arena_get_stats(const rdpArena* arena, rdpArenaStats* stats);
+
+#endif /* FREERDP_LIB_CORE_ARENA_H */
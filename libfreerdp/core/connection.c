@@ -486,6 +486,10 @@ BOOL rdp_client_disconnect(rdpRdp* rdp)
 
 	context = rdp->context;
 
+	/* a batched mouse move is still on its way, we do not care about success */
+	if (rdp->input && rdp_is_active_state(rdp))
+		(void)input_flush(rdp->input);
+
 	if (rdp->nego)
 	{
 		if (!nego_disconnect(rdp->nego))
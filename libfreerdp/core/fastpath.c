@@ -310,7 +310,6 @@ static BOOL fastpath_recv_update_common(rdpFastPath* fastpath, wStream* s)
 				return FALSE;
 
 			rc = IFCALLRESULT(defaultReturn, update->BitmapUpdate, context, bitmap_update);
-			free_bitmap_update(context, bitmap_update);
 		}
 		break;
 
@@ -353,9 +352,6 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 	if (!fastpath || !fastpath->rdp || !s)
 		return -1;
 
-	Stream_SealLength(s);
-	Stream_SetPosition(s, 0);
-
 	rdpUpdate* update = fastpath->rdp->update;
 
 	if (!update || !update->pointer || !update->context)
@@ -544,11 +540,6 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 		return -1;
 	}
 
-	if (!Stream_EnsureRemainingCapacity(fastpath->updateData, DstSize))
-		return -1;
-
-	Stream_Write(fastpath->updateData, pDstData, DstSize);
-
 	if (fragmentation == FASTPATH_FRAGMENT_SINGLE)
 	{
 		if (fastpath->fragmentation != -1)
@@ -557,7 +548,11 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 			goto out_fail;
 		}
 
-		status = fastpath_recv_update(fastpath, updateCode, fastpath->updateData);
+		/* A complete update, parse it in place. Uncompressed data still points to the
+		 * received stream, allowing asynchronous consumers to reference instead of copy it. */
+		wStream sbuffer = { 0 };
+		wStream* us = Stream_StaticConstInit(&sbuffer, pDstData, DstSize);
+		status = fastpath_recv_update(fastpath, updateCode, us);
 
 		if (status < 0)
 		{
@@ -567,13 +562,19 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 	}
 	else
 	{
-		rdpContext* context = NULL;
-		const size_t totalSize = Stream_GetPosition(fastpath->updateData);
-
-		context = transport_get_context(transport);
+		rdpContext* context = transport_get_context(transport);
 		WINPR_ASSERT(context);
 		WINPR_ASSERT(context->settings);
 
+		if (!Stream_EnsureRemainingCapacity(fastpath->updateData, DstSize))
+			return -1;
+
+		Stream_Write(fastpath->updateData, pDstData, DstSize);
+		if (context->metrics)
+			context->metrics->TotalUpdateBytesCopied += DstSize;
+
+		const size_t totalSize = Stream_GetPosition(fastpath->updateData);
+
 		if (totalSize > context->settings->MultifragMaxRequestSize)
 		{
 			WLog_ERR(TAG, "Total size (%" PRIuz ") exceeds MultifragMaxRequestSize (%" PRIu32 ")",
@@ -612,6 +613,8 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 			}
 
 			fastpath->fragmentation = -1;
+			Stream_SealLength(fastpath->updateData);
+			Stream_SetPosition(fastpath->updateData, 0);
 			status = fastpath_recv_update(fastpath, updateCode, fastpath->updateData);
 
 			if (status < 0)
@@ -19,7 +19,10 @@
 
 #include <freerdp/config.h>
 
+#include <stddef.h>
+
 #include <winpr/crt.h>
+#include <winpr/assert.h>
 
 #include <freerdp/graphics.h>
 
@@ -110,6 +113,12 @@ void graphics_register_pointer(rdpGraphics* graphics, const rdpPointer* pointer)
 
 /* Glyph Class */
 
+/* the public fields of rdpGlyph keep the offsets they had before DrawRun was added */
+WINPR_STATIC_ASSERT(offsetof(rdpGlyph, x) == 7 * sizeof(void*) + 9 * sizeof(UINT32));
+WINPR_STATIC_ASSERT(offsetof(rdpGlyph, aj) == offsetof(rdpGlyph, x) + 5 * sizeof(UINT32));
+WINPR_STATIC_ASSERT(sizeof(rdpGlyph) ==
+                    offsetof(rdpGlyph, aj) + sizeof(void*) + 10 * sizeof(UINT32));
+
 rdpGlyph* Glyph_Alloc(rdpContext* context, INT32 x, INT32 y, UINT32 cx, UINT32 cy, UINT32 cb,
                       const BYTE* aj)
 {
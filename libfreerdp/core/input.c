@@ -22,9 +22,12 @@
 
 #include <winpr/crt.h>
 #include <winpr/assert.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/input.h>
 #include <freerdp/log.h>
+#include <freerdp/metrics.h>
+#include <freerdp/timer.h>
 
 #include "message.h"
 
@@ -381,74 +384,343 @@ static BOOL input_send_keyboard_pause_event(rdpInput* input)
 	                                 RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
 }
 
-static BOOL input_send_fastpath_synchronize_event(rdpInput* input, UINT32 flags)
+typedef struct
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	wStream* s;
+	UINT16 sec_flags;
+	size_t events;
+	size_t sources;
+} input_fastpath_pdu;
+
+/* A pending mouse move taken out of the batch */
+typedef struct
+{
+	size_t events;
+	BYTE eventCode;
+	UINT16 x;
+	UINT16 y;
+	INT32 deltaX;
+	INT32 deltaY;
+} input_batch;
+
+static void input_batch_account(rdp_input_internal* in, size_t sources)
+{
+	WINPR_ASSERT(in);
+
+	rdpContext* context = in->common.context;
+	if (!context || !context->metrics)
+		return;
+
+	rdpMetrics* metrics = context->metrics;
+	size_t bucket = 0;
+	while ((bucket + 1 < ARRAYSIZE(metrics->InputBatchSizes)) && (sources >> (bucket + 1)))
+		bucket++;
+	metrics->InputBatchSizes[bucket]++;
+	if (sources > 1)
+		metrics->InputEventsCoalesced += sources - 1;
+}
 
-	WINPR_ASSERT(input);
+static void input_fastpath_write_event_header(wStream* s, BYTE eventFlags, BYTE eventCode)
+{
+	WINPR_ASSERT(s);
+	WINPR_ASSERT(eventCode < 8);
+	WINPR_ASSERT(eventFlags < 0x20);
+	Stream_Write_UINT8(s, (UINT8)(eventFlags | (eventCode << 5))); /* eventHeader (1 byte) */
+}
+
+/* Take the pending mouse move, if any. Must be called with batchLock held. */
+static BOOL input_batch_take_locked(rdp_input_internal* in, input_batch* batch)
+{
+	WINPR_ASSERT(in);
+	WINPR_ASSERT(batch);
+
+	if (!in->batchPending)
+		return FALSE;
+
+	batch->events = in->batchEvents;
+	batch->eventCode = in->batchEventCode;
+	batch->x = in->batchX;
+	batch->y = in->batchY;
+	batch->deltaX = in->batchDeltaX;
+	batch->deltaY = in->batchDeltaY;
+
+	in->batchPending = FALSE;
+	in->batchEvents = 0;
+	in->batchDeltaX = 0;
+	in->batchDeltaY = 0;
+	return TRUE;
+}
+
+/* Start a Fast-Path input PDU, a pending batched mouse move is written as first event.
+ * Holds sendLock until the PDU is sent or aborted, batchLock only while taking the move. */
+static BOOL input_fastpath_pdu_begin(rdpInput* input, input_fastpath_pdu* pdu)
+{
+	rdp_input_internal* in = input_cast(input);
+	input_batch batch = { 0 };
+
+	WINPR_ASSERT(pdu);
 	WINPR_ASSERT(input->context);
+	rdpRdp* rdp = input->context->rdp;
+	WINPR_ASSERT(rdp);
 
-	rdp = input->context->rdp;
+	*pdu = (input_fastpath_pdu){ 0 };
+
+	EnterCriticalSection(&in->sendLock);
+	pdu->s = fastpath_input_pdu_init_header(rdp->fastpath, &pdu->sec_flags);
+	if (!pdu->s)
+	{
+		LeaveCriticalSection(&in->sendLock);
+		return FALSE;
+	}
+
+	EnterCriticalSection(&in->batchLock);
+	const BOOL pending = input_batch_take_locked(in, &batch);
+	LeaveCriticalSection(&in->batchLock);
+
+	if (pending)
+	{
+		input_fastpath_write_event_header(pdu->s, 0, batch.eventCode);
+		if (batch.eventCode == TS_FP_RELPOINTER_EVENT)
+		{
+			Stream_Write_UINT16(pdu->s, PTR_FLAGS_MOVE); /* pointerFlags */
+			Stream_Write_INT16(pdu->s, WINPR_ASSERTING_INT_CAST(INT16, batch.deltaX)); /* xDelta */
+			Stream_Write_INT16(pdu->s, WINPR_ASSERTING_INT_CAST(INT16, batch.deltaY)); /* yDelta */
+		}
+		else
+			input_write_mouse_event(pdu->s, PTR_FLAGS_MOVE, batch.x, batch.y);
+
+		pdu->events = 1;
+		pdu->sources = batch.events;
+	}
+	return TRUE;
+}
+
+/* Send a PDU started with input_fastpath_pdu_begin with \b count additional events */
+static BOOL input_fastpath_pdu_send(rdpInput* input, input_fastpath_pdu* pdu, size_t count)
+{
+	rdp_input_internal* in = input_cast(input);
+
+	WINPR_ASSERT(pdu);
+	WINPR_ASSERT(input->context);
+	rdpRdp* rdp = input->context->rdp;
 	WINPR_ASSERT(rdp);
 
-	if (!input_ensure_client_running(input))
+	const BOOL rc = fastpath_send_multiple_input_pdu(rdp->fastpath, pdu->s, pdu->events + count,
+	                                                 pdu->sec_flags);
+	pdu->s = NULL;
+	if (rc)
+		input_batch_account(in, pdu->sources + count);
+	LeaveCriticalSection(&in->sendLock);
+	return rc;
+}
+
+static void input_fastpath_pdu_abort(rdpInput* input, input_fastpath_pdu* pdu)
+{
+	rdp_input_internal* in = input_cast(input);
+
+	WINPR_ASSERT(pdu);
+	Stream_Release(pdu->s);
+	pdu->s = NULL;
+	LeaveCriticalSection(&in->sendLock);
+}
+
+/* Send the pending mouse move on its own. Must be called without batchLock held. */
+static BOOL input_batch_flush(rdpInput* input)
+{
+	input_fastpath_pdu pdu = { 0 };
+
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
-	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
-	s = fastpath_input_pdu_init(rdp->fastpath, (BYTE)flags, FASTPATH_INPUT_EVENT_SYNC, &sec_flags);
+	/* flushed by someone else in the meantime */
+	if (pdu.events == 0)
+	{
+		input_fastpath_pdu_abort(input, &pdu);
+		return TRUE;
+	}
+	return input_fastpath_pdu_send(input, &pdu, 0);
+}
 
-	if (!s)
+BOOL input_flush(rdpInput* input)
+{
+	WINPR_ASSERT(input);
+
+	rdp_input_internal* in = input_cast(input);
+
+	EnterCriticalSection(&in->batchLock);
+	const BOOL pending = in->batchPending;
+	LeaveCriticalSection(&in->batchLock);
+
+	if (!pending)
+		return TRUE;
+	return input_batch_flush(input);
+}
+
+static uint64_t input_batch_timer_cb(WINPR_ATTR_UNUSED rdpContext* context, void* userdata,
+                                     WINPR_ATTR_UNUSED FreeRDP_TimerID timerID, uint64_t timestamp,
+                                     WINPR_ATTR_UNUSED uint64_t interval)
+{
+	rdpInput* input = userdata;
+	rdp_input_internal* in = input_cast(input);
+	uint64_t next = 0;
+	BOOL flush = FALSE;
+
+	EnterCriticalSection(&in->batchLock);
+	if (in->batchPending)
+	{
+		const uint64_t age = timestamp - in->batchStartNS;
+		if (age < in->batchLatencyNS)
+			next = in->batchLatencyNS - age;
+		else
+			flush = TRUE;
+	}
+
+	/* returning 0 disables the timer, the next batched event arms a new one */
+	if (next == 0)
+		in->batchTimerArmed = FALSE;
+	LeaveCriticalSection(&in->batchLock);
+
+	if (flush && !input_batch_flush(input))
+		WLog_Print(in->log, WLOG_WARN, "failed to flush batched mouse movement");
+	return next;
+}
+
+/* Must be called with batchLock held */
+static BOOL input_batch_compatible_locked(const rdp_input_internal* in, BYTE eventCode, INT32 x,
+                                          INT32 y)
+{
+	WINPR_ASSERT(in);
+
+	if (!in->batchPending)
+		return TRUE;
+	if (in->batchEventCode != eventCode)
 		return FALSE;
+	if (eventCode != TS_FP_RELPOINTER_EVENT)
+		return TRUE;
 
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	const INT32 dx = in->batchDeltaX + x;
+	const INT32 dy = in->batchDeltaY + y;
+	return (dx >= INT16_MIN) && (dx <= INT16_MAX) && (dy >= INT16_MIN) && (dy <= INT16_MAX);
+}
+
+/* Queue a mouse move event for at most FreeRDP_InputBatchLatency.
+ * Absolute moves replace the pending position, relative moves are accumulated.
+ * Any other input event sent in the meantime carries the pending move in the same PDU. */
+static BOOL input_batch_move(rdpInput* input, BYTE eventCode, INT32 x, INT32 y)
+{
+	rdp_input_internal* in = input_cast(input);
+	BOOL flush = FALSE;
+	BOOL armTimer = FALSE;
+
+	EnterCriticalSection(&in->batchLock);
+
+	/* the pending move can not absorb this one, send it first to keep the order */
+	while (!input_batch_compatible_locked(in, eventCode, x, y))
+	{
+		LeaveCriticalSection(&in->batchLock);
+		if (!input_batch_flush(input))
+			return FALSE;
+		EnterCriticalSection(&in->batchLock);
+	}
+
+	const uint64_t now = winpr_GetTickCount64NS();
+	if (!in->batchPending)
+	{
+		in->batchPending = TRUE;
+		in->batchEventCode = eventCode;
+		in->batchStartNS = now;
+	}
+
+	if (eventCode == TS_FP_RELPOINTER_EVENT)
+	{
+		in->batchDeltaX += x;
+		in->batchDeltaY += y;
+	}
+	else
+	{
+		in->batchX = WINPR_ASSERTING_INT_CAST(UINT16, x);
+		in->batchY = WINPR_ASSERTING_INT_CAST(UINT16, y);
+	}
+	in->batchEvents++;
+
+	if (now - in->batchStartNS >= in->batchLatencyNS)
+		flush = TRUE;
+	else if (!in->batchTimerArmed)
+	{
+		in->batchTimerArmed = TRUE;
+		armTimer = TRUE;
+	}
+	LeaveCriticalSection(&in->batchLock);
+
+	/* The timer callback runs with the timer list locked, do not add timers with batchLock held */
+	if (armTimer)
+	{
+		if (freerdp_timer_add(input->context, in->batchLatencyNS, input_batch_timer_cb, input,
+		                      false) == 0)
+		{
+			EnterCriticalSection(&in->batchLock);
+			in->batchTimerArmed = FALSE;
+			LeaveCriticalSection(&in->batchLock);
+			flush = TRUE;
+		}
+	}
+
+	if (flush)
+		return input_batch_flush(input);
+	return TRUE;
+}
+
+static BOOL input_send_fastpath_synchronize_event(rdpInput* input, UINT32 flags)
+{
+	input_fastpath_pdu pdu = { 0 };
+
+	WINPR_ASSERT(input);
+	WINPR_ASSERT(input->context);
+
+	if (!input_ensure_client_running(input))
+		return FALSE;
+
+	if (!input_fastpath_pdu_begin(input, &pdu))
+		return FALSE;
+
+	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
+	input_fastpath_write_event_header(pdu.s, (BYTE)flags, FASTPATH_INPUT_EVENT_SYNC);
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_keyboard_event(rdpInput* input, UINT16 flags, UINT8 code)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
+	input_fastpath_pdu pdu = { 0 };
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED) ? FASTPATH_INPUT_KBDFLAGS_EXTENDED : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED1) ? FASTPATH_INPUT_KBDFLAGS_PREFIX_E1 : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE,
-	                            &sec_flags);
 
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
+	input_fastpath_write_event_header(pdu.s, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE);
 	WINPR_ASSERT(code <= UINT8_MAX);
-	Stream_Write_UINT8(s, code); /* keyCode (1 byte) */
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	Stream_Write_UINT8(pdu.s, code); /* keyCode (1 byte) */
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_unicode_keyboard_event(rdpInput* input, UINT16 flags, UINT16 code)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
+	input_fastpath_pdu pdu = { 0 };
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -459,29 +731,23 @@ static BOOL input_send_fastpath_unicode_keyboard_event(rdpInput* input, UINT16 f
 	}
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_UNICODE,
-	                            &sec_flags);
 
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
-	Stream_Write_UINT16(s, code); /* unicodeCode (2 bytes) */
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	input_fastpath_write_event_header(pdu.s, eventFlags, FASTPATH_INPUT_EVENT_UNICODE);
+	Stream_Write_UINT16(pdu.s, code); /* unicodeCode (2 bytes) */
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_mouse_event(rdpInput* input, UINT16 flags, UINT16 x, UINT16 y)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	input_fastpath_pdu pdu = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -497,28 +763,26 @@ static BOOL input_send_fastpath_mouse_event(rdpInput* input, UINT16 flags, UINT1
 		}
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSE, &sec_flags);
+	/* Only plain moves are batched, buttons and wheel are never delayed */
+	if ((flags == PTR_FLAGS_MOVE) && (input_cast(input)->batchLatencyNS > 0))
+		return input_batch_move(input, FASTPATH_INPUT_EVENT_MOUSE, x, y);
 
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
-	input_write_mouse_event(s, flags, x, y);
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	input_fastpath_write_event_header(pdu.s, 0, FASTPATH_INPUT_EVENT_MOUSE);
+	input_write_mouse_event(pdu.s, flags, x, y);
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_extended_mouse_event(rdpInput* input, UINT16 flags, UINT16 x,
                                                      UINT16 y)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	input_fastpath_pdu pdu = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -531,29 +795,23 @@ static BOOL input_send_fastpath_extended_mouse_event(rdpInput* input, UINT16 fla
 		return TRUE;
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSEX, &sec_flags);
-
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
-	input_write_extended_mouse_event(s, flags, x, y);
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	input_fastpath_write_event_header(pdu.s, 0, FASTPATH_INPUT_EVENT_MOUSEX);
+	input_write_extended_mouse_event(pdu.s, flags, x, y);
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_relmouse_event(rdpInput* input, UINT16 flags, INT16 xDelta,
                                                INT16 yDelta)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	input_fastpath_pdu pdu = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -563,26 +821,27 @@ static BOOL input_send_fastpath_relmouse_event(rdpInput* input, UINT16 flags, IN
 		return FALSE;
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, TS_FP_RELPOINTER_EVENT, &sec_flags);
+	if ((flags == PTR_FLAGS_MOVE) && (input_cast(input)->batchLatencyNS > 0))
+		return input_batch_move(input, TS_FP_RELPOINTER_EVENT, xDelta, yDelta);
 
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
-	Stream_Write_UINT16(s, flags); /* pointerFlags (2 bytes) */
-	Stream_Write_INT16(s, xDelta); /* xDelta (2 bytes) */
-	Stream_Write_INT16(s, yDelta); /* yDelta (2 bytes) */
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	input_fastpath_write_event_header(pdu.s, 0, TS_FP_RELPOINTER_EVENT);
+	Stream_Write_UINT16(pdu.s, flags); /* pointerFlags (2 bytes) */
+	Stream_Write_INT16(pdu.s, xDelta); /* xDelta (2 bytes) */
+	Stream_Write_INT16(pdu.s, yDelta); /* yDelta (2 bytes) */
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_qoe_event(rdpInput* input, UINT32 timestampMS)
 {
+	input_fastpath_pdu pdu = { 0 };
+
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdpRdp* rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -592,55 +851,46 @@ static BOOL input_send_fastpath_qoe_event(rdpInput* input, UINT32 timestampMS)
 		return FALSE;
 	}
 
-	UINT16 sec_flags = 0;
-	wStream* s = fastpath_input_pdu_init(rdp->fastpath, 0, TS_FP_QOETIMESTAMP_EVENT, &sec_flags);
-
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
-	if (!Stream_EnsureRemainingCapacity(s, 4))
+	if (!Stream_EnsureRemainingCapacity(pdu.s, 5))
 	{
-		Stream_Free(s, TRUE);
+		input_fastpath_pdu_abort(input, &pdu);
 		return FALSE;
 	}
 
-	Stream_Write_UINT32(s, timestampMS);
-	return fastpath_send_input_pdu(rdp->fastpath, s, sec_flags);
+	input_fastpath_write_event_header(pdu.s, 0, TS_FP_QOETIMESTAMP_EVENT);
+	Stream_Write_UINT32(pdu.s, timestampMS);
+	return input_fastpath_pdu_send(input, &pdu, 1);
 }
 
 static BOOL input_send_fastpath_focus_in_event(rdpInput* input, UINT16 toggleStates)
 {
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
+	input_fastpath_pdu pdu = { 0 };
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	s = fastpath_input_pdu_init_header(rdp->fastpath, &sec_flags);
-
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
 	/* send a tab up like mstsc.exe */
 	eventFlags = FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_EVENT_SCANCODE << 5;
-	Stream_Write_UINT8(s, eventFlags); /* Key Release event (1 byte) */
-	Stream_Write_UINT8(s, 0x0f);       /* keyCode (1 byte) */
+	Stream_Write_UINT8(pdu.s, eventFlags); /* Key Release event (1 byte) */
+	Stream_Write_UINT8(pdu.s, 0x0f);       /* keyCode (1 byte) */
 	/* send the toggle key states */
 	eventFlags = (toggleStates & 0x1F) | FASTPATH_INPUT_EVENT_SYNC << 5;
-	Stream_Write_UINT8(s, eventFlags); /* toggle state (1 byte) */
+	Stream_Write_UINT8(pdu.s, eventFlags); /* toggle state (1 byte) */
 	/* send another tab up like mstsc.exe */
 	eventFlags = FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_EVENT_SCANCODE << 5;
-	Stream_Write_UINT8(s, eventFlags); /* Key Release event (1 byte) */
-	Stream_Write_UINT8(s, 0x0f);       /* keyCode (1 byte) */
-	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, 3, sec_flags);
+	Stream_Write_UINT8(pdu.s, eventFlags); /* Key Release event (1 byte) */
+	Stream_Write_UINT8(pdu.s, 0x0f);       /* keyCode (1 byte) */
+	return input_fastpath_pdu_send(input, &pdu, 3);
 }
 
 static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
@@ -649,39 +899,32 @@ static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
 	 * and pause-up sent nothing.  However, reverse engineering mstsc shows
 	 * it sending the following sequence:
 	 */
-	UINT16 sec_flags = 0;
-	wStream* s = NULL;
+	input_fastpath_pdu pdu = { 0 };
 	const BYTE keyDownEvent = FASTPATH_INPUT_EVENT_SCANCODE << 5;
 	const BYTE keyUpEvent = (FASTPATH_INPUT_EVENT_SCANCODE << 5) | FASTPATH_INPUT_KBDFLAGS_RELEASE;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	s = fastpath_input_pdu_init_header(rdp->fastpath, &sec_flags);
-
-	if (!s)
+	if (!input_fastpath_pdu_begin(input, &pdu))
 		return FALSE;
 
 	/* Control down (0x1D) */
-	Stream_Write_UINT8(s, keyDownEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL));
+	Stream_Write_UINT8(pdu.s, keyDownEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
+	Stream_Write_UINT8(pdu.s, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL));
 	/* Numlock down (0x45) */
-	Stream_Write_UINT8(s, keyDownEvent);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
+	Stream_Write_UINT8(pdu.s, keyDownEvent);
+	Stream_Write_UINT8(pdu.s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
 	/* Control up (0x1D) */
-	Stream_Write_UINT8(s, keyUpEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL));
+	Stream_Write_UINT8(pdu.s, keyUpEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
+	Stream_Write_UINT8(pdu.s, RDP_SCANCODE_CODE(RDP_SCANCODE_LCONTROL));
 	/* Numlock down (0x45) */
-	Stream_Write_UINT8(s, keyUpEvent);
-	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
-	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, 4, sec_flags);
+	Stream_Write_UINT8(pdu.s, keyUpEvent);
+	Stream_Write_UINT8(pdu.s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
+	return input_fastpath_pdu_send(input, &pdu, 4);
 }
 
 static BOOL input_recv_sync_event(rdpInput* input, wStream* s)
@@ -924,6 +1167,16 @@ BOOL input_register_client_callbacks(rdpInput* input)
 
 	if (freerdp_settings_get_bool(settings, FreeRDP_FastPathInput))
 	{
+		rdp_input_internal* in = input_cast(input);
+		EnterCriticalSection(&in->batchLock);
+		in->batchLatencyNS =
+		    1000000ull * freerdp_settings_get_uint32(settings, FreeRDP_InputBatchLatency);
+		in->batchPending = FALSE;
+		in->batchEvents = 0;
+		in->batchDeltaX = 0;
+		in->batchDeltaY = 0;
+		LeaveCriticalSection(&in->batchLock);
+
 		input->SynchronizeEvent = input_send_fastpath_synchronize_event;
 		input->KeyboardEvent = input_send_fastpath_keyboard_event;
 		input->KeyboardPauseEvent = input_send_fastpath_keyboard_pause_event;
@@ -1140,6 +1393,21 @@ rdpInput* input_new(rdpRdp* rdp)
 		return NULL;
 	}
 
+	if (!InitializeCriticalSectionAndSpinCount(&input->sendLock, 4000))
+	{
+		MessageQueue_Free(input->queue);
+		free(input);
+		return NULL;
+	}
+
+	if (!InitializeCriticalSectionAndSpinCount(&input->batchLock, 4000))
+	{
+		DeleteCriticalSection(&input->sendLock);
+		MessageQueue_Free(input->queue);
+		free(input);
+		return NULL;
+	}
+
 	return &input->common;
 }
 
@@ -1148,7 +1416,29 @@ void input_free(rdpInput* input)
 	if (input != NULL)
 	{
 		rdp_input_internal* in = input_cast(input);
+		const rdpMetrics* metrics = input->context ? input->context->metrics : NULL;
+
+		if (metrics && WLog_IsLevelActive(in->log, WLOG_DEBUG))
+		{
+			char buffer[256] = { 0 };
+			for (size_t x = 0; x < ARRAYSIZE(metrics->InputBatchSizes); x++)
+			{
+				char entry[32] = { 0 };
+				(void)_snprintf(entry, sizeof(entry), "%" PRIuz ":%" PRIu64, (size_t)1 << x,
+				                metrics->InputBatchSizes[x]);
+				(void)winpr_str_append(entry, buffer, sizeof(buffer), " ");
+			}
+			WLog_Print(in->log, WLOG_DEBUG, "input batch sizes [%s], %" PRIu64 " events coalesced",
+			           buffer, metrics->InputEventsCoalesced);
+		}
+
+		/* rdp_free and disconnect flush while the transport is still available */
+		if (in->batchPending)
+			WLog_Print(in->log, WLOG_DEBUG, "dropping %" PRIuz " batched mouse moves",
+			           in->batchEvents);
 
+		DeleteCriticalSection(&in->batchLock);
+		DeleteCriticalSection(&in->sendLock);
 		MessageQueue_Free(in->queue);
 		free(in);
 	}
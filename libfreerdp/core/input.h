@@ -29,6 +29,7 @@
 #include <freerdp/api.h>
 
 #include <winpr/stream.h>
+#include <winpr/synch.h>
 
 typedef struct
 {
@@ -42,6 +43,21 @@ typedef struct
 	UINT16 lastX;
 	UINT16 lastY;
 	wLog* log;
+
+	/* Fast-Path mouse move batching, protected by batchLock. sendLock keeps the order of PDUs
+	 * carrying batched moves, it is taken before batchLock and held while sending. */
+	CRITICAL_SECTION sendLock;
+	CRITICAL_SECTION batchLock;
+	UINT64 batchLatencyNS;
+	UINT64 batchStartNS;
+	size_t batchEvents;
+	BOOL batchPending;
+	BYTE batchEventCode;
+	UINT16 batchX;
+	UINT16 batchY;
+	INT32 batchDeltaX;
+	INT32 batchDeltaY;
+	BOOL batchTimerArmed;
 } rdp_input_internal;
 
 static inline rdp_input_internal* input_cast(rdpInput* input)
@@ -62,6 +78,9 @@ FREERDP_LOCAL BOOL input_recv(rdpInput* input, wStream* s);
 FREERDP_LOCAL int input_process_events(rdpInput* input);
 FREERDP_LOCAL BOOL input_register_client_callbacks(rdpInput* input);
 
+/** Send a batched mouse move now instead of waiting for FreeRDP_InputBatchLatency to expire */
+FREERDP_LOCAL BOOL input_flush(rdpInput* input);
+
 FREERDP_LOCAL void input_free(rdpInput* input);
 
 WINPR_ATTR_MALLOC(input_free, 1)
@@ -49,6 +49,7 @@
 
 #include "listener.h"
 #include "utils.h"
+#include "../crypto/tls.h"
 
 #define TAG FREERDP_TAG("core.listener")
 
@@ -459,7 +460,8 @@ static BOOL freerdp_check_and_create_client(freerdp_listener* instance, int peer
 		return FALSE;
 	}
 
-	if (!freerdp_peer_set_local_and_hostname(client, peer_addr))
+	if (!freerdp_listener_attach_tls(instance, client) ||
+	    !freerdp_peer_set_local_and_hostname(client, peer_addr))
 	{
 		freerdp_peer_free(client);
 		return FALSE;
@@ -544,6 +546,13 @@ freerdp_listener* freerdp_listener_new(void)
 		return NULL;
 	}
 
+	if (!InitializeCriticalSectionAndSpinCount(&listener->lock, 4000))
+	{
+		free(listener);
+		free(instance);
+		return NULL;
+	}
+
 	listener->instance = instance;
 	instance->listener = (void*)listener;
 	return instance;
@@ -553,7 +562,55 @@ void freerdp_listener_free(freerdp_listener* instance)
 {
 	if (instance)
 	{
-		free(instance->listener);
+		rdpListener* listener = (rdpListener*)instance->listener;
+		if (listener)
+		{
+			freerdp_tls_server_context_release(listener->tls);
+			DeleteCriticalSection(&listener->lock);
+		}
+		free(listener);
 		free(instance);
 	}
 }
+
+BOOL freerdp_listener_set_tls_settings(freerdp_listener* instance, const rdpSettings* settings)
+{
+	WINPR_ASSERT(instance);
+
+	rdpListener* listener = (rdpListener*)instance->listener;
+	WINPR_ASSERT(listener);
+
+	rdpTlsServerContext* tls = NULL;
+	if (settings)
+	{
+		tls = freerdp_tls_server_context_new(settings);
+		if (!tls)
+			return FALSE;
+	}
+
+	/* peers accepted so far keep their reference to the previous context */
+	EnterCriticalSection(&listener->lock);
+	rdpTlsServerContext* old = listener->tls;
+	listener->tls = tls;
+	LeaveCriticalSection(&listener->lock);
+
+	freerdp_tls_server_context_release(old);
+	return TRUE;
+}
+
+BOOL freerdp_listener_attach_tls(freerdp_listener* instance, freerdp_peer* client)
+{
+	WINPR_ASSERT(instance);
+	WINPR_ASSERT(client);
+
+	rdpListener* listener = (rdpListener*)instance->listener;
+	WINPR_ASSERT(listener);
+
+	EnterCriticalSection(&listener->lock);
+	rdpTlsServerContext* tls = freerdp_tls_server_context_ref(listener->tls);
+	LeaveCriticalSection(&listener->lock);
+
+	freerdp_tls_server_context_release(client->TlsServerContext);
+	client->TlsServerContext = tls;
+	return TRUE;
+}
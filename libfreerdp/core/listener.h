@@ -38,6 +38,10 @@ struct rdp_listener
 	int num_sockfds;
 	int sockfds[MAX_LISTENER_HANDLES];
 	HANDLE events[MAX_LISTENER_HANDLES];
+
+	/* TLS server context handed to accepted peers, replaced under lock */
+	CRITICAL_SECTION lock;
+	rdpTlsServerContext* tls;
 };
 
 #endif /* FREERDP_LIB_CORE_LISTENER_H */
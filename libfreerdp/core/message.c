@@ -29,6 +29,8 @@
 
 #include <freerdp/log.h>
 #include <freerdp/freerdp.h>
+#include <freerdp/metrics.h>
+#include <freerdp/codec/region.h>
 
 #include <winpr/crt.h>
 #include <winpr/stream.h>
@@ -43,6 +45,360 @@
 
 #define TAG FREERDP_TAG("core.message")
 
+static BOOL update_message_free_class(wMessage* msg, int msgClass, int msgType);
+
+/* Coalescing
+ *
+ * If the consumer falls behind, messages still waiting in the queue might already be obsolete
+ * when the next one arrives. Instead of replaying them, merge the new message into the queued
+ * ones where the result is identical: pointer positions and shapes, opaque rectangles covering
+ * each other and refresh requests. Damage that is completely overwritten by a following full
+ * surface update is dropped.
+ *
+ * The payload of a posted message always ends up owned by the queue: a callback returning
+ * WMQ_COALESCE_MERGED either moves it into the queued message or frees it, and if posting
+ * fails it is freed here. Callers must not touch wParam or lParam afterwards.
+ */
+
+static BOOL update_message_post_coalesced(rdpContext* context, UINT32 id, void* wParam,
+                                          void* lParam, MESSAGE_QUEUE_COALESCE_FN fn)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(context->update);
+
+	const wMessage message = {
+		.context = context, .id = id, .wParam = wParam, .lParam = lParam, .Free = NULL
+	};
+	rdp_update_internal* up = update_cast(context->update);
+	int rc = 0;
+	if (fn)
+		rc = MessageQueue_Coalesce(up->queue, &message, fn, context);
+	else if (!MessageQueue_Dispatch(up->queue, &message))
+		rc = -1;
+	if (rc < 0)
+	{
+		/* neither queued nor merged, the payload is still ours */
+		wMessage msg = message;
+		(void)update_message_free_class(&msg, GetMessageClass(id), GetMessageType(id));
+		return FALSE;
+	}
+
+	rdpMetrics* metrics = context->metrics;
+	if (metrics)
+	{
+		if (rc > 0)
+			metrics->UpdateQueueCoalesced++;
+		metrics->UpdateQueueMaxDepth =
+		    MAX(metrics->UpdateQueueMaxDepth, MessageQueue_Size(up->queue));
+	}
+	return TRUE;
+}
+
+/* replace the payload of a queued message with the one of the newer message */
+static wMessageQueueCoalesce update_message_replace(wMessage* queued, const wMessage* message)
+{
+	WINPR_ASSERT(queued);
+	WINPR_ASSERT(message);
+
+	(void)update_message_free_class(queued, GetMessageClass(queued->id),
+	                                GetMessageType(queued->id));
+	queued->id = message->id;
+	queued->wParam = message->wParam;
+	queued->lParam = message->lParam;
+	return WMQ_COALESCE_MERGED;
+}
+
+static wMessageQueueCoalesce update_message_coalesce_pointer_position(
+    wMessage* queued, const wMessage* message, WINPR_ATTR_UNUSED void* arg)
+{
+	WINPR_ASSERT(queued);
+
+	if (GetMessageClass(queued->id) != PointerUpdate_Class)
+		return WMQ_COALESCE_STOP;
+
+	/* position and shape are independent, skip over shape updates */
+	if (GetMessageType(queued->id) != PointerUpdate_PointerPosition)
+		return WMQ_COALESCE_CONTINUE;
+
+	return update_message_replace(queued, message);
+}
+
+static wMessageQueueCoalesce update_message_coalesce_pointer_shape(wMessage* queued,
+                                                                   const wMessage* message,
+                                                                   WINPR_ATTR_UNUSED void* arg)
+{
+	WINPR_ASSERT(queued);
+
+	if (GetMessageClass(queued->id) != PointerUpdate_Class)
+		return WMQ_COALESCE_STOP;
+
+	switch (GetMessageType(queued->id))
+	{
+		case PointerUpdate_PointerPosition:
+			return WMQ_COALESCE_CONTINUE;
+
+		/* only replace shape selections, color, large and new pointers populate the cache */
+		case PointerUpdate_PointerSystem:
+		case PointerUpdate_PointerCached:
+			return update_message_replace(queued, message);
+
+		default:
+			return WMQ_COALESCE_STOP;
+	}
+}
+
+static wMessageQueueCoalesce update_message_coalesce_opaque_rect(wMessage* queued,
+                                                                 const wMessage* message,
+                                                                 WINPR_ATTR_UNUSED void* arg)
+{
+	WINPR_ASSERT(queued);
+	WINPR_ASSERT(message);
+
+	if (queued->id != message->id)
+		return WMQ_COALESCE_STOP;
+
+	OPAQUE_RECT_ORDER* dst = queued->wParam;
+	const OPAQUE_RECT_ORDER* src = message->wParam;
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(src);
+
+	const INT64 dl = dst->nLeftRect;
+	const INT64 dt = dst->nTopRect;
+	const INT64 dr = dl + dst->nWidth;
+	const INT64 db = dt + dst->nHeight;
+	const INT64 sl = src->nLeftRect;
+	const INT64 st = src->nTopRect;
+	const INT64 sr = sl + src->nWidth;
+	const INT64 sb = st + src->nHeight;
+
+	/* the new rectangle paints over the queued one */
+	if ((sl <= dl) && (st <= dt) && (sr >= dr) && (sb >= db))
+		return update_message_replace(queued, message);
+
+	if (dst->color != src->color)
+		return WMQ_COALESCE_STOP;
+
+	/* same color and the union is a rectangle again */
+	const BOOL vertical = (sl == dl) && (sr == dr) && (st <= db) && (sb >= dt);
+	const BOOL horizontal = (st == dt) && (sb == db) && (sl <= dr) && (sr >= dl);
+	if (!vertical && !horizontal)
+		return WMQ_COALESCE_STOP;
+
+	const INT64 l = MIN(dl, sl);
+	const INT64 t = MIN(dt, st);
+	const INT64 w = MAX(dr, sr) - l;
+	const INT64 h = MAX(db, sb) - t;
+	if ((w > INT32_MAX) || (h > INT32_MAX))
+		return WMQ_COALESCE_STOP;
+
+	dst->nLeftRect = (INT32)l;
+	dst->nTopRect = (INT32)t;
+	dst->nWidth = (INT32)w;
+	dst->nHeight = (INT32)h;
+	free(message->wParam);
+	return WMQ_COALESCE_MERGED;
+}
+
+static BOOL update_message_rect_contains(const RECTANGLE_16* outer, const RECTANGLE_16* inner)
+{
+	WINPR_ASSERT(outer);
+	WINPR_ASSERT(inner);
+
+	return (outer->left <= inner->left) && (outer->top <= inner->top) &&
+	       (outer->right >= inner->right) && (outer->bottom >= inner->bottom);
+}
+
+static BOOL update_message_rects_contain(const RECTANGLE_16* rects, size_t count,
+                                         const RECTANGLE_16* rect)
+{
+	for (size_t x = 0; x < count; x++)
+	{
+		if (update_message_rect_contains(&rects[x], rect))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static wMessageQueueCoalesce update_message_coalesce_refresh_rect(wMessage* queued,
+                                                                  const wMessage* message,
+                                                                  WINPR_ATTR_UNUSED void* arg)
+{
+	WINPR_ASSERT(queued);
+	WINPR_ASSERT(message);
+
+	if (queued->id != message->id)
+		return WMQ_COALESCE_STOP;
+
+	const size_t count = (size_t)queued->wParam;
+	const size_t newCount = (size_t)message->wParam;
+	const RECTANGLE_16* areas = message->lParam;
+
+	size_t missing = 0;
+	for (size_t x = 0; x < newCount; x++)
+	{
+		if (!update_message_rects_contain(queued->lParam, count, &areas[x]))
+			missing++;
+	}
+
+	/* the count is transmitted as a single byte */
+	if (count + missing > UINT8_MAX)
+		return WMQ_COALESCE_STOP;
+
+	if (missing > 0)
+	{
+		RECTANGLE_16* merged = realloc(queued->lParam, (count + missing) * sizeof(RECTANGLE_16));
+		if (!merged)
+			return WMQ_COALESCE_STOP;
+
+		size_t pos = count;
+		for (size_t x = 0; x < newCount; x++)
+		{
+			if (!update_message_rects_contain(merged, count, &areas[x]))
+				merged[pos++] = areas[x];
+		}
+		queued->lParam = merged;
+		queued->wParam = (void*)pos;
+	}
+
+	free(message->lParam);
+	return WMQ_COALESCE_MERGED;
+}
+
+/* damage from codecs without state between messages, safe to skip */
+static BOOL update_message_is_stateless_surface_bits(const SURFACE_BITS_COMMAND* cmd)
+{
+	WINPR_ASSERT(cmd);
+
+	switch (cmd->bmp.codecID)
+	{
+		case RDP_CODEC_ID_NONE:
+		case RDP_CODEC_ID_NSCODEC:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL update_message_is_full_surface(rdpContext* context, const wMessage* message)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(message);
+
+	const UINT32 width = freerdp_settings_get_uint32(context->settings, FreeRDP_DesktopWidth);
+	const UINT32 height = freerdp_settings_get_uint32(context->settings, FreeRDP_DesktopHeight);
+	if ((width == 0) || (height == 0) || (width > UINT16_MAX) || (height > UINT16_MAX))
+		return FALSE;
+
+	const RECTANGLE_16 desktop = { 0, 0, (UINT16)width, (UINT16)height };
+	REGION16 region = { 0 };
+	UINT64 area = 0;
+	BOOL rc = FALSE;
+
+	region16_init(&region);
+	switch (message->id)
+	{
+		case MakeMessageId(Update, BitmapUpdate):
+		{
+			const BITMAP_UPDATE* bitmap = message->wParam;
+			for (UINT32 x = 0; x < bitmap->number; x++)
+			{
+				const BITMAP_DATA* data = &bitmap->rectangles[x];
+				const RECTANGLE_16 rect = { (UINT16)MIN(data->destLeft, width),
+					                        (UINT16)MIN(data->destTop, height),
+					                        (UINT16)MIN(data->destRight + 1ull, width),
+					                        (UINT16)MIN(data->destBottom + 1ull, height) };
+				if (rectangle_is_empty(&rect))
+					continue;
+				area += 1ull * (rect.right - rect.left) * (rect.bottom - rect.top);
+				if (!region16_union_rect(&region, &region, &rect))
+					goto fail;
+			}
+		}
+		break;
+
+		case MakeMessageId(Update, SurfaceBits):
+		{
+			const SURFACE_BITS_COMMAND* cmd = message->wParam;
+			if (!update_message_is_stateless_surface_bits(cmd))
+				goto fail;
+
+			const RECTANGLE_16 rect = {
+				(UINT16)MIN(cmd->destLeft, width), (UINT16)MIN(cmd->destTop, height),
+				(UINT16)MIN(MIN(cmd->destRight, cmd->destLeft + cmd->bmp.width), width),
+				(UINT16)MIN(MIN(cmd->destBottom, cmd->destTop + cmd->bmp.height), height)
+			};
+			if (rectangle_is_empty(&rect))
+				goto fail;
+			area = 1ull * (rect.right - rect.left) * (rect.bottom - rect.top);
+			if (!region16_union_rect(&region, &region, &rect))
+				goto fail;
+		}
+		break;
+
+		default:
+			goto fail;
+	}
+
+	if (area < 1ull * width * height)
+		goto fail;
+
+	rc = (region16_n_rects(&region) == 1) && rectangles_equal(region16_extents(&region), &desktop);
+fail:
+	region16_uninit(&region);
+	return rc;
+}
+
+/* called for a full surface update, walk back and drop the damage it overwrites */
+static wMessageQueueCoalesce
+update_message_drop_stale_damage(wMessage* queued, WINPR_ATTR_UNUSED const wMessage* message,
+                                 void* arg)
+{
+	WINPR_ASSERT(queued);
+
+	rdpContext* context = arg;
+	WINPR_ASSERT(context);
+
+	switch (queued->id)
+	{
+		case MakeMessageId(Update, BitmapUpdate):
+			break;
+
+		case MakeMessageId(Update, SurfaceBits):
+			if (!queued->wParam)
+				return WMQ_COALESCE_CONTINUE;
+			if (!update_message_is_stateless_surface_bits(queued->wParam))
+				return WMQ_COALESCE_STOP;
+			break;
+
+		/* messages not touching the surface content */
+		case MakeMessageId(Update, BeginPaint):
+		case MakeMessageId(Update, EndPaint):
+		case MakeMessageId(Update, SurfaceFrameMarker):
+		case MakeMessageId(Update, SurfaceFrameAcknowledge):
+		case MakeMessageId(PointerUpdate, PointerPosition):
+		case MakeMessageId(PointerUpdate, PointerSystem):
+		case MakeMessageId(PointerUpdate, PointerCached):
+			return WMQ_COALESCE_CONTINUE;
+
+		/* anything else might read the surface or depend on it */
+		default:
+			return WMQ_COALESCE_STOP;
+	}
+
+	if (queued->wParam)
+	{
+		/* keep the message in place, processing skips an empty payload */
+		(void)update_message_free_class(queued, GetMessageClass(queued->id),
+		                                GetMessageType(queued->id));
+		queued->wParam = NULL;
+		queued->lParam = NULL;
+
+		if (context->metrics)
+			context->metrics->UpdateQueueDropped++;
+	}
+	return WMQ_COALESCE_CONTINUE;
+}
+
 /* Update */
 
 static BOOL update_message_BeginPaint(rdpContext* context)
@@ -119,7 +475,6 @@ static BOOL update_message_DesktopResize(rdpContext* context)
 static BOOL update_message_BitmapUpdate(rdpContext* context, const BITMAP_UPDATE* bitmap)
 {
 	BITMAP_UPDATE* wParam = NULL;
-	rdp_update_internal* up = NULL;
 
 	if (!context || !context->update || !bitmap)
 		return FALSE;
@@ -129,9 +484,10 @@ static BOOL update_message_BitmapUpdate(rdpContext* context, const BITMAP_UPDATE
 	if (!wParam)
 		return FALSE;
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context, MakeMessageId(Update, BitmapUpdate),
-	                         (void*)wParam, NULL);
+	const wMessage message = { .id = MakeMessageId(Update, BitmapUpdate), .wParam = wParam };
+	const BOOL full = update_message_is_full_surface(context, &message);
+	return update_message_post_coalesced(context, message.id, wParam, NULL,
+	                                     full ? update_message_drop_stale_damage : NULL);
 }
 
 static BOOL update_message_Palette(rdpContext* context, const PALETTE_UPDATE* palette)
@@ -202,7 +558,6 @@ static BOOL update_message_SetKeyboardImeStatus(rdpContext* context, UINT16 imeI
 static BOOL update_message_RefreshRect(rdpContext* context, BYTE count, const RECTANGLE_16* areas)
 {
 	RECTANGLE_16* lParam = NULL;
-	rdp_update_internal* up = NULL;
 
 	if (!context || !context->update || !areas)
 		return FALSE;
@@ -214,9 +569,9 @@ static BOOL update_message_RefreshRect(rdpContext* context, BYTE count, const RE
 
 	CopyMemory(lParam, areas, sizeof(RECTANGLE_16) * count);
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context, MakeMessageId(Update, RefreshRect),
-	                         (void*)(size_t)count, (void*)lParam);
+	return update_message_post_coalesced(context, MakeMessageId(Update, RefreshRect),
+	                                     (void*)(size_t)count, (void*)lParam,
+	                                     update_message_coalesce_refresh_rect);
 }
 
 static BOOL update_message_SuppressOutput(rdpContext* context, BYTE allow, const RECTANGLE_16* area)
@@ -267,19 +622,45 @@ static BOOL update_message_SurfaceBits(rdpContext* context,
                                        const SURFACE_BITS_COMMAND* surfaceBitsCommand)
 {
 	SURFACE_BITS_COMMAND* wParam = NULL;
-	rdp_update_internal* up = NULL;
+	wStream* lParam = NULL;
 
 	if (!context || !context->update || !surfaceBitsCommand)
 		return FALSE;
 
-	wParam = copy_surface_bits_command(context, surfaceBitsCommand);
+	/* If the payload is still in the received stream keep a reference instead of a copy */
+	if (context->rdp && context->rdp->transport)
+		lParam = transport_ref_received(context->rdp->transport,
+		                                surfaceBitsCommand->bmp.bitmapData);
+
+	if (lParam)
+	{
+		wParam = malloc(sizeof(SURFACE_BITS_COMMAND));
+		if (!wParam)
+		{
+			Stream_Release(lParam);
+			return FALSE;
+		}
+		*wParam = *surfaceBitsCommand;
+	}
+	else
+		wParam = copy_surface_bits_command(context, surfaceBitsCommand);
 
 	if (!wParam)
 		return FALSE;
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context, MakeMessageId(Update, SurfaceBits),
-	                         (void*)wParam, NULL);
+	rdpMetrics* metrics = context->metrics;
+	if (metrics)
+	{
+		if (lParam)
+			metrics->TotalUpdateBytesReferenced += wParam->bmp.bitmapDataLength;
+		else
+			metrics->TotalUpdateBytesCopied += wParam->bmp.bitmapDataLength;
+	}
+
+	const wMessage message = { .id = MakeMessageId(Update, SurfaceBits), .wParam = wParam };
+	const BOOL full = update_message_is_full_surface(context, &message);
+	return update_message_post_coalesced(context, message.id, wParam, lParam,
+	                                     full ? update_message_drop_stale_damage : NULL);
 }
 
 static BOOL update_message_SurfaceFrameMarker(rdpContext* context,
@@ -382,7 +763,6 @@ static BOOL update_message_ScrBlt(rdpContext* context, const SCRBLT_ORDER* scrBl
 static BOOL update_message_OpaqueRect(rdpContext* context, const OPAQUE_RECT_ORDER* opaqueRect)
 {
 	OPAQUE_RECT_ORDER* wParam = NULL;
-	rdp_update_internal* up = NULL;
 
 	if (!context || !context->update || !opaqueRect)
 		return FALSE;
@@ -394,9 +774,8 @@ static BOOL update_message_OpaqueRect(rdpContext* context, const OPAQUE_RECT_ORD
 
 	CopyMemory(wParam, opaqueRect, sizeof(OPAQUE_RECT_ORDER));
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context, MakeMessageId(PrimaryUpdate, OpaqueRect),
-	                         (void*)wParam, NULL);
+	return update_message_post_coalesced(context, MakeMessageId(PrimaryUpdate, OpaqueRect),
+	                                     (void*)wParam, NULL, update_message_coalesce_opaque_rect);
 }
 
 static BOOL update_message_DrawNineGrid(rdpContext* context,
@@ -1572,7 +1951,6 @@ static BOOL update_message_PointerPosition(rdpContext* context,
                                            const POINTER_POSITION_UPDATE* pointerPosition)
 {
 	POINTER_POSITION_UPDATE* wParam = NULL;
-	rdp_update_internal* up = NULL;
 
 	if (!context || !context->update || !pointerPosition)
 		return FALSE;
@@ -1582,16 +1960,15 @@ static BOOL update_message_PointerPosition(rdpContext* context,
 	if (!wParam)
 		return FALSE;
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context,
-	                         MakeMessageId(PointerUpdate, PointerPosition), (void*)wParam, NULL);
+	return update_message_post_coalesced(context, MakeMessageId(PointerUpdate, PointerPosition),
+	                                     (void*)wParam, NULL,
+	                                     update_message_coalesce_pointer_position);
 }
 
 static BOOL update_message_PointerSystem(rdpContext* context,
                                          const POINTER_SYSTEM_UPDATE* pointerSystem)
 {
 	POINTER_SYSTEM_UPDATE* wParam = NULL;
-	rdp_update_internal* up = NULL;
 
 	if (!context || !context->update || !pointerSystem)
 		return FALSE;
@@ -1601,9 +1978,8 @@ static BOOL update_message_PointerSystem(rdpContext* context,
 	if (!wParam)
 		return FALSE;
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context, MakeMessageId(PointerUpdate, PointerSystem),
-	                         (void*)wParam, NULL);
+	return update_message_post_coalesced(context, MakeMessageId(PointerUpdate, PointerSystem),
+	                                     (void*)wParam, NULL, update_message_coalesce_pointer_shape);
 }
 
 static BOOL update_message_PointerColor(rdpContext* context,
@@ -1665,7 +2041,6 @@ static BOOL update_message_PointerCached(rdpContext* context,
                                          const POINTER_CACHED_UPDATE* pointerCached)
 {
 	POINTER_CACHED_UPDATE* wParam = NULL;
-	rdp_update_internal* up = NULL;
 
 	if (!context || !context->update || !pointerCached)
 		return FALSE;
@@ -1675,9 +2050,8 @@ static BOOL update_message_PointerCached(rdpContext* context,
 	if (!wParam)
 		return FALSE;
 
-	up = update_cast(context->update);
-	return MessageQueue_Post(up->queue, (void*)context, MakeMessageId(PointerUpdate, PointerCached),
-	                         (void*)wParam, NULL);
+	return update_message_post_coalesced(context, MakeMessageId(PointerUpdate, PointerCached),
+	                                     (void*)wParam, NULL, update_message_coalesce_pointer_shape);
 }
 
 /* Message Queue */
@@ -1744,7 +2118,16 @@ static BOOL update_message_free_update_class(wMessage* msg, int type)
 		case Update_SurfaceBits:
 		{
 			SURFACE_BITS_COMMAND* wParam = (SURFACE_BITS_COMMAND*)msg->wParam;
-			free_surface_bits_command(context, wParam);
+			wStream* lParam = (wStream*)msg->lParam;
+
+			/* payload referenced in the received stream */
+			if (lParam)
+			{
+				Stream_Release(lParam);
+				free(wParam);
+			}
+			else
+				free_surface_bits_command(context, wParam);
 		}
 		break;
 
@@ -1794,7 +2177,12 @@ static BOOL update_message_process_update_class(rdpUpdateProxy* proxy, wMessage*
 			break;
 
 		case Update_BitmapUpdate:
-			rc = IFCALLRESULT(TRUE, proxy->BitmapUpdate, msg->context, (BITMAP_UPDATE*)msg->wParam);
+			/* dropped as a full surface update followed */
+			if (!msg->wParam)
+				rc = TRUE;
+			else
+				rc = IFCALLRESULT(TRUE, proxy->BitmapUpdate, msg->context,
+				                  (BITMAP_UPDATE*)msg->wParam);
 			break;
 
 		case Update_Palette:
@@ -1821,8 +2209,12 @@ static BOOL update_message_process_update_class(rdpUpdateProxy* proxy, wMessage*
 			break;
 
 		case Update_SurfaceBits:
-			rc = IFCALLRESULT(TRUE, proxy->SurfaceBits, msg->context,
-			                  (SURFACE_BITS_COMMAND*)msg->wParam);
+			/* dropped as a full surface update followed */
+			if (!msg->wParam)
+				rc = TRUE;
+			else
+				rc = IFCALLRESULT(TRUE, proxy->SurfaceBits, msg->context,
+				                  (SURFACE_BITS_COMMAND*)msg->wParam);
 			break;
 
 		case Update_SurfaceFrameMarker:
@@ -1148,6 +1148,84 @@ static inline BOOL update_read_delta_points(wStream* s, DELTA_POINT** points, UI
 	return TRUE;
 }
 
+static inline BOOL FIELD_SKIP_BUFFER16(wStream* s, UINT32 TARGET_LEN)
+{
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
+		return FALSE;
+
+	Stream_Read_UINT16(s, TARGET_LEN);
+
+	if (!Stream_SafeSeek(s, TARGET_LEN))
+	{
+		WLog_ERR(TAG, "error skipping %" PRIu32 " bytes", TARGET_LEN);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL update_read_fast_glyph_data(wStream* s, FAST_GLYPH_ORDER* fastGlyph)
+{
+	GLYPH_DATA_V2* glyph = &fastGlyph->glyphData;
+	const BYTE* src = NULL;
+	wStream subbuffer;
+	wStream* sub = NULL;
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 1))
+		return FALSE;
+
+	Stream_Read_UINT8(s, fastGlyph->cbData);
+
+	src = Stream_ConstPointer(s);
+	if (!Stream_SafeSeek(s, fastGlyph->cbData) || (fastGlyph->cbData == 0))
+		return FALSE;
+
+	CopyMemory(fastGlyph->data, src, fastGlyph->cbData);
+	sub = Stream_StaticInit(&subbuffer, fastGlyph->data, fastGlyph->cbData);
+
+	Stream_Read_UINT8(sub, glyph->cacheIndex);
+
+	if (fastGlyph->cbData > 1)
+	{
+		if (!update_read_2byte_signed(sub, &glyph->x) ||
+		    !update_read_2byte_signed(sub, &glyph->y) ||
+		    !update_read_2byte_unsigned(sub, &glyph->cx) ||
+		    !update_read_2byte_unsigned(sub, &glyph->cy))
+			return FALSE;
+
+		if ((glyph->cx == 0) || (glyph->cy == 0))
+		{
+			WLog_ERR(TAG, "GLYPH_DATA_V2::cx=%" PRIu32 ", GLYPH_DATA_V2::cy=%" PRIu32,
+			         glyph->cx, glyph->cy);
+			return FALSE;
+		}
+
+		const size_t slen = Stream_GetRemainingLength(sub);
+		if (slen > UINT32_MAX)
+			return FALSE;
+		glyph->cb = (UINT32)slen;
+		if (glyph->cb > 0)
+		{
+			BYTE* new_aj = (BYTE*)realloc(glyph->aj, glyph->cb);
+
+			if (!new_aj)
+				return FALSE;
+
+			glyph->aj = new_aj;
+			Stream_Read(sub, glyph->aj, glyph->cb);
+		}
+		else
+		{
+			free(glyph->aj);
+			glyph->aj = NULL;
+		}
+	}
+
+	return TRUE;
+}
+
+/* The field by field readers of the primary orders, only built as the reference TestPrimaryOrders
+ * checks the layout tables of update_read_primary_order against. */
+#if defined(BUILD_TESTING_INTERNAL)
 static BOOL order_field_flag_is_set(const ORDER_INFO* orderInfo, BYTE number)
 {
 	const UINT32 mask = (UINT32)(1UL << ((UINT32)number - 1UL));
@@ -1295,21 +1373,6 @@ static inline BOOL read_order_field_color(const char* orderName, const ORDER_INF
 
 	return TRUE;
 }
-static inline BOOL FIELD_SKIP_BUFFER16(wStream* s, UINT32 TARGET_LEN)
-{
-	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
-		return FALSE;
-
-	Stream_Read_UINT16(s, TARGET_LEN);
-
-	if (!Stream_SafeSeek(s, TARGET_LEN))
-	{
-		WLog_ERR(TAG, "error skipping %" PRIu32 " bytes", TARGET_LEN);
-		return FALSE;
-	}
-
-	return TRUE;
-}
 /* Primary Drawing Orders */
 static BOOL update_read_dstblt_order(const char* orderName, wStream* s, const ORDER_INFO* orderInfo,
                                      DSTBLT_ORDER* dstblt)
@@ -2125,10 +2188,10 @@ static BOOL update_read_fast_index_order(const char* orderName, wStream* s,
 
 	return TRUE;
 }
+
 static BOOL update_read_fast_glyph_order(const char* orderName, wStream* s,
                                          const ORDER_INFO* orderInfo, FAST_GLYPH_ORDER* fastGlyph)
 {
-	GLYPH_DATA_V2* glyph = &fastGlyph->glyphData;
 	if (!read_order_field_byte(orderName, orderInfo, s, 1, &fastGlyph->cacheId, TRUE))
 		return FALSE;
 	if (fastGlyph->cacheId > 9)
@@ -2150,61 +2213,7 @@ static BOOL update_read_fast_glyph_order(const char* orderName, wStream* s,
 		return FALSE;
 
 	if ((orderInfo->fieldFlags & ORDER_FIELD_15) != 0)
-	{
-		const BYTE* src = NULL;
-		wStream subbuffer;
-		wStream* sub = NULL;
-		if (!Stream_CheckAndLogRequiredLength(TAG, s, 1))
-			return FALSE;
-
-		Stream_Read_UINT8(s, fastGlyph->cbData);
-
-		src = Stream_ConstPointer(s);
-		if (!Stream_SafeSeek(s, fastGlyph->cbData) || (fastGlyph->cbData == 0))
-			return FALSE;
-
-		CopyMemory(fastGlyph->data, src, fastGlyph->cbData);
-		sub = Stream_StaticInit(&subbuffer, fastGlyph->data, fastGlyph->cbData);
-
-		Stream_Read_UINT8(sub, glyph->cacheIndex);
-
-		if (fastGlyph->cbData > 1)
-		{
-			if (!update_read_2byte_signed(sub, &glyph->x) ||
-			    !update_read_2byte_signed(sub, &glyph->y) ||
-			    !update_read_2byte_unsigned(sub, &glyph->cx) ||
-			    !update_read_2byte_unsigned(sub, &glyph->cy))
-				return FALSE;
-
-			if ((glyph->cx == 0) || (glyph->cy == 0))
-			{
-				WLog_ERR(TAG, "GLYPH_DATA_V2::cx=%" PRIu32 ", GLYPH_DATA_V2::cy=%" PRIu32,
-				         glyph->cx, glyph->cy);
-				return FALSE;
-			}
-
-			const size_t slen = Stream_GetRemainingLength(sub);
-			if (slen > UINT32_MAX)
-				return FALSE;
-			glyph->cb = (UINT32)slen;
-			if (glyph->cb > 0)
-			{
-				BYTE* new_aj = (BYTE*)realloc(glyph->aj, glyph->cb);
-
-				if (!new_aj)
-					return FALSE;
-
-				glyph->aj = new_aj;
-				Stream_Read(sub, glyph->aj, glyph->cb);
-			}
-			else
-			{
-				free(glyph->aj);
-				glyph->aj = NULL;
-			}
-		}
-	}
-
+		return update_read_fast_glyph_data(s, fastGlyph);
 	return TRUE;
 }
 
@@ -2326,9 +2335,9 @@ static BOOL update_read_ellipse_cb_order(const char* orderName, wStream* s,
 		return TRUE;
 	return FALSE;
 }
+#endif /* BUILD_TESTING_INTERNAL */
 
 /* Secondary Drawing Orders */
-WINPR_ATTR_MALLOC(free_cache_bitmap_order, 2)
 WINPR_ATTR_NODISCARD
 static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wStream* s,
                                                           BOOL compressed, UINT16 flags)
@@ -2339,10 +2348,10 @@ static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wSt
 	if (!update || !s)
 		return NULL;
 
-	cache_bitmap = calloc(1, sizeof(CACHE_BITMAP_ORDER));
+	cache_bitmap = arena_calloc(up->arena, 1, sizeof(CACHE_BITMAP_ORDER));
 
 	if (!cache_bitmap)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 9))
 		goto fail;
@@ -2382,19 +2391,11 @@ static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wSt
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, cache_bitmap->bitmapLength))
 		goto fail;
 
-	cache_bitmap->bitmapDataStream = malloc(cache_bitmap->bitmapLength);
-
-	if (!cache_bitmap->bitmapDataStream)
-		goto fail;
-
-	Stream_Read(s, cache_bitmap->bitmapDataStream, cache_bitmap->bitmapLength);
+	cache_bitmap->bitmapDataStream = Stream_Pointer(s);
+	Stream_Seek(s, cache_bitmap->bitmapLength);
 	cache_bitmap->compressed = compressed;
 	return cache_bitmap;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_bitmap_order(update->context, cache_bitmap);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2449,7 +2450,6 @@ BOOL update_write_cache_bitmap_order(wStream* s, const CACHE_BITMAP_ORDER* cache
 	return TRUE;
 }
 
-WINPR_ATTR_MALLOC(free_cache_bitmap_v2_order, 2)
 WINPR_ATTR_NODISCARD
 static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* update, wStream* s,
                                                                 BOOL compressed, UINT16 flags)
@@ -2461,10 +2461,11 @@ static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* updat
 	if (!update || !s)
 		return NULL;
 
-	cache_bitmap_v2 = calloc(1, sizeof(CACHE_BITMAP_V2_ORDER));
+	rdp_update_internal* up = update_cast(update);
+	cache_bitmap_v2 = arena_calloc(up->arena, 1, sizeof(CACHE_BITMAP_V2_ORDER));
 
 	if (!cache_bitmap_v2)
-		goto fail;
+		return NULL;
 
 	cache_bitmap_v2->cacheId = flags & 0x0003;
 	cache_bitmap_v2->flags = (flags & 0xFF80) >> 7;
@@ -2521,28 +2522,18 @@ static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* updat
 		}
 	}
 
-	if (cache_bitmap_v2->bitmapLength == 0)
-		goto fail;
-
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, cache_bitmap_v2->bitmapLength))
 		goto fail;
 
+	/* the payload references the PDU, an empty one must not reach the decoder */
 	if (cache_bitmap_v2->bitmapLength == 0)
 		goto fail;
 
-	cache_bitmap_v2->bitmapDataStream = malloc(cache_bitmap_v2->bitmapLength);
-
-	if (!cache_bitmap_v2->bitmapDataStream)
-		goto fail;
-
-	Stream_Read(s, cache_bitmap_v2->bitmapDataStream, cache_bitmap_v2->bitmapLength);
+	cache_bitmap_v2->bitmapDataStream = Stream_Pointer(s);
+	Stream_Seek(s, cache_bitmap_v2->bitmapLength);
 	cache_bitmap_v2->compressed = compressed;
 	return cache_bitmap_v2;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_bitmap_v2_order(update->context, cache_bitmap_v2);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2635,7 +2626,6 @@ BOOL update_write_cache_bitmap_v2_order(wStream* s, CACHE_BITMAP_V2_ORDER* cache
 	return TRUE;
 }
 
-WINPR_ATTR_MALLOC(free_cache_bitmap_v3_order, 2)
 WINPR_ATTR_NODISCARD
 static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* update, wStream* s,
                                                                 UINT16 flags)
@@ -2644,17 +2634,16 @@ static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* updat
 	BYTE bitsPerPixelId = 0;
 	BITMAP_DATA_EX* bitmapData = NULL;
 	UINT32 new_len = 0;
-	BYTE* new_data = NULL;
 	CACHE_BITMAP_V3_ORDER* cache_bitmap_v3 = NULL;
 	rdp_update_internal* up = update_cast(update);
 
 	if (!update || !s)
 		return NULL;
 
-	cache_bitmap_v3 = calloc(1, sizeof(CACHE_BITMAP_V3_ORDER));
+	cache_bitmap_v3 = arena_calloc(up->arena, 1, sizeof(CACHE_BITMAP_V3_ORDER));
 
 	if (!cache_bitmap_v3)
-		goto fail;
+		return NULL;
 
 	cache_bitmap_v3->cacheId = flags & 0x00000003;
 	cache_bitmap_v3->flags = (flags & 0x0000FF80) >> 7;
@@ -2688,20 +2677,11 @@ static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* updat
 	if ((new_len == 0) || (!Stream_CheckAndLogRequiredLength(TAG, s, new_len)))
 		goto fail;
 
-	new_data = (BYTE*)realloc(bitmapData->data, new_len);
-
-	if (!new_data)
-		goto fail;
-
-	bitmapData->data = new_data;
+	bitmapData->data = Stream_Pointer(s);
 	bitmapData->length = new_len;
-	Stream_Read(s, bitmapData->data, bitmapData->length);
+	Stream_Seek(s, bitmapData->length);
 	return cache_bitmap_v3;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_bitmap_v3_order(update->context, cache_bitmap_v3);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2744,16 +2724,17 @@ BOOL update_write_cache_bitmap_v3_order(wStream* s, CACHE_BITMAP_V3_ORDER* cache
 	return TRUE;
 }
 
-WINPR_ATTR_MALLOC(free_cache_color_table_order, 2)
 WINPR_ATTR_NODISCARD
 static CACHE_COLOR_TABLE_ORDER* update_read_cache_color_table_order(rdpUpdate* update, wStream* s,
                                                                     WINPR_ATTR_UNUSED UINT16 flags)
 {
 	UINT32* colorTable = NULL;
-	CACHE_COLOR_TABLE_ORDER* cache_color_table = calloc(1, sizeof(CACHE_COLOR_TABLE_ORDER));
+	rdp_update_internal* up = update_cast(update);
+	CACHE_COLOR_TABLE_ORDER* cache_color_table =
+	    arena_calloc(up->arena, 1, sizeof(CACHE_COLOR_TABLE_ORDER));
 
 	if (!cache_color_table)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 3))
 		goto fail;
@@ -2777,10 +2758,6 @@ static CACHE_COLOR_TABLE_ORDER* update_read_cache_color_table_order(rdpUpdate* u
 
 	return cache_color_table;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_color_table_order(update->context, cache_color_table);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2823,13 +2800,14 @@ BOOL update_write_cache_color_table_order(wStream* s,
 }
 static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStream* s, UINT16 flags)
 {
-	CACHE_GLYPH_ORDER* cache_glyph_order = calloc(1, sizeof(CACHE_GLYPH_ORDER));
-
 	WINPR_ASSERT(update);
 	WINPR_ASSERT(s);
 
+	rdp_update_internal* up = update_cast(update);
+	CACHE_GLYPH_ORDER* cache_glyph_order = arena_calloc(up->arena, 1, sizeof(CACHE_GLYPH_ORDER));
+
 	if (!cache_glyph_order)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
 		goto fail;
@@ -2855,17 +2833,14 @@ static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStre
 		if (!Stream_CheckAndLogRequiredLength(TAG, s, glyph->cb))
 			goto fail;
 
-		glyph->aj = (BYTE*)malloc(glyph->cb);
-
-		if (!glyph->aj)
-			goto fail;
-
-		Stream_Read(s, glyph->aj, glyph->cb);
+		glyph->aj = Stream_Pointer(s);
+		Stream_Seek(s, glyph->cb);
 	}
 
 	if ((flags & CG_GLYPH_UNICODE_PRESENT) && (cache_glyph_order->cGlyphs > 0))
 	{
-		cache_glyph_order->unicodeCharacters = calloc(cache_glyph_order->cGlyphs, sizeof(WCHAR));
+		cache_glyph_order->unicodeCharacters =
+		    arena_calloc(up->arena, cache_glyph_order->cGlyphs, sizeof(WCHAR));
 
 		if (!cache_glyph_order->unicodeCharacters)
 			goto fail;
@@ -2880,7 +2855,6 @@ static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStre
 
 	return cache_glyph_order;
 fail:
-	free_cache_glyph_order(update->context, cache_glyph_order);
 	return NULL;
 }
 
@@ -2928,10 +2902,12 @@ BOOL update_write_cache_glyph_order(wStream* s, const CACHE_GLYPH_ORDER* cache_g
 static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update, wStream* s,
                                                               UINT16 flags)
 {
-	CACHE_GLYPH_V2_ORDER* cache_glyph_v2 = calloc(1, sizeof(CACHE_GLYPH_V2_ORDER));
+	rdp_update_internal* up = update_cast(update);
+	CACHE_GLYPH_V2_ORDER* cache_glyph_v2 =
+	    arena_calloc(up->arena, 1, sizeof(CACHE_GLYPH_V2_ORDER));
 
 	if (!cache_glyph_v2)
-		goto fail;
+		return NULL;
 
 	cache_glyph_v2->cacheId = (flags & 0x000F);
 	cache_glyph_v2->flags = (flags & 0x00F0) >> 4;
@@ -2959,17 +2935,14 @@ static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update,
 		if (!Stream_CheckAndLogRequiredLength(TAG, s, glyph->cb))
 			goto fail;
 
-		glyph->aj = (BYTE*)malloc(glyph->cb);
-
-		if (!glyph->aj)
-			goto fail;
-
-		Stream_Read(s, glyph->aj, glyph->cb);
+		glyph->aj = Stream_Pointer(s);
+		Stream_Seek(s, glyph->cb);
 	}
 
 	if ((flags & CG_GLYPH_UNICODE_PRESENT) && (cache_glyph_v2->cGlyphs > 0))
 	{
-		cache_glyph_v2->unicodeCharacters = calloc(cache_glyph_v2->cGlyphs, sizeof(WCHAR));
+		cache_glyph_v2->unicodeCharacters =
+		    arena_calloc(up->arena, cache_glyph_v2->cGlyphs, sizeof(WCHAR));
 
 		if (!cache_glyph_v2->unicodeCharacters)
 			goto fail;
@@ -2982,7 +2955,6 @@ static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update,
 
 	return cache_glyph_v2;
 fail:
-	free_cache_glyph_v2_order(update->context, cache_glyph_v2);
 	return NULL;
 }
 
@@ -3076,10 +3048,10 @@ static CACHE_BRUSH_ORDER* update_read_cache_brush_order(rdpUpdate* update, wStre
 	BYTE iBitmapFormat = 0;
 	BOOL compressed = FALSE;
 	rdp_update_internal* up = update_cast(update);
-	CACHE_BRUSH_ORDER* cache_brush = calloc(1, sizeof(CACHE_BRUSH_ORDER));
+	CACHE_BRUSH_ORDER* cache_brush = arena_calloc(up->arena, 1, sizeof(CACHE_BRUSH_ORDER));
 
 	if (!cache_brush)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 6))
 		goto fail;
@@ -3152,7 +3124,6 @@ static CACHE_BRUSH_ORDER* update_read_cache_brush_order(rdpUpdate* update, wStre
 
 	return cache_brush;
 fail:
-	free_cache_brush_order(update->context, cache_brush);
 	return NULL;
 }
 
@@ -3687,8 +3658,765 @@ BOOL update_write_bounds(wStream* s, const ORDER_INFO* orderInfo)
 	return TRUE;
 }
 
-static BOOL read_primary_order(wLog* log, const char* orderName, wStream* s,
+/* Table driven primary order decoding.
+ *
+ * The fields before the variable length part of each primary order are described by their
+ * encoding and their place in the order. The encoded length of the fields present in a byte of
+ * field flags is precomputed, so an order is checked against the stream once and then decoded
+ * by walking the set flags. The variable length parts are read by a per order finish function.
+ */
+typedef enum
+{
+	PRIMARY_FIELD_NONE = 0,   /* no such field or read by the finish function */
+	PRIMARY_FIELD_COORD,      /* INT32, an INT8 delta or an INT16 */
+	PRIMARY_FIELD_BYTE,       /* UINT32 from one byte */
+	PRIMARY_FIELD_2BYTES,     /* two UINT32 from one byte each */
+	PRIMARY_FIELD_UINT16,     /* UINT32 from UINT16 */
+	PRIMARY_FIELD_INT16,      /* INT32 from INT16 */
+	PRIMARY_FIELD_UINT32,     /* UINT32 */
+	PRIMARY_FIELD_COLOR,      /* UINT32 from 3 bytes */
+	PRIMARY_FIELD_COLOR_BYTE, /* one byte of a UINT32 color */
+	PRIMARY_FIELD_BRUSH_DATA, /* rows 1 to 7 of the 8x8 pattern of a rdpBrush */
+	PRIMARY_FIELD_COUNT,      /* entry count of the variable length part */
+	PRIMARY_FIELD_SKIP16      /* 2 unused bytes */
+} PRIMARY_FIELD_KIND;
+
+typedef struct
+{
+	BYTE kind;
+	BYTE shift;     /* of the byte in the color for PRIMARY_FIELD_COLOR_BYTE */
+	UINT16 offset;  /* of the target in the order */
+	UINT16 offset2; /* of the second target of PRIMARY_FIELD_2BYTES */
+} PRIMARY_ORDER_FIELD;
+
+/* reads the variable length part, count is the entry count after the fixed fields */
+typedef BOOL (*pPrimaryOrderFinish)(const char* orderName, wStream* s, const ORDER_INFO* orderInfo,
+                                    void* order, UINT32 count);
+
+typedef struct
+{
+	size_t order; /* offset of the order in rdp_primary_update_internal, 0 if not supported */
+	size_t count; /* offset of the entry count in the order, 0 without */
+	size_t brush; /* offset of the brush in the order, 0 without */
+	pPrimaryOrderFinish finish;
+	PRIMARY_ORDER_FIELD fields[24];
+} PRIMARY_ORDER_LAYOUT;
+
+#define PRIMARY_FIELD(kind, type, member) { (kind), 0, (UINT16)offsetof(type, member), 0 }
+#define PRIMARY_COORD(type, member) PRIMARY_FIELD(PRIMARY_FIELD_COORD, type, member)
+#define PRIMARY_BYTE(type, member) PRIMARY_FIELD(PRIMARY_FIELD_BYTE, type, member)
+#define PRIMARY_UINT16(type, member) PRIMARY_FIELD(PRIMARY_FIELD_UINT16, type, member)
+#define PRIMARY_INT16(type, member) PRIMARY_FIELD(PRIMARY_FIELD_INT16, type, member)
+#define PRIMARY_UINT32(type, member) PRIMARY_FIELD(PRIMARY_FIELD_UINT32, type, member)
+#define PRIMARY_COLOR(type, member) PRIMARY_FIELD(PRIMARY_FIELD_COLOR, type, member)
+#define PRIMARY_COLOR_BYTE(type, member, shift) \
+	{ PRIMARY_FIELD_COLOR_BYTE, (shift), (UINT16)offsetof(type, member), 0 }
+#define PRIMARY_2BYTES(type, member1, member2)                 \
+	{ PRIMARY_FIELD_2BYTES, 0, (UINT16)offsetof(type, member1), \
+	  (UINT16)offsetof(type, member2) }
+#define PRIMARY_BRUSH(type, member)                                                          \
+	PRIMARY_BYTE(type, member.x), PRIMARY_BYTE(type, member.y),                              \
+	    PRIMARY_BYTE(type, member.style), PRIMARY_BYTE(type, member.hatch),                  \
+	    PRIMARY_FIELD(PRIMARY_FIELD_BRUSH_DATA, type, member)
+#define PRIMARY_COUNT { PRIMARY_FIELD_COUNT, 0, 0, 0 }
+#define PRIMARY_SKIP16 { PRIMARY_FIELD_SKIP16, 0, 0, 0 }
+
+static BOOL primary_read_delta_rects(const char* orderName, wStream* s, BOOL present, UINT32 count,
+                                     UINT32* numRectangles, UINT32* cbData, DELTA_RECT* rectangles)
+{
+	if (present)
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
+			return FALSE;
+
+		*numRectangles = count;
+		Stream_Read_UINT16(s, *cbData);
+		return update_read_delta_rects(s, rectangles, numRectangles);
+	}
+
+	if (count > *numRectangles)
+	{
+		WLog_ERR(TAG, "%s numRectangles %" PRIu32 " > %" PRIu32, orderName, count,
+		         *numRectangles);
+		return FALSE;
+	}
+	*numRectangles = count;
+	return TRUE;
+}
+
+static BOOL primary_read_delta_points(const char* orderName, wStream* s, BOOL present,
+                                      UINT32 count, INT32 xStart, INT32 yStart, UINT32* numPoints,
+                                      UINT32* cbData, DELTA_POINT** points)
+{
+	if (present)
+	{
+		if (count == 0)
+			return FALSE;
+
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 1))
+			return FALSE;
+
+		Stream_Read_UINT8(s, *cbData);
+
+		if (!check_val_fits_int16(xStart) || !check_val_fits_int16(yStart))
+			return FALSE;
+
+		*numPoints = count;
+		return update_read_delta_points(s, points, count, get_checked_int16(xStart),
+		                                get_checked_int16(yStart));
+	}
+
+	if (count > *numPoints)
+	{
+		WLog_ERR(TAG, "%s numPoints %" PRIu32 " > %" PRIu32, orderName, count, *numPoints);
+		return FALSE;
+	}
+	*numPoints = count;
+	return TRUE;
+}
+
+static BOOL primary_read_glyph_data(wStream* s, BOOL present, UINT32* cbData, BYTE* data)
+{
+	if (!present)
+		return TRUE;
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 1))
+		return FALSE;
+
+	Stream_Read_UINT8(s, *cbData);
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, *cbData))
+		return FALSE;
+
+	Stream_Read(s, data, *cbData);
+	return TRUE;
+}
+
+static BOOL primary_finish_multi_dstblt(const char* orderName, wStream* s,
+                                        const ORDER_INFO* orderInfo, void* order, UINT32 count)
+{
+	MULTI_DSTBLT_ORDER* multi_dstblt = order;
+	return primary_read_delta_rects(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_07) != 0,
+	                                count, &multi_dstblt->numRectangles, &multi_dstblt->cbData,
+	                                multi_dstblt->rectangles);
+}
+
+static BOOL primary_finish_multi_patblt(const char* orderName, wStream* s,
+                                        const ORDER_INFO* orderInfo, void* order, UINT32 count)
+{
+	MULTI_PATBLT_ORDER* multi_patblt = order;
+	return primary_read_delta_rects(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_14) != 0,
+	                                count, &multi_patblt->numRectangles, &multi_patblt->cbData,
+	                                multi_patblt->rectangles);
+}
+
+static BOOL primary_finish_multi_scrblt(const char* orderName, wStream* s,
+                                        const ORDER_INFO* orderInfo, void* order, UINT32 count)
+{
+	MULTI_SCRBLT_ORDER* multi_scrblt = order;
+	return primary_read_delta_rects(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_09) != 0,
+	                                count, &multi_scrblt->numRectangles, &multi_scrblt->cbData,
+	                                multi_scrblt->rectangles);
+}
+
+static BOOL primary_finish_multi_opaque_rect(const char* orderName, wStream* s,
+                                             const ORDER_INFO* orderInfo, void* order,
+                                             UINT32 count)
+{
+	MULTI_OPAQUE_RECT_ORDER* multi_opaque_rect = order;
+	return primary_read_delta_rects(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_09) != 0,
+	                                count, &multi_opaque_rect->numRectangles,
+	                                &multi_opaque_rect->cbData, multi_opaque_rect->rectangles);
+}
+
+static BOOL primary_finish_multi_draw_nine_grid(const char* orderName, wStream* s,
+                                                const ORDER_INFO* orderInfo, void* order,
+                                                UINT32 count)
+{
+	MULTI_DRAW_NINE_GRID_ORDER* multi_draw_nine_grid = order;
+	return primary_read_delta_rects(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_07) != 0,
+	                                count, &multi_draw_nine_grid->nDeltaEntries,
+	                                &multi_draw_nine_grid->cbData,
+	                                multi_draw_nine_grid->rectangles);
+}
+
+static BOOL primary_finish_polyline(const char* orderName, wStream* s, const ORDER_INFO* orderInfo,
+                                    void* order, UINT32 count)
+{
+	POLYLINE_ORDER* polyline = order;
+	return primary_read_delta_points(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_07) != 0,
+	                                 count, polyline->xStart, polyline->yStart,
+	                                 &polyline->numDeltaEntries, &polyline->cbData,
+	                                 &polyline->points);
+}
+
+static BOOL primary_finish_memblt(WINPR_ATTR_UNUSED const char* orderName,
+                                  WINPR_ATTR_UNUSED wStream* s,
+                                  WINPR_ATTR_UNUSED const ORDER_INFO* orderInfo, void* order,
+                                  WINPR_ATTR_UNUSED UINT32 count)
+{
+	MEMBLT_ORDER* memblt = order;
+	memblt->colorIndex = (memblt->cacheId >> 8);
+	memblt->cacheId = (memblt->cacheId & 0xFF);
+	memblt->bitmap = NULL;
+	return TRUE;
+}
+
+static BOOL primary_finish_mem3blt(WINPR_ATTR_UNUSED const char* orderName,
+                                   WINPR_ATTR_UNUSED wStream* s,
+                                   WINPR_ATTR_UNUSED const ORDER_INFO* orderInfo, void* order,
+                                   WINPR_ATTR_UNUSED UINT32 count)
+{
+	MEM3BLT_ORDER* mem3blt = order;
+	mem3blt->colorIndex = (mem3blt->cacheId >> 8);
+	mem3blt->cacheId = (mem3blt->cacheId & 0xFF);
+	mem3blt->bitmap = NULL;
+	return TRUE;
+}
+
+static BOOL primary_finish_glyph_index(WINPR_ATTR_UNUSED const char* orderName, wStream* s,
+                                       const ORDER_INFO* orderInfo, void* order,
+                                       WINPR_ATTR_UNUSED UINT32 count)
+{
+	GLYPH_INDEX_ORDER* glyph_index = order;
+	return primary_read_glyph_data(s, (orderInfo->fieldFlags & ORDER_FIELD_22) != 0,
+	                               &glyph_index->cbData, glyph_index->data);
+}
+
+static BOOL primary_finish_fast_index(WINPR_ATTR_UNUSED const char* orderName, wStream* s,
+                                      const ORDER_INFO* orderInfo, void* order,
+                                      WINPR_ATTR_UNUSED UINT32 count)
+{
+	FAST_INDEX_ORDER* fast_index = order;
+	return primary_read_glyph_data(s, (orderInfo->fieldFlags & ORDER_FIELD_15) != 0,
+	                               &fast_index->cbData, fast_index->data);
+}
+
+static BOOL primary_finish_fast_glyph(WINPR_ATTR_UNUSED const char* orderName, wStream* s,
+                                      const ORDER_INFO* orderInfo, void* order,
+                                      WINPR_ATTR_UNUSED UINT32 count)
+{
+	FAST_GLYPH_ORDER* fastGlyph = order;
+	if (fastGlyph->cacheId > 9)
+		return FALSE;
+	if ((orderInfo->fieldFlags & ORDER_FIELD_15) != 0)
+		return update_read_fast_glyph_data(s, fastGlyph);
+	return TRUE;
+}
+
+static BOOL primary_finish_polygon_sc(const char* orderName, wStream* s,
+                                      const ORDER_INFO* orderInfo, void* order, UINT32 count)
+{
+	POLYGON_SC_ORDER* polygon_sc = order;
+	return primary_read_delta_points(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_07) != 0,
+	                                 count, polygon_sc->xStart, polygon_sc->yStart,
+	                                 &polygon_sc->numPoints, &polygon_sc->cbData,
+	                                 &polygon_sc->points);
+}
+
+static BOOL primary_finish_polygon_cb(const char* orderName, wStream* s,
+                                      const ORDER_INFO* orderInfo, void* order, UINT32 count)
+{
+	POLYGON_CB_ORDER* polygon_cb = order;
+	if (!primary_read_delta_points(orderName, s, (orderInfo->fieldFlags & ORDER_FIELD_13) != 0,
+	                               count, polygon_cb->xStart, polygon_cb->yStart,
+	                               &polygon_cb->numPoints, &polygon_cb->cbData,
+	                               &polygon_cb->points))
+		return FALSE;
+
+	polygon_cb->backMode = (polygon_cb->bRop2 & 0x80) ? BACKMODE_TRANSPARENT : BACKMODE_OPAQUE;
+	polygon_cb->bRop2 = (polygon_cb->bRop2 & 0x1F);
+	return TRUE;
+}
+
+/* indexed by orderType, fields[n] is field n + 1 */
+static const PRIMARY_ORDER_LAYOUT primary_order_layouts[ORDER_TYPE_GLYPH_INDEX + 1] = {
+	[ORDER_TYPE_DSTBLT] = { offsetof(rdp_primary_update_internal, dstblt),
+	                        0,
+	                        0,
+	                        NULL,
+	                        { PRIMARY_COORD(DSTBLT_ORDER, nLeftRect),
+	                          PRIMARY_COORD(DSTBLT_ORDER, nTopRect),
+	                          PRIMARY_COORD(DSTBLT_ORDER, nWidth),
+	                          PRIMARY_COORD(DSTBLT_ORDER, nHeight),
+	                          PRIMARY_BYTE(DSTBLT_ORDER, bRop) } },
+	[ORDER_TYPE_PATBLT] = { offsetof(rdp_primary_update_internal, patblt),
+	                        0,
+	                        offsetof(PATBLT_ORDER, brush),
+	                        NULL,
+	                        { PRIMARY_COORD(PATBLT_ORDER, nLeftRect),
+	                          PRIMARY_COORD(PATBLT_ORDER, nTopRect),
+	                          PRIMARY_COORD(PATBLT_ORDER, nWidth),
+	                          PRIMARY_COORD(PATBLT_ORDER, nHeight),
+	                          PRIMARY_BYTE(PATBLT_ORDER, bRop),
+	                          PRIMARY_COLOR(PATBLT_ORDER, backColor),
+	                          PRIMARY_COLOR(PATBLT_ORDER, foreColor),
+	                          PRIMARY_BRUSH(PATBLT_ORDER, brush) } },
+	[ORDER_TYPE_SCRBLT] = { offsetof(rdp_primary_update_internal, scrblt),
+	                        0,
+	                        0,
+	                        NULL,
+	                        { PRIMARY_COORD(SCRBLT_ORDER, nLeftRect),
+	                          PRIMARY_COORD(SCRBLT_ORDER, nTopRect),
+	                          PRIMARY_COORD(SCRBLT_ORDER, nWidth),
+	                          PRIMARY_COORD(SCRBLT_ORDER, nHeight),
+	                          PRIMARY_BYTE(SCRBLT_ORDER, bRop),
+	                          PRIMARY_COORD(SCRBLT_ORDER, nXSrc),
+	                          PRIMARY_COORD(SCRBLT_ORDER, nYSrc) } },
+	[ORDER_TYPE_DRAW_NINE_GRID] = { offsetof(rdp_primary_update_internal, draw_nine_grid),
+	                                0,
+	                                0,
+	                                NULL,
+	                                { PRIMARY_COORD(DRAW_NINE_GRID_ORDER, srcLeft),
+	                                  PRIMARY_COORD(DRAW_NINE_GRID_ORDER, srcTop),
+	                                  PRIMARY_COORD(DRAW_NINE_GRID_ORDER, srcRight),
+	                                  PRIMARY_COORD(DRAW_NINE_GRID_ORDER, srcBottom),
+	                                  PRIMARY_UINT16(DRAW_NINE_GRID_ORDER, bitmapId) } },
+	[ORDER_TYPE_MULTI_DRAW_NINE_GRID] = {
+	    offsetof(rdp_primary_update_internal, multi_draw_nine_grid),
+	    offsetof(MULTI_DRAW_NINE_GRID_ORDER, nDeltaEntries),
+	    0,
+	    primary_finish_multi_draw_nine_grid,
+	    { PRIMARY_COORD(MULTI_DRAW_NINE_GRID_ORDER, srcLeft),
+	      PRIMARY_COORD(MULTI_DRAW_NINE_GRID_ORDER, srcTop),
+	      PRIMARY_COORD(MULTI_DRAW_NINE_GRID_ORDER, srcRight),
+	      PRIMARY_COORD(MULTI_DRAW_NINE_GRID_ORDER, srcBottom),
+	      PRIMARY_UINT16(MULTI_DRAW_NINE_GRID_ORDER, bitmapId), PRIMARY_COUNT } },
+	[ORDER_TYPE_LINE_TO] = { offsetof(rdp_primary_update_internal, line_to),
+	                         0,
+	                         0,
+	                         NULL,
+	                         { PRIMARY_UINT16(LINE_TO_ORDER, backMode),
+	                           PRIMARY_COORD(LINE_TO_ORDER, nXStart),
+	                           PRIMARY_COORD(LINE_TO_ORDER, nYStart),
+	                           PRIMARY_COORD(LINE_TO_ORDER, nXEnd),
+	                           PRIMARY_COORD(LINE_TO_ORDER, nYEnd),
+	                           PRIMARY_COLOR(LINE_TO_ORDER, backColor),
+	                           PRIMARY_BYTE(LINE_TO_ORDER, bRop2),
+	                           PRIMARY_BYTE(LINE_TO_ORDER, penStyle),
+	                           PRIMARY_BYTE(LINE_TO_ORDER, penWidth),
+	                           PRIMARY_COLOR(LINE_TO_ORDER, penColor) } },
+	[ORDER_TYPE_OPAQUE_RECT] = { offsetof(rdp_primary_update_internal, opaque_rect),
+	                             0,
+	                             0,
+	                             NULL,
+	                             { PRIMARY_COORD(OPAQUE_RECT_ORDER, nLeftRect),
+	                               PRIMARY_COORD(OPAQUE_RECT_ORDER, nTopRect),
+	                               PRIMARY_COORD(OPAQUE_RECT_ORDER, nWidth),
+	                               PRIMARY_COORD(OPAQUE_RECT_ORDER, nHeight),
+	                               PRIMARY_COLOR_BYTE(OPAQUE_RECT_ORDER, color, 0),
+	                               PRIMARY_COLOR_BYTE(OPAQUE_RECT_ORDER, color, 8),
+	                               PRIMARY_COLOR_BYTE(OPAQUE_RECT_ORDER, color, 16) } },
+	[ORDER_TYPE_SAVE_BITMAP] = { offsetof(rdp_primary_update_internal, save_bitmap),
+	                             0,
+	                             0,
+	                             NULL,
+	                             { PRIMARY_UINT32(SAVE_BITMAP_ORDER, savedBitmapPosition),
+	                               PRIMARY_COORD(SAVE_BITMAP_ORDER, nLeftRect),
+	                               PRIMARY_COORD(SAVE_BITMAP_ORDER, nTopRect),
+	                               PRIMARY_COORD(SAVE_BITMAP_ORDER, nRightRect),
+	                               PRIMARY_COORD(SAVE_BITMAP_ORDER, nBottomRect),
+	                               PRIMARY_BYTE(SAVE_BITMAP_ORDER, operation) } },
+	[ORDER_TYPE_MEMBLT] = { offsetof(rdp_primary_update_internal, memblt),
+	                        0,
+	                        0,
+	                        primary_finish_memblt,
+	                        { PRIMARY_UINT16(MEMBLT_ORDER, cacheId),
+	                          PRIMARY_COORD(MEMBLT_ORDER, nLeftRect),
+	                          PRIMARY_COORD(MEMBLT_ORDER, nTopRect),
+	                          PRIMARY_COORD(MEMBLT_ORDER, nWidth),
+	                          PRIMARY_COORD(MEMBLT_ORDER, nHeight),
+	                          PRIMARY_BYTE(MEMBLT_ORDER, bRop),
+	                          PRIMARY_COORD(MEMBLT_ORDER, nXSrc),
+	                          PRIMARY_COORD(MEMBLT_ORDER, nYSrc),
+	                          PRIMARY_UINT16(MEMBLT_ORDER, cacheIndex) } },
+	[ORDER_TYPE_MEM3BLT] = { offsetof(rdp_primary_update_internal, mem3blt),
+	                         0,
+	                         offsetof(MEM3BLT_ORDER, brush),
+	                         primary_finish_mem3blt,
+	                         { PRIMARY_UINT16(MEM3BLT_ORDER, cacheId),
+	                           PRIMARY_COORD(MEM3BLT_ORDER, nLeftRect),
+	                           PRIMARY_COORD(MEM3BLT_ORDER, nTopRect),
+	                           PRIMARY_COORD(MEM3BLT_ORDER, nWidth),
+	                           PRIMARY_COORD(MEM3BLT_ORDER, nHeight),
+	                           PRIMARY_BYTE(MEM3BLT_ORDER, bRop),
+	                           PRIMARY_COORD(MEM3BLT_ORDER, nXSrc),
+	                           PRIMARY_COORD(MEM3BLT_ORDER, nYSrc),
+	                           PRIMARY_COLOR(MEM3BLT_ORDER, backColor),
+	                           PRIMARY_COLOR(MEM3BLT_ORDER, foreColor),
+	                           PRIMARY_BRUSH(MEM3BLT_ORDER, brush),
+	                           PRIMARY_UINT16(MEM3BLT_ORDER, cacheIndex) } },
+	[ORDER_TYPE_MULTI_DSTBLT] = { offsetof(rdp_primary_update_internal, multi_dstblt),
+	                              offsetof(MULTI_DSTBLT_ORDER, numRectangles),
+	                              0,
+	                              primary_finish_multi_dstblt,
+	                              { PRIMARY_COORD(MULTI_DSTBLT_ORDER, nLeftRect),
+	                                PRIMARY_COORD(MULTI_DSTBLT_ORDER, nTopRect),
+	                                PRIMARY_COORD(MULTI_DSTBLT_ORDER, nWidth),
+	                                PRIMARY_COORD(MULTI_DSTBLT_ORDER, nHeight),
+	                                PRIMARY_BYTE(MULTI_DSTBLT_ORDER, bRop), PRIMARY_COUNT } },
+	[ORDER_TYPE_MULTI_PATBLT] = { offsetof(rdp_primary_update_internal, multi_patblt),
+	                              offsetof(MULTI_PATBLT_ORDER, numRectangles),
+	                              offsetof(MULTI_PATBLT_ORDER, brush),
+	                              primary_finish_multi_patblt,
+	                              { PRIMARY_COORD(MULTI_PATBLT_ORDER, nLeftRect),
+	                                PRIMARY_COORD(MULTI_PATBLT_ORDER, nTopRect),
+	                                PRIMARY_COORD(MULTI_PATBLT_ORDER, nWidth),
+	                                PRIMARY_COORD(MULTI_PATBLT_ORDER, nHeight),
+	                                PRIMARY_BYTE(MULTI_PATBLT_ORDER, bRop),
+	                                PRIMARY_COLOR(MULTI_PATBLT_ORDER, backColor),
+	                                PRIMARY_COLOR(MULTI_PATBLT_ORDER, foreColor),
+	                                PRIMARY_BRUSH(MULTI_PATBLT_ORDER, brush), PRIMARY_COUNT } },
+	[ORDER_TYPE_MULTI_SCRBLT] = { offsetof(rdp_primary_update_internal, multi_scrblt),
+	                              offsetof(MULTI_SCRBLT_ORDER, numRectangles),
+	                              0,
+	                              primary_finish_multi_scrblt,
+	                              { PRIMARY_COORD(MULTI_SCRBLT_ORDER, nLeftRect),
+	                                PRIMARY_COORD(MULTI_SCRBLT_ORDER, nTopRect),
+	                                PRIMARY_COORD(MULTI_SCRBLT_ORDER, nWidth),
+	                                PRIMARY_COORD(MULTI_SCRBLT_ORDER, nHeight),
+	                                PRIMARY_BYTE(MULTI_SCRBLT_ORDER, bRop),
+	                                PRIMARY_COORD(MULTI_SCRBLT_ORDER, nXSrc),
+	                                PRIMARY_COORD(MULTI_SCRBLT_ORDER, nYSrc), PRIMARY_COUNT } },
+	[ORDER_TYPE_MULTI_OPAQUE_RECT] = {
+	    offsetof(rdp_primary_update_internal, multi_opaque_rect),
+	    offsetof(MULTI_OPAQUE_RECT_ORDER, numRectangles),
+	    0,
+	    primary_finish_multi_opaque_rect,
+	    { PRIMARY_COORD(MULTI_OPAQUE_RECT_ORDER, nLeftRect),
+	      PRIMARY_COORD(MULTI_OPAQUE_RECT_ORDER, nTopRect),
+	      PRIMARY_COORD(MULTI_OPAQUE_RECT_ORDER, nWidth),
+	      PRIMARY_COORD(MULTI_OPAQUE_RECT_ORDER, nHeight),
+	      PRIMARY_COLOR_BYTE(MULTI_OPAQUE_RECT_ORDER, color, 0),
+	      PRIMARY_COLOR_BYTE(MULTI_OPAQUE_RECT_ORDER, color, 8),
+	      PRIMARY_COLOR_BYTE(MULTI_OPAQUE_RECT_ORDER, color, 16), PRIMARY_COUNT } },
+	[ORDER_TYPE_FAST_INDEX] = { offsetof(rdp_primary_update_internal, fast_index),
+	                            0,
+	                            0,
+	                            primary_finish_fast_index,
+	                            { PRIMARY_BYTE(FAST_INDEX_ORDER, cacheId),
+	                              PRIMARY_2BYTES(FAST_INDEX_ORDER, ulCharInc, flAccel),
+	                              PRIMARY_COLOR(FAST_INDEX_ORDER, backColor),
+	                              PRIMARY_COLOR(FAST_INDEX_ORDER, foreColor),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, bkLeft),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, bkTop),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, bkRight),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, bkBottom),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, opLeft),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, opTop),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, opRight),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, opBottom),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, x),
+	                              PRIMARY_COORD(FAST_INDEX_ORDER, y) } },
+	[ORDER_TYPE_POLYGON_SC] = { offsetof(rdp_primary_update_internal, polygon_sc),
+	                            offsetof(POLYGON_SC_ORDER, numPoints),
+	                            0,
+	                            primary_finish_polygon_sc,
+	                            { PRIMARY_COORD(POLYGON_SC_ORDER, xStart),
+	                              PRIMARY_COORD(POLYGON_SC_ORDER, yStart),
+	                              PRIMARY_BYTE(POLYGON_SC_ORDER, bRop2),
+	                              PRIMARY_BYTE(POLYGON_SC_ORDER, fillMode),
+	                              PRIMARY_COLOR(POLYGON_SC_ORDER, brushColor), PRIMARY_COUNT } },
+	[ORDER_TYPE_POLYGON_CB] = { offsetof(rdp_primary_update_internal, polygon_cb),
+	                            offsetof(POLYGON_CB_ORDER, numPoints),
+	                            offsetof(POLYGON_CB_ORDER, brush),
+	                            primary_finish_polygon_cb,
+	                            { PRIMARY_COORD(POLYGON_CB_ORDER, xStart),
+	                              PRIMARY_COORD(POLYGON_CB_ORDER, yStart),
+	                              PRIMARY_BYTE(POLYGON_CB_ORDER, bRop2),
+	                              PRIMARY_BYTE(POLYGON_CB_ORDER, fillMode),
+	                              PRIMARY_COLOR(POLYGON_CB_ORDER, backColor),
+	                              PRIMARY_COLOR(POLYGON_CB_ORDER, foreColor),
+	                              PRIMARY_BRUSH(POLYGON_CB_ORDER, brush), PRIMARY_COUNT } },
+	[ORDER_TYPE_POLYLINE] = { offsetof(rdp_primary_update_internal, polyline),
+	                          offsetof(POLYLINE_ORDER, numDeltaEntries),
+	                          0,
+	                          primary_finish_polyline,
+	                          { PRIMARY_COORD(POLYLINE_ORDER, xStart),
+	                            PRIMARY_COORD(POLYLINE_ORDER, yStart),
+	                            PRIMARY_BYTE(POLYLINE_ORDER, bRop2), PRIMARY_SKIP16,
+	                            PRIMARY_COLOR(POLYLINE_ORDER, penColor), PRIMARY_COUNT } },
+	[ORDER_TYPE_FAST_GLYPH] = { offsetof(rdp_primary_update_internal, fast_glyph),
+	                            0,
+	                            0,
+	                            primary_finish_fast_glyph,
+	                            { PRIMARY_BYTE(FAST_GLYPH_ORDER, cacheId),
+	                              PRIMARY_2BYTES(FAST_GLYPH_ORDER, ulCharInc, flAccel),
+	                              PRIMARY_COLOR(FAST_GLYPH_ORDER, backColor),
+	                              PRIMARY_COLOR(FAST_GLYPH_ORDER, foreColor),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, bkLeft),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, bkTop),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, bkRight),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, bkBottom),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, opLeft),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, opTop),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, opRight),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, opBottom),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, x),
+	                              PRIMARY_COORD(FAST_GLYPH_ORDER, y) } },
+	[ORDER_TYPE_ELLIPSE_SC] = { offsetof(rdp_primary_update_internal, ellipse_sc),
+	                            0,
+	                            0,
+	                            NULL,
+	                            { PRIMARY_COORD(ELLIPSE_SC_ORDER, leftRect),
+	                              PRIMARY_COORD(ELLIPSE_SC_ORDER, topRect),
+	                              PRIMARY_COORD(ELLIPSE_SC_ORDER, rightRect),
+	                              PRIMARY_COORD(ELLIPSE_SC_ORDER, bottomRect),
+	                              PRIMARY_BYTE(ELLIPSE_SC_ORDER, bRop2),
+	                              PRIMARY_BYTE(ELLIPSE_SC_ORDER, fillMode),
+	                              PRIMARY_COLOR(ELLIPSE_SC_ORDER, color) } },
+	[ORDER_TYPE_ELLIPSE_CB] = { offsetof(rdp_primary_update_internal, ellipse_cb),
+	                            0,
+	                            offsetof(ELLIPSE_CB_ORDER, brush),
+	                            NULL,
+	                            { PRIMARY_COORD(ELLIPSE_CB_ORDER, leftRect),
+	                              PRIMARY_COORD(ELLIPSE_CB_ORDER, topRect),
+	                              PRIMARY_COORD(ELLIPSE_CB_ORDER, rightRect),
+	                              PRIMARY_COORD(ELLIPSE_CB_ORDER, bottomRect),
+	                              PRIMARY_BYTE(ELLIPSE_CB_ORDER, bRop2),
+	                              PRIMARY_BYTE(ELLIPSE_CB_ORDER, fillMode),
+	                              PRIMARY_COLOR(ELLIPSE_CB_ORDER, backColor),
+	                              PRIMARY_COLOR(ELLIPSE_CB_ORDER, foreColor),
+	                              PRIMARY_BRUSH(ELLIPSE_CB_ORDER, brush) } },
+	[ORDER_TYPE_GLYPH_INDEX] = { offsetof(rdp_primary_update_internal, glyph_index),
+	                             0,
+	                             offsetof(GLYPH_INDEX_ORDER, brush),
+	                             primary_finish_glyph_index,
+	                             { PRIMARY_BYTE(GLYPH_INDEX_ORDER, cacheId),
+	                               PRIMARY_BYTE(GLYPH_INDEX_ORDER, flAccel),
+	                               PRIMARY_BYTE(GLYPH_INDEX_ORDER, ulCharInc),
+	                               PRIMARY_BYTE(GLYPH_INDEX_ORDER, fOpRedundant),
+	                               PRIMARY_COLOR(GLYPH_INDEX_ORDER, backColor),
+	                               PRIMARY_COLOR(GLYPH_INDEX_ORDER, foreColor),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, bkLeft),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, bkTop),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, bkRight),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, bkBottom),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, opLeft),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, opTop),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, opRight),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, opBottom),
+	                               PRIMARY_BRUSH(GLYPH_INDEX_ORDER, brush),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, x),
+	                               PRIMARY_INT16(GLYPH_INDEX_ORDER, y) } },
+};
+
+/* encoded length of the fields present in a field flags byte, [orderType][delta][byte][flags] */
+static BYTE primary_order_field_lengths[ARRAYSIZE(primary_order_layouts)][2][3][256] = { 0 };
+static INIT_ONCE primary_order_layouts_once = INIT_ONCE_STATIC_INIT;
+
+static BYTE primary_order_field_length(BYTE kind, BOOL delta)
+{
+	switch (kind)
+	{
+		case PRIMARY_FIELD_COORD:
+			return delta ? 1 : 2;
+		case PRIMARY_FIELD_BYTE:
+		case PRIMARY_FIELD_COLOR_BYTE:
+		case PRIMARY_FIELD_COUNT:
+			return 1;
+		case PRIMARY_FIELD_2BYTES:
+		case PRIMARY_FIELD_UINT16:
+		case PRIMARY_FIELD_INT16:
+		case PRIMARY_FIELD_SKIP16:
+			return 2;
+		case PRIMARY_FIELD_COLOR:
+			return 3;
+		case PRIMARY_FIELD_UINT32:
+			return 4;
+		case PRIMARY_FIELD_BRUSH_DATA:
+			return 7;
+		default:
+			return 0;
+	}
+}
+
+static BOOL CALLBACK primary_order_layouts_init(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	for (size_t type = 0; type < ARRAYSIZE(primary_order_layouts); type++)
+	{
+		const PRIMARY_ORDER_FIELD* fields = primary_order_layouts[type].fields;
+
+		for (size_t delta = 0; delta < 2; delta++)
+		{
+			for (size_t byte = 0; byte < 3; byte++)
+			{
+				for (size_t flags = 0; flags < 256; flags++)
+				{
+					size_t length = 0;
+					for (size_t bit = 0; bit < 8; bit++)
+					{
+						if (flags & (1u << bit))
+							length += primary_order_field_length(fields[byte * 8 + bit].kind,
+							                                     delta != 0);
+					}
+					primary_order_field_lengths[type][delta][byte][flags] = (BYTE)length;
+				}
+			}
+		}
+	}
+	return TRUE;
+}
+
+static inline UINT32* primary_order_uint32(BYTE* order, size_t offset)
+{
+	void* target = &order[offset];
+	return target;
+}
+
+static BOOL primary_order_read_fields(const char* orderName, wStream* s,
+                                      const ORDER_INFO* orderInfo,
+                                      const PRIMARY_ORDER_LAYOUT* layout,
+                                      const BYTE (*lengths)[256], BYTE* order)
+{
+	const UINT32 flags = orderInfo->fieldFlags;
+	const size_t length = 1ull * lengths[0][flags & 0xFF] + lengths[1][(flags >> 8) & 0xFF] +
+	                      lengths[2][(flags >> 16) & 0xFF];
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, length))
+		return FALSE;
+
+	const BYTE* src = Stream_ConstPointer(s);
+	UINT32 count = 0;
+	if (layout->count != 0)
+		count = *primary_order_uint32(order, layout->count);
+
+	UINT32 present = flags & 0xFFFFFF;
+	for (size_t x = 0; present != 0; x++, present >>= 1)
+	{
+		if ((present & 1) == 0)
+			continue;
+
+		const PRIMARY_ORDER_FIELD* field = &layout->fields[x];
+		UINT32* target = primary_order_uint32(order, field->offset);
+		switch (field->kind)
+		{
+			case PRIMARY_FIELD_COORD:
+			{
+				INT32* coord = (INT32*)target;
+				if (orderInfo->deltaCoordinates)
+				{
+					*coord += winpr_Data_Get_INT8(src);
+					src += 1;
+				}
+				else
+				{
+					*coord = winpr_Data_Get_INT16(src);
+					src += 2;
+				}
+			}
+			break;
+			case PRIMARY_FIELD_BYTE:
+				*target = *src++;
+				break;
+			case PRIMARY_FIELD_COUNT:
+				count = *src++;
+				break;
+			case PRIMARY_FIELD_2BYTES:
+				*target = *src++;
+				*primary_order_uint32(order, field->offset2) = *src++;
+				break;
+			case PRIMARY_FIELD_UINT16:
+				*target = winpr_Data_Get_UINT16(src);
+				src += 2;
+				break;
+			case PRIMARY_FIELD_INT16:
+				*(INT32*)target = winpr_Data_Get_INT16(src);
+				src += 2;
+				break;
+			case PRIMARY_FIELD_SKIP16:
+				src += 2;
+				break;
+			case PRIMARY_FIELD_UINT32:
+				*target = winpr_Data_Get_UINT32(src);
+				src += 4;
+				break;
+			case PRIMARY_FIELD_COLOR:
+				*target = (UINT32)src[0] | ((UINT32)src[1] << 8) | ((UINT32)src[2] << 16);
+				src += 3;
+				break;
+			case PRIMARY_FIELD_COLOR_BYTE:
+				*target = (*target & (0x00FFFFFF & ~(0xFFu << field->shift))) |
+				          ((UINT32)*src++ << field->shift);
+				break;
+			case PRIMARY_FIELD_BRUSH_DATA:
+			{
+				rdpBrush* brush = (rdpBrush*)target;
+				brush->data = brush->p8x8;
+				for (size_t y = 7; y > 0; y--)
+					brush->data[y] = *src++;
+				brush->data[0] = get_checked_uint8(brush->hatch);
+			}
+			break;
+			default:
+				break;
+		}
+	}
+
+	Stream_Seek(s, length);
+
+	if (layout->brush != 0)
+	{
+		void* target = &order[layout->brush];
+		rdpBrush* brush = target;
+
+		if (brush->style & CACHED_BRUSH)
+		{
+			BOOL rc = FALSE;
+			brush->index = brush->hatch;
+			brush->bpp = get_bmf_bpp(brush->style, &rc);
+			if (!rc)
+				return FALSE;
+			if (brush->bpp == 0)
+				brush->bpp = 1;
+		}
+	}
+
+	if (!layout->finish)
+		return TRUE;
+	return layout->finish(orderName, s, orderInfo, order, count);
+}
+
+BOOL update_read_primary_order(wLog* log, const char* orderName, wStream* s,
                                const ORDER_INFO* orderInfo, rdpPrimaryUpdate* primary_pub)
+{
+	rdp_primary_update_internal* primary = primary_update_cast(primary_pub);
+
+	if (!s || !orderInfo || !orderName)
+		return FALSE;
+
+	if (!InitOnceExecuteOnce(&primary_order_layouts_once, primary_order_layouts_init, NULL, NULL))
+		return FALSE;
+
+	const UINT32 type = orderInfo->orderType;
+	if ((type >= ARRAYSIZE(primary_order_layouts)) || (primary_order_layouts[type].order == 0))
+	{
+		WLog_Print(log, WLOG_WARN, "%s %s not supported, ignoring", primary_order_str, orderName);
+		return TRUE;
+	}
+
+	const PRIMARY_ORDER_LAYOUT* layout = &primary_order_layouts[type];
+	const size_t delta = orderInfo->deltaCoordinates ? 1 : 0;
+	BYTE* order = (BYTE*)primary;
+
+	if (!primary_order_read_fields(orderName, s, orderInfo, layout,
+	                               primary_order_field_lengths[type][delta], &order[layout->order]))
+	{
+		WLog_Print(log, WLOG_ERROR, "%s %s failed", primary_order_str, orderName);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+#if defined(BUILD_TESTING_INTERNAL)
+BOOL update_read_primary_order_by_field(wLog* log, const char* orderName, wStream* s,
+                                        const ORDER_INFO* orderInfo,
+                                        rdpPrimaryUpdate* primary_pub)
 {
 	BOOL rc = FALSE;
 	rdp_primary_update_internal* primary = primary_update_cast(primary_pub);
@@ -3804,6 +4532,7 @@ static BOOL read_primary_order(wLog* log, const char* orderName, wStream* s,
 
 	return TRUE;
 }
+#endif
 
 static BOOL update_recv_primary_order(rdpUpdate* update, wStream* s, BYTE flags)
 {
@@ -3868,7 +4597,7 @@ static BOOL update_recv_primary_order(rdpUpdate* update, wStream* s, BYTE flags)
 
 	orderInfo->deltaCoordinates = (flags & ORDER_DELTA_COORDINATES) ? TRUE : FALSE;
 
-	if (!read_primary_order(up->log, orderName, s, orderInfo, &primary->common))
+	if (!update_read_primary_order(up->log, orderName, s, orderInfo, &primary->common))
 		return FALSE;
 
 	rc = IFCALLRESULT(TRUE, primary->common.OrderInfo, context, orderInfo, orderName);
@@ -4150,10 +4879,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 			    update_read_cache_bitmap_order(update, s, compressed, extraFlags);
 
 			if (order)
-			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheBitmap, context, order);
-				free_cache_bitmap_order(context, order);
-			}
 		}
 		break;
 
@@ -4165,10 +4891,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 			    update_read_cache_bitmap_v2_order(update, s, compressed, extraFlags);
 
 			if (order)
-			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheBitmapV2, context, order);
-				free_cache_bitmap_v2_order(context, order);
-			}
 		}
 		break;
 
@@ -4177,10 +4900,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 			CACHE_BITMAP_V3_ORDER* order = update_read_cache_bitmap_v3_order(update, s, extraFlags);
 
 			if (order)
-			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheBitmapV3, context, order);
-				free_cache_bitmap_v3_order(context, order);
-			}
 		}
 		break;
 
@@ -4190,10 +4910,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 			    update_read_cache_color_table_order(update, s, extraFlags);
 
 			if (order)
-			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheColorTable, context, order);
-				free_cache_color_table_order(context, order);
-			}
 		}
 		break;
 
@@ -4207,10 +4924,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 					CACHE_GLYPH_ORDER* order = update_read_cache_glyph_order(update, s, extraFlags);
 
 					if (order)
-					{
 						rc = IFCALLRESULT(defaultReturn, secondary->CacheGlyph, context, order);
-						free_cache_glyph_order(context, order);
-					}
 				}
 				break;
 
@@ -4220,10 +4934,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 					    update_read_cache_glyph_v2_order(update, s, extraFlags);
 
 					if (order)
-					{
 						rc = IFCALLRESULT(defaultReturn, secondary->CacheGlyphV2, context, order);
-						free_cache_glyph_v2_order(context, order);
-					}
 				}
 				break;
 
@@ -4240,10 +4951,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, WINPR_ATT
 				CACHE_BRUSH_ORDER* order = update_read_cache_brush_order(update, s, extraFlags);
 
 				if (order)
-				{
 					rc = IFCALLRESULT(defaultReturn, secondary->CacheBrush, context, order);
-					free_cache_brush_order(context, order);
-				}
 			}
 			break;
 
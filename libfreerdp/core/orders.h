@@ -193,6 +193,22 @@ FREERDP_LOCAL BYTE get_primary_drawing_order_field_bytes(UINT32 orderType, BOOL*
 
 FREERDP_LOCAL BOOL update_recv_order(rdpUpdate* update, wStream* s);
 
+/** decodes the fields of the primary order described by orderInfo into primary, fields that
+ *  are not present keep their previous value. Unsupported order types are skipped. */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL BOOL update_read_primary_order(wLog* log, const char* orderName, wStream* s,
+                                             const ORDER_INFO* orderInfo,
+                                             rdpPrimaryUpdate* primary);
+
+#if defined(BUILD_TESTING_INTERNAL)
+/** update_read_primary_order with a reader call per field, the reference the layout tables of
+ *  update_read_primary_order are tested against */
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL BOOL update_read_primary_order_by_field(wLog* log, const char* orderName,
+                                                      wStream* s, const ORDER_INFO* orderInfo,
+                                                      rdpPrimaryUpdate* primary);
+#endif
+
 FREERDP_LOCAL BOOL update_write_field_flags(wStream* s, UINT32 fieldFlags, BYTE flags,
                                             BYTE fieldBytes);
 
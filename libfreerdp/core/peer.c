@@ -39,6 +39,7 @@
 
 #include "rdp.h"
 #include "peer.h"
+#include "../crypto/tls.h"
 #include "multitransport.h"
 
 #define TAG FREERDP_TAG("core.peer")
@@ -1510,6 +1511,7 @@ void freerdp_peer_free(freerdp_peer* client)
 		return;
 
 	sspi_FreeAuthIdentity(&client->identity);
+	freerdp_tls_server_context_release(client->TlsServerContext);
 	if (client->sockfd >= 0)
 		closesocket((SOCKET)client->sockfd);
 	free(client);
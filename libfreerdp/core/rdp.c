@@ -2554,6 +2554,10 @@ void rdp_free(rdpRdp* rdp)
 	if (rdp)
 	{
 		freerdp_timer_free(rdp->timer);
+
+		/* send a batched mouse move while the transport is still there */
+		if (rdp->input && rdp->transport && rdp_is_active_state(rdp))
+			(void)input_flush(rdp->input);
 		rdp_reset_free(rdp);
 
 		freerdp_settings_free(rdp->settings);
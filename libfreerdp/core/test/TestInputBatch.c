@@ -0,0 +1,329 @@
+#include <stdio.h>
+
+#include <winpr/stream.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/client.h>
+#include <freerdp/input.h>
+#include <freerdp/metrics.h>
+
+#include "../rdp.h"
+#include "../connection.h"
+#include "../fastpath.h"
+#include "../input.h"
+#include "../transport.h"
+
+#define TEST_MAX_PDUS 8
+#define TEST_TIMER_LATENCY 20
+#define TEST_LONG_LATENCY 10000
+
+typedef struct
+{
+	size_t events;
+	BYTE eventCode;
+	UINT16 flags;
+	INT32 x;
+	INT32 y;
+} test_input_pdu;
+
+typedef struct
+{
+	CRITICAL_SECTION lock;
+	HANDLE sent;
+	size_t count;
+	test_input_pdu pdus[TEST_MAX_PDUS];
+} test_input_state;
+
+static test_input_state test_state = { 0 };
+
+/* record the number of events and the first event of every Fast-Path input PDU */
+static int test_write_pdu(WINPR_ATTR_UNUSED rdpTransport* transport, wStream* s)
+{
+	test_input_pdu pdu = { 0 };
+	const size_t length = Stream_GetPosition(s);
+	const BYTE* data = Stream_Buffer(s);
+
+	if (length < 6)
+		return -1;
+
+	pdu.events = (data[0] >> 2) & 0x0F;
+	pdu.eventCode = (data[3] >> 5) & 0x07;
+	pdu.flags = (UINT16)(data[4] | (data[5] << 8));
+	if (length >= 10)
+	{
+		if (pdu.eventCode == TS_FP_RELPOINTER_EVENT)
+		{
+			pdu.x = (INT16)(data[6] | (data[7] << 8));
+			pdu.y = (INT16)(data[8] | (data[9] << 8));
+		}
+		else
+		{
+			pdu.x = (UINT16)(data[6] | (data[7] << 8));
+			pdu.y = (UINT16)(data[8] | (data[9] << 8));
+		}
+	}
+
+	EnterCriticalSection(&test_state.lock);
+	if (test_state.count < TEST_MAX_PDUS)
+		test_state.pdus[test_state.count] = pdu;
+	test_state.count++;
+	(void)SetEvent(test_state.sent);
+	LeaveCriticalSection(&test_state.lock);
+	return (int)length;
+}
+
+static size_t test_sent(test_input_pdu* last)
+{
+	EnterCriticalSection(&test_state.lock);
+	const size_t count = test_state.count;
+	if (last && (count > 0) && (count <= TEST_MAX_PDUS))
+		*last = test_state.pdus[count - 1];
+	LeaveCriticalSection(&test_state.lock);
+	return count;
+}
+
+static void test_reset(void)
+{
+	EnterCriticalSection(&test_state.lock);
+	test_state.count = 0;
+	(void)ResetEvent(test_state.sent);
+	LeaveCriticalSection(&test_state.lock);
+}
+
+static rdpContext* test_context_new(UINT32 latency)
+{
+	RDP_CLIENT_ENTRY_POINTS entry = { 0 };
+
+	entry.Version = RDP_CLIENT_INTERFACE_VERSION;
+	entry.Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	entry.ContextSize = sizeof(rdpContext);
+
+	test_reset();
+
+	rdpContext* context = freerdp_client_context_new(&entry);
+	if (!context)
+		return NULL;
+
+	rdpSettings* settings = context->settings;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_FastPathInput, TRUE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_HasRelativeMouseEvent, TRUE) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_InputBatchLatency, latency))
+		goto fail;
+
+	if (!input_register_client_callbacks(context->input))
+		goto fail;
+
+	/* the send pool is only available with a transport attached, the socket is not used */
+	const SOCKET sockfd = _socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sockfd == INVALID_SOCKET)
+		goto fail;
+	if (!transport_attach(context->rdp->transport, (int)sockfd))
+	{
+		closesocket(sockfd);
+		goto fail;
+	}
+
+	const rdpTransportIo* cur = transport_get_io_callbacks(context->rdp->transport);
+	if (!cur)
+		goto fail;
+	rdpTransportIo io = *cur;
+	io.WritePdu = test_write_pdu;
+	if (!transport_set_io_callbacks(context->rdp->transport, &io))
+		goto fail;
+
+	if (!rdp_client_transition_to_state(context->rdp, CONNECTION_STATE_ACTIVE))
+		goto fail;
+
+	return context;
+
+fail:
+	freerdp_client_context_free(context);
+	return NULL;
+}
+
+static BOOL test_batch_absolute(void)
+{
+	BOOL rc = FALSE;
+	test_input_pdu pdu = { 0 };
+	rdpContext* context = test_context_new(TEST_LONG_LATENCY);
+	if (!context)
+		return FALSE;
+
+	for (UINT16 x = 1; x <= 5; x++)
+	{
+		if (!freerdp_input_send_mouse_event(context->input, PTR_FLAGS_MOVE, x, (UINT16)(x * 2)))
+			goto fail;
+	}
+	if (test_sent(NULL) != 0)
+		goto fail;
+
+	/* the click carries the last position in the same PDU, in front of it */
+	if (!freerdp_input_send_mouse_event(context->input, PTR_FLAGS_BUTTON1 | PTR_FLAGS_DOWN, 5,
+	                                    10))
+		goto fail;
+	if ((test_sent(&pdu) != 1) || (pdu.events != 2) ||
+	    (pdu.eventCode != FASTPATH_INPUT_EVENT_MOUSE) || (pdu.flags != PTR_FLAGS_MOVE) ||
+	    (pdu.x != 5) || (pdu.y != 10))
+		goto fail;
+
+	/* 6 client events in one PDU */
+	const rdpMetrics* metrics = context->metrics;
+	if ((metrics->InputBatchSizes[2] != 1) || (metrics->InputEventsCoalesced != 5))
+		goto fail;
+	for (size_t x = 0; x < ARRAYSIZE(metrics->InputBatchSizes); x++)
+	{
+		if ((x != 2) && (metrics->InputBatchSizes[x] != 0))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	freerdp_client_context_free(context);
+	if (!rc)
+		(void)fprintf(stderr, "%s failed\n", __func__);
+	return rc;
+}
+
+static BOOL test_batch_relative(void)
+{
+	BOOL rc = FALSE;
+	test_input_pdu pdu = { 0 };
+	rdpContext* context = test_context_new(TEST_LONG_LATENCY);
+	if (!context)
+		return FALSE;
+
+	if (!freerdp_input_send_rel_mouse_event(context->input, PTR_FLAGS_MOVE, 3, 4) ||
+	    !freerdp_input_send_rel_mouse_event(context->input, PTR_FLAGS_MOVE, -1, 2))
+		goto fail;
+	if (test_sent(NULL) != 0)
+		goto fail;
+
+	/* an absolute move can not be merged with the relative ones, these are sent first */
+	if (!freerdp_input_send_mouse_event(context->input, PTR_FLAGS_MOVE, 7, 7))
+		goto fail;
+	if ((test_sent(&pdu) != 1) || (pdu.events != 1) || (pdu.eventCode != TS_FP_RELPOINTER_EVENT) ||
+	    (pdu.x != 2) || (pdu.y != 6))
+		goto fail;
+
+	if (!freerdp_input_send_keyboard_event(context->input, KBD_FLAGS_DOWN, 0x1E))
+		goto fail;
+	if ((test_sent(&pdu) != 2) || (pdu.events != 2) ||
+	    (pdu.eventCode != FASTPATH_INPUT_EVENT_MOUSE) || (pdu.x != 7) || (pdu.y != 7))
+		goto fail;
+
+	const rdpMetrics* metrics = context->metrics;
+	if ((metrics->InputBatchSizes[1] != 2) || (metrics->InputEventsCoalesced != 2))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	freerdp_client_context_free(context);
+	if (!rc)
+		(void)fprintf(stderr, "%s failed\n", __func__);
+	return rc;
+}
+
+static BOOL test_batch_timer(void)
+{
+	BOOL rc = FALSE;
+	test_input_pdu pdu = { 0 };
+	rdpContext* context = test_context_new(TEST_TIMER_LATENCY);
+	if (!context)
+		return FALSE;
+
+	for (UINT16 x = 1; x <= 3; x++)
+	{
+		if (!freerdp_input_send_mouse_event(context->input, PTR_FLAGS_MOVE, x, x))
+			goto fail;
+	}
+
+	/* nothing else is sent, the timer flushes the batch on its own. On a loaded machine it
+	 * might have fired between the moves already, the last position arrives in any case. */
+	const rdpMetrics* metrics = context->metrics;
+	const UINT64 end = GetTickCount64() + 2000;
+	size_t sent = test_sent(&pdu);
+	while ((sent == 0) || (pdu.x != 3) || (metrics->InputBatchSizes[1] != sent))
+	{
+		if (GetTickCount64() > end)
+			goto fail;
+		Sleep(1);
+		sent = test_sent(&pdu);
+	}
+
+	if ((sent > 3) || (pdu.events != 1) || (pdu.y != 3) ||
+	    (metrics->InputEventsCoalesced != 3 - sent))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	freerdp_client_context_free(context);
+	if (!rc)
+		(void)fprintf(stderr, "%s failed\n", __func__);
+	return rc;
+}
+
+static BOOL test_batch_flush(void)
+{
+	BOOL rc = FALSE;
+	test_input_pdu pdu = { 0 };
+	rdpContext* context = test_context_new(TEST_LONG_LATENCY);
+	if (!context)
+		return FALSE;
+
+	if (!input_flush(context->input) || (test_sent(NULL) != 0))
+		goto fail;
+
+	if (!freerdp_input_send_mouse_event(context->input, PTR_FLAGS_MOVE, 1, 2) ||
+	    !freerdp_input_send_mouse_event(context->input, PTR_FLAGS_MOVE, 3, 4))
+		goto fail;
+	if (!input_flush(context->input))
+		goto fail;
+	if ((test_sent(&pdu) != 1) || (pdu.events != 1) || (pdu.x != 3) || (pdu.y != 4))
+		goto fail;
+
+	/* a pending move is not lost when the context goes away */
+	if (!freerdp_input_send_mouse_event(context->input, PTR_FLAGS_MOVE, 5, 6))
+		goto fail;
+	freerdp_client_context_free(context);
+	context = NULL;
+	if ((test_sent(&pdu) != 2) || (pdu.events != 1) || (pdu.x != 5) || (pdu.y != 6))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	freerdp_client_context_free(context);
+	if (!rc)
+		(void)fprintf(stderr, "%s failed\n", __func__);
+	return rc;
+}
+
+int TestInputBatch(int argc, char* argv[])
+{
+	int rc = -1;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!InitializeCriticalSectionAndSpinCount(&test_state.lock, 4000))
+		return -1;
+	test_state.sent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!test_state.sent)
+		goto fail;
+
+	if (!test_batch_absolute())
+		goto fail;
+	if (!test_batch_relative())
+		goto fail;
+	if (!test_batch_timer())
+		goto fail;
+	if (!test_batch_flush())
+		goto fail;
+
+	rc = 0;
+fail:
+	(void)CloseHandle(test_state.sent);
+	DeleteCriticalSection(&test_state.lock);
+	return rc;
+}
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <time.h>
+
+#include <winpr/crt.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/log.h>
+
+#include "../update.h"
+#include "../orders.h"
+#include "../../test/test_performance.h"
+
+#define TEST_ORDER_MAX_SIZE 128
+
+static const UINT32 test_order_types[] = {
+	ORDER_TYPE_DSTBLT,           ORDER_TYPE_PATBLT,       ORDER_TYPE_SCRBLT,
+	ORDER_TYPE_DRAW_NINE_GRID,   ORDER_TYPE_MULTI_DRAW_NINE_GRID,
+	ORDER_TYPE_LINE_TO,          ORDER_TYPE_OPAQUE_RECT,  ORDER_TYPE_SAVE_BITMAP,
+	ORDER_TYPE_MEMBLT,           ORDER_TYPE_MEM3BLT,      ORDER_TYPE_MULTI_DSTBLT,
+	ORDER_TYPE_MULTI_PATBLT,     ORDER_TYPE_MULTI_SCRBLT, ORDER_TYPE_MULTI_OPAQUE_RECT,
+	ORDER_TYPE_FAST_INDEX,       ORDER_TYPE_POLYGON_SC,   ORDER_TYPE_POLYGON_CB,
+	ORDER_TYPE_POLYLINE,         ORDER_TYPE_FAST_GLYPH,   ORDER_TYPE_ELLIPSE_SC,
+	ORDER_TYPE_ELLIPSE_CB,       ORDER_TYPE_GLYPH_INDEX
+};
+
+/* the frequent orders of a desktop session with the field flags before their variable part */
+static const struct
+{
+	UINT32 orderType;
+	UINT32 fields;
+} test_stream_orders[] = { { ORDER_TYPE_MEMBLT, 0x1FF },      { ORDER_TYPE_OPAQUE_RECT, 0x7F },
+	                       { ORDER_TYPE_GLYPH_INDEX, 0x1FFFFF }, { ORDER_TYPE_PATBLT, 0xFFF },
+	                       { ORDER_TYPE_SCRBLT, 0x7F },      { ORDER_TYPE_DSTBLT, 0x1F },
+	                       { ORDER_TYPE_LINE_TO, 0x3FF },    { ORDER_TYPE_MEM3BLT, 0xFFFF },
+	                       { ORDER_TYPE_FAST_INDEX, 0x3FFF } };
+
+static BYTE test_brush_data = 0;
+
+static void test_primary_reset(rdp_primary_update_internal* primary)
+{
+	free(primary->polyline.points);
+	free(primary->polygon_sc.points);
+	free(primary->polygon_cb.points);
+	free(primary->fast_glyph.glyphData.aj);
+	memset(primary, 0, sizeof(*primary));
+}
+
+static void test_primary_free(rdp_primary_update_internal* primary)
+{
+	if (!primary)
+		return;
+	test_primary_reset(primary);
+	free(primary);
+}
+
+/* the pointers of the copies of two states are replaced by markers after comparing what they
+ * point to */
+static void test_brush_normalize(const rdpBrush* brush, rdpBrush* copy)
+{
+	if (brush->data == brush->p8x8)
+		copy->data = &test_brush_data;
+}
+
+static BOOL test_points_normalize(DELTA_POINT** a, DELTA_POINT** b, size_t count)
+{
+	if (!*a || !*b)
+		return *a == *b;
+	if (memcmp(*a, *b, count * sizeof(DELTA_POINT)) != 0)
+		return FALSE;
+	*a = NULL;
+	*b = NULL;
+	return TRUE;
+}
+
+static void test_primary_normalize(const rdp_primary_update_internal* primary,
+                                   rdp_primary_update_internal* copy)
+{
+	memcpy(copy, primary, sizeof(*copy));
+	test_brush_normalize(&primary->patblt.brush, &copy->patblt.brush);
+	test_brush_normalize(&primary->multi_patblt.brush, &copy->multi_patblt.brush);
+	test_brush_normalize(&primary->mem3blt.brush, &copy->mem3blt.brush);
+	test_brush_normalize(&primary->glyph_index.brush, &copy->glyph_index.brush);
+	test_brush_normalize(&primary->polygon_cb.brush, &copy->polygon_cb.brush);
+	test_brush_normalize(&primary->ellipse_cb.brush, &copy->ellipse_cb.brush);
+}
+
+static BOOL test_primary_equal(const rdp_primary_update_internal* a,
+                               const rdp_primary_update_internal* b,
+                               rdp_primary_update_internal* ca, rdp_primary_update_internal* cb)
+{
+	test_primary_normalize(a, ca);
+	test_primary_normalize(b, cb);
+
+	if ((ca->polyline.numDeltaEntries != cb->polyline.numDeltaEntries) ||
+	    (ca->polygon_sc.numPoints != cb->polygon_sc.numPoints) ||
+	    (ca->polygon_cb.numPoints != cb->polygon_cb.numPoints) ||
+	    (ca->fast_glyph.glyphData.cb != cb->fast_glyph.glyphData.cb))
+		return FALSE;
+
+	if (!test_points_normalize(&ca->polyline.points, &cb->polyline.points,
+	                           ca->polyline.numDeltaEntries) ||
+	    !test_points_normalize(&ca->polygon_sc.points, &cb->polygon_sc.points,
+	                           ca->polygon_sc.numPoints) ||
+	    !test_points_normalize(&ca->polygon_cb.points, &cb->polygon_cb.points,
+	                           ca->polygon_cb.numPoints))
+		return FALSE;
+
+	BYTE** aja = &ca->fast_glyph.glyphData.aj;
+	BYTE** ajb = &cb->fast_glyph.glyphData.aj;
+	if (!*aja || !*ajb)
+	{
+		if (*aja != *ajb)
+			return FALSE;
+	}
+	else if (memcmp(*aja, *ajb, ca->fast_glyph.glyphData.cb) != 0)
+		return FALSE;
+	*aja = NULL;
+	*ajb = NULL;
+
+	return memcmp(ca, cb, sizeof(*ca)) == 0;
+}
+
+/* a random order, half of them with small byte values so entry counts and lengths fit */
+static size_t test_order_random(ORDER_INFO* orderInfo, BYTE* data, size_t size)
+{
+	const UINT32 orderType = test_order_types[(size_t)rand() % ARRAYSIZE(test_order_types)];
+	const BYTE bytes = get_primary_drawing_order_field_bytes(orderType, NULL);
+	const UINT32 mask = (1u << (8 * bytes)) - 1;
+	const UINT32 random = ((UINT32)rand() << 16) ^ (UINT32)rand();
+
+	orderInfo->orderType = orderType;
+	orderInfo->deltaCoordinates = (rand() % 2) ? TRUE : FALSE;
+	switch (rand() % 3)
+	{
+		case 0:
+			orderInfo->fieldFlags = random & mask;
+			break;
+		case 1:
+			orderInfo->fieldFlags = mask;
+			break;
+		default:
+			orderInfo->fieldFlags = random & ((UINT32)rand() << 8) & mask;
+			break;
+	}
+
+	const BOOL small = (rand() % 2) != 0;
+	for (size_t x = 0; x < size; x++)
+		data[x] = small ? (BYTE)(rand() % 8) : (BYTE)rand();
+
+	return (rand() % 8) ? size : (size_t)rand() % size;
+}
+
+static BOOL test_primary_differential(void)
+{
+	BOOL rc = FALSE;
+	const UINT32 seed = (UINT32)time(NULL);
+	size_t decoded[ORDER_TYPE_GLYPH_INDEX + 1] = { 0 };
+	wLog* log = WLog_Get(FREERDP_TAG("core.orders"));
+	rdp_primary_update_internal* table = calloc(1, sizeof(rdp_primary_update_internal));
+	rdp_primary_update_internal* field = calloc(1, sizeof(rdp_primary_update_internal));
+	rdp_primary_update_internal* ca = calloc(1, sizeof(rdp_primary_update_internal));
+	rdp_primary_update_internal* cb = calloc(1, sizeof(rdp_primary_update_internal));
+
+	if (!table || !field || !ca || !cb)
+		goto fail;
+
+	srand(seed);
+	for (size_t i = 0; i < 200000; i++)
+	{
+		BYTE data[TEST_ORDER_MAX_SIZE] = { 0 };
+		ORDER_INFO orderInfo = { 0 };
+		wStream sbuffer = { 0 };
+		wStream fbuffer = { 0 };
+
+		const size_t length = test_order_random(&orderInfo, data, sizeof(data));
+		wStream* st = Stream_StaticConstInit(&sbuffer, data, length);
+		wStream* sf = Stream_StaticConstInit(&fbuffer, data, length);
+
+		const BOOL rct = update_read_primary_order(log, "test", st, &orderInfo, &table->common);
+		const BOOL rcf =
+		    update_read_primary_order_by_field(log, "test", sf, &orderInfo, &field->common);
+		if (rct != rcf)
+		{
+			(void)fprintf(stderr,
+			              "%s: order %" PRIu32 " fields 0x%06" PRIx32 " %s by field, %s table "
+			              "driven [seed %" PRIu32 "]\n",
+			              __func__, orderInfo.orderType, orderInfo.fieldFlags,
+			              rcf ? "decoded" : "failed", rct ? "decoded" : "failed", seed);
+			goto fail;
+		}
+
+		/* the state after a failure is not used, the connection is dropped */
+		if (!rct)
+		{
+			test_primary_reset(table);
+			test_primary_reset(field);
+			continue;
+		}
+
+		if ((Stream_GetPosition(st) != Stream_GetPosition(sf)) ||
+		    !test_primary_equal(table, field, ca, cb))
+		{
+			(void)fprintf(stderr,
+			              "%s: order %" PRIu32 " fields 0x%06" PRIx32 " delta %d decoded "
+			              "differently [seed %" PRIu32 "]\n",
+			              __func__, orderInfo.orderType, orderInfo.fieldFlags,
+			              orderInfo.deltaCoordinates, seed);
+			goto fail;
+		}
+		decoded[orderInfo.orderType]++;
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(test_order_types); x++)
+	{
+		if (decoded[test_order_types[x]] == 0)
+		{
+			(void)fprintf(stderr, "%s: no order %" PRIu32 " decoded [seed %" PRIu32 "]\n",
+			              __func__, test_order_types[x], seed);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	test_primary_free(table);
+	test_primary_free(field);
+	free(ca);
+	free(cb);
+	return rc;
+}
+
+typedef struct
+{
+	ORDER_INFO orderInfo;
+	size_t offset;
+	size_t length;
+} TEST_STREAM_ORDER;
+
+/* orders with the fields a server sends for the frequent orders, a few fields changed with
+ * delta coordinates or all of them */
+static BOOL test_stream_new(TEST_STREAM_ORDER* orders, size_t count, wStream* s)
+{
+	srand(0);
+	for (size_t i = 0; i < count; i++)
+	{
+		TEST_STREAM_ORDER* order = &orders[i];
+		const size_t type = (size_t)rand() % ARRAYSIZE(test_stream_orders);
+		const UINT32 fields = test_stream_orders[type].fields;
+
+		order->orderInfo.orderType = test_stream_orders[type].orderType;
+		order->orderInfo.deltaCoordinates = (rand() % 4) ? TRUE : FALSE;
+		order->orderInfo.fieldFlags = order->orderInfo.deltaCoordinates
+		                                  ? (((UINT32)rand() << 8) ^ (UINT32)rand()) & fields
+		                                  : fields;
+		order->offset = Stream_GetPosition(s);
+		order->length = TEST_ORDER_MAX_SIZE;
+
+		if (!Stream_EnsureRemainingCapacity(s, order->length))
+			return FALSE;
+
+		/* brush styles below CACHED_BRUSH */
+		for (size_t x = 0; x < order->length; x++)
+			Stream_Write_UINT8(s, (BYTE)(rand() % 0x40));
+	}
+	return TRUE;
+}
+
+static BOOL test_stream_decode(const TEST_STREAM_ORDER* orders, size_t count, wStream* s,
+                               BOOL table, UINT64* duration)
+{
+	BOOL rc = FALSE;
+	wLog* log = WLog_Get(FREERDP_TAG("core.orders"));
+	rdp_primary_update_internal* primary = calloc(1, sizeof(rdp_primary_update_internal));
+
+	if (!primary)
+		return FALSE;
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (size_t repeat = 0; repeat < 20; repeat++)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const TEST_STREAM_ORDER* order = &orders[i];
+			wStream sbuffer = { 0 };
+			wStream* sub = Stream_StaticConstInit(&sbuffer, Stream_Buffer(s) + order->offset,
+			                                      order->length);
+
+			const BOOL decoded =
+			    table ? update_read_primary_order(log, "test", sub, &order->orderInfo,
+			                                      &primary->common)
+			          : update_read_primary_order_by_field(log, "test", sub, &order->orderInfo,
+			                                               &primary->common);
+			if (!decoded)
+				goto fail;
+		}
+	}
+	*duration = winpr_GetTickCount64NS() - start;
+
+	rc = TRUE;
+fail:
+	test_primary_free(primary);
+	return rc;
+}
+
+static BOOL test_primary_benchmark(void)
+{
+	BOOL rc = FALSE;
+	const size_t count = 100000;
+	UINT64 table = 0;
+	UINT64 field = 0;
+	TEST_STREAM_ORDER* orders = calloc(count, sizeof(TEST_STREAM_ORDER));
+	wStream* s = Stream_New(NULL, 1024);
+
+	if (!orders || !s || !test_stream_new(orders, count, s))
+		goto fail;
+
+	if (!test_stream_decode(orders, count, s, TRUE, &table) ||
+	    !test_stream_decode(orders, count, s, FALSE, &field))
+		goto fail;
+
+	printf("%" PRIuz " primary orders: table driven %" PRIu64 "ms, field by field %" PRIu64 "ms\n",
+	       20 * count, table / 1000000ull, field / 1000000ull);
+
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	free(orders);
+	return rc;
+}
+
+int TestPrimaryOrders(int argc, char* argv[])
+{
+	/* most of the random orders are invalid, keep their errors out of the test log */
+	WLog_SetLogLevel(WLog_Get(FREERDP_TAG("core.orders")), WLOG_OFF);
+	WLog_SetLogLevel(WLog_Get("com.winpr.wStream"), WLOG_OFF);
+
+	if (!test_primary_differential())
+		return -1;
+
+	test_performance_setup(argc, argv);
+	if (!g_TestPerformance)
+		return 0;
+
+	if (!test_primary_benchmark())
+		return -1;
+
+	return 0;
+}
@@ -0,0 +1,289 @@
+#include <stdio.h>
+
+#include <winpr/stream.h>
+
+#include <freerdp/client.h>
+
+#include "../update.h"
+#include "../orders.h"
+#include "../arena.h"
+
+#define TEST_PDU_RECTANGLES 16
+#define TEST_PDU_COUNT 1000
+
+typedef struct
+{
+	const BYTE* begin;
+	const BYTE* end;
+	size_t rectangles;
+	BOOL referenced;
+} test_bitmap_state;
+
+static test_bitmap_state test_state = { 0 };
+static size_t test_cache_orders = 0;
+
+static BOOL test_arena_basic(void)
+{
+	BOOL rc = FALSE;
+	rdpArenaStats stats = { 0 };
+	rdpArena* arena = arena_new(256);
+
+	if (!arena)
+		return FALSE;
+
+	for (size_t i = 1; i < 64; i++)
+	{
+		BYTE* ptr = arena_calloc(arena, i, 3);
+		if (!ptr || (((uintptr_t)ptr % 16) != 0))
+			goto fail;
+
+		for (size_t x = 0; x < i * 3; x++)
+		{
+			if (ptr[x] != 0)
+				goto fail;
+		}
+		memset(ptr, 0xA5, i * 3);
+	}
+
+	if (arena_calloc(arena, SIZE_MAX / 2, 4))
+		goto fail;
+
+	/* larger than a block, served from a dedicated block */
+	if (!arena_calloc(arena, 1, 4096))
+		goto fail;
+
+	arena_get_stats(arena, &stats);
+	if (stats.heapAllocations < 2)
+		goto fail;
+
+	/* after a reset the blocks are merged, the same workload does not need the heap */
+	arena_reset(arena);
+	arena_get_stats(arena, &stats);
+	const size_t heapAllocations = stats.heapAllocations;
+
+	for (size_t i = 1; i < 64; i++)
+	{
+		const BYTE* ptr = arena_calloc(arena, i, 3);
+		if (!ptr)
+			goto fail;
+
+		for (size_t x = 0; x < i * 3; x++)
+		{
+			if (ptr[x] != 0)
+				goto fail;
+		}
+	}
+
+	if (!arena_calloc(arena, 1, 4096))
+		goto fail;
+
+	arena_reset(arena);
+	arena_get_stats(arena, &stats);
+	if ((stats.heapAllocations != heapAllocations) || (stats.resets != 2))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	arena_free(arena);
+	return rc;
+}
+
+static BOOL test_bitmap_update(rdpContext* context, const BITMAP_UPDATE* bitmap)
+{
+	WINPR_UNUSED(context);
+
+	for (UINT32 i = 0; i < bitmap->number; i++)
+	{
+		const BITMAP_DATA* data = &bitmap->rectangles[i];
+		const BYTE* payload = data->bitmapDataStream;
+
+		if (!payload || (payload < test_state.begin) ||
+		    (payload + data->bitmapLength > test_state.end))
+			test_state.referenced = FALSE;
+	}
+
+	test_state.rectangles += bitmap->number;
+	return TRUE;
+}
+
+static wStream* test_bitmap_pdu(void)
+{
+	wStream* s = Stream_New(NULL, 4 + TEST_PDU_RECTANGLES * (18 + 64 * 2));
+	if (!s)
+		return NULL;
+
+	Stream_Write_UINT16(s, UPDATE_TYPE_BITMAP);
+	Stream_Write_UINT16(s, TEST_PDU_RECTANGLES);
+
+	for (UINT16 i = 0; i < TEST_PDU_RECTANGLES; i++)
+	{
+		Stream_Write_UINT16(s, i * 8); /* destLeft */
+		Stream_Write_UINT16(s, 0);     /* destTop */
+		Stream_Write_UINT16(s, i * 8 + 7);
+		Stream_Write_UINT16(s, 7);
+		Stream_Write_UINT16(s, 8);  /* width */
+		Stream_Write_UINT16(s, 8);  /* height */
+		Stream_Write_UINT16(s, 16); /* bitsPerPixel */
+		Stream_Write_UINT16(s, 0);  /* flags */
+		Stream_Write_UINT16(s, 64 * 2);
+		for (size_t x = 0; x < 64 * 2; x++)
+			Stream_Write_UINT8(s, (BYTE)(i + x));
+	}
+
+	Stream_SealLength(s);
+	return s;
+}
+
+static BOOL test_update_arena(void)
+{
+	BOOL rc = FALSE;
+	RDP_CLIENT_ENTRY_POINTS entry = { 0 };
+	rdpArenaStats first = { 0 };
+	rdpArenaStats last = { 0 };
+
+	entry.Version = RDP_CLIENT_INTERFACE_VERSION;
+	entry.Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	entry.ContextSize = sizeof(rdpContext);
+
+	wStream* s = test_bitmap_pdu();
+	rdpContext* context = freerdp_client_context_new(&entry);
+
+	if (!s || !context)
+		goto fail;
+
+	rdpUpdate* update = context->update;
+	rdp_update_internal* up = update_cast(update);
+	update->BitmapUpdate = test_bitmap_update;
+
+	test_state.begin = Stream_Buffer(s);
+	test_state.end = Stream_Buffer(s) + Stream_Length(s);
+	test_state.referenced = TRUE;
+
+	for (size_t i = 0; i < TEST_PDU_COUNT; i++)
+	{
+		Stream_SetPosition(s, 0);
+		if (!update_recv(update, s))
+			goto fail;
+
+		if (i == 0)
+			arena_get_stats(up->arena, &first);
+	}
+	arena_get_stats(up->arena, &last);
+
+	printf("%d bitmap update PDUs: %" PRIuz " arena allocations, %" PRIuz " heap allocations\n",
+	       TEST_PDU_COUNT, last.allocations, last.heapAllocations);
+
+	if (!test_state.referenced ||
+	    (test_state.rectangles != 1ull * TEST_PDU_COUNT * TEST_PDU_RECTANGLES))
+		goto fail;
+
+	/* an update and its rectangles per PDU, none of them after the first PDU from the heap */
+	if ((last.allocations - first.allocations) != 2ull * (TEST_PDU_COUNT - 1))
+		goto fail;
+	if (last.heapAllocations != first.heapAllocations)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	freerdp_client_context_free(context);
+	Stream_Free(s, TRUE);
+	return rc;
+}
+
+static BOOL test_cache_bitmap_v2(rdpContext* context, const CACHE_BITMAP_V2_ORDER* order)
+{
+	WINPR_UNUSED(context);
+
+	test_cache_orders++;
+	return order->bitmapDataStream && (order->bitmapLength == 8);
+}
+
+/* an uncompressed 16bpp CACHE_BITMAP_V2 order of a 2x2 bitmap with length bytes of payload */
+static wStream* test_cache_bitmap_v2_pdu(BYTE length)
+{
+	const UINT16 extraFlags = (CBR2_16BPP << 3) | 1; /* bitsPerPixelId, cacheId */
+	wStream* s = Stream_New(NULL, 32);
+	if (!s)
+		return NULL;
+
+	Stream_Write_UINT8(s, ORDER_STANDARD | ORDER_SECONDARY);
+	Stream_Write_INT16(s, (INT16)(5 + length + 8 - 7)); /* orderLength, 13 bytes less */
+	Stream_Write_UINT16(s, extraFlags);
+	Stream_Write_UINT8(s, ORDER_TYPE_BITMAP_UNCOMPRESSED_V2);
+	Stream_Write_UINT8(s, 2);      /* bitmapWidth */
+	Stream_Write_UINT8(s, 2);      /* bitmapHeight */
+	Stream_Write_UINT8(s, length); /* bitmapLength */
+	Stream_Write_UINT16(s, 0);     /* cacheIndex */
+	for (BYTE x = 0; x < length; x++)
+		Stream_Write_UINT8(s, x);
+	/* padding, so the order length check passes without payload as well */
+	Stream_Zero(s, 8);
+
+	Stream_SealLength(s);
+	Stream_SetPosition(s, 0);
+	return s;
+}
+
+static BOOL test_cache_bitmap_v2_empty(void)
+{
+	BOOL rc = FALSE;
+	RDP_CLIENT_ENTRY_POINTS entry = { 0 };
+
+	entry.Version = RDP_CLIENT_INTERFACE_VERSION;
+	entry.Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	entry.ContextSize = sizeof(rdpContext);
+
+	wStream* valid = test_cache_bitmap_v2_pdu(8);
+	wStream* empty = test_cache_bitmap_v2_pdu(0);
+	rdpContext* context = freerdp_client_context_new(&entry);
+
+	if (!valid || !empty || !context)
+		goto fail;
+
+	if (!freerdp_settings_set_bool(context->settings, FreeRDP_BitmapCacheEnabled, TRUE))
+		goto fail;
+	context->update->secondary->CacheBitmapV2 = test_cache_bitmap_v2;
+	test_cache_orders = 0;
+
+	if (!update_recv_order(context->update, valid) || (test_cache_orders != 1))
+		goto fail;
+
+	/* the payload is referenced in place, an empty one is still rejected by the parser and the
+	 * order is skipped without reaching the callback */
+	(void)update_recv_order(context->update, empty);
+	if (test_cache_orders != 1)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	freerdp_client_context_free(context);
+	Stream_Free(valid, TRUE);
+	Stream_Free(empty, TRUE);
+	return rc;
+}
+
+int TestUpdateArena(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_arena_basic())
+	{
+		printf("test_arena_basic failed\n");
+		return -1;
+	}
+
+	if (!test_update_arena())
+	{
+		printf("test_update_arena failed\n");
+		return -1;
+	}
+
+	if (!test_cache_bitmap_v2_empty())
+	{
+		printf("test_cache_bitmap_v2_empty failed\n");
+		return -1;
+	}
+
+	return 0;
+}
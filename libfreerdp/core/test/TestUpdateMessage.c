@@ -0,0 +1,576 @@
+#include <stdio.h>
+
+#include <winpr/stream.h>
+#include <winpr/synch.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/client.h>
+#include <freerdp/codec/region.h>
+
+#include "../rdp.h"
+#include "../fastpath.h"
+#include "../message.h"
+#include "../transport.h"
+#include "../update.h"
+
+#define TEST_DESKTOP_SIZE 64
+#define TEST_SURFACE_SIZE 16
+#define TEST_SURFACE_PAYLOAD (TEST_SURFACE_SIZE * TEST_SURFACE_SIZE * 4)
+#define TEST_DESKTOP_PAYLOAD (TEST_DESKTOP_SIZE * TEST_DESKTOP_SIZE * 4)
+#define TEST_MAX_DELIVERED 8
+
+typedef struct
+{
+	HANDLE entered;
+	HANDLE release;
+	const BYTE* begin;
+	const BYTE* end;
+	size_t surfaceBits;
+	size_t referenced;
+	size_t payloadLength;
+	BYTE payload[TEST_DESKTOP_PAYLOAD];
+	size_t opaqueRects;
+	OPAQUE_RECT_ORDER opaqueRect[TEST_MAX_DELIVERED];
+	size_t refreshRects;
+	size_t refreshAreas;
+	RECTANGLE_16 refreshArea[TEST_MAX_DELIVERED];
+	size_t pointerPositions;
+	POINTER_POSITION_UPDATE pointerPosition;
+	size_t pointerSystems;
+	POINTER_SYSTEM_UPDATE pointerSystem;
+} test_message_state;
+
+static test_message_state test_state = { 0 };
+
+/* holds the proxy thread in the first message, everything posted meanwhile stays queued */
+static BOOL test_begin_paint(rdpContext* context)
+{
+	WINPR_UNUSED(context);
+
+	(void)SetEvent(test_state.entered);
+	(void)WaitForSingleObject(test_state.release, INFINITE);
+	return TRUE;
+}
+
+static BOOL test_end_paint(rdpContext* context)
+{
+	WINPR_UNUSED(context);
+	return TRUE;
+}
+
+static BOOL test_surface_bits(rdpContext* context, const SURFACE_BITS_COMMAND* cmd)
+{
+	WINPR_UNUSED(context);
+
+	const BYTE* data = cmd->bmp.bitmapData;
+	const size_t length = cmd->bmp.bitmapDataLength;
+	if (!data || (length > sizeof(test_state.payload)))
+		return FALSE;
+
+	if ((data >= test_state.begin) && (data + length <= test_state.end))
+		test_state.referenced++;
+
+	memcpy(test_state.payload, data, length);
+	test_state.payloadLength = length;
+	test_state.surfaceBits++;
+	return TRUE;
+}
+
+static BOOL test_opaque_rect(rdpContext* context, const OPAQUE_RECT_ORDER* order)
+{
+	WINPR_UNUSED(context);
+
+	if (test_state.opaqueRects >= TEST_MAX_DELIVERED)
+		return FALSE;
+	test_state.opaqueRect[test_state.opaqueRects++] = *order;
+	return TRUE;
+}
+
+static BOOL test_refresh_rect(rdpContext* context, BYTE count, const RECTANGLE_16* areas)
+{
+	WINPR_UNUSED(context);
+
+	if (test_state.refreshAreas + count > TEST_MAX_DELIVERED)
+		return FALSE;
+	for (BYTE x = 0; x < count; x++)
+		test_state.refreshArea[test_state.refreshAreas++] = areas[x];
+	test_state.refreshRects++;
+	return TRUE;
+}
+
+static BOOL test_pointer_position(rdpContext* context, const POINTER_POSITION_UPDATE* position)
+{
+	WINPR_UNUSED(context);
+
+	test_state.pointerPosition = *position;
+	test_state.pointerPositions++;
+	return TRUE;
+}
+
+static BOOL test_pointer_system(rdpContext* context, const POINTER_SYSTEM_UPDATE* system)
+{
+	WINPR_UNUSED(context);
+
+	test_state.pointerSystem = *system;
+	test_state.pointerSystems++;
+	return TRUE;
+}
+
+/* process everything queued and stop the proxy thread */
+static void test_context_drain(rdpContext* context)
+{
+	rdp_update_internal* up = update_cast(context->update);
+
+	(void)SetEvent(test_state.release);
+	update_message_proxy_free(up->proxy);
+	up->proxy = NULL;
+}
+
+static void test_context_free(rdpContext* context)
+{
+	if (context)
+		test_context_drain(context);
+	freerdp_client_context_free(context);
+	(void)CloseHandle(test_state.entered);
+	(void)CloseHandle(test_state.release);
+	test_state.entered = NULL;
+	test_state.release = NULL;
+}
+
+/* a client context with an asynchronous update proxy delivering to the test callbacks */
+static rdpContext* test_context_new(void)
+{
+	RDP_CLIENT_ENTRY_POINTS entry = { 0 };
+
+	entry.Version = RDP_CLIENT_INTERFACE_VERSION;
+	entry.Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	entry.ContextSize = sizeof(rdpContext);
+
+	test_state = (test_message_state){ 0 };
+	test_state.entered = CreateEventA(NULL, TRUE, FALSE, NULL);
+	test_state.release = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+	rdpContext* context = freerdp_client_context_new(&entry);
+	if (!context || !test_state.entered || !test_state.release)
+		goto fail;
+
+	if (!freerdp_settings_set_uint32(context->settings, FreeRDP_DesktopWidth,
+	                                 TEST_DESKTOP_SIZE) ||
+	    !freerdp_settings_set_uint32(context->settings, FreeRDP_DesktopHeight,
+	                                 TEST_DESKTOP_SIZE))
+		goto fail;
+
+	/* the receive pool is only available with a transport attached, the socket is not used */
+	const SOCKET sockfd = _socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sockfd == INVALID_SOCKET)
+		goto fail;
+	if (!transport_attach(context->rdp->transport, (int)sockfd))
+	{
+		closesocket(sockfd);
+		goto fail;
+	}
+
+	rdpUpdate* update = context->update;
+	update->BeginPaint = test_begin_paint;
+	update->EndPaint = test_end_paint;
+	update->SurfaceBits = test_surface_bits;
+	update->RefreshRect = test_refresh_rect;
+	update->primary->OpaqueRect = test_opaque_rect;
+	update->pointer->PointerPosition = test_pointer_position;
+	update->pointer->PointerSystem = test_pointer_system;
+
+	rdp_update_internal* up = update_cast(update);
+	up->proxy = update_message_proxy_new(update);
+	if (!up->proxy)
+		goto fail;
+
+	return context;
+
+fail:
+	test_context_free(context);
+	return NULL;
+}
+
+/* park the proxy thread, messages posted after this stay in the queue */
+static BOOL test_context_hold(rdpContext* context)
+{
+	if (!context->update->BeginPaint(context))
+		return FALSE;
+	return WaitForSingleObject(test_state.entered, INFINITE) == WAIT_OBJECT_0;
+}
+
+static void test_write_surface_bits(wStream* s)
+{
+	Stream_Write_UINT16(s, CMDTYPE_SET_SURFACE_BITS);
+	Stream_Write_UINT16(s, 0); /* destLeft */
+	Stream_Write_UINT16(s, 0); /* destTop */
+	Stream_Write_UINT16(s, TEST_SURFACE_SIZE);
+	Stream_Write_UINT16(s, TEST_SURFACE_SIZE);
+	Stream_Write_UINT8(s, 32); /* bpp */
+	Stream_Write_UINT8(s, 0);  /* flags */
+	Stream_Write_UINT8(s, 0);  /* reserved */
+	Stream_Write_UINT8(s, RDP_CODEC_ID_NONE);
+	Stream_Write_UINT16(s, TEST_SURFACE_SIZE);
+	Stream_Write_UINT16(s, TEST_SURFACE_SIZE);
+	Stream_Write_UINT32(s, TEST_SURFACE_PAYLOAD);
+	for (size_t x = 0; x < TEST_SURFACE_PAYLOAD; x++)
+		Stream_Write_UINT8(s, (BYTE)(x * 7 + 3));
+}
+
+static BOOL test_write_fastpath_update(wStream* s, BYTE fragmentation, const BYTE* data,
+                                       size_t length)
+{
+	if (!Stream_EnsureRemainingCapacity(s, 3 + length))
+		return FALSE;
+
+	Stream_Write_UINT8(s, FASTPATH_UPDATETYPE_SURFCMDS | (fragmentation << 4));
+	Stream_Write_UINT16(s, (UINT16)length);
+	Stream_Write(s, data, length);
+	return TRUE;
+}
+
+/* a surface bits PDU either as a single fragment (parsed in place, the payload is referenced)
+ * or split into fragments (reassembled, the payload is copied) */
+static wStream* test_surface_bits_pdu(rdpTransport* transport, BOOL fragmented)
+{
+	wStream* s = NULL;
+	wStream* cmd = Stream_New(NULL, 64 + TEST_SURFACE_PAYLOAD);
+	if (!cmd)
+		return NULL;
+
+	test_write_surface_bits(cmd);
+	const size_t length = Stream_GetPosition(cmd);
+	const size_t half = length / 2;
+
+	s = transport_take_from_pool(transport, 64 + length);
+	if (!s)
+		goto fail;
+
+	const BYTE* data = Stream_Buffer(cmd);
+	if (!fragmented)
+	{
+		if (!test_write_fastpath_update(s, FASTPATH_FRAGMENT_SINGLE, data, length))
+			goto fail;
+	}
+	else
+	{
+		if (!test_write_fastpath_update(s, FASTPATH_FRAGMENT_FIRST, data, half))
+			goto fail;
+		if (!test_write_fastpath_update(s, FASTPATH_FRAGMENT_LAST, &data[half], length - half))
+			goto fail;
+	}
+
+	Stream_SealLength(s);
+	Stream_SetPosition(s, 0);
+	Stream_Free(cmd, TRUE);
+	return s;
+
+fail:
+	if (s)
+		Stream_Release(s);
+	Stream_Free(cmd, TRUE);
+	return NULL;
+}
+
+static BOOL test_surface_bits_path(BOOL fragmented, BYTE* payload)
+{
+	BOOL rc = FALSE;
+	wStream* s = NULL;
+	wStream* reused = NULL;
+	rdpContext* context = test_context_new();
+
+	if (!context)
+		goto fail;
+
+	rdpRdp* rdp = context->rdp;
+	s = test_surface_bits_pdu(rdp->transport, fragmented);
+	if (!s)
+		goto fail;
+
+	test_state.begin = Stream_Buffer(s);
+	test_state.end = Stream_Buffer(s) + Stream_Length(s);
+
+	if (fastpath_recv_updates(rdp->fastpath, s) != STATE_RUN_SUCCESS)
+		goto fail;
+
+	/* the receive buffer goes back to the pool and is overwritten while the message is still
+	 * queued, a referenced payload must not be affected */
+	Stream_Release(s);
+	s = NULL;
+	reused = transport_take_from_pool(rdp->transport, 64 + TEST_SURFACE_PAYLOAD);
+	if (!reused)
+		goto fail;
+	memset(Stream_Buffer(reused), 0xFF, Stream_Capacity(reused));
+
+	test_context_drain(context);
+
+	if ((test_state.surfaceBits != 1) || (test_state.payloadLength != TEST_SURFACE_PAYLOAD))
+		goto fail;
+
+	const rdpMetrics* metrics = context->metrics;
+	if (fragmented)
+	{
+		/* reassembly and the message each copy the payload */
+		if ((test_state.referenced != 0) || (metrics->TotalUpdateBytesReferenced != 0) ||
+		    (metrics->TotalUpdateBytesCopied < 2ull * TEST_SURFACE_PAYLOAD))
+			goto fail;
+	}
+	else
+	{
+		if ((test_state.referenced != 1) ||
+		    (metrics->TotalUpdateBytesReferenced != TEST_SURFACE_PAYLOAD) ||
+		    (metrics->TotalUpdateBytesCopied != 0))
+			goto fail;
+	}
+
+	memcpy(payload, test_state.payload, TEST_SURFACE_PAYLOAD);
+	rc = TRUE;
+fail:
+	if (reused)
+		Stream_Release(reused);
+	if (s)
+		Stream_Release(s);
+	test_context_free(context);
+	return rc;
+}
+
+static BOOL test_surface_bits_reference(void)
+{
+	BYTE referenced[TEST_SURFACE_PAYLOAD] = { 0 };
+	BYTE copied[TEST_SURFACE_PAYLOAD] = { 0 };
+
+	if (!test_surface_bits_path(FALSE, referenced))
+	{
+		printf("referenced surface bits path failed\n");
+		return FALSE;
+	}
+
+	if (!test_surface_bits_path(TRUE, copied))
+	{
+		printf("copied surface bits path failed\n");
+		return FALSE;
+	}
+
+	for (size_t x = 0; x < TEST_SURFACE_PAYLOAD; x++)
+	{
+		if ((referenced[x] != (BYTE)(x * 7 + 3)) || (copied[x] != referenced[x]))
+		{
+			printf("surface bits payload mismatch at %" PRIuz "\n", x);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static BOOL test_opaque_rect_equal(const OPAQUE_RECT_ORDER* order, INT32 left, INT32 top,
+                                   INT32 width, INT32 height, UINT32 color)
+{
+	return (order->nLeftRect == left) && (order->nTopRect == top) && (order->nWidth == width) &&
+	       (order->nHeight == height) && (order->color == color);
+}
+
+static BOOL test_coalesce_opaque_rect(void)
+{
+	BOOL rc = FALSE;
+	const OPAQUE_RECT_ORDER orders[] = {
+		{ 0, 0, 10, 10, 0xFF0000 },  /* queued */
+		{ 0, 10, 10, 10, 0xFF0000 }, /* same color below, merged into one rectangle */
+		{ 5, 5, 2, 2, 0x0000FF },    /* other color, queued */
+		{ 0, 0, 20, 20, 0x00FF00 },  /* paints over the previous one, replaces it */
+		{ 30, 30, 4, 4, 0x00FF00 },  /* same color, the union is no rectangle, queued */
+	};
+	rdpContext* context = test_context_new();
+
+	if (!context || !test_context_hold(context))
+		goto fail;
+
+	for (size_t x = 0; x < ARRAYSIZE(orders); x++)
+	{
+		if (!context->update->primary->OpaqueRect(context, &orders[x]))
+			goto fail;
+	}
+
+	test_context_drain(context);
+
+	if ((test_state.opaqueRects != 3) || (context->metrics->UpdateQueueCoalesced != 2))
+		goto fail;
+	if (!test_opaque_rect_equal(&test_state.opaqueRect[0], 0, 0, 10, 20, 0xFF0000) ||
+	    !test_opaque_rect_equal(&test_state.opaqueRect[1], 0, 0, 20, 20, 0x00FF00) ||
+	    !test_opaque_rect_equal(&test_state.opaqueRect[2], 30, 30, 4, 4, 0x00FF00))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	test_context_free(context);
+	return rc;
+}
+
+static BOOL test_coalesce_refresh_rect(void)
+{
+	BOOL rc = FALSE;
+	const RECTANGLE_16 first[] = { { 0, 0, 10, 10 } };
+	const RECTANGLE_16 second[] = { { 2, 2, 5, 5 }, { 20, 20, 30, 30 } };
+	const RECTANGLE_16 third[] = { { 20, 20, 30, 30 } };
+	rdpContext* context = test_context_new();
+
+	if (!context || !test_context_hold(context))
+		goto fail;
+
+	/* the second request adds one missing area, the third one is already covered */
+	if (!context->update->RefreshRect(context, ARRAYSIZE(first), first) ||
+	    !context->update->RefreshRect(context, ARRAYSIZE(second), second) ||
+	    !context->update->RefreshRect(context, ARRAYSIZE(third), third))
+		goto fail;
+
+	test_context_drain(context);
+
+	if ((test_state.refreshRects != 1) || (test_state.refreshAreas != 2) ||
+	    (context->metrics->UpdateQueueCoalesced != 2))
+		goto fail;
+	if (!rectangles_equal(&test_state.refreshArea[0], &first[0]) ||
+	    !rectangles_equal(&test_state.refreshArea[1], &second[1]))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	test_context_free(context);
+	return rc;
+}
+
+static BOOL test_post_surface_bits(rdpContext* context, BYTE* data, UINT16 size)
+{
+	SURFACE_BITS_COMMAND cmd = { 0 };
+
+	cmd.cmdType = CMDTYPE_SET_SURFACE_BITS;
+	cmd.destRight = size;
+	cmd.destBottom = size;
+	cmd.bmp.bpp = 32;
+	cmd.bmp.codecID = RDP_CODEC_ID_NONE;
+	cmd.bmp.width = size;
+	cmd.bmp.height = size;
+	cmd.bmp.bitmapDataLength = 4ul * size * size;
+	cmd.bmp.bitmapData = data;
+	return context->update->SurfaceBits(context, &cmd);
+}
+
+static BOOL test_drop_stale_damage(void)
+{
+	BOOL rc = FALSE;
+	wStream* s = NULL;
+	const OPAQUE_RECT_ORDER order = { 0, 0, 10, 10, 0xFF0000 };
+	rdpContext* context = test_context_new();
+
+	if (!context || !test_context_hold(context))
+		goto fail;
+
+	/* all payloads reference the same received stream, every queued message holds a reference */
+	s = transport_take_from_pool(context->rdp->transport, TEST_DESKTOP_PAYLOAD);
+	if (!s)
+		goto fail;
+	memset(Stream_Buffer(s), 0x42, TEST_DESKTOP_PAYLOAD);
+	test_state.begin = Stream_Buffer(s);
+	test_state.end = Stream_Buffer(s) + TEST_DESKTOP_PAYLOAD;
+
+	/* the opaque rectangle might be read by something else, damage before it must be kept */
+	if (!test_post_surface_bits(context, Stream_Buffer(s), TEST_SURFACE_SIZE) ||
+	    !context->update->primary->OpaqueRect(context, &order) ||
+	    !test_post_surface_bits(context, Stream_Buffer(s), TEST_SURFACE_SIZE) ||
+	    !test_post_surface_bits(context, Stream_Buffer(s), TEST_SURFACE_SIZE))
+		goto fail;
+	if (s->count != 4)
+		goto fail;
+
+	/* the full surface update drops the two damages after the opaque rectangle */
+	if (!test_post_surface_bits(context, Stream_Buffer(s), TEST_DESKTOP_SIZE))
+		goto fail;
+	if ((s->count != 3) || (context->metrics->UpdateQueueDropped != 2))
+		goto fail;
+
+	test_context_drain(context);
+
+	/* every reference taken for a queued message was returned */
+	if (s->count != 1)
+		goto fail;
+	if ((test_state.surfaceBits != 2) || (test_state.referenced != 2) ||
+	    (test_state.opaqueRects != 1) || (test_state.payloadLength != TEST_DESKTOP_PAYLOAD))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	if (s)
+		Stream_Release(s);
+	test_context_free(context);
+	return rc;
+}
+
+static BOOL test_coalesce_pointer(void)
+{
+	BOOL rc = FALSE;
+	const POINTER_POSITION_UPDATE positions[] = { { 1, 1 }, { 2, 2 }, { 3, 3 } };
+	const POINTER_SYSTEM_UPDATE systems[] = { { SYSPTR_DEFAULT }, { SYSPTR_NULL } };
+	rdpContext* context = test_context_new();
+
+	if (!context || !test_context_hold(context))
+		goto fail;
+
+	/* positions and system pointers are independent, each replaces its own older update */
+	rdpPointerUpdate* pointer = context->update->pointer;
+	if (!pointer->PointerPosition(context, &positions[0]) ||
+	    !pointer->PointerSystem(context, &systems[0]) ||
+	    !pointer->PointerPosition(context, &positions[1]) ||
+	    !pointer->PointerSystem(context, &systems[1]) ||
+	    !pointer->PointerPosition(context, &positions[2]))
+		goto fail;
+
+	test_context_drain(context);
+
+	if ((test_state.pointerPositions != 1) || (test_state.pointerSystems != 1) ||
+	    (context->metrics->UpdateQueueCoalesced != 3))
+		goto fail;
+	if ((test_state.pointerPosition.xPos != 3) || (test_state.pointerPosition.yPos != 3) ||
+	    (test_state.pointerSystem.type != SYSPTR_NULL))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	test_context_free(context);
+	return rc;
+}
+
+int TestUpdateMessage(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_surface_bits_reference())
+	{
+		printf("test_surface_bits_reference failed\n");
+		return -1;
+	}
+
+	if (!test_coalesce_opaque_rect())
+	{
+		printf("test_coalesce_opaque_rect failed\n");
+		return -1;
+	}
+
+	if (!test_coalesce_refresh_rect())
+	{
+		printf("test_coalesce_refresh_rect failed\n");
+		return -1;
+	}
+
+	if (!test_drop_stale_damage())
+	{
+		printf("test_drop_stale_damage failed\n");
+		return -1;
+	}
+
+	if (!test_coalesce_pointer())
+	{
+		printf("test_coalesce_pointer failed\n");
+		return -1;
+	}
+
+	return 0;
+}
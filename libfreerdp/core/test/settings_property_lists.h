@@ -184,6 +184,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_SynchronousStaticChannels,
 	FreeRDP_TcpKeepAlive,
 	FreeRDP_TlsSecurity,
+	FreeRDP_TlsSessionResumption,
 	FreeRDP_ToggleFullscreen,
 	FreeRDP_TransportDump,
 	FreeRDP_TransportDumpReplay,
@@ -251,6 +252,7 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_DeviceScaleFactor,
 	FreeRDP_DrawNineGridCacheEntries,
 	FreeRDP_DrawNineGridCacheSize,
+	FreeRDP_DriveDirectoryBatchSize,
 	FreeRDP_DynamicChannelArraySize,
 	FreeRDP_DynamicChannelCount,
 	FreeRDP_EarlyCapabilityFlags,
@@ -267,6 +269,7 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_GatewayUsageMethod,
 	FreeRDP_GfxCapsFilter,
 	FreeRDP_GlyphSupportLevel,
+	FreeRDP_InputBatchLatency,
 	FreeRDP_JpegCodecId,
 	FreeRDP_JpegQuality,
 	FreeRDP_KeySpec,
@@ -1893,6 +1893,20 @@ wStream* transport_take_from_pool(rdpTransport* transport, size_t size)
 	return StreamPool_Take(transport->ReceivePool, size);
 }
 
+wStream* transport_ref_received(rdpTransport* transport, const BYTE* ptr)
+{
+	WINPR_ASSERT(transport);
+
+	if (!ptr)
+		return NULL;
+
+	/* the stream is still referenced by the caller processing it, no race with the lookup */
+	wStream* s = StreamPool_Find(transport->ReceivePool, ptr);
+	if (s)
+		Stream_AddRef(s);
+	return s;
+}
+
 UINT64 transport_get_bytes_sent(rdpTransport* transport, BOOL resetCount)
 {
 	UINT64 rc = 0;
@@ -147,6 +147,16 @@ WINPR_ATTR_MALLOC(Stream_Release, 1)
 WINPR_ATTR_NODISCARD
 FREERDP_LOCAL wStream* transport_take_from_pool(rdpTransport* transport, size_t size);
 
+/** @brief Get a reference to the received stream holding \b ptr
+ *
+ *  Allows keeping received data alive (e.g. for asynchronous processing) without copying it.
+ *
+ *  @return A stream with an additional reference or \b NULL if \b ptr is not pool memory.
+ */
+WINPR_ATTR_MALLOC(Stream_Release, 1)
+WINPR_ATTR_NODISCARD
+FREERDP_LOCAL wStream* transport_ref_received(rdpTransport* transport, const BYTE* ptr);
+
 FREERDP_LOCAL UINT64 transport_get_bytes_sent(rdpTransport* transport, BOOL resetCount);
 
 FREERDP_LOCAL BOOL transport_have_more_bytes_to_read(rdpTransport* transport);
@@ -137,12 +137,8 @@ static BOOL update_read_bitmap_data(rdpUpdate* update, wStream* s, BITMAP_DATA*
 
 	if (bitmapData->bitmapLength > 0)
 	{
-		bitmapData->bitmapDataStream = malloc(bitmapData->bitmapLength);
-
-		if (!bitmapData->bitmapDataStream)
-			return FALSE;
-
-		memcpy(bitmapData->bitmapDataStream, Stream_ConstPointer(s), bitmapData->bitmapLength);
+		/* the payload is only read during the BitmapUpdate callback, reference the PDU */
+		bitmapData->bitmapDataStream = Stream_Pointer(s);
 		Stream_Seek(s, bitmapData->bitmapLength);
 	}
 
@@ -231,37 +227,32 @@ static BOOL update_write_bitmap_data(rdpUpdate* update_pub, wStream* s, BITMAP_D
 
 BITMAP_UPDATE* update_read_bitmap_update(rdpUpdate* update, wStream* s)
 {
-	BITMAP_UPDATE* bitmapUpdate = calloc(1, sizeof(BITMAP_UPDATE));
 	rdp_update_internal* up = update_cast(update);
+	BITMAP_UPDATE* bitmapUpdate = arena_calloc(up->arena, 1, sizeof(BITMAP_UPDATE));
 
 	if (!bitmapUpdate)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
-		goto fail;
+		return NULL;
 
 	Stream_Read_UINT16(s, bitmapUpdate->number); /* numberRectangles (2 bytes) */
 	WLog_Print(up->log, WLOG_TRACE, "BitmapUpdate: %" PRIu32 "", bitmapUpdate->number);
 
-	bitmapUpdate->rectangles = (BITMAP_DATA*)calloc(bitmapUpdate->number, sizeof(BITMAP_DATA));
+	bitmapUpdate->rectangles =
+	    (BITMAP_DATA*)arena_calloc(up->arena, bitmapUpdate->number, sizeof(BITMAP_DATA));
 
 	if (!bitmapUpdate->rectangles)
-		goto fail;
+		return NULL;
 
 	/* rectangles */
 	for (UINT32 i = 0; i < bitmapUpdate->number; i++)
 	{
 		if (!update_read_bitmap_data(update, s, &bitmapUpdate->rectangles[i]))
-			goto fail;
+			return NULL;
 	}
 
 	return bitmapUpdate;
-fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_bitmap_update(update->context, bitmapUpdate);
-	WINPR_PRAGMA_DIAG_POP
-	return NULL;
 }
 
 static BOOL update_write_bitmap_update(rdpUpdate* update, wStream* s,
@@ -871,7 +862,6 @@ BOOL update_recv(rdpUpdate* update, wStream* s)
 			}
 
 			rc = IFCALLRESULT(FALSE, update->BitmapUpdate, context, bitmap_update);
-			free_bitmap_update(context, bitmap_update);
 		}
 		break;
 
@@ -3386,6 +3376,11 @@ rdpUpdate* update_new(rdpRdp* rdp)
 	if (!update->queue)
 		goto fail;
 
+	update->arena = arena_new(UPDATE_ARENA_BLOCK_SIZE);
+
+	if (!update->arena)
+		goto fail;
+
 	return &update->common;
 fail:
 	WINPR_PRAGMA_DIAG_PUSH
@@ -3430,6 +3425,17 @@ void update_free(rdpUpdate* update)
 
 		if (up->us)
 			Stream_Free(up->us, TRUE);
+
+		if (up->arena)
+		{
+			rdpArenaStats stats = { 0 };
+			arena_get_stats(up->arena, &stats);
+			WLog_Print(up->log, WLOG_DEBUG,
+			           "update arena: %" PRIuz " allocations, %" PRIuz " heap allocations, %" PRIuz
+			           " resets",
+			           stats.allocations, stats.heapAllocations, stats.resets);
+			arena_free(up->arena);
+		}
 		free(update);
 	}
 }
@@ -3454,6 +3460,9 @@ BOOL update_begin_paint(rdpUpdate* update)
 
 	up->withinBeginEndPaint = TRUE;
 
+	/* nothing parsed for the previous PDU is referenced past its EndPaint */
+	arena_reset(up->arena);
+
 	WINPR_ASSERT(update->context);
 
 	BOOL rc = IFCALLRESULT(TRUE, update->BeginPaint, update->context);
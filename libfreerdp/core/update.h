@@ -22,6 +22,7 @@
 
 #include "rdp.h"
 #include "orders.h"
+#include "arena.h"
 
 #include <freerdp/types.h>
 #include <freerdp/update.h>
@@ -42,6 +43,9 @@
 #define BITMAP_COMPRESSION 0x0001
 #define NO_BITMAP_COMPRESSION_HDR 0x0400
 
+/* enough for the bitmap updates and cache orders of a typical PDU without a second block */
+#define UPDATE_ARENA_BLOCK_SIZE (64 * 1024)
+
 typedef struct
 {
 	rdpUpdate common;
@@ -65,6 +69,7 @@ typedef struct
 	rdpBounds previousBounds;
 	CRITICAL_SECTION mux;
 	BOOL withinBeginEndPaint;
+	rdpArena* arena; /* parsed updates and orders, reset when the next paint begins */
 } rdp_update_internal;
 
 typedef struct
@@ -186,7 +191,10 @@ FREERDP_LOCAL BOOL update_recv_play_sound(rdpUpdate* update, wStream* s);
 FREERDP_LOCAL BOOL update_recv_pointer(rdpUpdate* update, wStream* s);
 FREERDP_LOCAL BOOL update_recv(rdpUpdate* update, wStream* s);
 
-WINPR_ATTR_MALLOC(free_bitmap_update, 2)
+/** @brief parses a bitmap update into the update arena.
+ *
+ *  The result and its rectangles must not be freed, the bitmap data references s. Both stay
+ *  valid until the next update_begin_paint. */
 WINPR_ATTR_NODISCARD
 FREERDP_LOCAL BITMAP_UPDATE* update_read_bitmap_update(rdpUpdate* update, wStream* s);
 
@@ -1752,6 +1752,20 @@ X509* freerdp_certificate_get_x509(rdpCertificate* cert)
 	return cert->x509;
 }
 
+BOOL freerdp_certificate_is_key_match(const rdpCertificate* cert, const rdpPrivateKey* key)
+{
+	if (!cert || !cert->x509 || !key)
+		return FALSE;
+
+	EVP_PKEY* evp = freerdp_key_get_evp_pkey(key);
+	if (!evp)
+		return FALSE;
+
+	const BOOL rc = X509_check_private_key(cert->x509, evp) == 1;
+	EVP_PKEY_free(evp);
+	return rc;
+}
+
 BOOL freerdp_certificate_publickey_encrypt(const rdpCertificate* cert, const BYTE* input,
                                            size_t cbInput, BYTE** poutput, size_t* pcbOutput)
 {
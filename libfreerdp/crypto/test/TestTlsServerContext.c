@@ -0,0 +1,321 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/listener.h>
+#include <freerdp/settings.h>
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include "../tls.h"
+#include "../certificate.h"
+#include "../privatekey.h"
+#include "../../test/test_performance.h"
+
+#define TEST_ACCEPT_COUNT 64
+#define TEST_BENCH_ACCEPTS 200
+
+static rdpCertificate* create_certificate(const rdpPrivateKey* key)
+{
+	rdpCertificate* cert = NULL;
+	EVP_PKEY* evp = freerdp_key_get_evp_pkey(key);
+	X509* x509 = X509_new();
+	if (!evp || !x509)
+		goto fail;
+
+	X509_NAME* name = X509_get_subject_name(x509);
+	if ((X509_set_version(x509, 2) != 1) ||
+	    (ASN1_INTEGER_set(X509_get_serialNumber(x509), 1) != 1) ||
+	    !X509_gmtime_adj(X509_getm_notBefore(x509), 0) ||
+	    !X509_gmtime_adj(X509_getm_notAfter(x509), 60 * 60) ||
+	    (X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"testhost",
+	                                -1, -1, 0) != 1) ||
+	    (X509_set_issuer_name(x509, name) != 1) || (X509_set_pubkey(x509, evp) != 1) ||
+	    (X509_sign(x509, evp, EVP_sha256()) == 0))
+		goto fail;
+
+	cert = freerdp_certificate_new_from_x509(x509, NULL);
+fail:
+	X509_free(x509);
+	EVP_PKEY_free(evp);
+	return cert;
+}
+
+static BOOL set_credentials(rdpSettings* settings)
+{
+	rdpPrivateKey* key = freerdp_key_new();
+	if (!key)
+		return FALSE;
+
+	if (!freerdp_key_generate(key, "RSA", 1, (size_t)2048))
+	{
+		freerdp_key_free(key);
+		return FALSE;
+	}
+
+	rdpCertificate* cert = create_certificate(key);
+	if (!cert || !freerdp_certificate_is_key_match(cert, key))
+	{
+		freerdp_certificate_free(cert);
+		freerdp_key_free(key);
+		return FALSE;
+	}
+
+	if (!freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerRsaKey, key, 1))
+	{
+		freerdp_certificate_free(cert);
+		return FALSE;
+	}
+	return freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerCertificate, cert, 1);
+}
+
+/* start a server handshake, the peer never answers so it stops waiting for the ClientHello */
+static rdpTls* start_accept(rdpContext* context)
+{
+	BIO* cbio = NULL;
+	BIO* sbio = NULL;
+
+	rdpTls* tls = freerdp_tls_new(context);
+	if (!tls)
+		return NULL;
+
+	if (BIO_new_bio_pair(&cbio, 0, &sbio, 0) != 1)
+		goto fail;
+
+	if (freerdp_tls_accept_ex(tls, sbio, context->settings, TLS_server_method()) !=
+	    TLS_HANDSHAKE_CONTINUE)
+		goto fail;
+
+	BIO_free(cbio);
+	return tls;
+
+fail:
+	freerdp_tls_free(tls);
+	BIO_free(cbio);
+	return NULL;
+}
+
+/* a complete handshake with an OpenSSL client on the other end of a BIO pair */
+static BOOL full_accept(rdpContext* context, SSL_CTX* cctx)
+{
+	BOOL rc = FALSE;
+	BIO* cbio = NULL;
+	BIO* sbio = NULL;
+	SSL* cssl = NULL;
+
+	rdpTls* tls = freerdp_tls_new(context);
+	if (!tls)
+		return FALSE;
+
+	if (BIO_new_bio_pair(&cbio, 0, &sbio, 0) != 1)
+		goto fail;
+
+	cssl = SSL_new(cctx);
+	if (!cssl)
+		goto fail;
+	SSL_set_bio(cssl, cbio, cbio);
+	cbio = NULL;
+	SSL_set_connect_state(cssl);
+
+	if ((SSL_do_handshake(cssl) != -1) ||
+	    (SSL_get_error(cssl, -1) != SSL_ERROR_WANT_READ))
+		goto fail;
+
+	TlsHandshakeResult res =
+	    freerdp_tls_accept_ex(tls, sbio, context->settings, TLS_server_method());
+	sbio = NULL;
+
+	for (size_t x = 0; (x < 8) && (res == TLS_HANDSHAKE_CONTINUE); x++)
+	{
+		const int status = SSL_do_handshake(cssl);
+		if ((status != 1) && (SSL_get_error(cssl, status) != SSL_ERROR_WANT_READ))
+			goto fail;
+		res = freerdp_tls_handshake(tls);
+	}
+
+	rc = (res == TLS_HANDSHAKE_SUCCESS) && (SSL_do_handshake(cssl) == 1);
+fail:
+	SSL_free(cssl);
+	BIO_free(cbio);
+	BIO_free(sbio);
+	freerdp_tls_free(tls);
+	return rc;
+}
+
+static BOOL test_shared_context(rdpContext* context, freerdp_listener* listener)
+{
+	BOOL rc = FALSE;
+	rdpTls* tls[TEST_ACCEPT_COUNT] = { 0 };
+	rdpTls* other = NULL;
+	freerdp_peer peer = { 0 };
+
+	context->peer = &peer;
+	if (!freerdp_listener_attach_tls(listener, &peer) || !peer.TlsServerContext)
+		goto fail;
+
+	for (size_t x = 0; x < ARRAYSIZE(tls); x++)
+	{
+		tls[x] = start_accept(context);
+		if (!tls[x])
+		{
+			(void)fprintf(stderr, "accept %" PRIuz " failed\n", x);
+			goto fail;
+		}
+
+		/* all peers of the listener share its context */
+		if (tls[x]->ctx != tls[0]->ctx)
+		{
+			(void)fprintf(stderr, "accept %" PRIuz " did not use the shared SSL_CTX\n", x);
+			goto fail;
+		}
+	}
+
+	/* a peer configured with other credentials does not get the listener certificate */
+	if (!set_credentials(context->settings))
+		goto fail;
+	other = start_accept(context);
+	if (!other || (other->ctx == tls[0]->ctx))
+	{
+		(void)fprintf(stderr, "changed credentials used the shared SSL_CTX\n");
+		goto fail;
+	}
+	freerdp_tls_free(other);
+	other = NULL;
+
+	/* replaced on the listener (reloaded certificate), running peers keep the old one */
+	if (!freerdp_listener_set_tls_settings(listener, context->settings) ||
+	    !freerdp_listener_attach_tls(listener, &peer))
+		goto fail;
+	other = start_accept(context);
+	if (!other || (other->ctx == tls[0]->ctx) ||
+	    (SSL_get_SSL_CTX(tls[0]->ssl) != tls[0]->ctx))
+	{
+		(void)fprintf(stderr, "replaced listener context not used\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	for (size_t x = 0; x < ARRAYSIZE(tls); x++)
+		freerdp_tls_free(tls[x]);
+	freerdp_tls_free(other);
+	freerdp_tls_server_context_release(peer.TlsServerContext);
+	context->peer = NULL;
+	return rc;
+}
+
+static BOOL test_private_context(rdpContext* context)
+{
+	BOOL rc = FALSE;
+	rdpTls* first = start_accept(context);
+	rdpTls* second = start_accept(context);
+
+	/* without a listener context every peer sets up its own */
+	if (first && second && (first->ctx != second->ctx))
+		rc = TRUE;
+	else
+		(void)fprintf(stderr, "peers without a listener context share one\n");
+
+	freerdp_tls_free(first);
+	freerdp_tls_free(second);
+	return rc;
+}
+
+static BOOL run_accepts(rdpContext* context, SSL_CTX* cctx, size_t count, double* rate)
+{
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < count; x++)
+	{
+		if (!full_accept(context, cctx))
+		{
+			(void)fprintf(stderr, "handshake %" PRIuz " failed\n", x);
+			return FALSE;
+		}
+	}
+	const UINT64 diff = winpr_GetTickCount64NS() - start;
+	*rate = (1000000000.0 * (double)count) / (double)(diff ? diff : 1);
+	return TRUE;
+}
+
+static BOOL test_full_accepts(rdpContext* context, freerdp_listener* listener, size_t count)
+{
+	BOOL rc = FALSE;
+	freerdp_peer peer = { 0 };
+	double shared = 0.0;
+	double private = 0.0;
+
+	SSL_CTX* cctx = SSL_CTX_new(TLS_client_method());
+	if (!cctx)
+		return FALSE;
+
+	if (!freerdp_listener_attach_tls(listener, &peer))
+		goto fail;
+
+	context->peer = &peer;
+	if (!run_accepts(context, cctx, count, &shared))
+		goto fail;
+
+	context->peer = NULL;
+	if (!run_accepts(context, cctx, count, &private))
+		goto fail;
+
+	printf("%" PRIuz " full handshakes: %.0f accepts/s with the listener context, %.0f accepts/s "
+	       "with a context per peer\n",
+	       count, shared, private);
+	rc = TRUE;
+fail:
+	context->peer = NULL;
+	freerdp_tls_server_context_release(peer.TlsServerContext);
+	SSL_CTX_free(cctx);
+	return rc;
+}
+
+int TestTlsServerContext(int argc, char* argv[])
+{
+	int rc = -1;
+	rdpContext context = { 0 };
+	freerdp_listener* listener = freerdp_listener_new();
+
+	test_performance_setup(argc, argv);
+
+	context.settings = freerdp_settings_new(FREERDP_SETTINGS_SERVER_MODE);
+	if (!listener || !context.settings || !set_credentials(context.settings))
+		goto fail;
+
+	if (!freerdp_listener_set_tls_settings(listener, context.settings))
+		goto fail;
+
+	if (!test_shared_context(&context, listener))
+		goto fail;
+
+	if (!test_private_context(&context))
+		goto fail;
+
+	if (!test_full_accepts(&context, listener, g_TestPerformance ? TEST_BENCH_ACCEPTS : 1))
+		goto fail;
+
+	rc = 0;
+fail:
+	freerdp_listener_free(listener);
+	freerdp_settings_free(context.settings);
+	return rc;
+}
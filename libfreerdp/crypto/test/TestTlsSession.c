@@ -0,0 +1,280 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include "../tls_session.h"
+
+#define TEST_SESSION_KEY "testhost:3389"
+
+static EVP_PKEY* test_key = NULL;
+static X509* test_cert = NULL;
+
+static BOOL create_credentials(void)
+{
+	EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+	if (!pctx)
+		return FALSE;
+
+	BOOL rc = FALSE;
+	if ((EVP_PKEY_keygen_init(pctx) != 1) ||
+	    (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) != 1) ||
+	    (EVP_PKEY_keygen(pctx, &test_key) != 1))
+		goto fail;
+
+	test_cert = X509_new();
+	if (!test_cert)
+		goto fail;
+
+	X509_NAME* name = X509_get_subject_name(test_cert);
+	if ((X509_set_version(test_cert, 2) != 1) ||
+	    (ASN1_INTEGER_set(X509_get_serialNumber(test_cert), 1) != 1) ||
+	    !X509_gmtime_adj(X509_getm_notBefore(test_cert), 0) ||
+	    !X509_gmtime_adj(X509_getm_notAfter(test_cert), 60 * 60) ||
+	    (X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"testhost",
+	                                -1, -1, 0) != 1) ||
+	    (X509_set_issuer_name(test_cert, name) != 1) ||
+	    (X509_set_pubkey(test_cert, test_key) != 1) ||
+	    (X509_sign(test_cert, test_key, EVP_sha256()) == 0))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	EVP_PKEY_CTX_free(pctx);
+	return rc;
+}
+
+static SSL_CTX* create_server_ctx(BOOL resumption)
+{
+	SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+	if (!ctx)
+		return NULL;
+
+	if ((SSL_CTX_use_certificate(ctx, test_cert) != 1) ||
+	    (SSL_CTX_use_PrivateKey(ctx, test_key) != 1))
+		goto fail;
+
+	if (!resumption)
+		freerdp_tls_session_resumption_disable(ctx);
+	else if (!freerdp_tls_ticket_keys_enable(ctx))
+		goto fail;
+	return ctx;
+
+fail:
+	SSL_CTX_free(ctx);
+	return NULL;
+}
+
+static SSL_CTX* create_client_ctx(void)
+{
+	SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+	if (!ctx)
+		return NULL;
+
+	if (!freerdp_tls_session_cache_enable(ctx))
+	{
+		SSL_CTX_free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+static BOOL pump(SSL* client, SSL* server)
+{
+	BOOL clientDone = FALSE;
+	BOOL serverDone = FALSE;
+
+	for (size_t x = 0; (x < 32) && (!clientDone || !serverDone); x++)
+	{
+		if (!clientDone)
+		{
+			const int rc = SSL_do_handshake(client);
+			if (rc == 1)
+				clientDone = TRUE;
+			else if (SSL_get_error(client, rc) != SSL_ERROR_WANT_READ)
+				return FALSE;
+		}
+		if (!serverDone)
+		{
+			const int rc = SSL_do_handshake(server);
+			if (rc == 1)
+				serverDone = TRUE;
+			else if (SSL_get_error(server, rc) != SSL_ERROR_WANT_READ)
+				return FALSE;
+		}
+	}
+
+	if (!clientDone || !serverDone)
+		return FALSE;
+
+	/* TLS 1.3 tickets are sent after the handshake, deliver them with some data */
+	const char data = 'x';
+	char buffer = 0;
+	if (SSL_write(server, &data, sizeof(data)) != sizeof(data))
+		return FALSE;
+	if (SSL_read(client, &buffer, sizeof(buffer)) != sizeof(buffer))
+		return FALSE;
+	return buffer == data;
+}
+
+/* returns -1 on error, 0 for a full and 1 for a resumed handshake */
+static int test_connect(SSL_CTX* sctx, BOOL expectOffer)
+{
+	int rc = -1;
+	SSL* client = NULL;
+	SSL* server = NULL;
+	BIO* cbio = NULL;
+	BIO* sbio = NULL;
+
+	/* a new client context for every connection, just like rdpTls does. The server
+	 * context is shared like the one of a listener. */
+	SSL_CTX* cctx = create_client_ctx();
+	if (!cctx)
+		goto fail;
+
+	client = SSL_new(cctx);
+	server = SSL_new(sctx);
+	if (!client || !server)
+		goto fail;
+
+	if (BIO_new_bio_pair(&cbio, 0, &sbio, 0) != 1)
+		goto fail;
+	SSL_set_bio(client, cbio, cbio);
+	SSL_set_bio(server, sbio, sbio);
+	SSL_set_connect_state(client);
+	SSL_set_accept_state(server);
+
+	if (freerdp_tls_session_cache_attach(client, TEST_SESSION_KEY) != expectOffer)
+	{
+		(void)fprintf(stderr, "unexpected session offer state, expected %d\n", expectOffer);
+		goto fail;
+	}
+
+	if (!pump(client, server))
+	{
+		(void)fprintf(stderr, "TLS handshake failed\n");
+		goto fail;
+	}
+
+	const BOOL creused = SSL_session_reused(client) == 1;
+	const BOOL sreused = SSL_session_reused(server) == 1;
+	if (creused != sreused)
+		goto fail;
+	rc = creused ? 1 : 0;
+
+	/* sessions of connections that were not shut down are not resumable */
+	(void)SSL_shutdown(client);
+	(void)SSL_shutdown(server);
+
+fail:
+	SSL_free(client);
+	SSL_free(server);
+	SSL_CTX_free(cctx);
+	return rc;
+}
+
+int TestTlsSession(int argc, char* argv[])
+{
+	int rc = -1;
+	SSL_CTX* sctx = NULL;
+	SSL_CTX* other = NULL;
+	SSL_CTX* disabled = NULL;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!create_credentials())
+		goto fail;
+
+	sctx = create_server_ctx(TRUE);
+	other = create_server_ctx(TRUE);
+	disabled = create_server_ctx(FALSE);
+	if (!sctx || !other || !disabled)
+		goto fail;
+
+	freerdp_tls_session_cache_clear();
+
+	/* first connection: nothing cached, full handshake */
+	if (test_connect(sctx, FALSE) != 0)
+	{
+		(void)fprintf(stderr, "first connection was not a full handshake\n");
+		goto fail;
+	}
+	if (freerdp_tls_session_cache_count() != 1)
+	{
+		(void)fprintf(stderr, "session was not cached\n");
+		goto fail;
+	}
+
+	/* second connection: resumed with the ticket of the first one */
+	if (test_connect(sctx, TRUE) != 1)
+	{
+		(void)fprintf(stderr, "second connection was not resumed\n");
+		goto fail;
+	}
+
+	/* another server context has its own ticket keys */
+	if (test_connect(other, TRUE) != 0)
+	{
+		(void)fprintf(stderr, "ticket of another server context was accepted\n");
+		goto fail;
+	}
+
+	/* that connection cached a ticket of the other context, get one of sctx again */
+	if (test_connect(sctx, TRUE) != 0)
+		goto fail;
+
+	/* after two rotations the ticket key is unknown, fall back to a full handshake */
+	if (!freerdp_tls_ticket_keys_rotate(sctx) || !freerdp_tls_ticket_keys_rotate(sctx))
+		goto fail;
+	if (test_connect(sctx, TRUE) != 0)
+	{
+		(void)fprintf(stderr, "connection with expired ticket key was resumed\n");
+		goto fail;
+	}
+
+	/* a single rotation keeps the previous key valid */
+	if (!freerdp_tls_ticket_keys_rotate(sctx))
+		goto fail;
+	if (test_connect(sctx, TRUE) != 1)
+	{
+		(void)fprintf(stderr, "connection with previous ticket key was not resumed\n");
+		goto fail;
+	}
+
+	/* a server with resumption disabled neither resumes nor issues new tickets */
+	freerdp_tls_session_cache_clear();
+	if ((test_connect(disabled, FALSE) != 0) || (freerdp_tls_session_cache_count() != 0))
+	{
+		(void)fprintf(stderr, "server with resumption disabled issued a session\n");
+		goto fail;
+	}
+	if (freerdp_tls_ticket_keys_rotate(disabled))
+		goto fail;
+
+	rc = 0;
+fail:
+	SSL_CTX_free(sctx);
+	SSL_CTX_free(other);
+	SSL_CTX_free(disabled);
+	X509_free(test_cert);
+	EVP_PKEY_free(test_key);
+	return rc;
+}
@@ -33,16 +33,20 @@
 #include <winpr/sspi.h>
 #include <winpr/ssl.h>
 #include <winpr/json.h>
+#include <winpr/interlocked.h>
 
 #include <winpr/stream.h>
 #include <freerdp/utils/ringbuffer.h>
 
+#include <freerdp/peer.h>
 #include <freerdp/crypto/certificate.h>
 #include <freerdp/crypto/certificate_data.h>
 #include <freerdp/utils/helpers.h>
 
 #include <freerdp/log.h>
+#include <freerdp/metrics.h>
 #include "../crypto/tls.h"
+#include "../crypto/tls_session.h"
 #include "../core/tcp.h"
 
 #include "opensslcompat.h"
@@ -709,6 +713,14 @@ out_free:
 	return NULL;
 }
 
+struct rdp_tls_server_context
+{
+	SSL_CTX* ctx;
+	const SSL_METHOD* method;
+	BOOL resumption;
+	volatile LONG refCount;
+};
+
 static INIT_ONCE secrets_file_idx_once = INIT_ONCE_STATIC_INIT;
 static int secrets_file_idx = -1;
 
@@ -765,59 +777,93 @@ static void tls_reset(rdpTls* tls)
 }
 
 #if OPENSSL_VERSION_NUMBER >= 0x010000000L
-static BOOL tls_prepare(rdpTls* tls, BIO* underlying, const SSL_METHOD* method, int options,
-                        BOOL clientMode)
+static SSL_CTX* tls_ctx_new(const rdpSettings* settings, const SSL_METHOD* method, int options,
+                            BOOL clientMode)
 #else
-static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int options,
-                        BOOL clientMode)
+static SSL_CTX* tls_ctx_new(const rdpSettings* settings, SSL_METHOD* method, int options,
+                            BOOL clientMode)
 #endif
 {
-	WINPR_ASSERT(tls);
-
-	rdpSettings* settings = tls->context->settings;
 	WINPR_ASSERT(settings);
 
-	tls_reset(tls);
-	tls->ctx = SSL_CTX_new(method);
-
-	tls->underlying = underlying;
+	SSL_CTX* ctx = SSL_CTX_new(method);
 
-	if (!tls->ctx)
+	if (!ctx)
 	{
 		WLog_ERR(TAG, "SSL_CTX_new failed");
-		return FALSE;
+		return NULL;
 	}
 
-	SSL_CTX_set_mode(tls->ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
-	SSL_CTX_set_options(tls->ctx, WINPR_ASSERTING_INT_CAST(uint64_t, options));
-	SSL_CTX_set_read_ahead(tls->ctx, 1);
+	SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+	SSL_CTX_set_options(ctx, WINPR_ASSERTING_INT_CAST(uint64_t, options));
+	SSL_CTX_set_read_ahead(ctx, 1);
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
 	UINT16 version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMinVersion);
-	if (!SSL_CTX_set_min_proto_version(tls->ctx, version))
+	if (!SSL_CTX_set_min_proto_version(ctx, version))
 	{
 		WLog_ERR(TAG, "SSL_CTX_set_min_proto_version %" PRIu16 " failed", version);
-		return FALSE;
+		goto fail;
 	}
 	version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMaxVersion);
-	if (!SSL_CTX_set_max_proto_version(tls->ctx, version))
+	if (!SSL_CTX_set_max_proto_version(ctx, version))
 	{
 		WLog_ERR(TAG, "SSL_CTX_set_max_proto_version %" PRIu16 " failed", version);
-		return FALSE;
+		goto fail;
 	}
 #endif
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(LIBRESSL_VERSION_NUMBER)
-	SSL_CTX_set_security_level(tls->ctx, WINPR_ASSERTING_INT_CAST(int, settings->TlsSecLevel));
+	SSL_CTX_set_security_level(ctx, WINPR_ASSERTING_INT_CAST(int, settings->TlsSecLevel));
 #endif
 
+	if (clientMode && freerdp_settings_get_bool(settings, FreeRDP_TlsSessionResumption))
+	{
+		if (!freerdp_tls_session_cache_enable(ctx))
+			WLog_WARN(TAG, "TLS session cache not available, resumption disabled");
+	}
+
 	if (settings->AllowedTlsCiphers)
 	{
-		if (!SSL_CTX_set_cipher_list(tls->ctx, settings->AllowedTlsCiphers))
+		if (!SSL_CTX_set_cipher_list(ctx, settings->AllowedTlsCiphers))
 		{
 			WLog_ERR(TAG, "SSL_CTX_set_cipher_list %s failed", settings->AllowedTlsCiphers);
-			return FALSE;
+			goto fail;
 		}
 	}
 
+	if (settings->TlsSecretsFile)
+	{
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+		/* the file name is attached to each SSL, see tls_prepare */
+		if (InitOnceExecuteOnce(&secrets_file_idx_once, secrets_file_init_cb, NULL, NULL))
+			SSL_CTX_set_keylog_callback(ctx, SSLCTX_keylog_cb);
+#else
+		WLog_WARN(TAG, "Key-Logging not available - requires OpenSSL 1.1.1 or higher");
+#endif
+	}
+
+	return ctx;
+
+fail:
+	SSL_CTX_free(ctx);
+	return NULL;
+}
+
+/* takes ownership of the reference to ctx */
+static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_CTX* ctx, BOOL clientMode)
+{
+	WINPR_ASSERT(tls);
+
+	rdpSettings* settings = tls->context->settings;
+	WINPR_ASSERT(settings);
+
+	tls_reset(tls);
+	tls->ctx = ctx;
+
+	tls->underlying = underlying;
+
+	if (!tls->ctx)
+		return FALSE;
+
 	tls->bio = BIO_new_rdp_tls(tls->ctx, clientMode);
 
 	if (BIO_get_ssl(tls->bio, &tls->ssl) < 0)
@@ -826,23 +872,212 @@ static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int op
 		return FALSE;
 	}
 
-	if (settings->TlsSecretsFile)
-	{
 #if OPENSSL_VERSION_NUMBER >= 0x10101000L
-		InitOnceExecuteOnce(&secrets_file_idx_once, secrets_file_init_cb, NULL, NULL);
+	/* the callback is installed with the context, see tls_ctx_new */
+	if (settings->TlsSecretsFile && (secrets_file_idx != -1))
+		SSL_set_ex_data(tls->ssl, secrets_file_idx, settings->TlsSecretsFile);
+#endif
+
+	BIO_push(tls->bio, underlying);
+	return TRUE;
+}
+
+static SSL_CTX* tls_server_ctx_new(const rdpSettings* settings, const SSL_METHOD* method,
+                                   int options, BOOL shared)
+{
+	WINPR_ASSERT(settings);
+
+	SSL_CTX* ctx = NULL;
+	const rdpPrivateKey* rkey = freerdp_settings_get_pointer(settings, FreeRDP_RdpServerRsaKey);
+	if (!rkey)
+	{
+		WLog_ERR(TAG, "invalid private key");
+		return NULL;
+	}
+
+	rdpCertificate* cert = settings->RdpServerCertificate;
+	if (!cert || !freerdp_certificate_get_x509(cert))
+	{
+		WLog_ERR(TAG, "invalid certificate");
+		return NULL;
+	}
+
+	EVP_PKEY* key = freerdp_key_get_evp_pkey(rkey);
+	if (!key)
+	{
+		WLog_ERR(TAG, "invalid private key");
+		return NULL;
+	}
+
+	ctx = tls_ctx_new(settings, method, options, FALSE);
+	if (!ctx)
+		goto fail;
+
+	if (SSL_CTX_use_PrivateKey(ctx, key) <= 0)
+	{
+		WLog_ERR(TAG, "SSL_CTX_use_PrivateKey_file failed");
+		goto fail;
+	}
+
+	if (SSL_CTX_use_certificate(ctx, freerdp_certificate_get_x509(cert)) <= 0)
+	{
+		WLog_ERR(TAG, "SSL_use_certificate_file failed");
+		goto fail;
+	}
 
-		if (secrets_file_idx != -1)
+	const size_t cnt = freerdp_certificate_get_chain_len(cert);
+	for (size_t x = 0; x < cnt; x++)
+	{
+		X509* xcert = freerdp_certificate_get_chain_at(cert, x);
+		WINPR_ASSERT(xcert);
+		const long rc = SSL_CTX_add1_chain_cert(ctx, xcert);
+		if (rc != 1)
 		{
-			SSL_set_ex_data(tls->ssl, secrets_file_idx, settings->TlsSecretsFile);
-			SSL_CTX_set_keylog_callback(tls->ctx, SSLCTX_keylog_cb);
+			WLog_ERR(TAG, "SSL_add1_chain_cert failed");
+			goto fail;
 		}
-#else
-		WLog_WARN(TAG, "Key-Logging not available - requires OpenSSL 1.1.1 or higher");
+	}
+
+	/* All connections accepted with this context share the session cache and ticket keys.
+	 * A private context is used for a single connection, nothing could be resumed with it. */
+	const BYTE sid_ctx[] = "FreeRDP";
+	if (SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx) - 1) != 1)
+		goto fail;
+
+	if (!shared || !freerdp_settings_get_bool(settings, FreeRDP_TlsSessionResumption))
+		freerdp_tls_session_resumption_disable(ctx);
+	else if (!freerdp_tls_ticket_keys_enable(ctx))
+	{
+		WLog_WARN(TAG, "TLS session ticket keys not available, resumption disabled");
+		freerdp_tls_session_resumption_disable(ctx);
+	}
+
+	EVP_PKEY_free(key);
+	return ctx;
+
+fail:
+	EVP_PKEY_free(key);
+	SSL_CTX_free(ctx);
+	return NULL;
+}
+
+static int tls_server_options(void)
+{
+	int options = 0;
+
+	/**
+	 * SSL_OP_NO_SSLv2:
+	 *
+	 * We only want SSLv3 and TLSv1, so disable SSLv2.
+	 * SSLv3 is used by, eg. Microsoft RDC for Mac OS X.
+	 */
+	options |= SSL_OP_NO_SSLv2;
+	/**
+	 * SSL_OP_NO_COMPRESSION:
+	 *
+	 * The Microsoft RDP server does not advertise support
+	 * for TLS compression, but alternative servers may support it.
+	 * This was observed between early versions of the FreeRDP server
+	 * and the FreeRDP client, and caused major performance issues,
+	 * which is why we're disabling it.
+	 */
+#ifdef SSL_OP_NO_COMPRESSION
+	options |= SSL_OP_NO_COMPRESSION;
+#endif
+	/**
+	 * SSL_OP_TLS_BLOCK_PADDING_BUG:
+	 *
+	 * The Microsoft RDP server does *not* support TLS padding.
+	 * It absolutely needs to be disabled otherwise it won't work.
+	 */
+	options |= SSL_OP_TLS_BLOCK_PADDING_BUG;
+	/**
+	 * SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS:
+	 *
+	 * Just like TLS padding, the Microsoft RDP server does not
+	 * support empty fragments. This needs to be disabled.
+	 */
+	options |= SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS;
+
+	/**
+	 * SSL_OP_NO_RENEGOTIATION
+	 *
+	 * Disable SSL client site renegotiation.
+	 */
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L) && (OPENSSL_VERSION_NUMBER < 0x30000000L) && \
+    !defined(LIBRESSL_VERSION_NUMBER)
+	options |= SSL_OP_NO_RENEGOTIATION;
 #endif
+
+	return options;
+}
+
+rdpTlsServerContext* freerdp_tls_server_context_new(const rdpSettings* settings)
+{
+	WINPR_ASSERT(settings);
+
+	rdpTlsServerContext* server = calloc(1, sizeof(rdpTlsServerContext));
+	if (!server)
+		return NULL;
+
+	server->method = freerdp_tls_get_ssl_method(FALSE, FALSE);
+	server->resumption = freerdp_settings_get_bool(settings, FreeRDP_TlsSessionResumption);
+	server->ctx = tls_server_ctx_new(settings, server->method, tls_server_options(), TRUE);
+	if (!server->ctx)
+	{
+		free(server);
+		return NULL;
 	}
 
-	BIO_push(tls->bio, underlying);
-	return TRUE;
+	server->refCount = 1;
+	return server;
+}
+
+rdpTlsServerContext* freerdp_tls_server_context_ref(rdpTlsServerContext* server)
+{
+	if (server)
+		InterlockedIncrement(&server->refCount);
+	return server;
+}
+
+void freerdp_tls_server_context_release(rdpTlsServerContext* server)
+{
+	if (!server)
+		return;
+
+	if (InterlockedDecrement(&server->refCount) > 0)
+		return;
+
+	SSL_CTX_free(server->ctx);
+	free(server);
+}
+
+/**
+ * Use the context shared by the listener if it serves the certificate the peer was configured
+ * with, otherwise (no shared context, a different certificate or method, resumption disabled
+ * for the peer only) set up a private one.
+ */
+static SSL_CTX* tls_server_ctx_get(rdpTlsServerContext* server, const rdpSettings* settings,
+                                   const SSL_METHOD* method, int options)
+{
+	WINPR_ASSERT(settings);
+
+	const BOOL resumption = freerdp_settings_get_bool(settings, FreeRDP_TlsSessionResumption);
+	if (server && (server->method == method) && (resumption || !server->resumption))
+	{
+		rdpCertificate* cert = settings->RdpServerCertificate;
+		if (!cert || (X509_cmp(SSL_CTX_get0_certificate(server->ctx),
+		                       freerdp_certificate_get_x509(cert)) == 0))
+		{
+			SSL_CTX_up_ref(server->ctx);
+			return server->ctx;
+		}
+
+		WLog_DBG(TAG, "peer certificate differs from the shared TLS context");
+	}
+
+	return tls_server_ctx_new(settings, method, options, FALSE);
 }
 
 static void
@@ -878,6 +1113,46 @@ const SSL_METHOD* freerdp_tls_get_ssl_method(BOOL isDtls, BOOL isClient)
 #endif
 }
 
+static void tls_session_cache_attach(rdpTls* tls)
+{
+	WINPR_ASSERT(tls);
+	WINPR_ASSERT(tls->context);
+
+	if (!freerdp_settings_get_bool(tls->context->settings, FreeRDP_TlsSessionResumption))
+		return;
+
+	const char* name = tls_get_server_name(tls);
+	if (!name)
+		return;
+
+	/* gateway and direct connections to the same host:port must not share sessions */
+	char* key = NULL;
+	size_t keylen = 0;
+	winpr_asprintf(&key, &keylen, "%s:%d%s", name, tls->port,
+	               tls->isGatewayTransport ? "/gateway" : "");
+	if (!key)
+		return;
+
+	(void)freerdp_tls_session_cache_attach(tls->ssl, key);
+	free(key);
+}
+
+static void tls_update_metrics(rdpTls* tls)
+{
+	WINPR_ASSERT(tls);
+
+	const BOOL resumed = SSL_session_reused(tls->ssl) == 1;
+	WLog_DBG(TAG, "TLS handshake completed (%s)", resumed ? "resumed" : "full");
+
+	rdpMetrics* metrics = tls->context ? tls->context->metrics : NULL;
+	if (!metrics)
+		return;
+
+	metrics->TotalTlsHandshakes++;
+	if (resumed)
+		metrics->TotalTlsResumedHandshakes++;
+}
+
 TlsHandshakeResult freerdp_tls_connect_ex(rdpTls* tls, BIO* underlying, const SSL_METHOD* methods)
 {
 	WINPR_ASSERT(tls);
@@ -913,7 +1188,8 @@ TlsHandshakeResult freerdp_tls_connect_ex(rdpTls* tls, BIO* underlying, const SS
 	tls->isClientMode = TRUE;
 	adjustSslOptions(&options);
 
-	if (!tls_prepare(tls, underlying, methods, options, TRUE))
+	SSL_CTX* ctx = tls_ctx_new(tls->context->settings, methods, options, TRUE);
+	if (!tls_prepare(tls, underlying, ctx, TRUE))
 		return TLS_HANDSHAKE_ERROR;
 
 #if !defined(OPENSSL_NO_TLSEXT)
@@ -922,6 +1198,8 @@ TlsHandshakeResult freerdp_tls_connect_ex(rdpTls* tls, BIO* underlying, const SS
 	SSL_set_tlsext_host_name(tls->ssl, ptr);
 #endif
 
+	tls_session_cache_attach(tls);
+
 	return freerdp_tls_handshake(tls);
 }
 
@@ -980,6 +1258,7 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 
 		/* server-side NLA needs public keys (keys from us, the server) but no certificate verify */
 		ret = TLS_HANDSHAKE_SUCCESS;
+		tls_update_metrics(tls);
 
 		if (tls->isClientMode)
 		{
@@ -990,6 +1269,7 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 			if (verify_status < 1)
 			{
 				WLog_ERR(TAG, "certificate not trusted, aborting.");
+				freerdp_tls_session_cache_invalidate(tls->ssl);
 				freerdp_tls_send_alert(tls);
 				ret = TLS_HANDSHAKE_VERIFY_ERROR;
 			}
@@ -1110,113 +1390,14 @@ TlsHandshakeResult freerdp_tls_accept_ex(rdpTls* tls, BIO* underlying, rdpSettin
                                          const SSL_METHOD* methods)
 {
 	WINPR_ASSERT(tls);
+	WINPR_ASSERT(tls->context);
 
-	int options = 0;
-	int status = 0;
-
-	/**
-	 * SSL_OP_NO_SSLv2:
-	 *
-	 * We only want SSLv3 and TLSv1, so disable SSLv2.
-	 * SSLv3 is used by, eg. Microsoft RDC for Mac OS X.
-	 */
-	options |= SSL_OP_NO_SSLv2;
-	/**
-	 * SSL_OP_NO_COMPRESSION:
-	 *
-	 * The Microsoft RDP server does not advertise support
-	 * for TLS compression, but alternative servers may support it.
-	 * This was observed between early versions of the FreeRDP server
-	 * and the FreeRDP client, and caused major performance issues,
-	 * which is why we're disabling it.
-	 */
-#ifdef SSL_OP_NO_COMPRESSION
-	options |= SSL_OP_NO_COMPRESSION;
-#endif
-	/**
-	 * SSL_OP_TLS_BLOCK_PADDING_BUG:
-	 *
-	 * The Microsoft RDP server does *not* support TLS padding.
-	 * It absolutely needs to be disabled otherwise it won't work.
-	 */
-	options |= SSL_OP_TLS_BLOCK_PADDING_BUG;
-	/**
-	 * SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS:
-	 *
-	 * Just like TLS padding, the Microsoft RDP server does not
-	 * support empty fragments. This needs to be disabled.
-	 */
-	options |= SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS;
-
-	/**
-	 * SSL_OP_NO_RENEGOTIATION
-	 *
-	 * Disable SSL client site renegotiation.
-	 */
-
-#if (OPENSSL_VERSION_NUMBER >= 0x10101000L) && (OPENSSL_VERSION_NUMBER < 0x30000000L) && \
-    !defined(LIBRESSL_VERSION_NUMBER)
-	options |= SSL_OP_NO_RENEGOTIATION;
-#endif
-
-	if (!tls_prepare(tls, underlying, methods, options, FALSE))
-		return TLS_HANDSHAKE_ERROR;
-
-	const rdpPrivateKey* key = freerdp_settings_get_pointer(settings, FreeRDP_RdpServerRsaKey);
-	if (!key)
-	{
-		WLog_ERR(TAG, "invalid private key");
-		return TLS_HANDSHAKE_ERROR;
-	}
-
-	EVP_PKEY* privkey = freerdp_key_get_evp_pkey(key);
-	if (!privkey)
-	{
-		WLog_ERR(TAG, "invalid private key");
-		return TLS_HANDSHAKE_ERROR;
-	}
-
-	status = SSL_use_PrivateKey(tls->ssl, privkey);
-	/* The local reference to the private key will anyway go out of
-	 * scope; so the reference count should be decremented weither
-	 * SSL_use_PrivateKey succeeds or fails.
-	 */
-	EVP_PKEY_free(privkey);
-
-	if (status <= 0)
-	{
-		WLog_ERR(TAG, "SSL_CTX_use_PrivateKey_file failed");
-		return TLS_HANDSHAKE_ERROR;
-	}
-
-	rdpCertificate* cert =
-	    freerdp_settings_get_pointer_writable(settings, FreeRDP_RdpServerCertificate);
-	if (!cert)
-	{
-		WLog_ERR(TAG, "invalid certificate");
-		return TLS_HANDSHAKE_ERROR;
-	}
-
-	status = SSL_use_certificate(tls->ssl, freerdp_certificate_get_x509(cert));
+	const freerdp_peer* peer = tls->context->peer;
+	rdpTlsServerContext* server = peer ? peer->TlsServerContext : NULL;
 
-	if (status <= 0)
-	{
-		WLog_ERR(TAG, "SSL_use_certificate_file failed");
+	SSL_CTX* ctx = tls_server_ctx_get(server, settings, methods, tls_server_options());
+	if (!tls_prepare(tls, underlying, ctx, FALSE))
 		return TLS_HANDSHAKE_ERROR;
-	}
-
-	const size_t cnt = freerdp_certificate_get_chain_len(cert);
-	for (size_t x = 0; x < cnt; x++)
-	{
-		X509* xcert = freerdp_certificate_get_chain_at(cert, x);
-		WINPR_ASSERT(xcert);
-		const long rc = SSL_add1_chain_cert(tls->ssl, xcert);
-		if (rc != 1)
-		{
-			WLog_ERR(TAG, "SSL_add1_chain_cert failed");
-			return TLS_HANDSHAKE_ERROR;
-		}
-	}
 
 #if defined(MICROSOFT_IOS_SNI_BUG) && !defined(OPENSSL_NO_TLSEXT) && \
     !defined(LIBRESSL_VERSION_NUMBER)
@@ -125,6 +125,23 @@ extern "C"
 	WINPR_ATTR_NODISCARD
 	FREERDP_LOCAL rdpTls* freerdp_tls_new(rdpContext* context);
 
+	FREERDP_LOCAL void freerdp_tls_server_context_release(rdpTlsServerContext* server);
+
+	/** @brief Set up a server TLS context from the key, certificate and TLS options in
+	 *  \b settings, to be shared by all peers accepted with them.
+	 *
+	 *  Key logging (\b FreeRDP_TlsSecretsFile) is also decided here, once for all peers.
+	 *
+	 *  @return A context with one reference or \b NULL on failure
+	 */
+	WINPR_ATTR_MALLOC(freerdp_tls_server_context_release, 1)
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL rdpTlsServerContext* freerdp_tls_server_context_new(const rdpSettings* settings);
+
+	/** @brief Take another reference to \b server, released with
+	 *  \b freerdp_tls_server_context_release */
+	FREERDP_LOCAL rdpTlsServerContext* freerdp_tls_server_context_ref(rdpTlsServerContext* server);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,489 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * TLS session resumption (client session cache, server ticket keys)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
+#include <openssl/core_names.h>
+#define TLS_TICKET_USE_EVP_MAC
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include <freerdp/log.h>
+
+#include "tls_session.h"
+
+#define TAG FREERDP_TAG("crypto.tls")
+
+#define TLS_TICKET_KEY_NAME_LENGTH 16
+#define TLS_TICKET_KEY_LENGTH 32
+
+typedef struct
+{
+	char* key;
+	SSL_SESSION* session;
+	UINT64 lastUsed;
+} tls_session_entry;
+
+typedef struct
+{
+	BOOL valid;
+	UINT64 created;
+	BYTE name[TLS_TICKET_KEY_NAME_LENGTH];
+	BYTE aesKey[TLS_TICKET_KEY_LENGTH];
+	BYTE hmacKey[TLS_TICKET_KEY_LENGTH];
+} tls_ticket_key;
+
+/* The ticket key ring of a server SSL_CTX, stored as its ex_data */
+typedef struct
+{
+	CRITICAL_SECTION lock;
+	/* [0] is the key used to issue new tickets, [1] the previous one
+	 * which is still accepted for decryption. */
+	tls_ticket_key keys[2];
+} tls_ticket_keys;
+
+static INIT_ONCE tls_session_once = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION tls_session_lock;
+static int tls_session_key_idx = -1;
+static int tls_ticket_keys_idx = -1;
+
+static tls_session_entry tls_sessions[TLS_SESSION_CACHE_SIZE] = { 0 };
+
+static void tls_session_key_free(WINPR_ATTR_UNUSED void* parent, void* ptr,
+                                 WINPR_ATTR_UNUSED CRYPTO_EX_DATA* ad, WINPR_ATTR_UNUSED int idx,
+                                 WINPR_ATTR_UNUSED long argl, WINPR_ATTR_UNUSED void* argp)
+{
+	free(ptr);
+}
+
+static void tls_ticket_keys_free(WINPR_ATTR_UNUSED void* parent, void* ptr,
+                                 WINPR_ATTR_UNUSED CRYPTO_EX_DATA* ad, WINPR_ATTR_UNUSED int idx,
+                                 WINPR_ATTR_UNUSED long argl, WINPR_ATTR_UNUSED void* argp)
+{
+	tls_ticket_keys* ring = ptr;
+	if (!ring)
+		return;
+
+	DeleteCriticalSection(&ring->lock);
+	OPENSSL_cleanse(ring->keys, sizeof(ring->keys));
+	free(ring);
+}
+
+static BOOL CALLBACK tls_session_init_cb(WINPR_ATTR_UNUSED PINIT_ONCE once,
+                                         WINPR_ATTR_UNUSED PVOID param,
+                                         WINPR_ATTR_UNUSED PVOID* context)
+{
+	if (!InitializeCriticalSectionAndSpinCount(&tls_session_lock, 4000))
+		return FALSE;
+
+	tls_session_key_idx = SSL_get_ex_new_index(0, NULL, NULL, NULL, tls_session_key_free);
+	tls_ticket_keys_idx = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, tls_ticket_keys_free);
+	return (tls_session_key_idx != -1) && (tls_ticket_keys_idx != -1);
+}
+
+static BOOL tls_session_init(void)
+{
+	return InitOnceExecuteOnce(&tls_session_once, tls_session_init_cb, NULL, NULL);
+}
+
+static BOOL tls_session_is_resumable(const SSL_SESSION* session)
+{
+	if (!session)
+		return FALSE;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+	return SSL_SESSION_is_resumable(session) == 1;
+#else
+	return TRUE;
+#endif
+}
+
+static void tls_session_entry_clear(tls_session_entry* entry)
+{
+	WINPR_ASSERT(entry);
+
+	free(entry->key);
+	if (entry->session)
+		SSL_SESSION_free(entry->session);
+
+	const tls_session_entry empty = { 0 };
+	*entry = empty;
+}
+
+/* must be called with tls_session_lock held */
+static tls_session_entry* tls_session_find(const char* key)
+{
+	WINPR_ASSERT(key);
+
+	for (size_t x = 0; x < ARRAYSIZE(tls_sessions); x++)
+	{
+		tls_session_entry* entry = &tls_sessions[x];
+		if (entry->key && (strcmp(entry->key, key) == 0))
+			return entry;
+	}
+	return NULL;
+}
+
+/* must be called with tls_session_lock held, returns a free or the least recently used entry */
+static tls_session_entry* tls_session_find_slot(void)
+{
+	tls_session_entry* lru = &tls_sessions[0];
+
+	for (size_t x = 0; x < ARRAYSIZE(tls_sessions); x++)
+	{
+		tls_session_entry* entry = &tls_sessions[x];
+		if (!entry->key)
+			return entry;
+		if (entry->lastUsed < lru->lastUsed)
+			lru = entry;
+	}
+
+	tls_session_entry_clear(lru);
+	return lru;
+}
+
+static int tls_session_new_cb(SSL* ssl, SSL_SESSION* session)
+{
+	const char* key = SSL_get_ex_data(ssl, tls_session_key_idx);
+	if (!key || !tls_session_is_resumable(session))
+		return 0;
+
+	int rc = 0;
+	EnterCriticalSection(&tls_session_lock);
+	tls_session_entry* entry = tls_session_find(key);
+	if (!entry)
+	{
+		entry = tls_session_find_slot();
+		entry->key = _strdup(key);
+	}
+	else if (entry->session)
+		SSL_SESSION_free(entry->session);
+
+	entry->session = NULL;
+	if (entry->key)
+	{
+		/* returning 1 keeps the reference OpenSSL handed to us */
+		entry->session = session;
+		entry->lastUsed = GetTickCount64();
+		rc = 1;
+	}
+	LeaveCriticalSection(&tls_session_lock);
+
+	if (rc)
+		WLog_DBG(TAG, "cached TLS session for %s", key);
+	return rc;
+}
+
+BOOL freerdp_tls_session_cache_enable(SSL_CTX* ctx)
+{
+	WINPR_ASSERT(ctx);
+
+	if (!tls_session_init())
+		return FALSE;
+
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, tls_session_new_cb);
+	return TRUE;
+}
+
+BOOL freerdp_tls_session_cache_attach(SSL* ssl, const char* key)
+{
+	WINPR_ASSERT(ssl);
+	WINPR_ASSERT(key);
+
+	if (!tls_session_init())
+		return FALSE;
+
+	char* dup = _strdup(key);
+	if (!dup)
+		return FALSE;
+
+	free(SSL_get_ex_data(ssl, tls_session_key_idx));
+	if (SSL_set_ex_data(ssl, tls_session_key_idx, dup) != 1)
+	{
+		free(dup);
+		return FALSE;
+	}
+
+	BOOL offered = FALSE;
+	EnterCriticalSection(&tls_session_lock);
+	tls_session_entry* entry = tls_session_find(key);
+	if (entry)
+	{
+		if (tls_session_is_resumable(entry->session) && (SSL_set_session(ssl, entry->session) == 1))
+		{
+			entry->lastUsed = GetTickCount64();
+			offered = TRUE;
+		}
+		else
+			tls_session_entry_clear(entry);
+	}
+	LeaveCriticalSection(&tls_session_lock);
+
+	if (offered)
+		WLog_DBG(TAG, "offering cached TLS session for %s", key);
+	return offered;
+}
+
+void freerdp_tls_session_cache_invalidate(SSL* ssl)
+{
+	WINPR_ASSERT(ssl);
+
+	if (!tls_session_init())
+		return;
+
+	/* unbind first so tickets arriving later on this connection are not stored */
+	char* key = SSL_get_ex_data(ssl, tls_session_key_idx);
+	if (!key || (SSL_set_ex_data(ssl, tls_session_key_idx, NULL) != 1))
+		return;
+
+	EnterCriticalSection(&tls_session_lock);
+	tls_session_entry* entry = tls_session_find(key);
+	if (entry)
+		tls_session_entry_clear(entry);
+	LeaveCriticalSection(&tls_session_lock);
+	free(key);
+}
+
+void freerdp_tls_session_cache_clear(void)
+{
+	if (!tls_session_init())
+		return;
+
+	EnterCriticalSection(&tls_session_lock);
+	for (size_t x = 0; x < ARRAYSIZE(tls_sessions); x++)
+		tls_session_entry_clear(&tls_sessions[x]);
+	LeaveCriticalSection(&tls_session_lock);
+}
+
+size_t freerdp_tls_session_cache_count(void)
+{
+	size_t count = 0;
+
+	if (!tls_session_init())
+		return 0;
+
+	EnterCriticalSection(&tls_session_lock);
+	for (size_t x = 0; x < ARRAYSIZE(tls_sessions); x++)
+	{
+		if (tls_sessions[x].key)
+			count++;
+	}
+	LeaveCriticalSection(&tls_session_lock);
+	return count;
+}
+
+static BOOL tls_ticket_key_generate(tls_ticket_key* key)
+{
+	WINPR_ASSERT(key);
+
+	if (RAND_bytes(key->name, sizeof(key->name)) != 1)
+		return FALSE;
+	if (RAND_bytes(key->aesKey, sizeof(key->aesKey)) != 1)
+		return FALSE;
+	if (RAND_bytes(key->hmacKey, sizeof(key->hmacKey)) != 1)
+		return FALSE;
+
+	key->created = GetTickCount64();
+	key->valid = TRUE;
+	return TRUE;
+}
+
+/* must be called with the lock of the ring held */
+static BOOL tls_ticket_keys_update(tls_ticket_keys* ring, BOOL force)
+{
+	WINPR_ASSERT(ring);
+
+	const tls_ticket_key* current = &ring->keys[0];
+	const UINT64 now = GetTickCount64();
+
+	if (!force && current->valid && (now - current->created < TLS_TICKET_KEY_LIFETIME * 1000ull))
+		return TRUE;
+
+	tls_ticket_key next = { 0 };
+	if (!tls_ticket_key_generate(&next))
+	{
+		WLog_ERR(TAG, "failed to generate TLS session ticket key");
+		return FALSE;
+	}
+
+	ring->keys[1] = ring->keys[0];
+	ring->keys[0] = next;
+	OPENSSL_cleanse(&next, sizeof(next));
+	return TRUE;
+}
+
+#if defined(TLS_TICKET_USE_EVP_MAC)
+static BOOL tls_ticket_mac_init(EVP_MAC_CTX* hctx, BYTE* hmacKey)
+{
+	char digest[] = "SHA256";
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, hmacKey, TLS_TICKET_KEY_LENGTH),
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0), OSSL_PARAM_construct_end()
+	};
+	return EVP_MAC_CTX_set_params(hctx, params) == 1;
+}
+
+static int tls_ticket_key_cb(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                             EVP_CIPHER_CTX* ctx, EVP_MAC_CTX* hctx, int enc)
+#else
+static BOOL tls_ticket_mac_init(HMAC_CTX* hctx, BYTE* hmacKey)
+{
+	return HMAC_Init_ex(hctx, hmacKey, TLS_TICKET_KEY_LENGTH, EVP_sha256(), NULL) == 1;
+}
+
+static int tls_ticket_key_cb(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                             EVP_CIPHER_CTX* ctx, HMAC_CTX* hctx, int enc)
+#endif
+{
+	/* return values: -1 error, 0 unknown key (full handshake), 1 success, 2 success + renew
+	 *
+	 * Successful decryption always requests a renewal: TLS 1.3 clients use a session only once
+	 * and without a fresh ticket the next reconnect would be a full handshake again. */
+	int rc = -1;
+	tls_ticket_key key = { 0 };
+	tls_ticket_keys* ring = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), tls_ticket_keys_idx);
+
+	if (!ring)
+		return -1;
+
+	EnterCriticalSection(&ring->lock);
+	if (tls_ticket_keys_update(ring, FALSE))
+	{
+		if (enc)
+		{
+			key = ring->keys[0];
+			rc = 1;
+		}
+		else
+		{
+			rc = 0;
+			for (size_t x = 0; x < ARRAYSIZE(ring->keys); x++)
+			{
+				const tls_ticket_key* cur = &ring->keys[x];
+				if (cur->valid && (memcmp(cur->name, key_name, sizeof(cur->name)) == 0))
+				{
+					key = *cur;
+					rc = 2;
+					break;
+				}
+			}
+		}
+	}
+	LeaveCriticalSection(&ring->lock);
+
+	if (rc > 0)
+	{
+		const EVP_CIPHER* cipher = EVP_aes_256_cbc();
+		if (enc)
+		{
+			memcpy(key_name, key.name, sizeof(key.name));
+			if ((RAND_bytes(iv, EVP_CIPHER_iv_length(cipher)) != 1) ||
+			    (EVP_EncryptInit_ex(ctx, cipher, NULL, key.aesKey, iv) != 1))
+				rc = -1;
+		}
+		else if (EVP_DecryptInit_ex(ctx, cipher, NULL, key.aesKey, iv) != 1)
+			rc = -1;
+
+		if ((rc > 0) && !tls_ticket_mac_init(hctx, key.hmacKey))
+			rc = -1;
+	}
+
+	OPENSSL_cleanse(&key, sizeof(key));
+	return rc;
+}
+
+BOOL freerdp_tls_ticket_keys_enable(SSL_CTX* ctx)
+{
+	WINPR_ASSERT(ctx);
+
+	if (!tls_session_init())
+		return FALSE;
+
+	if (SSL_CTX_get_ex_data(ctx, tls_ticket_keys_idx))
+		return TRUE;
+
+	tls_ticket_keys* ring = calloc(1, sizeof(tls_ticket_keys));
+	if (!ring)
+		return FALSE;
+
+	if (!InitializeCriticalSectionAndSpinCount(&ring->lock, 4000))
+	{
+		free(ring);
+		return FALSE;
+	}
+
+	/* the ring is owned by ctx from here on, see tls_ticket_keys_free */
+	if (SSL_CTX_set_ex_data(ctx, tls_ticket_keys_idx, ring) != 1)
+	{
+		tls_ticket_keys_free(NULL, ring, NULL, 0, 0, NULL);
+		return FALSE;
+	}
+
+	EnterCriticalSection(&ring->lock);
+	const BOOL rc = tls_ticket_keys_update(ring, FALSE);
+	LeaveCriticalSection(&ring->lock);
+	if (!rc)
+		return FALSE;
+
+	SSL_CTX_set_timeout(ctx, TLS_TICKET_KEY_LIFETIME);
+#if defined(TLS_TICKET_USE_EVP_MAC)
+	return SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, tls_ticket_key_cb) == 1;
+#else
+	return SSL_CTX_set_tlsext_ticket_key_cb(ctx, tls_ticket_key_cb) == 1;
+#endif
+}
+
+BOOL freerdp_tls_ticket_keys_rotate(SSL_CTX* ctx)
+{
+	WINPR_ASSERT(ctx);
+
+	if (!tls_session_init())
+		return FALSE;
+
+	tls_ticket_keys* ring = SSL_CTX_get_ex_data(ctx, tls_ticket_keys_idx);
+	if (!ring)
+		return FALSE;
+
+	EnterCriticalSection(&ring->lock);
+	const BOOL rc = tls_ticket_keys_update(ring, TRUE);
+	LeaveCriticalSection(&ring->lock);
+	return rc;
+}
+
+void freerdp_tls_session_resumption_disable(SSL_CTX* ctx)
+{
+	WINPR_ASSERT(ctx);
+
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+	SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+	(void)SSL_CTX_set_num_tickets(ctx, 0);
+#endif
+}
@@ -0,0 +1,85 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * TLS session resumption (client session cache, server ticket keys)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CRYPTO_TLS_SESSION_H
+#define FREERDP_LIB_CRYPTO_TLS_SESSION_H
+
+#include <winpr/wtypes.h>
+
+#include <openssl/ssl.h>
+
+#include <freerdp/api.h>
+
+/** Maximum number of client sessions kept in the process wide cache */
+#define TLS_SESSION_CACHE_SIZE 64
+
+/** Lifetime of a server ticket key in seconds. The previous key is still
+ * accepted (and the ticket renewed) for another lifetime after rotation. */
+#define TLS_TICKET_KEY_LIFETIME (60 * 60)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief Enable the external client session cache on \b ctx
+	 *
+	 *  New sessions (and TLS 1.3 tickets) received on connections created
+	 *  from \b ctx are stored in the process wide cache under the key set with
+	 *  \b freerdp_tls_session_cache_attach
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL freerdp_tls_session_cache_enable(SSL_CTX* ctx);
+
+	/** @brief Bind \b ssl to the cache entry \b key and offer a cached session if available
+	 *
+	 *  @return \b TRUE if a cached session was offered for resumption
+	 */
+	FREERDP_LOCAL BOOL freerdp_tls_session_cache_attach(SSL* ssl, const char* key);
+
+	/** @brief Drop the cached session \b ssl is bound to (e.g. after a failed verification) */
+	FREERDP_LOCAL void freerdp_tls_session_cache_invalidate(SSL* ssl);
+
+	/** @brief Drop all cached client sessions */
+	FREERDP_LOCAL void freerdp_tls_session_cache_clear(void);
+
+	/** @brief Number of sessions currently held in the client cache */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL size_t freerdp_tls_session_cache_count(void);
+
+	/** @brief Install a session ticket key ring on a server \b ctx
+	 *
+	 *  The keys belong to \b ctx and are freed with it. A ticket issued on one
+	 *  connection accepted with \b ctx (e.g. the shared context of a listener)
+	 *  resumes another one accepted with the same context, tickets of other
+	 *  contexts and certificates are rejected.
+	 */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL freerdp_tls_ticket_keys_enable(SSL_CTX* ctx);
+
+	/** @brief Force a rotation of the ticket keys of the server \b ctx */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL freerdp_tls_ticket_keys_rotate(SSL_CTX* ctx);
+
+	/** @brief Neither issue tickets nor cache sessions on the server \b ctx */
+	FREERDP_LOCAL void freerdp_tls_session_resumption_disable(SSL_CTX* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_LIB_CRYPTO_TLS_SESSION_H */
@@ -37,6 +37,8 @@
 
 #include "brush.h"
 #include "clipping.h"
+#include "pattern.h"
+#include "rop.h"
 #include "../gdi/gdi.h"
 
 #define TAG FREERDP_TAG("gdi.bitmap")
@@ -463,14 +465,164 @@ static BOOL adjust_src_dst_coordinates(HGDI_DC hdcDest, INT32* pnXSrc, INT32* pn
 	return TRUE;
 }
 
+static void BitBlt_fill_row(BYTE* WINPR_RESTRICT row, UINT32 format, UINT32 color, size_t width)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+
+	for (size_t x = 0; x < width; x++)
+		FreeRDPWriteColor(&row[x * bpp], format, color);
+}
+
+/* Source pixels in the destination format. Like SRCCOPY a source that already is in the
+ * destination format is used as is, others are converted pixel by pixel. */
+static BOOL BitBlt_convert_src_row(HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, UINT32 format,
+                                   BYTE* WINPR_RESTRICT row, size_t width,
+                                   const gdiPalette* palette)
+{
+	const BYTE* srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc);
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+
+	if (!srcp)
+		return FALSE;
+
+	if (hdcSrc->format == format)
+	{
+		memcpy(row, srcp, width * bpp);
+		return TRUE;
+	}
+
+	const size_t srcBpp = FreeRDPGetBytesPerPixel(hdcSrc->format);
+	for (size_t x = 0; x < width; x++)
+	{
+		UINT32 color = FreeRDPReadColor(&srcp[x * srcBpp], hdcSrc->format);
+		color = FreeRDPConvertColor(color, hdcSrc->format, format, palette);
+		FreeRDPWriteColor(&row[x * bpp], format, color);
+	}
+	return TRUE;
+}
+
+/* The brush bitmap tiled across the row, see gdi_get_brush_pointer */
+static void BitBlt_pattern_row(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, UINT32 format,
+                               BYTE* WINPR_RESTRICT row, size_t width)
+{
+	const HGDI_BITMAP hBmpBrush = hdcDest->brush->pattern;
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	const size_t brushBpp = FreeRDPGetBytesPerPixel(hBmpBrush->format);
+	const UINT32 w = WINPR_ASSERTING_INT_CAST(UINT32, hBmpBrush->width);
+	const size_t period = MIN(w, width) * bpp;
+	const size_t bytes = width * bpp;
+
+	for (UINT32 x = 0; x < MIN(w, width); x++)
+	{
+		const BYTE* patp =
+		    gdi_get_brush_pointer(hdcDest, WINPR_ASSERTING_INT_CAST(uint32_t, nXDest) + x,
+		                          WINPR_ASSERTING_INT_CAST(uint32_t, nYDest));
+		memcpy(&row[x * bpp], patp, MIN(bpp, brushBpp));
+	}
+
+	for (size_t x = period; x < bytes; x += period)
+		memcpy(&row[x], row, MIN(period, bytes - x));
+}
+
+/* Row based BitBlt_process, the ROP is applied to whole rows in the destination format */
+static BOOL BitBlt_process_rows(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth,
+                                INT32 nHeight, HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc,
+                                UINT32 style, const gdiRop3Program* program,
+                                const gdiPatternTile* tile, const gdiPalette* palette)
+{
+	BOOL rc = FALSE;
+	gdiPatternTile expanded;
+	const UINT32 format = hdcDest->format;
+	const size_t width = WINPR_ASSERTING_INT_CAST(size_t, nWidth);
+	const size_t bytes = width * FreeRDPGetBytesPerPixel(format);
+
+	if ((nWidth <= 0) || (nHeight <= 0))
+		return TRUE;
+
+	if (!program->usePat || (style == GDI_BS_SOLID))
+		tile = NULL;
+	else if (!tile || (tile->format != format))
+	{
+		tile = NULL;
+		if (gdi_pattern_tile_init(&expanded, hdcDest->brush->pattern, format))
+			tile = &expanded;
+	}
+
+	/* PATCOPY writes the tile rows directly */
+	const BOOL patCopy = tile && (program->count == 1);
+
+	BYTE* scratch = calloc(4, bytes);
+	if (!scratch)
+		return FALSE;
+
+	BYTE* srcRow = scratch;
+	BYTE* patRow = &scratch[bytes];
+	BYTE* black = &scratch[2 * bytes];
+	BYTE* white = &scratch[3 * bytes];
+
+	if (program->useConst)
+	{
+		BitBlt_fill_row(black, format, FreeRDPGetColor(format, 0, 0, 0, 0xFF), width);
+		BitBlt_fill_row(white, format, FreeRDPGetColor(format, 0xFF, 0xFF, 0xFF, 0xFF), width);
+	}
+
+	if (program->usePat && (style == GDI_BS_SOLID))
+		BitBlt_fill_row(patRow, format, hdcDest->brush->color, width);
+
+	/* the source may be the destination bitmap, start with the row written last */
+	const BOOL reverse = program->useSrc && (nYDest > nYSrc);
+
+	for (INT32 i = 0; i < nHeight; i++)
+	{
+		const INT32 y = reverse ? nHeight - 1 - i : i;
+		BYTE* dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
+
+		if (!dstp)
+			goto fail;
+
+		if (program->useSrc)
+		{
+			if (!BitBlt_convert_src_row(hdcSrc, nXSrc, nYSrc + y, format, srcRow, width,
+			                            palette))
+				goto fail;
+		}
+
+		if (patCopy)
+		{
+			gdi_pattern_tile_row(tile, dstp, WINPR_ASSERTING_INT_CAST(UINT32, nXDest),
+			                     WINPR_ASSERTING_INT_CAST(UINT32, nYDest + y),
+			                     hdcDest->brush->nXOrg, hdcDest->brush->nYOrg, width);
+			continue;
+		}
+
+		if (tile)
+			gdi_pattern_tile_row(tile, patRow, WINPR_ASSERTING_INT_CAST(UINT32, nXDest),
+			                     WINPR_ASSERTING_INT_CAST(UINT32, nYDest + y),
+			                     hdcDest->brush->nXOrg, hdcDest->brush->nYOrg, width);
+		else if (program->usePat && (style != GDI_BS_SOLID))
+			BitBlt_pattern_row(hdcDest, nXDest, nYDest + y, format, patRow, width);
+
+		gdi_rop3_row(program, dstp, srcRow, patRow, black, white, bytes);
+	}
+
+	rc = TRUE;
+fail:
+	free(scratch);
+	return rc;
+}
+
 static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32 nHeight,
                            HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, const char* rop,
-                           const gdiPalette* palette)
+                           const gdiPatternTile* tile, const gdiPalette* palette)
 {
 	UINT32 style = 0;
 	BOOL useSrc = FALSE;
 	BOOL usePat = FALSE;
 	const char* iter = rop;
+	gdiRop3Program program = { 0 };
+
+	if (!rop)
+		return FALSE;
 
 	while (*iter != '\0')
 	{
@@ -521,6 +673,10 @@ static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nW
 		}
 	}
 
+	if (gdi_rop3_format_supported(hdcDest->format) && gdi_rop3_compile(rop, &program))
+		return BitBlt_process_rows(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc,
+		                           style, &program, tile, palette);
+
 	if ((nXDest > nXSrc) && (nYDest > nYSrc))
 	{
 		for (INT32 y = nHeight - 1; y >= 0; y--)
@@ -590,6 +746,14 @@ static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nW
  */
 BOOL gdi_BitBlt(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32 nHeight,
                 HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, DWORD rop, const gdiPalette* palette)
+{
+	return gdi_pattern_bitblt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, rop,
+	                          NULL, palette);
+}
+
+BOOL gdi_pattern_bitblt(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32 nHeight,
+                        HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, DWORD rop,
+                        const gdiPatternTile* tile, const gdiPalette* palette)
 {
 	HGDI_BITMAP hSrcBmp = NULL;
 	HGDI_BITMAP hDstBmp = NULL;
@@ -665,7 +829,7 @@ BOOL gdi_BitBlt(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32
 
 		default:
 			if (!BitBlt_process(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc,
-			                    gdi_rop_to_string(rop), palette))
+			                    gdi_rop_to_string(rop), tile, palette))
 				return FALSE;
 
 			break;
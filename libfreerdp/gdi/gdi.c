@@ -44,6 +44,7 @@
 #include "clipping.h"
 #include "brush.h"
 #include "line.h"
+#include "pattern.h"
 #include "gdi.h"
 #include "../core/graphics.h"
 #include "../core/update.h"
@@ -588,6 +589,110 @@ static BOOL gdi_dstblt(rdpContext* context, const DSTBLT_ORDER* dstblt)
 	                  &gdi->palette);
 }
 
+/* The 8x8 brush data of a PatBlt order converted to the drawing surface format */
+static BOOL gdi_patblt_brush_data(rdpContext* context, const rdpBrush* brush, UINT32 foreColor,
+                                  UINT32 backColor, BYTE* data)
+{
+	rdpGdi* gdi = context->gdi;
+	const UINT32 format = gdi->drawing->hdc->format;
+
+	if (brush->style == GDI_BS_HATCHED)
+	{
+		if (brush->hatch >= ARRAYSIZE(GDI_BS_HATCHED_PATTERNS) / 8)
+			return FALSE;
+
+		const BYTE* hatched = GDI_BS_HATCHED_PATTERNS + (8ULL * brush->hatch);
+		return freerdp_image_copy_from_monochrome(data, format, 0, 0, 0, 8, 8, hatched, backColor,
+		                                          foreColor, &gdi->palette);
+	}
+
+	if (!brush->data)
+		return FALSE;
+
+	if (brush->bpp > 1)
+	{
+		UINT32 bpp = brush->bpp;
+
+		if ((bpp == 16) &&
+		    (freerdp_settings_get_uint32(context->settings, FreeRDP_ColorDepth) == 15))
+			bpp = 15;
+
+		const UINT32 brushFormat = gdi_get_pixel_format(bpp);
+		return freerdp_image_copy_no_overlap(data, format, 0, 0, 0, 8, 8, brush->data, brushFormat,
+		                                     0, 0, 0, &gdi->palette, FREERDP_FLIP_NONE);
+	}
+
+	return freerdp_image_copy_from_monochrome(data, format, 0, 0, 0, 8, 8, brush->data, backColor,
+	                                          foreColor, &gdi->palette);
+}
+
+/* A pattern tile kept with a brush cache entry, monochrome brushes are expanded with the colours
+ * of the order that used them last. */
+typedef struct
+{
+	UINT32 foreColor;
+	UINT32 backColor;
+	gdiPatternTile tile;
+} gdiBrushTile;
+
+static BOOL gdi_patblt_tile_init(rdpContext* context, const rdpBrush* brush, UINT32 foreColor,
+                                 UINT32 backColor, gdiPatternTile* tile)
+{
+	BYTE data[8 * 8 * 4] = { 0 };
+	const UINT32 format = context->gdi->drawing->hdc->format;
+	const GDI_BITMAP pattern = { .objectType = GDIOBJECT_BITMAP,
+		                         .format = format,
+		                         .width = 8,
+		                         .height = 8,
+		                         .scanline = 8 * FreeRDPGetBytesPerPixel(format),
+		                         .data = data };
+
+	if (!gdi_patblt_brush_data(context, brush, foreColor, backColor, data))
+		return FALSE;
+
+	return gdi_pattern_tile_init(tile, &pattern, format);
+}
+
+/* The brush expanded to a pattern tile. Brushes from the brush cache keep their tile with the
+ * cache entry, except 8bpp ones that depend on the palette. */
+static const gdiPatternTile* gdi_patblt_tile(rdpContext* context, const rdpBrush* brush,
+                                             UINT32 foreColor, UINT32 backColor,
+                                             gdiPatternTile* tmp)
+{
+	void** slot = NULL;
+	const UINT32 format = context->gdi->drawing->hdc->format;
+
+	if ((brush->style == GDI_BS_PATTERN) && (brush->bpp != 8) && context->cache)
+		slot = brush_cache_expanded(context->cache->brush, brush->index, brush->bpp, brush->data);
+
+	if (!slot)
+		return gdi_patblt_tile_init(context, brush, foreColor, backColor, tmp) ? tmp : NULL;
+
+	gdiBrushTile* cached = *slot;
+	if (cached && (cached->tile.format == format) &&
+	    ((brush->bpp != 1) ||
+	     ((cached->foreColor == foreColor) && (cached->backColor == backColor))))
+		return &cached->tile;
+
+	if (!cached)
+	{
+		cached = calloc(1, sizeof(gdiBrushTile));
+		if (!cached)
+			return NULL;
+		*slot = cached;
+	}
+
+	cached->foreColor = foreColor;
+	cached->backColor = backColor;
+	if (!gdi_patblt_tile_init(context, brush, foreColor, backColor, &cached->tile))
+	{
+		free(cached);
+		*slot = NULL;
+		return NULL;
+	}
+	return &cached->tile;
+}
+
 static BOOL gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 {
 	WINPR_ASSERT(context);
@@ -604,7 +709,8 @@ static BOOL gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 	const DWORD rop = gdi_rop3_code_checked(patblt->bRop);
 	INT32 nXSrc = 0;
 	INT32 nYSrc = 0;
-	BYTE data[8 * 8 * 4];
+	gdiPatternTile tmp;
+	const gdiPatternTile* tile = NULL;
 	HGDI_BITMAP hBmp = NULL;
 
 	if (!gdi || !gdi->drawing || !gdi->drawing->hdc)
@@ -626,56 +732,24 @@ static BOOL gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 			break;
 
 		case GDI_BS_HATCHED:
+		case GDI_BS_PATTERN:
 		{
-			const BYTE* hatched = NULL;
-			hatched = GDI_BS_HATCHED_PATTERNS + (8ULL * brush->hatch);
+			tile = gdi_patblt_tile(context, brush, foreColor, backColor, &tmp);
 
-			if (!freerdp_image_copy_from_monochrome(data, gdi->drawing->hdc->format, 0, 0, 0, 8, 8,
-			                                        hatched, backColor, foreColor, &gdi->palette))
+			if (!tile)
 				goto out_error;
 
-			hBmp = gdi_CreateBitmapEx(8, 8, gdi->drawing->hdc->format, 0, data, NULL);
+			/* the brush bitmap is the tile, the part that is not repeated */
+			hBmp = gdi_CreateBitmapEx(tile->width, tile->height, tile->format,
+			                          GDI_PATTERN_ROW_BYTES, (BYTE*)tile->rows[0], NULL);
 
 			if (!hBmp)
 				goto out_error;
 
-			hbrush = gdi_CreateHatchBrush(hBmp);
-		}
-		break;
-
-		case GDI_BS_PATTERN:
-		{
-			UINT32 brushFormat = 0;
-
-			if (brush->bpp > 1)
-			{
-				UINT32 bpp = brush->bpp;
-
-				if ((bpp == 16) &&
-				    (freerdp_settings_get_uint32(context->settings, FreeRDP_ColorDepth) == 15))
-					bpp = 15;
-
-				brushFormat = gdi_get_pixel_format(bpp);
-
-				if (!freerdp_image_copy_no_overlap(data, gdi->drawing->hdc->format, 0, 0, 0, 8, 8,
-				                                   brush->data, brushFormat, 0, 0, 0, &gdi->palette,
-				                                   FREERDP_FLIP_NONE))
-					goto out_error;
-			}
+			if (brush->style == GDI_BS_HATCHED)
+				hbrush = gdi_CreateHatchBrush(hBmp);
 			else
-			{
-				if (!freerdp_image_copy_from_monochrome(data, gdi->drawing->hdc->format, 0, 0, 0, 8,
-				                                        8, brush->data, backColor, foreColor,
-				                                        &gdi->palette))
-					goto out_error;
-			}
-
-			hBmp = gdi_CreateBitmapEx(8, 8, gdi->drawing->hdc->format, 0, data, NULL);
-
-			if (!hBmp)
-				goto out_error;
-
-			hbrush = gdi_CreatePatternBrush(hBmp);
+				hbrush = gdi_CreatePatternBrush(hBmp);
 		}
 		break;
 
@@ -689,8 +763,9 @@ static BOOL gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 		hbrush->nXOrg = WINPR_ASSERTING_INT_CAST(int32_t, brush->x);
 		hbrush->nYOrg = WINPR_ASSERTING_INT_CAST(int32_t, brush->y);
 		gdi->drawing->hdc->brush = hbrush;
-		ret = gdi_BitBlt(gdi->drawing->hdc, patblt->nLeftRect, patblt->nTopRect, patblt->nWidth,
-		                 patblt->nHeight, gdi->primary->hdc, nXSrc, nYSrc, rop, &gdi->palette);
+		ret = gdi_pattern_bitblt(gdi->drawing->hdc, patblt->nLeftRect, patblt->nTopRect,
+		                         patblt->nWidth, patblt->nHeight, gdi->primary->hdc, nXSrc, nYSrc,
+		                         rop, tile, &gdi->palette);
 	}
 
 out_error:
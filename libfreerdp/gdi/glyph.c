@@ -0,0 +1,147 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Glyph Runs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+
+#include "glyph.h"
+#include "../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#endif
+
+static inline void glyph_blend_pixels(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT mask,
+                                      size_t width, size_t bpp, const BYTE* keep, const BYTE* set)
+{
+	for (size_t x = 0; x < width; x++)
+	{
+		BYTE* d = &dst[x * bpp];
+		const size_t m = mask[x] ? bpp : 0;
+
+		for (size_t b = 0; b < bpp; b++)
+			d[b] = (d[b] & keep[m + b]) | set[m + b];
+	}
+}
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+static inline __m128i glyph_blend_sse2(__m128i d, __m128i m, const __m128i keep[2],
+                                       const __m128i set[2])
+{
+	const __m128i off = _mm_or_si128(_mm_and_si128(d, keep[0]), set[0]);
+	const __m128i on = _mm_or_si128(_mm_and_si128(d, keep[1]), set[1]);
+	return _mm_or_si128(_mm_and_si128(m, on), _mm_andnot_si128(m, off));
+}
+
+/* 16 pixels per iteration, the mask bytes are widened to the pixel size */
+static size_t glyph_blend_row_sse2(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT mask,
+                                   size_t width, size_t bpp, const BYTE* keep, const BYTE* set)
+{
+	size_t x = 0;
+
+	if (bpp == 4)
+	{
+		UINT32 k[2] = { 0 };
+		UINT32 s[2] = { 0 };
+		memcpy(k, keep, sizeof(k));
+		memcpy(s, set, sizeof(s));
+
+		const __m128i keepv[2] = { _mm_set1_epi32((int)k[0]), _mm_set1_epi32((int)k[1]) };
+		const __m128i setv[2] = { _mm_set1_epi32((int)s[0]), _mm_set1_epi32((int)s[1]) };
+
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i* d = (__m128i*)&dst[x * 4];
+			const __m128i mk = _mm_loadu_si128((const __m128i*)&mask[x]);
+			const __m128i lo = _mm_unpacklo_epi8(mk, mk);
+			const __m128i hi = _mm_unpackhi_epi8(mk, mk);
+			const __m128i m[4] = { _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo),
+				                   _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi) };
+
+			for (size_t i = 0; i < ARRAYSIZE(m); i++)
+			{
+				const __m128i v = _mm_loadu_si128(&d[i]);
+				_mm_storeu_si128(&d[i], glyph_blend_sse2(v, m[i], keepv, setv));
+			}
+		}
+	}
+	else if (bpp == 2)
+	{
+		UINT16 k[2] = { 0 };
+		UINT16 s[2] = { 0 };
+		memcpy(k, keep, sizeof(k));
+		memcpy(s, set, sizeof(s));
+
+		const __m128i keepv[2] = { _mm_set1_epi16((short)k[0]), _mm_set1_epi16((short)k[1]) };
+		const __m128i setv[2] = { _mm_set1_epi16((short)s[0]), _mm_set1_epi16((short)s[1]) };
+
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i* d = (__m128i*)&dst[x * 2];
+			const __m128i mk = _mm_loadu_si128((const __m128i*)&mask[x]);
+			const __m128i m[2] = { _mm_unpacklo_epi8(mk, mk), _mm_unpackhi_epi8(mk, mk) };
+
+			for (size_t i = 0; i < ARRAYSIZE(m); i++)
+			{
+				const __m128i v = _mm_loadu_si128(&d[i]);
+				_mm_storeu_si128(&d[i], glyph_blend_sse2(v, m[i], keepv, setv));
+			}
+		}
+	}
+
+	return x;
+}
+#endif
+
+void gdi_glyph_blend_row(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT mask, size_t width,
+                         size_t bpp, const BYTE* keep, const BYTE* set)
+{
+	size_t x = 0;
+
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(mask);
+	WINPR_ASSERT(keep);
+	WINPR_ASSERT(set);
+	WINPR_ASSERT((bpp > 0) && (bpp <= 4));
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	x = glyph_blend_row_sse2(dst, mask, width, bpp, keep, set);
+#endif
+
+	/* constant pixel sizes let the compiler unroll the byte loop */
+	switch (bpp)
+	{
+		case 4:
+			glyph_blend_pixels(&dst[x * 4], &mask[x], width - x, 4, keep, set);
+			break;
+
+		case 3:
+			glyph_blend_pixels(&dst[x * 3], &mask[x], width - x, 3, keep, set);
+			break;
+
+		case 2:
+			glyph_blend_pixels(&dst[x * 2], &mask[x], width - x, 2, keep, set);
+			break;
+
+		default:
+			glyph_blend_pixels(&dst[x * bpp], &mask[x], width - x, bpp, keep, set);
+			break;
+	}
+}
@@ -0,0 +1,44 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Glyph Runs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_GDI_GLYPH_H
+#define FREERDP_LIB_GDI_GLYPH_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief blends a row of an expanded glyph mask (0x00 or 0xFF per pixel, see
+	 *  freerdp_glyph_convert_ex) into dst.
+	 *
+	 *  Every pixel becomes (dst & keep) | set, keep and set hold two pixels of bpp bytes
+	 *  each, the first for an unset mask and the second for a set one.
+	 */
+	FREERDP_LOCAL void gdi_glyph_blend_row(BYTE* WINPR_RESTRICT dst,
+	                                       const BYTE* WINPR_RESTRICT mask, size_t width,
+	                                       size_t bpp, const BYTE* keep, const BYTE* set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_LIB_GDI_GLYPH_H */
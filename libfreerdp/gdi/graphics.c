@@ -33,7 +33,9 @@
 #include "clipping.h"
 #include "drawing.h"
 #include "brush.h"
+#include "glyph.h"
 #include "graphics.h"
+#include "rop.h"
 
 #define TAG FREERDP_TAG("gdi")
 /* Bitmap Class */
@@ -373,6 +375,150 @@ static BOOL gdi_Glyph_Draw(rdpContext* context, const rdpGlyph* glyph, INT32 x,
 	return rc;
 }
 
+/* The part of a glyph cell gdi_Glyph_Draw writes to, clipped to the surface and the glyph */
+static BOOL gdi_Glyph_Clip(const rdpGlyphRunEntry* entry, const gdiGlyph* gdi_glyph,
+                           HGDI_BITMAP bmp, GDI_RECT* rect, INT32* sx, INT32* sy)
+{
+	const INT32 left = MAX(entry->x, 0);
+	const INT32 top = MAX(entry->y, 0);
+
+	*sx = entry->sx + left - entry->x;
+	*sy = entry->sy + top - entry->y;
+	rect->left = left;
+	rect->top = top;
+	rect->right = MIN(MIN(entry->x + entry->w, bmp->width), left + gdi_glyph->bitmap->width - *sx);
+	rect->bottom =
+	    MIN(MIN(entry->y + entry->h, bmp->height), top + gdi_glyph->bitmap->height - *sy);
+
+	return (*sx >= 0) && (*sy >= 0) && (rect->left < rect->right) && (rect->top < rect->bottom);
+}
+
+/* gdi_Glyph_Draw only fills cells that are wider and higher than a single pixel */
+static BOOL gdi_Glyph_HasBackground(const rdpGlyphRunEntry* entry)
+{
+	const INT32 left = MAX(entry->x, 0);
+	const INT32 top = MAX(entry->y, 0);
+	const INT32 right = (entry->x + entry->w > 0) ? entry->x + entry->w - 1 : 0;
+	const INT32 bottom = (entry->y + entry->h > 0) ? entry->y + entry->h - 1 : 0;
+
+	return (left < right) && (top < bottom);
+}
+
+/* Draws a text run row by row instead of a brush and a GDI_GLYPH_ORDER BitBlt per glyph.
+ * The glyph bitmaps already hold one mask byte per pixel, so every row of a glyph is a
+ * blend of the destination or background with two constants per mask value. */
+static BOOL gdi_Glyph_DrawRun(rdpContext* context, const rdpGlyphRunEntry* entries, size_t count,
+                              BOOL fOpRedundant)
+{
+	GDI_RECT bounds = { GDIOBJECT_RECT, INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+	GDI_RECT rect = { 0 };
+	INT32 sx = 0;
+	INT32 sy = 0;
+
+	if (!context || !context->gdi || (!entries && (count > 0)))
+		return FALSE;
+
+	rdpGdi* gdi = context->gdi;
+
+	if (!gdi->drawing || !gdi->drawing->hdc)
+		return FALSE;
+
+	HGDI_DC hdc = gdi->drawing->hdc;
+	HGDI_BITMAP bmp = (HGDI_BITMAP)hdc->selectedObject;
+
+	/* clipped drawing and formats the row kernels do not handle take the per glyph path */
+	if (!bmp || !hdc->clip->null || !gdi_rop3_format_supported(hdc->format))
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const rdpGlyphRunEntry* e = &entries[i];
+			if (!gdi_Glyph_Draw(context, e->glyph, e->x, e->y, e->w, e->h, e->sx, e->sy,
+			                    fOpRedundant))
+				return FALSE;
+		}
+		return TRUE;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const rdpGlyphRunEntry* e = &entries[i];
+
+		if (!gdi_Glyph_Clip(e, (const gdiGlyph*)e->glyph, bmp, &rect, &sx, &sy))
+			continue;
+
+		bounds.left = MIN(bounds.left, rect.left);
+		bounds.top = MIN(bounds.top, rect.top);
+		bounds.right = MAX(bounds.right, rect.right);
+		bounds.bottom = MAX(bounds.bottom, rect.bottom);
+	}
+
+	if ((bounds.left >= bounds.right) || (bounds.top >= bounds.bottom))
+		return TRUE;
+
+	/* GDI_GLYPH_ORDER is SPaDSnao, (S & P) | (D & ~S) per bit with P the text color and S the
+	 * mono mask converted like gdi_BitBlt does. With only two source values every pixel is
+	 * (D & keep) | set, a cell with background starts from the background color instead. */
+	const UINT32 format = hdc->format;
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	BYTE pat[4] = { 0 };
+	BYTE bg[4] = { 0 };
+	BYTE keep[8] = { 0 };
+	BYTE set[8] = { 0 };
+	BYTE fillKeep[8] = { 0 };
+	BYTE fillSet[8] = { 0 };
+
+	if (!FreeRDPWriteColor(pat, format, hdc->textColor) ||
+	    !FreeRDPWriteColor(bg, format, hdc->bkColor))
+		return FALSE;
+
+	for (size_t m = 0; m < 2; m++)
+	{
+		const BYTE value = m ? 0xFF : 0x00;
+		BYTE src[4] = { 0 };
+		UINT32 color = FreeRDPReadColor(&value, PIXEL_FORMAT_MONO);
+		color = FreeRDPConvertColor(color, PIXEL_FORMAT_MONO, format, &gdi->palette);
+		if (!FreeRDPWriteColor(src, format, color))
+			return FALSE;
+
+		for (size_t b = 0; b < bpp; b++)
+		{
+			keep[m * bpp + b] = (BYTE)~src[b];
+			set[m * bpp + b] = src[b] & pat[b];
+			fillSet[m * bpp + b] = (src[b] & pat[b]) | (bg[b] & (BYTE)~src[b]);
+		}
+	}
+
+	for (INT32 y = bounds.top; y < bounds.bottom; y++)
+	{
+		BYTE* row = &bmp->data[1ull * WINPR_ASSERTING_INT_CAST(size_t, y) * bmp->scanline];
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const rdpGlyphRunEntry* e = &entries[i];
+			const gdiGlyph* gdi_glyph = (const gdiGlyph*)e->glyph;
+
+			if (!gdi_Glyph_Clip(e, gdi_glyph, bmp, &rect, &sx, &sy))
+				continue;
+
+			if ((y < rect.top) || (y >= rect.bottom))
+				continue;
+
+			const HGDI_BITMAP mask = gdi_glyph->bitmap;
+			const size_t my = WINPR_ASSERTING_INT_CAST(size_t, sy + y - rect.top);
+			const size_t mx = WINPR_ASSERTING_INT_CAST(size_t, sx);
+			const BOOL fill = !fOpRedundant && gdi_Glyph_HasBackground(e);
+
+			gdi_glyph_blend_row(&row[WINPR_ASSERTING_INT_CAST(size_t, rect.left) * bpp],
+			                    &mask->data[my * mask->scanline + mx],
+			                    WINPR_ASSERTING_INT_CAST(size_t, rect.right - rect.left), bpp,
+			                    fill ? fillKeep : keep, fill ? fillSet : set);
+		}
+	}
+
+	return gdi_InvalidateRegion(hdc, bounds.left, bounds.top, bounds.right - bounds.left,
+	                            bounds.bottom - bounds.top);
+}
+
 static BOOL gdi_Glyph_BeginDraw(rdpContext* context, INT32 x, INT32 y, INT32 width, INT32 height,
                                 UINT32 bgcolor, UINT32 fgcolor, BOOL fOpRedundant)
 {
@@ -466,6 +612,7 @@ BOOL gdi_register_graphics(rdpGraphics* graphics)
 	glyph.Draw = gdi_Glyph_Draw;
 	glyph.BeginDraw = gdi_Glyph_BeginDraw;
 	glyph.EndDraw = gdi_Glyph_EndDraw;
+	glyph.DrawRun = gdi_Glyph_DrawRun;
 	graphics_register_glyph(graphics, &glyph);
 	return TRUE;
 }
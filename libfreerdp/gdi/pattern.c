@@ -0,0 +1,205 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Pattern Brush Fills
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/cast.h>
+
+#include <freerdp/codec/color.h>
+
+#include "pattern.h"
+#include "../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#elif defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+#endif
+
+/* A tile row repeating within this many vectors is kept in registers and stored over the whole
+ * destination row, an 8 pixel pattern needs 1 (16bpp), 3 (24bpp) or 2 (32bpp) */
+#define GDI_PATTERN_MAX_VECS 4
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+typedef __m128i pattern_vec;
+
+static inline pattern_vec pattern_load(const BYTE* p)
+{
+	return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void pattern_store(BYTE* p, pattern_vec v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+}
+#elif defined(NEON_INTRINSICS_ENABLED)
+typedef uint8x16_t pattern_vec;
+
+static inline pattern_vec pattern_load(const BYTE* p)
+{
+	return vld1q_u8(p);
+}
+
+static inline void pattern_store(BYTE* p, pattern_vec v)
+{
+	vst1q_u8(p, v);
+}
+#else
+typedef UINT64 pattern_vec;
+
+static inline pattern_vec pattern_load(const BYTE* p)
+{
+	pattern_vec v = 0;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void pattern_store(BYTE* p, pattern_vec v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+#endif
+
+static size_t pattern_gcd(size_t a, size_t b)
+{
+	while (b != 0)
+	{
+		const size_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static inline UINT32 pattern_phase(UINT32 x, INT32 org, UINT32 size)
+{
+	const INT64 d = ((INT64)x - org) % (INT64)size;
+	return WINPR_ASSERTING_INT_CAST(UINT32, (d < 0) ? d + size : d);
+}
+
+BOOL gdi_pattern_tile_init(gdiPatternTile* tile, const GDI_BITMAP* pattern, UINT32 format)
+{
+	WINPR_ASSERT(tile);
+
+	if (!pattern || !pattern->data)
+		return FALSE;
+
+	if ((pattern->width <= 0) || (pattern->width > GDI_PATTERN_MAX_SIZE) ||
+	    (pattern->height <= 0) || (pattern->height > GDI_PATTERN_MAX_SIZE))
+		return FALSE;
+
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	const size_t patternBpp = FreeRDPGetBytesPerPixel(pattern->format);
+	if ((bpp == 0) || (bpp > 4) || (patternBpp == 0))
+		return FALSE;
+
+	tile->format = format;
+	tile->width = WINPR_ASSERTING_INT_CAST(UINT32, pattern->width);
+	tile->height = WINPR_ASSERTING_INT_CAST(UINT32, pattern->height);
+	tile->bpp = bpp;
+
+	const size_t period = tile->width * bpp;
+	const size_t bytes = (GDI_PATTERN_SPAN + tile->width) * bpp;
+	tile->span = (GDI_PATTERN_SPAN / tile->width) * period;
+
+	const size_t repeat = period / pattern_gcd(period, sizeof(pattern_vec)) * sizeof(pattern_vec);
+	tile->vecs = repeat / sizeof(pattern_vec);
+	if (tile->vecs > GDI_PATTERN_MAX_VECS)
+		tile->vecs = 0;
+
+	for (UINT32 y = 0; y < tile->height; y++)
+	{
+		BYTE* row = tile->rows[y];
+		const BYTE* src = &pattern->data[1ull * y * pattern->scanline];
+
+		/* like on the per pixel path the unused bit of RGB15 formats is cleared */
+		if ((pattern->format == format) && (FreeRDPGetBitsPerPixel(format) % 8 == 0))
+			memcpy(row, src, period);
+		else
+		{
+			for (UINT32 x = 0; x < tile->width; x++)
+			{
+				const UINT32 color = FreeRDPReadColor(&src[x * patternBpp], pattern->format);
+				FreeRDPWriteColor(&row[x * bpp], format,
+				                  FreeRDPConvertColor(color, pattern->format, format, NULL));
+			}
+		}
+
+		for (size_t x = period; x < bytes; x += period)
+			memcpy(&row[x], row, MIN(period, bytes - x));
+	}
+
+	return TRUE;
+}
+
+/* stores the vecs vectors at src over dst, returns the bytes written */
+static inline size_t pattern_store_row(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT src,
+                                       size_t bytes, size_t vecs)
+{
+	pattern_vec v[GDI_PATTERN_MAX_VECS];
+	const size_t step = vecs * sizeof(pattern_vec);
+	size_t off = 0;
+
+	for (size_t x = 0; x < vecs; x++)
+		v[x] = pattern_load(&src[x * sizeof(pattern_vec)]);
+
+	for (; off + step <= bytes; off += step)
+	{
+		for (size_t x = 0; x < vecs; x++)
+			pattern_store(&dst[off + x * sizeof(pattern_vec)], v[x]);
+	}
+	return off;
+}
+
+void gdi_pattern_tile_row(const gdiPatternTile* tile, BYTE* WINPR_RESTRICT dst, UINT32 x,
+                          UINT32 y, INT32 nXOrg, INT32 nYOrg, size_t width)
+{
+	WINPR_ASSERT(tile);
+	WINPR_ASSERT(dst);
+
+	const UINT32 px = pattern_phase(x, nXOrg, tile->width);
+	const UINT32 py = pattern_phase(y, nYOrg, tile->height);
+	const BYTE* src = &tile->rows[py][px * tile->bpp];
+	const size_t bytes = width * tile->bpp;
+	size_t off = 0;
+
+	/* every chunk starts at the same pattern column, the tail is the start of a chunk */
+	switch (tile->vecs)
+	{
+		case 1:
+			off = pattern_store_row(dst, src, bytes, 1);
+			break;
+		case 2:
+			off = pattern_store_row(dst, src, bytes, 2);
+			break;
+		case 3:
+			off = pattern_store_row(dst, src, bytes, 3);
+			break;
+		case 4:
+			off = pattern_store_row(dst, src, bytes, 4);
+			break;
+		default:
+			for (; off + tile->span <= bytes; off += tile->span)
+				memcpy(&dst[off], src, tile->span);
+			break;
+	}
+
+	memcpy(&dst[off], src, bytes - off);
+}
@@ -0,0 +1,79 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Pattern Brush Fills
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_GDI_PATTERN_H
+#define FREERDP_LIB_GDI_PATTERN_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+#include <freerdp/gdi/gdi.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* RDP brushes are 8x8, larger pattern bitmaps take the per pixel path */
+#define GDI_PATTERN_MAX_SIZE 8
+/* pixels of a tile row that are written with one copy */
+#define GDI_PATTERN_SPAN 64
+#define GDI_PATTERN_ROW_BYTES ((GDI_PATTERN_SPAN + GDI_PATTERN_MAX_SIZE) * 4)
+
+	/** A brush bitmap converted to a destination format with every row repeated to
+	 *  GDI_PATTERN_SPAN pixels plus one pattern width, so that a destination row starting at any
+	 *  pattern column is a plain copy of a tile row. */
+	typedef struct
+	{
+		UINT32 format;
+		UINT32 width;
+		UINT32 height;
+		size_t bpp;
+		size_t span; /* bytes of whole pattern rows that fit GDI_PATTERN_SPAN pixels */
+		size_t vecs; /* vectors after which a row repeats, 0 if it is copied in spans */
+		BYTE rows[GDI_PATTERN_MAX_SIZE][GDI_PATTERN_ROW_BYTES];
+	} gdiPatternTile;
+
+	/** @brief expands pattern to tile in format.
+	 *
+	 *  Fails for patterns larger than GDI_PATTERN_MAX_SIZE and for formats with less than
+	 *  a byte per pixel, callers keep their per pixel implementation for these. */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL gdi_pattern_tile_init(gdiPatternTile* tile, const GDI_BITMAP* pattern,
+	                                         UINT32 format);
+
+	/** @brief writes width pixels of the tile to dst, the pixels of destination row y starting
+	 *  at column x with the brush origin at nXOrg, nYOrg (see gdi_get_brush_pointer) */
+	FREERDP_LOCAL void gdi_pattern_tile_row(const gdiPatternTile* tile, BYTE* WINPR_RESTRICT dst,
+	                                        UINT32 x, UINT32 y, INT32 nXOrg, INT32 nYOrg,
+	                                        size_t width);
+
+	/** @brief gdi_BitBlt with the pattern of the brush selected in hdcDest taken from tile.
+	 *
+	 *  tile must be expanded from that brush in the format of hdcDest, NULL expands it when
+	 *  the ROP needs it. */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL gdi_pattern_bitblt(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest,
+	                                      INT32 nWidth, INT32 nHeight, HGDI_DC hdcSrc,
+	                                      INT32 nXSrc, INT32 nYSrc, DWORD rop,
+	                                      const gdiPatternTile* tile, const gdiPalette* palette);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_LIB_GDI_PATTERN_H */
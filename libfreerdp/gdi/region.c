@@ -604,6 +604,124 @@ inline BOOL gdi_PtInRect(const GDI_RECT* rc, INT32 x, INT32 y)
 	return FALSE;
 }
 
+static INT64 gdi_rgn_area(const GDI_RGN* rgn)
+{
+	return 1ll * rgn->w * rgn->h;
+}
+
+static BOOL gdi_rgn_contains(const GDI_RGN* outer, const GDI_RGN* inner)
+{
+	return (outer->x <= inner->x) && (outer->y <= inner->y) &&
+	       (1ll * outer->x + outer->w >= 1ll * inner->x + inner->w) &&
+	       (1ll * outer->y + outer->h >= 1ll * inner->y + inner->h);
+}
+
+static void gdi_rgn_union(const GDI_RGN* a, const GDI_RGN* b, GDI_RGN* u)
+{
+	const INT64 right = MAX(1ll * a->x + a->w, 1ll * b->x + b->w);
+	const INT64 bottom = MAX(1ll * a->y + a->h, 1ll * b->y + b->h);
+
+	u->x = MIN(a->x, b->x);
+	u->y = MIN(a->y, b->y);
+	u->w = (INT32)MIN(right - u->x, INT32_MAX);
+	u->h = (INT32)MIN(bottom - u->y, INT32_MAX);
+	u->null = FALSE;
+}
+
+/* pixels that are not invalid but pushed if a and b are replaced by their bounding box */
+static INT64 gdi_rgn_merge_waste(const GDI_RGN* a, const GDI_RGN* b)
+{
+	GDI_RGN u = { 0 };
+	const INT64 iw = MIN(1ll * a->x + a->w, 1ll * b->x + b->w) - MAX(a->x, b->x);
+	const INT64 ih = MIN(1ll * a->y + a->h, 1ll * b->y + b->h) - MAX(a->y, b->y);
+	const INT64 overlap = ((iw > 0) && (ih > 0)) ? iw * ih : 0;
+
+	gdi_rgn_union(a, b, &u);
+	return gdi_rgn_area(&u) - (gdi_rgn_area(a) + gdi_rgn_area(b) - overlap);
+}
+
+/* Adds rgn to the damage list. Rectangles that overlap, touch or are close enough that their
+ * bounding box wastes no more than GDI_INVALID_RECT_COST pixels are merged. A full list merges
+ * rgn with the rectangle that wastes the fewest pixels instead of growing. */
+static BOOL gdi_invalid_add(HGDI_WND hwnd, GDI_RGN rgn)
+{
+	size_t n = WINPR_ASSERTING_INT_CAST(size_t, hwnd->ninvalid);
+	GDI_RGN* cinvalid = hwnd->cinvalid;
+
+	for (;;)
+	{
+		BOOL merged = FALSE;
+
+		/* the latest rectangles are at the end and the most likely neighbours */
+		for (size_t i = n; i-- > 0;)
+		{
+			const GDI_RGN* cur = &cinvalid[i];
+
+			if (gdi_rgn_contains(cur, &rgn))
+				return TRUE;
+
+			if (gdi_rgn_merge_waste(cur, &rgn) <= GDI_INVALID_RECT_COST)
+			{
+				gdi_rgn_union(cur, &rgn, &rgn);
+				cinvalid[i] = cinvalid[--n];
+				merged = TRUE;
+				break;
+			}
+		}
+
+		/* a grown rectangle might now be mergeable with ones checked before */
+		if (merged)
+			continue;
+
+		if (n < GDI_INVALID_MAX_RECTS)
+			break;
+
+		size_t best = 0;
+		INT64 waste = INT64_MAX;
+		for (size_t i = 0; i < n; i++)
+		{
+			const INT64 cur = gdi_rgn_merge_waste(&cinvalid[i], &rgn);
+			if (cur < waste)
+			{
+				waste = cur;
+				best = i;
+			}
+		}
+
+		gdi_rgn_union(&cinvalid[best], &rgn, &rgn);
+		cinvalid[best] = cinvalid[--n];
+	}
+
+	if (n + 1 > hwnd->count)
+	{
+		const size_t new_cnt = MIN(MAX(2ULL * hwnd->count, 32), GDI_INVALID_MAX_RECTS);
+		GDI_RGN* new_rgn = (GDI_RGN*)realloc(cinvalid, sizeof(GDI_RGN) * new_cnt);
+
+		if (!new_rgn)
+			return FALSE;
+
+		hwnd->count = (UINT32)new_cnt;
+		hwnd->cinvalid = cinvalid = new_rgn;
+	}
+
+	cinvalid[n++] = rgn;
+	hwnd->ninvalid = (INT32)n;
+	return TRUE;
+}
+
+UINT64 gdi_InvalidRegionCost(const GDI_WND* hwnd)
+{
+	UINT64 cost = 0;
+
+	if (!hwnd)
+		return 0;
+
+	for (INT32 i = 0; i < hwnd->ninvalid; i++)
+		cost += (UINT64)gdi_rgn_area(&hwnd->cinvalid[i]) + GDI_INVALID_RECT_COST;
+
+	return cost;
+}
+
 /**
  * Invalidate a given region, such that it is redrawn on the next region update.
  * msdn{dd145003}
@@ -619,8 +737,8 @@ inline BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h
 {
 	GDI_RECT inv;
 	GDI_RECT rgn;
+	GDI_RGN cur = { 0 };
 	GDI_RGN* invalid = NULL;
-	GDI_RGN* cinvalid = NULL;
 
 	if (!hdc->hwnd)
 		return TRUE;
@@ -631,30 +749,14 @@ inline BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h
 	if (w == 0 || h == 0)
 		return TRUE;
 
-	cinvalid = hdc->hwnd->cinvalid;
-
-	if ((hdc->hwnd->ninvalid + 1) > (INT64)hdc->hwnd->count)
-	{
-		GDI_RGN* new_rgn = NULL;
-		size_t new_cnt = 2ULL * hdc->hwnd->count;
-		if (new_cnt > UINT32_MAX)
-			return FALSE;
-
-		new_rgn = (GDI_RGN*)realloc(cinvalid, sizeof(GDI_RGN) * new_cnt);
-
-		if (!new_rgn)
-			return FALSE;
+	if (!gdi_SetRgn(&cur, x, y, w, h))
+		return FALSE;
 
-		hdc->hwnd->count = (UINT32)new_cnt;
-		cinvalid = new_rgn;
-	}
+	if (!gdi_invalid_add(hdc->hwnd, cur))
+		return FALSE;
 
-	hdc->hwnd->cinvalid = cinvalid;
 	invalid = hdc->hwnd->invalid;
 
-	if (!gdi_SetRgn(&cinvalid[hdc->hwnd->ninvalid++], x, y, w, h))
-		return FALSE;
-
 	if (!gdi_CRgnToRect(x, y, w, h, &rgn))
 	{
 		invalid->x = 0;
@@ -0,0 +1,295 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Ternary Raster Operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+
+#include <freerdp/codec/color.h>
+
+#include "rop.h"
+#include "../core/simd.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#elif defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+#endif
+
+/* Rows are processed in blocks, every operation of the program is applied to a whole block
+ * before the next one, so the per operation dispatch is paid once per block and not per pixel.
+ * All operations are bitwise, so pixels are just bytes here. */
+#define GDI_ROP3_BLOCK 256
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+typedef __m128i rop_vec;
+
+static inline rop_vec rop_load(const BYTE* p)
+{
+	return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void rop_store(BYTE* p, rop_vec v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+}
+
+#define rop_and(a, b) _mm_and_si128((a), (b))
+#define rop_or(a, b) _mm_or_si128((a), (b))
+#define rop_xor(a, b) _mm_xor_si128((a), (b))
+#define rop_not(a) _mm_xor_si128((a), _mm_set1_epi32(-1))
+#elif defined(NEON_INTRINSICS_ENABLED)
+typedef uint8x16_t rop_vec;
+
+static inline rop_vec rop_load(const BYTE* p)
+{
+	return vld1q_u8(p);
+}
+
+static inline void rop_store(BYTE* p, rop_vec v)
+{
+	vst1q_u8(p, v);
+}
+
+#define rop_and(a, b) vandq_u8((a), (b))
+#define rop_or(a, b) vorrq_u8((a), (b))
+#define rop_xor(a, b) veorq_u8((a), (b))
+#define rop_not(a) vmvnq_u8((a))
+#else
+typedef UINT64 rop_vec;
+
+static inline rop_vec rop_load(const BYTE* p)
+{
+	rop_vec v = 0;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void rop_store(BYTE* p, rop_vec v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+#define rop_and(a, b) ((a) & (b))
+#define rop_or(a, b) ((a) | (b))
+#define rop_xor(a, b) ((a) ^ (b))
+#define rop_not(a) (~(a))
+#endif
+
+#define GDI_ROP3_VECS (GDI_ROP3_BLOCK / sizeof(rop_vec))
+
+BOOL gdi_rop3_compile(const char* rop, gdiRop3Program* program)
+{
+	size_t depth = 0;
+
+	WINPR_ASSERT(program);
+
+	const gdiRop3Program empty = { 0 };
+	*program = empty;
+
+	if (!rop)
+		return FALSE;
+
+	for (; *rop != '\0'; rop++)
+	{
+		if (program->count >= GDI_ROP3_MAX_OPS)
+			return FALSE;
+
+		switch (*rop)
+		{
+			case 'S':
+				program->useSrc = TRUE;
+				depth++;
+				break;
+
+			case 'P':
+				program->usePat = TRUE;
+				depth++;
+				break;
+
+			case '0':
+			case '1':
+				program->useConst = TRUE;
+				depth++;
+				break;
+
+			case 'D':
+				depth++;
+				break;
+
+			case 'n':
+				if (depth < 1)
+					return FALSE;
+				break;
+
+			case 'a':
+			case 'o':
+			case 'x':
+				if (depth < 2)
+					return FALSE;
+				depth--;
+				break;
+
+			default:
+				return FALSE;
+		}
+
+		if (depth > GDI_ROP3_MAX_DEPTH)
+			return FALSE;
+
+		program->ops[program->count++] = *rop;
+	}
+
+	return depth == 1;
+}
+
+BOOL gdi_rop3_format_supported(UINT32 format)
+{
+	switch (FreeRDPGetBitsPerPixel(format))
+	{
+		case 16:
+		case 24:
+		case 32:
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static inline void rop3_load_block(rop_vec* WINPR_RESTRICT v, const BYTE* WINPR_RESTRICT p,
+                                   size_t vecs)
+{
+	for (size_t x = 0; x < vecs; x++)
+		v[x] = rop_load(&p[x * sizeof(rop_vec)]);
+}
+
+static void rop3_block(const gdiRop3Program* program, BYTE* WINPR_RESTRICT dst,
+                       const BYTE* WINPR_RESTRICT src, const BYTE* WINPR_RESTRICT pat,
+                       const BYTE* WINPR_RESTRICT black, const BYTE* WINPR_RESTRICT white,
+                       size_t vecs)
+{
+	rop_vec stack[GDI_ROP3_MAX_DEPTH][GDI_ROP3_VECS];
+	size_t sp = 0;
+
+	for (size_t i = 0; i < program->count; i++)
+	{
+		switch (program->ops[i])
+		{
+			case 'D':
+				rop3_load_block(stack[sp++], dst, vecs);
+				break;
+
+			case 'S':
+				rop3_load_block(stack[sp++], src, vecs);
+				break;
+
+			case 'P':
+				rop3_load_block(stack[sp++], pat, vecs);
+				break;
+
+			case '0':
+				rop3_load_block(stack[sp++], black, vecs);
+				break;
+
+			case '1':
+				rop3_load_block(stack[sp++], white, vecs);
+				break;
+
+			case 'n':
+			{
+				rop_vec* a = stack[sp - 1];
+				for (size_t x = 0; x < vecs; x++)
+					a[x] = rop_not(a[x]);
+			}
+			break;
+
+			case 'a':
+			{
+				rop_vec* a = stack[sp - 2];
+				const rop_vec* b = stack[--sp];
+				for (size_t x = 0; x < vecs; x++)
+					a[x] = rop_and(a[x], b[x]);
+			}
+			break;
+
+			case 'o':
+			{
+				rop_vec* a = stack[sp - 2];
+				const rop_vec* b = stack[--sp];
+				for (size_t x = 0; x < vecs; x++)
+					a[x] = rop_or(a[x], b[x]);
+			}
+			break;
+
+			case 'x':
+			{
+				rop_vec* a = stack[sp - 2];
+				const rop_vec* b = stack[--sp];
+				for (size_t x = 0; x < vecs; x++)
+					a[x] = rop_xor(a[x], b[x]);
+			}
+			break;
+
+			default:
+				break;
+		}
+	}
+
+	for (size_t x = 0; x < vecs; x++)
+		rop_store(&dst[x * sizeof(rop_vec)], stack[0][x]);
+}
+
+void gdi_rop3_row(const gdiRop3Program* program, BYTE* WINPR_RESTRICT dst,
+                  const BYTE* WINPR_RESTRICT src, const BYTE* WINPR_RESTRICT pat,
+                  const BYTE* WINPR_RESTRICT black, const BYTE* WINPR_RESTRICT white, size_t bytes)
+{
+	WINPR_ASSERT(program);
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(!program->useSrc || src);
+	WINPR_ASSERT(!program->usePat || pat);
+	WINPR_ASSERT(!program->useConst || (black && white));
+
+	size_t off = 0;
+	for (; off + GDI_ROP3_BLOCK <= bytes; off += GDI_ROP3_BLOCK)
+		rop3_block(program, &dst[off], src ? &src[off] : NULL, pat ? &pat[off] : NULL,
+		           black ? &black[off] : NULL, white ? &white[off] : NULL, GDI_ROP3_VECS);
+
+	if (off < bytes)
+	{
+		/* the tail of the row is padded to whole vectors in scratch memory */
+		BYTE tmp[5][GDI_ROP3_BLOCK];
+		const size_t len = bytes - off;
+		const size_t vecs = (len + sizeof(rop_vec) - 1) / sizeof(rop_vec);
+		const BYTE* rows[5] = { dst, program->useSrc ? src : NULL, program->usePat ? pat : NULL,
+			                    program->useConst ? black : NULL,
+			                    program->useConst ? white : NULL };
+
+		for (size_t x = 0; x < ARRAYSIZE(tmp); x++)
+		{
+			if (!rows[x])
+				continue;
+			memcpy(tmp[x], &rows[x][off], len);
+			memset(&tmp[x][len], 0, vecs * sizeof(rop_vec) - len);
+		}
+
+		rop3_block(program, tmp[0], tmp[1], tmp[2], tmp[3], tmp[4], vecs);
+		memcpy(&dst[off], tmp[0], len);
+	}
+}
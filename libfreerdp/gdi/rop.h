@@ -0,0 +1,68 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * GDI Ternary Raster Operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_GDI_ROP_H
+#define FREERDP_LIB_GDI_ROP_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define GDI_ROP3_MAX_OPS 16
+#define GDI_ROP3_MAX_DEPTH 6
+
+	/** A ROP3 reverse polish string (see gdi_rop_to_string) compiled to a list of operations
+	 *  that are applied to whole rows. */
+	typedef struct
+	{
+		char ops[GDI_ROP3_MAX_OPS];
+		size_t count;
+		BOOL useSrc;
+		BOOL usePat;
+		BOOL useConst; /* '0' or '1', black or white in the destination format */
+	} gdiRop3Program;
+
+	/** @brief compiles a ROP3 string, fails for unknown operators or an unbalanced stack */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL gdi_rop3_compile(const char* rop, gdiRop3Program* program);
+
+	/** @brief TRUE if rows of format can be combined byte by byte.
+	 *  Formats with less than 16bpp or with the unused bit of 15bpp formats cleared on write
+	 *  need the per pixel implementation. */
+	WINPR_ATTR_NODISCARD
+	FREERDP_LOCAL BOOL gdi_rop3_format_supported(UINT32 format);
+
+	/** @brief applies program to bytes of dst.
+	 *
+	 *  src, pat, black and white are rows of the same size in the destination format, only the
+	 *  ones the program uses are accessed. */
+	FREERDP_LOCAL void gdi_rop3_row(const gdiRop3Program* program, BYTE* WINPR_RESTRICT dst,
+	                                const BYTE* WINPR_RESTRICT src,
+	                                const BYTE* WINPR_RESTRICT pat,
+	                                const BYTE* WINPR_RESTRICT black,
+	                                const BYTE* WINPR_RESTRICT white, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_LIB_GDI_ROP_H */
@@ -35,6 +35,7 @@
 #include <freerdp/log.h>
 
 #include "clipping.h"
+#include "pattern.h"
 #include "../gdi/gdi.h"
 
 #define TAG FREERDP_TAG("gdi.shape")
@@ -121,6 +122,40 @@ BOOL gdi_Ellipse(HGDI_DC hdc, int nLeftRect, int nTopRect, int nRightRect, int n
 	return Ellipse_Bresenham(hdc, nLeftRect, nTopRect, nRightRect, nBottomRect);
 }
 
+/* Per pixel fill for pattern bitmaps that do not fit a gdiPatternTile */
+static BOOL gdi_FillRect_pattern(HGDI_DC hdc, INT32 nXDest, INT32 nYDest, INT32 nWidth,
+                                 INT32 nHeight, HGDI_BRUSH hbr)
+{
+	const HGDI_BITMAP pattern = hbr->pattern;
+	const UINT32 formatSize = FreeRDPGetBytesPerPixel(pattern->format);
+	if ((formatSize == 0) || (pattern->width <= 0) || (pattern->height <= 0))
+		return FALSE;
+
+	const INT64 w = pattern->width;
+	const INT64 h = pattern->height;
+
+	for (INT32 y = 0; y < nHeight; y++)
+	{
+		const INT64 py = (((1LL * nYDest + y - hbr->nYOrg) % h) + h) % h;
+		const BYTE* row = &pattern->data[1ull * WINPR_ASSERTING_INT_CAST(size_t, py) *
+		                                 pattern->scanline];
+
+		for (INT32 x = 0; x < nWidth; x++)
+		{
+			const INT64 px = (((1LL * nXDest + x - hbr->nXOrg) % w) + w) % w;
+			const BYTE* patp = &row[1ull * WINPR_ASSERTING_INT_CAST(size_t, px) * formatSize];
+			UINT32 dstColor = FreeRDPReadColor(patp, pattern->format);
+			if (pattern->format != hdc->format)
+				dstColor = FreeRDPConvertColor(dstColor, pattern->format, hdc->format, NULL);
+
+			BYTE* dstp = gdi_get_bitmap_pointer(hdc, nXDest + x, nYDest + y);
+			if (dstp)
+				FreeRDPWriteColor(dstp, hdc->format, dstColor);
+		}
+	}
+	return TRUE;
+}
+
 /**
  * Fill a rectangle with the given brush.
  * msdn{dd162719}
@@ -180,47 +215,22 @@ BOOL gdi_FillRect(HGDI_DC hdc, const GDI_RECT* rect, HGDI_BRUSH hbr)
 		case GDI_BS_HATCHED:
 		case GDI_BS_PATTERN:
 		{
-			const BOOL monochrome = (hbr->pattern->format == PIXEL_FORMAT_MONO);
-			const UINT32 formatSize = FreeRDPGetBytesPerPixel(hbr->pattern->format);
-			if (formatSize == 0)
-				return FALSE;
+			gdiPatternTile tile;
 
-			for (INT32 y = 0; y < nHeight; y++)
+			if (gdi_pattern_tile_init(&tile, hbr->pattern, hdc->format))
 			{
-				for (INT32 x = 0; x < nWidth; x++)
+				for (INT32 y = 0; y < nHeight; y++)
 				{
-					const size_t yOffset =
-					    ((1ULL * WINPR_ASSERTING_INT_CAST(size_t, nYDest) +
-					      WINPR_ASSERTING_INT_CAST(size_t, y)) *
-					     WINPR_ASSERTING_INT_CAST(size_t, hbr->pattern->width) %
-					     WINPR_ASSERTING_INT_CAST(size_t, hbr->pattern->height)) *
-					    formatSize;
-					const size_t xOffset = ((1ULL * WINPR_ASSERTING_INT_CAST(size_t, nXDest) +
-					                         WINPR_ASSERTING_INT_CAST(size_t, x)) %
-					                        WINPR_ASSERTING_INT_CAST(size_t, hbr->pattern->width)) *
-					                       formatSize;
-					const BYTE* patp = &hbr->pattern->data[yOffset + xOffset];
-
-					UINT32 dstColor = 0;
-					if (monochrome)
-					{
-						if (*patp == 0)
-							dstColor = hdc->bkColor;
-						else
-							dstColor = hdc->textColor;
-					}
-					else
-					{
-						const UINT32 tmp = FreeRDPReadColor(patp, hbr->pattern->format);
-						dstColor =
-						    FreeRDPConvertColor(tmp, hbr->pattern->format, hdc->format, NULL);
-					}
-
-					BYTE* dstp = gdi_get_bitmap_pointer(hdc, nXDest + x, nYDest + y);
-					if (dstp)
-						FreeRDPWriteColor(dstp, hdc->format, dstColor);
+					BYTE* dstp = gdi_get_bitmap_pointer(hdc, nXDest, nYDest + y);
+					if (!dstp)
+						return FALSE;
+					gdi_pattern_tile_row(&tile, dstp, WINPR_ASSERTING_INT_CAST(UINT32, nXDest),
+					                     WINPR_ASSERTING_INT_CAST(UINT32, nYDest + y), hbr->nXOrg,
+					                     hbr->nYOrg, WINPR_ASSERTING_INT_CAST(size_t, nWidth));
 				}
 			}
+			else if (!gdi_FillRect_pattern(hdc, nXDest, nYDest, nWidth, nHeight, hbr))
+				return FALSE;
 		}
 		break;
 
@@ -7,6 +7,7 @@
 #include <freerdp/gdi/bitmap.h>
 
 #include <winpr/crt.h>
+#include <winpr/sysinfo.h>
 
 #include "line.h"
 #include "brush.h"
@@ -346,6 +347,172 @@ fail:
 	return rc;
 }
 
+static BOOL test_invalid_covered(const HGDI_WND hwnd, INT32 x, INT32 y, INT32 w, INT32 h)
+{
+	for (INT32 py = y; py < y + h; py++)
+	{
+		for (INT32 px = x; px < x + w; px++)
+		{
+			BOOL found = FALSE;
+
+			for (INT32 i = 0; (i < hwnd->ninvalid) && !found; i++)
+			{
+				const GDI_RGN* rgn = &hwnd->cinvalid[i];
+				found = (px >= rgn->x) && (px < rgn->x + rgn->w) && (py >= rgn->y) &&
+				        (py < rgn->y + rgn->h);
+			}
+
+			if (!found)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static int test_gdi_InvalidateRegionMerge(void)
+{
+	int rc = -1;
+	HGDI_DC hdc = gdi_CreateDC(PIXEL_FORMAT_XRGB32);
+
+	if (!hdc)
+		return -1;
+
+	HGDI_WND hwnd = hdc->hwnd;
+
+	/* a line of glyph cells ends up as a single rectangle */
+	for (INT32 x = 0; x < 10; x++)
+	{
+		if (!gdi_InvalidateRegion(hdc, 100 + x * 8, 50, 8, 16))
+			goto fail;
+	}
+
+	if ((hwnd->ninvalid != 1) || (hwnd->cinvalid[0].x != 100) || (hwnd->cinvalid[0].y != 50) ||
+	    (hwnd->cinvalid[0].w != 80) || (hwnd->cinvalid[0].h != 16))
+		goto fail;
+
+	/* contained */
+	if (!gdi_InvalidateRegion(hdc, 120, 52, 10, 10) || (hwnd->ninvalid != 1))
+		goto fail;
+
+	/* far away */
+	if (!gdi_InvalidateRegion(hdc, 600, 600, 10, 10) || (hwnd->ninvalid != 2))
+		goto fail;
+
+	/* merged with the line, the bounding box grows by less than GDI_INVALID_RECT_COST */
+	if (!gdi_InvalidateRegion(hdc, 180, 48, 8, 16) || (hwnd->ninvalid != 2))
+		goto fail;
+
+	hwnd->ninvalid = 0;
+	hwnd->invalid->null = TRUE;
+
+	/* random rectangles: the list stays bounded and covers all of them */
+	srand(1);
+	for (size_t i = 0; i < 2000; i++)
+	{
+		const INT32 x = rand() % 1000;
+		const INT32 y = rand() % 700;
+		const INT32 w = 1 + rand() % 24;
+		const INT32 h = 1 + rand() % 24;
+
+		if (!gdi_InvalidateRegion(hdc, x, y, w, h))
+			goto fail;
+
+		if ((hwnd->ninvalid > GDI_INVALID_MAX_RECTS) || !test_invalid_covered(hwnd, x, y, w, h))
+			goto fail;
+	}
+
+	rc = 0;
+fail:
+	gdi_DeleteDC(hdc);
+	return rc;
+}
+
+/* A frame of orders: lines of text with glyph cells, small fills and a few large blits.
+ * Prints the cost of the merged damage list against the one of all invalidated rectangles. */
+static int test_gdi_InvalidateRegionBenchmark(void)
+{
+	int rc = -1;
+	UINT64 count = 0;
+	UINT64 cost = 0;
+	UINT64 merged = 0;
+	UINT64 rects = 0;
+	HGDI_DC hdc = gdi_CreateDC(PIXEL_FORMAT_XRGB32);
+
+	if (!hdc)
+		return -1;
+
+	HGDI_WND hwnd = hdc->hwnd;
+
+	srand(2);
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (size_t frame = 0; frame < 100; frame++)
+	{
+		hwnd->ninvalid = 0;
+		hwnd->invalid->null = TRUE;
+
+		for (size_t i = 0; i < 400; i++)
+		{
+			INT32 x = rand() % 1920;
+			INT32 y = rand() % 1080;
+			INT32 w = 8;
+			INT32 h = 16;
+
+			switch (rand() % 10)
+			{
+				case 0:
+					w = 1 + rand() % 64;
+					h = 1 + rand() % 64;
+					break;
+
+				case 1:
+					if (rand() % 8 == 0)
+					{
+						w = 200 + rand() % 400;
+						h = 100 + rand() % 300;
+					}
+					break;
+
+				default:
+				{
+					/* a text line */
+					const INT32 glyphs = 10 + rand() % 70;
+					for (INT32 g = 0; g < glyphs; g++)
+					{
+						const INT32 gx = x + g * 7;
+						const INT32 gy = y + rand() % 3;
+
+						if (!gdi_InvalidateRegion(hdc, gx, gy, 7 + rand() % 3, 14))
+							goto fail;
+
+						count++;
+						cost += 14ull * 8 + GDI_INVALID_RECT_COST;
+					}
+				}
+					continue;
+			}
+
+			if (!gdi_InvalidateRegion(hdc, x, y, w, h))
+				goto fail;
+
+			count++;
+			cost += 1ull * w * h + GDI_INVALID_RECT_COST;
+		}
+
+		merged += gdi_InvalidRegionCost(hwnd);
+		rects += (UINT64)hwnd->ninvalid;
+	}
+	const UINT64 end = winpr_GetTickCount64NS();
+
+	printf("%" PRIu64 " invalidated rectangles, cost %" PRIu64 ", merged to %" PRIu64
+	       " rectangles, cost %" PRIu64 " in %" PRIu64 "ms\n",
+	       count, cost, rects, merged, (end - start) / 1000000ull);
+	rc = 0;
+
+fail:
+	gdi_DeleteDC(hdc);
+	return rc;
+}
+
 int TestGdiClip(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -360,5 +527,13 @@ int TestGdiClip(int argc, char* argv[])
 	if (test_gdi_InvalidateRegion() < 0)
 		return -1;
 
+	(void)fprintf(stderr, "test_gdi_InvalidateRegionMerge()\n");
+
+	if (test_gdi_InvalidateRegionMerge() < 0)
+		return -1;
+
+	if (test_gdi_InvalidateRegionBenchmark() < 0)
+		return -1;
+
 	return 0;
 }
@@ -0,0 +1,223 @@
+#include <freerdp/freerdp.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/graphics.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
+
+#include "../../test/test_performance.h"
+
+#define TEST_GLYPH_WIDTH 320
+#define TEST_GLYPH_HEIGHT 200
+#define TEST_GLYPH_COUNT 64
+
+static void test_glyph_instance_free(freerdp* instance)
+{
+	if (!instance)
+		return;
+
+	if (instance->context)
+	{
+		gdi_free(instance);
+		freerdp_context_free(instance);
+	}
+	freerdp_free(instance);
+}
+
+/* A gdi surface without a connection, runs draw text runs with the glyph DrawRun callback or,
+ * if disabled, with a Draw call per glyph. */
+static freerdp* test_glyph_instance_new(UINT32 format, BOOL runs)
+{
+	freerdp* instance = freerdp_new();
+	if (!instance)
+		return NULL;
+
+	if (!freerdp_context_new(instance))
+		goto fail;
+
+	rdpSettings* settings = instance->context->settings;
+	if (!freerdp_settings_set_uint32(settings, FreeRDP_DesktopWidth, TEST_GLYPH_WIDTH) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_DesktopHeight, TEST_GLYPH_HEIGHT) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_ColorDepth, 32))
+		goto fail;
+
+	if (!gdi_init(instance, format))
+		goto fail;
+
+	if (!runs)
+		instance->context->graphics->Glyph_Prototype->DrawRun = NULL;
+
+	return instance;
+
+fail:
+	test_glyph_instance_free(instance);
+	return NULL;
+}
+
+static BOOL test_glyph_cache(rdpContext* context, UINT32 seed)
+{
+	BOOL rc = FALSE;
+	BYTE aj[TEST_GLYPH_COUNT][64] = { 0 };
+	CACHE_GLYPH_ORDER order = { 0 };
+
+	order.cacheId = 0;
+	order.cGlyphs = TEST_GLYPH_COUNT;
+
+	/* the same glyphs for every instance */
+	srand(seed);
+	for (size_t i = 0; i < TEST_GLYPH_COUNT; i++)
+	{
+		GLYPH_DATA* glyph = &order.glyphData[i];
+
+		glyph->cacheIndex = (UINT32)i;
+		glyph->x = (INT16)(rand() % 5 - 2);
+		glyph->y = (INT16)(rand() % 15 - 14);
+		glyph->cx = 1 + (UINT32)rand() % 16;
+		glyph->cy = 1 + (UINT32)rand() % 16;
+		glyph->cb = (glyph->cx + 7) / 8 * glyph->cy;
+		glyph->aj = aj[i];
+
+		for (size_t x = 0; x < glyph->cb; x++)
+			aj[i][x] = (BYTE)rand();
+	}
+
+	rc = context->update->secondary->CacheGlyph(context, &order);
+	return rc;
+}
+
+static void test_glyph_order(GLYPH_INDEX_ORDER* order, UINT32 count)
+{
+	/* text starting right of the surface is rejected by update_process_glyph_fragments */
+	const INT32 x = rand() % TEST_GLYPH_WIDTH;
+	const INT32 y = rand() % (TEST_GLYPH_HEIGHT + 40) - 20;
+	const GLYPH_INDEX_ORDER empty = { 0 };
+
+	*order = empty;
+	order->cacheId = 0;
+	order->flAccel = SO_HORIZONTAL;
+	order->fOpRedundant = (rand() % 2) ? 1 : 0;
+	order->backColor = (UINT32)rand() & 0xFFFFFF;
+	order->foreColor = (UINT32)rand() & 0xFFFFFF;
+	order->x = x;
+	order->y = y;
+	order->bkLeft = x - rand() % 8;
+	order->bkTop = y - 16;
+	order->bkRight = x + rand() % (TEST_GLYPH_WIDTH / 2);
+	order->bkBottom = y + rand() % 8;
+
+	/* opaque rectangle, or none */
+	if (rand() % 3)
+	{
+		order->opLeft = order->bkLeft;
+		order->opTop = order->bkTop;
+		order->opRight = order->bkRight;
+		order->opBottom = order->bkBottom;
+	}
+
+	/* glyph index followed by the offset to the previous glyph, some glyphs overlap */
+	for (UINT32 i = 0; i < count; i++)
+	{
+		order->data[order->cbData++] = (BYTE)(rand() % TEST_GLYPH_COUNT);
+		order->data[order->cbData++] = (BYTE)(rand() % 14);
+	}
+}
+
+static BOOL test_glyph_compare(UINT32 format)
+{
+	BOOL rc = FALSE;
+	const UINT32 seed = (UINT32)time(NULL);
+	freerdp* runs = test_glyph_instance_new(format, TRUE);
+	freerdp* single = test_glyph_instance_new(format, FALSE);
+
+	if (!runs || !single)
+		goto fail;
+
+	if (!test_glyph_cache(runs->context, seed) || !test_glyph_cache(single->context, seed))
+		goto fail;
+
+	for (size_t i = 0; i < 500; i++)
+	{
+		GLYPH_INDEX_ORDER order = { 0 };
+
+		test_glyph_order(&order, 1 + (UINT32)rand() % 40);
+		if (!runs->context->update->primary->GlyphIndex(runs->context, &order) ||
+		    !single->context->update->primary->GlyphIndex(single->context, &order))
+			goto fail;
+	}
+
+	const rdpGdi* a = runs->context->gdi;
+	const rdpGdi* b = single->context->gdi;
+	if (memcmp(a->primary_buffer, b->primary_buffer, 1ull * a->stride * a->height) != 0)
+	{
+		(void)fprintf(stderr, "%s: %s glyph runs differ [seed %" PRIu32 "]\n", __func__,
+		              FreeRDPGetColorFormatName(format), seed);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	test_glyph_instance_free(runs);
+	test_glyph_instance_free(single);
+	return rc;
+}
+
+/* a text heavy stream: lines of 80 glyphs over the whole surface */
+static BOOL test_glyph_benchmark(UINT32 format, BOOL drawRun, UINT64* duration)
+{
+	BOOL rc = FALSE;
+	freerdp* instance = test_glyph_instance_new(format, drawRun);
+
+	if (!instance || !test_glyph_cache(instance->context, 0))
+		goto fail;
+
+	srand(0);
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (size_t i = 0; i < 2000; i++)
+	{
+		GLYPH_INDEX_ORDER order = { 0 };
+
+		test_glyph_order(&order, 80);
+		order.bkLeft = 0;
+		order.bkRight = TEST_GLYPH_WIDTH - 1;
+		if (!instance->context->update->primary->GlyphIndex(instance->context, &order))
+			goto fail;
+	}
+	*duration = winpr_GetTickCount64NS() - start;
+
+	rc = TRUE;
+fail:
+	test_glyph_instance_free(instance);
+	return rc;
+}
+
+int TestGdiGlyph(int argc, char* argv[])
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_BGR24, PIXEL_FORMAT_RGB16, PIXEL_FORMAT_RGB15 };
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		if (!test_glyph_compare(formats[x]))
+			return -1;
+	}
+
+	test_performance_setup(argc, argv);
+	if (!g_TestPerformance)
+		return 0;
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		UINT64 runs = 0;
+		UINT64 single = 0;
+
+		if (!test_glyph_benchmark(formats[x], TRUE, &runs) ||
+		    !test_glyph_benchmark(formats[x], FALSE, &single))
+			return -1;
+
+		printf("%s: 2000 runs of 80 glyphs %" PRIu64 "ms, glyph by glyph %" PRIu64 "ms\n",
+		       FreeRDPGetColorFormatName(formats[x]), runs / 1000000ull, single / 1000000ull);
+	}
+
+	return 0;
+}
@@ -0,0 +1,387 @@
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/bitmap.h>
+#include <freerdp/gdi/shape.h>
+#include <freerdp/codec/color.h>
+
+#include "brush.h"
+#include "../../test/test_performance.h"
+
+#define TEST_PATTERN_WIDTH 300
+#define TEST_PATTERN_HEIGHT 24
+
+static HGDI_BITMAP test_pattern_bitmap(UINT32 width, UINT32 height, UINT32 format)
+{
+	const size_t size = 1ull * width * height * FreeRDPGetBytesPerPixel(format);
+	BYTE* data = winpr_aligned_malloc(size, 16);
+	if (!data)
+		return NULL;
+
+	winpr_RAND(data, size);
+	HGDI_BITMAP bmp = gdi_CreateBitmap(width, height, format, data);
+	if (!bmp)
+		winpr_aligned_free(data);
+	return bmp;
+}
+
+static HGDI_DC test_pattern_dc(HGDI_BITMAP bmp)
+{
+	HGDI_DC hdc = gdi_GetDC();
+	if (!hdc)
+		return NULL;
+
+	hdc->format = bmp->format;
+	gdi_SelectObject(hdc, (HGDIOBJECT)bmp);
+	return hdc;
+}
+
+static void test_pattern_dc_free(HGDI_DC hdc)
+{
+	if (!hdc)
+		return;
+
+	gdi_DeleteObject(hdc->selectedObject);
+	gdi_DeleteDC(hdc);
+}
+
+/* the brush pixel for a destination pixel, see msdn{dd183396} */
+static UINT32 test_pattern_pixel(HGDI_BRUSH brush, INT32 x, INT32 y, UINT32 format)
+{
+	const HGDI_BITMAP pattern = brush->pattern;
+	const INT32 px = ((x - brush->nXOrg) % pattern->width + pattern->width) % pattern->width;
+	const INT32 py = ((y - brush->nYOrg) % pattern->height + pattern->height) % pattern->height;
+	const BYTE* p = &pattern->data[1ull * (UINT32)py * pattern->scanline +
+	                               1ull * (UINT32)px * FreeRDPGetBytesPerPixel(pattern->format)];
+	const UINT32 color = FreeRDPReadColor(p, pattern->format);
+
+	/* a pattern in the destination format is used as is */
+	if (pattern->format == format)
+		return color;
+	return FreeRDPConvertColor(color, pattern->format, format, NULL);
+}
+
+static void test_pattern_expected(HGDI_BITMAP dst, const BYTE* orig, HGDI_BRUSH brush, INT32 dx,
+                                  INT32 dy, INT32 w, INT32 h, BOOL invert, BYTE* expected)
+{
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(dst->format);
+
+	memcpy(expected, orig, 1ull * dst->scanline * dst->height);
+	for (INT32 y = dy; y < dy + h; y++)
+	{
+		for (INT32 x = dx; x < dx + w; x++)
+		{
+			BYTE* p = &expected[1ull * (UINT32)y * dst->scanline + 1ull * (UINT32)x * bpp];
+			UINT32 color = test_pattern_pixel(brush, x, y, dst->format);
+			if (invert)
+				color ^= FreeRDPReadColor(p, dst->format);
+			FreeRDPWriteColor(p, dst->format, color);
+		}
+	}
+}
+
+/* FillRect with a pattern in patternFormat and BitBlt with PATCOPY and PATINVERT with a pattern
+ * in the destination format, for random rectangles and brush origins */
+static BOOL test_pattern_fill(UINT32 format, UINT32 patternFormat, UINT32 pw, UINT32 ph)
+{
+	BOOL rc = FALSE;
+	BYTE* orig = NULL;
+	BYTE* expected = NULL;
+	HGDI_BRUSH brush = NULL;
+	HGDI_BITMAP pattern = NULL;
+	HGDI_DC hdc = NULL;
+	HGDI_BITMAP dst = test_pattern_bitmap(TEST_PATTERN_WIDTH, TEST_PATTERN_HEIGHT, format);
+
+	if (!dst)
+		goto fail;
+
+	hdc = test_pattern_dc(dst);
+	if (!hdc)
+	{
+		gdi_DeleteObject((HGDIOBJECT)dst);
+		goto fail;
+	}
+
+	const size_t size = 1ull * dst->scanline * dst->height;
+	orig = malloc(size);
+	expected = malloc(size);
+	if (!orig || !expected)
+		goto fail;
+
+	for (size_t i = 0; i < 200; i++)
+	{
+		const BOOL fill = (i % 3) == 0;
+		const BOOL invert = !fill && ((i % 3) == 2);
+		const INT32 x = rand() % TEST_PATTERN_WIDTH;
+		const INT32 y = rand() % TEST_PATTERN_HEIGHT;
+		const INT32 w = 1 + rand() % (TEST_PATTERN_WIDTH - x);
+		const INT32 h = 1 + rand() % (TEST_PATTERN_HEIGHT - y);
+
+		/* the unused bit of RGB15 is cleared on the per pixel path */
+		if (invert && (FreeRDPGetBitsPerPixel(format) == 15))
+			continue;
+
+		gdi_DeleteObject((HGDIOBJECT)brush);
+		gdi_DeleteObject((HGDIOBJECT)pattern);
+		brush = NULL;
+		pattern = test_pattern_bitmap(pw, ph, fill ? patternFormat : format);
+		if (!pattern)
+			goto fail;
+		brush = gdi_CreatePatternBrush(pattern);
+		if (!brush)
+			goto fail;
+		brush->nXOrg = rand() % 8;
+		brush->nYOrg = rand() % 8;
+		gdi_SelectObject(hdc, (HGDIOBJECT)brush);
+
+		memcpy(orig, dst->data, size);
+		test_pattern_expected(dst, orig, brush, x, y, w, h, invert, expected);
+
+		if (fill)
+		{
+			const GDI_RECT rect = { GDIOBJECT_RECT, x, y, x + w - 1, y + h - 1 };
+			if (!gdi_FillRect(hdc, &rect, brush))
+				goto fail;
+		}
+		else if (!gdi_BitBlt(hdc, x, y, w, h, NULL, 0, 0, invert ? GDI_PATINVERT : GDI_PATCOPY,
+		                     NULL))
+			goto fail;
+
+		if (memcmp(dst->data, expected, size) != 0)
+		{
+			(void)fprintf(stderr, "%s %" PRIu32 "x%" PRIu32 " %s mismatch\n",
+			              FreeRDPGetColorFormatName(format), pw, ph,
+			              fill ? "FillRect" : (invert ? "PATINVERT" : "PATCOPY"));
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	if (!rc)
+		(void)fprintf(stderr, "%s: %s, %" PRIu32 "x%" PRIu32 " pattern failed\n", __func__,
+		              FreeRDPGetColorFormatName(format), pw, ph);
+	free(orig);
+	free(expected);
+	test_pattern_dc_free(hdc);
+	gdi_DeleteObject((HGDIOBJECT)brush);
+	gdi_DeleteObject((HGDIOBJECT)pattern);
+	return rc;
+}
+
+static void test_pattern_instance_free(freerdp* instance)
+{
+	if (!instance)
+		return;
+
+	if (instance->context)
+	{
+		gdi_free(instance);
+		freerdp_context_free(instance);
+	}
+	freerdp_free(instance);
+}
+
+static freerdp* test_pattern_instance_new(UINT32 format)
+{
+	freerdp* instance = freerdp_new();
+	if (!instance)
+		return NULL;
+
+	if (!freerdp_context_new(instance))
+		goto fail;
+
+	rdpSettings* settings = instance->context->settings;
+	if (!freerdp_settings_set_uint32(settings, FreeRDP_DesktopWidth, TEST_PATTERN_WIDTH) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_DesktopHeight, TEST_PATTERN_HEIGHT) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_ColorDepth, 32))
+		goto fail;
+
+	if (!gdi_init(instance, format))
+		goto fail;
+
+	return instance;
+
+fail:
+	test_pattern_instance_free(instance);
+	return NULL;
+}
+
+/* PatBlt orders with cached brushes, which keep their expanded pattern with the cache entry,
+ * must draw what the same orders with the brush data inline draw */
+static BOOL test_pattern_cache(UINT32 format)
+{
+	BOOL rc = FALSE;
+	const UINT32 bpps[] = { 1, 16, 24, 32 };
+	CACHE_BRUSH_ORDER brushes[8] = { 0 };
+	freerdp* cached = test_pattern_instance_new(format);
+	freerdp* direct = test_pattern_instance_new(format);
+
+	if (!cached || !direct)
+		goto fail;
+
+	for (UINT32 i = 0; i < ARRAYSIZE(brushes); i++)
+	{
+		CACHE_BRUSH_ORDER* order = &brushes[i];
+
+		order->index = i;
+		order->bpp = bpps[i % ARRAYSIZE(bpps)];
+		order->length = order->bpp * 64 / 8;
+		winpr_RAND(order->data, order->length);
+		if (!cached->context->update->secondary->CacheBrush(cached->context, order))
+			goto fail;
+	}
+
+	for (size_t i = 0; i < 1000; i++)
+	{
+		const BYTE rops[] = { 0xF0, 0x5A, 0xFA, 0xA0 };
+		const CACHE_BRUSH_ORDER* entry = &brushes[(UINT32)rand() % ARRAYSIZE(brushes)];
+		PATBLT_ORDER order = { 0 };
+
+		order.nLeftRect = rand() % TEST_PATTERN_WIDTH - 8;
+		order.nTopRect = rand() % TEST_PATTERN_HEIGHT - 8;
+		order.nWidth = 1 + rand() % TEST_PATTERN_WIDTH;
+		order.nHeight = 1 + rand() % TEST_PATTERN_HEIGHT;
+		order.bRop = rops[(UINT32)rand() % ARRAYSIZE(rops)];
+		/* few colours, so that monochrome brushes are drawn with the colours they were
+		 * expanded with as well as with others */
+		order.foreColor = (UINT32)(rand() % 2) * 0x00FF8040;
+		order.backColor = (UINT32)(rand() % 2) * 0x00204080;
+		order.brush.x = (UINT32)rand() % 8;
+		order.brush.y = (UINT32)rand() % 8;
+
+		if ((i % 10) == 0)
+		{
+			order.brush.style = GDI_BS_HATCHED;
+			order.brush.hatch = (UINT32)rand() % 6;
+		}
+		else
+		{
+			order.brush.style = CACHED_BRUSH | GDI_BS_PATTERN;
+			order.brush.bpp = entry->bpp;
+			order.brush.index = entry->index;
+		}
+
+		if (!cached->context->update->primary->PatBlt(cached->context, &order))
+			goto fail;
+
+		order.brush.style &= ~CACHED_BRUSH;
+		order.brush.data = (BYTE*)entry->data;
+		if (!direct->context->update->primary->PatBlt(direct->context, &order))
+			goto fail;
+	}
+
+	const rdpGdi* a = cached->context->gdi;
+	const rdpGdi* b = direct->context->gdi;
+	if (memcmp(a->primary_buffer, b->primary_buffer, 1ull * a->stride * a->height) != 0)
+	{
+		(void)fprintf(stderr, "%s: %s cached brushes differ\n", __func__,
+		              FreeRDPGetColorFormatName(format));
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	test_pattern_instance_free(cached);
+	test_pattern_instance_free(direct);
+	return rc;
+}
+
+/* the brush pixel resolved for every destination pixel */
+static void test_pattern_fill_per_pixel(HGDI_BITMAP dst, HGDI_BRUSH brush, INT32 w, INT32 h)
+{
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(dst->format);
+
+	for (INT32 y = 0; y < h; y++)
+	{
+		for (INT32 x = 0; x < w; x++)
+			FreeRDPWriteColor(&dst->data[1ull * (UINT32)y * dst->scanline + 1ull * (UINT32)x * bpp],
+			                  dst->format, test_pattern_pixel(brush, x, y, dst->format));
+	}
+}
+
+/* PatBlt sizes from a few pixels up to full lines, each drawn until about 16M pixels are filled */
+static BOOL test_pattern_benchmark(UINT32 format)
+{
+	BOOL rc = FALSE;
+	const INT32 sizes[][2] = { { 8, 8 }, { 16, 16 }, { 32, 32 }, { 64, 64 }, { 256, 256 },
+		                       { 1024, 16 } };
+	HGDI_BITMAP pattern = test_pattern_bitmap(8, 8, format);
+	HGDI_BRUSH brush = pattern ? gdi_CreatePatternBrush(pattern) : NULL;
+	HGDI_BITMAP dst = test_pattern_bitmap(1024, 256, format);
+	HGDI_DC hdc = dst ? test_pattern_dc(dst) : NULL;
+
+	if (!brush || !hdc)
+	{
+		if (!hdc)
+			gdi_DeleteObject((HGDIOBJECT)dst);
+		goto fail;
+	}
+	gdi_SelectObject(hdc, (HGDIOBJECT)brush);
+
+	for (size_t i = 0; i < ARRAYSIZE(sizes); i++)
+	{
+		const INT32 w = sizes[i][0];
+		const INT32 h = sizes[i][1];
+		const size_t count = (16ull << 20) / (1ull * (UINT32)w * (UINT32)h);
+
+		const UINT64 start = winpr_GetTickCount64NS();
+		for (size_t x = 0; x < count; x++)
+		{
+			if (!gdi_BitBlt(hdc, 0, 0, w, h, NULL, 0, 0, GDI_PATCOPY, NULL))
+				goto fail;
+		}
+		const UINT64 tiles = winpr_GetTickCount64NS() - start;
+
+		const UINT64 begin = winpr_GetTickCount64NS();
+		for (size_t x = 0; x < count; x++)
+			test_pattern_fill_per_pixel(dst, brush, w, h);
+		const UINT64 pixels = winpr_GetTickCount64NS() - begin;
+
+		printf("%s 8x8 brush, %" PRIuz " PATCOPY %" PRId32 "x%" PRId32 ": %" PRIu64
+		       "us, per pixel %" PRIu64 "us\n",
+		       FreeRDPGetColorFormatName(format), count, w, h, tiles / 1000ull,
+		       pixels / 1000ull);
+	}
+
+	rc = TRUE;
+fail:
+	test_pattern_dc_free(hdc);
+	gdi_DeleteObject((HGDIOBJECT)brush);
+	gdi_DeleteObject((HGDIOBJECT)pattern);
+	return rc;
+}
+
+int TestGdiPattern(int argc, char* argv[])
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_BGR24, PIXEL_FORMAT_RGB16, PIXEL_FORMAT_RGB15 };
+	const UINT32 sizes[][2] = { { 8, 8 }, { 1, 1 }, { 2, 4 }, { 3, 7 }, { 5, 8 }, { 12, 9 } };
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(sizes); y++)
+		{
+			if (!test_pattern_fill(formats[x], formats[x], sizes[y][0], sizes[y][1]) ||
+			    !test_pattern_fill(formats[x], PIXEL_FORMAT_BGRX32, sizes[y][0], sizes[y][1]))
+				return -1;
+		}
+
+		if (!test_pattern_cache(formats[x]))
+			return -1;
+	}
+
+	test_performance_setup(argc, argv);
+	if (!g_TestPerformance)
+		return 0;
+
+	if (!test_pattern_benchmark(PIXEL_FORMAT_BGRX32) ||
+	    !test_pattern_benchmark(PIXEL_FORMAT_BGR24) || !test_pattern_benchmark(PIXEL_FORMAT_RGB16))
+		return -1;
+
+	return 0;
+}
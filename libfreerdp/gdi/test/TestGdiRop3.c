@@ -1,8 +1,18 @@
 
 #include <winpr/crt.h>
 #include <winpr/winpr.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
 #include <winpr/collections.h>
 
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/bitmap.h>
+#include <freerdp/codec/color.h>
+
+#include "brush.h"
+#include "../../test/test_performance.h"
+
 /**
  * Ternary Raster Operations:
  * See "Windows Graphics Programming: Win32 GDI and DirectDraw", chapter 11. Advanced Bitmap
@@ -198,10 +208,310 @@ static const char* test_ROP3[] = { "DSPDxax",  "PSDPxax", "SPna",   "DSna",   "D
 	                               "PDna",     "DPan",    "DSan",   "DSxn",   "DPa",
 	                               "D",        "DPno",    "SDno",   "PDno",   "DPo" };
 
+#define TEST_ROP_WIDTH 67
+#define TEST_ROP_HEIGHT 13
+
+typedef enum
+{
+	TEST_ROP_SRC,
+	TEST_ROP_PATTERN,
+	TEST_ROP_OVERLAP_UP,
+	TEST_ROP_OVERLAP_DOWN
+} test_rop_mode;
+
+/* the ROP3 index is the truth table of the operation, bit (P << 2) | (S << 1) | D */
+static UINT32 test_rop_eval(BYTE code, UINT32 format, UINT32 D, UINT32 S, UINT32 P)
+{
+	UINT32 r = 0;
+
+	/* BLACKNESS and WHITENESS are colors with alpha, not all bits cleared or set */
+	if (code == 0x00)
+		return FreeRDPGetColor(format, 0, 0, 0, 0xFF);
+	if (code == 0xFF)
+		return FreeRDPGetColor(format, 0xFF, 0xFF, 0xFF, 0xFF);
+
+	for (UINT32 i = 0; i < 8; i++)
+	{
+		if ((code & (1u << i)) == 0)
+			continue;
+
+		const UINT32 p = (i & 4) ? P : ~P;
+		const UINT32 s = (i & 2) ? S : ~S;
+		const UINT32 d = (i & 1) ? D : ~D;
+		r |= p & s & d;
+	}
+	return r;
+}
+
+static HGDI_BITMAP test_rop_bitmap(UINT32 width, UINT32 height, UINT32 format)
+{
+	const size_t size = 1ull * width * height * FreeRDPGetBytesPerPixel(format);
+	BYTE* data = winpr_aligned_malloc(size, 16);
+	if (!data)
+		return NULL;
+
+	winpr_RAND(data, size);
+	HGDI_BITMAP bmp = gdi_CreateBitmap(width, height, format, data);
+	if (!bmp)
+		winpr_aligned_free(data);
+	return bmp;
+}
+
+static HGDI_DC test_rop_dc(HGDI_BITMAP bmp)
+{
+	HGDI_DC hdc = gdi_GetDC();
+	if (!hdc)
+		return NULL;
+
+	hdc->format = bmp->format;
+	gdi_SelectObject(hdc, (HGDIOBJECT)bmp);
+	return hdc;
+}
+
+static BOOL test_rop_expected(BYTE code, HGDI_BITMAP dst, const BYTE* orig, HGDI_BITMAP src,
+                              const BYTE* srcData, HGDI_BRUSH brush, INT32 dx, INT32 dy, INT32 sx,
+                              INT32 sy, INT32 w, INT32 h, BYTE* expected)
+{
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(dst->format);
+	const UINT32 sbpp = FreeRDPGetBytesPerPixel(src->format);
+
+	memcpy(expected, orig, 1ull * dst->scanline * dst->height);
+	for (INT32 y = 0; y < h; y++)
+	{
+		for (INT32 x = 0; x < w; x++)
+		{
+			const size_t doff = 1ull * (dy + y) * dst->scanline + 1ull * (dx + x) * bpp;
+			const size_t soff = 1ull * (sy + y) * src->scanline + 1ull * (sx + x) * sbpp;
+			const UINT32 D = FreeRDPReadColor(&orig[doff], dst->format);
+			UINT32 S = FreeRDPReadColor(&srcData[soff], src->format);
+			UINT32 P = brush->color;
+
+			/* like SRCCOPY a source in the destination format is used as is */
+			if (src->format != dst->format)
+				S = FreeRDPConvertColor(S, src->format, dst->format, NULL);
+			if (brush->style == GDI_BS_PATTERN)
+			{
+				const HGDI_BITMAP pat = brush->pattern;
+				const size_t poff = 1ull * ((dy + y) % pat->height) * pat->scanline +
+				                    1ull * ((dx + x) % pat->width) * bpp;
+				P = FreeRDPReadColor(&pat->data[poff], dst->format);
+			}
+
+			const UINT32 color = test_rop_eval(code, dst->format, D, S, P);
+			if (!FreeRDPWriteColor(&expected[doff], dst->format, color))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* runs all ROP3 codes through gdi_BitBlt and compares with the truth table of each code */
+static BOOL test_rop_all(UINT32 dstFormat, UINT32 srcFormat, test_rop_mode mode)
+{
+	BOOL rc = FALSE;
+	BYTE* orig = NULL;
+	BYTE* srcData = NULL;
+	BYTE* expected = NULL;
+	HGDI_DC hdcDst = NULL;
+	HGDI_DC hdcSrc = NULL;
+	HGDI_BITMAP src = NULL;
+	HGDI_BITMAP pattern = NULL;
+	HGDI_BRUSH brush = NULL;
+	INT32 dx = 3;
+	INT32 dy = 2;
+	INT32 sx = 1;
+	INT32 sy = 0;
+	const INT32 w = TEST_ROP_WIDTH - 5;
+	const INT32 h = TEST_ROP_HEIGHT - 3;
+
+	HGDI_BITMAP dst = test_rop_bitmap(TEST_ROP_WIDTH, TEST_ROP_HEIGHT, dstFormat);
+	if (!dst)
+		goto fail;
+	hdcDst = test_rop_dc(dst);
+	if (!hdcDst)
+	{
+		gdi_DeleteObject((HGDIOBJECT)dst);
+		goto fail;
+	}
+
+	if (mode == TEST_ROP_OVERLAP_DOWN)
+	{
+		dx = 1;
+		dy = 0;
+		sx = 3;
+		sy = 2;
+	}
+
+	if ((mode == TEST_ROP_OVERLAP_UP) || (mode == TEST_ROP_OVERLAP_DOWN))
+		src = dst;
+	else
+	{
+		src = test_rop_bitmap(TEST_ROP_WIDTH, TEST_ROP_HEIGHT, srcFormat);
+		if (!src)
+			goto fail;
+		hdcSrc = test_rop_dc(src);
+		if (!hdcSrc)
+		{
+			gdi_DeleteObject((HGDIOBJECT)src);
+			goto fail;
+		}
+	}
+
+	if (mode == TEST_ROP_PATTERN)
+	{
+		pattern = test_rop_bitmap(8, 8, dstFormat);
+		if (!pattern)
+			goto fail;
+		brush = gdi_CreatePatternBrush(pattern);
+	}
+	else
+		brush = gdi_CreateSolidBrush(FreeRDPGetColor(dstFormat, 0x12, 0x34, 0x56, 0x78));
+	if (!brush)
+		goto fail;
+	gdi_SelectObject(hdcDst, (HGDIOBJECT)brush);
+
+	const size_t size = 1ull * dst->scanline * dst->height;
+	orig = malloc(size);
+	expected = malloc(size);
+	srcData = malloc(1ull * src->scanline * src->height);
+	if (!orig || !expected || !srcData)
+		goto fail;
+	memcpy(orig, dst->data, size);
+	memcpy(srcData, src->data, 1ull * src->scanline * src->height);
+
+	for (UINT32 code = 0; code <= UINT8_MAX; code++)
+	{
+		const DWORD rop = gdi_rop3_code((BYTE)code);
+
+		/* SRCCOPY and DSTCOPY are plain image copies without alpha conversion */
+		if ((rop == GDI_SRCCOPY) || (rop == GDI_DSTCOPY))
+			continue;
+
+		memcpy(dst->data, orig, size);
+		if (!test_rop_expected((BYTE)code, dst, orig, src, srcData, brush, dx, dy, sx, sy, w, h,
+		                       expected))
+			goto fail;
+
+		if (!gdi_BitBlt(hdcDst, dx, dy, w, h, hdcSrc ? hdcSrc : hdcDst, sx, sy, rop, NULL))
+			goto fail;
+
+		if (memcmp(dst->data, expected, size) != 0)
+		{
+			(void)fprintf(stderr, "ROP %s [0x%08" PRIx32 "] mismatch\n", gdi_rop_to_string(rop),
+			              rop);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	if (!rc)
+		(void)fprintf(stderr, "%s: %s -> %s, mode %d failed\n", __func__,
+		              FreeRDPGetColorFormatName(srcFormat), FreeRDPGetColorFormatName(dstFormat),
+		              mode);
+	free(orig);
+	free(expected);
+	free(srcData);
+	if (hdcSrc)
+	{
+		gdi_DeleteObject(hdcSrc->selectedObject);
+		gdi_DeleteDC(hdcSrc);
+	}
+	if (hdcDst)
+	{
+		gdi_DeleteObject(hdcDst->selectedObject);
+		gdi_DeleteDC(hdcDst);
+	}
+	if (brush)
+		gdi_DeleteObject((HGDIOBJECT)brush);
+	if (pattern)
+		gdi_DeleteObject((HGDIOBJECT)pattern);
+	return rc;
+}
+
+/* Time all 256 ROPs on a 16bpp format, applied to whole rows, and on RGB15, which still takes
+ * the per pixel path because its unused bit is cleared on write. */
+static BOOL test_rop_benchmark(UINT32 format, BOOL pattern)
+{
+	BOOL rc = FALSE;
+	HGDI_DC hdcDst = NULL;
+	HGDI_DC hdcSrc = NULL;
+	HGDI_BITMAP pat = NULL;
+	HGDI_BRUSH brush = NULL;
+	const INT32 size = 256;
+
+	HGDI_BITMAP dst = test_rop_bitmap(size, size, format);
+	HGDI_BITMAP src = test_rop_bitmap(size, size, format);
+	if (!dst || !src)
+	{
+		gdi_DeleteObject((HGDIOBJECT)dst);
+		gdi_DeleteObject((HGDIOBJECT)src);
+		goto fail;
+	}
+
+	hdcDst = test_rop_dc(dst);
+	hdcSrc = test_rop_dc(src);
+	if (!hdcDst || !hdcSrc)
+		goto fail;
+
+	if (pattern)
+	{
+		pat = test_rop_bitmap(8, 8, format);
+		if (!pat)
+			goto fail;
+		brush = gdi_CreatePatternBrush(pat);
+	}
+	else
+		brush = gdi_CreateSolidBrush(FreeRDPGetColor(format, 0x12, 0x34, 0x56, 0xFF));
+	if (!brush)
+		goto fail;
+	gdi_SelectObject(hdcDst, (HGDIOBJECT)brush);
+
+	UINT64 max = 0;
+	DWORD maxRop = 0;
+	const UINT64 start = winpr_GetTickCount64NS();
+	for (UINT32 code = 0; code <= UINT8_MAX; code++)
+	{
+		const DWORD rop = gdi_rop3_code((BYTE)code);
+		const UINT64 begin = winpr_GetTickCount64NS();
+		if (!gdi_BitBlt(hdcDst, 0, 0, size, size, hdcSrc, 0, 0, rop, NULL))
+			goto fail;
+		const UINT64 diff = winpr_GetTickCount64NS() - begin;
+		if (diff > max)
+		{
+			max = diff;
+			maxRop = rop;
+		}
+	}
+	const UINT64 total = winpr_GetTickCount64NS() - start;
+
+	printf("%s %s brush, 256 ROPs on %" PRId32 "x%" PRId32 ": %" PRIu64
+	       "us total, slowest %s %" PRIu64 "us\n",
+	       FreeRDPGetColorFormatName(format), pattern ? "pattern" : "solid", size, size,
+	       total / 1000ull, gdi_rop_to_string(maxRop), max / 1000ull);
+	rc = TRUE;
+
+fail:
+	if (hdcSrc)
+	{
+		gdi_DeleteObject(hdcSrc->selectedObject);
+		gdi_DeleteDC(hdcSrc);
+	}
+	if (hdcDst)
+	{
+		gdi_DeleteObject(hdcDst->selectedObject);
+		gdi_DeleteDC(hdcDst);
+	}
+	if (brush)
+		gdi_DeleteObject((HGDIOBJECT)brush);
+	if (pat)
+		gdi_DeleteObject((HGDIOBJECT)pat);
+	return rc;
+}
+
 int TestGdiRop3(int argc, char* argv[])
 {
-	WINPR_UNUSED(argc);
-	WINPR_UNUSED(argv);
+	test_performance_setup(argc, argv);
 
 	for (size_t index = 0; index < sizeof(test_ROP3) / sizeof(test_ROP3[0]); index++)
 	{
@@ -215,5 +525,38 @@ int TestGdiRop3(int argc, char* argv[])
 		free(infix);
 	}
 
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_BGR24,  PIXEL_FORMAT_RGB16,
+		                       PIXEL_FORMAT_RGB15 };
+
+	for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		const UINT32 format = formats[x];
+
+		if (!test_rop_all(format, format, TEST_ROP_SRC))
+			return -1;
+		if (!test_rop_all(format, format, TEST_ROP_PATTERN))
+			return -1;
+		if (!test_rop_all(format, format, TEST_ROP_OVERLAP_UP))
+			return -1;
+		if (!test_rop_all(format, format, TEST_ROP_OVERLAP_DOWN))
+			return -1;
+		if (!test_rop_all(format, PIXEL_FORMAT_BGRA32, TEST_ROP_SRC))
+			return -1;
+		/* glyphs */
+		if (!test_rop_all(format, PIXEL_FORMAT_MONO, TEST_ROP_SRC))
+			return -1;
+	}
+
+	if (!g_TestPerformance)
+		return 0;
+
+	if (!test_rop_benchmark(PIXEL_FORMAT_RGB16, FALSE) ||
+	    !test_rop_benchmark(PIXEL_FORMAT_RGB15, FALSE) ||
+	    !test_rop_benchmark(PIXEL_FORMAT_RGB16, TRUE) ||
+	    !test_rop_benchmark(PIXEL_FORMAT_RGB15, TRUE) ||
+	    !test_rop_benchmark(PIXEL_FORMAT_BGRX32, FALSE))
+		return -1;
+
 	return 0;
 }
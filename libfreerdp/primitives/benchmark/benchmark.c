@@ -23,6 +23,7 @@
 #include <winpr/crypto.h>
 #include <winpr/sysinfo.h>
 #include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
 
 typedef struct
 {
@@ -198,6 +199,64 @@ static BOOL primitives_RGB2444_benchmark_run(primitives_YUV_benchmark* bench, pr
 	return TRUE;
 }
 
+static BOOL primitives_copy_benchmark_run(primitives_t* prims)
+{
+	BOOL rc = FALSE;
+	const UINT32 width = 1920;
+	const UINT32 height = 1080;
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGBA32,
+		                       PIXEL_FORMAT_RGBX32, PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32,
+		                       PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_BGR24,
+		                       PIXEL_FORMAT_RGB24,  PIXEL_FORMAT_RGB16,  PIXEL_FORMAT_BGR16 };
+	const UINT32 flags[] = { FREERDP_FLIP_NONE, FREERDP_KEEP_DST_ALPHA };
+	BYTE* src = calloc(4ull * width, height);
+	BYTE* dst = calloc(4ull * width, height);
+	if (!src || !dst)
+		goto fail;
+	winpr_RAND(src, 4ull * width * height);
+
+	for (size_t f = 0; f < ARRAYSIZE(flags); f++)
+	{
+		for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+		{
+			for (size_t y = 0; y < ARRAYSIZE(formats); y++)
+			{
+				const UINT32 srcFormat = formats[x];
+				const UINT32 dstFormat = formats[y];
+				const UINT32 srcStep = width * FreeRDPGetBytesPerPixel(srcFormat);
+				const UINT32 dstStep = width * FreeRDPGetBytesPerPixel(dstFormat);
+				UINT64 diff = 0;
+
+				for (size_t z = 0; z < 10; z++)
+				{
+					const UINT64 start = winpr_GetTickCount64NS();
+					pstatus_t status =
+					    prims->copy_no_overlap(dst, dstFormat, dstStep, 0, 0, width, height, src,
+					                           srcFormat, srcStep, 0, 0, NULL, flags[f]);
+					diff += winpr_GetTickCount64NS() - start;
+					if (status != PRIMITIVES_SUCCESS)
+					{
+						(void)fprintf(stderr, "Running copy_no_overlap failed\n");
+						goto fail;
+					}
+				}
+
+				char buffer[32] = { 0 };
+				printf("copy_no_overlap %s -> %s [0x%08" PRIx32 "] %" PRIu32 "x%" PRIu32
+				       " took %sns\n",
+				       FreeRDPGetColorFormatName(srcFormat), FreeRDPGetColorFormatName(dstFormat),
+				       flags[f], width, height, print_time(diff / 10, buffer, sizeof(buffer)));
+			}
+		}
+	}
+	rc = TRUE;
+
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
 int main(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -245,6 +304,14 @@ int main(int argc, char* argv[])
 			goto fail;
 		}
 		printf("\n");
+
+		printf("Running copy_no_overlap benchmark on %s implementation:\n", hintstr);
+		if (!primitives_copy_benchmark_run(prim))
+		{
+			(void)fprintf(stderr, "copy_no_overlap benchmark failed\n");
+			goto fail;
+		}
+		printf("\n");
 	}
 fail:
 	primitives_YUV_benchmark_free(&bench);
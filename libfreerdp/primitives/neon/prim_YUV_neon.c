@@ -820,6 +820,175 @@ static pstatus_t neon_YUV420CombineToYUV444(avc444_frame_type type,
 			return -1;
 	}
 }
+
+static inline void neon_YUY2ToLuma(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                   BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, size_t width,
+                                   UINT32 height)
+{
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* WINPR_RESTRICT s = &pSrc[y * srcStep];
+		BYTE* WINPR_RESTRICT d = &pDst[y * dstStep];
+
+		for (size_t x = 0; x < width; x += 16)
+		{
+			const uint8x16x2_t yuyv = vld2q_u8(&s[2 * x]);
+			vst1q_u8(&d[x], yuyv.val[0]);
+		}
+	}
+}
+
+/* U (val[0]) and V (val[1]) of 32 pixels averaged over two lines */
+static inline uint8x16x2_t neon_YUY2Chroma(const BYTE* WINPR_RESTRICT s0,
+                                           const BYTE* WINPR_RESTRICT s1)
+{
+	const uint8x16x4_t a = vld4q_u8(s0);
+	const uint8x16x4_t b = vld4q_u8(s1);
+	uint8x16x2_t uv;
+	uv.val[0] = vrhaddq_u8(a.val[1], b.val[1]);
+	uv.val[1] = vrhaddq_u8(a.val[3], b.val[3]);
+	return uv;
+}
+
+/* The vector part covers multiples of 32 pixels, the generic code does the rest */
+static pstatus_t neon_YUY2ToYUV420_8u_C2P3R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                            BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t width = roi->width & ~31u;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	neon_YUY2ToLuma(pSrc, srcStep, pDst[0], dstStep[0], width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s0 = &pSrc[2 * y * srcStep];
+		const BYTE* WINPR_RESTRICT s1 = (2 * y + 1 < roi->height) ? &s0[srcStep] : s0;
+		BYTE* WINPR_RESTRICT u = &pDst[1][y * dstStep[1]];
+		BYTE* WINPR_RESTRICT v = &pDst[2][y * dstStep[2]];
+
+		for (size_t x = 0; x < width; x += 32)
+		{
+			const uint8x16x2_t uv = neon_YUY2Chroma(&s0[2 * x], &s1[2 * x]);
+			vst1q_u8(&u[x / 2], uv.val[0]);
+			vst1q_u8(&v[x / 2], uv.val[1]);
+		}
+	}
+
+	if (width == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	BYTE* pRest[3] = { &pDst[0][width], &pDst[1][width / 2], &pDst[2][width / 2] };
+	const prim_size_t rest = { .width = roi->width - (UINT32)width, .height = roi->height };
+	return generic->YUY2ToYUV420_8u_C2P3R(&pSrc[2 * width], srcStep, pRest, dstStep, &rest);
+}
+
+static pstatus_t neon_YUY2ToNV12_8u_C2P2R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                          BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+                                          const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t width = roi->width & ~31u;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	neon_YUY2ToLuma(pSrc, srcStep, pDst[0], dstStep[0], width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s0 = &pSrc[2 * y * srcStep];
+		const BYTE* WINPR_RESTRICT s1 = (2 * y + 1 < roi->height) ? &s0[srcStep] : s0;
+		BYTE* WINPR_RESTRICT d = &pDst[1][y * dstStep[1]];
+
+		for (size_t x = 0; x < width; x += 32)
+			vst2q_u8(&d[x], neon_YUY2Chroma(&s0[2 * x], &s1[2 * x]));
+	}
+
+	if (width == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	BYTE* pRest[3] = { &pDst[0][width], &pDst[1][width], NULL };
+	const prim_size_t rest = { .width = roi->width - (UINT32)width, .height = roi->height };
+	return generic->YUY2ToNV12_8u_C2P2R(&pSrc[2 * width], srcStep, pRest, dstStep, &rest);
+}
+
+/* 16 chroma samples (32 pixels) per iteration, the remaining columns are done one by one */
+static pstatus_t neon_NV12ToYUV420_8u_P2P3R(const BYTE* WINPR_RESTRICT pSrc[3],
+                                            const UINT32 srcStep[3], BYTE* WINPR_RESTRICT pDst[3],
+                                            const UINT32 dstStep[3],
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	for (size_t y = 0; y < roi->height; y++)
+		memcpy(&pDst[0][y * dstStep[0]], &pSrc[0][y * srcStep[0]], roi->width);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s = &pSrc[1][y * srcStep[1]];
+		BYTE* WINPR_RESTRICT u = &pDst[1][y * dstStep[1]];
+		BYTE* WINPR_RESTRICT v = &pDst[2][y * dstStep[2]];
+		size_t x = 0;
+
+		for (; x + 16 <= cw; x += 16)
+		{
+			const uint8x16x2_t uv = vld2q_u8(&s[2 * x]);
+			vst1q_u8(&u[x], uv.val[0]);
+			vst1q_u8(&v[x], uv.val[1]);
+		}
+
+		for (; x < cw; x++)
+		{
+			u[x] = s[2 * x];
+			v[x] = s[2 * x + 1];
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t neon_YUV420ToNV12_8u_P3P2R(const BYTE* WINPR_RESTRICT pSrc[3],
+                                            const UINT32 srcStep[3], BYTE* WINPR_RESTRICT pDst[3],
+                                            const UINT32 dstStep[3],
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	for (size_t y = 0; y < roi->height; y++)
+		memcpy(&pDst[0][y * dstStep[0]], &pSrc[0][y * srcStep[0]], roi->width);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT u = &pSrc[1][y * srcStep[1]];
+		const BYTE* WINPR_RESTRICT v = &pSrc[2][y * srcStep[2]];
+		BYTE* WINPR_RESTRICT d = &pDst[1][y * dstStep[1]];
+		size_t x = 0;
+
+		for (; x + 16 <= cw; x += 16)
+		{
+			uint8x16x2_t uv;
+			uv.val[0] = vld1q_u8(&u[x]);
+			uv.val[1] = vld1q_u8(&v[x]);
+			vst2q_u8(&d[2 * x], uv);
+		}
+
+		for (; x < cw; x++)
+		{
+			d[2 * x] = u[x];
+			d[2 * x + 1] = v[x];
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
 #endif
 
 void primitives_init_YUV_neon_int(primitives_t* WINPR_RESTRICT prims)
@@ -830,6 +999,10 @@ void primitives_init_YUV_neon_int(primitives_t* WINPR_RESTRICT prims)
 	prims->YUV420ToRGB_8u_P3AC4R = neon_YUV420ToRGB_8u_P3AC4R;
 	prims->YUV444ToRGB_8u_P3AC4R = neon_YUV444ToRGB_8u_P3AC4R;
 	prims->YUV420CombineToYUV444 = neon_YUV420CombineToYUV444;
+	prims->YUY2ToYUV420_8u_C2P3R = neon_YUY2ToYUV420_8u_C2P3R;
+	prims->YUY2ToNV12_8u_C2P2R = neon_YUY2ToNV12_8u_C2P2R;
+	prims->NV12ToYUV420_8u_P2P3R = neon_NV12ToYUV420_8u_P2P3R;
+	prims->YUV420ToNV12_8u_P3P2R = neon_YUV420ToNV12_8u_P3P2R;
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
 	WINPR_UNUSED(prims);
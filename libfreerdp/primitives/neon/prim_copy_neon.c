@@ -0,0 +1,326 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized copy operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_copy.h"
+
+#include "prim_internal.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* Pixels are handled as one vector per channel (vld3q/vld4q, vst3q/vst4q), order selects the
+ * source channel written to each destination byte, 4 for zero and 5 for 0xFF.
+ * It is taken from the first pixel of the pshufb mask, so it works on ARMv7 as well. */
+static BOOL neon_copy_order(UINT32 SrcFormat, UINT32 DstFormat, BYTE order[4])
+{
+	BYTE shuffle[16] = { 0 };
+	BYTE fill[16] = { 0 };
+
+	if (!primitives_copy_swizzle_mask(SrcFormat, DstFormat, shuffle, fill))
+		return FALSE;
+
+	for (size_t x = 0; x < 4; x++)
+	{
+		if (shuffle[x] < 4)
+			order[x] = shuffle[x];
+		else
+			order[x] = fill[x] ? 5 : 4;
+	}
+	return TRUE;
+}
+
+static inline void neon_copy_store(BYTE* WINPR_RESTRICT dst, size_t dstByte,
+                                   const uint8x16_t ch[6], const BYTE order[4])
+{
+	if (dstByte == 3)
+	{
+		uint8x16x3_t px;
+		px.val[0] = ch[order[0]];
+		px.val[1] = ch[order[1]];
+		px.val[2] = ch[order[2]];
+		vst3q_u8(dst, px);
+	}
+	else
+	{
+		uint8x16x4_t px;
+		px.val[0] = ch[order[0]];
+		px.val[1] = ch[order[1]];
+		px.val[2] = ch[order[2]];
+		px.val[3] = ch[order[3]];
+		vst4q_u8(dst, px);
+	}
+}
+
+static inline void neon_copy_load(const BYTE* WINPR_RESTRICT src, size_t srcByte, uint8x16_t ch[6])
+{
+	if (srcByte == 3)
+	{
+		const uint8x16x3_t px = vld3q_u8(src);
+		ch[0] = px.val[0];
+		ch[1] = px.val[1];
+		ch[2] = px.val[2];
+	}
+	else
+	{
+		const uint8x16x4_t px = vld4q_u8(src);
+		ch[0] = px.val[0];
+		ch[1] = px.val[1];
+		ch[2] = px.val[2];
+		ch[3] = px.val[3];
+	}
+}
+
+/* The kernels below convert columns [0, n) of every line, 16 pixels per step, and return n.
+ * The remaining columns are left to generic_image_copy_no_overlap_convert. */
+static inline UINT32 neon_image_copy_swizzle(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                             UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                             UINT32 nWidth, UINT32 nHeight,
+                                             const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                             UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                             int64_t srcVMultiplier, int64_t srcVOffset,
+                                             int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE order[4] = { 0 };
+
+	if (!neon_copy_order(SrcFormat, DstFormat, order))
+		return 0;
+
+	const int64_t srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const int64_t dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	const UINT32 width = nWidth & ~15u;
+	uint8x16_t ch[6] = { 0 };
+	ch[4] = vdupq_n_u8(0x00);
+	ch[5] = vdupq_n_u8(0xFF);
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 16)
+		{
+			neon_copy_load(&srcLine[(x + nXSrc) * srcByte], (size_t)srcByte, ch);
+			neon_copy_store(&dstLine[(x + nXDst) * dstByte], (size_t)dstByte, ch, order);
+		}
+	}
+
+	return width;
+}
+
+/* RGB16/BGR16 to 24 or 32bpp. vld2q splits the low and high bytes of 16 pixels, the 5/6 bit
+ * channels are expanded like FreeRDPSplitColor does, the saturating add clamps green. */
+static inline UINT32 neon_image_copy_unpack16(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                              UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                              UINT32 nWidth, UINT32 nHeight,
+                                              const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                              UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                              int64_t srcVMultiplier, int64_t srcVOffset,
+                                              int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE order[4] = { 0 };
+
+	if (!neon_copy_order(PIXEL_FORMAT_BGRX32, DstFormat, order))
+		return 0;
+
+	const int64_t srcByte = 2;
+	const int64_t dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	const BOOL bgr = (SrcFormat == PIXEL_FORMAT_BGR16);
+	const UINT32 width = nWidth & ~15u;
+	const uint8x16_t m5 = vdupq_n_u8(0x1F);
+	const uint8x16_t m3 = vdupq_n_u8(0x07);
+	uint8x16_t ch[6] = { 0 };
+	ch[3] = vdupq_n_u8(0xFF);
+	ch[4] = vdupq_n_u8(0x00);
+	ch[5] = ch[3];
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 16)
+		{
+			const uint8x16x2_t v = vld2q_u8(&srcLine[(x + nXSrc) * srcByte]);
+			const uint8x16_t hi5 = vshrq_n_u8(v.val[1], 3);
+			const uint8x16_t lo5 = vandq_u8(v.val[0], m5);
+			const uint8x16_t g =
+			    vorrq_u8(vshlq_n_u8(vandq_u8(v.val[1], m3), 3), vshrq_n_u8(v.val[0], 5));
+			const uint8x16_t r = bgr ? lo5 : hi5;
+			const uint8x16_t b = bgr ? hi5 : lo5;
+
+			ch[0] = vorrq_u8(vshlq_n_u8(b, 3), vshrq_n_u8(b, 2));
+			ch[1] = vqaddq_u8(vshlq_n_u8(g, 2), vshrq_n_u8(g, 3));
+			ch[2] = vorrq_u8(vshlq_n_u8(r, 3), vshrq_n_u8(r, 2));
+			neon_copy_store(&dstLine[(x + nXDst) * dstByte], (size_t)dstByte, ch, order);
+		}
+	}
+
+	return width;
+}
+
+/* 24 or 32bpp to RGB16/BGR16, the high and low bytes are built separately and interleaved
+ * with vst2q */
+static inline UINT32 neon_image_copy_pack16(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                            UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                            UINT32 nWidth, UINT32 nHeight,
+                                            const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                            UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                            int64_t srcVMultiplier, int64_t srcVOffset,
+                                            int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE order[4] = { 0 };
+
+	if (!neon_copy_order(SrcFormat, PIXEL_FORMAT_BGRX32, order))
+		return 0;
+
+	const int64_t srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const int64_t dstByte = 2;
+	const BOOL bgr = (DstFormat == PIXEL_FORMAT_BGR16);
+	const UINT32 width = nWidth & ~15u;
+	const uint8x16_t m5h = vdupq_n_u8(0xF8);
+	const uint8x16_t m3h = vdupq_n_u8(0xE0);
+	uint8x16_t ch[6] = { 0 };
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 16)
+		{
+			neon_copy_load(&srcLine[(x + nXSrc) * srcByte], (size_t)srcByte, ch);
+
+			const uint8x16_t b = ch[order[0]];
+			const uint8x16_t g = ch[order[1]];
+			const uint8x16_t r = ch[order[2]];
+			const uint8x16_t hi = bgr ? b : r;
+			const uint8x16_t lo = bgr ? r : b;
+			uint8x16x2_t v;
+			v.val[0] = vorrq_u8(vandq_u8(vshlq_n_u8(g, 3), m3h), vshrq_n_u8(lo, 3));
+			v.val[1] = vorrq_u8(vandq_u8(hi, m5h), vshrq_n_u8(g, 5));
+			vst2q_u8(&dstLine[(x + nXDst) * dstByte], v);
+		}
+	}
+
+	return width;
+}
+
+static pstatus_t neon_image_copy_no_overlap_convert(
+    BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+    UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+    UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
+    int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	UINT32 done = 0;
+
+	if ((SrcFormat == PIXEL_FORMAT_RGB16) || (SrcFormat == PIXEL_FORMAT_BGR16))
+		done = neon_image_copy_unpack16(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+		                                nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                                srcVMultiplier, srcVOffset, dstVMultiplier, dstVOffset);
+	else if ((DstFormat == PIXEL_FORMAT_RGB16) || (DstFormat == PIXEL_FORMAT_BGR16))
+		done = neon_image_copy_pack16(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
+		                              pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, srcVMultiplier,
+		                              srcVOffset, dstVMultiplier, dstVOffset);
+	else
+		done = neon_image_copy_swizzle(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+		                               nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                               srcVMultiplier, srcVOffset, dstVMultiplier, dstVOffset);
+
+	if (done >= nWidth)
+		return PRIMITIVES_SUCCESS;
+
+	return generic_image_copy_no_overlap_convert(
+	    pDstData, DstFormat, nDstStep, nXDst + done, nYDst, nWidth - done, nHeight, pSrcData,
+	    SrcFormat, nSrcStep, nXSrc + done, nYSrc, palette, srcVMultiplier, srcVOffset,
+	    dstVMultiplier, dstVOffset);
+}
+
+static pstatus_t neon_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                            UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                            UINT32 nWidth, UINT32 nHeight,
+                                            const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                            UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                            const gdiPalette* WINPR_RESTRICT palette, UINT32 flags)
+{
+	const BOOL vSrcVFlip = (flags & FREERDP_FLIP_VERTICAL) ? TRUE : FALSE;
+	int64_t srcVOffset = 0;
+	int64_t srcVMultiplier = 1;
+	int64_t dstVOffset = 0;
+	int64_t dstVMultiplier = 1;
+
+	/* FREERDP_KEEP_DST_ALPHA and memcpy-able pairs are left to the generic implementation */
+	if ((((flags & FREERDP_KEEP_DST_ALPHA) != 0) && FreeRDPColorHasAlpha(DstFormat)) ||
+	    FreeRDPAreColorFormatsEqualNoAlpha(SrcFormat, DstFormat))
+		return generic->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+		                                nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                                palette, flags);
+
+	if ((nWidth == 0) || (nHeight == 0))
+		return PRIMITIVES_SUCCESS;
+
+	if ((nHeight > INT32_MAX) || (nWidth > INT32_MAX))
+		return -1;
+
+	if (!pDstData || !pSrcData)
+		return -1;
+
+	if (nDstStep == 0)
+		nDstStep = nWidth * FreeRDPGetBytesPerPixel(DstFormat);
+
+	if (nSrcStep == 0)
+		nSrcStep = nWidth * FreeRDPGetBytesPerPixel(SrcFormat);
+
+	if (vSrcVFlip)
+	{
+		srcVOffset = (nHeight - 1ll) * nSrcStep;
+		srcVMultiplier = -1;
+	}
+
+	return neon_image_copy_no_overlap_convert(
+	    pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+	    nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset, dstVMultiplier, dstVOffset);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_copy_neon_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	prims->copy_no_overlap = neon_image_copy_no_overlap;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
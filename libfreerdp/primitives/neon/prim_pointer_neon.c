@@ -0,0 +1,203 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized pointer shape conversion
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_pointer.h"
+
+#include "prim_internal.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* 8 pixels are handled as separate B, G, R and A vectors and stored with vst4_u8, order
+ * selects the channel (or 4 for zero) written to each destination byte.
+ * Returns FALSE for formats that are not a byte permutation of BGRA32. */
+static BOOL neon_pointer_dst_order(UINT32 DstFormat, BYTE order[4])
+{
+	static const BYTE argb[] = { 3, 2, 1, 0 };
+	static const BYTE xrgb[] = { 4, 2, 1, 0 };
+	static const BYTE abgr[] = { 3, 0, 1, 2 };
+	static const BYTE xbgr[] = { 4, 0, 1, 2 };
+	static const BYTE rgba[] = { 2, 1, 0, 3 };
+	static const BYTE bgra[] = { 0, 1, 2, 3 };
+	const BYTE* src = NULL;
+
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_ARGB32:
+			src = argb;
+			break;
+		case PIXEL_FORMAT_XRGB32:
+			src = xrgb;
+			break;
+		case PIXEL_FORMAT_ABGR32:
+			src = abgr;
+			break;
+		case PIXEL_FORMAT_XBGR32:
+			src = xbgr;
+			break;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			src = rgba;
+			break;
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			src = bgra;
+			break;
+		default:
+			return FALSE;
+	}
+
+	for (size_t x = 0; x < 4; x++)
+		order[x] = src[x];
+	return TRUE;
+}
+
+/* expands the 8 mask bits (MSB first) to one lane each */
+static inline uint8x8_t neon_pointer_expand_bits(BYTE bits, uint8x8_t lanes)
+{
+	return vtst_u8(vdup_n_u8(bits), lanes);
+}
+
+static pstatus_t neon_pointerToRGB_8u_AC4R(const BYTE* WINPR_RESTRICT pXorMask, INT32 xorStep,
+                                           UINT32 xorBpp, const BYTE* WINPR_RESTRICT pAndMask,
+                                           INT32 andStep, BYTE* WINPR_RESTRICT pDst,
+                                           UINT32 dstStep, UINT32 DstFormat, UINT32 width,
+                                           UINT32 height)
+{
+	BYTE order[4] = { 0 };
+	const UINT32 vwidth = width & ~7u;
+
+	if (((xorBpp != 1) && (xorBpp != 24) && (xorBpp != 32)) || ((xorBpp == 1) && !pAndMask) ||
+	    (vwidth == 0) || !neon_pointer_dst_order(DstFormat, order))
+		return generic->pointerToRGB_8u_AC4R(pXorMask, xorStep, xorBpp, pAndMask, andStep, pDst,
+		                                     dstStep, DstFormat, width, height);
+
+	static const BYTE bits[] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+	static const BYTE even[] = { 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00 };
+	const uint8x8_t lanes = vld1_u8(bits);
+	const uint8x8_t ones = vdup_n_u8(0xFF);
+	const uint8x8_t zero = vdup_n_u8(0x00);
+	/* color channels of even pixels on even lines are white, black otherwise */
+	const uint8x8_t invertedEven = vld1_u8(even);
+	const uint8x8_t invertedOdd = vmvn_u8(invertedEven);
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* xorLine = &pXorMask[(SSIZE_T)y * xorStep];
+		const BYTE* andLine = pAndMask ? &pAndMask[(SSIZE_T)y * andStep] : NULL;
+		BYTE* dstLine = &pDst[y * dstStep];
+		const uint8x8_t inverted = (y & 1) ? invertedOdd : invertedEven;
+
+		for (size_t x = 0; x < vwidth; x += 8)
+		{
+			const uint8x8_t andPixel =
+			    andLine ? neon_pointer_expand_bits(andLine[x / 8], lanes) : zero;
+			uint8x8_t ch[5] = { 0 };
+
+			switch (xorBpp)
+			{
+				case 1:
+				{
+					/* opaque black or white, transparent or inverted where the AND bit is set */
+					const uint8x8_t xorPixel = neon_pointer_expand_bits(xorLine[x / 8], lanes);
+					const uint8x8_t rgb = vbsl_u8(andPixel, vand_u8(xorPixel, inverted), xorPixel);
+					ch[0] = rgb;
+					ch[1] = rgb;
+					ch[2] = rgb;
+					ch[3] = vbsl_u8(andPixel, xorPixel, ones);
+				}
+				break;
+
+				case 24:
+				{
+					const uint8x8x3_t c = vld3_u8(&xorLine[3 * x]);
+					const uint8x8_t white =
+					    vand_u8(vceq_u8(c.val[0], ones),
+					            vand_u8(vceq_u8(c.val[1], ones), vceq_u8(c.val[2], ones)));
+					const uint8x8_t inv = vand_u8(white, inverted);
+					for (size_t i = 0; i < 3; i++)
+						ch[i] = vbsl_u8(andPixel, inv, c.val[i]);
+					ch[3] = vbsl_u8(andPixel, white, ones);
+				}
+				break;
+
+				default:
+				{
+					const uint8x8x4_t c = vld4_u8(&xorLine[4 * x]);
+					const uint8x8_t rgbWhite =
+					    vand_u8(vceq_u8(c.val[0], ones),
+					            vand_u8(vceq_u8(c.val[1], ones), vceq_u8(c.val[2], ones)));
+					const uint8x8_t rgbBlack =
+					    vand_u8(vceq_u8(c.val[0], zero),
+					            vand_u8(vceq_u8(c.val[1], zero), vceq_u8(c.val[2], zero)));
+					const uint8x8_t opaque = vceq_u8(c.val[3], ones);
+					const uint8x8_t white = vand_u8(rgbWhite, opaque);
+					const uint8x8_t replace =
+					    vand_u8(andPixel, vand_u8(vorr_u8(rgbWhite, rgbBlack), opaque));
+					const uint8x8_t inv = vand_u8(white, inverted);
+					for (size_t i = 0; i < 3; i++)
+						ch[i] = vbsl_u8(replace, inv, c.val[i]);
+					ch[3] = vbsl_u8(replace, white, c.val[3]);
+				}
+				break;
+			}
+
+			ch[4] = zero;
+
+			uint8x8x4_t px;
+			px.val[0] = ch[order[0]];
+			px.val[1] = ch[order[1]];
+			px.val[2] = ch[order[2]];
+			px.val[3] = ch[order[3]];
+			vst4_u8(&dstLine[4 * x], px);
+		}
+	}
+
+	if (vwidth == width)
+		return PRIMITIVES_SUCCESS;
+
+	/* the remaining columns start at a multiple of 8, so the inverted pattern and the mask bit
+	 * positions stay aligned */
+	return generic->pointerToRGB_8u_AC4R(&pXorMask[vwidth * xorBpp / 8], xorStep, xorBpp,
+	                                     pAndMask ? &pAndMask[vwidth / 8] : NULL, andStep,
+	                                     &pDst[4ull * vwidth], dstStep, DstFormat, width - vwidth,
+	                                     height);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_pointer_neon_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	prims->pointerToRGB_8u_AC4R = neon_pointerToRGB_8u_AC4R;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
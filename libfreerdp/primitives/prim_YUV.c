@@ -2303,6 +2303,161 @@ static pstatus_t general_RGBToAVC444YUVv2(const BYTE* WINPR_RESTRICT pSrc, UINT3
 	return !PRIMITIVES_SUCCESS;
 }
 
+/* Camera formats: 2 pixels share a chroma sample horizontally, odd sizes are rounded up */
+static void general_YUY2ToLuma(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                               BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 width,
+                               UINT32 height)
+{
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* WINPR_RESTRICT s = &pSrc[y * srcStep];
+		BYTE* WINPR_RESTRICT d = &pDst[y * dstStep];
+
+		for (size_t x = 0; x < width; x++)
+			d[x] = s[2 * x];
+	}
+}
+
+/* 4:2:2 to 4:2:0, each chroma sample is the average of two vertically adjacent ones */
+static pstatus_t general_YUY2ToYUV420_8u_C2P3R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                               BYTE* WINPR_RESTRICT pDst[3],
+                                               const UINT32 dstStep[3],
+                                               const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(pSrc);
+	WINPR_ASSERT(pDst);
+	WINPR_ASSERT(dstStep);
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	general_YUY2ToLuma(pSrc, srcStep, pDst[0], dstStep[0], roi->width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s0 = &pSrc[2 * y * srcStep];
+		const BYTE* WINPR_RESTRICT s1 = (2 * y + 1 < roi->height) ? &s0[srcStep] : s0;
+		BYTE* WINPR_RESTRICT u = &pDst[1][y * dstStep[1]];
+		BYTE* WINPR_RESTRICT v = &pDst[2][y * dstStep[2]];
+
+		for (size_t x = 0; x < cw; x++)
+		{
+			u[x] = (BYTE)((s0[4 * x + 1] + s1[4 * x + 1] + 1) >> 1);
+			v[x] = (BYTE)((s0[4 * x + 3] + s1[4 * x + 3] + 1) >> 1);
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t general_YUY2ToNV12_8u_C2P2R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                             BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+                                             const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(pSrc);
+	WINPR_ASSERT(pDst);
+	WINPR_ASSERT(dstStep);
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	general_YUY2ToLuma(pSrc, srcStep, pDst[0], dstStep[0], roi->width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s0 = &pSrc[2 * y * srcStep];
+		const BYTE* WINPR_RESTRICT s1 = (2 * y + 1 < roi->height) ? &s0[srcStep] : s0;
+		BYTE* WINPR_RESTRICT d = &pDst[1][y * dstStep[1]];
+
+		for (size_t x = 0; x < 2 * cw; x++)
+			d[x] = (BYTE)((s0[2 * x + 1] + s1[2 * x + 1] + 1) >> 1);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static void general_copyLuma(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                             BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 width,
+                             UINT32 height)
+{
+	if ((srcStep == width) && (dstStep == width))
+	{
+		memcpy(pDst, pSrc, 1ull * width * height);
+		return;
+	}
+
+	for (size_t y = 0; y < height; y++)
+		memcpy(&pDst[y * dstStep], &pSrc[y * srcStep], width);
+}
+
+static pstatus_t general_NV12ToYUV420_8u_P2P3R(const BYTE* WINPR_RESTRICT pSrc[3],
+                                               const UINT32 srcStep[3],
+                                               BYTE* WINPR_RESTRICT pDst[3],
+                                               const UINT32 dstStep[3],
+                                               const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(pSrc);
+	WINPR_ASSERT(srcStep);
+	WINPR_ASSERT(pDst);
+	WINPR_ASSERT(dstStep);
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	general_copyLuma(pSrc[0], srcStep[0], pDst[0], dstStep[0], roi->width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s = &pSrc[1][y * srcStep[1]];
+		BYTE* WINPR_RESTRICT u = &pDst[1][y * dstStep[1]];
+		BYTE* WINPR_RESTRICT v = &pDst[2][y * dstStep[2]];
+
+		for (size_t x = 0; x < cw; x++)
+		{
+			u[x] = s[2 * x];
+			v[x] = s[2 * x + 1];
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t general_YUV420ToNV12_8u_P3P2R(const BYTE* WINPR_RESTRICT pSrc[3],
+                                               const UINT32 srcStep[3],
+                                               BYTE* WINPR_RESTRICT pDst[3],
+                                               const UINT32 dstStep[3],
+                                               const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(pSrc);
+	WINPR_ASSERT(srcStep);
+	WINPR_ASSERT(pDst);
+	WINPR_ASSERT(dstStep);
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	general_copyLuma(pSrc[0], srcStep[0], pDst[0], dstStep[0], roi->width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT u = &pSrc[1][y * srcStep[1]];
+		const BYTE* WINPR_RESTRICT v = &pSrc[2][y * srcStep[2]];
+		BYTE* WINPR_RESTRICT d = &pDst[1][y * dstStep[1]];
+
+		for (size_t x = 0; x < cw; x++)
+		{
+			d[2 * x] = u[x];
+			d[2 * x + 1] = v[x];
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
 void primitives_init_YUV(primitives_t* WINPR_RESTRICT prims)
 {
 	prims->YUV420ToRGB_8u_P3AC4R = general_YUV420ToRGB_8u_P3AC4R;
@@ -2313,6 +2468,10 @@ void primitives_init_YUV(primitives_t* WINPR_RESTRICT prims)
 	prims->YUV444SplitToYUV420 = general_YUV444SplitToYUV420;
 	prims->RGBToAVC444YUV = general_RGBToAVC444YUV;
 	prims->RGBToAVC444YUVv2 = general_RGBToAVC444YUVv2;
+	prims->YUY2ToYUV420_8u_C2P3R = general_YUY2ToYUV420_8u_C2P3R;
+	prims->YUY2ToNV12_8u_C2P2R = general_YUY2ToNV12_8u_C2P2R;
+	prims->NV12ToYUV420_8u_P2P3R = general_NV12ToYUV420_8u_P2P3R;
+	prims->YUV420ToNV12_8u_P3P2R = general_YUV420ToNV12_8u_P3P2R;
 }
 
 void primitives_init_YUV_opt(primitives_t* WINPR_RESTRICT prims)
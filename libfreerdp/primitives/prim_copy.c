@@ -287,6 +287,93 @@ pstatus_t generic_image_copy_no_overlap_memcpy(
 	return PRIMITIVES_SUCCESS;
 }
 
+/* byte offsets of r, g, b and a in a pixel, -1 if the channel is not stored.
+ * X formats read alpha as 0xFF, when writing RGBX/BGRX store it while XRGB/XBGR zero it. */
+static BOOL copy_channel_offsets(UINT32 format, BOOL write, INT8 offsets[4])
+{
+	INT8 r = 0;
+	INT8 g = 1;
+	INT8 b = 2;
+	INT8 a = 3;
+
+	switch (format)
+	{
+		case PIXEL_FORMAT_ARGB32:
+		case PIXEL_FORMAT_XRGB32:
+			r = 1;
+			g = 2;
+			b = 3;
+			a = 0;
+			break;
+		case PIXEL_FORMAT_ABGR32:
+		case PIXEL_FORMAT_XBGR32:
+			b = 1;
+			g = 2;
+			r = 3;
+			a = 0;
+			break;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+		case PIXEL_FORMAT_RGB24:
+			break;
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGR24:
+			b = 0;
+			r = 2;
+			break;
+		default:
+			return FALSE;
+	}
+
+	if (FreeRDPGetBytesPerPixel(format) == 3)
+		a = -1;
+	else if (!FreeRDPColorHasAlpha(format) && (!write || (a == 0)))
+		a = -1;
+
+	offsets[0] = r;
+	offsets[1] = g;
+	offsets[2] = b;
+	offsets[3] = a;
+	return TRUE;
+}
+
+BOOL primitives_copy_swizzle_mask(UINT32 SrcFormat, UINT32 DstFormat, BYTE shuffle[16],
+                                  BYTE fill[16])
+{
+	INT8 src[4] = { 0 };
+	INT8 dst[4] = { 0 };
+
+	WINPR_ASSERT(shuffle);
+	WINPR_ASSERT(fill);
+
+	if (!copy_channel_offsets(SrcFormat, FALSE, src) || !copy_channel_offsets(DstFormat, TRUE, dst))
+		return FALSE;
+
+	const size_t srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const size_t dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+
+	/* unused bytes are zeroed, pshufb zeroes lanes with the high bit set */
+	memset(shuffle, 0x80, 16);
+	memset(fill, 0x00, 16);
+
+	for (size_t x = 0; x < 4; x++)
+	{
+		for (size_t c = 0; c < 4; c++)
+		{
+			if (dst[c] < 0)
+				continue;
+
+			const size_t pos = x * dstByte + (size_t)dst[c];
+			if (src[c] < 0)
+				fill[pos] = 0xFF;
+			else
+				shuffle[pos] = (BYTE)(x * srcByte + (size_t)src[c]);
+		}
+	}
+	return TRUE;
+}
+
 static inline pstatus_t generic_image_copy_no_overlap_dst_alpha(
     BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
@@ -434,4 +521,5 @@ void primitives_init_copy_opt(primitives_t* WINPR_RESTRICT prims)
 #if defined(WITH_AVX2)
 	primitives_init_copy_avx2(prims);
 #endif
+	primitives_init_copy_neon(prims);
 }
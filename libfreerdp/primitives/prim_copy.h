@@ -40,6 +40,13 @@ pstatus_t generic_image_copy_no_overlap_memcpy(
     int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset,
     UINT32 flags);
 
+/** @brief builds a pshufb mask converting 4 pixels between two 24 or 32bpp formats.
+ *  Bytes of the result that are not copied from the source must be OR'ed with fill, which
+ *  sets alpha to 0xFF for sources without alpha.
+ *  @return FALSE if one of the formats is not a 24 or 32bpp RGB format */
+FREERDP_LOCAL BOOL primitives_copy_swizzle_mask(UINT32 SrcFormat, UINT32 DstFormat,
+                                                BYTE shuffle[16], BYTE fill[16]);
+
 FREERDP_LOCAL void primitives_init_copy_sse41_int(primitives_t* WINPR_RESTRICT prims);
 static inline void primitives_init_copy_sse41(primitives_t* WINPR_RESTRICT prims)
 {
@@ -60,4 +67,13 @@ static inline void primitives_init_copy_avx2(primitives_t* WINPR_RESTRICT prims)
 }
 #endif
 
+FREERDP_LOCAL void primitives_init_copy_neon_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_copy_neon(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_copy_neon_int(prims);
+}
+
 #endif
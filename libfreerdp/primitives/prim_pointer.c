@@ -0,0 +1,121 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives pointer shape conversion
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+
+#include "prim_internal.h"
+#include "prim_pointer.h"
+#include "../codec/color.h"
+
+/* ----------------------------------------------------------------------------
+ * Convert one pointer pixel to ARGB32.
+ *
+ * Inverted pointer colors (where individual pixels can change their color to accommodate the
+ * background behind them) only seem to be supported on Windows. A static replacement color might
+ * result in invisible pointers depending on the background, so use either black or white
+ * depending on the pixel's position.
+ */
+static inline UINT32 pointer_pixel_argb(const BYTE* WINPR_RESTRICT xorLine, UINT32 xorBpp,
+                                        BOOL andPixel, size_t x, size_t y)
+{
+	const UINT32 inverted = ((x + y) & 1) ? 0xFF000000 : 0xFFFFFFFF;
+
+	switch (xorBpp)
+	{
+		case 1:
+		{
+			const BOOL xorPixel = (xorLine[x / 8] & (0x80 >> (x % 8))) != 0;
+			if (!andPixel)
+				return xorPixel ? 0xFFFFFFFF : 0xFF000000;
+			return xorPixel ? inverted : 0;
+		}
+
+		case 24:
+		{
+			const BYTE* src = &xorLine[3 * x];
+			const UINT32 color =
+			    0xFF000000 | ((UINT32)src[2] << 16) | ((UINT32)src[1] << 8) | src[0];
+			if (!andPixel)
+				return color;
+			return (color == 0xFFFFFFFF) ? inverted : 0;
+		}
+
+		case 32:
+		default:
+		{
+			const BYTE* src = &xorLine[4 * x];
+			const UINT32 color = ((UINT32)src[3] << 24) | ((UINT32)src[2] << 16) |
+			                     ((UINT32)src[1] << 8) | src[0];
+			if (!andPixel)
+				return color;
+			if (color == 0xFF000000) /* black -> transparent */
+				return 0;
+			if (color == 0xFFFFFFFF) /* white -> inverted */
+				return inverted;
+			return color;
+		}
+	}
+}
+
+static pstatus_t general_pointerToRGB_8u_AC4R(const BYTE* WINPR_RESTRICT pXorMask, INT32 xorStep,
+                                              UINT32 xorBpp, const BYTE* WINPR_RESTRICT pAndMask,
+                                              INT32 andStep, BYTE* WINPR_RESTRICT pDst,
+                                              UINT32 dstStep, UINT32 DstFormat, UINT32 width,
+                                              UINT32 height)
+{
+	const UINT32 dstBpp = FreeRDPGetBytesPerPixel(DstFormat);
+
+	if ((xorBpp != 1) && (xorBpp != 24) && (xorBpp != 32))
+		return -1;
+	if ((xorBpp == 1) && !pAndMask)
+		return -1;
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* xorLine = &pXorMask[(SSIZE_T)y * xorStep];
+		const BYTE* andLine = pAndMask ? &pAndMask[(SSIZE_T)y * andStep] : NULL;
+		BYTE* dstLine = &pDst[y * dstStep];
+
+		for (size_t x = 0; x < width; x++)
+		{
+			const BOOL andPixel = andLine && (andLine[x / 8] & (0x80 >> (x % 8)));
+			const UINT32 argb = pointer_pixel_argb(xorLine, xorBpp, andPixel, x, y);
+			const UINT32 color = FreeRDPConvertColor(argb, PIXEL_FORMAT_ARGB32, DstFormat, NULL);
+			if (!FreeRDPWriteColor_int(&dstLine[x * dstBpp], DstFormat, color))
+				return -1;
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_pointer(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->pointerToRGB_8u_AC4R = general_pointerToRGB_8u_AC4R;
+}
+
+void primitives_init_pointer_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_pointer(prims);
+	primitives_init_pointer_ssse3(prims);
+	primitives_init_pointer_neon(prims);
+}
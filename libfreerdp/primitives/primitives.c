@@ -71,6 +71,7 @@ static BOOL primitives_init_generic(primitives_t* prims)
 	primitives_init_andor(prims);
 	primitives_init_alphaComp(prims);
 	primitives_init_copy(prims);
+	primitives_init_pointer(prims);
 	primitives_init_set(prims);
 	primitives_init_shift(prims);
 	primitives_init_sign(prims);
@@ -98,6 +99,7 @@ static BOOL primitives_init_optimized(primitives_t* prims)
 	primitives_init_andor_opt(prims);
 	primitives_init_alphaComp_opt(prims);
 	primitives_init_copy_opt(prims);
+	primitives_init_pointer_opt(prims);
 	primitives_init_set_opt(prims);
 	primitives_init_shift_opt(prims);
 	primitives_init_sign_opt(prims);
@@ -1721,6 +1721,185 @@ static pstatus_t sse41_YUV420CombineToYUV444(avc444_frame_type type,
 			return -1;
 	}
 }
+
+/****************************************************************************/
+/* sse41 YUY2/NV12/I420 camera frame conversion                             */
+/****************************************************************************/
+static inline void sse41_YUY2ToLuma(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                    BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, size_t width,
+                                    UINT32 height)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* WINPR_RESTRICT s = &pSrc[y * srcStep];
+		BYTE* WINPR_RESTRICT d = &pDst[y * dstStep];
+
+		for (size_t x = 0; x < width; x += 16)
+		{
+			const __m128i a = LOAD_SI128(&s[2 * x]);
+			const __m128i b = LOAD_SI128(&s[2 * x + 16]);
+			STORE_SI128(&d[x], _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+		}
+	}
+}
+
+/* U and V of 16 pixels (8 each, interleaved) averaged over two lines */
+static inline __m128i sse41_YUY2Chroma(const BYTE* WINPR_RESTRICT s0,
+                                       const BYTE* WINPR_RESTRICT s1)
+{
+	const __m128i a0 = _mm_srli_epi16(LOAD_SI128(s0), 8);
+	const __m128i b0 = _mm_srli_epi16(LOAD_SI128(&s0[16]), 8);
+	const __m128i a1 = _mm_srli_epi16(LOAD_SI128(s1), 8);
+	const __m128i b1 = _mm_srli_epi16(LOAD_SI128(&s1[16]), 8);
+	return _mm_avg_epu8(_mm_packus_epi16(a0, b0), _mm_packus_epi16(a1, b1));
+}
+
+/* The vector part covers multiples of 16 pixels, the generic code does the rest */
+static pstatus_t sse41_YUY2ToYUV420_8u_C2P3R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                             BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+                                             const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t width = roi->width & ~15u;
+	const size_t ch = (roi->height + 1ull) / 2;
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+
+	sse41_YUY2ToLuma(pSrc, srcStep, pDst[0], dstStep[0], width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s0 = &pSrc[2 * y * srcStep];
+		const BYTE* WINPR_RESTRICT s1 = (2 * y + 1 < roi->height) ? &s0[srcStep] : s0;
+		BYTE* WINPR_RESTRICT u = &pDst[1][y * dstStep[1]];
+		BYTE* WINPR_RESTRICT v = &pDst[2][y * dstStep[2]];
+
+		for (size_t x = 0; x < width; x += 16)
+		{
+			const __m128i uv = sse41_YUY2Chroma(&s0[2 * x], &s1[2 * x]);
+			const __m128i uu = _mm_packus_epi16(_mm_and_si128(uv, mask), uv);
+			const __m128i vv = _mm_packus_epi16(_mm_srli_epi16(uv, 8), uv);
+			_mm_storel_epi64((__m128i*)&u[x / 2], uu);
+			_mm_storel_epi64((__m128i*)&v[x / 2], vv);
+		}
+	}
+
+	if (width == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	BYTE* pRest[3] = { &pDst[0][width], &pDst[1][width / 2], &pDst[2][width / 2] };
+	const prim_size_t rest = { .width = roi->width - (UINT32)width, .height = roi->height };
+	return generic->YUY2ToYUV420_8u_C2P3R(&pSrc[2 * width], srcStep, pRest, dstStep, &rest);
+}
+
+static pstatus_t sse41_YUY2ToNV12_8u_C2P2R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                           BYTE* WINPR_RESTRICT pDst[3], const UINT32 dstStep[3],
+                                           const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t width = roi->width & ~15u;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	sse41_YUY2ToLuma(pSrc, srcStep, pDst[0], dstStep[0], width, roi->height);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s0 = &pSrc[2 * y * srcStep];
+		const BYTE* WINPR_RESTRICT s1 = (2 * y + 1 < roi->height) ? &s0[srcStep] : s0;
+		BYTE* WINPR_RESTRICT d = &pDst[1][y * dstStep[1]];
+
+		for (size_t x = 0; x < width; x += 16)
+			STORE_SI128(&d[x], sse41_YUY2Chroma(&s0[2 * x], &s1[2 * x]));
+	}
+
+	if (width == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	BYTE* pRest[3] = { &pDst[0][width], &pDst[1][width], NULL };
+	const prim_size_t rest = { .width = roi->width - (UINT32)width, .height = roi->height };
+	return generic->YUY2ToNV12_8u_C2P2R(&pSrc[2 * width], srcStep, pRest, dstStep, &rest);
+}
+
+/* 16 chroma samples (32 pixels) per iteration, the remaining columns are done one by one */
+static pstatus_t sse41_NV12ToYUV420_8u_P2P3R(const BYTE* WINPR_RESTRICT pSrc[3],
+                                             const UINT32 srcStep[3], BYTE* WINPR_RESTRICT pDst[3],
+                                             const UINT32 dstStep[3],
+                                             const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+
+	for (size_t y = 0; y < roi->height; y++)
+		memcpy(&pDst[0][y * dstStep[0]], &pSrc[0][y * srcStep[0]], roi->width);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT s = &pSrc[1][y * srcStep[1]];
+		BYTE* WINPR_RESTRICT u = &pDst[1][y * dstStep[1]];
+		BYTE* WINPR_RESTRICT v = &pDst[2][y * dstStep[2]];
+		size_t x = 0;
+
+		for (; x + 16 <= cw; x += 16)
+		{
+			const __m128i a = LOAD_SI128(&s[2 * x]);
+			const __m128i b = LOAD_SI128(&s[2 * x + 16]);
+			STORE_SI128(&u[x], _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+			STORE_SI128(&v[x], _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+		}
+
+		for (; x < cw; x++)
+		{
+			u[x] = s[2 * x];
+			v[x] = s[2 * x + 1];
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t sse41_YUV420ToNV12_8u_P3P2R(const BYTE* WINPR_RESTRICT pSrc[3],
+                                             const UINT32 srcStep[3], BYTE* WINPR_RESTRICT pDst[3],
+                                             const UINT32 dstStep[3],
+                                             const prim_size_t* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(roi);
+
+	const size_t cw = (roi->width + 1ull) / 2;
+	const size_t ch = (roi->height + 1ull) / 2;
+
+	for (size_t y = 0; y < roi->height; y++)
+		memcpy(&pDst[0][y * dstStep[0]], &pSrc[0][y * srcStep[0]], roi->width);
+
+	for (size_t y = 0; y < ch; y++)
+	{
+		const BYTE* WINPR_RESTRICT u = &pSrc[1][y * srcStep[1]];
+		const BYTE* WINPR_RESTRICT v = &pSrc[2][y * srcStep[2]];
+		BYTE* WINPR_RESTRICT d = &pDst[1][y * dstStep[1]];
+		size_t x = 0;
+
+		for (; x + 16 <= cw; x += 16)
+		{
+			const __m128i uu = LOAD_SI128(&u[x]);
+			const __m128i vv = LOAD_SI128(&v[x]);
+			STORE_SI128(&d[2 * x], _mm_unpacklo_epi8(uu, vv));
+			STORE_SI128(&d[2 * x + 16], _mm_unpackhi_epi8(uu, vv));
+		}
+
+		for (; x < cw; x++)
+		{
+			d[2 * x] = u[x];
+			d[2 * x + 1] = v[x];
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
 #endif
 
 void primitives_init_YUV_sse41_int(primitives_t* WINPR_RESTRICT prims)
@@ -1735,6 +1914,10 @@ void primitives_init_YUV_sse41_int(primitives_t* WINPR_RESTRICT prims)
 	prims->YUV420ToRGB_8u_P3AC4R = sse41_YUV420ToRGB;
 	prims->YUV444ToRGB_8u_P3AC4R = sse41_YUV444ToRGB_8u_P3AC4R;
 	prims->YUV420CombineToYUV444 = sse41_YUV420CombineToYUV444;
+	prims->YUY2ToYUV420_8u_C2P3R = sse41_YUY2ToYUV420_8u_C2P3R;
+	prims->YUY2ToNV12_8u_C2P2R = sse41_YUY2ToNV12_8u_C2P2R;
+	prims->NV12ToYUV420_8u_P2P3R = sse41_NV12ToYUV420_8u_P2P3R;
+	prims->YUV420ToNV12_8u_P3P2R = sse41_YUV420ToNV12_8u_P3P2R;
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or sse41 intrinsics not available");
 	WINPR_UNUSED(prims);
@@ -23,6 +23,7 @@
 #include <freerdp/log.h>
 
 #include "prim_internal.h"
+#include "prim_avxsse.h"
 #include "prim_copy.h"
 #include "../codec/color.h"
 
@@ -32,6 +33,9 @@
 #include <emmintrin.h>
 #include <immintrin.h>
 
+/* the implementation registered before AVX2, used for conversions without an AVX2 kernel */
+static fn_copy_no_overlap_t copy_no_overlap_fallback = NULL;
+
 static inline __m256i mm256_set_epu32(uint32_t i0, uint32_t i1, uint32_t i2, uint32_t i3,
                                       uint32_t i4, uint32_t i5, uint32_t i6, uint32_t i7)
 {
@@ -153,6 +157,94 @@ static inline pstatus_t avx2_image_copy_bgrx32_bgrx32(BYTE* WINPR_RESTRICT pDstD
 	return PRIMITIVES_SUCCESS;
 }
 
+/* 24 or 32bpp to 24 or 32bpp, 8 pixels per step. 24bpp pixels are loaded and stored as two
+ * 16 byte halves, so the vector loop stops 2 pixels early to stay within the line.
+ * @return the number of columns converted */
+static inline UINT32 avx2_image_copy_swizzle(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                             UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                             UINT32 nWidth, UINT32 nHeight,
+                                             const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                             UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                             int64_t srcVMultiplier, int64_t srcVOffset,
+                                             int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE smask[16] = { 0 };
+	BYTE sfill[16] = { 0 };
+
+	if (!primitives_copy_swizzle_mask(SrcFormat, DstFormat, smask, sfill))
+		return 0;
+
+	const int64_t srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const int64_t dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	const UINT32 pad = ((srcByte == 3) || (dstByte == 3)) ? 2 : 0;
+	if (nWidth < 8 + pad)
+		return 0;
+
+	const UINT32 width = (nWidth - pad) & ~7u;
+
+	/* _mm256_shuffle_epi8 works per 128bit lane, each lane holds 4 pixels */
+	const __m256i mask = _mm256_broadcastsi128_si256(LOAD_SI128(smask));
+	const __m256i fill = _mm256_broadcastsi128_si256(LOAD_SI128(sfill));
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 8)
+		{
+			const BYTE* src = &srcLine[(x + nXSrc) * srcByte];
+			BYTE* dst = &dstLine[(x + nXDst) * dstByte];
+			__m256i s0 = _mm256_setzero_si256();
+
+			if (srcByte == 4)
+				s0 = _mm256_loadu_si256((const __m256i*)src);
+			else
+				s0 = _mm256_inserti128_si256(_mm256_castsi128_si256(LOAD_SI128(src)),
+				                             LOAD_SI128(&src[12]), 1);
+
+			const __m256i d0 = _mm256_or_si256(_mm256_shuffle_epi8(s0, mask), fill);
+
+			if (dstByte == 4)
+				_mm256_storeu_si256((__m256i*)dst, d0);
+			else
+			{
+				STORE_SI128(dst, _mm256_castsi256_si128(d0));
+				STORE_SI128(&dst[12], _mm256_extracti128_si256(d0, 1));
+			}
+		}
+	}
+
+	return width;
+}
+
+static pstatus_t avx2_image_copy_no_overlap_convert(
+    BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+    UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+    UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
+    UINT32 flags, int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier,
+    int64_t dstVOffset)
+{
+	const UINT32 done = avx2_image_copy_swizzle(
+	    pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+	    nXSrc, nYSrc, srcVMultiplier, srcVOffset, dstVMultiplier, dstVOffset);
+
+	if (done == 0)
+		return copy_no_overlap_fallback(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+		                                nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                                palette, flags);
+
+	if (done >= nWidth)
+		return PRIMITIVES_SUCCESS;
+
+	return generic_image_copy_no_overlap_convert(
+	    pDstData, DstFormat, nDstStep, nXDst + done, nYDst, nWidth - done, nHeight, pSrcData,
+	    SrcFormat, nSrcStep, nXSrc + done, nYSrc, palette, srcVMultiplier, srcVOffset,
+	    dstVMultiplier, dstVOffset);
+}
+
 static pstatus_t avx2_image_copy_no_overlap_dst_alpha(
     BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
@@ -207,9 +299,10 @@ static pstatus_t avx2_image_copy_no_overlap_dst_alpha(
 			break;
 	}
 
-	primitives_t* gen = primitives_get_generic();
-	return gen->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
-	                            pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette, flags);
+	return avx2_image_copy_no_overlap_convert(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+	                                          nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+	                                          palette, flags, srcVMultiplier, srcVOffset,
+	                                          dstVMultiplier, dstVOffset);
 }
 
 static pstatus_t avx2_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
@@ -257,11 +350,10 @@ static pstatus_t avx2_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD
 		                                            nXSrc, nYSrc, palette, srcVMultiplier,
 		                                            srcVOffset, dstVMultiplier, dstVOffset, flags);
 	else
-	{
-		primitives_t* gen = primitives_get_generic();
-		return gen->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
-		                            pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette, flags);
-	}
+		return avx2_image_copy_no_overlap_convert(pDstData, DstFormat, nDstStep, nXDst, nYDst,
+		                                          nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+		                                          nXSrc, nYSrc, palette, flags, srcVMultiplier,
+		                                          srcVOffset, dstVMultiplier, dstVOffset);
 }
 #endif
 
@@ -270,6 +362,8 @@ void primitives_init_copy_avx2_int(primitives_t* WINPR_RESTRICT prims)
 {
 #if defined(SSE_AVX_INTRINSICS_ENABLED)
 	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	if (prims->copy_no_overlap != avx2_image_copy_no_overlap)
+		copy_no_overlap_fallback = prims->copy_no_overlap;
 	prims->copy_no_overlap = avx2_image_copy_no_overlap;
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
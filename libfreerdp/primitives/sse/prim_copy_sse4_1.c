@@ -132,12 +132,214 @@ static inline pstatus_t sse_image_copy_bgrx32_bgrx32(BYTE* WINPR_RESTRICT pDstDa
 	return PRIMITIVES_SUCCESS;
 }
 
+static inline BOOL sse_is_rgb16(UINT32 format)
+{
+	return (format == PIXEL_FORMAT_RGB16) || (format == PIXEL_FORMAT_BGR16);
+}
+
+/* The kernels below convert columns [0, n) of every line and return n, the remaining columns
+ * are left to generic_image_copy_no_overlap_convert. 24bpp lines are loaded and stored 16 bytes
+ * at a time, so the vector loop stops 2 pixels early to stay within the line. */
+static inline UINT32 sse_image_copy_swizzle(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                            UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                            UINT32 nWidth, UINT32 nHeight,
+                                            const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                            UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                            int64_t srcVMultiplier, int64_t srcVOffset,
+                                            int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE smask[16] = { 0 };
+	BYTE sfill[16] = { 0 };
+
+	if (!primitives_copy_swizzle_mask(SrcFormat, DstFormat, smask, sfill))
+		return 0;
+
+	const int64_t srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const int64_t dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	const UINT32 pad = ((srcByte == 3) || (dstByte == 3)) ? 2 : 0;
+	if (nWidth < 4 + pad)
+		return 0;
+
+	const UINT32 width = (nWidth - pad) & ~3u;
+	const __m128i mask = LOAD_SI128(smask);
+	const __m128i fill = LOAD_SI128(sfill);
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 4)
+		{
+			const __m128i s0 = LOAD_SI128(&srcLine[(x + nXSrc) * srcByte]);
+			const __m128i d0 = _mm_or_si128(_mm_shuffle_epi8(s0, mask), fill);
+			STORE_SI128(&dstLine[(x + nXDst) * dstByte], d0);
+		}
+	}
+
+	return width;
+}
+
+/* RGB16/BGR16 to 24 or 32bpp, 8 pixels per step. The 5/6 bit channels are expanded like
+ * FreeRDPSplitColor does, then interleaved to BGRX and swizzled to the destination format. */
+static inline UINT32 sse_image_copy_unpack16(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                             UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                             UINT32 nWidth, UINT32 nHeight,
+                                             const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                             UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                             int64_t srcVMultiplier, int64_t srcVOffset,
+                                             int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE smask[16] = { 0 };
+	BYTE sfill[16] = { 0 };
+
+	if (!primitives_copy_swizzle_mask(PIXEL_FORMAT_BGRX32, DstFormat, smask, sfill))
+		return 0;
+
+	const int64_t srcByte = 2;
+	const int64_t dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	const UINT32 pad = (dstByte == 3) ? 2 : 0;
+	if (nWidth < 8 + pad)
+		return 0;
+
+	const BOOL bgr = (SrcFormat == PIXEL_FORMAT_BGR16);
+	const UINT32 width = (nWidth - pad) & ~7u;
+	const __m128i mask = LOAD_SI128(smask);
+	const __m128i fill = LOAD_SI128(sfill);
+	const __m128i m5 = _mm_set1_epi16(0x1F);
+	const __m128i m6 = _mm_set1_epi16(0x3F);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 8)
+		{
+			const __m128i v = LOAD_SI128(&srcLine[(x + nXSrc) * srcByte]);
+			const __m128i hi5 = _mm_srli_epi16(v, 11);
+			const __m128i lo5 = _mm_and_si128(v, m5);
+			__m128i r = bgr ? lo5 : hi5;
+			__m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), m6);
+			__m128i b = bgr ? hi5 : lo5;
+
+			/* green may exceed 255, packus saturates like the clamp in FreeRDPSplitColor */
+			r = _mm_add_epi16(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+			g = _mm_add_epi16(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 3));
+			b = _mm_add_epi16(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+			const __m128i bg = _mm_packus_epi16(b, g);
+			const __m128i r0 = _mm_packus_epi16(r, zero);
+			const __m128i bgi = _mm_unpacklo_epi8(bg, _mm_srli_si128(bg, 8));
+			const __m128i r0i = _mm_unpacklo_epi8(r0, zero);
+			const __m128i lo = _mm_unpacklo_epi16(bgi, r0i);
+			const __m128i hi = _mm_unpackhi_epi16(bgi, r0i);
+
+			BYTE* dst = &dstLine[(x + nXDst) * dstByte];
+			STORE_SI128(dst, _mm_or_si128(_mm_shuffle_epi8(lo, mask), fill));
+			STORE_SI128(&dst[4 * dstByte], _mm_or_si128(_mm_shuffle_epi8(hi, mask), fill));
+		}
+	}
+
+	return width;
+}
+
+/* 24 or 32bpp to RGB16/BGR16, 8 pixels per step */
+static inline UINT32 sse_image_copy_pack16(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                           UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                           UINT32 nWidth, UINT32 nHeight,
+                                           const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                           UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                           int64_t srcVMultiplier, int64_t srcVOffset,
+                                           int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	BYTE smask[16] = { 0 };
+	BYTE sfill[16] = { 0 };
+
+	if (!primitives_copy_swizzle_mask(SrcFormat, PIXEL_FORMAT_BGRX32, smask, sfill))
+		return 0;
+
+	const int64_t srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const int64_t dstByte = 2;
+	const UINT32 pad = (srcByte == 3) ? 2 : 0;
+	if (nWidth < 8 + pad)
+		return 0;
+
+	const BOOL bgr = (DstFormat == PIXEL_FORMAT_BGR16);
+	const UINT32 width = (nWidth - pad) & ~7u;
+	const __m128i mask = LOAD_SI128(smask);
+	const __m128i m5 = _mm_set1_epi32(0x1F);
+	const __m128i m6 = _mm_set1_epi32(0x3F);
+
+	for (int64_t y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		BYTE* WINPR_RESTRICT dstLine =
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+
+		for (int64_t x = 0; x < width; x += 8)
+		{
+			const BYTE* src = &srcLine[(x + nXSrc) * srcByte];
+			__m128i c[2];
+
+			for (size_t z = 0; z < 2; z++)
+			{
+				const __m128i v = _mm_shuffle_epi8(LOAD_SI128(&src[4 * z * srcByte]), mask);
+				const __m128i b = _mm_and_si128(_mm_srli_epi32(v, 3), m5);
+				const __m128i g = _mm_and_si128(_mm_srli_epi32(v, 10), m6);
+				const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 19), m5);
+				const __m128i hi = _mm_slli_epi32(bgr ? b : r, 11);
+				c[z] = _mm_or_si128(_mm_or_si128(hi, _mm_slli_epi32(g, 5)), bgr ? r : b);
+			}
+
+			STORE_SI128(&dstLine[(x + nXDst) * dstByte], _mm_packus_epi32(c[0], c[1]));
+		}
+	}
+
+	return width;
+}
+
+static pstatus_t sse_image_copy_no_overlap_convert(
+    BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+    UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+    UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
+    int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset)
+{
+	UINT32 done = 0;
+
+	if (sse_is_rgb16(SrcFormat))
+		done = sse_image_copy_unpack16(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+		                               nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                               srcVMultiplier, srcVOffset, dstVMultiplier, dstVOffset);
+	else if (sse_is_rgb16(DstFormat))
+		done = sse_image_copy_pack16(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
+		                             pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, srcVMultiplier,
+		                             srcVOffset, dstVMultiplier, dstVOffset);
+	else
+		done = sse_image_copy_swizzle(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
+		                              pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, srcVMultiplier,
+		                              srcVOffset, dstVMultiplier, dstVOffset);
+
+	if (done >= nWidth)
+		return PRIMITIVES_SUCCESS;
+
+	return generic_image_copy_no_overlap_convert(
+	    pDstData, DstFormat, nDstStep, nXDst + done, nYDst, nWidth - done, nHeight, pSrcData,
+	    SrcFormat, nSrcStep, nXSrc + done, nYSrc, palette, srcVMultiplier, srcVOffset,
+	    dstVMultiplier, dstVOffset);
+}
+
 static pstatus_t sse_image_copy_no_overlap_dst_alpha(
     BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
     UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
-    UINT32 flags, int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier,
-    int64_t dstVOffset)
+    int64_t srcVMultiplier, int64_t srcVOffset, int64_t dstVMultiplier, int64_t dstVOffset)
 {
 	WINPR_ASSERT(pDstData);
 	WINPR_ASSERT(pSrcData);
@@ -186,9 +388,9 @@ static pstatus_t sse_image_copy_no_overlap_dst_alpha(
 			break;
 	}
 
-	primitives_t* gen = primitives_get_generic();
-	return gen->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
-	                            pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette, flags);
+	return sse_image_copy_no_overlap_convert(
+	    pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+	    nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset, dstVMultiplier, dstVOffset);
 }
 
 static pstatus_t sse_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
@@ -228,7 +430,7 @@ static pstatus_t sse_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD
 	if (((flags & FREERDP_KEEP_DST_ALPHA) != 0) && FreeRDPColorHasAlpha(DstFormat))
 		return sse_image_copy_no_overlap_dst_alpha(pDstData, DstFormat, nDstStep, nXDst, nYDst,
 		                                           nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
-		                                           nXSrc, nYSrc, palette, flags, srcVMultiplier,
+		                                           nXSrc, nYSrc, palette, srcVMultiplier,
 		                                           srcVOffset, dstVMultiplier, dstVOffset);
 	else if (FreeRDPAreColorFormatsEqualNoAlpha(SrcFormat, DstFormat))
 		return generic_image_copy_no_overlap_memcpy(pDstData, DstFormat, nDstStep, nXDst, nYDst,
@@ -236,11 +438,10 @@ static pstatus_t sse_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD
 		                                            nXSrc, nYSrc, palette, srcVMultiplier,
 		                                            srcVOffset, dstVMultiplier, dstVOffset, flags);
 	else
-	{
-		primitives_t* gen = primitives_get_generic();
-		return gen->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight,
-		                            pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette, flags);
-	}
+		return sse_image_copy_no_overlap_convert(pDstData, DstFormat, nDstStep, nXDst, nYDst,
+		                                         nWidth, nHeight, pSrcData, SrcFormat, nSrcStep,
+		                                         nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset,
+		                                         dstVMultiplier, dstVOffset);
 }
 #endif
 
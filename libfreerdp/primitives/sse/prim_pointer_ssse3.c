@@ -0,0 +1,218 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized pointer shape conversion
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_pointer.h"
+
+#include "prim_internal.h"
+#include "prim_avxsse.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Pixels are converted to ARGB32 (B, G, R, A in memory) and shuffled to the destination format.
+ * Returns FALSE for formats that are not a byte permutation of ARGB32. */
+static BOOL ssse3_pointer_dst_shuffle(UINT32 DstFormat, __m128i* shuffle)
+{
+	/* source byte of each destination byte, 0x80 clears it */
+	static const BYTE argb[] = { 3, 2, 1, 0 };
+	static const BYTE xrgb[] = { 0x80, 2, 1, 0 };
+	static const BYTE abgr[] = { 3, 0, 1, 2 };
+	static const BYTE xbgr[] = { 0x80, 0, 1, 2 };
+	static const BYTE rgba[] = { 2, 1, 0, 3 };
+	static const BYTE bgra[] = { 0, 1, 2, 3 };
+	const BYTE* order = NULL;
+
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_ARGB32:
+			order = argb;
+			break;
+		case PIXEL_FORMAT_XRGB32:
+			order = xrgb;
+			break;
+		case PIXEL_FORMAT_ABGR32:
+			order = abgr;
+			break;
+		case PIXEL_FORMAT_XBGR32:
+			order = xbgr;
+			break;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			order = rgba;
+			break;
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			order = bgra;
+			break;
+		default:
+			return FALSE;
+	}
+
+	BYTE mask[16] = { 0 };
+	for (size_t x = 0; x < ARRAYSIZE(mask); x++)
+	{
+		const BYTE o = order[x % 4];
+		mask[x] = (o & 0x80) ? o : (BYTE)(o + (x & ~3u));
+	}
+	*shuffle = LOAD_SI128(mask);
+	return TRUE;
+}
+
+/* expands the 4 mask bits (MSB first) to one lane each */
+static inline __m128i ssse3_pointer_expand_bits(UINT32 bits, __m128i lanes)
+{
+	const __m128i v = _mm_and_si128(mm_set1_epu32(bits), lanes);
+	return _mm_cmpeq_epi32(v, lanes);
+}
+
+static inline __m128i ssse3_pointer_mono(__m128i xorPixel, __m128i andPixel, __m128i inverted)
+{
+	const __m128i black = mm_set1_epu32(0xFF000000);
+	const __m128i rgb = mm_set1_epu32(0x00FFFFFF);
+	const __m128i opaque = _mm_or_si128(black, _mm_and_si128(xorPixel, rgb));
+	const __m128i inv = _mm_and_si128(_mm_and_si128(andPixel, xorPixel), inverted);
+	return _mm_or_si128(_mm_andnot_si128(andPixel, opaque), inv);
+}
+
+static inline __m128i ssse3_pointer_rgb(__m128i color, __m128i andPixel, __m128i inverted)
+{
+	const __m128i white = _mm_cmpeq_epi32(color, mm_set1_epu32(0xFFFFFFFF));
+	const __m128i inv = _mm_and_si128(_mm_and_si128(andPixel, white), inverted);
+	return _mm_or_si128(_mm_andnot_si128(andPixel, color), inv);
+}
+
+static inline __m128i ssse3_pointer_argb(__m128i color, __m128i andPixel, __m128i inverted)
+{
+	const __m128i white = _mm_cmpeq_epi32(color, mm_set1_epu32(0xFFFFFFFF));
+	const __m128i black = _mm_cmpeq_epi32(color, mm_set1_epu32(0xFF000000));
+	const __m128i replace = _mm_and_si128(andPixel, _mm_or_si128(white, black));
+	const __m128i inv = _mm_and_si128(_mm_and_si128(andPixel, white), inverted);
+	return _mm_or_si128(_mm_andnot_si128(replace, color), inv);
+}
+
+static pstatus_t ssse3_pointerToRGB_8u_AC4R(const BYTE* WINPR_RESTRICT pXorMask, INT32 xorStep,
+                                            UINT32 xorBpp, const BYTE* WINPR_RESTRICT pAndMask,
+                                            INT32 andStep, BYTE* WINPR_RESTRICT pDst,
+                                            UINT32 dstStep, UINT32 DstFormat, UINT32 width,
+                                            UINT32 height)
+{
+	__m128i shuffle = { 0 };
+	const UINT32 vwidth = width & ~7u;
+
+	if (((xorBpp != 1) && (xorBpp != 24) && (xorBpp != 32)) || ((xorBpp == 1) && !pAndMask) ||
+	    (vwidth == 0) || !ssse3_pointer_dst_shuffle(DstFormat, &shuffle))
+		return generic->pointerToRGB_8u_AC4R(pXorMask, xorStep, xorBpp, pAndMask, andStep, pDst,
+		                                     dstStep, DstFormat, width, height);
+
+	const __m128i lanes = _mm_set_epi32(1, 2, 4, 8);
+	const __m128i alpha = mm_set1_epu32(0xFF000000);
+	const __m128i rgb0 = mm_set_epu8(0x80, 11, 10, 9, 0x80, 8, 7, 6, 0x80, 5, 4, 3, 0x80, 2, 1, 0);
+	const __m128i rgb1 =
+	    mm_set_epu8(0x80, 15, 14, 13, 0x80, 12, 11, 10, 0x80, 9, 8, 7, 0x80, 6, 5, 4);
+	/* lanes of even pixels on even lines are white, black otherwise */
+	const __m128i invertedEven = mm_set_epu32(0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF);
+	const __m128i invertedOdd = mm_set_epu32(0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000);
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* xorLine = &pXorMask[(SSIZE_T)y * xorStep];
+		const BYTE* andLine = pAndMask ? &pAndMask[(SSIZE_T)y * andStep] : NULL;
+		BYTE* dstLine = &pDst[y * dstStep];
+		const __m128i inverted = (y & 1) ? invertedOdd : invertedEven;
+
+		for (size_t x = 0; x < vwidth; x += 8)
+		{
+			const UINT32 andBits = andLine ? andLine[x / 8] : 0;
+			const __m128i and0 = ssse3_pointer_expand_bits(andBits >> 4, lanes);
+			const __m128i and1 = ssse3_pointer_expand_bits(andBits & 0x0F, lanes);
+			__m128i px0 = { 0 };
+			__m128i px1 = { 0 };
+
+			switch (xorBpp)
+			{
+				case 1:
+				{
+					const UINT32 xorBits = xorLine[x / 8];
+					px0 = ssse3_pointer_mono(ssse3_pointer_expand_bits(xorBits >> 4, lanes), and0,
+					                         inverted);
+					px1 = ssse3_pointer_mono(ssse3_pointer_expand_bits(xorBits & 0x0F, lanes),
+					                         and1, inverted);
+				}
+				break;
+
+				case 24:
+				{
+					/* 8 pixels are 24 bytes, the second load overlaps the first */
+					const BYTE* src = &xorLine[3 * x];
+					const __m128i c0 = _mm_or_si128(_mm_shuffle_epi8(LOAD_SI128(src), rgb0), alpha);
+					const __m128i c1 =
+					    _mm_or_si128(_mm_shuffle_epi8(LOAD_SI128(&src[8]), rgb1), alpha);
+					px0 = ssse3_pointer_rgb(c0, and0, inverted);
+					px1 = ssse3_pointer_rgb(c1, and1, inverted);
+				}
+				break;
+
+				default:
+				{
+					const BYTE* src = &xorLine[4 * x];
+					px0 = ssse3_pointer_argb(LOAD_SI128(src), and0, inverted);
+					px1 = ssse3_pointer_argb(LOAD_SI128(&src[16]), and1, inverted);
+				}
+				break;
+			}
+
+			STORE_SI128(&dstLine[4 * x], _mm_shuffle_epi8(px0, shuffle));
+			STORE_SI128(&dstLine[4 * x + 16], _mm_shuffle_epi8(px1, shuffle));
+		}
+	}
+
+	if (vwidth == width)
+		return PRIMITIVES_SUCCESS;
+
+	/* the remaining columns start at a multiple of 8, so the inverted pattern and the mask bit
+	 * positions stay aligned */
+	return generic->pointerToRGB_8u_AC4R(&pXorMask[vwidth * xorBpp / 8], xorStep, xorBpp,
+	                                     pAndMask ? &pAndMask[vwidth / 8] : NULL, andStep,
+	                                     &pDst[4ull * vwidth], dstStep, DstFormat, width - vwidth,
+	                                     height);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_pointer_ssse3_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "SSE3/SSSE3 optimizations");
+	prims->pointerToRGB_8u_AC4R = ssse3_pointerToRGB_8u_AC4R;
+
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSSE3 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
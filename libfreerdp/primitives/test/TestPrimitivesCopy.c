@@ -252,36 +252,52 @@ int TestPrimitivesCopy(int argc, char* argv[])
 		FREERDP_KEEP_DST_ALPHA | FREERDP_FLIP_VERTICAL | FREERDP_FLIP_HORIZONTAL
 #endif
 	};
-	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32,
-		                       PIXEL_FORMAT_BGRX32,
-		                       PIXEL_FORMAT_BGR24
-#if defined(TEST_ALL_FLAGS) /* Only the previous 3 have SIMD optimizations, so skip the rest */
-		                       ,
-		                       PIXEL_FORMAT_RGB24,
-		                       PIXEL_FORMAT_ABGR32,
-		                       PIXEL_FORMAT_ARGB32,
-		                       PIXEL_FORMAT_XBGR32,
-		                       PIXEL_FORMAT_XRGB32,
-		                       PIXEL_FORMAT_RGBA32,
-		                       PIXEL_FORMAT_RGBX32
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_BGR24,
+		                       PIXEL_FORMAT_RGB24,  PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_ARGB32,
+		                       PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_RGBA32,
+		                       PIXEL_FORMAT_RGBX32, PIXEL_FORMAT_RGB16,  PIXEL_FORMAT_BGR16 };
+	/* one pair per conversion kernel: swizzle 24 -> 32bpp, swizzle 32 -> 32bpp, RGB16 unpack
+	 * and pack. The full format matrix runs with TEST_ALL_FLAGS or when timing. */
+	const UINT32 pairs[][2] = { { PIXEL_FORMAT_RGB24, PIXEL_FORMAT_BGRA32 },
+		                        { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBA32 },
+		                        { PIXEL_FORMAT_RGB16, PIXEL_FORMAT_BGRX32 },
+		                        { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB16 } };
+#if defined(TEST_ALL_FLAGS)
+	const BOOL allFormats = TRUE;
+#else
+	const BOOL allFormats = g_TestPrimitivesPerformance;
 #endif
-	};
+	const size_t formatCount = allFormats ? ARRAYSIZE(formats) : 3;
 
 	int rc = 0;
 	for (size_t z = 0; z < ARRAYSIZE(flags); z++)
 	{
 		const UINT32 flag = flags[z];
-		for (size_t x = 0; x < ARRAYSIZE(formats); x++)
+		for (size_t x = 0; x < formatCount; x++)
 		{
 			const UINT32 sformat = formats[x];
-			for (size_t y = 0; y < ARRAYSIZE(formats); y++)
+			for (size_t y = 0; y < formatCount; y++)
 			{
 				const UINT32 dformat = formats[y];
 
+				/* copy_no_overlap ignores FREERDP_FLIP_HORIZONTAL, so only repeat the formats
+				 * with dedicated FREERDP_KEEP_DST_ALPHA kernels for those flags */
+				if (((flag & FREERDP_FLIP_HORIZONTAL) != 0) && ((x >= 3) || (y >= 3)))
+					continue;
+
 				if (!test_copy_no_overlap(verbose, sformat, dformat, flag, 21, 17))
 					rc = -1;
 			}
 		}
+
+		if (allFormats || ((flag & FREERDP_FLIP_HORIZONTAL) != 0))
+			continue;
+
+		for (size_t x = 0; x < ARRAYSIZE(pairs); x++)
+		{
+			if (!test_copy_no_overlap(verbose, pairs[x][0], pairs[x][1], flag, 21, 17))
+				rc = -1;
+		}
 	}
 
 	if (verbose)
@@ -1404,6 +1404,103 @@ fail:
 	return rc;
 }
 
+static BOOL compare_planes(const char* what, BYTE* const planes1[3], BYTE* const planes2[3],
+                           const size_t sizes[3])
+{
+	for (size_t x = 0; x < 3; x++)
+	{
+		if (memcmp(planes1[x], planes2[x], sizes[x]) != 0)
+		{
+			(void)fprintf(stderr, "[%s] %s plane %" PRIuz " mismatch\n", __func__, what, x);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* Check the camera format conversions (YUY2, NV12, I420) of generic and the optimized routines
+ * match, the source lines are padded to catch stride mistakes.
+ */
+static BOOL compare_yuy2_to_yuv420(prim_size_t roi, DWORD type)
+{
+	BOOL rc = FALSE;
+	const UINT32 cw = (roi.width + 1) / 2;
+	const UINT32 ch = (roi.height + 1) / 2;
+	const UINT32 srcStep = 4 * cw + 12;
+	const UINT32 i420Step[3] = { roi.width, cw, cw };
+	const UINT32 nv12Step[3] = { roi.width, 2 * cw, 0 };
+	const size_t i420Size[3] = { 1ull * roi.width * roi.height, 1ull * cw * ch, 1ull * cw * ch };
+	const size_t nv12Size[3] = { 1ull * roi.width * roi.height, 2ull * cw * ch, 0 };
+	BYTE* i420[2][3] = { 0 };
+	BYTE* nv12[2][3] = { 0 };
+
+	primitives_t* prims = primitives_get_by_type(type);
+	if (!prims)
+	{
+		printf("primitives type %" PRIu32 " not supported, skipping\n", type);
+		return TRUE;
+	}
+
+	primitives_t* soft = primitives_get_by_type(PRIMITIVES_PURE_SOFT);
+	BYTE* yuy2 = calloc(roi.height, srcStep);
+	if (!soft || !yuy2)
+		goto fail;
+	winpr_RAND(yuy2, 1ull * roi.height * srcStep);
+
+	for (size_t x = 0; x < 2; x++)
+	{
+		for (size_t y = 0; y < 3; y++)
+		{
+			i420[x][y] = calloc(1, i420Size[y]);
+			nv12[x][y] = calloc(1, nv12Size[y] + 1);
+			if (!i420[x][y] || !nv12[x][y])
+				goto fail;
+		}
+	}
+
+	if ((soft->YUY2ToYUV420_8u_C2P3R(yuy2, srcStep, i420[0], i420Step, &roi) !=
+	     PRIMITIVES_SUCCESS) ||
+	    (prims->YUY2ToYUV420_8u_C2P3R(yuy2, srcStep, i420[1], i420Step, &roi) !=
+	     PRIMITIVES_SUCCESS))
+		goto fail;
+	if (!compare_planes("YUY2ToYUV420", i420[0], i420[1], i420Size))
+		goto fail;
+
+	if ((soft->YUY2ToNV12_8u_C2P2R(yuy2, srcStep, nv12[0], nv12Step, &roi) !=
+	     PRIMITIVES_SUCCESS) ||
+	    (prims->YUY2ToNV12_8u_C2P2R(yuy2, srcStep, nv12[1], nv12Step, &roi) !=
+	     PRIMITIVES_SUCCESS))
+		goto fail;
+	if (!compare_planes("YUY2ToNV12", nv12[0], nv12[1], nv12Size))
+		goto fail;
+
+	/* both layouts carry the same samples */
+	if ((prims->NV12ToYUV420_8u_P2P3R((const BYTE**)nv12[1], nv12Step, i420[1], i420Step,
+	                                  &roi) != PRIMITIVES_SUCCESS) ||
+	    !compare_planes("NV12ToYUV420", i420[0], i420[1], i420Size))
+		goto fail;
+
+	memset(nv12[1][1], 0, nv12Size[1]);
+	if ((prims->YUV420ToNV12_8u_P3P2R((const BYTE**)i420[0], i420Step, nv12[1], nv12Step,
+	                                  &roi) != PRIMITIVES_SUCCESS) ||
+	    !compare_planes("YUV420ToNV12", nv12[0], nv12[1], nv12Size))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	printf("%s finished with %s\n", __func__, rc ? "SUCCESS" : "FAILURE");
+	for (size_t x = 0; x < 2; x++)
+	{
+		for (size_t y = 0; y < 3; y++)
+		{
+			free(i420[x][y]);
+			free(nv12[x][y]);
+		}
+	}
+	free(yuy2);
+	return rc;
+}
+
 int TestPrimitivesYUV(int argc, char* argv[])
 {
 	BOOL large = (argc > 1);
@@ -1450,6 +1547,11 @@ int TestPrimitivesYUV(int argc, char* argv[])
 			goto end;
 		if (!compare_rgb_to_yuv420(roi, type))
 			goto end;
+
+		/* odd sizes leave a remainder for the vector code */
+		const prim_size_t odd = { .width = (roi.width + 47) | 1, .height = roi.height | 1 };
+		if (!compare_yuy2_to_yuv420(roi, type) || !compare_yuy2_to_yuv420(odd, type))
+			goto end;
 	}
 
 	if (!run_tests(roi))
@@ -779,6 +779,7 @@ static DWORD WINAPI pf_client_thread_proc(pClientContext* pc)
 	DWORD nCount = 0;
 	DWORD status = 0;
 	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+	WINPR_WAIT_SET* waitSet = NULL;
 
 	WINPR_ASSERT(pc);
 
@@ -809,6 +810,25 @@ static DWORD WINAPI pf_client_thread_proc(pClientContext* pc)
 	}
 	handles[nCount++] = Queue_Event(pc->cached_server_channel_data);
 
+	/* the handles collected so far do not change, the transport handles may */
+	waitSet = CreateWaitSet();
+	if (!waitSet)
+	{
+		PROXY_LOG_ERR(TAG, pc, "CreateWaitSet failed!");
+		proxy_data_abort_connect(pdata);
+		goto end;
+	}
+
+	for (DWORD x = 0; x < nCount; x++)
+	{
+		if (!WaitSetAdd(waitSet, handles[x]))
+		{
+			PROXY_LOG_ERR(TAG, pc, "WaitSetAdd failed!");
+			proxy_data_abort_connect(pdata);
+			goto end;
+		}
+	}
+
 	while (!freerdp_shall_disconnect_context(instance->context))
 	{
 		UINT32 tmp = freerdp_get_event_handles(instance->context, &handles[nCount],
@@ -820,11 +840,17 @@ static DWORD WINAPI pf_client_thread_proc(pClientContext* pc)
 			break;
 		}
 
-		status = WaitForMultipleObjects(nCount + tmp, handles, FALSE, INFINITE);
+		if (!WaitSetAssign(waitSet, nCount, &handles[nCount], tmp))
+		{
+			PROXY_LOG_ERR(TAG, pc, "WaitSetAssign failed!");
+			break;
+		}
+
+		status = WaitSetWait(waitSet, INFINITE);
 
 		if (status == WAIT_FAILED)
 		{
-			WLog_ERR(TAG, "WaitForMultipleObjects failed with %" PRIu32 "", status);
+			WLog_ERR(TAG, "WaitSetWait failed with %" PRIu32 "", status);
 			break;
 		}
 
@@ -851,6 +877,7 @@ static DWORD WINAPI pf_client_thread_proc(pClientContext* pc)
 	freerdp_disconnect(instance);
 
 end:
+	CloseWaitSet(waitSet);
 	pf_modules_run_hook(pdata->module, HOOK_TYPE_CLIENT_UNINIT_CONNECT, pdata, pc);
 
 	return 0;
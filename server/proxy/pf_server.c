@@ -24,10 +24,12 @@
 #include <freerdp/config.h>
 
 #include <winpr/crt.h>
+#include <winpr/file.h>
 #include <winpr/ssl.h>
 #include <winpr/path.h>
 #include <winpr/synch.h>
 #include <winpr/string.h>
+#include <winpr/sysinfo.h>
 #include <winpr/winsock.h>
 #include <winpr/thread.h>
 #include <errno.h>
@@ -57,6 +59,9 @@
 
 #define TAG PROXY_TAG("server")
 
+/* minimum interval between checks for changed certificate or key files */
+#define PF_SERVER_CREDENTIALS_CHECK_INTERVAL_MS 1000
+
 typedef struct
 {
 	HANDLE thread;
@@ -461,6 +466,163 @@ original_cb:
 	                                                   totalSize);
 }
 
+static BOOL pf_server_get_file_time(const char* path, FILETIME* ft)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data = { 0 };
+
+	WINPR_ASSERT(ft);
+
+	if (!path || !GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+		return FALSE;
+
+	*ft = data.ftLastWriteTime;
+	return TRUE;
+}
+
+static BOOL pf_server_file_changed(const char* path, const FILETIME* last, FILETIME* current)
+{
+	WINPR_ASSERT(last);
+	WINPR_ASSERT(current);
+
+	if (!pf_server_get_file_time(path, current))
+		return FALSE;
+	return (last->dwLowDateTime != current->dwLowDateTime) ||
+	       (last->dwHighDateTime != current->dwHighDateTime);
+}
+
+/* the listener builds the TLS server context all peers share from these */
+static BOOL pf_server_set_tls_credentials(proxyServer* server, const rdpPrivateKey* key,
+                                          const rdpCertificate* cert)
+{
+	WINPR_ASSERT(server);
+
+	BOOL rc = FALSE;
+	rdpSettings* settings = freerdp_settings_new(FREERDP_SETTINGS_SERVER_MODE);
+	if (!settings)
+		return FALSE;
+
+	rdpPrivateKey* ckey = freerdp_key_clone(key);
+	if (!ckey || !freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerRsaKey, ckey, 1))
+		goto fail;
+
+	rdpCertificate* ccert = freerdp_certificate_clone(cert);
+	if (!ccert ||
+	    !freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerCertificate, ccert, 1))
+		goto fail;
+
+	rc = freerdp_listener_set_tls_settings(server->listener, settings);
+fail:
+	freerdp_settings_free(settings);
+	return rc;
+}
+
+/* must be called with server->credentialsLock held */
+static BOOL pf_server_load_credentials(proxyServer* server, BOOL fromFiles)
+{
+	WINPR_ASSERT(server);
+
+	const proxyConfig* config = server->config;
+	WINPR_ASSERT(config);
+
+	/* inline content has precedence over files, see pf_config_load_certificates */
+	const BOOL keyFromFile = fromFiles && !config->PrivateKeyContent && config->PrivateKeyFile;
+	const BOOL certFromFile = fromFiles && !config->CertificateContent && config->CertificateFile;
+
+	rdpPrivateKey* key = keyFromFile ? freerdp_key_new_from_file_enc(config->PrivateKeyFile, NULL)
+	                                 : freerdp_key_new_from_pem_enc(config->PrivateKeyPEM, NULL);
+	rdpCertificate* cert = certFromFile ? freerdp_certificate_new_from_file(config->CertificateFile)
+	                                    : freerdp_certificate_new_from_pem(config->CertificatePEM);
+
+	if (!key || !cert)
+		goto fail;
+
+	/* files might be updated one after the other, only switch to a matching pair */
+	if (!freerdp_certificate_is_key_match(cert, key))
+	{
+		WLog_WARN(TAG, "certificate and private key do not match");
+		goto fail;
+	}
+
+	if (!pf_server_set_tls_credentials(server, key, cert))
+	{
+		WLog_WARN(TAG, "failed to set up the TLS server context");
+		goto fail;
+	}
+
+	freerdp_key_free(server->key);
+	freerdp_certificate_free(server->cert);
+	server->key = key;
+	server->cert = cert;
+	return TRUE;
+
+fail:
+	freerdp_key_free(key);
+	freerdp_certificate_free(cert);
+	return FALSE;
+}
+
+/* must be called with server->credentialsLock held */
+static void pf_server_check_credentials(proxyServer* server)
+{
+	WINPR_ASSERT(server);
+
+	const UINT64 now = GetTickCount64();
+	if (now - server->credentialsChecked < PF_SERVER_CREDENTIALS_CHECK_INTERVAL_MS)
+		return;
+	server->credentialsChecked = now;
+
+	const proxyConfig* config = server->config;
+	FILETIME keyTime = server->keyFileTime;
+	FILETIME certTime = server->certFileTime;
+	BOOL changed = FALSE;
+
+	if (!config->PrivateKeyContent)
+		changed |= pf_server_file_changed(config->PrivateKeyFile, &server->keyFileTime, &keyTime);
+	if (!config->CertificateContent)
+		changed |=
+		    pf_server_file_changed(config->CertificateFile, &server->certFileTime, &certTime);
+
+	if (!changed)
+		return;
+
+	if (!pf_server_load_credentials(server, TRUE))
+	{
+		WLog_WARN(TAG, "failed to reload TLS credentials, keeping the current ones");
+		return;
+	}
+
+	WLog_INFO(TAG, "reloaded TLS credentials");
+	server->keyFileTime = keyTime;
+	server->certFileTime = certTime;
+}
+
+/* returns copies of the current TLS credentials, sharing the underlying key, and attaches
+ * the TLS server context built from the same credentials to the peer */
+static BOOL pf_server_get_credentials(proxyServer* server, freerdp_peer* peer,
+                                      rdpPrivateKey** pkey, rdpCertificate** pcert)
+{
+	WINPR_ASSERT(server);
+	WINPR_ASSERT(pkey);
+	WINPR_ASSERT(pcert);
+
+	EnterCriticalSection(&server->credentialsLock);
+	pf_server_check_credentials(server);
+	*pkey = freerdp_key_clone(server->key);
+	*pcert = freerdp_certificate_clone(server->cert);
+	const BOOL attached = freerdp_listener_attach_tls(server->listener, peer);
+	LeaveCriticalSection(&server->credentialsLock);
+
+	if (!attached || !*pkey || !*pcert)
+	{
+		freerdp_key_free(*pkey);
+		freerdp_certificate_free(*pcert);
+		*pkey = NULL;
+		*pcert = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static BOOL pf_server_initialize_peer_connection(freerdp_peer* peer)
 {
 	WINPR_ASSERT(peer);
@@ -482,16 +644,16 @@ static BOOL pf_server_initialize_peer_connection(freerdp_peer* peer)
 	pdata->module = server->module;
 	const proxyConfig* config = pdata->config = server->config;
 
-	rdpPrivateKey* key = freerdp_key_new_from_pem_enc(config->PrivateKeyPEM, NULL);
-	if (!key)
+	rdpPrivateKey* key = NULL;
+	rdpCertificate* cert = NULL;
+	if (!pf_server_get_credentials(server, peer, &key, &cert))
 		return FALSE;
 
 	if (!freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerRsaKey, key, 1))
+	{
+		freerdp_certificate_free(cert);
 		return FALSE;
-
-	rdpCertificate* cert = freerdp_certificate_new_from_pem(config->CertificatePEM);
-	if (!cert)
-		return FALSE;
+	}
 
 	if (!freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerCertificate, cert, 1))
 		return FALSE;
@@ -574,7 +736,9 @@ static BOOL pf_server_initialize_peer_connection(freerdp_peer* peer)
  */
 static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 {
-	HANDLE eventHandles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+	HANDLE eventHandles[MAXIMUM_WAIT_OBJECTS - 3] = { 0 };
+	HANDLE ChannelEvent = NULL;
+	WINPR_WAIT_SET* waitSet = NULL;
 	pServerContext* ps = NULL;
 	proxyData* pdata = NULL;
 	peer_thread_args* args = arg;
@@ -617,38 +781,45 @@ static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 	if (!pf_modules_run_hook(pdata->module, HOOK_TYPE_SERVER_SESSION_STARTED, pdata, client))
 		goto out_free_peer;
 
-	while (1)
+	/* Main client event handling loop */
+	ChannelEvent = WTSVirtualChannelManagerGetEventHandle(ps->vcm);
+
+	WINPR_ASSERT(ChannelEvent && (ChannelEvent != INVALID_HANDLE_VALUE));
+	WINPR_ASSERT(pdata->abort_event && (pdata->abort_event != INVALID_HANDLE_VALUE));
+
+	/* these do not change during the session, only the transport handles may */
+	waitSet = CreateWaitSet();
+	if (!waitSet || !WaitSetAdd(waitSet, ChannelEvent) ||
+	    !WaitSetAdd(waitSet, pdata->abort_event) || !WaitSetAdd(waitSet, server->stopEvent))
 	{
-		HANDLE ChannelEvent = INVALID_HANDLE_VALUE;
-		DWORD eventCount = 0;
-		{
-			WINPR_ASSERT(client->GetEventHandles);
-			const DWORD tmp = client->GetEventHandles(client, &eventHandles[eventCount],
-			                                          ARRAYSIZE(eventHandles) - eventCount);
+		PROXY_LOG_ERR(TAG, ps, "failed to create the wait set");
+		goto fail;
+	}
 
-			if (tmp == 0)
-			{
-				PROXY_LOG_ERR(TAG, ps, "Failed to get FreeRDP transport event handles");
-				break;
-			}
+	while (1)
+	{
+		WINPR_ASSERT(client->GetEventHandles);
+		const DWORD eventCount =
+		    client->GetEventHandles(client, eventHandles, ARRAYSIZE(eventHandles));
 
-			eventCount += tmp;
+		if (eventCount == 0)
+		{
+			PROXY_LOG_ERR(TAG, ps, "Failed to get FreeRDP transport event handles");
+			break;
 		}
-		/* Main client event handling loop */
-		ChannelEvent = WTSVirtualChannelManagerGetEventHandle(ps->vcm);
 
-		WINPR_ASSERT(ChannelEvent && (ChannelEvent != INVALID_HANDLE_VALUE));
-		WINPR_ASSERT(pdata->abort_event && (pdata->abort_event != INVALID_HANDLE_VALUE));
-		eventHandles[eventCount++] = ChannelEvent;
-		eventHandles[eventCount++] = pdata->abort_event;
-		eventHandles[eventCount++] = server->stopEvent;
+		if (!WaitSetAssign(waitSet, 3, eventHandles, eventCount))
+		{
+			PROXY_LOG_ERR(TAG, ps, "WaitSetAssign failed");
+			break;
+		}
 
-		const DWORD status = WaitForMultipleObjects(
-		    eventCount, eventHandles, FALSE, 1000); /* Do periodic polling to avoid client hang */
+		/* Do periodic polling to avoid client hang */
+		const DWORD status = WaitSetWait(waitSet, 1000);
 
 		if (status == WAIT_FAILED)
 		{
-			PROXY_LOG_ERR(TAG, ps, "WaitForMultipleObjects failed (status: %" PRIu32 ")", status);
+			PROXY_LOG_ERR(TAG, ps, "WaitSetWait failed (status: %" PRIu32 ")", status);
 			break;
 		}
 
@@ -707,6 +878,7 @@ static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 	}
 
 fail:
+	CloseWaitSet(waitSet);
 
 	PROXY_LOG_INFO(TAG, ps, "starting shutdown of connection");
 	PROXY_LOG_INFO(TAG, ps, "stopping proxy's client");
@@ -943,9 +1115,31 @@ proxyServer* pf_server_new(const proxyConfig* config)
 	if (!server)
 		return NULL;
 
+	if (!InitializeCriticalSectionAndSpinCount(&server->credentialsLock, 4000))
+	{
+		free(server);
+		return NULL;
+	}
+
 	if (!pf_config_clone(&server->config, config))
 		goto out;
 
+	server->listener = freerdp_listener_new();
+	if (!server->listener)
+		goto out;
+
+	/* parse the TLS credentials once, peers get copies sharing the key.
+	 * Missing file times (inline content) just disable the reload check. */
+	(void)pf_server_get_file_time(server->config->PrivateKeyFile, &server->keyFileTime);
+	(void)pf_server_get_file_time(server->config->CertificateFile, &server->certFileTime);
+	server->credentialsChecked = GetTickCount64();
+
+	if (!pf_server_load_credentials(server, FALSE))
+	{
+		WLog_ERR(TAG, "failed to load TLS credentials!");
+		goto out;
+	}
+
 	server->module = pf_modules_new(FREERDP_PROXY_PLUGINDIR, pf_config_modules(server->config),
 	                                pf_config_modules_count(server->config));
 	if (!server->module)
@@ -962,10 +1156,6 @@ proxyServer* pf_server_new(const proxyConfig* config)
 	if (!server->stopEvent)
 		goto out;
 
-	server->listener = freerdp_listener_new();
-	if (!server->listener)
-		goto out;
-
 	server->peer_list = ArrayList_New(FALSE);
 	if (!server->peer_list)
 		goto out;
@@ -1085,6 +1275,9 @@ void pf_server_free(proxyServer* server)
 
 	pf_server_config_free(server->config);
 	pf_modules_free(server->module);
+	freerdp_key_free(server->key);
+	freerdp_certificate_free(server->cert);
+	DeleteCriticalSection(&server->credentialsLock);
 	free(server);
 
 #if defined(WITH_DEBUG_EVENTS)
@@ -25,7 +25,10 @@
 #define INT_FREERDP_SERVER_PROXY_SERVER_H
 
 #include <winpr/collections.h>
+#include <winpr/synch.h>
 #include <freerdp/listener.h>
+#include <freerdp/crypto/certificate.h>
+#include <freerdp/crypto/privatekey.h>
 
 #include <freerdp/server/proxy/proxy_config.h>
 #include "proxy_modules.h"
@@ -38,6 +41,14 @@ struct proxy_server
 	freerdp_listener* listener;
 	HANDLE stopEvent; /* an event used to signal the main thread to stop */
 	wArrayList* peer_list;
+
+	/* TLS credentials shared by all peers, reloaded when the files change */
+	CRITICAL_SECTION credentialsLock;
+	rdpPrivateKey* key;
+	rdpCertificate* cert;
+	FILETIME keyFileTime;
+	FILETIME certFileTime;
+	UINT64 credentialsChecked;
 };
 
 #endif /* INT_FREERDP_SERVER_PROXY_SERVER_H */
@@ -2288,6 +2288,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	rdpShadowServer* server = NULL;
 	rdpShadowSubsystem* subsystem = NULL;
 	wMessageQueue* MsgQueue = NULL;
+	WINPR_WAIT_SET* waitSet = NULL;
 	/* This should only be visited in client thread */
 	SHADOW_GFX_STATUS gfxstatus = { 0 };
 	rdpUpdate* update = NULL;
@@ -2347,13 +2348,19 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	WINPR_ASSERT(rc);
 	rc = freerdp_settings_set_bool(settings, FreeRDP_SupportMonitorLayoutPdu, TRUE);
 	WINPR_ASSERT(rc);
+
+	/* these do not change during the session, the transport and gfx handles may */
+	waitSet = CreateWaitSet();
+	if (!waitSet || !WaitSetAdd(waitSet, UpdateEvent) || !WaitSetAdd(waitSet, ChannelEvent) ||
+	    !WaitSetAdd(waitSet, MessageQueue_Event(MsgQueue)))
+		goto fail;
+
 	while (1)
 	{
-		HANDLE events[MAXIMUM_WAIT_OBJECTS] = { 0 };
+		HANDLE events[MAXIMUM_WAIT_OBJECTS - 3] = { 0 };
 		DWORD nCount = 0;
-		events[nCount++] = UpdateEvent;
 		{
-			DWORD tmp = peer->GetEventHandles(peer, &events[nCount], 64 - nCount);
+			DWORD tmp = peer->GetEventHandles(peer, events, ARRAYSIZE(events) - 1);
 
 			if (tmp == 0)
 			{
@@ -2363,8 +2370,6 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 
 			nCount += tmp;
 		}
-		events[nCount++] = ChannelEvent;
-		events[nCount++] = MessageQueue_Event(MsgQueue);
 
 #if defined(CHANNEL_RDPGFX_SERVER)
 		HANDLE gfxevent = rdpgfx_server_get_event_handle(client->rdpgfx);
@@ -2373,7 +2378,10 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 			events[nCount++] = gfxevent;
 #endif
 
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+		if (!WaitSetAssign(waitSet, 3, events, nCount))
+			goto fail;
+
+		status = WaitSetWait(waitSet, INFINITE);
 
 		if (status == WAIT_FAILED)
 			goto fail;
@@ -2586,6 +2594,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	}
 
 fail:
+	CloseWaitSet(waitSet);
 
 	/* Free channels early because we establish channels in post connect */
 #if defined(CHANNEL_AUDIN_SERVER)
@@ -743,6 +743,13 @@ int shadow_server_start(rdpShadowServer* server)
 		return -1;
 	}
 
+	/* all clients are set up from server->settings, share one TLS context between them */
+	if (!freerdp_listener_set_tls_settings(server->listener, server->settings))
+	{
+		WLog_ERR(TAG, "failed to set up the TLS server context");
+		return -1;
+	}
+
 	/* Bind magic:
 	 *
 	 * empty                 ... bind TCP all
@@ -765,6 +765,46 @@ extern "C"
 	                                 void* lParam);
 	WINPR_API BOOL MessageQueue_PostQuit(wMessageQueue* queue, int nExitCode);
 
+	/** @brief Result of a \b MESSAGE_QUEUE_COALESCE_FN call
+	 *  @since version 3.23.0
+	 */
+	typedef enum
+	{
+		WMQ_COALESCE_STOP,     /**< stop looking at older messages and post the new one */
+		WMQ_COALESCE_CONTINUE, /**< look at the next older message */
+		WMQ_COALESCE_MERGED    /**< the new message was merged, do not post it */
+	} wMessageQueueCoalesce;
+
+	/** @brief Callback for \b MessageQueue_Coalesce
+	 *
+	 *  @param queued A message waiting in the queue. It may be modified in place, resources it
+	 *  no longer references must be released.
+	 *  @param message The message to be posted. When returning \b WMQ_COALESCE_MERGED the
+	 *  callback takes over its resources, moving them to \b queued or releasing them.
+	 *  @param arg The argument passed to \b MessageQueue_Coalesce
+	 *  @since version 3.23.0
+	 */
+	typedef wMessageQueueCoalesce (*MESSAGE_QUEUE_COALESCE_FN)(wMessage* queued,
+	                                                           const wMessage* message, void* arg);
+
+	/** @brief Post a message, allowing it to be merged with messages still waiting in the queue
+	 *
+	 *  With the queue locked \b fn is called for the queued messages, newest first, until it
+	 *  returns something other than \b WMQ_COALESCE_CONTINUE. Messages already retrieved by
+	 *  the consumer are never passed to \b fn.
+	 *
+	 *  @param queue The queue to post to
+	 *  @param message The message to post
+	 *  @param fn The callback deciding if and how to merge \b message
+	 *  @param arg An argument passed on to \b fn
+	 *  @return \b -1 on failure, \b 0 if \b message was posted and \b 1 if it was merged.
+	 *  On failure the resources of \b message still belong to the caller, otherwise they were
+	 *  handed to the queue or to \b fn.
+	 *  @since version 3.23.0
+	 */
+	WINPR_API int MessageQueue_Coalesce(wMessageQueue* queue, const wMessage* message,
+	                                    MESSAGE_QUEUE_COALESCE_FN fn, void* arg);
+
 	WINPR_API int MessageQueue_Get(wMessageQueue* queue, wMessage* message);
 	WINPR_API int MessageQueue_Peek(wMessageQueue* queue, wMessage* message, BOOL remove);
 
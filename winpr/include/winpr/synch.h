@@ -482,6 +482,55 @@ extern "C"
 
 	WINPR_API void* GetEventWaitObject(HANDLE hEvent);
 
+	/** @brief A set of handles that is registered once and then waited for repeatedly.
+	 *
+	 *  WaitForMultipleObjects looks up and polls the file descriptor of every handle on each
+	 *  call, a wait set does that when a handle is added. With epoll a wait costs
+	 *  O(signalled handles), elsewhere the set falls back to WaitForMultipleObjects.
+	 *
+	 *  Event loops add the handles they always wait for once with WaitSetAdd and pass the
+	 *  ones that change between waits to WaitSetAssign. A handle must be removed before it is
+	 *  closed or its file descriptor changes, WaitSetAssign detects both for the handles
+	 *  passed to it. Alertable waits are not supported and a set must only be used by one
+	 *  thread at a time.
+	 *
+	 *  @since version 3.23.0
+	 */
+	typedef struct s_winpr_wait_set WINPR_WAIT_SET;
+
+	/** @since version 3.23.0 */
+	WINPR_API void CloseWaitSet(WINPR_WAIT_SET* set);
+
+	/** @since version 3.23.0 */
+	WINPR_ATTR_MALLOC(CloseWaitSet, 1)
+	WINPR_ATTR_NODISCARD
+	WINPR_API WINPR_WAIT_SET* CreateWaitSet(void);
+
+	/** @brief appends handle to the set, at most MAXIMUM_WAIT_OBJECTS are supported
+	 *  @since version 3.23.0 */
+	WINPR_API BOOL WaitSetAdd(WINPR_WAIT_SET* set, HANDLE handle);
+
+	/** @brief removes handle from the set, the handles following it move down one index
+	 *  @since version 3.23.0 */
+	WINPR_API BOOL WaitSetRemove(WINPR_WAIT_SET* set, HANDLE handle);
+
+	/** @brief replaces the handles from index first on with exactly count handles, in that
+	 *  order. The first handles of the set are kept.
+	 *
+	 *  Only handles that differ from the previous contents (or were closed and recreated at
+	 *  the same address, or got a new file descriptor) are registered again, so an event loop
+	 *  can call this with the handles it collected before every wait.
+	 *
+	 *  @since version 3.23.0 */
+	WINPR_API BOOL WaitSetAssign(WINPR_WAIT_SET* set, DWORD first, const HANDLE* handles,
+	                             DWORD count);
+
+	/** @brief waits for any handle of the set, like WaitForMultipleObjects with bWaitAll FALSE.
+	 *
+	 *  @return WAIT_OBJECT_0 + index of the first signalled handle, WAIT_TIMEOUT or WAIT_FAILED
+	 *  @since version 3.23.0 */
+	WINPR_API DWORD WaitSetWait(WINPR_WAIT_SET* set, DWORD dwMilliseconds);
+
 #ifdef __cplusplus
 }
 #endif
@@ -70,6 +70,17 @@ extern "C"
 #define WLOG_APPENDER_JOURNALD 5
 #define WLOG_APPENDER_UDP 6
 
+/** @defgroup LogAsyncModes Asynchronous logging modes
+ *  @since version 3.23.0
+ *  @{
+ */
+#define WLOG_ASYNC_OFF 0   /**< messages are written by the logging thread */
+#define WLOG_ASYNC_DROP 1  /**< messages are queued, dropped if the queue of the thread is full */
+#define WLOG_ASYNC_BLOCK 2 /**< messages are queued, the thread waits if its queue is full */
+/**
+ * @}
+ */
+
 	typedef struct
 	{
 		DWORD Type;
@@ -193,6 +204,50 @@ extern "C"
 	 */
 	WINPR_API BOOL WLog_SetContext(wLog* log, const char* (*fkt)(void*), void* context);
 
+	/** @brief Counters of the asynchronous logging mode since the process started */
+	typedef struct
+	{
+		UINT64 queued;  /**< messages queued by the logging threads */
+		UINT64 written; /**< queued messages handed to the appenders */
+		UINT64 dropped; /**< messages dropped with @ref WLOG_ASYNC_DROP */
+		UINT64 blocked; /**< messages that waited for queue space with @ref WLOG_ASYNC_BLOCK */
+	} wLogAsyncStats;
+
+	/** @brief Switch between synchronous and asynchronous logging.
+	 *
+	 *  In asynchronous mode text messages are formatted by the logging thread and queued,
+	 *  data and packet messages are copied and formatted later. A background thread hands
+	 *  the queued messages to the appenders. The mode can also be selected with the
+	 *  \b WLOG_ASYNC environment variable (\b OFF, \b DROP or \b BLOCK).
+	 *
+	 *  @param mode One of \ref LogAsyncModes
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise.
+	 *  @since version 3.23.0
+	 */
+	WINPR_API BOOL WLog_SetAsyncMode(DWORD mode);
+
+	/** @brief Get the current mode, one of \ref LogAsyncModes
+	 *  @since version 3.23.0
+	 */
+	WINPR_API DWORD WLog_GetAsyncMode(void);
+
+	/** @brief Wait until every message queued before the call was handed to the appenders.
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise.
+	 *  @since version 3.23.0
+	 */
+	WINPR_API BOOL WLog_Flush(void);
+
+	/** @brief Get the counters of the asynchronous logging mode.
+	 *
+	 *  @param stats The counters are written here. Must not be \b NULL
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise.
+	 *  @since version 3.23.0
+	 */
+	WINPR_API BOOL WLog_GetAsyncStats(wLogAsyncStats* stats);
+
 #define WLog_Print_unchecked(_log, _log_level, ...)                                         \
 	do                                                                                      \
 	{                                                                                       \
@@ -37,9 +37,17 @@
 #endif
 
 #include <winpr/assert.h>
+#include <winpr/interlocked.h>
 
 #include "../handle/handle.h"
 
+static LONG volatile generation = 0;
+
+UINT32 winpr_Handle_NextGeneration(void)
+{
+	return (UINT32)InterlockedIncrement(&generation);
+}
+
 BOOL CloseHandle(HANDLE hObject)
 {
 	ULONG Type = 0;
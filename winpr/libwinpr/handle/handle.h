@@ -111,6 +111,7 @@ typedef struct
 	ULONG Type;
 	ULONG Mode;
 	HANDLE_OPS* ops;
+	UINT32 Generation;
 } WINPR_HANDLE;
 
 static inline BOOL WINPR_HANDLE_IS_HANDLED(HANDLE handle, ULONG type, BOOL invalidValue)
@@ -133,12 +134,25 @@ static inline BOOL WINPR_HANDLE_IS_HANDLED(HANDLE handle, ULONG type, BOOL inval
 	return TRUE;
 }
 
+/* Every handle gets a new generation when it is created and whenever its file descriptor is
+ * replaced. Caches of handle file descriptors compare it to detect a handle address reused by
+ * a new handle or a handle that now waits on another descriptor. */
+UINT32 winpr_Handle_NextGeneration(void);
+
+static inline void winpr_Handle_FdChanged(void* _handle)
+{
+	WINPR_HANDLE* hdl = (WINPR_HANDLE*)_handle;
+
+	hdl->Generation = winpr_Handle_NextGeneration();
+}
+
 static inline void WINPR_HANDLE_SET_TYPE_AND_MODE(void* _handle, ULONG _type, ULONG _mode)
 {
 	WINPR_HANDLE* hdl = (WINPR_HANDLE*)_handle;
 
 	hdl->Type = _type;
 	hdl->Mode = _mode;
+	hdl->Generation = winpr_Handle_NextGeneration();
 }
 
 static inline BOOL winpr_Handle_GetInfo(HANDLE handle, ULONG* pType, WINPR_HANDLE** pObject)
@@ -769,6 +769,7 @@ BOOL ConnectNamedPipe(HANDLE hNamedPipe, LPOVERLAPPED lpOverlapped)
 
 		pNamedPipe->clientfd = status;
 		pNamedPipe->ServerMode = FALSE;
+		winpr_Handle_FdChanged(pNamedPipe);
 	}
 	else
 	{
@@ -798,6 +799,7 @@ BOOL DisconnectNamedPipe(HANDLE hNamedPipe)
 	{
 		close(pNamedPipe->clientfd);
 		pNamedPipe->clientfd = -1;
+		winpr_Handle_FdChanged(pNamedPipe);
 	}
 
 	return TRUE;
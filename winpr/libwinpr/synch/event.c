@@ -508,6 +508,7 @@ int SetEventFileDescriptor(HANDLE hEvent, int FileDescriptor, ULONG mode)
 	event->bAttached = TRUE;
 	event->common.Mode = mode;
 	event->impl.fds[0] = FileDescriptor;
+	winpr_Handle_FdChanged(event);
 	return 0;
 #else
 	return -1;
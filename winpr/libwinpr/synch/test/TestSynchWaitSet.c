@@ -0,0 +1,338 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#define TEST_HANDLES 48
+#define TEST_BENCH_WAITS 100000
+#define TEST_FIXED_HANDLES 40
+
+static BOOL test_wait_set_events(HANDLE* events)
+{
+	BOOL rc = FALSE;
+	WINPR_WAIT_SET* set = CreateWaitSet();
+
+	if (!set)
+		return FALSE;
+
+	if (!WaitSetAssign(set, 0, events, TEST_HANDLES))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_TIMEOUT)
+	{
+		printf("WaitSetWait signalled without a set event\n");
+		goto fail;
+	}
+
+	/* the lowest signalled index wins, like with WaitForMultipleObjects */
+	if (!SetEvent(events[30]) || !SetEvent(events[17]))
+		goto fail;
+
+	if (WaitSetWait(set, INFINITE) != WAIT_OBJECT_0 + 17)
+	{
+		printf("WaitSetWait did not return the lowest signalled index\n");
+		goto fail;
+	}
+
+	if (!ResetEvent(events[17]))
+		goto fail;
+
+	if (WaitSetWait(set, 100) != WAIT_OBJECT_0 + 30)
+	{
+		printf("WaitSetWait did not return the remaining signalled index\n");
+		goto fail;
+	}
+
+	/* the following handles move down one index */
+	if (!WaitSetRemove(set, events[3]) || WaitSetRemove(set, events[3]))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + 29)
+	{
+		printf("WaitSetWait index after WaitSetRemove mismatch\n");
+		goto fail;
+	}
+
+	if (!ResetEvent(events[30]) || !WaitSetAdd(set, events[3]) || !SetEvent(events[3]))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + TEST_HANDLES - 1)
+	{
+		printf("WaitSetWait index after WaitSetAdd mismatch\n");
+		goto fail;
+	}
+
+	if (!ResetEvent(events[3]))
+		goto fail;
+
+	/* reassigning in a different order moves the registrations */
+	{
+		HANDLE reversed[TEST_HANDLES] = { 0 };
+		for (size_t x = 0; x < TEST_HANDLES; x++)
+			reversed[x] = events[TEST_HANDLES - 1 - x];
+
+		if (!WaitSetAssign(set, 0, reversed, TEST_HANDLES) || !SetEvent(events[0]))
+			goto fail;
+
+		if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + TEST_HANDLES - 1)
+		{
+			printf("WaitSetWait index after WaitSetAssign mismatch\n");
+			goto fail;
+		}
+
+		if (!ResetEvent(events[0]))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	CloseWaitSet(set);
+	return rc;
+}
+
+static BOOL test_wait_set_shared_fd(void)
+{
+	BOOL rc = FALSE;
+	HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	HANDLE shared = NULL;
+	WINPR_WAIT_SET* set = CreateWaitSet();
+
+	if (!event || !set)
+		goto fail;
+
+	/* a second handle on the same descriptor */
+	shared = CreateFileDescriptorEvent(NULL, TRUE, FALSE, GetEventFileDescriptor(event),
+	                                   WINPR_FD_READ);
+	if (!shared)
+		goto fail;
+
+	if (!WaitSetAdd(set, shared) || !WaitSetAdd(set, event))
+		goto fail;
+
+	if (!SetEvent(event))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0)
+	{
+		printf("WaitSetWait with a shared descriptor mismatch\n");
+		goto fail;
+	}
+
+	/* the duplicate registration is gone with the handle, the original one stays */
+	if (!WaitSetRemove(set, shared))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0)
+	{
+		printf("WaitSetWait after removing the shared descriptor failed\n");
+		goto fail;
+	}
+
+	if (!ResetEvent(event) || (WaitSetWait(set, 0) != WAIT_TIMEOUT))
+	{
+		printf("WaitSetWait signalled a reset event\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	CloseWaitSet(set);
+	(void)CloseHandle(shared);
+	(void)CloseHandle(event);
+	return rc;
+}
+
+static BOOL test_wait_set_assign(HANDLE* events)
+{
+	BOOL rc = FALSE;
+	HANDLE recreated = NULL;
+	WINPR_WAIT_SET* set = CreateWaitSet();
+
+	if (!set)
+		return FALSE;
+
+	for (size_t x = 0; x < 4; x++)
+	{
+		if (!WaitSetAdd(set, events[x]))
+			goto fail;
+	}
+
+	/* only the handles after the fixed ones are replaced */
+	if (!WaitSetAssign(set, 4, &events[10], 2) || !SetEvent(events[11]))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + 5)
+	{
+		printf("WaitSetWait index after WaitSetAssign of the tail mismatch\n");
+		goto fail;
+	}
+
+	if (!WaitSetAssign(set, 4, &events[11], 1) || !SetEvent(events[2]))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + 2)
+	{
+		printf("WaitSetWait lost a fixed handle\n");
+		goto fail;
+	}
+
+	if (!ResetEvent(events[2]) || !ResetEvent(events[11]))
+		goto fail;
+
+	if (WaitSetAssign(set, 6, events, 1))
+	{
+		printf("WaitSetAssign accepted a gap\n");
+		goto fail;
+	}
+
+	/* a handle closed and created again, possibly at the same address */
+	recreated = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!recreated || !WaitSetAssign(set, 4, &recreated, 1))
+		goto fail;
+	(void)CloseHandle(recreated);
+	recreated = CreateEvent(NULL, TRUE, TRUE, NULL);
+	if (!recreated || !WaitSetAssign(set, 4, &recreated, 1))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + 4)
+	{
+		printf("WaitSetWait missed a recreated handle\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	CloseWaitSet(set);
+	(void)CloseHandle(recreated);
+	return rc;
+}
+
+static BOOL test_wait_set_fd_changed(HANDLE* events)
+{
+	BOOL rc = FALSE;
+	HANDLE handle = CreateFileDescriptorEvent(NULL, TRUE, FALSE,
+	                                          GetEventFileDescriptor(events[0]), WINPR_FD_READ);
+	WINPR_WAIT_SET* set = CreateWaitSet();
+
+	if (!handle || !set)
+		goto fail;
+
+	if (!WaitSetAssign(set, 0, &handle, 1))
+		goto fail;
+
+	/* same handle, another descriptor */
+	if (SetEventFileDescriptor(handle, GetEventFileDescriptor(events[1]), WINPR_FD_READ) != 0)
+		goto fail;
+	if (!WaitSetAssign(set, 0, &handle, 1) || !SetEvent(events[1]))
+		goto fail;
+
+	if (WaitSetWait(set, 0) != WAIT_OBJECT_0)
+	{
+		printf("WaitSetWait did not follow the new descriptor\n");
+		goto fail;
+	}
+
+	rc = ResetEvent(events[1]);
+fail:
+	CloseWaitSet(set);
+	(void)CloseHandle(handle);
+	return rc;
+}
+
+static BOOL test_wait_set_bench(HANDLE* events)
+{
+	WINPR_WAIT_SET* set = CreateWaitSet();
+
+	if (!set || !SetEvent(events[TEST_HANDLES - 1]))
+		goto fail;
+
+	UINT64 start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < TEST_BENCH_WAITS; x++)
+	{
+		if (WaitForMultipleObjects(TEST_HANDLES, events, FALSE, 0) !=
+		    WAIT_OBJECT_0 + TEST_HANDLES - 1)
+			goto fail;
+	}
+	const UINT64 multiple = winpr_GetTickCount64NS() - start;
+
+	/* an event loop adds its fixed handles once and collects the others before every wait */
+	for (size_t x = 0; x < TEST_FIXED_HANDLES; x++)
+	{
+		if (!WaitSetAdd(set, events[x]))
+			goto fail;
+	}
+
+	start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < TEST_BENCH_WAITS; x++)
+	{
+		if (!WaitSetAssign(set, TEST_FIXED_HANDLES, &events[TEST_FIXED_HANDLES],
+		                   TEST_HANDLES - TEST_FIXED_HANDLES))
+			goto fail;
+		if (WaitSetWait(set, 0) != WAIT_OBJECT_0 + TEST_HANDLES - 1)
+			goto fail;
+	}
+	const UINT64 waitset = winpr_GetTickCount64NS() - start;
+
+	printf("%d waits on %d handles: WaitForMultipleObjects %" PRIu64 "ms, wait set %" PRIu64
+	       "ms\n",
+	       TEST_BENCH_WAITS, TEST_HANDLES, multiple / 1000000ull, waitset / 1000000ull);
+
+	CloseWaitSet(set);
+	return ResetEvent(events[TEST_HANDLES - 1]);
+fail:
+	CloseWaitSet(set);
+	return FALSE;
+}
+
+int TestSynchWaitSet(int argc, char* argv[])
+{
+	int rc = -1;
+	HANDLE events[TEST_HANDLES] = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	for (size_t x = 0; x < TEST_HANDLES; x++)
+	{
+		events[x] = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (!events[x])
+			goto fail;
+	}
+
+	if (!test_wait_set_events(events))
+	{
+		printf("test_wait_set_events failed\n");
+		goto fail;
+	}
+
+	if (!test_wait_set_shared_fd())
+	{
+		printf("test_wait_set_shared_fd failed\n");
+		goto fail;
+	}
+
+	if (!test_wait_set_assign(events))
+	{
+		printf("test_wait_set_assign failed\n");
+		goto fail;
+	}
+
+	if (!test_wait_set_fd_changed(events))
+	{
+		printf("test_wait_set_fd_changed failed\n");
+		goto fail;
+	}
+
+	if (!test_wait_set_bench(events))
+	{
+		printf("test_wait_set_bench failed\n");
+		goto fail;
+	}
+
+	rc = 0;
+fail:
+	for (size_t x = 0; x < TEST_HANDLES; x++)
+		(void)CloseHandle(events[x]);
+	return rc;
+}
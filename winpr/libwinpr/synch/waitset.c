@@ -0,0 +1,370 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * Persistent Wait Sets
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include "../log.h"
+#define TAG WINPR_TAG("sync.waitset")
+
+#if !defined(_WIN32) && defined(WINPR_HAVE_SYS_EPOLL_H)
+#define WITH_WAIT_SET_EPOLL
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include <winpr/debug.h>
+
+#include "../handle/handle.h"
+
+typedef struct
+{
+	int handleFd; /* descriptor of the handle when it was registered */
+	int fd;       /* registered descriptor, a duplicate if handleFd was already registered */
+	UINT32 events;
+	UINT32 generation; /* generation of the handle when it was registered */
+} WINPR_WAIT_SET_ENTRY;
+#endif
+
+struct s_winpr_wait_set
+{
+	DWORD count;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+#if defined(WITH_WAIT_SET_EPOLL)
+	int epfd;
+	WINPR_WAIT_SET_ENTRY entries[MAXIMUM_WAIT_OBJECTS];
+#endif
+};
+
+#if defined(WITH_WAIT_SET_EPOLL)
+static BOOL waitset_register(WINPR_WAIT_SET* set, DWORD index, HANDLE handle)
+{
+	ULONG type = 0;
+	WINPR_HANDLE* object = NULL;
+
+	WINPR_ASSERT(set);
+	WINPR_ASSERT(index < MAXIMUM_WAIT_OBJECTS);
+
+	if (!winpr_Handle_GetInfo(handle, &type, &object))
+	{
+		WLog_ERR(TAG, "invalid handle at %" PRIu32, index);
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+
+	const int fd = winpr_Handle_getFd(object);
+	if (fd < 0)
+	{
+		WLog_ERR(TAG, "invalid file descriptor at %" PRIu32, index);
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+
+	struct epoll_event event = { 0 };
+	if (object->Mode & WINPR_FD_READ)
+		event.events |= EPOLLIN;
+	if (object->Mode & WINPR_FD_WRITE)
+		event.events |= EPOLLOUT;
+	event.data.u32 = index;
+
+	int registered = fd;
+	if (epoll_ctl(set->epfd, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+		/* epoll registers a descriptor once, a second handle on it gets a duplicate */
+		if (errno == EEXIST)
+		{
+			registered = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+			if ((registered >= 0) && (epoll_ctl(set->epfd, EPOLL_CTL_ADD, registered, &event) < 0))
+			{
+				close(registered);
+				registered = -1;
+			}
+		}
+		else
+			registered = -1;
+
+		if (registered < 0)
+		{
+			char ebuffer[256] = { 0 };
+			WLog_ERR(TAG, "epoll_ctl() failure at %" PRIu32 " [%d] %s", index, errno,
+			         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+			SetLastError(ERROR_INTERNAL_ERROR);
+			return FALSE;
+		}
+	}
+
+	WINPR_WAIT_SET_ENTRY* entry = &set->entries[index];
+	entry->handleFd = fd;
+	entry->fd = registered;
+	entry->events = event.events;
+	entry->generation = object->Generation;
+	set->handles[index] = handle;
+	return TRUE;
+}
+
+static void waitset_unregister(WINPR_WAIT_SET* set, DWORD index)
+{
+	WINPR_ASSERT(set);
+	WINPR_ASSERT(index < MAXIMUM_WAIT_OBJECTS);
+
+	WINPR_WAIT_SET_ENTRY* entry = &set->entries[index];
+
+	/* fails if the descriptor is already closed, epoll dropped it then */
+	(void)epoll_ctl(set->epfd, EPOLL_CTL_DEL, entry->fd, NULL);
+	if (entry->fd != entry->handleFd)
+		close(entry->fd);
+
+	entry->handleFd = -1;
+	entry->fd = -1;
+	set->handles[index] = NULL;
+}
+
+/* a closed handle whose address is reused or a handle with a new descriptor has a new
+ * generation, so the descriptor does not need to be looked up again */
+static BOOL waitset_changed(const WINPR_WAIT_SET* set, DWORD index, HANDLE handle)
+{
+	ULONG type = 0;
+	WINPR_HANDLE* object = NULL;
+
+	WINPR_ASSERT(set);
+
+	if (set->handles[index] != handle)
+		return TRUE;
+	if (!winpr_Handle_GetInfo(handle, &type, &object))
+		return TRUE;
+	return object->Generation != set->entries[index].generation;
+}
+#endif
+
+void CloseWaitSet(WINPR_WAIT_SET* set)
+{
+	if (!set)
+		return;
+
+#if defined(WITH_WAIT_SET_EPOLL)
+	for (DWORD index = 0; index < set->count; index++)
+		waitset_unregister(set, index);
+
+	if (set->epfd >= 0)
+		close(set->epfd);
+#endif
+	free(set);
+}
+
+WINPR_WAIT_SET* CreateWaitSet(void)
+{
+	WINPR_WAIT_SET* set = calloc(1, sizeof(WINPR_WAIT_SET));
+	if (!set)
+		return NULL;
+
+#if defined(WITH_WAIT_SET_EPOLL)
+	set->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->epfd < 0)
+	{
+		char ebuffer[256] = { 0 };
+		WLog_ERR(TAG, "epoll_create1() failure [%d] %s", errno,
+		         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+		free(set);
+		return NULL;
+	}
+#endif
+	return set;
+}
+
+BOOL WaitSetAdd(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	WINPR_ASSERT(set);
+
+	if (set->count >= MAXIMUM_WAIT_OBJECTS)
+	{
+		WLog_ERR(TAG, "wait set is full (%" PRIu32 " handles)", set->count);
+		return FALSE;
+	}
+
+#if defined(WITH_WAIT_SET_EPOLL)
+	if (!waitset_register(set, set->count, handle))
+		return FALSE;
+#else
+	set->handles[set->count] = handle;
+#endif
+	set->count++;
+	return TRUE;
+}
+
+BOOL WaitSetRemove(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	WINPR_ASSERT(set);
+
+	DWORD index = 0;
+	for (; index < set->count; index++)
+	{
+		if (set->handles[index] == handle)
+			break;
+	}
+
+	if (index >= set->count)
+		return FALSE;
+
+#if defined(WITH_WAIT_SET_EPOLL)
+	waitset_unregister(set, index);
+
+	/* the entries after it move down, their registrations carry the index */
+	for (DWORD x = index + 1; x < set->count; x++)
+	{
+		WINPR_WAIT_SET_ENTRY* entry = &set->entries[x];
+		struct epoll_event event = { 0 };
+		event.events = entry->events;
+		event.data.u32 = x - 1;
+
+		if (epoll_ctl(set->epfd, EPOLL_CTL_MOD, entry->fd, &event) < 0)
+		{
+			char ebuffer[256] = { 0 };
+			WLog_ERR(TAG, "epoll_ctl() failure at %" PRIu32 " [%d] %s", x, errno,
+			         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+		}
+
+		set->entries[x - 1] = *entry;
+		set->handles[x - 1] = set->handles[x];
+	}
+#else
+	for (DWORD x = index + 1; x < set->count; x++)
+		set->handles[x - 1] = set->handles[x];
+#endif
+
+	set->count--;
+	set->handles[set->count] = NULL;
+	return TRUE;
+}
+
+BOOL WaitSetAssign(WINPR_WAIT_SET* set, DWORD first, const HANDLE* handles, DWORD count)
+{
+	WINPR_ASSERT(set);
+	WINPR_ASSERT(handles || (count == 0));
+
+	if ((first > set->count) || (count > MAXIMUM_WAIT_OBJECTS - first))
+	{
+		WLog_ERR(TAG, "invalid handles range(%" PRIu32 ", %" PRIu32 ")", first, count);
+		return FALSE;
+	}
+
+#if defined(WITH_WAIT_SET_EPOLL)
+	/* drop the stale registrations first, a new handle may reuse the descriptor of one */
+	for (DWORD index = first; index < set->count; index++)
+	{
+		const DWORD x = index - first;
+		if ((x >= count) || waitset_changed(set, index, handles[x]))
+			waitset_unregister(set, index);
+	}
+
+	for (DWORD x = 0; x < count; x++)
+	{
+		const DWORD index = first + x;
+		if (set->handles[index])
+			continue;
+
+		if (!waitset_register(set, index, handles[x]))
+		{
+			for (DWORD y = first; y < first + count; y++)
+			{
+				if (set->handles[y])
+					waitset_unregister(set, y);
+			}
+			set->count = first;
+			return FALSE;
+		}
+	}
+#else
+	for (DWORD x = 0; x < count; x++)
+		set->handles[first + x] = handles[x];
+#endif
+
+	set->count = first + count;
+	return TRUE;
+}
+
+DWORD WaitSetWait(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	WINPR_ASSERT(set);
+
+	if (set->count == 0)
+	{
+		WLog_ERR(TAG, "invalid handles count(%" PRIu32 ")", set->count);
+		return WAIT_FAILED;
+	}
+
+#if defined(WITH_WAIT_SET_EPOLL)
+	const UINT64 dueTime = GetTickCount64() + dwMilliseconds;
+
+	for (;;)
+	{
+		struct epoll_event events[MAXIMUM_WAIT_OBJECTS] = { 0 };
+		int timeout = -1;
+
+		if (dwMilliseconds != INFINITE)
+		{
+			const UINT64 now = GetTickCount64();
+			const UINT64 remaining = (now < dueTime) ? dueTime - now : 0;
+			timeout = (remaining > INT32_MAX) ? INT32_MAX : (int)remaining;
+		}
+
+		const int status = epoll_wait(set->epfd, events, ARRAYSIZE(events), timeout);
+		if (status < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			char ebuffer[256] = { 0 };
+			WLog_ERR(TAG, "epoll_wait() failure [%d] %s", errno,
+			         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+			SetLastError(ERROR_INTERNAL_ERROR);
+			return WAIT_FAILED;
+		}
+
+		/* like WaitForMultipleObjects report the lowest signalled index */
+		DWORD signalled = set->count;
+		for (int x = 0; x < status; x++)
+		{
+			const DWORD index = events[x].data.u32;
+			if ((index < signalled) && (events[x].events & set->entries[index].events))
+				signalled = index;
+		}
+
+		if (signalled < set->count)
+		{
+			const DWORD rc = winpr_Handle_cleanup(set->handles[signalled]);
+			if (rc != WAIT_OBJECT_0)
+			{
+				WLog_ERR(TAG, "error in cleanup function for handle at index=%" PRIu32,
+				         signalled);
+				return rc;
+			}
+			return WAIT_OBJECT_0 + signalled;
+		}
+
+		if ((status == 0) || ((dwMilliseconds != INFINITE) && (GetTickCount64() >= dueTime)))
+			return WAIT_TIMEOUT;
+	}
+#else
+	return WaitForMultipleObjects(set->count, set->handles, FALSE, dwMilliseconds);
+#endif
+}
@@ -623,7 +623,7 @@ HANDLE CreateProcessHandle(pid_t pid)
 		return NULL;
 
 	process->pid = pid;
-	process->common.Type = HANDLE_TYPE_PROCESS;
+	WINPR_HANDLE_SET_TYPE_AND_MODE(process, HANDLE_TYPE_PROCESS, 0);
 	process->common.ops = &ops;
 	process->fd = pidfd_open(pid);
 	if (process->fd >= 0)
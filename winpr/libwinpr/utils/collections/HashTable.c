@@ -21,39 +21,65 @@
 
 #include <winpr/crt.h>
 #include <winpr/assert.h>
+#include <winpr/interlocked.h>
 
 #include <winpr/collections.h>
 
 /**
- * This implementation is based on the public domain
- * hash table implementation made by Keith Pomakis:
+ * Open addressing in the style of the SwissTable design:
  *
- * http://www.pomakis.com/hashtable/hashtable.c
- * http://www.pomakis.com/hashtable/hashtable.h
+ * The entries are stored inline in a power of two sized slot array. Every slot has a control
+ * byte, either HASHTABLE_EMPTY, HASHTABLE_DELETED or the low 7 bits of the hash of its entry.
+ * A lookup probes aligned groups of HASHTABLE_GROUP control bytes, matches all bytes of a group
+ * with a few integer operations and only compares the keys of the slots that matched.
+ *
+ * Synchronized tables with pointer keys are read without taking the lock, see
+ * HashTable_ReadUnlocked.
  */
 
-typedef struct s_wKeyValuePair wKeyValuePair;
+#define HASHTABLE_GROUP 8
+#define HASHTABLE_INITIAL_CAPACITY 64
+#define HASHTABLE_EMPTY 0x80
+#define HASHTABLE_DELETED 0xFE
+#define HASHTABLE_LSB 0x0101010101010101ull
+#define HASHTABLE_MSB 0x8080808080808080ull
+#define HASHTABLE_READ_RETRIES 4
 
-struct s_wKeyValuePair
+typedef struct
 {
 	void* key;
 	void* value;
-
-	wKeyValuePair* next;
+	UINT32 hash;
 	BOOL markedForRemove;
+} wHashTableSlot;
+
+typedef struct s_wHashTableArray wHashTableArray;
+
+struct s_wHashTableArray
+{
+	size_t capacity; /* a power of two, a multiple of HASHTABLE_GROUP */
+	BYTE* ctrl;
+	wHashTableSlot* slots;
+	wHashTableArray* retired;
 };
 
 struct s_wHashTable
 {
 	BOOL synchronized;
 	CRITICAL_SECTION lock;
+	LONG volatile sequence; /* odd while the table is modified */
+	DWORD writers;
 
-	size_t numOfBuckets;
+	wHashTableArray* array;
+	wHashTableArray* retired; /* replaced arrays, unlocked readers might still probe them */
 	size_t numOfElements;
-	float idealRatio;
-	float lowerRehashThreshold;
-	float upperRehashThreshold;
-	wKeyValuePair** bucketArray;
+	size_t occupied;   /* slots with an entry, including the ones marked for removal */
+	size_t tombstones; /* slots set to HASHTABLE_DELETED */
+
+	/* entries inserted by a HashTable_Foreach callback while the slot array was full */
+	wHashTableSlot* overflow;
+	size_t overflowCount;
+	size_t overflowSize;
 
 	HASH_TABLE_HASH_FN hash;
 	wObject key;
@@ -104,105 +130,495 @@ void HashTable_StringFree(void* str)
 	winpr_ObjectStringFree(str);
 }
 
-static inline BOOL HashTable_IsProbablePrime(size_t oddNumber)
+static inline UINT32 HashTable_Hash(wHashTable* table, const void* key)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(table->hash);
+
+	/* the murmur3 finalizer, spreads weak hashes like HashTable_PointerHash over all bits */
+	UINT32 hash = table->hash(key);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static inline BYTE HashTable_H2(UINT32 hash)
 {
-	for (size_t i = 3; i < 51; i += 2)
+	return (BYTE)(hash & 0x7F);
+}
+
+static inline size_t HashTable_MaxLoad(size_t capacity)
+{
+	return capacity - capacity / 8;
+}
+
+static inline UINT64 HashTable_LoadGroup(const wHashTableArray* array, size_t group)
+{
+	UINT64 ctrl = 0;
+	const BYTE* bytes = &array->ctrl[group * HASHTABLE_GROUP];
+
+	/* control byte x in bits 8x to 8x + 7, independent of the byte order */
+	for (size_t x = 0; x < HASHTABLE_GROUP; x++)
+		ctrl |= ((UINT64)bytes[x]) << (8 * x);
+	return ctrl;
+}
+
+static inline UINT64 HashTable_MatchHash(UINT64 ctrl, UINT32 hash)
+{
+	/* find the zero bytes of ctrl ^ h2. A byte following a match might be reported too, the
+	 * stored hash of the slot rules it out */
+	const UINT64 x = ctrl ^ (HASHTABLE_LSB * HashTable_H2(hash));
+	return (x - HASHTABLE_LSB) & ~x & HASHTABLE_MSB;
+}
+
+static inline UINT64 HashTable_MatchEmpty(UINT64 ctrl)
+{
+	/* HASHTABLE_EMPTY is the only control byte with the high bit set and bit 1 cleared */
+	return ctrl & ~(ctrl << 6) & HASHTABLE_MSB;
+}
+
+static inline UINT64 HashTable_MatchFree(UINT64 ctrl)
+{
+	return ctrl & HASHTABLE_MSB;
+}
+
+static inline size_t HashTable_FirstMatch(UINT64 match)
+{
+	WINPR_ASSERT(match);
+#if defined(__GNUC__) || defined(__clang__)
+	return (size_t)__builtin_ctzll(match) / 8;
+#else
+	size_t index = 0;
+	while ((match & 0xFF) == 0)
 	{
-		if (oddNumber == i)
-			return TRUE;
-		else if (oddNumber % i == 0)
-			return FALSE;
+		match >>= 8;
+		index++;
 	}
+	return index;
+#endif
+}
+
+static inline BOOL HashTable_Equals(wHashTable* table, const wHashTableSlot* slot, const void* key,
+                                    UINT32 hash)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(slot);
+	WINPR_ASSERT(key);
 
-	return TRUE; /* maybe */
+	if (slot->hash != hash)
+		return FALSE;
+	if (table->key.fnObjectEquals == HashTable_PointerCompare)
+		return slot->key == key;
+	return table->key.fnObjectEquals(key, slot->key);
 }
 
-static inline size_t HashTable_CalculateIdealNumOfBuckets(wHashTable* table)
+static inline wHashTableSlot* HashTable_FindSlot(wHashTable* table, const wHashTableArray* array,
+                                                 const void* key, UINT32 hash)
+{
+	const size_t groups = array->capacity / HASHTABLE_GROUP;
+	size_t group = (hash >> 7) & (groups - 1);
+
+	/* triangular probing, visits every group once */
+	for (size_t probe = 1; probe <= groups; probe++)
+	{
+		const UINT64 ctrl = HashTable_LoadGroup(array, group);
+
+		for (UINT64 match = HashTable_MatchHash(ctrl, hash); match; match &= match - 1)
+		{
+			const size_t index = group * HASHTABLE_GROUP + HashTable_FirstMatch(match);
+			wHashTableSlot* slot = &array->slots[index];
+
+			if (HashTable_Equals(table, slot, key, hash))
+				return slot;
+		}
+
+		/* an insert would have used the empty slot, the key is not further down */
+		if (HashTable_MatchEmpty(ctrl))
+			break;
+
+		group = (group + probe) & (groups - 1);
+	}
+
+	return NULL;
+}
+
+static inline size_t HashTable_FindFree(const wHashTableArray* array, UINT32 hash)
+{
+	const size_t groups = array->capacity / HASHTABLE_GROUP;
+	size_t group = (hash >> 7) & (groups - 1);
+
+	for (size_t probe = 1; probe <= groups; probe++)
+	{
+		const UINT64 match = HashTable_MatchFree(HashTable_LoadGroup(array, group));
+
+		if (match)
+			return group * HASHTABLE_GROUP + HashTable_FirstMatch(match);
+
+		group = (group + probe) & (groups - 1);
+	}
+
+	return array->capacity;
+}
+
+static inline wHashTableSlot* HashTable_Get(wHashTable* table, const void* key, UINT32 hash)
 {
 	WINPR_ASSERT(table);
 
-	const float numOfElements = (float)table->numOfElements;
-	const float tmp = (numOfElements / table->idealRatio);
-	size_t idealNumOfBuckets = (size_t)tmp;
+	wHashTableSlot* slot = HashTable_FindSlot(table, table->array, key, hash);
+	if (slot)
+		return slot;
 
-	if (idealNumOfBuckets < 5)
-		idealNumOfBuckets = 5;
-	else
-		idealNumOfBuckets |= 0x01;
+	for (size_t index = 0; index < table->overflowCount; index++)
+	{
+		slot = &table->overflow[index];
+		if (HashTable_Equals(table, slot, key, hash))
+			return slot;
+	}
+
+	return NULL;
+}
 
-	while (!HashTable_IsProbablePrime(idealNumOfBuckets))
-		idealNumOfBuckets += 2;
+/** @brief iterates the entries of the slot array and the overflow slots, \b index starts at 0 */
+static inline wHashTableSlot* HashTable_Next(wHashTable* table, size_t* index)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(index);
+
+	const wHashTableArray* array = table->array;
+
+	while (*index < array->capacity)
+	{
+		const size_t x = (*index)++;
+		if (array->ctrl[x] < HASHTABLE_EMPTY)
+			return &array->slots[x];
+	}
 
-	return idealNumOfBuckets;
+	const size_t x = (*index)++ - array->capacity;
+	if (x < table->overflowCount)
+		return &table->overflow[x];
+	return NULL;
 }
 
-static inline void HashTable_Rehash(wHashTable* table, size_t numOfBuckets)
+static wHashTableArray* HashTable_ArrayNew(size_t capacity)
 {
-	UINT32 hashValue = 0;
-	wKeyValuePair* nextPair = NULL;
-	wKeyValuePair** newBucketArray = NULL;
+	WINPR_ASSERT(capacity >= HASHTABLE_GROUP);
+	WINPR_ASSERT((capacity & (capacity - 1)) == 0);
+
+	if (capacity > (SIZE_MAX - sizeof(wHashTableArray)) / (1 + sizeof(wHashTableSlot)))
+		return NULL;
+
+	/* the control bytes and slots follow the header in the same allocation */
+	wHashTableArray* array =
+	    malloc(sizeof(wHashTableArray) + capacity * (1 + sizeof(wHashTableSlot)));
+	if (!array)
+		return NULL;
+
+	array->capacity = capacity;
+	array->ctrl = (BYTE*)&array[1];
+	array->slots = (wHashTableSlot*)&array->ctrl[capacity];
+	array->retired = NULL;
+	memset(array->ctrl, HASHTABLE_EMPTY, capacity);
+	return array;
+}
+
+static inline LONG HashTable_LoadSequence(wHashTable* table)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(&table->sequence, __ATOMIC_ACQUIRE);
+#else
+	return InterlockedCompareExchange(&table->sequence, 0, 0);
+#endif
+}
+
+static inline BOOL HashTable_SequenceUnchanged(wHashTable* table, LONG sequence)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&table->sequence, __ATOMIC_RELAXED) == sequence;
+#else
+	return InterlockedCompareExchange(&table->sequence, 0, 0) == sequence;
+#endif
+}
+
+static inline wHashTableArray* HashTable_LoadArray(wHashTable* table)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(&table->array, __ATOMIC_ACQUIRE);
+#else
+	return InterlockedCompareExchangePointer((PVOID volatile*)&table->array, NULL, NULL);
+#endif
+}
+
+static inline void HashTable_StoreArray(wHashTable* table, wHashTableArray* array)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_store_n(&table->array, array, __ATOMIC_RELEASE);
+#else
+	(void)InterlockedCompareExchangePointer((PVOID volatile*)&table->array, array, table->array);
+#endif
+}
+
+static inline void HashTable_BeginWrite(wHashTable* table)
+{
+	WINPR_ASSERT(table);
+	if (!table->synchronized)
+		return;
+
+	EnterCriticalSection(&table->lock);
+	if (table->writers++ == 0)
+		(void)InterlockedIncrement(&table->sequence);
+}
+
+static inline void HashTable_EndWrite(wHashTable* table)
+{
+	WINPR_ASSERT(table);
+	if (!table->synchronized)
+		return;
+
+	WINPR_ASSERT(table->writers > 0);
+	if (--table->writers == 0)
+		(void)InterlockedIncrement(&table->sequence);
+	LeaveCriticalSection(&table->lock);
+}
+
+/**
+ * A seqlock reader: the lookup runs without the lock and is only used if no writer was active
+ * meanwhile, otherwise the caller looks up the key with the lock held.
+ *
+ * Restricted to pointer keys, comparing them never touches memory a concurrent writer frees.
+ * Replaced slot arrays stay allocated until HashTable_Free, the probing of a stale array always
+ * stays in bounds.
+ */
+static BOOL HashTable_ReadUnlocked(wHashTable* table, const void* key, UINT32 hash, BOOL* found,
+                                   void** value)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(found);
+	WINPR_ASSERT(value);
+
+	if (!table->synchronized || (table->key.fnObjectEquals != HashTable_PointerCompare))
+		return FALSE;
+
+	for (size_t x = 0; x < HASHTABLE_READ_RETRIES; x++)
+	{
+		const LONG sequence = HashTable_LoadSequence(table);
+
+		/* a writer is active, the lock waits for it */
+		if ((sequence & 1) || (table->overflowCount > 0))
+			return FALSE;
+
+		const wHashTableArray* array = HashTable_LoadArray(table);
+		const wHashTableSlot* slot = HashTable_FindSlot(table, array, key, hash);
+		*found = slot && !slot->markedForRemove;
+		*value = *found ? slot->value : NULL;
+
+		if (HashTable_SequenceUnchanged(table, sequence))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static BOOL HashTable_Lookup(wHashTable* table, const void* key, void** pvalue)
+{
+	BOOL found = FALSE;
+	void* value = NULL;
 
 	WINPR_ASSERT(table);
-	if (numOfBuckets == 0)
-		numOfBuckets = HashTable_CalculateIdealNumOfBuckets(table);
+	WINPR_ASSERT(key);
 
-	if (numOfBuckets == table->numOfBuckets)
-		return; /* already the right size! */
+	const UINT32 hash = HashTable_Hash(table, key);
 
-	newBucketArray = (wKeyValuePair**)calloc(numOfBuckets, sizeof(wKeyValuePair*));
+	if (!HashTable_ReadUnlocked(table, key, hash, &found, &value))
+	{
+		if (table->synchronized)
+			EnterCriticalSection(&table->lock);
 
-	if (!newBucketArray)
+		const wHashTableSlot* slot = HashTable_Get(table, key, hash);
+		found = slot && !slot->markedForRemove;
+		value = found ? slot->value : NULL;
+
+		if (table->synchronized)
+			LeaveCriticalSection(&table->lock);
+	}
+
+	if (pvalue)
+		*pvalue = value;
+	return found;
+}
+
+static inline void HashTable_Retire(wHashTable* table, wHashTableArray* array)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(array);
+
+	if (!table->synchronized)
 	{
-		/*
-		 * Couldn't allocate memory for the new array.
-		 * This isn't a fatal error; we just can't perform the rehash.
-		 */
+		free(array);
 		return;
 	}
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	array->retired = table->retired;
+	table->retired = array;
+}
+
+static inline void HashTable_Place(wHashTableArray* array, const wHashTableSlot* entry)
+{
+	const size_t index = HashTable_FindFree(array, entry->hash);
+
+	WINPR_ASSERT(index < array->capacity);
+	array->ctrl[index] = HashTable_H2(entry->hash);
+	array->slots[index] = *entry;
+}
+
+static BOOL HashTable_Rehash(wHashTable* table, size_t capacity)
+{
+	WINPR_ASSERT(table);
+
+	wHashTableArray* array = table->array;
+	WINPR_ASSERT(array);
+	WINPR_ASSERT(HashTable_MaxLoad(capacity) > table->occupied);
+
+	if (capacity == array->capacity)
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
+		/* drop the tombstones in place, a synchronized table keeps every replaced array */
+		size_t count = 0;
+		wHashTableSlot* entries = NULL;
+
+		if (table->occupied > 0)
+		{
+			entries = (wHashTableSlot*)calloc(table->occupied, sizeof(wHashTableSlot));
+			if (!entries)
+				return FALSE;
+		}
 
-		while (pair)
+		for (size_t index = 0; index < array->capacity; index++)
 		{
-			nextPair = pair->next;
-			hashValue = table->hash(pair->key) % numOfBuckets;
-			pair->next = newBucketArray[hashValue];
-			newBucketArray[hashValue] = pair;
-			pair = nextPair;
+			if (array->ctrl[index] < HASHTABLE_EMPTY)
+				entries[count++] = array->slots[index];
 		}
+
+		memset(array->ctrl, HASHTABLE_EMPTY, array->capacity);
+		for (size_t index = 0; index < count; index++)
+			HashTable_Place(array, &entries[index]);
+		free(entries);
+	}
+	else
+	{
+		wHashTableArray* newArray = HashTable_ArrayNew(capacity);
+		if (!newArray)
+			return FALSE;
+
+		for (size_t index = 0; index < array->capacity; index++)
+		{
+			if (array->ctrl[index] < HASHTABLE_EMPTY)
+				HashTable_Place(newArray, &array->slots[index]);
+		}
+
+		HashTable_StoreArray(table, newArray);
+		HashTable_Retire(table, array);
 	}
 
-	free((void*)table->bucketArray);
-	table->bucketArray = newBucketArray;
-	table->numOfBuckets = numOfBuckets;
+	table->tombstones = 0;
+	return TRUE;
+}
+
+static inline BOOL HashTable_Grow(wHashTable* table)
+{
+	WINPR_ASSERT(table);
+
+	const size_t capacity = table->array->capacity;
+
+	/* mostly tombstones, dropping them makes enough room */
+	if (table->occupied < HashTable_MaxLoad(capacity) / 2)
+		return HashTable_Rehash(table, capacity);
+
+	if (capacity > SIZE_MAX / 2)
+		return FALSE;
+	return HashTable_Rehash(table, capacity * 2);
 }
 
-static inline BOOL HashTable_Equals(wHashTable* table, const wKeyValuePair* pair, const void* key)
+/** @brief a free slot of the slot array, \b NULL if the array is full and can not grow now */
+static wHashTableSlot* HashTable_ArraySlot(wHashTable* table, UINT32 hash)
 {
 	WINPR_ASSERT(table);
-	WINPR_ASSERT(pair);
-	WINPR_ASSERT(key);
-	return table->key.fnObjectEquals(key, pair->key);
+
+	wHashTableArray* array = table->array;
+	size_t index = HashTable_FindFree(array, hash);
+
+	if ((index < array->capacity) && (array->ctrl[index] == HASHTABLE_DELETED))
+		table->tombstones--;
+	else if (table->occupied + table->tombstones >= HashTable_MaxLoad(array->capacity))
+	{
+		/* no rehash while HashTable_Foreach walks the slots */
+		if (table->foreachRecursionLevel || !HashTable_Grow(table))
+			return NULL;
+
+		array = table->array;
+		index = HashTable_FindFree(array, hash);
+	}
+
+	WINPR_ASSERT(index < array->capacity);
+	table->occupied++;
+	array->ctrl[index] = HashTable_H2(hash);
+	return &array->slots[index];
 }
 
-static inline wKeyValuePair* HashTable_Get(wHashTable* table, const void* key)
+static wHashTableSlot* HashTable_NewSlot(wHashTable* table, UINT32 hash)
 {
-	UINT32 hashValue = 0;
-	wKeyValuePair* pair = NULL;
+	WINPR_ASSERT(table);
+
+	wHashTableSlot* slot = HashTable_ArraySlot(table, hash);
+	if (slot)
+		return slot;
+
+	if (table->overflowCount == table->overflowSize)
+	{
+		const size_t size = table->overflowSize ? table->overflowSize * 2 : HASHTABLE_GROUP;
+		wHashTableSlot* overflow =
+		    (wHashTableSlot*)realloc(table->overflow, size * sizeof(wHashTableSlot));
+
+		if (!overflow)
+			return NULL;
+
+		table->overflow = overflow;
+		table->overflowSize = size;
+	}
 
+	return &table->overflow[table->overflowCount++];
+}
+
+static void HashTable_Erase(wHashTable* table, wHashTableSlot* slot)
+{
 	WINPR_ASSERT(table);
-	if (!key)
-		return NULL;
+	WINPR_ASSERT(slot);
 
-	hashValue = table->hash(key) % table->numOfBuckets;
-	pair = table->bucketArray[hashValue];
+	wHashTableArray* array = table->array;
+	const size_t offset = (size_t)((ULONG_PTR)slot - (ULONG_PTR)array->slots);
+	const size_t index = offset / sizeof(wHashTableSlot);
 
-	while (pair && !HashTable_Equals(table, pair, key))
-		pair = pair->next;
+	if (index >= array->capacity)
+	{
+		/* an overflow slot, the last one takes its place */
+		WINPR_ASSERT(table->overflowCount > 0);
+		*slot = table->overflow[--table->overflowCount];
+		return;
+	}
 
-	return pair;
+	/* no probe passed a group with an empty slot, such a group needs no tombstone */
+	if (HashTable_MatchEmpty(HashTable_LoadGroup(array, index / HASHTABLE_GROUP)))
+		array->ctrl[index] = HASHTABLE_EMPTY;
+	else
+	{
+		array->ctrl[index] = HASHTABLE_DELETED;
+		table->tombstones++;
+	}
+
+	WINPR_ASSERT(table->occupied > 0);
+	table->occupied--;
 }
 
 static inline void disposeKey(wHashTable* table, void* key)
@@ -219,24 +635,23 @@ static inline void disposeValue(wHashTable* table, void* value)
 		table->value.fnObjectFree(value);
 }
 
-static inline void disposePair(wHashTable* table, wKeyValuePair* pair)
+static inline void disposeSlot(wHashTable* table, wHashTableSlot* slot)
 {
 	WINPR_ASSERT(table);
-	if (!pair)
+	if (!slot)
 		return;
-	disposeKey(table, pair->key);
-	disposeValue(table, pair->value);
-	free(pair);
+	disposeKey(table, slot->key);
+	disposeValue(table, slot->value);
 }
 
-static inline void setKey(wHashTable* table, wKeyValuePair* pair, const void* key)
+static inline void setKey(wHashTable* table, wHashTableSlot* slot, const void* key)
 {
 	WINPR_ASSERT(table);
-	if (!pair)
+	if (!slot)
 		return;
-	disposeKey(table, pair->key);
+	disposeKey(table, slot->key);
 	if (table->key.fnObjectNew)
-		pair->key = table->key.fnObjectNew(key);
+		slot->key = table->key.fnObjectNew(key);
 	else
 	{
 		union
@@ -245,18 +660,18 @@ static inline void setKey(wHashTable* table, wKeyValuePair* pair, const void* ke
 			void* pv;
 		} cnv;
 		cnv.cpv = key;
-		pair->key = cnv.pv;
+		slot->key = cnv.pv;
 	}
 }
 
-static inline void setValue(wHashTable* table, wKeyValuePair* pair, const void* value)
+static inline void setValue(wHashTable* table, wHashTableSlot* slot, const void* value)
 {
 	WINPR_ASSERT(table);
-	if (!pair)
+	if (!slot)
 		return;
-	disposeValue(table, pair->value);
+	disposeValue(table, slot->value);
 	if (table->value.fnObjectNew)
-		pair->value = table->value.fnObjectNew(value);
+		slot->value = table->value.fnObjectNew(value);
 	else
 	{
 		union
@@ -265,10 +680,98 @@ static inline void setValue(wHashTable* table, wKeyValuePair* pair, const void*
 			void* pv;
 		} cnv;
 		cnv.cpv = value;
-		pair->value = cnv.pv;
+		slot->value = cnv.pv;
 	}
 }
 
+/** @brief disposes all entries and resets the table to empty slots */
+static void HashTable_Reset(wHashTable* table)
+{
+	WINPR_ASSERT(table);
+
+	size_t index = 0;
+	wHashTableSlot* slot = NULL;
+
+	while ((slot = HashTable_Next(table, &index)))
+		disposeSlot(table, slot);
+
+	/* a synchronized table keeps its slots, a replaced array would stay until HashTable_Free */
+	if (!table->synchronized && (table->array->capacity > HASHTABLE_INITIAL_CAPACITY))
+	{
+		wHashTableArray* array = HashTable_ArrayNew(HASHTABLE_INITIAL_CAPACITY);
+
+		if (array)
+		{
+			free(table->array);
+			table->array = array;
+		}
+	}
+
+	memset(table->array->ctrl, HASHTABLE_EMPTY, table->array->capacity);
+	table->occupied = 0;
+	table->tombstones = 0;
+
+	free(table->overflow);
+	table->overflow = NULL;
+	table->overflowCount = 0;
+	table->overflowSize = 0;
+}
+
+/** @brief disposes the entries removed and moves the entries inserted during a HashTable_Foreach */
+static void HashTable_Cleanup(wHashTable* table)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(table->foreachRecursionLevel == 0);
+
+	if ((table->pendingRemoves == 0) && (table->overflowCount == 0))
+		return;
+
+	HashTable_BeginWrite(table);
+
+	if (table->pendingRemoves)
+	{
+		wHashTableArray* array = table->array;
+
+		for (size_t index = 0; index < array->capacity; index++)
+		{
+			wHashTableSlot* slot = &array->slots[index];
+
+			if ((array->ctrl[index] < HASHTABLE_EMPTY) && slot->markedForRemove)
+			{
+				disposeSlot(table, slot);
+				HashTable_Erase(table, slot);
+			}
+		}
+		table->pendingRemoves = 0;
+	}
+
+	while (table->overflowCount > 0)
+	{
+		const wHashTableSlot entry = table->overflow[table->overflowCount - 1];
+
+		if (entry.markedForRemove)
+			disposeSlot(table, &table->overflow[table->overflowCount - 1]);
+		else
+		{
+			wHashTableSlot* slot = HashTable_ArraySlot(table, entry.hash);
+			if (!slot)
+				break;
+			*slot = entry;
+		}
+
+		table->overflowCount--;
+	}
+
+	if (table->overflowCount == 0)
+	{
+		free(table->overflow);
+		table->overflow = NULL;
+		table->overflowSize = 0;
+	}
+
+	HashTable_EndWrite(table);
+}
+
 /**
  * C equivalent of the C# Hashtable Class:
  * http://msdn.microsoft.com/en-us/library/system.collections.hashtable.aspx
@@ -307,71 +810,56 @@ int HashTable_Add(wHashTable* table, const void* key, const void* value)
 BOOL HashTable_Insert(wHashTable* table, const void* key, const void* value)
 {
 	BOOL rc = FALSE;
-	UINT32 hashValue = 0;
-	wKeyValuePair* pair = NULL;
-	wKeyValuePair* newPair = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key || !value)
 		return FALSE;
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
+	const UINT32 hash = HashTable_Hash(table, key);
 
-	hashValue = table->hash(key) % table->numOfBuckets;
-	pair = table->bucketArray[hashValue];
+	HashTable_BeginWrite(table);
 
-	while (pair && !HashTable_Equals(table, pair, key))
-		pair = pair->next;
+	wHashTableSlot* slot = HashTable_Get(table, key, hash);
 
-	if (pair)
+	if (slot)
 	{
-		if (pair->markedForRemove)
+		if (slot->markedForRemove)
 		{
 			/* this entry was set to be removed but will be recycled instead */
 			table->pendingRemoves--;
-			pair->markedForRemove = FALSE;
+			slot->markedForRemove = FALSE;
 			table->numOfElements++;
 		}
 
-		if (pair->key != key)
+		if (slot->key != key)
 		{
-			setKey(table, pair, key);
+			setKey(table, slot, key);
 		}
 
-		if (pair->value != value)
+		if (slot->value != value)
 		{
-			setValue(table, pair, value);
+			setValue(table, slot, value);
 		}
 		rc = TRUE;
 	}
 	else
 	{
-		newPair = (wKeyValuePair*)calloc(1, sizeof(wKeyValuePair));
+		slot = HashTable_NewSlot(table, hash);
 
-		if (newPair)
+		if (slot)
 		{
-			setKey(table, newPair, key);
-			setValue(table, newPair, value);
-			newPair->next = table->bucketArray[hashValue];
-			newPair->markedForRemove = FALSE;
-			table->bucketArray[hashValue] = newPair;
+			slot->key = NULL;
+			slot->value = NULL;
+			slot->hash = hash;
+			slot->markedForRemove = FALSE;
+			setKey(table, slot, key);
+			setValue(table, slot, value);
 			table->numOfElements++;
-
-			if (!table->foreachRecursionLevel && table->upperRehashThreshold > table->idealRatio)
-			{
-				float elementToBucketRatio =
-				    (float)table->numOfElements / (float)table->numOfBuckets;
-
-				if (elementToBucketRatio > table->upperRehashThreshold)
-					HashTable_Rehash(table, 0);
-			}
 			rc = TRUE;
 		}
 	}
 
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
+	HashTable_EndWrite(table);
 
 	return rc;
 }
@@ -382,28 +870,19 @@ BOOL HashTable_Insert(wHashTable* table, const void* key, const void* value)
 
 BOOL HashTable_Remove(wHashTable* table, const void* key)
 {
-	UINT32 hashValue = 0;
 	BOOL status = TRUE;
-	wKeyValuePair* pair = NULL;
-	wKeyValuePair* previousPair = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
 		return FALSE;
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
+	const UINT32 hash = HashTable_Hash(table, key);
 
-	hashValue = table->hash(key) % table->numOfBuckets;
-	pair = table->bucketArray[hashValue];
+	HashTable_BeginWrite(table);
 
-	while (pair && !HashTable_Equals(table, pair, key))
-	{
-		previousPair = pair;
-		pair = pair->next;
-	}
+	wHashTableSlot* slot = HashTable_Get(table, key, hash);
 
-	if (!pair)
+	if (!slot || slot->markedForRemove)
 	{
 		status = FALSE;
 		goto out;
@@ -412,31 +891,18 @@ BOOL HashTable_Remove(wHashTable* table, const void* key)
 	if (table->foreachRecursionLevel)
 	{
 		/* if we are running a HashTable_Foreach, just mark the entry for removal */
-		pair->markedForRemove = TRUE;
+		slot->markedForRemove = TRUE;
 		table->pendingRemoves++;
 		table->numOfElements--;
 		goto out;
 	}
 
-	if (previousPair)
-		previousPair->next = pair->next;
-	else
-		table->bucketArray[hashValue] = pair->next;
-
-	disposePair(table, pair);
+	disposeSlot(table, slot);
+	HashTable_Erase(table, slot);
 	table->numOfElements--;
 
-	if (!table->foreachRecursionLevel && table->lowerRehashThreshold > 0.0f)
-	{
-		float elementToBucketRatio = (float)table->numOfElements / (float)table->numOfBuckets;
-
-		if (elementToBucketRatio < table->lowerRehashThreshold)
-			HashTable_Rehash(table, 0);
-	}
-
 out:
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
+	HashTable_EndWrite(table);
 
 	return status;
 }
@@ -448,23 +914,12 @@ out:
 void* HashTable_GetItemValue(wHashTable* table, const void* key)
 {
 	void* value = NULL;
-	wKeyValuePair* pair = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
 		return NULL;
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
-
-	pair = HashTable_Get(table, key);
-
-	if (pair && !pair->markedForRemove)
-		value = pair->value;
-
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
-
+	(void)HashTable_Lookup(table, key, &value);
 	return value;
 }
 
@@ -475,26 +930,25 @@ void* HashTable_GetItemValue(wHashTable* table, const void* key)
 BOOL HashTable_SetItemValue(wHashTable* table, const void* key, const void* value)
 {
 	BOOL status = TRUE;
-	wKeyValuePair* pair = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
 		return FALSE;
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
+	const UINT32 hash = HashTable_Hash(table, key);
+
+	HashTable_BeginWrite(table);
 
-	pair = HashTable_Get(table, key);
+	wHashTableSlot* slot = HashTable_Get(table, key, hash);
 
-	if (!pair || pair->markedForRemove)
+	if (!slot || slot->markedForRemove)
 		status = FALSE;
 	else
 	{
-		setValue(table, pair, value);
+		setValue(table, slot, value);
 	}
 
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
+	HashTable_EndWrite(table);
 
 	return status;
 }
@@ -505,43 +959,31 @@ BOOL HashTable_SetItemValue(wHashTable* table, const void* key, const void* valu
 
 void HashTable_Clear(wHashTable* table)
 {
-	wKeyValuePair* nextPair = NULL;
-
 	WINPR_ASSERT(table);
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
+	HashTable_BeginWrite(table);
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	if (table->foreachRecursionLevel)
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
+		/* if we're in a foreach we just mark the entries for removal */
+		size_t index = 0;
+		wHashTableSlot* slot = NULL;
 
-		while (pair)
+		while ((slot = HashTable_Next(table, &index)))
 		{
-			nextPair = pair->next;
-
-			if (table->foreachRecursionLevel)
+			if (!slot->markedForRemove)
 			{
-				/* if we're in a foreach we just mark the entry for removal */
-				pair->markedForRemove = TRUE;
+				slot->markedForRemove = TRUE;
 				table->pendingRemoves++;
 			}
-			else
-			{
-				disposePair(table, pair);
-				pair = nextPair;
-			}
 		}
-
-		table->bucketArray[index] = NULL;
 	}
+	else
+		HashTable_Reset(table);
 
 	table->numOfElements = 0;
-	if (table->foreachRecursionLevel == 0)
-		HashTable_Rehash(table, 5);
 
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
+	HashTable_EndWrite(table);
 }
 
 /**
@@ -551,16 +993,16 @@ void HashTable_Clear(wHashTable* table)
 size_t HashTable_GetKeys(wHashTable* table, ULONG_PTR** ppKeys)
 {
 	size_t iKey = 0;
+	size_t index = 0;
 	size_t count = 0;
 	ULONG_PTR* pKeys = NULL;
-	wKeyValuePair* nextPair = NULL;
+	const wHashTableSlot* slot = NULL;
 
 	WINPR_ASSERT(table);
 
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	iKey = 0;
 	count = table->numOfElements;
 	if (ppKeys)
 		*ppKeys = NULL;
@@ -583,16 +1025,12 @@ size_t HashTable_GetKeys(wHashTable* table, ULONG_PTR** ppKeys)
 		return 0;
 	}
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	while ((slot = HashTable_Next(table, &index)))
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
-
-		while (pair)
+		if (!slot->markedForRemove)
 		{
-			nextPair = pair->next;
-			if (!pair->markedForRemove)
-				pKeys[iKey++] = (ULONG_PTR)pair->key;
-			pair = nextPair;
+			WINPR_ASSERT(iKey < count);
+			pKeys[iKey++] = (ULONG_PTR)slot->key;
 		}
 	}
 
@@ -609,6 +1047,8 @@ size_t HashTable_GetKeys(wHashTable* table, ULONG_PTR** ppKeys)
 BOOL HashTable_Foreach(wHashTable* table, HASH_TABLE_FOREACH_FN fn, VOID* arg)
 {
 	BOOL ret = TRUE;
+	size_t index = 0;
+	const wHashTableSlot* slot = NULL;
 
 	WINPR_ASSERT(table);
 	WINPR_ASSERT(fn);
@@ -616,48 +1056,20 @@ BOOL HashTable_Foreach(wHashTable* table, HASH_TABLE_FOREACH_FN fn, VOID* arg)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
+	/* the slots are not rehashed before the outermost foreach returns, entries inserted by fn
+	 * might or might not be visited */
 	table->foreachRecursionLevel++;
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	while (ret && (slot = HashTable_Next(table, &index)))
 	{
-		for (wKeyValuePair* pair = table->bucketArray[index]; pair; pair = pair->next)
-		{
-			if (!pair->markedForRemove && !fn(pair->key, pair->value, arg))
-			{
-				ret = FALSE;
-				goto out;
-			}
-		}
+		if (!slot->markedForRemove)
+			ret = fn(slot->key, slot->value, arg);
 	}
 	table->foreachRecursionLevel--;
 
-	if (!table->foreachRecursionLevel && table->pendingRemoves)
-	{
-		/* if we're the last recursive foreach call, let's do the cleanup if needed */
-		wKeyValuePair** prevPtr = NULL;
-		for (size_t index = 0; index < table->numOfBuckets; index++)
-		{
-			wKeyValuePair* nextPair = NULL;
-			prevPtr = &table->bucketArray[index];
-			for (wKeyValuePair* pair = table->bucketArray[index]; pair;)
-			{
-				nextPair = pair->next;
-
-				if (pair->markedForRemove)
-				{
-					disposePair(table, pair);
-					*prevPtr = nextPair;
-				}
-				else
-				{
-					prevPtr = &pair->next;
-				}
-				pair = nextPair;
-			}
-		}
-		table->pendingRemoves = 0;
-	}
+	/* if we're the last recursive foreach call, let's do the cleanup if needed */
+	if (!table->foreachRecursionLevel)
+		HashTable_Cleanup(table);
 
-out:
 	if (table->synchronized)
 		LeaveCriticalSection(&table->lock);
 	return ret;
@@ -669,23 +1081,11 @@ out:
 
 BOOL HashTable_Contains(wHashTable* table, const void* key)
 {
-	BOOL status = 0;
-	wKeyValuePair* pair = NULL;
-
 	WINPR_ASSERT(table);
 	if (!key)
 		return FALSE;
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
-
-	pair = HashTable_Get(table, key);
-	status = (pair && !pair->markedForRemove);
-
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
-
-	return status;
+	return HashTable_Lookup(table, key, NULL);
 }
 
 /**
@@ -694,23 +1094,11 @@ BOOL HashTable_Contains(wHashTable* table, const void* key)
 
 BOOL HashTable_ContainsKey(wHashTable* table, const void* key)
 {
-	BOOL status = 0;
-	wKeyValuePair* pair = NULL;
-
 	WINPR_ASSERT(table);
 	if (!key)
 		return FALSE;
 
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
-
-	pair = HashTable_Get(table, key);
-	status = (pair && !pair->markedForRemove);
-
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
-
-	return status;
+	return HashTable_Lookup(table, key, NULL);
 }
 
 /**
@@ -720,6 +1108,8 @@ BOOL HashTable_ContainsKey(wHashTable* table, const void* key)
 BOOL HashTable_ContainsValue(wHashTable* table, const void* value)
 {
 	BOOL status = FALSE;
+	size_t index = 0;
+	const wHashTableSlot* slot = NULL;
 
 	WINPR_ASSERT(table);
 	if (!value)
@@ -728,23 +1118,13 @@ BOOL HashTable_ContainsValue(wHashTable* table, const void* value)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	while ((slot = HashTable_Next(table, &index)))
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
-
-		while (pair)
+		if (!slot->markedForRemove && table->key.fnObjectEquals(value, slot->key))
 		{
-			if (!pair->markedForRemove && HashTable_Equals(table, pair, value))
-			{
-				status = TRUE;
-				break;
-			}
-
-			pair = pair->next;
-		}
-
-		if (status)
+			status = TRUE;
 			break;
+		}
 	}
 
 	if (table->synchronized)
@@ -766,16 +1146,11 @@ wHashTable* HashTable_New(BOOL synchronized)
 
 	table->synchronized = synchronized;
 	InitializeCriticalSectionAndSpinCount(&(table->lock), 4000);
-	table->numOfBuckets = 64;
-	table->numOfElements = 0;
-	table->bucketArray = (wKeyValuePair**)calloc(table->numOfBuckets, sizeof(wKeyValuePair*));
+	table->array = HashTable_ArrayNew(HASHTABLE_INITIAL_CAPACITY);
 
-	if (!table->bucketArray)
+	if (!table->array)
 		goto fail;
 
-	table->idealRatio = 3.0f;
-	table->lowerRehashThreshold = 0.0f;
-	table->upperRehashThreshold = 15.0f;
 	table->hash = HashTable_PointerHash;
 	table->key.fnObjectEquals = HashTable_PointerCompare;
 	table->value.fnObjectEquals = HashTable_PointerCompare;
@@ -791,28 +1166,27 @@ fail:
 
 void HashTable_Free(wHashTable* table)
 {
-	wKeyValuePair* pair = NULL;
-	wKeyValuePair* nextPair = NULL;
-
 	if (!table)
 		return;
 
-	if (table->bucketArray)
+	if (table->array)
 	{
-		for (size_t index = 0; index < table->numOfBuckets; index++)
-		{
-			pair = table->bucketArray[index];
+		size_t index = 0;
+		wHashTableSlot* slot = NULL;
 
-			while (pair)
-			{
-				nextPair = pair->next;
+		while ((slot = HashTable_Next(table, &index)))
+			disposeSlot(table, slot);
+		free(table->array);
+	}
 
-				disposePair(table, pair);
-				pair = nextPair;
-			}
-		}
-		free((void*)table->bucketArray);
+	while (table->retired)
+	{
+		wHashTableArray* array = table->retired;
+		table->retired = array->retired;
+		free(array);
 	}
+
+	free(table->overflow);
 	DeleteCriticalSection(&(table->lock));
 
 	free(table);
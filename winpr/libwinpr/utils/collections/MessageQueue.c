@@ -161,25 +161,19 @@ static BOOL MessageQueue_EnsureCapacity(wMessageQueue* queue, size_t count)
 	return TRUE;
 }
 
-BOOL MessageQueue_Dispatch(wMessageQueue* queue, const wMessage* message)
+/* must be called with queue->lock held */
+static BOOL MessageQueue_DispatchLocked(wMessageQueue* queue, const wMessage* message)
 {
-	wMessage* dst = NULL;
-	BOOL ret = FALSE;
-	WINPR_ASSERT(queue);
-
-	if (!message)
-		return FALSE;
-
 	WINPR_ASSERT(queue);
-	EnterCriticalSection(&queue->lock);
+	WINPR_ASSERT(message);
 
 	if (queue->closed)
-		goto out;
+		return FALSE;
 
 	if (!MessageQueue_EnsureCapacity(queue, 1))
-		goto out;
+		return FALSE;
 
-	dst = &(queue->array[queue->tail]);
+	wMessage* dst = &(queue->array[queue->tail]);
 	*dst = *message;
 	dst->time = GetTickCount64();
 
@@ -192,12 +186,59 @@ BOOL MessageQueue_Dispatch(wMessageQueue* queue, const wMessage* message)
 	if (message->id == WMQ_QUIT)
 		queue->closed = TRUE;
 
-	ret = TRUE;
-out:
+	return TRUE;
+}
+
+BOOL MessageQueue_Dispatch(wMessageQueue* queue, const wMessage* message)
+{
+	WINPR_ASSERT(queue);
+
+	if (!message)
+		return FALSE;
+
+	EnterCriticalSection(&queue->lock);
+	const BOOL ret = MessageQueue_DispatchLocked(queue, message);
 	LeaveCriticalSection(&queue->lock);
 	return ret;
 }
 
+int MessageQueue_Coalesce(wMessageQueue* queue, const wMessage* message,
+                          MESSAGE_QUEUE_COALESCE_FN fn, void* arg)
+{
+	int status = -1;
+
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(fn);
+
+	if (!message)
+		return -1;
+
+	EnterCriticalSection(&queue->lock);
+
+	if (queue->closed)
+		goto out;
+
+	for (size_t x = 0; x < queue->size; x++)
+	{
+		const size_t index = (queue->tail + queue->capacity - 1 - x) % queue->capacity;
+		const wMessageQueueCoalesce rc = fn(&queue->array[index], message, arg);
+		if (rc == WMQ_COALESCE_MERGED)
+		{
+			status = 1;
+			goto out;
+		}
+		if (rc != WMQ_COALESCE_CONTINUE)
+			break;
+	}
+
+	if (MessageQueue_DispatchLocked(queue, message))
+		status = 0;
+
+out:
+	LeaveCriticalSection(&queue->lock);
+	return status;
+}
+
 BOOL MessageQueue_Post(wMessageQueue* queue, void* context, UINT32 type, void* wParam, void* lParam)
 {
 	wMessage message = { 0 };
@@ -1,6 +1,9 @@
 
 #include <winpr/crt.h>
 #include <winpr/tchar.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
 #include <winpr/collections.h>
 
 static char* key1 = "key1";
@@ -431,6 +434,461 @@ out:
 	return retCode;
 }
 
+#define TEST_ENTRIES 10000
+#define TEST_READERS 2
+#define TEST_READS 200000
+#define TEST_BENCH_ENTRIES 100000
+#define TEST_BENCH_LOOKUPS 10
+
+static void* test_pointer(size_t x)
+{
+	return (void*)(ULONG_PTR)((x + 1) * 16);
+}
+
+static int test_hash_table_growth(void)
+{
+	int rc = -1;
+	ULONG_PTR* keys = NULL;
+	wHashTable* table = HashTable_New(FALSE);
+
+	if (!table)
+		return -1;
+
+	for (size_t x = 0; x < TEST_ENTRIES; x++)
+	{
+		if (!HashTable_Insert(table, test_pointer(x), test_pointer(x + 1)))
+			goto fail;
+	}
+
+	/* leaves tombstones behind, the following inserts reuse or drop them */
+	for (size_t round = 0; round < 20; round++)
+	{
+		for (size_t x = 0; x < TEST_ENTRIES; x += 2)
+		{
+			if (!HashTable_Remove(table, test_pointer(x)))
+				goto fail;
+		}
+
+		if (HashTable_Count(table) != TEST_ENTRIES / 2)
+			goto fail;
+
+		for (size_t x = 0; x < TEST_ENTRIES; x += 2)
+		{
+			if (HashTable_Contains(table, test_pointer(x)))
+				goto fail;
+			if (!HashTable_Insert(table, test_pointer(x), test_pointer(x + round)))
+				goto fail;
+		}
+	}
+
+	for (size_t x = 0; x < TEST_ENTRIES; x++)
+	{
+		const size_t expect = (x % 2) ? x + 1 : x + 19;
+		if (HashTable_GetItemValue(table, test_pointer(x)) != test_pointer(expect))
+		{
+			printf("HashTable_GetItemValue: wrong value for entry %" PRIuz "\n", x);
+			goto fail;
+		}
+	}
+
+	if (HashTable_GetKeys(table, &keys) != TEST_ENTRIES)
+		goto fail;
+
+	ULONG_PTR sum = 0;
+	for (size_t x = 0; x < TEST_ENTRIES; x++)
+		sum += keys[x];
+	if (sum != 16ull * TEST_ENTRIES * (TEST_ENTRIES + 1) / 2)
+		goto fail;
+
+	HashTable_Clear(table);
+	if ((HashTable_Count(table) != 0) || HashTable_Contains(table, test_pointer(1)))
+		goto fail;
+
+	if (!HashTable_Insert(table, test_pointer(1), test_pointer(2)) ||
+	    (HashTable_GetItemValue(table, test_pointer(1)) != test_pointer(2)))
+		goto fail;
+
+	rc = 1;
+fail:
+	free(keys);
+	HashTable_Free(table);
+	return rc;
+}
+
+static BOOL foreachInsertFn(const void* key, void* value, void* arg)
+{
+	wHashTable* table = arg;
+
+	WINPR_UNUSED(value);
+
+	if (key != test_pointer(0))
+		return TRUE;
+
+	/* more than the slots can take without a rehash */
+	for (size_t x = 100; x < 300; x++)
+	{
+		if (!HashTable_Insert(table, test_pointer(x), test_pointer(x)))
+			return FALSE;
+	}
+
+	/* removed while the inserts above are still pending */
+	if (!HashTable_Remove(table, test_pointer(299)) || !HashTable_Remove(table, test_pointer(1)))
+		return FALSE;
+
+	return HashTable_Contains(table, test_pointer(298)) &&
+	       !HashTable_Contains(table, test_pointer(299)) && (HashTable_Count(table) == 206);
+}
+
+static int test_hash_foreach_insert(void)
+{
+	int rc = -1;
+	wHashTable* table = HashTable_New(TRUE);
+
+	if (!table)
+		return -1;
+
+	for (size_t x = 0; x < 8; x++)
+	{
+		if (!HashTable_Insert(table, test_pointer(x), test_pointer(x)))
+			goto fail;
+	}
+
+	if (!HashTable_Foreach(table, foreachInsertFn, table))
+		goto fail;
+
+	if (HashTable_Count(table) != 206)
+		goto fail;
+
+	for (size_t x = 0; x < 300; x++)
+	{
+		const BOOL expect = (x != 1) && (x != 299) && ((x < 8) || (x >= 100));
+		if (HashTable_Contains(table, test_pointer(x)) != expect)
+		{
+			printf("HashTable_Contains: unexpected result for entry %" PRIuz "\n", x);
+			goto fail;
+		}
+	}
+
+	rc = 1;
+fail:
+	HashTable_Free(table);
+	return rc;
+}
+
+typedef struct
+{
+	wHashTable* table;
+	LONG volatile stop;
+	LONG volatile errors;
+} ConcurrentData;
+
+static DWORD WINAPI test_reader(LPVOID arg)
+{
+	ConcurrentData* data = arg;
+
+	for (size_t x = 0; x < TEST_READS; x++)
+	{
+		const size_t index = x % 64;
+		if (HashTable_GetItemValue(data->table, test_pointer(index)) != test_pointer(index + 1))
+			(void)InterlockedIncrement(&data->errors);
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+static DWORD WINAPI test_writer(LPVOID arg)
+{
+	ConcurrentData* data = arg;
+
+	/* grows, fills with tombstones and rehashes the table under the readers */
+	while (!InterlockedCompareExchange(&data->stop, 0, 0))
+	{
+		for (size_t x = 1000; x < 3000; x++)
+			(void)HashTable_Insert(data->table, test_pointer(x), test_pointer(x));
+		for (size_t x = 1000; x < 3000; x++)
+			(void)HashTable_Remove(data->table, test_pointer(x));
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+static int test_hash_table_concurrent(void)
+{
+	int rc = -1;
+	HANDLE writer = NULL;
+	HANDLE readers[TEST_READERS] = { 0 };
+	ConcurrentData data = { 0 };
+
+	data.table = HashTable_New(TRUE);
+	if (!data.table)
+		return -1;
+
+	for (size_t x = 0; x < 64; x++)
+	{
+		if (!HashTable_Insert(data.table, test_pointer(x), test_pointer(x + 1)))
+			goto fail;
+	}
+
+	writer = CreateThread(NULL, 0, test_writer, &data, 0, NULL);
+	if (!writer)
+		goto fail;
+
+	for (size_t x = 0; x < TEST_READERS; x++)
+	{
+		readers[x] = CreateThread(NULL, 0, test_reader, &data, 0, NULL);
+		if (!readers[x])
+			goto fail;
+	}
+
+	for (size_t x = 0; x < TEST_READERS; x++)
+		(void)WaitForSingleObject(readers[x], INFINITE);
+
+	if (data.errors != 0)
+	{
+		printf("HashTable_GetItemValue: %" PRId32 " wrong values read\n", data.errors);
+		goto fail;
+	}
+
+	rc = 1;
+fail:
+	(void)InterlockedExchange(&data.stop, 1);
+	if (writer)
+		(void)WaitForSingleObject(writer, INFINITE);
+	(void)CloseHandle(writer);
+	for (size_t x = 0; x < TEST_READERS; x++)
+		(void)CloseHandle(readers[x]);
+	HashTable_Free(data.table);
+	return rc;
+}
+
+/**
+ * The separate chaining table HashTable used before, a heap allocated pair per entry and prime
+ * sized buckets, as a reference for test_hash_table_bench.
+ */
+typedef struct s_ChainPair
+{
+	void* key;
+	void* value;
+	struct s_ChainPair* next;
+} ChainPair;
+
+typedef struct
+{
+	size_t numOfBuckets;
+	size_t numOfElements;
+	ChainPair** buckets;
+	HASH_TABLE_HASH_FN hash;
+	OBJECT_EQUALS_FN equals;
+} ChainTable;
+
+static size_t chain_buckets(size_t numOfElements)
+{
+	size_t buckets = (numOfElements / 3) | 0x01;
+
+	for (size_t i = 3; i < 51; i += 2)
+	{
+		if ((buckets != i) && (buckets % i == 0))
+		{
+			buckets += 2;
+			i = 1;
+		}
+	}
+	return buckets;
+}
+
+static BOOL chain_rehash(ChainTable* table, size_t numOfBuckets)
+{
+	ChainPair** buckets = calloc(numOfBuckets, sizeof(ChainPair*));
+	if (!buckets)
+		return FALSE;
+
+	for (size_t x = 0; x < table->numOfBuckets; x++)
+	{
+		ChainPair* next = NULL;
+		for (ChainPair* pair = table->buckets[x]; pair; pair = next)
+		{
+			const size_t index = table->hash(pair->key) % numOfBuckets;
+			next = pair->next;
+			pair->next = buckets[index];
+			buckets[index] = pair;
+		}
+	}
+
+	free(table->buckets);
+	table->buckets = buckets;
+	table->numOfBuckets = numOfBuckets;
+	return TRUE;
+}
+
+static ChainPair** chain_find(ChainTable* table, const void* key)
+{
+	ChainPair** pair = &table->buckets[table->hash(key) % table->numOfBuckets];
+
+	while (*pair && !table->equals(key, (*pair)->key))
+		pair = &(*pair)->next;
+	return pair;
+}
+
+static BOOL chain_insert(ChainTable* table, void* key, void* value)
+{
+	ChainPair** pair = chain_find(table, key);
+	if (*pair)
+	{
+		(*pair)->value = value;
+		return TRUE;
+	}
+
+	ChainPair* newPair = calloc(1, sizeof(ChainPair));
+	if (!newPair)
+		return FALSE;
+
+	newPair->key = key;
+	newPair->value = value;
+	const size_t index = table->hash(key) % table->numOfBuckets;
+	newPair->next = table->buckets[index];
+	table->buckets[index] = newPair;
+	table->numOfElements++;
+
+	if (table->numOfElements > 15 * table->numOfBuckets)
+		return chain_rehash(table, chain_buckets(table->numOfElements));
+	return TRUE;
+}
+
+static void* chain_get(ChainTable* table, const void* key)
+{
+	ChainPair* pair = *chain_find(table, key);
+	return pair ? pair->value : NULL;
+}
+
+static BOOL chain_remove(ChainTable* table, const void* key)
+{
+	ChainPair** pair = chain_find(table, key);
+	ChainPair* removed = *pair;
+
+	if (!removed)
+		return FALSE;
+
+	*pair = removed->next;
+	free(removed);
+	table->numOfElements--;
+	return TRUE;
+}
+
+typedef struct
+{
+	const char* name;
+	BOOL (*insert)(void* table, void* key);
+	BOOL (*lookup)(void* table, const void* key);
+	BOOL (*remove)(void* table, const void* key);
+} BenchOps;
+
+static BOOL bench_chain_insert(void* table, void* key)
+{
+	return chain_insert(table, key, key);
+}
+
+static BOOL bench_chain_lookup(void* table, const void* key)
+{
+	return chain_get(table, key) == key;
+}
+
+static BOOL bench_chain_remove(void* table, const void* key)
+{
+	return chain_remove(table, key);
+}
+
+static BOOL bench_insert(void* table, void* key)
+{
+	return HashTable_Insert(table, key, key);
+}
+
+static BOOL bench_lookup(void* table, const void* key)
+{
+	return HashTable_GetItemValue(table, key) == key;
+}
+
+static BOOL bench_remove(void* table, const void* key)
+{
+	return HashTable_Remove(table, key);
+}
+
+static BOOL test_bench_run(const BenchOps* ops, void* table)
+{
+	UINT64 times[3] = { 0 };
+
+	/* keys in a scattered order, like lookups from incoming PDUs */
+	UINT64 start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < TEST_BENCH_ENTRIES; x++)
+	{
+		if (!ops->insert(table, test_pointer((x * 7919) % TEST_BENCH_ENTRIES)))
+			return FALSE;
+	}
+	times[0] = winpr_GetTickCount64NS() - start;
+
+	start = winpr_GetTickCount64NS();
+	for (size_t y = 0; y < TEST_BENCH_LOOKUPS; y++)
+	{
+		for (size_t x = 0; x < TEST_BENCH_ENTRIES; x++)
+		{
+			if (!ops->lookup(table, test_pointer((x * 7877) % TEST_BENCH_ENTRIES)))
+				return FALSE;
+		}
+	}
+	times[1] = winpr_GetTickCount64NS() - start;
+
+	start = winpr_GetTickCount64NS();
+	for (size_t x = 0; x < TEST_BENCH_ENTRIES; x++)
+	{
+		if (!ops->remove(table, test_pointer((x * 7919) % TEST_BENCH_ENTRIES)))
+			return FALSE;
+	}
+	times[2] = winpr_GetTickCount64NS() - start;
+
+	printf("%d entries, %s: insert %" PRIu64 "us, %d lookups %" PRIu64 "us, remove %" PRIu64
+	       "us\n",
+	       TEST_BENCH_ENTRIES, ops->name, times[0] / 1000ull, TEST_BENCH_LOOKUPS,
+	       times[1] / 1000ull, times[2] / 1000ull);
+	return TRUE;
+}
+
+static int test_hash_table_bench(void)
+{
+	int rc = -1;
+	ChainTable reference = { 0 };
+	wHashTable* table = HashTable_New(FALSE);
+	wHashTable* synchronized = HashTable_New(TRUE);
+	const BenchOps chainOps = { "separate chaining", bench_chain_insert, bench_chain_lookup,
+		                        bench_chain_remove };
+	const BenchOps tableOps = { "HashTable", bench_insert, bench_lookup, bench_remove };
+	const BenchOps synchronizedOps = { "synchronized HashTable", bench_insert, bench_lookup,
+		                               bench_remove };
+
+	reference.numOfBuckets = 64;
+	reference.hash = HashTable_PointerHash;
+	reference.equals = HashTable_PointerCompare;
+	reference.buckets = calloc(reference.numOfBuckets, sizeof(ChainPair*));
+	if (!table || !synchronized || !reference.buckets)
+		goto fail;
+
+	if (!test_bench_run(&chainOps, &reference) || !test_bench_run(&tableOps, table) ||
+	    !test_bench_run(&synchronizedOps, synchronized))
+		goto fail;
+
+	rc = 1;
+fail:
+	for (size_t x = 0; x < reference.numOfBuckets; x++)
+	{
+		while (reference.buckets && reference.buckets[x])
+			(void)chain_remove(&reference, reference.buckets[x]->key);
+	}
+	free(reference.buckets);
+	HashTable_Free(synchronized);
+	HashTable_Free(table);
+	return rc;
+}
+
 int TestHashTable(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -444,5 +902,17 @@ int TestHashTable(int argc, char* argv[])
 
 	if (test_hash_foreach() < 0)
 		return 3;
+
+	if (test_hash_table_growth() < 0)
+		return 4;
+
+	if (test_hash_foreach_insert() < 0)
+		return 5;
+
+	if (test_hash_table_concurrent() < 0)
+		return 6;
+
+	if (test_hash_table_bench() < 0)
+		return 7;
 	return 0;
 }
@@ -183,6 +183,78 @@ static bool test_operation(wMessageQueue* queue)
 	return rc;
 }
 
+static wMessageQueueCoalesce coalesce_fkt(wMessage* queued, const wMessage* message, void* arg)
+{
+	size_t* calls = arg;
+	WINPR_ASSERT(calls);
+	(*calls)++;
+
+	/* 1 merges into the newest 1, 2 walks over other messages to the next 2, 3 stops */
+	switch (message->id)
+	{
+		case 1:
+			if (queued->id != 1)
+				return WMQ_COALESCE_STOP;
+			queued->wParam = message->wParam;
+			return WMQ_COALESCE_MERGED;
+		case 2:
+			if (queued->id != 2)
+				return WMQ_COALESCE_CONTINUE;
+			queued->wParam = message->wParam;
+			return WMQ_COALESCE_MERGED;
+		default:
+			return WMQ_COALESCE_STOP;
+	}
+}
+
+static bool coalesce(wMessageQueue* queue, UINT32 id, size_t value, int expect, size_t calls)
+{
+	size_t count = 0;
+	const wMessage message = { .id = id, .wParam = (void*)value };
+	if (MessageQueue_Coalesce(queue, &message, coalesce_fkt, &count) != expect)
+		return false;
+	return count == calls;
+}
+
+static bool test_coalesce(wMessageQueue* queue)
+{
+	WINPR_ASSERT(queue);
+
+	/* empty queue, nothing to merge with */
+	if (!coalesce(queue, 2, 1, 0, 0))
+		return false;
+	if (!coalesce(queue, 1, 2, 0, 1))
+		return false;
+	if (!coalesce(queue, 1, 3, 1, 1))
+		return false;
+	if (!coalesce(queue, 3, 4, 0, 1))
+		return false;
+	/* walks over 3 and 1 to the first message */
+	if (!coalesce(queue, 2, 5, 1, 3))
+		return false;
+	/* 3 is the newest message, do not merge across it */
+	if (!coalesce(queue, 1, 6, 0, 1))
+		return false;
+
+	const size_t expect[][2] = { { 2, 5 }, { 1, 3 }, { 3, 4 }, { 1, 6 } };
+	if (MessageQueue_Size(queue) != ARRAYSIZE(expect))
+		return false;
+
+	for (size_t x = 0; x < ARRAYSIZE(expect); x++)
+	{
+		wMessage message = { 0 };
+		if (MessageQueue_Get(queue, &message) < 0)
+			return false;
+		if ((message.id != expect[x][0]) || (message.wParam != (void*)expect[x][1]))
+			return false;
+	}
+
+	/* a closed queue does not accept messages */
+	if (!MessageQueue_PostQuit(queue, 0))
+		return false;
+	return coalesce(queue, 1, 7, -1, 0);
+}
+
 int TestMessageQueue(WINPR_ATTR_UNUSED int argc, WINPR_ATTR_UNUSED char* argv[])
 {
 	if (!wrap_test(test_growth_big_move))
@@ -191,5 +263,7 @@ int TestMessageQueue(WINPR_ATTR_UNUSED int argc, WINPR_ATTR_UNUSED char* argv[])
 		return -2;
 	if (!wrap_test(test_operation))
 		return -3;
+	if (!wrap_test(test_coalesce))
+		return -4;
 	return 0;
 }
@@ -0,0 +1,291 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/wlog.h>
+
+#define TEST_THREADS 4
+#define TEST_THREAD_MESSAGES 5000
+#define TEST_BENCH_ROUNDS 20
+#define TEST_BENCH_MESSAGES 1000
+
+typedef struct
+{
+	wLog* log;
+	size_t index;
+} test_thread_arg;
+
+static BOOL success = TRUE;
+static size_t written = 0;
+static size_t next[TEST_THREADS] = { 0 };
+static char prefixes[TEST_THREADS][64] = { 0 };
+static HANDLE gate = NULL;
+static BYTE data[64] = { 0 };
+static size_t dataMessages = 0;
+
+static BOOL fail(const char* what)
+{
+	(void)fprintf(stderr, "%s\n", what);
+	success = FALSE;
+	return FALSE;
+}
+
+static BOOL test_message(const wLogMessage* msg)
+{
+	size_t index = 0;
+	size_t seq = 0;
+
+	if (gate)
+		(void)WaitForSingleObject(gate, INFINITE);
+
+	written++;
+
+	/* the thread messages, in order per thread and with the prefix of their thread */
+	if (sscanf(msg->TextString, "thread %" PRIuz " message %" PRIuz, &index, &seq) == 2)
+	{
+		if ((index >= TEST_THREADS) || (seq != next[index]))
+			return fail("message out of order");
+		next[index]++;
+
+		if (prefixes[index][0] == '\0')
+			(void)_snprintf(prefixes[index], sizeof(prefixes[index]), "%s", msg->PrefixString);
+		else if (strcmp(prefixes[index], msg->PrefixString) != 0)
+			return fail("thread id prefix mismatch");
+	}
+	return TRUE;
+}
+
+static BOOL test_data(const wLogMessage* msg)
+{
+	dataMessages++;
+
+	if (msg->Length != sizeof(data))
+		return fail("data message length mismatch");
+
+	/* copied when logged, the caller changed its buffer since */
+	const BYTE* bytes = msg->Data;
+	for (size_t x = 0; x < sizeof(data); x++)
+	{
+		if (bytes[x] != (BYTE)x)
+			return fail("data message content mismatch");
+	}
+	return TRUE;
+}
+
+static DWORD WINAPI test_thread(LPVOID arg)
+{
+	const test_thread_arg* targ = arg;
+
+	for (size_t x = 0; x < TEST_THREAD_MESSAGES; x++)
+		WLog_Print(targ->log, WLOG_TRACE, "thread %" PRIuz " message %" PRIuz, targ->index, x);
+
+	ExitThread(0);
+	return 0;
+}
+
+static BOOL test_threads(wLog* log)
+{
+	HANDLE threads[TEST_THREADS] = { 0 };
+	test_thread_arg args[TEST_THREADS] = { 0 };
+	wLogAsyncStats before = { 0 };
+	wLogAsyncStats after = { 0 };
+	BOOL rc = FALSE;
+
+	if (!WLog_SetAsyncMode(WLOG_ASYNC_BLOCK) || !WLog_GetAsyncStats(&before))
+		return FALSE;
+
+	for (size_t x = 0; x < TEST_THREADS; x++)
+	{
+		args[x].log = log;
+		args[x].index = x;
+		threads[x] = CreateThread(NULL, 0, test_thread, &args[x], 0, NULL);
+		if (!threads[x])
+			goto fail;
+	}
+
+	for (size_t x = 0; x < TEST_THREADS; x++)
+		(void)WaitForSingleObject(threads[x], INFINITE);
+
+	if (!WLog_Flush() || !WLog_GetAsyncStats(&after))
+		goto fail;
+
+	for (size_t x = 0; x < TEST_THREADS; x++)
+	{
+		if (next[x] != TEST_THREAD_MESSAGES)
+			goto fail;
+
+		for (size_t y = 0; y < x; y++)
+		{
+			if (strcmp(prefixes[x], prefixes[y]) == 0)
+				goto fail;
+		}
+	}
+
+	if ((after.queued - before.queued != 1ull * TEST_THREADS * TEST_THREAD_MESSAGES) ||
+	    (after.written - before.written != after.queued - before.queued) ||
+	    (after.dropped != before.dropped))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	for (size_t x = 0; x < TEST_THREADS; x++)
+		(void)CloseHandle(threads[x]);
+	return rc;
+}
+
+static BOOL test_drop(wLog* log)
+{
+	wLogAsyncStats before = { 0 };
+	wLogAsyncStats after = { 0 };
+	char text[1024] = { 0 };
+	BOOL rc = FALSE;
+
+	/* the appender stalls, the queue of this thread fills up */
+	gate = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!gate)
+		return FALSE;
+
+	memset(text, 'x', sizeof(text) - 1);
+
+	if (!WLog_SetAsyncMode(WLOG_ASYNC_DROP) || !WLog_GetAsyncStats(&before))
+		goto fail;
+
+	const size_t start = written;
+	for (size_t x = 0; x < 1000; x++)
+		WLog_Print(log, WLOG_TRACE, "%s", text);
+
+	if (!WLog_GetAsyncStats(&after))
+		goto fail;
+
+	(void)SetEvent(gate);
+
+	if (!WLog_Flush() || !WLog_GetAsyncStats(&after))
+		goto fail;
+
+	printf("DROP: %" PRIu64 " queued, %" PRIu64 " dropped\n", after.queued - before.queued,
+	       after.dropped - before.dropped);
+
+	if ((after.dropped == before.dropped) ||
+	    (after.queued - before.queued + after.dropped - before.dropped != 1000) ||
+	    (written - start != after.queued - before.queued))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	(void)SetEvent(gate);
+	(void)WLog_Flush();
+	(void)CloseHandle(gate);
+	gate = NULL;
+	return rc;
+}
+
+static BOOL test_data_copy(wLog* log)
+{
+	if (!WLog_SetAsyncMode(WLOG_ASYNC_BLOCK))
+		return FALSE;
+
+	for (size_t x = 0; x < sizeof(data); x++)
+		data[x] = (BYTE)x;
+
+	const size_t start = dataMessages;
+	WLog_Data(log, WLOG_TRACE, data, sizeof(data));
+	memset(data, 0, sizeof(data));
+
+	if (!WLog_Flush())
+		return FALSE;
+
+	return dataMessages == start + 1;
+}
+
+static BOOL test_bench(wLog* log)
+{
+	UINT64 times[2] = { 0 };
+	const DWORD modes[] = { WLOG_ASYNC_OFF, WLOG_ASYNC_BLOCK };
+
+	/* the default prefix, its formatting moves to the background thread */
+	wLog* root = WLog_GetRoot();
+	if (!WLog_Layout_SetPrefixFormat(root, WLog_GetLogLayout(root),
+	                                 "[%hr:%mi:%se:%ml] [%pid:%tid] [%lv][%mn] - [%fn]: "))
+		return FALSE;
+
+	for (size_t x = 0; x < ARRAYSIZE(modes); x++)
+	{
+		if (!WLog_SetAsyncMode(modes[x]))
+			return FALSE;
+
+		/* bursts that fit the queue, the time spent by the logging thread */
+		for (size_t y = 0; y < TEST_BENCH_ROUNDS; y++)
+		{
+			const UINT64 start = winpr_GetTickCount64NS();
+			for (size_t z = 0; z < TEST_BENCH_MESSAGES; z++)
+				WLog_Print(log, WLOG_TRACE, "benchmark message %" PRIuz, z);
+			times[x] += winpr_GetTickCount64NS() - start;
+
+			if (!WLog_Flush())
+				return FALSE;
+		}
+	}
+
+	printf("%d messages logged: synchronous %" PRIu64 "us, asynchronous %" PRIu64 "us\n",
+	       TEST_BENCH_ROUNDS * TEST_BENCH_MESSAGES, times[0] / 1000ull, times[1] / 1000ull);
+	return WLog_SetAsyncMode(WLOG_ASYNC_OFF);
+}
+
+int TestWLogAsync(int argc, char* argv[])
+{
+	wLogCallbacks callbacks = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	wLog* root = WLog_GetRoot();
+
+	if (!WLog_SetLogAppenderType(root, WLOG_APPENDER_CALLBACK))
+		return -1;
+
+	callbacks.message = test_message;
+	callbacks.data = test_data;
+
+	wLogAppender* appender = WLog_GetLogAppender(root);
+	if (!WLog_ConfigureAppender(appender, "callbacks", (void*)&callbacks))
+		return -1;
+
+	wLogLayout* layout = WLog_GetLogLayout(root);
+	if (!WLog_Layout_SetPrefixFormat(root, layout, "%tid"))
+		return -1;
+
+	wLog* log = WLog_Get("com.test.async");
+	if (!WLog_SetLogLevel(log, WLOG_TRACE))
+		return -1;
+
+	if (!test_threads(log))
+	{
+		printf("test_threads failed\n");
+		return -1;
+	}
+
+	if (!test_drop(log))
+	{
+		printf("test_drop failed\n");
+		return -1;
+	}
+
+	if (!test_data_copy(log))
+	{
+		printf("test_data_copy failed\n");
+		return -1;
+	}
+
+	if (!test_bench(log))
+	{
+		printf("test_bench failed\n");
+		return -1;
+	}
+
+	if (WLog_GetAsyncMode() != WLOG_ASYNC_OFF)
+		return -1;
+
+	return success ? 0 : -1;
+}
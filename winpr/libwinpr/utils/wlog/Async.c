@@ -0,0 +1,692 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * WinPR Logger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <string.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#include "wlog.h"
+#include "Async.h"
+
+/* the queue of each logging thread, a power of two */
+#define WLOG_ASYNC_RING_SIZE (256u * 1024u)
+#define WLOG_ASYNC_RING_MASK (WLOG_ASYNC_RING_SIZE - 1u)
+
+/* larger messages are written by the logging thread once its queue is empty */
+#define WLOG_ASYNC_MAX_RECORD (WLOG_ASYNC_RING_SIZE / 4u)
+
+/* the background thread drains at least this often, in milliseconds */
+#define WLOG_ASYNC_INTERVAL 10
+
+#define WLOG_ASYNC_ALIGN(x) (((x) + 7u) & ~(size_t)7u)
+#define WLOG_ASYNC_RECORD_PAD 0xFFFFFFFF
+
+typedef struct
+{
+	UINT32 size; /* bytes of the record including this header and the alignment */
+	DWORD type;  /* one of LogMessageTypes or WLOG_ASYNC_RECORD_PAD */
+	DWORD level;
+	DWORD packetFlags;
+	size_t line;
+	const char* file;
+	const char* function;
+	const char* format;
+	wLog* log;
+	wLogAsyncOrigin origin;
+	size_t contextLength; /* including the '\0', 0 if there is no context */
+	size_t length;        /* bytes of the message following the context */
+} wLogAsyncRecord;
+
+#define WLOG_ASYNC_HEADER_SIZE WLOG_ASYNC_ALIGN(sizeof(wLogAsyncRecord))
+
+#define WLOG_ASYNC_RING_ACTIVE 0
+#define WLOG_ASYNC_RING_DETACHED 1 /* the owning thread exited */
+#define WLOG_ASYNC_RING_CLOSED 2   /* the logger shut down, the owning thread frees it */
+
+/** A single producer single consumer queue of records. The positions wrap around at 2^32, the
+ *  owning thread advances tail, the thread draining the queues advances head. */
+typedef struct s_wLogAsyncRing
+{
+	struct s_wLogAsyncRing* next;
+	LONG volatile state;
+	LONG volatile head;
+	LONG volatile tail;
+	UINT32 cachedHead; /* last head seen by the owning thread */
+	size_t tid;
+
+	/* written by the owning thread only, the totals are informational */
+	UINT64 queued;
+	UINT64 dropped;
+	UINT64 blocked;
+
+	BYTE buffer[];
+} wLogAsyncRing;
+
+typedef struct
+{
+	BOOL initialized;
+	DWORD requested;
+	LONG volatile started;
+	LONG volatile mode;
+	LONG volatile stop;
+	LONG volatile passes;
+
+	CRITICAL_SECTION control; /* serializes starting and stopping the background thread */
+	CRITICAL_SECTION lock;    /* protects rings and totals */
+	CRITICAL_SECTION drain;   /* held by the thread draining the queues */
+	HANDLE thread;
+	HANDLE wake;
+	HANDLE drained;
+
+	wLogAsyncRing* rings;
+	wLogAsyncStats totals; /* written messages and the counters of freed rings */
+	const wLogAsyncOrigin* current;
+} wLogAsyncState;
+
+static wLogAsyncState g_Async = { 0 };
+
+/* the ring slot of a thread draining the queues, its own messages are written directly */
+static BYTE g_AsyncDrainer = 0;
+
+#if defined(_WIN32)
+static DWORD g_AsyncKey = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t g_AsyncKey;
+#endif
+
+static void async_ring_detach(void* arg)
+{
+	wLogAsyncRing* ring = arg;
+
+	if (!ring || (arg == &g_AsyncDrainer))
+		return;
+
+	if (InterlockedCompareExchange(&ring->state, WLOG_ASYNC_RING_DETACHED,
+	                               WLOG_ASYNC_RING_ACTIVE) == WLOG_ASYNC_RING_CLOSED)
+		free(ring);
+}
+
+#if defined(_WIN32)
+static VOID WINAPI async_fls_callback(PVOID arg)
+{
+	async_ring_detach(arg);
+}
+#endif
+
+static void* async_tls_get(void)
+{
+#if defined(_WIN32)
+	return FlsGetValue(g_AsyncKey);
+#else
+	return pthread_getspecific(g_AsyncKey);
+#endif
+}
+
+static BOOL async_tls_set(void* value)
+{
+#if defined(_WIN32)
+	return FlsSetValue(g_AsyncKey, value);
+#else
+	return pthread_setspecific(g_AsyncKey, value) == 0;
+#endif
+}
+
+static LONG async_load(LONG volatile* value)
+{
+	return InterlockedCompareExchange(value, 0, 0);
+}
+
+static wLogAsyncRing* async_get_ring(void)
+{
+	void* value = async_tls_get();
+
+	if (value == &g_AsyncDrainer)
+		return NULL;
+
+	if (value)
+		return value;
+
+	wLogAsyncRing* ring = calloc(1, sizeof(wLogAsyncRing) + WLOG_ASYNC_RING_SIZE);
+
+	if (!ring)
+		return NULL;
+
+	ring->tid = WLog_Layout_GetThreadId();
+
+	if (!async_tls_set(ring))
+	{
+		free(ring);
+		return NULL;
+	}
+
+	EnterCriticalSection(&g_Async.lock);
+	ring->next = g_Async.rings;
+	g_Async.rings = ring;
+	LeaveCriticalSection(&g_Async.lock);
+	return ring;
+}
+
+static void async_wait_drained(void)
+{
+	(void)ResetEvent(g_Async.drained);
+	(void)SetEvent(g_Async.wake);
+	(void)WaitForSingleObject(g_Async.drained, WLOG_ASYNC_INTERVAL);
+}
+
+static void async_wait_empty(wLogAsyncRing* ring)
+{
+	WINPR_ASSERT(ring);
+
+	while (async_load(&ring->head) != ring->tail)
+	{
+		if (async_load(&g_Async.mode) == WLOG_ASYNC_OFF)
+			break;
+		async_wait_drained();
+	}
+}
+
+/* makes room for size bytes at the tail, *pad is set to the bytes to skip to the start */
+static BOOL async_reserve(wLogAsyncRing* ring, UINT32 size, LONG mode, UINT32* pad)
+{
+	WINPR_ASSERT(ring);
+	WINPR_ASSERT(pad);
+
+	const UINT32 tail = (UINT32)ring->tail;
+	const UINT32 contiguous = WLOG_ASYNC_RING_SIZE - (tail & WLOG_ASYNC_RING_MASK);
+	const UINT32 needed = (contiguous < size) ? contiguous + size : size;
+	BOOL blocked = FALSE;
+
+	*pad = (contiguous < size) ? contiguous : 0;
+
+	while (WLOG_ASYNC_RING_SIZE - (tail - ring->cachedHead) < needed)
+	{
+		ring->cachedHead = (UINT32)async_load(&ring->head);
+
+		if (WLOG_ASYNC_RING_SIZE - (tail - ring->cachedHead) >= needed)
+			break;
+
+		if ((mode != WLOG_ASYNC_BLOCK) || (async_load(&g_Async.mode) == WLOG_ASYNC_OFF))
+			return FALSE;
+
+		if (!blocked)
+			ring->blocked++;
+		blocked = TRUE;
+		async_wait_drained();
+	}
+
+	return TRUE;
+}
+
+BOOL WLog_Async_Write(wLog* log, const wLogMessage* message, BOOL* status)
+{
+	WINPR_ASSERT(log);
+	WINPR_ASSERT(message);
+	WINPR_ASSERT(status);
+
+	const LONG mode = g_Async.mode;
+
+	if (mode == WLOG_ASYNC_OFF)
+		return FALSE;
+
+	const void* data = NULL;
+	size_t length = 0;
+
+	switch (message->Type)
+	{
+		case WLOG_MESSAGE_TEXT:
+			data = message->TextString;
+			length = strlen(message->TextString) + 1;
+			break;
+		case WLOG_MESSAGE_DATA:
+			data = message->Data;
+			length = message->Length;
+			break;
+		case WLOG_MESSAGE_PACKET:
+			data = message->PacketData;
+			length = message->PacketLength;
+			break;
+		default:
+			return FALSE;
+	}
+
+	wLogAsyncRing* ring = async_get_ring();
+
+	if (!ring)
+		return FALSE;
+
+	const char* context = NULL;
+	size_t contextLength = 0;
+
+	if (log->custom)
+	{
+		context = log->custom(log->context);
+		if (context)
+			contextLength = strlen(context) + 1;
+	}
+
+	if ((length > WLOG_ASYNC_MAX_RECORD) ||
+	    (WLOG_ASYNC_HEADER_SIZE + contextLength + length > WLOG_ASYNC_MAX_RECORD))
+	{
+		/* keep the order of the messages of this thread */
+		async_wait_empty(ring);
+		return FALSE;
+	}
+
+	const UINT32 size = (UINT32)WLOG_ASYNC_ALIGN(WLOG_ASYNC_HEADER_SIZE + contextLength + length);
+	UINT32 pad = 0;
+
+	if (!async_reserve(ring, size, mode, &pad))
+	{
+		ring->dropped++;
+		*status = FALSE;
+		return TRUE;
+	}
+
+	const UINT32 tail = (UINT32)ring->tail;
+
+	if (pad >= WLOG_ASYNC_HEADER_SIZE)
+	{
+		wLogAsyncRecord* padding = (wLogAsyncRecord*)&ring->buffer[tail & WLOG_ASYNC_RING_MASK];
+		padding->size = pad;
+		padding->type = WLOG_ASYNC_RECORD_PAD;
+	}
+
+	BYTE* dst = &ring->buffer[(tail + pad) & WLOG_ASYNC_RING_MASK];
+	wLogAsyncRecord* record = (wLogAsyncRecord*)dst;
+	record->size = size;
+	record->type = message->Type;
+	record->level = message->Level;
+	record->packetFlags = message->PacketFlags;
+	record->line = message->LineNumber;
+	record->file = message->FileName;
+	record->function = message->FunctionName;
+	record->format = message->FormatString;
+	record->log = log;
+	record->origin.time = winpr_GetUnixTimeNS();
+	record->origin.tid = ring->tid;
+	record->origin.context = NULL;
+	record->contextLength = contextLength;
+	record->length = length;
+
+	dst += WLOG_ASYNC_HEADER_SIZE;
+	if (contextLength > 0)
+		memcpy(dst, context, contextLength);
+	if (length > 0)
+		memcpy(&dst[contextLength], data, length);
+
+	const UINT32 used = tail - ring->cachedHead;
+	(void)InterlockedExchange(&ring->tail, (LONG)(tail + pad + size));
+	ring->queued++;
+
+	/* the background thread polls, only wake it for errors or a queue filling up */
+	if ((message->Level >= WLOG_ERROR) ||
+	    ((used < WLOG_ASYNC_RING_SIZE / 2) && (used + pad + size >= WLOG_ASYNC_RING_SIZE / 2)))
+		(void)SetEvent(g_Async.wake);
+
+	*status = TRUE;
+	return TRUE;
+}
+
+static void async_write_record(wLogAsyncRecord* record)
+{
+	WINPR_ASSERT(record);
+
+	BYTE* data = &((BYTE*)record)[WLOG_ASYNC_HEADER_SIZE];
+	wLogAsyncOrigin origin = record->origin;
+
+	if (record->contextLength > 0)
+	{
+		origin.context = (const char*)data;
+		data += record->contextLength;
+	}
+
+	wLogMessage message = { 0 };
+	message.Type = record->type;
+	message.Level = record->level;
+	message.LineNumber = record->line;
+	message.FileName = record->file;
+	message.FunctionName = record->function;
+	message.FormatString = record->format;
+
+	switch (record->type)
+	{
+		case WLOG_MESSAGE_TEXT:
+			message.TextString = (const char*)data;
+			break;
+		case WLOG_MESSAGE_DATA:
+			message.Data = data;
+			message.Length = record->length;
+			break;
+		case WLOG_MESSAGE_PACKET:
+			message.PacketData = data;
+			message.PacketLength = record->length;
+			message.PacketFlags = record->packetFlags;
+			break;
+		default:
+			return;
+	}
+
+	g_Async.current = &origin;
+	(void)WLog_Dispatch(record->log, &message);
+	g_Async.current = NULL;
+}
+
+static UINT64 async_drain_ring(wLogAsyncRing* ring)
+{
+	WINPR_ASSERT(ring);
+
+	UINT64 written = 0;
+	UINT32 head = (UINT32)ring->head;
+	const UINT32 tail = (UINT32)async_load(&ring->tail);
+
+	while (head != tail)
+	{
+		const UINT32 offset = head & WLOG_ASYNC_RING_MASK;
+
+		if (WLOG_ASYNC_RING_SIZE - offset < WLOG_ASYNC_HEADER_SIZE)
+			head += WLOG_ASYNC_RING_SIZE - offset; /* too short for a padding record */
+		else
+		{
+			wLogAsyncRecord* record = (wLogAsyncRecord*)&ring->buffer[offset];
+
+			if (record->type != WLOG_ASYNC_RECORD_PAD)
+			{
+				async_write_record(record);
+				written++;
+			}
+			head += record->size;
+		}
+
+		(void)InterlockedExchange(&ring->head, (LONG)head);
+	}
+
+	return written;
+}
+
+static void async_drain_all(void)
+{
+	EnterCriticalSection(&g_Async.drain);
+
+	/* messages logged by the appenders are written directly */
+	void* slot = async_tls_get();
+	(void)async_tls_set(&g_AsyncDrainer);
+
+	EnterCriticalSection(&g_Async.lock);
+	wLogAsyncRing* ring = g_Async.rings;
+	LeaveCriticalSection(&g_Async.lock);
+
+	/* rings are only unlinked below, new ones are added in front of the first one */
+	UINT64 written = 0;
+	for (; ring; ring = ring->next)
+		written += async_drain_ring(ring);
+
+	EnterCriticalSection(&g_Async.lock);
+	g_Async.totals.written += written;
+
+	wLogAsyncRing** pring = &g_Async.rings;
+	while (*pring)
+	{
+		ring = *pring;
+
+		if ((async_load(&ring->state) == WLOG_ASYNC_RING_DETACHED) &&
+		    (async_load(&ring->tail) == ring->head))
+		{
+			g_Async.totals.queued += ring->queued;
+			g_Async.totals.dropped += ring->dropped;
+			g_Async.totals.blocked += ring->blocked;
+			*pring = ring->next;
+			free(ring);
+		}
+		else
+			pring = &ring->next;
+	}
+	LeaveCriticalSection(&g_Async.lock);
+
+	(void)async_tls_set(slot);
+	(void)InterlockedIncrement(&g_Async.passes);
+	LeaveCriticalSection(&g_Async.drain);
+}
+
+static DWORD WINAPI async_thread(LPVOID arg)
+{
+	WINPR_UNUSED(arg);
+
+	(void)async_tls_set(&g_AsyncDrainer);
+
+	for (;;)
+	{
+		(void)WaitForSingleObject(g_Async.wake, WLOG_ASYNC_INTERVAL);
+		(void)ResetEvent(g_Async.wake);
+
+		const BOOL stop = async_load(&g_Async.stop) != 0;
+		async_drain_all();
+		(void)SetEvent(g_Async.drained);
+
+		if (stop)
+			break;
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+/* g_Async.control must be held */
+static BOOL async_start(DWORD mode)
+{
+	if (!g_Async.wake)
+		g_Async.wake = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!g_Async.drained)
+		g_Async.drained = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!g_Async.wake || !g_Async.drained)
+		return FALSE;
+
+	if (!g_Async.thread)
+	{
+		(void)InterlockedExchange(&g_Async.stop, 0);
+		g_Async.thread = CreateThread(NULL, 0, async_thread, NULL, 0, NULL);
+
+		if (!g_Async.thread)
+			return FALSE;
+	}
+
+	(void)InterlockedExchange(&g_Async.mode, (LONG)mode);
+	return TRUE;
+}
+
+/* g_Async.control must be held */
+static void async_stop(void)
+{
+	(void)InterlockedExchange(&g_Async.mode, WLOG_ASYNC_OFF);
+
+	if (g_Async.thread)
+	{
+		(void)InterlockedExchange(&g_Async.stop, 1);
+		(void)SetEvent(g_Async.wake);
+		(void)WaitForSingleObject(g_Async.thread, INFINITE);
+		(void)CloseHandle(g_Async.thread);
+		g_Async.thread = NULL;
+	}
+
+	/* messages queued while the mode changed */
+	async_drain_all();
+}
+
+static BOOL async_set_mode(DWORD mode)
+{
+	BOOL rc = TRUE;
+
+	EnterCriticalSection(&g_Async.control);
+	if (mode == WLOG_ASYNC_OFF)
+		async_stop();
+	else
+		rc = async_start(mode);
+	LeaveCriticalSection(&g_Async.control);
+	return rc;
+}
+
+BOOL WLog_Async_Init(DWORD mode)
+{
+	if (g_Async.initialized)
+		return TRUE;
+
+#if defined(_WIN32)
+	g_AsyncKey = FlsAlloc(async_fls_callback);
+	if (g_AsyncKey == FLS_OUT_OF_INDEXES)
+		return FALSE;
+#else
+	if (pthread_key_create(&g_AsyncKey, async_ring_detach) != 0)
+		return FALSE;
+#endif
+
+	InitializeCriticalSectionAndSpinCount(&g_Async.control, 4000);
+	InitializeCriticalSectionAndSpinCount(&g_Async.lock, 4000);
+	InitializeCriticalSectionAndSpinCount(&g_Async.drain, 4000);
+	g_Async.requested = mode;
+	g_Async.initialized = TRUE;
+	return TRUE;
+}
+
+void WLog_Async_Startup(void)
+{
+	if (!g_Async.initialized || (g_Async.requested == WLOG_ASYNC_OFF))
+		return;
+
+	/* starting the thread may log, that must not start it again */
+	if (InterlockedCompareExchange(&g_Async.started, 1, 0) != 0)
+		return;
+
+	if (!async_set_mode(g_Async.requested))
+		(void)fprintf(stderr, "%s: failed to start the asynchronous logging thread\n", __func__);
+}
+
+void WLog_Async_Uninit(void)
+{
+	if (!g_Async.initialized)
+		return;
+
+	EnterCriticalSection(&g_Async.control);
+	async_stop();
+	LeaveCriticalSection(&g_Async.control);
+
+	/* threads still running free their ring when they exit */
+	EnterCriticalSection(&g_Async.lock);
+	wLogAsyncRing* ring = g_Async.rings;
+	while (ring)
+	{
+		wLogAsyncRing* next = ring->next;
+
+		if (InterlockedCompareExchange(&ring->state, WLOG_ASYNC_RING_CLOSED,
+		                               WLOG_ASYNC_RING_ACTIVE) != WLOG_ASYNC_RING_ACTIVE)
+			free(ring);
+		ring = next;
+	}
+	g_Async.rings = NULL;
+	LeaveCriticalSection(&g_Async.lock);
+
+	(void)CloseHandle(g_Async.wake);
+	(void)CloseHandle(g_Async.drained);
+	g_Async.wake = NULL;
+	g_Async.drained = NULL;
+
+	/* the key stays, the destructor of a running thread still needs it */
+	DeleteCriticalSection(&g_Async.drain);
+	DeleteCriticalSection(&g_Async.lock);
+	DeleteCriticalSection(&g_Async.control);
+	g_Async.initialized = FALSE;
+}
+
+const wLogAsyncOrigin* WLog_Async_GetOrigin(void)
+{
+	if (!g_Async.initialized || (async_tls_get() != &g_AsyncDrainer))
+		return NULL;
+
+	return g_Async.current;
+}
+
+BOOL WLog_SetAsyncMode(DWORD mode)
+{
+	if (mode > WLOG_ASYNC_BLOCK)
+		return FALSE;
+
+	if (!WLog_GetRoot() || !g_Async.initialized)
+		return FALSE;
+
+	(void)InterlockedExchange(&g_Async.started, 1);
+	return async_set_mode(mode);
+}
+
+DWORD WLog_GetAsyncMode(void)
+{
+	if (!WLog_GetRoot())
+		return WLOG_ASYNC_OFF;
+
+	return (DWORD)async_load(&g_Async.mode);
+}
+
+BOOL WLog_Flush(void)
+{
+	if (!WLog_GetRoot() || !g_Async.initialized)
+		return FALSE;
+
+	/* called by an appender, the messages before it are already written */
+	if (async_tls_get() == &g_AsyncDrainer)
+		return TRUE;
+
+	/* the second pass from now started after every message queued before */
+	const LONG target = async_load(&g_Async.passes) + 2;
+
+	while ((async_load(&g_Async.passes) - target) < 0)
+	{
+		if (async_load(&g_Async.mode) == WLOG_ASYNC_OFF)
+			break;
+		async_wait_drained();
+	}
+
+	/* wait for a concurrent async_stop to write what is left */
+	EnterCriticalSection(&g_Async.control);
+	LeaveCriticalSection(&g_Async.control);
+	return TRUE;
+}
+
+BOOL WLog_GetAsyncStats(wLogAsyncStats* stats)
+{
+	if (!stats || !WLog_GetRoot() || !g_Async.initialized)
+		return FALSE;
+
+	EnterCriticalSection(&g_Async.lock);
+	*stats = g_Async.totals;
+
+	for (const wLogAsyncRing* ring = g_Async.rings; ring; ring = ring->next)
+	{
+		stats->queued += ring->queued;
+		stats->dropped += ring->dropped;
+		stats->blocked += ring->blocked;
+	}
+	LeaveCriticalSection(&g_Async.lock);
+	return TRUE;
+}
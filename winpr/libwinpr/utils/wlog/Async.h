@@ -0,0 +1,55 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * WinPR Logger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WINPR_WLOG_ASYNC_PRIVATE_H
+#define WINPR_WLOG_ASYNC_PRIVATE_H
+
+#include "wlog.h"
+
+/**
+ * Asynchronous logging
+ */
+
+/** The state of the logging thread a queued message was captured with */
+typedef struct
+{
+	UINT64 time;         /* winpr_GetUnixTimeNS() */
+	size_t tid;          /* WLog_Layout_GetThreadId() */
+	const char* context; /* result of the custom context function, NULL if none is set */
+} wLogAsyncOrigin;
+
+/** @brief queues a text, data or packet message if the asynchronous mode is enabled.
+ *
+ *  @return \b TRUE if the message was handled, \b status is the result then. \b FALSE if the
+ *  caller has to write the message itself. */
+WINPR_LOCAL BOOL WLog_Async_Write(wLog* log, const wLogMessage* message, BOOL* status);
+
+/** @brief the origin of the message currently written by the background thread, \b NULL when
+ *  called from any other thread. */
+WINPR_LOCAL const wLogAsyncOrigin* WLog_Async_GetOrigin(void);
+
+/** @brief prepares the asynchronous mode while the root logger is initialized, \b mode is
+ *  applied by WLog_Async_Startup */
+WINPR_LOCAL BOOL WLog_Async_Init(DWORD mode);
+
+/** @brief applies the mode passed to WLog_Async_Init once the root logger is ready */
+WINPR_LOCAL void WLog_Async_Startup(void);
+
+/** @brief stops the background thread and writes the queued messages */
+WINPR_LOCAL void WLog_Async_Uninit(void);
+
+#endif /* WINPR_WLOG_ASYNC_PRIVATE_H */
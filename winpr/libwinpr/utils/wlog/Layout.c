@@ -19,6 +19,7 @@
 
 #include <winpr/config.h>
 
+#include <time.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -32,6 +33,7 @@
 #include "wlog.h"
 
 #include "Layout.h"
+#include "Async.h"
 
 #if defined __linux__ && !defined ANDROID
 #include <unistd.h>
@@ -46,6 +48,7 @@ struct format_option_recurse;
 
 struct format_tid_arg
 {
+	const wLogAsyncOrigin* origin;
 	char tid[32];
 };
 
@@ -97,22 +100,66 @@ static void WLog_PrintMessagePrefix(char* prefix, size_t prefixlen,
 	va_end(args);
 }
 
-static const char* get_tid(void* arg)
+size_t WLog_Layout_GetThreadId(void)
 {
-	struct format_tid_arg* targ = arg;
-	WINPR_ASSERT(targ);
-
-	size_t tid = 0;
 #if defined __linux__ && !defined ANDROID
 	/* On Linux we prefer to see the LWP id */
-	tid = (size_t)syscall(SYS_gettid);
+	return (size_t)syscall(SYS_gettid);
 #else
-	tid = (size_t)GetCurrentThreadId();
+	return (size_t)GetCurrentThreadId();
 #endif
+}
+
+static const char* get_tid(void* arg)
+{
+	struct format_tid_arg* targ = arg;
+	WINPR_ASSERT(targ);
+
+	/* a queued message prints the thread that logged it, not the one writing it */
+	const size_t tid = targ->origin ? targ->origin->tid : WLog_Layout_GetThreadId();
 	(void)_snprintf(targ->tid, sizeof(targ->tid), "%08" PRIxz, tid);
 	return targ->tid;
 }
 
+static void get_local_time(const wLogAsyncOrigin* origin, SYSTEMTIME* localTime)
+{
+	WINPR_ASSERT(localTime);
+
+	if (!origin)
+	{
+		GetLocalTime(localTime);
+		return;
+	}
+
+#if defined(_WIN32)
+	const UINT64 ticks = (origin->time / 100ull) + 116444736000000000ull;
+	FILETIME ft = { 0 };
+	FILETIME lt = { 0 };
+	ft.dwLowDateTime = (DWORD)ticks;
+	ft.dwHighDateTime = (DWORD)(ticks >> 32);
+
+	if (!FileTimeToLocalFileTime(&ft, &lt) || !FileTimeToSystemTime(&lt, localTime))
+		GetLocalTime(localTime);
+#else
+	struct tm tres = { 0 };
+	const time_t ct = (time_t)WINPR_TIME_NS_TO_S(origin->time);
+	const struct tm* ltm = localtime_r(&ct, &tres);
+	ZeroMemory(localTime, sizeof(SYSTEMTIME));
+
+	if (ltm)
+	{
+		localTime->wYear = (WORD)(ltm->tm_year + 1900);
+		localTime->wMonth = (WORD)(ltm->tm_mon + 1);
+		localTime->wDayOfWeek = (WORD)ltm->tm_wday;
+		localTime->wDay = (WORD)ltm->tm_mday;
+		localTime->wHour = (WORD)ltm->tm_hour;
+		localTime->wMinute = (WORD)ltm->tm_min;
+		localTime->wSecond = (WORD)ltm->tm_sec;
+		localTime->wMilliseconds = (WORD)WINPR_TIME_NS_REM_MS(origin->time);
+	}
+#endif
+}
+
 static BOOL log_invalid_fmt(const char* what)
 {
 	(void)fprintf(stderr, "Invalid format string '%s'\n", what);
@@ -244,10 +291,20 @@ BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout, const wLogMessa
 	WINPR_ASSERT(message);
 	WINPR_ASSERT(prefix);
 
-	struct format_tid_arg targ = { 0 };
+	const wLogAsyncOrigin* origin = WLog_Async_GetOrigin();
+	struct format_tid_arg targ = { .origin = origin };
 
 	SYSTEMTIME localTime = { 0 };
-	GetLocalTime(&localTime);
+	get_local_time(origin, &localTime);
+
+	/* the context of a queued message was resolved when it was logged */
+	const char* (*ctxfkt)(void*) = log->custom;
+	const void* ctxarg = log->context;
+	if (origin)
+	{
+		ctxfkt = NULL;
+		ctxarg = origin->context;
+	}
 
 	struct format_option_recurse recurse = {
 		.options = NULL, .nroptions = 0, .log = log, .layout = layout, .message = message
@@ -257,8 +314,8 @@ BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout, const wLogMessa
 	struct format_option options[] = {
 		{ ENTRY("%ctx"),
 		  ENTRY("%s"),
-		  log->custom,
-		  { .pv = log->context },
+		  ctxfkt,
+		  { .cpv = ctxarg },
 		  NULL,
 		  &recurse }, /* log context */
 		{ ENTRY("%dw"),
@@ -324,7 +381,7 @@ BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout, const wLogMessa
 		{ ENTRY("%{"),
 		  ENTRY("%}"),
 		  NULL,
-		  { .pv = log->context },
+		  { .cpv = ctxarg },
 		  skip_if_null,
 		  &recurse }, /* skip if no context */
 	};
@@ -35,6 +35,9 @@ struct s_wLogLayout
 
 WINPR_LOCAL void WLog_Layout_Free(wLog* log, wLogLayout* layout);
 
+/** @brief the thread id the \b %tid prefix option prints for the calling thread */
+WINPR_LOCAL size_t WLog_Layout_GetThreadId(void);
+
 WINPR_ATTR_MALLOC(WLog_Layout_Free, 2)
 WINPR_ATTR_NODISCARD
 WINPR_LOCAL wLogLayout* WLog_Layout_New(wLog* log);
@@ -37,6 +37,7 @@
 #endif
 
 #include "wlog.h"
+#include "Async.h"
 
 #define WLOG_MAX_STRING_SIZE 16384
 
@@ -82,6 +83,9 @@ static void WLog_Uninit_(void)
 	if (!root)
 		return;
 
+	/* queued messages still need the appenders */
+	WLog_Async_Uninit();
+
 	for (DWORD index = 0; index < root->ChildrenCount; index++)
 	{
 		child = root->Children[index];
@@ -92,6 +96,32 @@ static void WLog_Uninit_(void)
 	g_RootLog = NULL;
 }
 
+static DWORD WLog_GetAsyncModeFromEnv(void)
+{
+	LPCSTR async = "WLOG_ASYNC";
+	DWORD mode = WLOG_ASYNC_OFF;
+	const DWORD nSize = GetEnvironmentVariableA(async, NULL, 0);
+
+	if (!nSize)
+		return mode;
+
+	char* env = (LPSTR)malloc(nSize);
+
+	if (!env)
+		return mode;
+
+	if (GetEnvironmentVariableA(async, env, nSize) == nSize - 1)
+	{
+		if (_stricmp(env, "DROP") == 0)
+			mode = WLOG_ASYNC_DROP;
+		else if (_stricmp(env, "BLOCK") == 0)
+			mode = WLOG_ASYNC_BLOCK;
+	}
+
+	free(env);
+	return mode;
+}
+
 static void WLog_Lock(wLog* log)
 {
 	WINPR_ASSERT(log);
@@ -165,6 +195,9 @@ static BOOL CALLBACK WLog_InitializeRoot(PINIT_ONCE InitOnce, PVOID Parameter, P
 	if (!WLog_ParseFilters(g_RootLog))
 		goto fail;
 
+	if (!WLog_Async_Init(WLog_GetAsyncModeFromEnv()))
+		goto fail;
+
 	(void)atexit(WLog_Uninit_);
 
 	return TRUE;
@@ -345,11 +378,31 @@ static BOOL WLog_WritePacket(wLog* log, wLogMessage* message)
 	return status;
 }
 
+BOOL WLog_Dispatch(wLog* log, wLogMessage* message)
+{
+	WINPR_ASSERT(message);
+
+	switch (message->Type)
+	{
+		case WLOG_MESSAGE_TEXT:
+			return WLog_Write(log, message);
+		case WLOG_MESSAGE_DATA:
+			return WLog_WriteData(log, message);
+		case WLOG_MESSAGE_IMAGE:
+			return WLog_WriteImage(log, message);
+		case WLOG_MESSAGE_PACKET:
+			return WLog_WritePacket(log, message);
+		default:
+			return FALSE;
+	}
+}
+
 static BOOL WLog_PrintTextMessageInternal(wLog* log, const wLogMessage* cmessage, va_list args)
 {
 	assert(cmessage);
 
-	char formattedLogMessage[WLOG_MAX_STRING_SIZE] = { 0 };
+	/* vsnprintf terminates the string, clearing the whole buffer for every message is costly */
+	char formattedLogMessage[WLOG_MAX_STRING_SIZE];
 	wLogMessage message = *cmessage;
 	message.TextString = formattedLogMessage;
 
@@ -360,6 +413,10 @@ static BOOL WLog_PrintTextMessageInternal(wLog* log, const wLogMessage* cmessage
 		return FALSE;
 	WINPR_PRAGMA_DIAG_POP
 
+	BOOL status = FALSE;
+	if (WLog_Async_Write(log, &message, &status))
+		return status;
+
 	return WLog_Write(log, &message);
 }
 
@@ -385,7 +442,8 @@ BOOL WLog_PrintMessageVA(wLog* log, DWORD type, DWORD level, size_t line, const
 		case WLOG_MESSAGE_DATA:
 			message.Data = va_arg(args, void*);
 			message.Length = va_arg(args, size_t);
-			status = WLog_WriteData(log, &message);
+			if (!WLog_Async_Write(log, &message, &status))
+				status = WLog_WriteData(log, &message);
 			break;
 
 		case WLOG_MESSAGE_IMAGE:
@@ -400,7 +458,8 @@ BOOL WLog_PrintMessageVA(wLog* log, DWORD type, DWORD level, size_t line, const
 			message.PacketData = va_arg(args, void*);
 			message.PacketLength = va_arg(args, size_t);
 			message.PacketFlags = va_arg(args, unsigned);
-			status = WLog_WritePacket(log, &message);
+			if (!WLog_Async_Write(log, &message, &status))
+				status = WLog_WritePacket(log, &message);
 			break;
 
 		default:
@@ -956,6 +1015,7 @@ wLog* WLog_GetRoot(void)
 	if (!InitOnceExecuteOnce(&g_WLogInitialized, WLog_InitializeRoot, NULL, NULL))
 		return NULL;
 
+	WLog_Async_Startup();
 	return g_RootLog;
 }
 
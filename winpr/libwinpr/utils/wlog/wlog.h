@@ -84,6 +84,9 @@ WINPR_LOCAL BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout,
                                               const wLogMessage* message, char* prefix,
                                               size_t prefixlen);
 
+/** @brief hands a message to the appender of \b log on the calling thread */
+WINPR_LOCAL BOOL WLog_Dispatch(wLog* log, wLogMessage* message);
+
 #include "Layout.h"
 #include "Appender.h"
 